@@ -0,0 +1,31 @@
+// Adaptive sensor sampling.
+//
+// Picks the interval until the next sensor read from how much the last readings
+// moved. A reading that changed faster than a per-channel rate threshold (above the
+// sensor's noise floor), or a channel whose recent spread is well above its noise,
+// drops the interval straight to the minimum; while readings stay flat it backs off
+// geometrically to the maximum. A stable room is then read about once a minute and a
+// window being opened about once a second.
+//
+// Pure logic with no I/O; the simulator's --sampler-test replays traces through it.
+#pragma once
+
+#include <stdint.h>
+
+struct SamplerStats {
+  uint32_t intervalMs;    // Interval chosen after the latest reading
+  float activity;         // Latest change score: >= 1 means "changing", < 0.5 means "flat"
+  uint32_t samples;       // Readings since samplerBegin()
+  uint32_t fastSamples;   // Readings taken at the minimum interval
+  uint32_t skippedReads;  // Reads avoided compared with always sampling at the minimum interval
+};
+
+void samplerBegin(uint32_t minIntervalMs, uint32_t maxIntervalMs);
+
+// Feeds one reading and returns the interval to wait before the next one. NaN marks a
+// channel that failed, was rejected or has no sensor; with no channel read the
+// interval is held.
+uint32_t samplerUpdate(float tempC, float humidity, float pressureHpa, uint32_t nowMs);
+
+uint32_t samplerInterval();
+const SamplerStats& samplerGetStats();
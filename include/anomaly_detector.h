@@ -0,0 +1,100 @@
+// Streaming anomaly and stuck-sensor detection on the sensor readings.
+//
+// Every reading of each channel is checked as it arrives, in O(1) time:
+//   - failed reads, and values outside the sensor's measuring range;
+//   - steps between two readings that no room can produce (a fixed allowance plus a
+//     rate limit, so a long sampling interval isn't mistaken for a fault);
+//   - spikes: readings further than ANOMALY_Z_LIMIT deviations from a Holt (level and
+//     trend) forecast, the deviation being an exponentially weighted average of the
+//     forecast residuals. Rejected readings don't feed the forecast, so a burst of
+//     garbage can't drag it along; ANOMALY_SHIFT_READINGS consecutive spikes that agree
+//     with each other are taken as a real change and restart it;
+//   - a stuck sensor (exactly the same value ANOMALY_STUCK_READINGS times in a row) and
+//     a flat line (readings within a fraction of the sensor's noise for ANOMALY_FLAT_SEC).
+//
+// anomalyCheck() returns the condition of the reading: only SENSOR_OK readings should
+// reach charts, statistics and alerts. Each change to a bad condition, and recovery
+// from a lasting fault, is also recorded as a typed event in a small ring.
+//
+// loop() checks readings while web handlers read conditions and events.
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+enum AnomalyChannel : uint8_t {
+  ANOMALY_TEMP,
+  ANOMALY_HUMIDITY,
+  ANOMALY_PRESSURE,
+  ANOMALY_CHANNELS
+};
+
+// Condition of a reading, mildest first. As an event type, SENSOR_OK marks recovery.
+enum SensorCondition : uint8_t {
+  SENSOR_OK,
+  SENSOR_SPIKE,          // Far off the forecast
+  SENSOR_STEP,           // Jumped further than physically possible since the last reading
+  SENSOR_OUT_OF_RANGE,   // Outside the sensor's measuring range
+  SENSOR_STUCK,          // The same value ANOMALY_STUCK_READINGS times in a row
+  SENSOR_FLAT,           // No change beyond a fraction of the noise for ANOMALY_FLAT_SEC
+  SENSOR_READ_FAILED,
+  SENSOR_CONDITIONS
+};
+
+const uint8_t ANOMALY_EVENTS = 16;           // Events kept
+const uint8_t ANOMALY_WARMUP = 10;           // Readings before spikes are judged
+const float ANOMALY_Z_LIMIT = 6.0f;
+const uint8_t ANOMALY_SHIFT_READINGS = 3;
+const uint8_t ANOMALY_STUCK_READINGS = 5;
+const uint32_t ANOMALY_FLAT_SEC = 60 * 60;
+
+struct AnomalyEvent {
+  uint32_t atMs;         // millis() of the reading
+  float value;
+  AnomalyChannel channel;
+  SensorCondition type;
+};
+
+// Internal state, public only so a test run can use its own instance
+struct AnomalyChannelState {
+  uint32_t accepted;     // Readings that have fed the forecast
+  uint32_t lastMs;       // Time of the last accepted reading
+  float last;            // Last accepted reading
+  float level;           // Holt forecast
+  float trend;           // Per second
+  float residualVar;
+  float rejected;        // Last spike, and how many came in a row
+  uint8_t rejectedRun;
+  float previous;        // Previous in-range reading, and how many in a row equalled it
+  uint8_t stuckRun;
+  float flatAnchor;      // Start of the current run of unchanged readings
+  uint32_t flatSinceMs;
+  bool seen;
+  SensorCondition condition;   // Of the latest reading
+  bool faulted;          // A lasting fault (out of range, stuck, flat, failed) hasn't cleared yet
+  uint32_t counts[SENSOR_CONDITIONS];   // Events by type
+};
+
+struct AnomalyDetector {
+  AnomalyChannelState channels[ANOMALY_CHANNELS];
+  AnomalyEvent events[ANOMALY_EVENTS];
+  uint32_t eventEnd;     // Running index of the next event
+  portMUX_TYPE lock;
+};
+
+void anomalyBegin(AnomalyDetector& d);
+// Checks one reading (nowMs = millis() of the read; readOk false for a failed read).
+// Call from one task only.
+SensorCondition anomalyCheck(AnomalyDetector& d, AnomalyChannel c, uint32_t nowMs, bool readOk, float value);
+// Condition of the latest reading of c. Safe from any task.
+SensorCondition anomalyCondition(AnomalyDetector& d, AnomalyChannel c);
+// Events of type t on channel c so far.
+uint32_t anomalyEventCount(AnomalyDetector& d, AnomalyChannel c, SensorCondition t);
+// Running index of the oldest kept event, and one past the newest.
+uint32_t anomalyEventFirst(AnomalyDetector& d);
+uint32_t anomalyEventEnd(AnomalyDetector& d);
+// Copies event i. False if it was overwritten or isn't there yet.
+bool anomalyEventGet(AnomalyDetector& d, uint32_t i, AnomalyEvent& out);
+
+const char* anomalyChannelName(AnomalyChannel c);     // "temp", "humidity", "pressure"
+const char* sensorConditionName(SensorCondition c);   // e.g. "stuck"
@@ -0,0 +1,66 @@
+// BH1750 ambient light sensor: non-blocking one-time measurements with auto-ranging.
+//
+// bh1750Poll() starts a one-time measurement and returns; a later call, once the
+// measurement time has passed, reads the result. Nothing waits on the bus, and the
+// sensor powers itself down between measurements.
+//
+// The sensor counts light for a time set by its MTreg register (31..254, 69 by
+// default), in H-resolution mode (1 count = 1 lx / 1.2 at MTreg 69) or H-resolution
+// mode 2 (twice as fine, same time). The ranges below go from the finest resolution,
+// for a dark room, to the shortest measurement, which is the only one that doesn't
+// saturate in sunlight. After each reading the driver moves one range coarser when the
+// count nears full scale, re-measuring at once if it clipped, and one range finer
+// when the reading would fit comfortably in the finer one.
+//
+// The caller holds the I2C bus around bh1750Begin() and bh1750Poll() (see i2c_bus.h).
+#pragma once
+
+#include <stdint.h>
+#include <Wire.h>
+
+const uint8_t BH1750_ADDRESS = 0x23;        // ADDR pin low (0x5C with it high)
+const uint16_t BH1750_INTERVAL_MS = 2000;   // Time from one measurement to the next
+
+enum Bh1750Range : uint8_t {
+  BH1750_RANGE_DARK,     // H-res mode 2, MTreg 254: 0.11 lx per count, up to 7 400 lx, 663 ms
+  BH1750_RANGE_DIM,      // H-res mode 2, MTreg 69: 0.42 lx, up to 27 300 lx, 180 ms
+  BH1750_RANGE_NORMAL,   // H-res mode, MTreg 69: 0.83 lx, up to 54 600 lx, 180 ms
+  BH1750_RANGE_BRIGHT,   // H-res mode, MTreg 31: 1.85 lx, up to 121 500 lx, 81 ms
+  BH1750_RANGES
+};
+
+enum Bh1750Status : uint8_t {
+  BH1750_IDLE,       // Nothing was due
+  BH1750_STARTED,    // A measurement was started
+  BH1750_READING,    // A new reading is in bh1750Lux()
+  BH1750_RANGING,    // The reading clipped; a coarser measurement follows straight away
+  BH1750_FAILED      // The sensor didn't answer; tried again after BH1750_INTERVAL_MS
+};
+
+// Internal state, public only so a test run can use its own instance
+struct Bh1750 {
+  TwoWire* wire;
+  uint8_t address;
+  Bh1750Range range;
+  uint8_t mtreg;          // As last written to the sensor; 0 = unknown
+  bool measuring;
+  uint32_t dueMs;         // When the measurement can be read, or the next one started
+  float lux;              // Latest reading, NaN until the first one
+  uint16_t raw;           // Its count
+  uint32_t readings;
+  uint32_t failures;
+  uint32_t rangeChanges;
+};
+
+// Probes the sensor and powers it on; the first measurement is due at once. False if
+// it doesn't answer.
+bool bh1750Begin(Bh1750& s, TwoWire& wire, uint32_t nowMs, uint8_t address = BH1750_ADDRESS);
+// True when bh1750Poll() has work to do, i.e. it's worth taking the bus for.
+bool bh1750Due(const Bh1750& s, uint32_t nowMs);
+// millis() time at which bh1750Due() turns true.
+uint32_t bh1750Deadline(const Bh1750& s);
+// Starts or collects a measurement as due. Call with the bus held.
+Bh1750Status bh1750Poll(Bh1750& s, uint32_t nowMs);
+
+float bh1750Lux(const Bh1750& s);                 // NaN until the first reading
+const char* bh1750RangeName(Bh1750Range r);       // e.g. "dark"
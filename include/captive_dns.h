@@ -0,0 +1,27 @@
+// Captive-portal DNS: answers every A query with the access point's address.
+//
+// The Arduino DNSServer has to be polled with processNextRequest(), which kept loop()
+// spinning every 10 ms in setup mode and left queries unanswered whenever the loop was
+// busy (the first connection attempt, the NTP wait, a display flush). Phones decide
+// whether a network has a captive portal from how fast a probe resolves, so a slow
+// answer shows as "no internet" instead of the sign-in page. This responder sits on
+// AsyncUDP instead: each query is answered from the UDP task as it arrives, and the
+// loop has nothing to poll.
+//
+// Queries for other record types (AAAA, HTTPS, ...) get an empty NOERROR answer, which
+// sends the client to its A query. Anything that is not a well-formed standard query
+// with one question is dropped.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint32_t CAPTIVE_DNS_TTL_S = 60;
+const size_t CAPTIVE_DNS_MAX_PACKET = 512;   // Plain UDP DNS
+
+// Starts answering on port 53 with ip (network byte order, as IPAddress stores it).
+bool captiveDnsBegin(const uint8_t ip[4]);
+uint32_t captiveDnsAnswered();
+
+// The reply to the DNS message query[0, len) in out, or 0 if it gets none.
+size_t captiveDnsReply(const uint8_t* query, size_t len, const uint8_t ip[4], uint8_t* out, size_t size);
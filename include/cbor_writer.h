@@ -0,0 +1,27 @@
+// Minimal CBOR (RFC 8949) encoder for the binary API.
+//
+// Items are written straight to a Print (normally the response's HttpBuffer) as they
+// are produced: there is no document tree, so maps and arrays take their item count
+// up front. Numeric series go out as RFC 8746 typed arrays, one byte string of
+// little-endian values behind a tag, which costs 4 bytes a float instead of 5.
+#pragma once
+
+#include <Arduino.h>
+
+// RFC 8746 typed array tags
+const uint8_t CBOR_TAG_UINT32_LE = 70;
+const uint8_t CBOR_TAG_FLOAT32_LE = 85;
+
+void cborMap(Print& out, uint32_t pairs);
+void cborArray(Print& out, uint32_t items);
+void cborTag(Print& out, uint32_t tag);
+void cborUint(Print& out, uint64_t v);
+void cborInt(Print& out, int64_t v);
+void cborFloat(Print& out, float v);
+void cborText(Print& out, const char* s);
+void cborBool(Print& out, bool v);
+void cborNull(Print& out);
+
+// Tagged typed arrays: the tag, a byte string header, then the packed values.
+void cborUint32Array(Print& out, const uint32_t* v, uint32_t count);
+void cborFloat32Array(Print& out, const float* v, uint32_t count);
@@ -0,0 +1,72 @@
+// Deferred commands from the web handlers to loop().
+//
+// Handlers run on the AsyncTCP task, which serves every connection: anything slow
+// there (delay() before a restart, NVS writes, display updates) stalls the other
+// clients and can trip the task watchdog. Handlers instead post a typed Command,
+// answer the request and return; loop() takes the commands in order and runs them.
+// The queue is a small fixed ring, so posting never allocates and fails (the handler
+// answers 503) rather than blocking when loop() has fallen behind.
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t COMMAND_QUEUE_DEPTH = 8;
+
+enum CommandType : uint8_t {
+  CMD_REBOOT,           // Restart after rebootDelayMs, so the response can go out first
+  CMD_SAVE_WIFI,        // Store Wi-Fi credentials and device name, then restart
+  CMD_APPLY_SETTINGS,   // Store the settings page values, then restart
+  CMD_FIND_ME           // Start the "Find My Mochi" sequence
+};
+
+struct WifiConfig {
+  char ssid[33];
+  char pass[65];
+  char name[33];        // Already sanitized for mDNS
+};
+
+struct SettingsValues {
+  float tempHigh;
+  float tempLow;
+  int32_t tzOffset;
+  uint16_t sensorInterval;   // Seconds
+  uint16_t sensorMin;
+  uint16_t sensorMax;
+  uint16_t oledTimeout;      // Minutes
+  int16_t altitude;          // Metres above sea level
+  uint8_t quietStart;
+  uint8_t quietEnd;
+  uint8_t alarmHour;
+  uint8_t alarmMinute;
+  bool buzzer;
+  bool alarmEnabled;
+  bool sensorAdaptive;
+  bool autoBrightness;
+};
+
+struct Command {
+  CommandType type;
+  uint32_t postedAt;    // millis(), filled in by commandQueuePost()
+  union {
+    uint16_t rebootDelayMs;
+    WifiConfig wifi;
+    SettingsValues settings;
+  };
+};
+
+struct CommandQueueStats {
+  uint32_t posted;
+  uint32_t executed;
+  uint32_t rejected;    // Posts refused because the queue was full
+  uint8_t depth;        // Commands waiting now
+  uint8_t depthMax;
+  uint32_t waitMsLast;  // Time from post to loop() taking the command
+  uint32_t waitMsMax;
+  float waitMsAvg;
+};
+
+// Queues a copy of cmd. Safe from any task; false if the queue is full.
+bool commandQueuePost(const Command& cmd);
+// Oldest waiting command, if any. Call from loop() only.
+bool commandQueueTake(Command& out);
+const CommandQueueStats& commandQueueGetStats();
@@ -0,0 +1,155 @@
+// Crash-surviving trace of what the firmware was doing.
+//
+// A ring of the last TRACE_EVENTS events lives in RTC memory (RTC_NOINIT_ATTR), which
+// keeps its contents through a watchdog, panic, brownout or ESP.restart() reset; only a
+// power-on clears it. Each event is one 32-bit word, a TraceType in the top byte and a
+// 24-bit argument below, so recording one is a load, two stores and an increment:
+// cheap enough to leave on in every build. Events are loop passes (with the time),
+// loop stages, web handler entries, I2C transactions, new heap low-water marks and
+// deliberate restarts.
+//
+// crashTraceBegin(), first thing in setup(), takes a copy of the previous run's events
+// when the reset kept them and starts a new trace. /debug/lastcrash serves that copy,
+// oldest first, with the reset reason.
+//
+// Recording takes no lock. Two tasks recording at the same instant may overwrite each
+// other's event; for a post-mortem trace that is a fair price for not locking.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Print;
+
+const uint16_t TRACE_EVENTS = 512;         // A power of two; 2 KB of RTC memory
+const uint32_t TRACE_MAGIC = 0x54524332;   // "TRC2"; changed when the ids below change
+const uint32_t TRACE_ARG_MASK = 0xFFFFFF;
+
+enum TraceType : uint8_t {
+  TRACE_NONE,
+  TRACE_BOOT,        // arg: reset reason (esp_reset_reason_t) of this boot
+  TRACE_LOOP,        // arg: millis() & TRACE_ARG_MASK at the start of a loop() pass
+  TRACE_STAGE,       // arg: TraceStage
+  TRACE_HANDLER,     // arg: TraceHandler
+  TRACE_I2C,         // arg: 7-bit address << 17 | ok << 16 | bus hold time in us (saturating)
+  TRACE_HEAP,        // arg: new minimum free heap in bytes
+  TRACE_RESTART,     // arg: TraceRestart
+  TRACE_TYPES
+};
+
+enum TraceStage : uint8_t {
+  TRACE_STAGE_OTA,
+  TRACE_STAGE_COMMANDS,
+  TRACE_STAGE_PORTAL,
+  TRACE_STAGE_LIGHT,
+  TRACE_STAGE_SENSORS,
+  TRACE_STAGE_STORE,
+  TRACE_STAGE_ALERTS,
+  TRACE_STAGE_GESTURE,
+  TRACE_STAGE_DISPLAY,
+  TRACE_STAGE_IDLE,
+  TRACE_STAGES
+};
+
+enum TraceHandler : uint8_t {
+  TRACE_H_ROOT,
+  TRACE_H_DATA,
+  TRACE_H_HISTORY,
+  TRACE_H_STATS,
+  TRACE_H_QUANTILES,
+  TRACE_H_SENSOR_EVENTS,
+  TRACE_H_METRICS,
+  TRACE_H_EXPORT,
+  TRACE_H_LOGS,
+  TRACE_H_LASTCRASH,
+  TRACE_H_SETTINGS,
+  TRACE_H_SAVE_SETTINGS,
+  TRACE_H_REBOOT,
+  TRACE_H_UPDATE,
+  TRACE_H_UPDATE_UPLOAD,
+  TRACE_H_FIND,
+  TRACE_H_CONFIG,
+  TRACE_H_SAVE_CONFIG,
+  TRACE_H_NOT_FOUND,
+  TRACE_H_NETWORKS,
+  TRACE_HANDLERS
+};
+
+enum TraceRestart : uint8_t {
+  TRACE_RESTART_COMMAND,   // Reboot, saved settings or Wi-Fi, finished web update
+  TRACE_RESTART_OTA        // ArduinoOTA restarts by itself after onEnd
+};
+
+struct TraceRing {
+  uint32_t magic;
+  uint32_t head;             // Events recorded since traceBegin(); the next goes to head % TRACE_EVENTS
+  uint32_t boot;             // Boots since the last power-on, this one included
+  uint32_t events[TRACE_EVENTS];
+};
+
+// The previous run's trace, oldest event first
+struct TraceSnapshot {
+  bool valid;                // False after a power-on or when RTC memory held no trace
+  int resetReason;           // esp_reset_reason_t that ended it
+  uint32_t boot;             // Its boot number
+  uint32_t recorded;         // Events it recorded, including those overwritten since
+  uint16_t count;            // Events kept, <= TRACE_EVENTS
+  uint32_t events[TRACE_EVENTS];
+};
+
+struct TraceEvent {
+  TraceType type;
+  uint32_t arg;
+};
+
+// The firmware's trace, in RTC memory
+extern TraceRing crashTrace;
+
+inline uint32_t traceEncode(TraceType type, uint32_t arg) {
+  return (uint32_t)type << 24 | (arg & TRACE_ARG_MASK);
+}
+
+inline TraceEvent traceDecode(uint32_t word) {
+  TraceEvent e;
+  e.type = (TraceType)(word >> 24);
+  e.arg = word & TRACE_ARG_MASK;
+  return e;
+}
+
+inline void traceRecordTo(TraceRing& t, TraceType type, uint32_t arg) {
+  uint32_t h = t.head;
+  t.events[h & (TRACE_EVENTS - 1)] = traceEncode(type, arg);
+  t.head = h + 1;
+}
+
+inline void traceRecord(TraceType type, uint32_t arg) {
+  traceRecordTo(crashTrace, type, arg);
+}
+
+inline uint32_t traceI2cArg(uint8_t address, bool ok, uint32_t us) {
+  return (uint32_t)(address & 0x7F) << 17 | (ok ? 1u << 16 : 0) | (us > 0xFFFF ? 0xFFFF : us);
+}
+
+// Empties t and starts a new trace numbered boot.
+void traceBegin(TraceRing& t, uint32_t boot);
+// Copies t's events into out, oldest first, if t holds a trace that survived a reset
+// with reason resetReason. Returns out.valid.
+bool traceSnapshot(const TraceRing& t, int resetReason, TraceSnapshot& out);
+// The event as a JSON object, e.g. {"type":"i2c","addr":56,"ok":true,"us":412}; returns its length.
+size_t traceEventJson(const TraceEvent& e, char* out, size_t size);
+const char* traceTypeName(TraceType type);
+const char* traceStageName(TraceStage stage);
+const char* traceHandlerName(TraceHandler handler);
+const char* resetReasonName(int reason);   // "panic", "task_wdt", ...
+
+// Call first in setup() with esp_reset_reason(): keeps the previous run's trace and
+// starts this one.
+void crashTraceBegin(int resetReason);
+const TraceSnapshot& crashTraceLast();
+// Records a TRACE_HEAP event if the heap's low-water mark fell since the last one.
+void crashTraceHeap();
+
+// /debug/lastcrash: the previous run's trace as one JSON document. An HttpStreamFn and
+// the state it keeps (2 words).
+void crashReportBegin(uint32_t* state);
+bool crashReportNext(Print& out, uint32_t* state);
@@ -0,0 +1,40 @@
+// Percentiles of temperature, humidity and pressure over the last hour, day and week.
+//
+// Each window is a tier of quantile sketches (quantile_sketch.h), one per time bucket:
+// 4 x 15 min for the hour, 6 x 4 h for the day, 7 x 1 day for the week. Readings go
+// into a small pending batch and from there into the current 15 min sketch only. When
+// a bucket ends its sketch is merged into the current bucket of the next tier up, so
+// the longer windows are rollups and no reading is ever touched twice. A query merges
+// the sketches inside the window plus the still-open buckets of the tiers below, all in
+// one pass.
+//
+// About 30 KB in all (592 bytes per sketch), and 6 KB more for queries. loop() adds
+// readings; web handlers query.
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "env_stats.h"
+#include "quantile_sketch.h"
+
+const uint8_t EQ_CHANNELS = ENV_PRESSURE + 1;   // Temperature, humidity, pressure
+const uint8_t EQ_SLOTS = 4 + 6 + 7;             // Buckets of all tiers
+const uint8_t EQ_PENDING = 8;                   // Readings batched per sketch update
+
+struct EnvQuantiles {
+  uint32_t newest[ENV_WINDOWS];      // Current bucket number of each tier
+  uint32_t ids[EQ_SLOTS];            // Bucket number held in each slot
+  QuantileSketch sketches[EQ_CHANNELS][EQ_SLOTS];
+  float pending[EQ_CHANNELS][EQ_PENDING];
+  uint8_t pendingCount[EQ_CHANNELS];
+  bool started;
+  portMUX_TYPE lock;
+};
+
+void envQuantilesBegin(EnvQuantiles& s);
+// One reading at nowS (monotonic seconds, as for envStatsAdd()); NaN skips a channel.
+// Call from one task only.
+void envQuantilesAdd(EnvQuantiles& s, uint32_t nowS, float tempC, float humidity, float pressureHpa);
+// Merges everything in window w ending at nowS into out; query it with qsketchQuantile().
+// False for a channel without quantiles (c >= EQ_CHANNELS). Call from one task only.
+bool envQuantilesSketch(EnvQuantiles& s, EnvWindow w, EnvChannel c, uint32_t nowS, QuantileSketch& out);
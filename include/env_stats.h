@@ -0,0 +1,98 @@
+// Rolling environment statistics and comfort metrics.
+//
+// Every reading updates min, max, mean and variance of temperature, humidity, pressure
+// and dew point over the last hour, day and week in constant time, so the dashboard,
+// the parameter screen and the API never rescan the history.
+//
+// Each window is a ring of time buckets (5 min for the hour, 1 h for the day, 6 h for
+// the week; the window slides a bucket at a time). A reading is folded into the newest
+// bucket with a Welford update and offered to a monotonic deque of bucket extrema per
+// direction, whose front is the window's min or max. A query merges the bucket
+// moments (Chan et al.) instead of keeping a running total that expiring buckets would
+// have to be subtracted from, so float error never accumulates over days of uptime.
+//
+// Dew point, absolute humidity and heat index are derived from each reading.
+//
+// Pure logic apart from a spinlock: loop() adds readings while web handlers query.
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+enum EnvChannel : uint8_t {
+  ENV_TEMP,
+  ENV_HUMIDITY,
+  ENV_PRESSURE,
+  ENV_DEW_POINT,
+  ENV_CHANNELS
+};
+
+enum EnvWindow : uint8_t {
+  ENV_1H,
+  ENV_24H,
+  ENV_7D,
+  ENV_WINDOWS
+};
+
+const uint8_t ENV_MAX_BUCKETS = 28;
+
+struct EnvSummary {
+  uint32_t count;   // Readings in the window; the other fields are NaN when 0
+  float min;
+  float max;
+  float mean;
+  float stddev;
+};
+
+struct EnvComfort {
+  float dewPointC;
+  float absHumidity;   // g/m3
+  float heatIndexC;    // Apparent temperature (NWS heat index)
+};
+
+// Internal state, public only so a benchmark can run on its own instance
+struct EnvBucket {
+  uint32_t count;
+  float mean;
+  float m2;
+};
+
+struct EnvDeque {
+  uint32_t bucket[ENV_MAX_BUCKETS];
+  float value[ENV_MAX_BUCKETS];
+  uint8_t head;
+  uint8_t len;
+};
+
+struct EnvWindowState {
+  uint32_t bucketSec;
+  uint8_t buckets;
+  uint32_t newest;                       // Bucket number (time / bucketSec) of the latest reading
+  uint32_t ids[ENV_MAX_BUCKETS];         // Bucket number held in each slot
+  EnvBucket moments[ENV_CHANNELS][ENV_MAX_BUCKETS];
+  EnvDeque lows[ENV_CHANNELS];
+  EnvDeque highs[ENV_CHANNELS];
+};
+
+struct EnvStats {
+  EnvWindowState windows[ENV_WINDOWS];
+  EnvComfort comfort;
+  bool started;
+  portMUX_TYPE lock;
+};
+
+const char* envWindowName(EnvWindow w);       // "1h", "24h", "7d"
+const char* envChannelName(EnvChannel c);     // "temp", "humidity", "pressure", "dew_point"
+
+void envStatsBegin(EnvStats& s);
+// One reading at nowS (seconds on a monotonic clock, e.g. millis() / 1000). NaN marks
+// a channel as unavailable; dew point and comfort need both temperature and humidity.
+void envStatsAdd(EnvStats& s, uint32_t nowS, float tempC, float humidity, float pressureHpa);
+// Summary of one channel over a window ending at nowS.
+EnvSummary envStatsGet(EnvStats& s, EnvWindow w, EnvChannel c, uint32_t nowS);
+EnvComfort envStatsComfort(EnvStats& s);
+
+// Derived quantities, also usable on their own
+float envDewPoint(float tempC, float humidity);
+float envAbsoluteHumidity(float tempC, float humidity);
+float envHeatIndex(float tempC, float humidity);
@@ -0,0 +1,67 @@
+// Fixed-frame-rate animator for the "Big Eyes" face.
+//
+// Composes each frame from the precomputed socket layers in eye_frames.h plus
+// tweened pupils, blinks and dithered cross-fades between expressions. It only
+// writes into a 128x64 SSD1306 page-layout framebuffer and never touches the
+// bus itself, so the same code runs against a plain host buffer.
+//
+// Typical use from loop():
+//   if (eyeAnimTick(millis(), busBusy)) {
+//     uint32_t t0 = micros();
+//     display.display();
+//     eyeAnimFlushDone(micros() - t0);
+//   }
+#pragma once
+
+#include <stdint.h>
+
+enum EyeEase : uint8_t {
+  EASE_LINEAR,
+  EASE_IN_OUT,   // Smooth start and stop (cubic)
+  EASE_OUT_BACK  // Slight overshoot, for surprised glances
+};
+
+struct EyeAnimStats {
+  uint16_t targetFps;
+  float fps;                // Achieved frame rate while animating (last 1 s window)
+  uint32_t framesRendered;  // Since eyeAnimBegin()
+  uint32_t framesDropped;   // Frame slots skipped because the bus was busy or a frame overran
+  uint32_t renderUsAvg;     // Compose time per frame (last 1 s window)
+  uint32_t renderUsMax;
+  uint32_t flushUsAvg;      // Time spent pushing the frame to the panel (last 1 s window)
+  uint32_t flushUsMax;
+};
+
+typedef uint32_t (*EyeAnimClockUs)();
+
+// framebuffer: EYE_FRAME_BYTES in SSD1306 page layout (e.g. display.getBuffer()).
+// clockUs: microsecond clock used to time the render step.
+void eyeAnimBegin(uint8_t* framebuffer, uint16_t fps, EyeAnimClockUs clockUs);
+
+// Switches to an expression (a MochiState with frames in eye_frames.h), cross-fading
+// from whatever the framebuffer currently shows. With force set, the fade also runs
+// when the expression is unchanged, e.g. after another screen drew over the eyes.
+void eyeAnimSetExpression(uint8_t state, uint32_t nowMs, bool force = false);
+
+// Replaces the pupil keyframes with a single move to (dx, dy) from the current position.
+void eyeAnimLookAt(int8_t dx, int8_t dy, uint16_t durationMs, EyeEase ease, uint32_t nowMs);
+// Appends a keyframe that starts after the queued ones (and holdMs of stillness).
+bool eyeAnimQueueLook(int8_t dx, int8_t dy, uint16_t durationMs, EyeEase ease, uint16_t holdMs);
+
+void eyeAnimBlink(uint32_t nowMs);
+void eyeAnimSetAutoBlink(bool enabled);  // Random blinks every few seconds (on by default)
+
+// True while a tween, blink or fade is in progress and frames are being produced.
+bool eyeAnimIsAnimating();
+
+// Renders the next frame if one is due. Returns true when the framebuffer holds a new
+// frame that the caller must flush and then report with eyeAnimFlushDone(). When busBusy
+// is set the frame slot is dropped instead of competing with other bus traffic.
+bool eyeAnimTick(uint32_t nowMs, bool busBusy);
+void eyeAnimFlushDone(uint32_t flushUs);
+
+// millis() time at which eyeAnimTick() next has work: the next frame slot while animating,
+// otherwise the next auto-blink. Lets the loop sleep until then.
+uint32_t eyeAnimNextDeadline(uint32_t nowMs);
+
+const EyeAnimStats& eyeAnimGetStats();
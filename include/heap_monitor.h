@@ -0,0 +1,32 @@
+// Heap telemetry: free memory alone hides fragmentation, so this also tracks the
+// largest allocatable block, the low-water mark and the number of live allocations,
+// and keeps a short per-interval history of them so a slow trend is visible in /metrics.
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t HEAP_TREND_SAMPLES = 12;        // One hour at the default interval
+const uint32_t HEAP_TREND_INTERVAL_MS = 300000;
+
+struct HeapSample {
+  uint32_t freeBytes;
+  uint32_t largestBlock;
+  uint32_t allocatedBlocks;
+};
+
+struct HeapStats {
+  uint32_t totalBytes;
+  uint32_t freeBytes;
+  uint32_t minFreeBytes;      // Lowest free heap since boot
+  uint32_t largestBlock;      // Biggest single allocation that would succeed now
+  uint32_t allocatedBlocks;   // Live allocations
+  uint32_t freeBlocks;        // Free fragments
+  float fragmentation;        // 1 - largestBlock / freeBytes
+  uint8_t trendCount;         // Valid entries in trend[], oldest first
+  HeapSample trend[HEAP_TREND_SAMPLES];
+};
+
+// Refreshes the stats and records a trend sample every HEAP_TREND_INTERVAL_MS. Call from loop().
+void heapMonitorPoll(uint32_t nowMs);
+// Current numbers (sampled on the call) plus a copy of the trend; safe from any task.
+HeapStats heapMonitorGetStats();
@@ -0,0 +1,109 @@
+// Allocation-free response writing for the web handlers.
+//
+// Handlers format their body into one of HTTP_POOL_SLOTS fixed buffers instead of
+// building Strings: an HttpBuffer is a Print, so ArduinoJson serializes straight
+// into it and printf() covers the rest. httpSend() streams the body out of the slot
+// and the slot goes back to the pool when the response is done or the client drops.
+//
+// HTML pages stay in flash. tools/gen_web_pages.py cuts the %NAME% placeholders out of
+// the pages in web/ at build time and records where they were (include/web_pages.h), so
+// httpSendPage() only walks that table: it streams the static slices straight from
+// flash as a chunked response and has the handler's callback print each value into the
+// slot's scratch space in between.
+//
+// Bodies of any length (bulk exports) go through httpSendStream(): a producer callback
+// prints the next few lines into the slot whenever the socket wants more, so memory use
+// stays at one slot however much is sent.
+//
+// The web server library still allocates its own request/response objects; what this
+// removes is the per-request page copies and String concatenation in the handlers.
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+const uint8_t HTTP_POOL_SLOTS = 4;      // Concurrent responses; AsyncTCP serves a handful of sockets
+const size_t HTTP_SLOT_SIZE = 4096;     // Largest dynamic body: /history, 60 points in at most ~3.8 KB
+
+class HttpBuffer : public Print {
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+
+  const char* data() const { return buf; }
+  size_t length() const { return len; }
+  bool overflowed() const { return overflow; }
+  void clear() {
+    len = 0;
+    overflow = false;
+  }
+
+private:
+  char buf[HTTP_SLOT_SIZE];
+  size_t len = 0;
+  bool overflow = false;
+};
+
+const uint8_t HTTP_PAGE_END = 0xFF;    // Placeholder id of the last segment
+
+// A slice of static page text followed by a placeholder (a WebPlaceholder id)
+struct HttpSegment {
+  uint16_t textLen;
+  uint8_t placeholder;
+};
+
+struct HttpPage {
+  const char* text;                // Static text of all the slices, back to back
+  const HttpSegment* segments;
+  uint8_t segmentCount;
+};
+
+// Prints the value of one placeholder.
+typedef void (*HttpPlaceholderFn)(uint8_t placeholder, Print& out);
+
+// Where a page render has got to; zero-initialize to start from the top.
+struct HttpPageCursor {
+  uint8_t segment;
+  uint16_t sliceOffset;   // Bytes of the current slice already sent
+  size_t textPos;         // Offset of the next static byte in HttpPage::text
+  size_t scratchPos;      // Bytes of the current value already sent
+};
+
+struct HttpPoolStats {
+  uint8_t slots;
+  uint8_t inUse;
+  uint8_t inUseMax;
+  uint32_t responses;
+  uint32_t exhausted;   // Requests answered 503 because every slot was busy
+  uint32_t overflows;   // Bodies that didn't fit in a slot (answered 500)
+  uint32_t largestBody;
+};
+
+// Takes a free slot for the response body. When every slot is busy it answers the
+// request with 503 itself and returns nullptr.
+HttpBuffer* httpBegin(AsyncWebServerRequest* request);
+// Sends the slot's contents and returns the slot to the pool once they are out.
+void httpSend(AsyncWebServerRequest* request, int code, const char* contentType, HttpBuffer* body);
+// Streams a generated page, filling in its placeholders through fn.
+void httpSendPage(AsyncWebServerRequest* request, const char* contentType, const HttpPage& page, HttpPlaceholderFn fn);
+// Renders the next up to maxLen bytes of a page into out, formatting values into
+// scratch (empty it before the first call). Returns 0 once the page is done.
+size_t httpRenderPage(const HttpPage& page, HttpPlaceholderFn fn, HttpPageCursor& cursor, HttpBuffer& scratch,
+                      uint8_t* out, size_t maxLen);
+// Sends a constant string without copying it.
+void httpSendStatic(AsyncWebServerRequest* request, int code, const char* contentType, const char* text);
+
+const uint8_t HTTP_STREAM_STATE_WORDS = 8;
+
+// Prints the next piece of a streamed body (a few lines, well under HTTP_SLOT_SIZE)
+// into out, keeping its position in state. Returns false once there is nothing left.
+typedef bool (*HttpStreamFn)(Print& out, uint32_t* state);
+
+// Streams a body of unknown length as a chunked response. state is copied into the slot
+// and handed to fn on every call.
+void httpSendStream(AsyncWebServerRequest* request, const char* contentType, HttpStreamFn fn,
+                    const uint32_t (&state)[HTTP_STREAM_STATE_WORDS]);
+
+// A consistent copy of the pool counters; safe from any task.
+HttpPoolStats httpGetStats();
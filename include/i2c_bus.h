@@ -0,0 +1,61 @@
+// Shared I2C bus manager.
+//
+// Owns the Wire bus that the OLED and the sensors share. Every driver call that
+// touches the bus is wrapped in i2cBusAcquire() / i2cBusRelease(); callers from
+// different tasks queue up by priority, and the bus is switched to the clock of
+// the device that gets it. A stuck SDA line (a slave holding it low after a reset
+// mid-transfer) is cleared with the standard 9-clock recovery, stepped from
+// i2cBusPoll() so no task ever blocks on it.
+#pragma once
+
+#include <stdint.h>
+#include <Wire.h>
+
+enum I2cPriority : uint8_t {
+  I2C_PRIO_LOW,    // Bulk transfers that can be skipped (display frames)
+  I2C_PRIO_NORMAL,
+  I2C_PRIO_HIGH    // Short, time-sensitive reads (sensors)
+};
+
+struct I2cDeviceStats {
+  const char* name;
+  uint8_t address;
+  uint32_t clockHz;
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t busyMs;          // Total time this device held the bus
+};
+
+struct I2cBusStats {
+  float utilization;        // Fraction of the last 1 s window the bus was held (0..1)
+  uint32_t transactions;
+  uint32_t errors;          // Transactions the caller reported as failed
+  uint32_t timeouts;        // Acquires that gave up waiting
+  uint32_t rejected;        // Acquires refused because the bus was stuck or recovering
+  uint32_t clockSwitches;
+  uint32_t stuckEvents;     // SDA found held low while the bus was idle
+  uint32_t recoveries;      // Successful 9-clock recoveries
+  uint32_t recoveryFailures;
+  uint32_t waitUsMax;       // Longest wait for the bus (last 1 s window)
+  uint8_t queueDepthMax;    // Most transactions waiting at once (last 1 s window)
+};
+
+void i2cBusBegin(TwoWire& wire, int sdaPin, int sclPin);
+// Registers a device and the SCL frequency to use while talking to it. Returns its id, or -1 if full.
+int8_t i2cBusAddDevice(const char* name, uint8_t address, uint32_t clockHz);
+
+// Waits up to timeoutMs for the bus. On success the caller owns it and must call
+// i2cBusRelease(); report ok = false if the transaction failed so a stuck bus is noticed.
+bool i2cBusAcquire(int8_t device, I2cPriority prio, uint32_t timeoutMs);
+void i2cBusRelease(bool ok = true);
+
+// True while the bus is held, has transactions waiting or is being recovered.
+bool i2cBusBusy();
+bool i2cBusRecovering();
+
+// Steps the bus recovery and rolls the stats window. Call often from loop().
+void i2cBusPoll();
+
+const I2cBusStats& i2cBusGetStats();
+uint8_t i2cBusDeviceCount();
+const I2cDeviceStats& i2cBusGetDeviceStats(uint8_t device);
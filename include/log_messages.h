@@ -0,0 +1,65 @@
+// The log message catalog: LOG_MESSAGE(name, level, format), one line per message.
+//
+// An entry in the log ring stores the message's index here and its arguments, not the
+// text; the format is applied when the entry is printed (log_ring.h). Include this only
+// with LOG_MESSAGE defined. Formats take up to LOG_MAX_ARGS of %d %u %x %c %f %s, with
+// the usual flags, width and precision.
+
+// Boot
+LOG_MESSAGE(BOOT, LOG_LEVEL_INFO, "--- Smart-Nav-Mitra Firmware Starting ---")
+LOG_MESSAGE(RESET_REASON, LOG_LEVEL_INFO, "Reset reason: %s, previous trace: %s")
+LOG_MESSAGE(READY, LOG_LEVEL_INFO, "Smart-Nav-Mitra is ready!")
+LOG_MESSAGE(OLED_FAILED, LOG_LEVEL_ERROR, "SSD1306 allocation failed")
+LOG_MESSAGE(AHT_MISSING, LOG_LEVEL_ERROR, "Could not find AHT20 sensor, check wiring!")
+LOG_MESSAGE(BMP_MISSING, LOG_LEVEL_WARN, "BMP280 sensor not found. Pressure readings will be disabled.")
+LOG_MESSAGE(BMP_READY, LOG_LEVEL_INFO, "BMP280 sensor initialization complete.")
+LOG_MESSAGE(LIGHT_FOUND, LOG_LEVEL_INFO, "BH1750 light sensor found.")
+LOG_MESSAGE(LIGHT_MISSING, LOG_LEVEL_WARN, "BH1750 light sensor not found. Light readings will be disabled.")
+LOG_MESSAGE(MIC_STARTED, LOG_LEVEL_INFO, "INMP441 capture started.")
+LOG_MESSAGE(MIC_FAILED, LOG_LEVEL_WARN, "I2S driver setup failed. Sound levels will be disabled.")
+LOG_MESSAGE(POWER_MODE, LOG_LEVEL_INFO, "Power manager: %s light sleep")
+LOG_MESSAGE(NTP_SYNCED, LOG_LEVEL_INFO, "Time synchronized after %u s")
+LOG_MESSAGE(NTP_FAILED, LOG_LEVEL_WARN, "Failed to synchronize time. Proceeding without it.")
+
+// Network
+LOG_MESSAGE(WIFI_CONNECTING, LOG_LEVEL_INFO, "Connecting to Wi-Fi: %s")
+LOG_MESSAGE(WIFI_CONNECTED, LOG_LEVEL_INFO, "Wi-Fi connected after %u ms, IP Address: %s")
+LOG_MESSAGE(WIFI_FAILED, LOG_LEVEL_WARN, "Wi-Fi connection failed or timed out.")
+LOG_MESSAGE(MDNS_STARTED, LOG_LEVEL_INFO, "mDNS responder started at: http://%s.local")
+LOG_MESSAGE(MDNS_FAILED, LOG_LEVEL_WARN, "Error starting mDNS")
+LOG_MESSAGE(PORTAL_STARTING, LOG_LEVEL_INFO, "Starting Captive Portal...")
+LOG_MESSAGE(PORTAL_AP, LOG_LEVEL_INFO, "AP Name: %s, AP IP: %s")
+LOG_MESSAGE(PORTAL_READY, LOG_LEVEL_INFO, "HTTP and DNS Server started.")
+LOG_MESSAGE(PORTAL_DNS_FAILED, LOG_LEVEL_ERROR, "Captive DNS could not listen on port 53")
+
+// Configuration and updates
+LOG_MESSAGE(CONFIG_SAVED, LOG_LEVEL_INFO, "Configuration saved. Rebooting...")
+LOG_MESSAGE(SETTINGS_SAVED, LOG_LEVEL_INFO, "Settings saved. Rebooting...")
+LOG_MESSAGE(UPDATE_START, LOG_LEVEL_INFO, "Update Start: %s")
+LOG_MESSAGE(UPDATE_DONE, LOG_LEVEL_INFO, "Update Success")
+LOG_MESSAGE(UPDATE_FAILED, LOG_LEVEL_ERROR, "Update failed: %s")
+LOG_MESSAGE(OTA_READY, LOG_LEVEL_INFO, "OTA Initialized.")
+LOG_MESSAGE(OTA_START, LOG_LEVEL_INFO, "OTA update started")
+LOG_MESSAGE(OTA_PROGRESS, LOG_LEVEL_DEBUG, "OTA progress: %u%%")
+LOG_MESSAGE(OTA_END, LOG_LEVEL_INFO, "OTA update finished")
+LOG_MESSAGE(OTA_ERROR, LOG_LEVEL_ERROR, "OTA Error[%u]")
+
+// Sensors
+LOG_MESSAGE(SENSOR_READING, LOG_LEVEL_DEBUG, "T: %.2f C, H: %.2f %%, P: %.2f hPa")
+LOG_MESSAGE(AHT_READ_FAILED, LOG_LEVEL_WARN, "Failed to read from AHT20")
+LOG_MESSAGE(SENSOR_BUS_BUSY, LOG_LEVEL_WARN, "I2C bus unavailable, keeping last %s reading")
+LOG_MESSAGE(I2C_STUCK, LOG_LEVEL_WARN, "I2C: SDA stuck low, starting bus recovery")
+LOG_MESSAGE(I2C_RECOVERED, LOG_LEVEL_INFO, "I2C: bus recovered")
+LOG_MESSAGE(I2C_RECOVERY_FAILED, LOG_LEVEL_ERROR, "I2C: recovery failed, SDA still held low")
+LOG_MESSAGE(TEMP_HIGH, LOG_LEVEL_WARN, "High Temperature Alert!")
+LOG_MESSAGE(TEMP_LOW, LOG_LEVEL_WARN, "Low Temperature Alert!")
+
+// User
+LOG_MESSAGE(ALARM_RINGING, LOG_LEVEL_INFO, "ALARM! WAKE UP!")
+LOG_MESSAGE(ALARM_STOPPED, LOG_LEVEL_INFO, "Alarm stopped for the day.")
+LOG_MESSAGE(ALARM_SNOOZED, LOG_LEVEL_INFO, "Alarm snoozed for 7 minutes.")
+LOG_MESSAGE(FIND_ME, LOG_LEVEL_INFO, "'Find My Mochi' activated!")
+
+// The log itself
+LOG_MESSAGE(LOG_LOST, LOG_LEVEL_WARN, "%u log entries were overwritten before they were printed")
+LOG_MESSAGE(LOG_BENCH, LOG_LEVEL_DEBUG, "Bench %u: T: %.2f C, H: %.2f %%, %s")
@@ -0,0 +1,147 @@
+// Structured logging into a RAM ring instead of synchronous Serial.printf().
+//
+// At 115200 baud a 60-character line takes over 5 ms to leave the UART, and once its
+// FIFO is full Serial.printf() waits for it; sensor reads, alarms and OTA progress used
+// to stall on that. Now a log call only stores an entry: a sequence number, millis(),
+// the message's index in the catalog (log_messages.h) and its arguments in binary,
+// LOG_ARG_BYTES at most (strings are copied, and cut short so the arguments after them
+// still fit). That is a copy of a
+// few dozen bytes under a spinlock, with nothing to format and nothing to wait for: a
+// full ring overwrites its oldest entry.
+//
+// A task at idle priority formats the entries and writes them to Serial, so the UART
+// gets the CPU only when nothing else wants it. /logs serves the same entries as NDJSON
+// from any sequence number; entries overwritten before a reader got to them show up as
+// a gap in the numbers, and the drain task prints how many it lost.
+//
+// Log from any task, not from interrupts. logFlush() prints what is pending from the
+// caller, for the last words before a restart.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+class Print;
+class String;
+
+enum LogLevel : uint8_t {
+  LOG_LEVEL_DEBUG,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_ERROR
+};
+
+enum LogMessage : uint8_t {
+#define LOG_MESSAGE(name, level, format) LOG_MSG_##name,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+  LOG_MESSAGE_COUNT
+};
+
+const uint16_t LOG_RING_ENTRIES = 128;      // A power of two; 7 KB
+const uint8_t LOG_ARG_BYTES = 40;
+const uint8_t LOG_MAX_ARGS = 4;
+const size_t LOG_LINE_MAX = 192;            // Formatted message, with its terminator
+const UBaseType_t LOG_TASK_PRIORITY = 0;    // Idle priority: below loop() (1) and everything else
+const uint32_t LOG_TASK_STACK = 3072;
+
+enum LogArgType : uint8_t {
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_FLOAT,
+  LOG_ARG_STRING
+};
+
+struct LogArgs {
+  uint8_t count;                // Arguments encoded so far
+  uint8_t total;                // Arguments the call passes
+  uint8_t types;                // 2 bits per argument, LogArgType
+  uint8_t len;                  // Bytes of data used
+  uint8_t data[LOG_ARG_BYTES];  // 4 bytes per number; strings NUL-terminated
+};
+
+struct LogEntry {
+  uint32_t seq;                 // From 1
+  uint32_t ms;                  // millis()
+  LogMessage message;
+  LogArgs args;
+};
+
+struct LogStats {
+  uint32_t written;             // Entries since logRingBegin(), the sequence number of the latest
+  uint32_t printed;             // By the drain task or logFlush()
+  uint32_t lost;                // Overwritten before they were printed
+};
+
+// Internal state, public only so a test run can use its own instance
+struct LogRing {
+  LogEntry entries[LOG_RING_ENTRIES];
+  uint32_t written;
+  portMUX_TYPE lock;
+  TaskHandle_t drainTask;       // Woken on every entry, if set
+};
+
+// The firmware's log, drained to Serial once logBegin() has run
+extern LogRing systemLog;
+
+void logRingBegin(LogRing& r);
+// The hot path: copies the entry in and wakes the drain task. Never blocks.
+void logAppend(LogRing& r, LogMessage message, const LogArgs& args);
+// Copies entry seq; false if it isn't written yet or was overwritten.
+bool logRead(LogRing& r, uint32_t seq, LogEntry& out);
+// Sequence number of the oldest entry still in the ring (written + 1 when it is empty)
+uint32_t logOldest(LogRing& r);
+
+// The entry's message with its arguments filled in; returns its length.
+size_t logFormat(const LogEntry& e, char* out, size_t size);
+LogLevel logLevelOf(LogMessage message);
+const char* logLevelName(LogLevel level);    // "debug", "info", ...
+// "warn" and so on to a level; false if it is none
+bool logParseLevel(const char* name, LogLevel& level);
+
+// /logs: NDJSON lines of the system log's entries after seq `after`, at minLevel or
+// above, up to the latest when the stream began. An HttpStreamFn and the state it
+// keeps (3 words).
+void logStreamBegin(uint32_t* state, uint32_t after, LogLevel minLevel);
+bool logStreamNext(Print& out, uint32_t* state);
+
+// Starts the drain task that prints the system log to out. Entries logged before are
+// printed too.
+bool logBegin(Print& out);
+// Prints whatever the drain task hasn't yet, from the calling task. Blocks until done.
+void logFlush();
+LogStats logStats();
+
+// --- Argument encoding ---
+void logArg(LogArgs& a, int32_t v, LogArgType type);
+void logArg(LogArgs& a, float v);
+void logArg(LogArgs& a, const char* s);
+void logArg(LogArgs& a, const String& s);
+inline void logArg(LogArgs& a, int v) { logArg(a, (int32_t)v, LOG_ARG_INT); }
+inline void logArg(LogArgs& a, long v) { logArg(a, (int32_t)v, LOG_ARG_INT); }
+inline void logArg(LogArgs& a, long long v) { logArg(a, (int32_t)v, LOG_ARG_INT); }
+inline void logArg(LogArgs& a, unsigned int v) { logArg(a, (int32_t)v, LOG_ARG_UINT); }
+inline void logArg(LogArgs& a, unsigned long v) { logArg(a, (int32_t)v, LOG_ARG_UINT); }
+inline void logArg(LogArgs& a, unsigned long long v) { logArg(a, (int32_t)v, LOG_ARG_UINT); }
+inline void logArg(LogArgs& a, double v) { logArg(a, (float)v); }
+
+// logWriteTo(ring, LOG_MSG_SENSOR_READING, tempC, humidity, pressure): the arguments are
+// encoded by type, whatever the format says; numbers are stored as 32 bits.
+template <typename... Args>
+inline void logWriteTo(LogRing& r, LogMessage message, const Args&... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  LogArgs a;
+  a.count = a.types = a.len = 0;
+  a.total = sizeof...(Args);
+  int expand[] = {0, (logArg(a, args), 0)...};
+  (void)expand;
+  logAppend(r, message, a);
+}
+
+template <typename... Args>
+inline void logWrite(LogMessage message, const Args&... args) {
+  logWriteTo(systemLog, message, args...);
+}
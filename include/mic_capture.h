@@ -0,0 +1,43 @@
+// INMP441 capture: I2S DMA into a lock-free ring that a processing task drains.
+//
+// The I2S driver fills MIC_DMA_BUFFERS buffers of MIC_DMA_FRAMES samples by DMA. A
+// capture task, at a priority above the web server and loop(), blocks on the driver for
+// each buffer, turns the 32-bit I2S slots into 24-bit samples and appends them to the
+// ring. It does nothing else, so it is never late for the next buffer however busy the
+// rest of the firmware is. The consumer reads from the ring at its own pace; the ring
+// holds MIC_RING_SAMPLES, enough to ride out the web server or a display flush keeping
+// it off the CPU for a good while.
+//
+// Nothing is lost silently: the driver reports DMA buffers it had to overwrite before
+// the capture task read them (I2S_EVENT_RX_Q_OVF), and samples that find the ring full
+// are dropped and counted. micStats() has both.
+//
+// The ring is single-producer, single-consumer and takes no lock: the capture task
+// only moves the head and the consumer only the tail. Each index is stored with release
+// ordering after the samples it covers are written (or read), and loaded with acquire.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+const uint8_t MIC_DMA_BUFFERS = 6;
+const uint16_t MIC_DMA_FRAMES = 256;       // 16 ms per buffer at 16 kHz
+const uint32_t MIC_RING_SAMPLES = 8192;    // 512 ms at 16 kHz; a power of two
+const UBaseType_t MIC_TASK_PRIORITY = 5;   // Above AsyncTCP (3) and loop() (1)
+
+struct MicStats {
+  uint32_t samples;       // Captured into the ring since micBegin()
+  uint32_t dmaOverruns;   // DMA buffers overwritten before the capture task got to them
+  uint32_t ringDropped;   // Samples that found the ring full
+  uint32_t maxFill;       // Highest ring fill seen, samples
+};
+
+// Installs the I2S driver (INMP441 with L/R tied low: left slot, 24 bits in 32) and
+// starts the capture task. False if the driver can't be set up.
+bool micBegin(uint32_t sampleRate, int sckPin, int wsPin, int sdPin);
+// Copies up to max captured samples (24-bit values, sign-extended), waiting up to
+// ticks for the first one. For one consumer task only.
+size_t micRead(int32_t* out, size_t max, TickType_t ticks);
+// Safe from any task.
+MicStats micStats();
@@ -0,0 +1,45 @@
+// Power manager: lets the chip idle between the loop's deadlines.
+//
+// loop() works out when it next has something to do (sensor sample, alarm check,
+// animation frame, gesture timing, ...) and passes that deadline to powerIdleUntil()
+// instead of spinning on delay(10). Until then the loop task blocks, so the CPU
+// clock-gates in the idle task, and Wi-Fi stays associated through DTIM modem sleep.
+//
+// Light sleep comes from the IDF's automatic light sleep, in builds with tickless idle
+// (CONFIG_PM_ENABLE + CONFIG_FREERTOS_USE_TICKLESS_IDLE): while every task is blocked
+// the chip sleeps until the next timer, touch or DTIM beacon, and keeps the connection.
+// It may only do so through waits the loop allows it in, and while the radio can sleep
+// (a station in modem sleep, or the radio off; the access point keeps it awake). Other
+// waits hold a no-light-sleep lock, and only the allowed ones are counted as sleep.
+// Other builds stay in modem sleep. Explicit esp_light_sleep_start() is not used: it
+// stops the Wi-Fi MAC too, and loop() never runs with the radio off.
+#pragma once
+
+#include <stdint.h>
+
+struct PowerStats {
+  uint32_t activeMs;     // CPU running loop() code, since boot
+  uint32_t idleMs;       // Loop blocked waiting for its next deadline, since boot
+  uint32_t sleepMs;      // Light sleep, since boot
+  float dutyCycle;       // Fraction of the last minute the CPU was running
+  float sleepFraction;   // Fraction of the last minute spent in light sleep
+  float avgCurrentMa;    // Estimated average supply current over the last minute
+  float usedMah;         // Estimated charge drawn since boot
+  bool autoLightSleep;   // IDF automatic light sleep is active
+};
+
+// Call from setup() (the loop task): hooks the touch pin and configures power management.
+void powerBegin(uint8_t touchPin);
+// Switch Wi-Fi to DTIM modem sleep; call once the station is connected.
+void powerEnableModemSleep();
+// The OLED draws a noticeable share of the current; tell the estimator when it is lit.
+void powerSetDisplayOn(bool on);
+
+// Blocks until deadlineMs (millis() time), a touch, or POWER_MAX_IDLE_MS, whichever
+// comes first. With allowLightSleep, and a radio that can sleep, the automatic light
+// sleep may take the wait; otherwise it is kept out of light sleep.
+void powerIdleUntil(uint32_t deadlineMs, bool allowLightSleep);
+// Ends the current wait early; for other tasks (web handlers) that hand the loop new work.
+void powerWake();
+
+const PowerStats& powerGetStats();
@@ -0,0 +1,89 @@
+// Barometric tendency and a short-term (Zambretti) weather forecast.
+//
+// The tendency is the least-squares slope of the BMP280 pressure over the last 3 hours,
+// given as the change per 3 h the way weather reports do ("falling slowly, -1.2 hPa").
+// Readings are folded into 5 min bins as they arrive, each bin keeping the count, the
+// means and the co-moments of time and pressure (a bivariate Welford update, O(1) per
+// reading). When a bin closes the fit is redone from the bins in the window by merging
+// their moments, which gives exactly the fit over every reading: irregular intervals,
+// gaps and the adaptive sampler's bursts are weighted correctly, and no running sum has
+// to be subtracted from as bins expire.
+//
+// The forecast is the Negretti & Zambra rule: sea-level pressure and its tendency pick
+// one of 26 outlooks, 'A' (settled fine) to 'Z' (stormy, much rain). The station's
+// altitude is needed to reduce the reading to sea level.
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+const uint16_t PT_BIN_SEC = 5 * 60;
+const uint8_t PT_BINS = 36;             // 3 h
+const uint8_t PT_SLOTS = PT_BINS + 1;   // The window plus the open bin
+const uint8_t PT_MIN_BINS = 24;         // Bins with readings needed before the fit is trusted (2 h)
+
+// WMO-style pressure characteristic of the 3 h change
+enum PressureTendency : uint8_t {
+  PT_UNKNOWN,
+  PT_STEADY,                // Under 0.1 hPa
+  PT_RISING_SLOWLY,         // 0.1 to 1.6 hPa
+  PT_RISING,                // 1.6 to 3.6 hPa
+  PT_RISING_QUICKLY,        // 3.6 to 6 hPa
+  PT_RISING_VERY_RAPIDLY,   // Over 6 hPa
+  PT_FALLING_SLOWLY,
+  PT_FALLING,
+  PT_FALLING_QUICKLY,
+  PT_FALLING_VERY_RAPIDLY
+};
+
+// What the forecast glyph shows
+enum ForecastOutlook : uint8_t {
+  OUTLOOK_FINE,
+  OUTLOOK_FAIR,
+  OUTLOOK_CHANGEABLE,
+  OUTLOOK_RAIN,
+  OUTLOOK_STORM
+};
+
+struct PressureForecast {
+  bool valid;                 // False until PT_MIN_BINS bins of readings; the rest is then unset
+  float changePer3h;          // hPa, from the fitted slope
+  float seaLevelHpa;          // Fitted pressure at the end of the window, reduced to sea level
+  PressureTendency tendency;
+  char letter;                // Zambretti outlook 'A'..'Z'
+};
+
+// Internal state, public only so a test run can use its own instance
+struct PressureBin {
+  uint16_t count;
+  float meanT;   // Seconds from the start of the bin
+  float meanP;   // hPa relative to PressureTrend::refHpa, which keeps float resolution
+  float m2T;
+  float cTP;     // Co-moment of time and pressure
+};
+
+struct PressureTrend {
+  PressureBin bins[PT_SLOTS];
+  uint32_t ids[PT_SLOTS];   // Bin number held in each slot
+  uint32_t newest;
+  float refHpa;
+  float altitudeM;
+  bool started;
+  PressureForecast forecast;
+  portMUX_TYPE lock;
+};
+
+void pressureTrendBegin(PressureTrend& s, float altitudeM);
+// One station pressure reading at nowS (monotonic seconds, as for envStatsAdd()); NaN is
+// skipped. Call from one task only.
+void pressureTrendAdd(PressureTrend& s, uint32_t nowS, float pressureHpa);
+// The forecast as of the last closed bin. Safe from any task.
+PressureForecast pressureTrendForecast(PressureTrend& s);
+
+const char* pressureTendencyName(PressureTendency t);   // e.g. "falling_slowly"
+// Zambretti letter for a sea-level pressure and its change over 3 h
+char zambrettiLetter(float seaLevelHpa, float changePer3h);
+const char* zambrettiText(char letter);                 // e.g. "Fairly fine, improving"
+ForecastOutlook zambrettiOutlook(char letter);
+// Standard-atmosphere reduction of a station pressure to sea level
+float seaLevelPressure(float stationHpa, float altitudeM);
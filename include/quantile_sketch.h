@@ -0,0 +1,55 @@
+// Mergeable streaming quantile sketch (a merging t-digest).
+//
+// A sketch summarises any number of readings as at most QSKETCH_CENTROIDS weighted
+// centroids, sorted by mean. Centroids are kept small near the tails and larger in the
+// middle (the k1 arcsine scale), so p1/p99 stay accurate while the whole sketch fits in
+// a few hundred bytes. Readings are added in batches: the batch is sorted, merged with
+// the centroids and compressed again. Two sketches merge the same way, which is what
+// lets hourly sketches be folded into daily ones.
+//
+// Every compression pass costs some accuracy, and a sketch of a week has been through
+// many. With 96 centroids, and the sketches of a window merged in one pass
+// (QuantileGather), p1 to p99 stay within 1.2% in rank of the exact values in every
+// window of env_quantiles.h (sim --quantile-test); 32 centroids merged one sketch at a
+// time were off by up to 4%. Weights are whole readings and stored as 16 bits.
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t QSKETCH_CENTROIDS = 96;
+
+struct QuantileSketch {
+  float mean[QSKETCH_CENTROIDS];
+  uint16_t weight[QSKETCH_CENTROIDS];   // Readings in each centroid
+  float min;
+  float max;
+  float total;      // Readings summarised
+  uint8_t count;    // Centroids in use
+};
+
+// Sketches gathered to be merged in a single pass. Merged one at a time, the growing
+// result is compressed again after each and the errors add up; a query over a week
+// merges ten sketches. Up to QSKETCH_GATHER_MAX centroids (ten full sketches); more
+// than that costs one extra pass.
+const uint16_t QSKETCH_GATHER_MAX = 10 * QSKETCH_CENTROIDS;
+
+struct QuantileGather {
+  float mean[QSKETCH_GATHER_MAX];
+  uint16_t weight[QSKETCH_GATHER_MAX];
+  float min;
+  float max;
+  float total;
+  uint16_t count;
+};
+
+void qsketchClear(QuantileSketch& s);
+// Adds n readings (the array is sorted in place).
+void qsketchAdd(QuantileSketch& s, float* values, uint8_t n);
+void qsketchMerge(QuantileSketch& into, const QuantileSketch& from);
+// Estimated value at quantile q (0..1); NaN for an empty sketch.
+float qsketchQuantile(const QuantileSketch& s, float q);
+
+void qgatherClear(QuantileGather& g);
+void qgatherAdd(QuantileGather& g, const QuantileSketch& s);
+// Everything gathered as one sketch.
+void qgatherSketch(const QuantileGather& g, QuantileSketch& out);
@@ -0,0 +1,22 @@
+// Bulk export of the sample store as CSV or NDJSON (/export).
+//
+// Lines are formatted from the fixed-point records with integer arithmetic, a batch
+// at a time, straight into the response slot (see httpSendStream()). An export of any
+// length needs no memory beyond that slot.
+#pragma once
+
+#include <Arduino.h>
+#include "http_response.h"
+
+enum ExportFormat : uint8_t {
+  EXPORT_CSV,
+  EXPORT_NDJSON
+};
+
+const uint8_t EXPORT_BATCH = 16;   // Records formatted per producer call
+
+// Sets up state for the samples with fromS <= epoch_s <= toS (0 = no limit).
+void exportBegin(uint32_t (&state)[HTTP_STREAM_STATE_WORDS], ExportFormat format, uint32_t fromS, uint32_t toS);
+// HttpStreamFn: prints the header line on the first call, then the next batch of records.
+bool exportNext(Print& out, uint32_t* state);
+const char* exportContentType(ExportFormat format);
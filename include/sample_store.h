@@ -0,0 +1,70 @@
+// Long-term sample history for bulk export (/export).
+//
+// Every sensor reading is kept as a 24-byte fixed-point record in a RAM ring of
+// SAMPLE_STORE_CAPACITY entries, about a day at the adaptive sampler's typical rate.
+// Records are addressed by a running index, so a reader streaming the ring while new
+// samples arrive can tell when the ones it hasn't sent yet have been overwritten.
+//
+// Clients that poll (the dashboard, /history?after= collectors) know a sample by its
+// sequence number, the running index plus one, so that 0 means "nothing yet". Sequence
+// numbers start over at every boot; the session, a random number drawn at boot, tells
+// a client that it is talking to a new run and must start over too.
+#pragma once
+
+#include <stdint.h>
+
+const uint16_t SAMPLE_STORE_CAPACITY = 2048;
+
+// Status flags stored with each sample
+const uint16_t SAMPLE_TEMP_OK = 0x01;      // AHT20 read succeeded (temperature and humidity are valid)
+const uint16_t SAMPLE_PRESSURE_OK = 0x02;  // BMP280 present and read succeeded
+const uint16_t SAMPLE_TIME_SYNCED = 0x04;  // The clock had been set by NTP when the sample was taken
+const uint16_t SAMPLE_ALERT_HIGH = 0x08;   // Temperature above the high alert threshold
+const uint16_t SAMPLE_ALERT_LOW = 0x10;    // Temperature below the low alert threshold
+const uint16_t SAMPLE_FAST = 0x20;         // Taken at the adaptive sampler's minimum interval
+const uint16_t SAMPLE_TEMP_SUSPECT = 0x40;      // Temperature/humidity read but failed the anomaly checks
+const uint16_t SAMPLE_PRESSURE_SUSPECT = 0x80;  // Pressure read but failed the anomaly checks
+const uint16_t SAMPLE_LIGHT_OK = 0x100;    // BH1750 present and has a reading (lux is valid)
+const uint16_t SAMPLE_SOUND_OK = 0x200;    // Microphone running; the sound levels cover the time since the previous sample
+
+struct StoredSample {
+  uint32_t uptimeMs;
+  uint32_t epochS;          // 0 if the clock was not set yet
+  int16_t tempCenti;        // 0.01 degC
+  uint16_t humidityCenti;   // 0.01 %RH
+  uint16_t pressureDeci;    // 0.1 hPa
+  uint16_t flags;
+  uint32_t luxCenti;        // 0.01 lx
+  uint16_t laeqDeci;        // 0.1 dB SPL, A-weighted Leq since the previous sample
+  uint16_t lamaxDeci;       // 0.1 dB SPL, its loudest 125 ms
+};
+
+// Where a client that last saw sequence number `after` of `session` picks up: the
+// running indexes [from, end) to send next
+struct SampleResume {
+  uint32_t from;
+  uint32_t end;
+  uint32_t dropped;   // Samples after `after` that were overwritten before it asked
+  bool reset;         // Another session, or `after` is ahead of the store: the device restarted,
+                      // and this resumes from its oldest sample as if after were 0
+  bool more;          // Samples beyond end; ask again with the last one's sequence number
+};
+
+// Empties the store and starts a new session. Called once at boot.
+void sampleStoreBegin(uint32_t session);
+uint32_t sampleStoreSession();
+
+// Stores one reading. Values of channels whose flag is not set are stored as 0.
+void sampleStoreAdd(uint32_t uptimeMs, uint32_t epochS, float tempC, float humidity, float pressureHpa, float lux,
+                    float laeq, float lamax, uint16_t flags);
+
+// Running index of the oldest stored sample, and one past the newest.
+uint32_t sampleStoreFirst();
+uint32_t sampleStoreEnd();
+// Copies the sample with running index i. False if it was overwritten or isn't there yet.
+bool sampleStoreGet(uint32_t i, StoredSample& out);
+
+inline uint32_t sampleSeq(uint32_t index) { return index + 1; }
+// At most maxCount samples after sequence number `after`. session 0 means the client
+// doesn't know one; a restart then shows only when `after` is ahead of the store.
+SampleResume sampleStoreResume(uint32_t session, uint32_t after, uint32_t maxCount);
@@ -0,0 +1,38 @@
+// Latest sensor reading, shared between loop() and the web handlers.
+//
+// loop() is the only writer: it publishes a complete SensorSnapshot after every
+// reading (and when the device state changes). Handlers on the AsyncTCP task take a
+// copy with sensorSnapshotRead() and never see half of one update and half of the next.
+//
+// Publication is a seqlock over two copies: the writer bumps the sequence before
+// touching each copy, and readers copy whichever one is not being written, retrying
+// only if the sequence moved during their copy. On the single-core C3 a reader that
+// preempts the writer therefore never spins; on a dual-core part it retries at most
+// until the writer finishes one copy. Neither side takes a lock.
+#pragma once
+
+#include <stdint.h>
+#include "pressure_trend.h"
+#include "anomaly_detector.h"
+
+struct SensorSnapshot {
+  uint32_t version;     // Publications so far; 0 = nothing published yet
+  uint32_t sampledAt;   // millis() of the reading
+  int64_t epochMs;      // Wall-clock time of the reading, 0 before NTP sync
+  float tempC;
+  float humidity;
+  float pressureHpa;    // < 0 when the BMP280 is missing
+  uint8_t state;        // MochiState
+  bool tempOk;          // tempC/humidity come from an AHT20 read that passed the anomaly checks
+  bool pressureOk;
+  SensorCondition conditions[ANOMALY_CHANNELS];   // Of each channel's latest reading
+  PressureForecast forecast;   // Pressure tendency and forecast as of this reading
+  float lux;            // Latest BH1750 reading; NaN without one
+};
+
+// Publishes s (its version field is filled in). Only one task may call this.
+void sensorSnapshotPublish(const SensorSnapshot& s);
+// A consistent copy of the latest publication. Safe from any task.
+SensorSnapshot sensorSnapshotRead();
+// Publications that readers had to retry because the writer got in the way.
+uint32_t sensorSnapshotRetries();
@@ -0,0 +1,98 @@
+// Fixed-point sound level meter for the INMP441 microphone.
+//
+// Samples (24-bit, as the microphone sends them) go through a DC blocker and an
+// A-weighting filter, then their squares are summed in 125 ms blocks. Each block gives
+// the A-weighted level (close to a meter's "fast" reading), each 8 blocks the Leq over
+// that second, and the last 60 seconds the Leq over a minute and its loudest block. The
+// unweighted peak comes straight from the DC-blocked samples.
+//
+// Everything per sample is integer arithmetic: samples are scaled to 30 bits, the
+// filters are Direct Form I biquads with Q30 coefficients and 64-bit accumulators, and
+// the energies are 64-bit sums. Only the per-block conversion to dB uses floats.
+//
+// The A-weighting is the IEC 61672 curve mapped to z by the matched-z transform (poles
+// at exp(-2 pi f / fs)), plus one zero at z = -SOUND_AWEIGHT_ZERO that cancels the
+// rise matched-z gives towards Nyquist. At 16 kHz it stays within 0.12 dB of the curve
+// from 10 Hz to 6.3 kHz (the IEC class 1 tolerance is 0.7 dB at 1 kHz, wider away from
+// it) and within 0.6 dB up to 7.5 kHz.
+//
+// Levels are dB SPL from the INMP441's nominal sensitivity: a 1 kHz tone at 94 dB SPL
+// reads -26 dBFS. calibrationDb corrects for an individual microphone.
+//
+// The kernels are public so the simulator's --sound-bench can time them one by one.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+const uint32_t SOUND_SAMPLE_RATE = 16000;
+const uint16_t SOUND_BLOCK_SAMPLES = 2000;   // 125 ms
+const uint8_t SOUND_BLOCKS_PER_SEC = 8;
+const uint8_t SOUND_MINUTE_SEC = 60;
+const uint16_t SOUND_CHUNK = 256;            // Samples filtered at a time
+const uint8_t SOUND_AWEIGHT_STAGES = 3;
+const double SOUND_AWEIGHT_ZERO = 0.111;
+
+struct SoundLevels {
+  bool valid;        // False until the first full second; the levels are 0 until then
+  uint32_t seconds;  // Seconds measured so far
+  float la;          // A-weighted level of the latest 125 ms block, dB SPL
+  float laeq1s;      // A-weighted Leq over the last full second
+  float laeq1min;    // ...over the last minute (the seconds so far, during the first one)
+  float lamax1min;   // Loudest 125 ms block of the last minute
+  float lzpeak1s;    // Unweighted peak of the last second (a 94 dB tone reads 97 dB)
+};
+
+// Internal state, public only so a test run can use its own instance
+struct SoundDcBlocker {
+  int32_t x1, y1;
+};
+
+struct SoundBiquad {
+  int32_t b0, b1, b2, a1, a2;   // Q30; a1, a2 as in y = b.x - a1 y1 - a2 y2
+  int32_t x1, x2, y1, y2;
+};
+
+struct SoundMeter {
+  bool started;
+  SoundDcBlocker dc;
+  SoundBiquad aweight[SOUND_AWEIGHT_STAGES];
+  int32_t work[SOUND_CHUNK];
+  float levelOffset;     // dB SPL of a mean square of 1, for the block and second means
+  float peakOffset;      // dB SPL of a peak of 1
+  uint64_t blockSum;     // Sum of squares in the open block
+  uint16_t blockFill;
+  uint32_t blockPeak;
+  uint64_t secSum;       // Sum of the block means in the open second
+  uint64_t secMax;       // Loudest block mean in it
+  uint32_t secPeak;
+  uint8_t secBlocks;
+  uint64_t minuteMean[SOUND_MINUTE_SEC];   // Mean square of each of the last 60 seconds
+  uint64_t minuteMax[SOUND_MINUTE_SEC];    // Loudest block mean of each
+  double intervalSum;    // Since the last soundMeterTakeInterval(), which may be a while
+  uint64_t intervalMax;
+  uint32_t intervalBlocks;
+  SoundLevels levels;
+  portMUX_TYPE lock;
+};
+
+void soundMeterBegin(SoundMeter& m, float calibrationDb = 0);
+// Measures n more samples (24-bit values, sign-extended). Call from one task only.
+void soundMeterProcess(SoundMeter& m, const int32_t* samples, size_t n);
+// The latest levels. Safe from any task.
+SoundLevels soundMeterLevels(SoundMeter& m);
+// A-weighted Leq and loudest block since the previous call, for one periodic reader.
+// False if no block has completed since.
+bool soundMeterTakeInterval(SoundMeter& m, float& laeq, float& lamax);
+
+// --- Kernels ---
+// 24-bit samples in, DC removed (first-order high-pass at about 2.5 Hz) and scaled to 30 bits out
+void soundDcBlock(SoundDcBlocker& s, const int32_t* in, int32_t* out, size_t n);
+// A cascade of biquads, in place
+void soundBiquads(SoundBiquad* stages, uint8_t count, int32_t* buf, size_t n);
+// A-weighting coefficients for sampleRate, unity gain at 1 kHz; clears the filter state
+void soundAWeightDesign(SoundBiquad (&stages)[SOUND_AWEIGHT_STAGES], uint32_t sampleRate);
+// Sum of squares of the 30-bit samples, each taken >> 5 so a block can't overflow 64 bits
+uint64_t soundSumSquares(const int32_t* buf, size_t n);
+uint32_t soundPeak(const int32_t* buf, size_t n);
@@ -0,0 +1,53 @@
+// Touch capture for training the gesture classifier: binary records over serial.
+//
+// DATA_COLLECTION_MODE 1 streams the touch pin to tools/touch_recorder.py, which cuts it
+// into labelled gestures for tools/train_touch_gestures.py. Two kinds of record:
+//  - edges: the pin's interrupt stamps every change with micros(), so press and gap
+//    lengths are exact to the microsecond whatever the sampling rate;
+//  - samples: an esp_timer samples the pin at TOUCH_CAPTURE_HZ and packs
+//    TOUCH_CAPTURE_BLOCK samples to a record with the time of the first, so the host
+//    can see bounce and glitches too short or too fast for the interrupt.
+// Both go into lock-free single-producer, single-consumer rings (the interrupt and the
+// esp_timer task produce, loop() drains) and out as frames:
+//
+//   0xA5 0x5A | type | length | payload (length bytes) | CRC-16/CCITT-FALSE
+//
+// The CRC covers type, length and payload. Every field is little-endian. A record that
+// finds its ring full is dropped and counted, and an info frame once a second carries
+// the counters, so the host knows what it missed. About 1.1 KB/s at 2 kHz, well within
+// 115200 baud.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Print;
+
+const uint16_t TOUCH_CAPTURE_HZ = 2000;
+const uint8_t TOUCH_CAPTURE_BLOCK = 32;        // Samples per record, one bit each
+const uint16_t TOUCH_CAPTURE_EDGES = 128;      // Ring sizes; powers of two
+const uint8_t TOUCH_CAPTURE_BLOCKS = 16;       // 256 ms at 2 kHz
+const uint8_t TOUCH_CAPTURE_VERSION = 1;
+
+const uint8_t TOUCH_FRAME_SYNC0 = 0xA5;
+const uint8_t TOUCH_FRAME_SYNC1 = 0x5A;
+enum TouchFrameType : uint8_t {
+  TOUCH_FRAME_INFO = 0x01,      // t_us u32, sample_hz u16, pin u8, version u8, edges u32, blocks u32, dropped u32
+  TOUCH_FRAME_SAMPLES = 0x02,   // t0_us u32, period_us u16, count u8, bits u32 (bit i: sample i, 1 = touched)
+  TOUCH_FRAME_EDGE = 0x03,      // t_us u32, level u8
+};
+
+struct TouchCaptureStats {
+  uint32_t edges;               // Captured since touchCaptureBegin()
+  uint32_t blocks;
+  uint32_t dropped;             // Records that found their ring full
+};
+
+// Attaches the pin's interrupt and starts the sampling timer. False if the timer can't
+// be set up.
+bool touchCaptureBegin(uint8_t pin);
+// Writes the records captured so far as frames, and an info frame once a second.
+// Returns the bytes written. For one task only.
+size_t touchCaptureWrite(Print& out);
+TouchCaptureStats touchCaptureStats();
+uint16_t touchCaptureCrc(const uint8_t* data, size_t n);
@@ -0,0 +1,81 @@
+// Touch gestures from the TTP223: a segmenter, and fixed thresholds or a small decision
+// tree trained on host.
+//
+// The segmenter follows the touch pin and cuts the presses into gestures. A gesture is
+// complete at its second release, or once the pin has stayed released for
+// TOUCH_SEGMENT_GAP_MS after the first. A press held on past TOUCH_MAX_PRESS_MS still
+// ends at its release, with its length saturated. Each gesture becomes TOUCH_FEATURES
+// numbers: the press count, the first press's length, the gap after it and the second
+// press's length, in ms (0 where there is none).
+//
+// By default those are classified with the fixed thresholds of the old
+// detectTouchGesture(): presses under TOUCH_TAP_MAX_MS are taps, two taps with the second
+// released within TOUCH_DOUBLE_TAP_MS of the first are a double tap, and a press of
+// TOUCH_LONG_PRESS_MS or more is a long press. A late second tap no longer leaves the
+// tap count stuck: each gesture starts afresh. The decision tree in
+// include/touch_gesture_model.h takes over once tools/train_touch_gestures.py has trained
+// it on gestures recorded with tools/touch_recorder.py (DATA_COLLECTION_MODE in main.cpp),
+// which fits it to the way you tap; the shipped tree is trained on synthetic timings only.
+// Classifying takes a few comparisons either way; touchGestureStats() has the cycles it took.
+#pragma once
+
+#include <stdint.h>
+
+const uint16_t TOUCH_SEGMENT_GAP_MS = 350;   // Released this long: the gesture is over
+const uint16_t TOUCH_MAX_PRESS_MS = 60000;
+const uint8_t TOUCH_FEATURES = 4;
+const uint16_t TOUCH_TAP_MAX_MS = 250;      // Fixed thresholds: shorter presses are taps
+const uint16_t TOUCH_DOUBLE_TAP_MS = 400;   // Second tap released within this of the first
+const uint16_t TOUCH_LONG_PRESS_MS = 1500;
+
+// Same order as the classes in tools/train_touch_gestures.py
+enum TouchGesture : uint8_t {
+  TOUCH_GESTURE_NONE,         // Presses that aren't a gesture, e.g. a brush or a half-hearted hold
+  TOUCH_GESTURE_SINGLE_TAP,
+  TOUCH_GESTURE_DOUBLE_TAP,
+  TOUCH_GESTURE_LONG_PRESS,
+  TOUCH_GESTURE_COUNT
+};
+
+enum TouchFeature : uint8_t {
+  TOUCH_FEATURE_PRESSES,
+  TOUCH_FEATURE_FIRST_MS,
+  TOUCH_FEATURE_GAP_MS,
+  TOUCH_FEATURE_SECOND_MS,
+};
+
+// One node of the decision tree: an inner node sends features[feature] <= threshold to
+// left, and the rest to right; a leaf (feature TOUCH_TREE_LEAF) answers gesture left.
+struct TouchTreeNode {
+  uint8_t feature;
+  uint16_t threshold;
+  uint8_t left, right;
+};
+const uint8_t TOUCH_TREE_LEAF = 0xFF;
+
+struct TouchGestureStats {
+  uint32_t gestures[TOUCH_GESTURE_COUNT];
+  uint32_t lastCycles;         // CPU cycles of the latest classification
+  uint32_t maxCycles;
+};
+
+// Internal state, public only so a test run can use its own instance
+struct TouchGestureState {
+  bool pressed;
+  uint8_t presses;             // In the open gesture
+  uint32_t pressStart;         // millis()
+  uint32_t lastRelease;
+  uint16_t features[TOUCH_FEATURES];
+  TouchGestureStats stats;
+};
+
+void touchGestureBegin(TouchGestureState& s);
+// Feeds the pin level at nowMs; returns the gesture that completed, if any. Call every
+// 10 ms or so while touchGestureBusy(), and on every pin change.
+bool touchGestureUpdate(TouchGestureState& s, bool touched, uint32_t nowMs, TouchGesture& gesture);
+// A press is held or a gesture is still open
+bool touchGestureBusy(const TouchGestureState& s);
+TouchGesture touchGestureClassify(const uint16_t features[TOUCH_FEATURES]);
+const char* touchGestureName(TouchGesture g);   // "single_tap", ... ("" for none)
+uint8_t touchGestureModelDepth();   // 0 while the fixed thresholds classify
+const TouchGestureStats& touchGestureStats(const TouchGestureState& s);
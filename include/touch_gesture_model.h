@@ -0,0 +1,24 @@
+// AUTO-GENERATED by tools/train_touch_gestures.py -- do not edit by hand.
+// Decision tree for touchGestureClassify() (touch_gesture.h), preorder, root first.
+// Trained on 2000 synthetic (seed 1) gestures, depth limit 4, at least 20 per leaf.
+// 5-fold cross-validated accuracy 97.9 % (the fixed thresholds: 85.2 %).
+// Synthetic gestures only: these scores say how well it fits the generator, not real taps.
+#pragma once
+
+#include "touch_gesture.h"
+
+// Trained on recorded gestures; until then touchGestureClassify() keeps the fixed thresholds
+const bool TOUCH_TREE_RECORDED = false;
+const uint8_t TOUCH_TREE_DEPTH = 3;
+const uint8_t TOUCH_TREE_NODES = 9;
+const TouchTreeNode TOUCH_TREE[TOUCH_TREE_NODES] = {
+  { TOUCH_FEATURE_FIRST_MS, 1249, 1, 8 },  // 0: first_ms <= 1249
+  { TOUCH_FEATURE_PRESSES, 1, 2, 5 },  // 1: presses <= 1
+  { TOUCH_FEATURE_FIRST_MS, 303, 3, 4 },  // 2: first_ms <= 303
+  { TOUCH_TREE_LEAF, 0, TOUCH_GESTURE_SINGLE_TAP, 0 },  // 3: single_tap (training 4/494/0/0)
+  { TOUCH_TREE_LEAF, 0, TOUCH_GESTURE_NONE, 0 },  // 4: none (training 281/6/0/11)
+  { TOUCH_FEATURE_SECOND_MS, 237, 6, 7 },  // 5: second_ms <= 237
+  { TOUCH_TREE_LEAF, 0, TOUCH_GESTURE_DOUBLE_TAP, 0 },  // 6: double_tap (training 0/0/499/0)
+  { TOUCH_TREE_LEAF, 0, TOUCH_GESTURE_NONE, 0 },  // 7: none (training 199/0/1/0)
+  { TOUCH_TREE_LEAF, 0, TOUCH_GESTURE_LONG_PRESS, 0 },  // 8: long_press (training 16/0/0/489)
+};
@@ -0,0 +1,139 @@
+// Speech front end for the INMP441: voice-activity detection and MFCC features.
+//
+// The same 16 kHz samples the sound level meter gets are cut into 25 ms frames every
+// 10 ms, the usual framing for keyword spotting. Each frame gives:
+//  - a voice-activity decision from its energy and zero-crossing count against a
+//    tracked noise floor: loud frames, or moderately loud ones that cross zero as often
+//    as fricatives ("s", "f") do, count as speech. VOICE_VAD_ONSET_FRAMES of them in a
+//    row start speech, and it lasts until VOICE_VAD_HANGOVER_FRAMES have passed without
+//    one, so the gaps between words don't split an utterance;
+//  - VOICE_MFCC mel-frequency cepstral coefficients: pre-emphasis, a Hamming window, a
+//    512-point real FFT, VOICE_MEL_BANDS triangular mel filters, the natural log of each
+//    band's energy and an orthonormal DCT-II. Frames go into a ring of the last second,
+//    the input window a keyword-spotting model needs.
+//
+// All per-sample and per-frame work is integer arithmetic. The FFT is a 256-point complex
+// radix-2 FFT over the frame's even and odd samples, split into the 257 bins of the real
+// transform. Each frame is scaled to use the full width before the FFT (block floating
+// point) and the FFT halves its data every stage, so it never overflows and a quiet frame
+// keeps the precision of a loud one. Twiddles are Q30, window and DCT are Q15, logs come
+// from a bit-by-bit log2 with 16 fractional bits. The coefficients are Q7 (a value of
+// 1.0 is 128); an energy of 0 reads as VOICE_LOG_FLOOR.
+//
+// The memory is all in VoiceFrontend, about 12 KB: tables, the frame and FFT buffers
+// and the feature ring. Nothing is allocated.
+//
+// The simulator's --voice-bench times the kernels in ns and cycles per frame and checks
+// the features against a double-precision reference.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "sound_level.h"
+
+const uint16_t VOICE_FRAME_SAMPLES = 400;   // 25 ms at 16 kHz
+const uint16_t VOICE_HOP_SAMPLES = 160;     // 10 ms
+const uint16_t VOICE_FFT_SIZE = 512;
+const uint16_t VOICE_FFT_HALF = VOICE_FFT_SIZE / 2;
+const uint16_t VOICE_BINS = VOICE_FFT_HALF + 1;
+const uint8_t VOICE_FFT_STAGES = 8;         // log2(VOICE_FFT_HALF)
+const uint8_t VOICE_MEL_BANDS = 40;
+const uint8_t VOICE_MFCC = 13;
+const float VOICE_MEL_LOW_HZ = 20;
+const float VOICE_MEL_HIGH_HZ = 8000;
+const float VOICE_PREEMPHASIS = 0.97;
+const float VOICE_LOG_FLOOR = -20;          // ln of the band energy when there is none
+const uint8_t VOICE_MFCC_FRAC_BITS = 7;
+const uint8_t VOICE_POWER_SHIFT = 20;       // Bin powers are taken >> this before the mel sums
+const uint8_t VOICE_FEATURE_FRAMES = 100;   // 1 s
+
+const float VOICE_VAD_MARGIN_DB = 9;        // Above the noise floor: speech
+const float VOICE_VAD_ZCR_MARGIN_DB = 4;    // ...or this much, crossing zero at least
+const uint8_t VOICE_VAD_ZCR_MIN = 50;       // ...this often in a 160-sample hop
+const float VOICE_VAD_MIN_DBFS = -80;       // Quieter frames are never speech (about 40 dB SPL)
+const float VOICE_VAD_FLOOR_RISE_DB = 1;    // Per second; the floor falls to a quieter frame at once
+const uint8_t VOICE_VAD_ONSET_FRAMES = 3;
+const uint8_t VOICE_VAD_HANGOVER_FRAMES = 30;
+
+struct VoiceFeatureFrame {
+  int16_t mfcc[VOICE_MFCC];   // Q7
+  bool speech;                // The VAD's decision for this frame
+};
+
+struct VoiceStats {
+  uint32_t frames;            // Frames analysed since voiceFrontendBegin()
+  uint32_t speechFrames;
+  uint32_t utterances;        // Starts of speech
+  bool speech;                // Speech now
+  float energyDbfs;           // Latest hop, 0 dBFS is a full-scale sine
+  float noiseFloorDbfs;
+};
+
+// Internal state, public only so a test run can use its own instance
+struct VoiceFrontend {
+  // Tables, built by voiceFrontendBegin()
+  int16_t window[VOICE_FRAME_SAMPLES];          // Hamming, Q15
+  int32_t twiddleCos[VOICE_BINS];               // cos(2 pi k / 512), Q30
+  int32_t twiddleSin[VOICE_BINS];
+  uint8_t bitReverse[VOICE_FFT_HALF];
+  uint8_t binPoint[VOICE_BINS];                 // Mel point at or below the bin; 0xFF outside the bands
+  int16_t binWeight[VOICE_BINS];                // Rising edge weight of the band starting there, Q15
+  int16_t dct[VOICE_MFCC][VOICE_MEL_BANDS];     // Q15
+  int16_t preemphasis;                          // Q15
+  int32_t energyOffset;                         // log2 of a hop's sum of squares to dBFS, Q16
+  int32_t floorRise;                            // Noise floor rise per frame, dB Q16
+
+  // Signal
+  bool started;
+  SoundDcBlocker dc;
+  int32_t dcOut[VOICE_HOP_SAMPLES];
+  int32_t lastSample;                           // Previous DC-blocked sample, for pre-emphasis
+  int32_t frame[VOICE_FRAME_SAMPLES];           // Pre-emphasized, 2^27 = full scale; a ring
+  uint16_t framePos;                            // Where the next sample goes (the oldest, once full)
+  uint16_t filled;                              // Samples in frame, up to VOICE_FRAME_SAMPLES
+  uint16_t hopFill;                             // New samples since the last frame
+  uint64_t hopEnergy;
+  uint16_t hopCrossings;
+  int32_t fft[VOICE_FFT_SIZE];                  // 256 complex values, re and im interleaved
+  uint64_t mel[VOICE_MEL_BANDS];
+  int32_t logMel[VOICE_MEL_BANDS];              // Natural log, Q16
+
+  // VAD
+  int32_t floorDb;                              // dBFS, Q16
+  int32_t energyDb;
+  uint8_t run;                                  // Speech-like frames in a row
+  uint8_t hang;                                 // Frames left before speech ends
+  bool speech;
+
+  // Output
+  VoiceFeatureFrame ring[VOICE_FEATURE_FRAMES];
+  VoiceStats stats;
+  portMUX_TYPE lock;
+};
+
+void voiceFrontendBegin(VoiceFrontend& v);
+// Analyses n more samples (24-bit values, sign-extended, at 16 kHz), producing a frame
+// every VOICE_HOP_SAMPLES. Call from one task only. Returns the frames produced.
+uint16_t voiceFrontendProcess(VoiceFrontend& v, const int32_t* samples, size_t n);
+// Copies the latest frames (up to max, at most VOICE_FEATURE_FRAMES), oldest first.
+// Returns the number copied; newest gets the running number of the last one (frames so
+// far), so a reader can tell which frames it has already seen. Safe from any task.
+uint16_t voiceFrontendFeatures(VoiceFrontend& v, VoiceFeatureFrame* out, uint16_t max, uint32_t& newest);
+// Safe from any task.
+VoiceStats voiceFrontendStats(VoiceFrontend& v);
+
+// --- Kernels ---
+// log2(x) in Q16; x > 0
+int32_t voiceLog2(uint64_t x);
+// Pre-emphasized frame to windowed FFT input, scaled to the full width; the scale
+// exponent (log2 of the factor applied), or INT8_MIN for a silent frame
+int8_t voiceWindow(VoiceFrontend& v);
+// In place on v.fft, halving every stage
+void voiceFft(VoiceFrontend& v);
+// v.fft to the power of the 257 real-transform bins, then into the mel bands
+void voiceMelEnergies(VoiceFrontend& v);
+// v.mel to v.logMel and the DCT; scale is voiceWindow()'s exponent
+void voiceCepstrum(VoiceFrontend& v, int8_t scale, int16_t* mfcc);
+// Energy and zero crossings of a hop to the VAD decision
+bool voiceVadUpdate(VoiceFrontend& v, uint64_t sumSquares, uint16_t crossings);
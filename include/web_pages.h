@@ -0,0 +1,1059 @@
+// AUTO-GENERATED by tools/gen_web_pages.py from web/ -- do not edit by hand.
+// Each page is its static text with the %NAME% placeholders cut out, plus a
+// segment table: a slice of the text, then the placeholder that follows it.
+// httpSendPage() streams the slices straight from flash and asks the handler
+// for each value in between.
+#pragma once
+
+#include <pgmspace.h>
+#include "http_response.h"
+
+enum WebPlaceholder : uint8_t {
+  PH_ALARM_CHECKED,
+  PH_ALARM_HR,
+  PH_ALARM_MIN,
+  PH_ALTITUDE,
+  PH_AUTO_BRIGHT_CHECKED,
+  PH_BUZZER_CHECKED,
+  PH_DEVICENAME,
+  PH_FREE_HEAP,
+  PH_GREETING,
+  PH_HUMIDITY,
+  PH_LOCAL_IP,
+  PH_MAC_ADDRESS,
+  PH_NETWORKS,
+  PH_OLED_TO,
+  PH_PRESSURE,
+  PH_QUIET_END,
+  PH_QUIET_START,
+  PH_RSSI,
+  PH_SENSOR_ADAPT_CHECKED,
+  PH_SENSOR_INTERVAL,
+  PH_SENSOR_INTERVAL_MS,
+  PH_SENSOR_MAX,
+  PH_SENSOR_MIN,
+  PH_STATE,
+  PH_TEMP_HIGH,
+  PH_TEMP_LOW,
+  PH_TZ_OFFSET,
+  PH_WIFI_SSID,
+  PH_COUNT
+};
+
+// Placeholder names as they appear in web/, indexed by WebPlaceholder
+static const char* const WEB_PLACEHOLDER_NAMES[PH_COUNT] = {
+  "ALARM_CHECKED",
+  "ALARM_HR",
+  "ALARM_MIN",
+  "ALTITUDE",
+  "AUTO_BRIGHT_CHECKED",
+  "BUZZER_CHECKED",
+  "DEVICENAME",
+  "FREE_HEAP",
+  "GREETING",
+  "HUMIDITY",
+  "LOCAL_IP",
+  "MAC_ADDRESS",
+  "NETWORKS",
+  "OLED_TO",
+  "PRESSURE",
+  "QUIET_END",
+  "QUIET_START",
+  "RSSI",
+  "SENSOR_ADAPT_CHECKED",
+  "SENSOR_INTERVAL",
+  "SENSOR_INTERVAL_MS",
+  "SENSOR_MAX",
+  "SENSOR_MIN",
+  "STATE",
+  "TEMP_HIGH",
+  "TEMP_LOW",
+  "TZ_OFFSET",
+  "WIFI_SSID",
+};
+
+// web/config.html: 6952 bytes, 2 placeholders
+static const char CONFIG_PAGE_TEXT[] PROGMEM =
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "    <meta charset=\"UTF-8\">\n"
+    "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+    "    <title>Smart-Nav-Mitra Configuration</title>\n"
+    "    <style>\n"
+    "        :root {\n"
+    "            --primary: #FF69B4; /* Hot Pink (Mochi color) */\n"
+    "            --secondary: #6A5ACD; /* Slate Blue */\n"
+    "            --bg: #F0F4F8; /* Light Blue/Gray */\n"
+    "            --card-bg: #FFFFFF;\n"
+    "            --text-color: #333;\n"
+    "        }\n"
+    "        body {\n"
+    "            font-family: Arial, sans-serif;\n"
+    "            margin: 0;\n"
+    "            padding: 20px;\n"
+    "            background-color: var(--bg);\n"
+    "            color: var(--text-color);\n"
+    "            display: flex;\n"
+    "            justify-content: center;\n"
+    "            align-items: center;\n"
+    "            min-height: 100vh;\n"
+    "        }\n"
+    "        .container {\n"
+    "            background: var(--card-bg);\n"
+    "            padding: 30px;\n"
+    "            border-radius: 16px;\n"
+    "            box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1);\n"
+    "            width: 100%;\n"
+    "            max-width: 400px;\n"
+    "        }\n"
+    "        h1 {\n"
+    "            color: var(--primary);\n"
+    "            text-align: center;\n"
+    "            margin-bottom: 20px;\n"
+    "            font-size: 1.8em;\n"
+    "        }\n"
+    "        .mochi-face {\n"
+    "            text-align: center;\n"
+    "            font-size: 3rem;\n"
+    "            margin-bottom: 20px;\n"
+    "            animation: pulse 1.5s infinite;\n"
+    "        }\n"
+    "        @keyframes pulse {\n"
+    "            0% { transform: scale(1); opacity: 0.8; }\n"
+    "            50% { transform: scale(1.1); opacity: 1; }\n"
+    "            100% { transform: scale(1); opacity: 0.8; }\n"
+    "        }\n"
+    "        label {\n"
+    "            display: block;\n"
+    "            margin-bottom: 8px;\n"
+    "            font-weight: bold;\n"
+    "            color: var(--secondary);\n"
+    "        }\n"
+    "        input[type=\"text\"], input[type=\"password\"] {\n"
+    "            width: 100%;\n"
+    "            padding: 12px;\n"
+    "            margin-bottom: 15px;\n"
+    "            border: 2px solid #ddd;\n"
+    "            border-radius: 8px;\n"
+    "            box-sizing: border-box;\n"
+    "            transition: border-color 0.3s;\n"
+    "        }\n"
+    "        input[type=\"text\"]:focus, input[type=\"password\"]:focus {\n"
+    "            border-color: var(--primary);\n"
+    "            outline: none;\n"
+    "        }\n"
+    "        button {\n"
+    "            width: 100%;\n"
+    "            padding: 12px;\n"
+    "            background-color: var(--primary);\n"
+    "            color: white;\n"
+    "            border: none;\n"
+    "            border-radius: 8px;\n"
+    "            font-size: 1.1em;\n"
+    "            cursor: pointer;\n"
+    "            transition: background-color 0.3s, transform 0.1s;\n"
+    "        }\n"
+    "        button:hover {\n"
+    "            background-color: #E05AA0;\n"
+    "        }\n"
+    "        button:active {\n"
+    "            transform: scale(0.99);\n"
+    "        }\n"
+    "        .networks {\n"
+    "            list-style: none;\n"
+    "            margin: 0 0 15px;\n"
+    "            padding: 0;\n"
+    "            border: 2px solid #ddd;\n"
+    "            border-radius: 8px;\n"
+    "            max-height: 220px;\n"
+    "            overflow-y: auto;\n"
+    "        }\n"
+    "        .networks li {\n"
+    "            display: flex;\n"
+    "            justify-content: space-between;\n"
+    "            padding: 10px 12px;\n"
+    "            border-bottom: 1px solid #eee;\n"
+    "            cursor: pointer;\n"
+    "        }\n"
+    "        .networks li:last-child {\n"
+    "            border-bottom: none;\n"
+    "        }\n"
+    "        .networks li:hover, .networks li.selected {\n"
+    "            background-color: #FFF0F7;\n"
+    "        }\n"
+    "        .networks .signal {\n"
+    "            color: #666;\n"
+    "            font-size: 0.9em;\n"
+    "            white-space: nowrap;\n"
+    "            margin-left: 10px;\n"
+    "        }\n"
+    "        .networks .empty {\n"
+    "            color: #666;\n"
+    "            cursor: default;\n"
+    "        }\n"
+    "        p.note {\n"
+    "            margin-top: 20px;\n"
+    "            font-size: 0.9em;\n"
+    "            color: #666;\n"
+    "            text-align: center;\n"
+    "            border-top: 1px dashed #ddd;\n"
+    "            padding-top: 10px;\n"
+    "        }\n"
+    "    </style>\n"
+    "</head>\n"
+    "<body>\n"
+    "    <div class=\"container\">\n"
+    "        <h1>Smart-Nav-Mitra Configuration Portal</h1>\n"
+    "        <div class=\"mochi-face\">\360\237\215\245</div>\n"
+    "        <form action=\"/saveconfig\" method=\"post\">\n"
+    "            <label for=\"devicename\">Device Name (mDNS: [name].local)</label>\n"
+    "            <input type=\"text\" id=\"devicename\" name=\"devicename\" value=\"\" required>\n"
+    "\n"
+    "            <label>Nearby Networks</label>\n"
+    "            <ul class=\"networks\" id=\"networks\"></ul>\n"
+    "\n"
+    "            <label for=\"ssid\">Wi-Fi SSID</label>\n"
+    "            <input type=\"text\" id=\"ssid\" name=\"ssid\" required>\n"
+    "\n"
+    "            <label for=\"password\">Wi-Fi Password</label>\n"
+    "            <input type=\"password\" id=\"password\" name=\"password\">\n"
+    "\n"
+    "            <button type=\"submit\">Connect & Save</button>\n"
+    "        </form>\n"
+    "        <p class=\"note\">Once saved, Smart-Nav-Mitra will reboot and try to connect to your network.</p>\n"
+    "    </div>\n"
+    "    <script>\n"
+    "        // The device's last background scan comes with the page; /networks refreshes it\n"
+    "        const initialScan = ;\n"
+    "\n"
+    "        function signalBars(rssi) {\n"
+    "            const bars = rssi >= -55 ? 4 : rssi >= -67 ? 3 : rssi >= -78 ? 2 : 1;\n"
+    "            return '\342\226\256'.repeat(bars) + '\342\226\257'.repeat(4 - bars);\n"
+    "        }\n"
+    "\n"
+    "        function showNetworks(scan) {\n"
+    "            const list = document.getElementById('networks');\n"
+    "            const ssidInput = document.getElementById('ssid');\n"
+    "            list.innerHTML = '';\n"
+    "            if (!scan.networks.length) {\n"
+    "                const item = document.createElement('li');\n"
+    "                item.className = 'empty';\n"
+    "                item.textContent = scan.age_s < 0 ? 'Scanning\342\200\246' : 'No networks found. Type the name below.';\n"
+    "                list.appendChild(item);\n"
+    "                return;\n"
+    "            }\n"
+    "            scan.networks.forEach(net => {\n"
+    "                const item = document.createElement('li');\n"
+    "                const name = document.createElement('span');\n"
+    "                name.textContent = net.ssid; // Never as HTML: anyone nearby can name a network\n"
+    "                const signal = document.createElement('span');\n"
+    "                signal.className = 'signal';\n"
+    "                signal.textContent = (net.open ? '' : '\360\237\224\222 ') + signalBars(net.rssi);\n"
+    "                item.append(name, signal);\n"
+    "                if (net.ssid === ssidInput.value) item.classList.add('selected');\n"
+    "                item.onclick = () => {\n"
+    "                    ssidInput.value = net.ssid;\n"
+    "                    list.querySelectorAll('li').forEach(li => li.classList.remove('selected'));\n"
+    "                    item.classList.add('selected');\n"
+    "                    document.getElementById('password').focus();\n"
+    "                };\n"
+    "                list.appendChild(item);\n"
+    "            });\n"
+    "        }\n"
+    "\n"
+    "        function refreshNetworks() {\n"
+    "            fetch('/networks')\n"
+    "                .then(response => response.json())\n"
+    "                .then(showNetworks)\n"
+    "                .catch(error => console.error('Error fetching networks:', error));\n"
+    "        }\n"
+    "\n"
+    "        showNetworks(initialScan);\n"
+    "        // Until the first scan is in, ask again soon; then at the device's refresh rate\n"
+    "        if (initialScan.age_s < 0) setTimeout(refreshNetworks, 3000);\n"
+    "        setInterval(refreshNetworks, 30000);\n"
+    "    </script>\n"
+    "</body>\n"
+    "</html>\n";
+static const HttpSegment CONFIG_PAGE_SEGMENTS[] PROGMEM = {
+  { 4058, PH_DEVICENAME },
+  { 666, PH_NETWORKS },
+  { 2206, HTTP_PAGE_END },
+};
+static const HttpPage CONFIG_PAGE = { CONFIG_PAGE_TEXT, CONFIG_PAGE_SEGMENTS, 3 };
+
+// web/index.html: 22427 bytes, 14 placeholders
+static const char MAIN_PAGE_TEXT[] PROGMEM =
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "    <meta charset=\"UTF-8\">\n"
+    "    <script src=\"https://cdn.jsdelivr.net/npm/chart.js\"></script>\n"
+    "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+    "    <title> Interface</title>\n"
+    "    <style>\n"
+    "        :root {\n"
+    "            --primary: #FF69B4; /* Hot Pink */\n"
+    "            --secondary: #6A5ACD; /* Slate Blue */\n"
+    "            --bg: #F0F4F8;\n"
+    "            --card-bg: #FFFFFF;\n"
+    "            --text-color: #333;\n"
+    "            --success: #32CD32; /* Lime Green */\n"
+    "            --danger: #FF4500; /* Orange Red */\n"
+    "            --cold: #00BFFF; /* Deep Sky Blue */\n"
+    "            --warning: #FFA500; /* Orange */\n"
+    "        }\n"
+    "        .top-right-info {\n"
+    "            position: absolute;\n"
+    "            top: 20px;\n"
+    "            right: 20px;\n"
+    "            text-align: right;\n"
+    "            color: #555;\n"
+    "        }\n"
+    "        body {\n"
+    "            font-family: 'Inter', sans-serif;\n"
+    "            margin: 0;\n"
+    "            padding: 20px;\n"
+    "            background-color: var(--bg);\n"
+    "            color: var(--text-color);\n"
+    "            display: flex;\n"
+    "            flex-direction: column;\n"
+    "            align-items: center;\n"
+    "            min-height: 100vh;\n"
+    "        }\n"
+    "        .header {\n"
+    "            text-align: center;\n"
+    "            margin-bottom: 30px;\n"
+    "        }\n"
+    "        h1 {\n"
+    "            color: var(--primary);\n"
+    "            font-size: 2.5em;\n"
+    "            margin-bottom: 5px;\n"
+    "        }\n"
+    "        h2.device-name {\n"
+    "            font-family: Verdana, sans-serif;\n"
+    "            color: black;\n"
+    "        }\n"
+    "        .mochi-display {\n"
+    "            display: flex;\n"
+    "            flex-direction: column;\n"
+    "            align-items: center;\n"
+    "            margin-bottom: 40px;\n"
+    "            padding: 20px;\n"
+    "            background: var(--card-bg);\n"
+    "            border-radius: 16px;\n"
+    "            box-shadow: 0 8px 20px rgba(0, 0, 0, 0.1);\n"
+    "            width: 100%;\n"
+    "            max-width: 600px;\n"
+    "            transition: background-color 0.5s;\n"
+    "        }\n"
+    "        .mochi-face {\n"
+    "            font-size: 8rem;\n"
+    "            animation: breathe 4s ease-in-out infinite;\n"
+    "        }\n"
+    "        @keyframes breathe {\n"
+    "            0%, 100% { transform: scale(1); }\n"
+    "            50% { transform: scale(1.05); }\n"
+    "        }\n"
+    "        .emotion-text {\n"
+    "            font-size: 1.5em;\n"
+    "            font-weight: bold;\n"
+    "            margin-top: 10px;\n"
+    "        }\n"
+    "        .info-grid {\n"
+    "            display: grid;\n"
+    "            grid-template-columns: repeat(auto-fit, minmax(250px, 1fr));\n"
+    "            gap: 20px;\n"
+    "            width: 100%;\n"
+    "            max-width: 1000px;\n"
+    "        }\n"
+    "        .card {\n"
+    "            background: var(--card-bg);\n"
+    "            padding: 20px;\n"
+    "            border-radius: 12px;\n"
+    "            box-shadow: 0 4px 15px rgba(0, 0, 0, 0.05);\n"
+    "            transition: transform 0.2s;\n"
+    "        }\n"
+    "        .card:hover {\n"
+    "            transform: translateY(-3px);\n"
+    "        }\n"
+    "        .card h2 {\n"
+    "            margin-top: 0;\n"
+    "            font-size: 1.3em;\n"
+    "            color: var(--primary);\n"
+    "            border-bottom: 2px solid var(--bg);\n"
+    "            padding-bottom: 8px;\n"
+    "            margin-bottom: 15px;\n"
+    "        }\n"
+    "        .card p {\n"
+    "            margin: 5px 0;\n"
+    "            line-height: 1.5;\n"
+    "        }\n"
+    "        .status-badge {\n"
+    "            display: inline-block;\n"
+    "            padding: 4px 10px;\n"
+    "            border-radius: 6px;\n"
+    "            font-size: 0.9em;\n"
+    "            font-weight: bold;\n"
+    "            margin-left: 10px;\n"
+    "        }\n"
+    "        .status-badge.online {\n"
+    "            background-color: var(--success);\n"
+    "            color: white;\n"
+    "        }\n"
+    "        .actions {\n"
+    "            display: flex;\n"
+    "            gap: 10px;\n"
+    "            flex-wrap: wrap; /* Allow buttons to wrap on small screens */\n"
+    "            margin-top: 20px;\n"
+    "        }\n"
+    "        .action-btn {\n"
+    "            padding: 8px 16px;\n"
+    "            border: none;\n"
+    "            border-radius: 8px;\n"
+    "            color: white;\n"
+    "            font-weight: bold;\n"
+    "            cursor: pointer;\n"
+    "            transition: opacity 0.2s;\n"
+    "        }\n"
+    "        .action-btn:hover { opacity: 0.85; }\n"
+    "        .btn-settings { background-color: var(--secondary); }\n"
+    "        .btn-reboot { background-color: var(--warning); }\n"
+    "        .btn-find { background-color: #1E90FF; } /* Dodger Blue */\n"
+    "\n"
+    "        @media (max-width: 650px) {\n"
+    "            .info-grid {\n"
+    "                grid-template-columns: 1fr;\n"
+    "            }\n"
+    "        }\n"
+    "    </style>\n"
+    "</head>\n"
+    "<body>\n"
+    "    <div class=\"header\">\n"
+    "        <h1>Hello.. </h1>\n"
+    "        <h2 class=\"device-name\">I'm !</h2>\n"
+    "        <p>Your friendly companion is online and connected.</p>\n"
+    "    </div>\n"
+    "    <div class=\"top-right-info\">\n"
+    "        <p id=\"live-datetime\" style=\"margin:0; font-weight: bold;\"></p>\n"
+    "    </div>\n"
+    "\n"
+    "    <div id=\"mochi-display\" class=\"mochi-display\">\n"
+    "        <div id=\"mochi-face\" class=\"mochi-face\">\360\237\230\212</div>\n"
+    "        <div id=\"emotion-text\" class=\"emotion-text\" style=\"color: var(--secondary);\">Happy and Ready!</div>\n"
+    "    </div>\n"
+    "\n"
+    "    <div class=\"info-grid\">\n"
+    "        <!-- PARAMETER CARD 1: Sensor Data -->\n"
+    "        <div class=\"card parameter-card\">\n"
+    "            <h2>Environment State</h2>\n"
+    "            <p><strong>Temperature:</strong> <span id=\"temp\">--.-</span> \302\260C</p>\n"
+    "            <p><strong>Humidity:</strong> <span id=\"humidity\"></span> %</p>\n"
+    "            <p><strong>Pressure:</strong> <span id=\"pressure\"></span> hPa</p>\n"
+    "            <p><strong>Light:</strong> <span id=\"lux\">--</span> lx</p>\n"
+    "            <p id=\"sound-row\" hidden><strong>Sound:</strong> <span id=\"sound\">--</span> dB(A) &nbsp; <strong>1 min:</strong> <span id=\"sound-min\">--</span> dB(A), max <span id=\"sound-max\">--</span></p>\n"
+    "            <p><strong>Dew Point:</strong> <span id=\"dew-point\">--.-</span> \302\260C &nbsp; <strong>Feels Like:</strong> <span id=\"heat-index\">--.-</span> \302\260C</p>\n"
+    "            <p><strong>Last 24 h:</strong> <span id=\"temp-range\">--</span></p>\n"
+    "            <p><strong>Forecast:</strong> <span id=\"forecast\">needs 2 h of pressure readings</span></p>\n"
+    "        </div>\n"
+    "\n"
+    "        <!-- PARAMETER CARD 2: System Status -->\n"
+    "        <div class=\"card parameter-card\">\n"
+    "            <h2>System Health</h2>\n"
+    "            <p><strong>Current State:</strong> <span id=\"current-state\"></span></p>\n"
+    "            <p><strong>Uptime:</strong> <span id=\"uptime\">Loading...</span></p>\n"
+    "            <p><strong>Free Heap:</strong> <span id=\"heap\"></span></p>\n"
+    "            <p><strong>Sensors:</strong> <span id=\"sensor-health\">--</span></p>\n"
+    "            <div class=\"actions\">\n"
+    "                <button class=\"action-btn btn-settings\" onclick=\"window.location.href='/settings'\">Settings</button>\n"
+    "                <button class=\"action-btn btn-reboot\" onclick=\"rebootDevice()\">Reboot</button>\n"
+    "                <button class=\"action-btn btn-find\" onclick=\"findMochi()\">Find Me!</button>\n"
+    "            </div>\n"
+    "        </div>\n"
+    "\n"
+    "        <!-- INFO CARD 3: Network Information -->\n"
+    "        <div class=\"card info-card\">\n"
+    "            <h2>Network Info <span class=\"status-badge online\">Online</span></h2>\n"
+    "            <p><strong>Local IP:</strong> <span id=\"ip\"></span></p>\n"
+    "            <p><strong>mDNS URL:</strong> http://.local</p>\n"
+    "            <p><strong>Wi-Fi SSID:</strong> </p>\n"
+    "            <p><strong>Signal Strength:</strong> <span id=\"rssi\"></span> dBm</p>\n"
+    "        </div>\n"
+    "\n"
+    "        <!-- INFO CARD 4: Device Details -->\n"
+    "        <div class=\"card info-card\">\n"
+    "            <h2>Device Info</h2>\n"
+    "            <p><strong>Firmware Ver:</strong> 2.0.0</p>\n"
+    "            <p><strong>Chip Model:</strong> ESP32</p>\n"
+    "            <p><strong>MAC Address:</strong> </p>\n"
+    "            <p><strong>Configured Name:</strong> </p>\n"
+    "        </div>\n"
+    "    </div>\n"
+    "    \n"
+    "    <!-- CHART CARD -->\n"
+    "    <div class=\"card\" style=\"width: 100%; max-width: 1000px; margin-top: 20px;\">\n"
+    "        <h2>Live Environment Data</h2>\n"
+    "        <canvas id=\"sensorChart\"></canvas>\n"
+    "        </div>\n"
+    "\n"
+    "    <script>\n"
+    "        let sensorChart;\n"
+    "        let lastSampledAt = null; // Time of the newest reading /data has shown\n"
+    "        let historySession = 0; // Device run the chart's readings come from (see /history)\n"
+    "        let historyLast = 0; // Sequence number of the newest reading the chart has seen\n"
+    "        let historySyncing = false;\n"
+    "\n"
+    "        // Mapping MochiState enum to Strings for display\n"
+    "        const stateMap = {\n"
+    "            0: 'HAPPY',\n"
+    "            1: 'ALERT_HIGH (Too Hot)',\n"
+    "            2: 'ALERT_LOW (Too Cold)',\n"
+    "            3: 'TOUCHED',\n"
+    "            4: 'UPDATING (OTA)',\n"
+    "        };\n"
+    "\n"
+    "        const dayNames = [\"Sunday\", \"Monday\", \"Tuesday\", \"Wednesday\", \"Thursday\", \"Friday\", \"Saturday\"];\n"
+    "        const monthNames = [\"January\", \"February\", \"March\", \"April\", \"May\", \"June\", \"July\", \"August\", \"September\", \"October\", \"November\", \"December\"];\n"
+    "\n"
+    "        function getDayWithOrdinal(d) {\n"
+    "            if (d > 3 && d < 21) return d + 'th';\n"
+    "            switch (d % 10) {\n"
+    "                case 1: return d + \"st\";\n"
+    "                case 2: return d + \"nd\";\n"
+    "                case 3: return d + \"rd\";\n"
+    "                default: return d + \"th\";\n"
+    "            }\n"
+    "        }\n"
+    "\n"
+    "        // Function to update the live clock every second\n"
+    "        function updateLiveClock() {\n"
+    "            const now = new Date();\n"
+    "\n"
+    "            // Time part\n"
+    "            const hours = String(now.getHours()).padStart(2, '0');\n"
+    "            const minutes = String(now.getMinutes()).padStart(2, '0');\n"
+    "            const seconds = String(now.getSeconds()).padStart(2, '0');\n"
+    "            const timeString = `${hours}:${minutes}:${seconds}`;\n"
+    "\n"
+    "            // Date part\n"
+    "            const dayOfWeek = dayNames[now.getDay()];\n"
+    "            const dayOfMonth = getDayWithOrdinal(now.getDate());\n"
+    "            const month = monthNames[now.getMonth()];\n"
+    "            const year = now.getFullYear();\n"
+    "            const dateString = `${dayOfWeek}, ${dayOfMonth} ${month} ${year}`;\n"
+    "\n"
+    "            const liveTimeElement = document.getElementById('live-datetime');\n"
+    "            if (liveTimeElement) liveTimeElement.innerHTML = `${dateString}<br>${timeString}`;\n"
+    "        }\n"
+    "\n"
+    "        // Function to fetch dynamic data and update the cards\n"
+    "        function updateData() {\n"
+    "            fetch('/data')\n"
+    "                .then(response => response.json())\n"
+    "                .then(data => {\n"
+    "                    // Update Sensor Data\n"
+    "                    document.getElementById('temp').innerText = data.tempC.toFixed(1);\n"
+    "                    document.getElementById('humidity').innerText = data.humidity.toFixed(0);\n"
+    "                    document.getElementById('pressure').innerText = data.pressure_hPa.toFixed(0);\n"
+    "                    if (data.dew_point !== undefined) {\n"
+    "                        document.getElementById('dew-point').innerText = data.dew_point.toFixed(1);\n"
+    "                        document.getElementById('heat-index').innerText = data.heat_index.toFixed(1);\n"
+    "                    }\n"
+    "                    if (data.lux !== undefined) {\n"
+    "                        document.getElementById('lux').innerText = data.lux < 10 ? data.lux.toFixed(1) : data.lux.toFixed(0);\n"
+    "                    }\n"
+    "                    if (data.sound) {\n"
+    "                        document.getElementById('sound-row').hidden = false;\n"
+    "                        document.getElementById('sound').innerText = data.sound.laeq_1s.toFixed(1);\n"
+    "                        document.getElementById('sound-min').innerText = data.sound.laeq_1min.toFixed(1);\n"
+    "                        document.getElementById('sound-max').innerText = data.sound.lamax_1min.toFixed(1);\n"
+    "                    }\n"
+    "                    if (data.forecast !== undefined) {\n"
+    "                        const trend = (data.pressure_trend > 0 ? '+' : '') + data.pressure_trend.toFixed(1);\n"
+    "                        document.getElementById('forecast').innerText = data.forecast_text + ' (pressure ' +\n"
+    "                            data.pressure_tendency.replace(/_/g, ' ') + ', ' + trend + ' hPa / 3 h)';\n"
+    "                    }\n"
+    "\n"
+    "                    // Update System Data\n"
+    "                    document.getElementById('current-state').innerText = stateMap[data.state];\n"
+    "                    document.getElementById('uptime').innerText = formatUptime(data.uptime);\n"
+    "                    document.getElementById('heap').innerText = data.heap_percent.toFixed(1) + ' % (fragmented ' + data.heap_frag.toFixed(0) + ' %)';\n"
+    "\n"
+    "                    const health = data.sensor_health || {};\n"
+    "                    const faults = Object.keys(health).filter(k => health[k] !== 'ok')\n"
+    "                        .map(k => k + ' ' + health[k].replace(/_/g, ' '));\n"
+    "                    document.getElementById('sensor-health').innerText = faults.length ? faults.join(', ') : 'OK';\n"
+    "\n"
+    "                    // Update Chart, once per new reading: the device sends the ones stored since\n"
+    "                    // the chart's newest, which has only readings that passed its sanity checks\n"
+    "                    if (data.sampled_at !== lastSampledAt) {\n"
+    "                        lastSampledAt = data.sampled_at;\n"
+    "                        syncHistory();\n"
+    "                    }\n"
+    "\n"
+    "                    // Update Mochi Face and Display Color\n"
+    "                    updateMochiFace(data.state, data.tempC);\n"
+    "                })\n"
+    "                .catch(error => console.error('Error fetching data:', error));\n"
+    "        }\n"
+    "\n"
+    "        function updateMochiFace(state, temp) {\n"
+    "            const faceElement = document.getElementById('mochi-face');\n"
+    "            const emotionElement = document.getElementById('emotion-text');\n"
+    "            const displayElement = document.getElementById('mochi-display');\n"
+    "            let face, emotion, color, bgColor;\n"
+    "\n"
+    "            switch (state) {\n"
+    "                case 1: // ALERT_HIGH\n"
+    "                    face = '\360\237\245\265';\n"
+    "                    emotion = 'It\\'s getting warm!';\n"
+    "                    color = 'var(--danger)';\n"
+    "                    bgColor = '#FFEDED';\n"
+    "                    break;\n"
+    "                case 2: // ALERT_LOW\n"
+    "                    face = '\360\237\245\266';\n"
+    "                    emotion = 'A bit chilly!';\n"
+    "                    color = 'var(--cold)';\n"
+    "                    bgColor = '#EDF6FF';\n"
+    "                    break;\n"
+    "                case 3: // TOUCHED\n"
+    "                    face = '\360\237\230\211';\n"
+    "                    emotion = 'Thanks for the touch!';\n"
+    "                    color = 'var(--primary)';\n"
+    "                    bgColor = 'var(--card-bg)';\n"
+    "                    break;\n"
+    "                case 4: // UPDATING\n"
+    "                    face = '\360\237\224\204';\n"
+    "                    emotion = 'Updating...';\n"
+    "                    color = 'orange';\n"
+    "                    bgColor = 'var(--card-bg)';\n"
+    "                    break;\n"
+    "                case 0: // HAPPY\n"
+    "                default:\n"
+    "                    face = '\360\237\230\212';\n"
+    "                    emotion = 'Happy and Ready!';\n"
+    "                    color = 'var(--secondary)';\n"
+    "                    bgColor = 'var(--card-bg)';\n"
+    "                    break;\n"
+    "            }\n"
+    "\n"
+    "            faceElement.innerText = face;\n"
+    "            emotionElement.innerText = emotion;\n"
+    "            emotionElement.style.color = color;\n"
+    "            displayElement.style.backgroundColor = bgColor;\n"
+    "        }\n"
+    "\n"
+    "        // Helper function to format uptime from seconds\n"
+    "        function formatUptime(ms) {\n"
+    "            let totalSeconds = Math.floor(ms / 1000);\n"
+    "            const hours = Math.floor(totalSeconds / 3600);\n"
+    "            totalSeconds %= 3600;\n"
+    "            const minutes = Math.floor(totalSeconds / 60);\n"
+    "            const seconds = totalSeconds % 60;\n"
+    "            return `${hours}h ${minutes}m ${seconds}s`;\n"
+    "        }\n"
+    "\n"
+    "        function rebootDevice() {\n"
+    "            if (confirm('Are you sure you want to reboot Mochi?')) {\n"
+    "                fetch('/reboot', { method: 'POST' })\n"
+    "                    .then(() => {\n"
+    "                        alert('Reboot command sent. The device will now restart.');\n"
+    "                        // Disable page interaction\n"
+    "                        document.body.style.pointerEvents = 'none';\n"
+    "                        document.body.style.opacity = '0.5';\n"
+    "                    })\n"
+    "                    .catch(error => console.error('Error sending reboot command:', error));\n"
+    "            }\n"
+    "        }\n"
+    "\n"
+    "        function findMochi() {\n"
+    "            fetch('/find', { method: 'POST' })\n"
+    "                .then(response => {\n"
+    "                    if (!response.ok) alert('Failed to send Find Me command.');\n"
+    "                })\n"
+    "                .catch(error => console.error('Error sending find command:', error));\n"
+    "        }\n"
+    "\n"
+    "        function initChart(history) {\n"
+    "            const ctx = document.getElementById('sensorChart').getContext('2d');\n"
+    "            sensorChart = new Chart(ctx, {\n"
+    "                type: 'line',\n"
+    "                data: {\n"
+    "                    labels: history.labels,\n"
+    "                    datasets: [{\n"
+    "                        label: 'Temperature (\302\260C)',\n"
+    "                        data: history.temps,\n"
+    "                        borderColor: 'rgba(255, 99, 132, 1)',\n"
+    "                        backgroundColor: 'rgba(255, 99, 132, 0.2)',\n"
+    "                        yAxisID: 'yTemp',\n"
+    "                    }, {\n"
+    "                        label: 'Humidity (%)',\n"
+    "                        data: history.hums,\n"
+    "                        borderColor: 'rgba(54, 162, 235, 1)',\n"
+    "                        backgroundColor: 'rgba(54, 162, 235, 0.2)',\n"
+    "                        yAxisID: 'yHum',\n"
+    "                    }, {\n"
+    "                        label: 'Light (lx)',\n"
+    "                        data: history.lux,\n"
+    "                        borderColor: 'rgba(255, 193, 7, 1)',\n"
+    "                        backgroundColor: 'rgba(255, 193, 7, 0.2)',\n"
+    "                        yAxisID: 'yLux',\n"
+    "                        hidden: !history.lux.some(v => v !== null), // No BH1750\n"
+    "                    }]\n"
+    "                },\n"
+    "                options: {\n"
+    "                    scales: {\n"
+    "                        yTemp: {\n"
+    "                            type: 'linear',\n"
+    "                            display: true,\n"
+    "                            position: 'left',\n"
+    "                            title: { display: true, text: 'Temperature (\302\260C)' }\n"
+    "                        },\n"
+    "                        yHum: {\n"
+    "                            type: 'linear',\n"
+    "                            display: true,\n"
+    "                            position: 'right',\n"
+    "                            title: { display: true, text: 'Humidity (%)' },\n"
+    "                            grid: { drawOnChartArea: false } // only draw grid for temp axis\n"
+    "                        },\n"
+    "                        yLux: {\n"
+    "                            type: 'logarithmic', // From a dark room to daylight\n"
+    "                            display: 'auto',\n"
+    "                            position: 'right',\n"
+    "                            title: { display: true, text: 'Light (lx)' },\n"
+    "                            grid: { drawOnChartArea: false }\n"
+    "                        }\n"
+    "                    }\n"
+    "                }\n"
+    "            });\n"
+    "        }\n"
+    "\n"
+    "        // The body of a /history answer; an error status (503 while the device is busy) rejects\n"
+    "        function historyJson(response) {\n"
+    "            if (!response.ok) throw new Error('/history answered ' + response.status);\n"
+    "            return response.json();\n"
+    "        }\n"
+    "\n"
+    "        // Replaces the chart's readings with the latest ones\n"
+    "        function loadHistory() {\n"
+    "            return fetch('/history')\n"
+    "                .then(historyJson)\n"
+    "                .then(history => {\n"
+    "                    historySession = history.session;\n"
+    "                    historyLast = history.last;\n"
+    "                    if (!sensorChart) {\n"
+    "                        initChart(history);\n"
+    "                        return;\n"
+    "                    }\n"
+    "                    sensorChart.data.labels = history.labels;\n"
+    "                    sensorChart.data.datasets[0].data = history.temps;\n"
+    "                    sensorChart.data.datasets[1].data = history.hums;\n"
+    "                    sensorChart.data.datasets[2].data = history.lux;\n"
+    "                    sensorChart.update('none');\n"
+    "                });\n"
+    "        }\n"
+    "\n"
+    "        // Appends the readings stored since the chart's newest. A dropped poll or a tab that\n"
+    "        // slept just makes the next delta bigger. After a restart (a new session), or when\n"
+    "        // readings were overwritten or there are more than fit, the chart is reloaded instead,\n"
+    "        // as it is when the first load failed and there is no chart yet.\n"
+    "        function syncHistory() {\n"
+    "            if (historySyncing) return;\n"
+    "            historySyncing = true;\n"
+    "            const sync = !sensorChart ? loadHistory() : fetch('/history?after=' + historyLast + '&session=' + historySession)\n"
+    "                .then(historyJson)\n"
+    "                .then(history => {\n"
+    "                    if (history.reset || history.dropped || history.more) return loadHistory();\n"
+    "                    historyLast = history.last;\n"
+    "                    for (let i = 0; i < history.labels.length; i++) {\n"
+    "                        sensorChart.data.labels.push(history.labels[i]); // Device time of the reading\n"
+    "                        sensorChart.data.datasets[0].data.push(history.temps[i]);\n"
+    "                        sensorChart.data.datasets[1].data.push(history.hums[i]);\n"
+    "                        sensorChart.data.datasets[2].data.push(history.lux[i]);\n"
+    "                    }\n"
+    "\n"
+    "                    // Limit data points\n"
+    "                    while (sensorChart.data.labels.length > 60) {\n"
+    "                        sensorChart.data.labels.shift();\n"
+    "                        sensorChart.data.datasets.forEach(dataset => dataset.data.shift());\n"
+    "                    }\n"
+    "                    sensorChart.update('none'); // 'none' for no animation\n"
+    "                });\n"
+    "            sync.catch(error => console.error('Error fetching history:', error))\n"
+    "                .finally(() => { historySyncing = false; });\n"
+    "        }\n"
+    "\n"
+    "        // Today's temperature range and mean from the device's rolling statistics\n"
+    "        function updateStats() {\n"
+    "            fetch('/stats')\n"
+    "                .then(response => response.json())\n"
+    "                .then(stats => {\n"
+    "                    const t = stats.windows['24h'].temp;\n"
+    "                    if (t.count > 0) {\n"
+    "                        document.getElementById('temp-range').innerText =\n"
+    "                            t.min.toFixed(1) + ' \342\200\223 ' + t.max.toFixed(1) + ' \302\260C (mean ' + t.mean.toFixed(1) + ' \302\260C)';\n"
+    "                    }\n"
+    "                })\n"
+    "                .catch(error => console.error('Error fetching stats:', error));\n"
+    "        }\n"
+    "\n"
+    "        // Fetch historical data on page load to populate chart\n"
+    "        loadHistory().catch(error => console.error('Error fetching history:', error));\n"
+    "\n"
+    "        // Update data every 3 seconds\n"
+    "        setInterval(updateData, );\n"
+    "        updateStats();\n"
+    "        setInterval(updateStats, 60000);\n"
+    "        updateLiveClock(); // Call it once immediately on load\n"
+    "        setInterval(updateLiveClock, 1000);\n"
+    "    </script>\n"
+    "</body>\n"
+    "</html>\n";
+static const HttpSegment MAIN_PAGE_SEGMENTS[] PROGMEM = {
+  { 219, PH_DEVICENAME },
+  { 4073, PH_GREETING },
+  { 42, PH_DEVICENAME },
+  { 728, PH_HUMIDITY },
+  { 76, PH_PRESSURE },
+  { 844, PH_STATE },
+  { 151, PH_FREE_HEAP },
+  { 690, PH_LOCAL_IP },
+  { 61, PH_DEVICENAME },
+  { 55, PH_WIFI_SSID },
+  { 70, PH_RSSI },
+  { 302, PH_MAC_ADDRESS },
+  { 54, PH_DEVICENAME },
+  { 14702, PH_SENSOR_INTERVAL_MS },
+  { 204, HTTP_PAGE_END },
+};
+static const HttpPage MAIN_PAGE = { MAIN_PAGE_TEXT, MAIN_PAGE_SEGMENTS, 15 };
+
+// web/settings.html: 6974 bytes, 16 placeholders
+static const char SETTINGS_PAGE_TEXT[] PROGMEM =
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "    <meta charset=\"UTF-8\">\n"
+    "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+    "    <title>Mochi Settings</title>\n"
+    "    <style>\n"
+    "        :root {\n"
+    "            --primary: #FF69B4;\n"
+    "            --secondary: #6A5ACD;\n"
+    "            --bg: #F0F4F8;\n"
+    "            --card-bg: #FFFFFF;\n"
+    "            --text-color: #333;\n"
+    "        }\n"
+    "        body { font-family: Arial, sans-serif; margin: 0; padding: 20px; background-color: var(--bg); color: var(--text-color); display: flex; justify-content: center; align-items: center; min-height: 100vh; }\n"
+    "        .container { background: var(--card-bg); padding: 30px; border-radius: 16px; box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1); width: 100%; max-width: 400px; }\n"
+    "        h1 { color: var(--primary); text-align: center; margin-bottom: 20px; }\n"
+    "        label { display: block; margin: 15px 0 8px; font-weight: bold; color: var(--secondary); }\n"
+    "        input[type=\"number\"], select { width: 100%; padding: 12px; border: 2px solid #ddd; border-radius: 8px; box-sizing: border-box; background-color: white; }\n"
+    "        input[type=\"number\"]:focus, select:focus { border-color: var(--primary); outline: none; }\n"
+    "        .checkbox-group { display: flex; align-items: center; gap: 10px; margin-top: 20px; }\n"
+    "        input[type=\"range\"] { width: 100%; }\n"
+    "        button { width: 100%; padding: 12px; margin-top: 20px; background-color: var(--primary); color: white; border: none; border-radius: 8px; font-size: 1.1em; cursor: pointer; }\n"
+    "        button:hover { background-color: #E05AA0; }\n"
+    "        .note { margin-top: 20px; font-size: 0.9em; color: #666; text-align: center; }\n"
+    "    </style>\n"
+    "</head>\n"
+    "<body>\n"
+    "    <div class=\"container\">\n"
+    "        <h1>Mochi Settings</h1>\n"
+    "        <form action=\"/save-settings\" method=\"post\">\n"
+    "            <label for=\"temp_high\">High Temperature Alert (\302\260C)</label>\n"
+    "            <input type=\"number\" id=\"temp_high\" name=\"temp_high\" step=\"0.1\" value=\"\" required>\n"
+    "\n"
+    "            <label for=\"temp_low\">Low Temperature Alert (\302\260C)</label>\n"
+    "            <input type=\"number\" id=\"temp_low\" name=\"temp_low\" step=\"0.1\" value=\"\" required>\n"
+    "\n"
+    "            <label for=\"timezone\">Time Zone</label>\n"
+    "            <select id=\"timezone\" name=\"timezone\">\n"
+    "                <option value=\"-43200\">UTC-12:00</option>\n"
+    "                <option value=\"-39600\">UTC-11:00</option>\n"
+    "                <option value=\"-36000\">UTC-10:00 (HST)</option>\n"
+    "                <option value=\"-32400\">UTC-09:00 (AKST)</option>\n"
+    "                <option value=\"-28800\">UTC-08:00 (PST)</option>\n"
+    "                <option value=\"-25200\">UTC-07:00 (MST)</option>\n"
+    "                <option value=\"-21600\">UTC-06:00 (CST)</option>\n"
+    "                <option value=\"-18000\">UTC-05:00 (EST)</option>\n"
+    "                <option value=\"-14400\">UTC-04:00 (AST)</option>\n"
+    "                <option value=\"-10800\">UTC-03:00</option>\n"
+    "                <option value=\"-7200\">UTC-02:00</option>\n"
+    "                <option value=\"-3600\">UTC-01:00</option>\n"
+    "                <option value=\"0\">UTC\302\26100:00 (GMT)</option>\n"
+    "                <option value=\"3600\">UTC+01:00 (CET)</option>\n"
+    "                <option value=\"7200\">UTC+02:00 (EET)</option>\n"
+    "                <option value=\"10800\">UTC+03:00 (MSK)</option>\n"
+    "                <option value=\"14400\">UTC+04:00</option>\n"
+    "                <option value=\"18000\">UTC+05:00</option>\n"
+    "                <option value=\"19800\">UTC+05:30 (IST)</option>\n"
+    "                <option value=\"21600\">UTC+06:00</option>\n"
+    "                <option value=\"25200\">UTC+07:00</option>\n"
+    "                <option value=\"28800\">UTC+08:00 (CST)</option>\n"
+    "                <option value=\"32400\">UTC+09:00 (JST)</option>\n"
+    "                <option value=\"34200\">UTC+09:30</option>\n"
+    "                <option value=\"36000\">UTC+10:00 (AEST)</option>\n"
+    "                <option value=\"39600\">UTC+11:00</option>\n"
+    "                <option value=\"43200\">UTC+12:00</option>\n"
+    "            </select>\n"
+    "\n"
+    "            <label for=\"sensor_interval\">Sensor Read Interval (seconds, min 5)</label>\n"
+    "            <input type=\"number\" id=\"sensor_interval\" name=\"sensor_interval\" min=\"5\" value=\"\">\n"
+    "\n"
+    "            <div class=\"checkbox-group\">\n"
+    "                <input type=\"checkbox\" id=\"sensor_adapt\" name=\"sensor_adapt\" >\n"
+    "                <label for=\"sensor_adapt\">Adaptive Sampling (read faster while readings change)</label>\n"
+    "            </div>\n"
+    "            <label for=\"sensor_min\">Adaptive Fastest Interval (seconds, min 1)</label>\n"
+    "            <input type=\"number\" id=\"sensor_min\" name=\"sensor_min\" min=\"1\" value=\"\">\n"
+    "            <label for=\"sensor_max\">Adaptive Slowest Interval (seconds)</label>\n"
+    "            <input type=\"number\" id=\"sensor_max\" name=\"sensor_max\" min=\"1\" value=\"\">\n"
+    "\n"
+    "            <label for=\"altitude\">Altitude (metres above sea level, for the weather forecast)</label>\n"
+    "            <input type=\"number\" id=\"altitude\" name=\"altitude\" min=\"-500\" max=\"9000\" value=\"\">\n"
+    "\n"
+    "            <label for=\"oled_timeout\">OLED Timeout (minutes, 0=always on)</label>\n"
+    "            <input type=\"number\" id=\"oled_timeout\" name=\"oled_timeout\" min=\"0\" value=\"\">\n"
+    "\n"
+    "            <div class=\"checkbox-group\">\n"
+    "                <input type=\"checkbox\" id=\"auto_bright\" name=\"auto_bright\" >\n"
+    "                <label for=\"auto_bright\">Auto Brightness (needs the BH1750: dims with the room light, screen off in the dark)</label>\n"
+    "            </div>\n"
+    "\n"
+    "            <hr style=\"margin: 20px 0; border: 1px dashed #ddd;\">\n"
+    "\n"
+    "            <label for=\"quiet_start\">Quiet Hours Start (0-23)</label>\n"
+    "            <input type=\"number\" id=\"quiet_start\" name=\"quiet_start\" min=\"0\" max=\"23\" value=\"\">\n"
+    "            <label for=\"quiet_end\">Quiet Hours End (0-23)</label>\n"
+    "            <input type=\"number\" id=\"quiet_end\" name=\"quiet_end\" min=\"0\" max=\"23\" value=\"\">\n"
+    "\n"
+    "            <label for=\"alarm_hr\">Alarm Time (Hour, 0-23)</label>\n"
+    "            <input type=\"number\" id=\"alarm_hr\" name=\"alarm_hr\" min=\"0\" max=\"23\" value=\"\">\n"
+    "            <label for=\"alarm_min\">Alarm Time (Minute, 0-59)</label>\n"
+    "            <input type=\"number\" id=\"alarm_min\" name=\"alarm_min\" min=\"0\" max=\"59\" value=\"\">\n"
+    "\n"
+    "            <div class=\"checkbox-group\">\n"
+    "                <input type=\"checkbox\" id=\"buzzer\" name=\"buzzer\" >\n"
+    "                <label for=\"buzzer\">Enable Buzzer</label>\n"
+    "            </div>\n"
+    "\n"
+    "            <div class=\"checkbox-group\" style=\"margin-top: 10px;\">\n"
+    "                <input type=\"checkbox\" id=\"alarm_en\" name=\"alarm_en\" >\n"
+    "                <label for=\"alarm_en\">Enable Wake-up Alarm</label>\n"
+    "            </div>\n"
+    "\n"
+    "            <button type=\"submit\">Save & Reboot</button>\n"
+    "        </form>\n"
+    "\n"
+    "        <a href=\"/update\" style=\"display: block; text-align: center; margin-top: 20px;\">Update Firmware</a>\n"
+    "\n"
+    "        <p class=\"note\">Smart-Nav-Mitra will reboot to apply the new settings.</p>\n"
+    "    </div>\n"
+    "    <script>document.getElementById('timezone').value = '';</script>\n"
+    "</body>\n"
+    "</html>\n";
+static const HttpSegment SETTINGS_PAGE_SEGMENTS[] PROGMEM = {
+  { 1935, PH_TEMP_HIGH },
+  { 164, PH_TEMP_LOW },
+  { 1954, PH_SENSOR_INTERVAL },
+  { 122, PH_SENSOR_ADAPT_CHECKED },
+  { 294, PH_SENSOR_MIN },
+  { 165, PH_SENSOR_MAX },
+  { 198, PH_ALTITUDE },
+  { 172, PH_OLED_TO },
+  { 120, PH_AUTO_BRIGHT_CHECKED },
+  { 386, PH_QUIET_START },
+  { 158, PH_QUIET_END },
+  { 157, PH_ALARM_HR },
+  { 161, PH_ALARM_MIN },
+  { 110, PH_BUZZER_CHECKED },
+  { 216, PH_ALARM_CHECKED },
+  { 423, PH_TZ_OFFSET },
+  { 28, HTTP_PAGE_END },
+};
+static const HttpPage SETTINGS_PAGE = { SETTINGS_PAGE_TEXT, SETTINGS_PAGE_SEGMENTS, 17 };
+
+// web/update.html: 3675 bytes, 0 placeholders
+static const char UPDATE_PAGE_TEXT[] PROGMEM =
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "    <meta charset=\"UTF-8\">\n"
+    "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+    "    <title>Firmware Update</title>\n"
+    "    <style>\n"
+    "        :root { --primary: #6A5ACD; --bg: #F0F4F8; --card-bg: #FFFFFF; --text-color: #333; }\n"
+    "        body { font-family: Arial, sans-serif; margin: 0; padding: 20px; background-color: var(--bg); color: var(--text-color); display: flex; justify-content: center; align-items: center; min-height: 100vh; }\n"
+    "        .container { background: var(--card-bg); padding: 30px; border-radius: 16px; box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1); width: 100%; max-width: 500px; text-align: center; }\n"
+    "        h1 { color: var(--primary); }\n"
+    "        form { margin-top: 20px; }\n"
+    "        input[type=\"file\"] { border: 2px dashed #ddd; padding: 20px; border-radius: 8px; width: 100%; box-sizing: border-box; }\n"
+    "        button { width: 100%; padding: 12px; margin-top: 20px; background-color: var(--primary); color: white; border: none; border-radius: 8px; font-size: 1.1em; cursor: pointer; }\n"
+    "        button:hover { background-color: #5949B2; }\n"
+    "        .progress-bar { width: 100%; background-color: #ddd; border-radius: 4px; margin-top: 20px; display: none; }\n"
+    "        .progress { width: 0%; height: 20px; background-color: var(--primary); border-radius: 4px; text-align: center; color: white; line-height: 20px; }\n"
+    "        #status { margin-top: 10px; font-weight: bold; }\n"
+    "    </style>\n"
+    "</head>\n"
+    "<body>\n"
+    "    <div class=\"container\">\n"
+    "        <h1>Firmware Update</h1>\n"
+    "        <p>Select a .bin file to upload and update the device.</p>\n"
+    "        <form id=\"upload_form\" method=\"POST\" action=\"/update\" enctype=\"multipart/form-data\">\n"
+    "            <input type=\"file\" name=\"update\" id=\"file\" accept=\".bin\" required>\n"
+    "            <button type=\"submit\">Update Firmware</button>\n"
+    "        </form>\n"
+    "        <div class=\"progress-bar\" id=\"progress_bar\">\n"
+    "            <div class=\"progress\" id=\"progress\">0%</div>\n"
+    "        </div>\n"
+    "        <div id=\"status\"></div>\n"
+    "    </div>\n"
+    "    <script>\n"
+    "        const form = document.getElementById('upload_form');\n"
+    "        const progressBar = document.getElementById('progress_bar');\n"
+    "        const progress = document.getElementById('progress');\n"
+    "        const status = document.getElementById('status');\n"
+    "\n"
+    "        form.addEventListener('submit', function(e) {\n"
+    "            e.preventDefault();\n"
+    "            const fileInput = document.getElementById('file');\n"
+    "            const file = fileInput.files[0];\n"
+    "            if (!file) {\n"
+    "                status.textContent = 'Please select a file.';\n"
+    "                return;\n"
+    "            }\n"
+    "\n"
+    "            const xhr = new XMLHttpRequest();\n"
+    "            xhr.open('POST', '/update', true);\n"
+    "\n"
+    "            xhr.upload.addEventListener('progress', function(e) {\n"
+    "                if (e.lengthComputable) {\n"
+    "                    const percentComplete = (e.loaded / e.total) * 100;\n"
+    "                    progressBar.style.display = 'block';\n"
+    "                    progress.style.width = percentComplete.toFixed(2) + '%';\n"
+    "                    progress.textContent = percentComplete.toFixed(2) + '%';\n"
+    "                }\n"
+    "            });\n"
+    "\n"
+    "            xhr.onload = function() {\n"
+    "                if (xhr.status === 200) {\n"
+    "                    status.textContent = 'Update successful! Rebooting...';\n"
+    "                    setTimeout(() => window.location.href = '/', 5000); // Redirect to home page after 5s\n"
+    "                } else {\n"
+    "                    status.textContent = 'Update failed! ' + xhr.responseText;\n"
+    "                }\n"
+    "            };\n"
+    "\n"
+    "            const formData = new FormData();\n"
+    "            formData.append('update', file);\n"
+    "            xhr.send(formData);\n"
+    "        });\n"
+    "    </script>\n"
+    "</body>\n"
+    "</html>\n";
+static const HttpSegment UPDATE_PAGE_SEGMENTS[] PROGMEM = {
+  { 3675, HTTP_PAGE_END },
+};
+static const HttpPage UPDATE_PAGE = { UPDATE_PAGE_TEXT, UPDATE_PAGE_SEGMENTS, 1 };
@@ -0,0 +1,42 @@
+// Background Wi-Fi scan for the setup portal.
+//
+// A blocking WiFi.scanNetworks() holds its caller for about two seconds while the radio
+// hops channels. Here the scan runs asynchronously: wifiScanPoll(), called from loop(),
+// starts one every WIFI_SCAN_REFRESH_MS and, once the driver reports it done, copies the
+// results into a small cache and frees the driver's list. The cache keeps the strongest
+// WIFI_SCAN_MAX networks, one entry per SSID, strongest first; hidden networks are left
+// out. The portal page gets the cache inlined as JSON, so its list is there as soon as
+// the page is, and /networks serves the same JSON to refresh it. Readers copy the cache
+// under a spinlock and never wait for a scan.
+//
+// Scanning needs the station interface, so the first scan turns the access point's
+// WIFI_AP mode into WIFI_AP_STA; the AP keeps running.
+#pragma once
+
+#include <stdint.h>
+
+class Print;
+
+const uint8_t WIFI_SCAN_MAX = 16;
+const uint32_t WIFI_SCAN_REFRESH_MS = 30000;
+const uint32_t WIFI_SCAN_POLL_MS = 250;   // While a scan runs
+
+struct WifiNetwork {
+  char ssid[33];
+  int8_t rssi;      // dBm
+  uint8_t channel;
+  bool open;        // No password
+};
+
+// Starts the first scan. Call once the interface it scans from is up.
+void wifiScanBegin();
+// Collects a finished scan and starts the next one when it is due. Returns the millis()
+// time by which it wants to be called again.
+uint32_t wifiScanPoll(uint32_t nowMs);
+// Copies the cache into out (WIFI_SCAN_MAX entries); returns the number of networks.
+uint8_t wifiScanResults(WifiNetwork* out);
+
+// {"scanning":bool,"age_s":n,"networks":[{"ssid","rssi","channel","open"},...]}, with
+// age_s -1 before the first scan finishes. '<' is escaped, so the JSON can go inside a
+// <script> element as it is.
+void wifiScanPrintJson(Print& out);
@@ -0,0 +1,18 @@
+// Simulated AHT20: values come from the simulator's environment model.
+#pragma once
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#define AHTX0_I2CADDR_DEFAULT 0x38
+
+class Adafruit_AHTX0 {
+public:
+  bool begin(TwoWire* wire = &Wire, int32_t sensor_id = 0, uint8_t i2c_address = AHTX0_I2CADDR_DEFAULT);
+  bool getEvent(sensors_event_t* humidity, sensors_event_t* temp);
+  uint8_t getStatus() { return 0x18; }
+
+private:
+  TwoWire* wire_ = nullptr;
+  bool present_ = false;
+};
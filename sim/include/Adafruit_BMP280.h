@@ -0,0 +1,37 @@
+// Simulated BMP280: values come from the simulator's environment model.
+#pragma once
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#define BMP280_ADDRESS 0x77
+#define BMP280_ADDRESS_ALT 0x76
+#define BMP280_CHIPID 0x58
+
+class Adafruit_BMP280 {
+public:
+  enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+  enum sensor_mode { MODE_SLEEP = 0x00, MODE_FORCED = 0x01, MODE_NORMAL = 0x03, MODE_SOFT_RESET_CODE = 0xB6 };
+  enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+  enum standby_duration {
+    STANDBY_MS_1 = 0x00, STANDBY_MS_63 = 0x01, STANDBY_MS_125 = 0x02, STANDBY_MS_250 = 0x03,
+    STANDBY_MS_500 = 0x04, STANDBY_MS_1000 = 0x05, STANDBY_MS_2000 = 0x06, STANDBY_MS_4000 = 0x07
+  };
+
+  explicit Adafruit_BMP280(TwoWire* theWire = &Wire) : wire_(theWire) {}
+  bool begin(uint8_t addr = BMP280_ADDRESS, uint8_t chipid = BMP280_CHIPID);
+  uint32_t sensorID() { return present_ ? BMP280_CHIPID : 0; }
+  float readTemperature();
+  float readPressure();
+  float readAltitude(float seaLevelhPa = 1013.25);
+  void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling tempSampling = SAMPLING_X16,
+                   sensor_sampling pressSampling = SAMPLING_X16, sensor_filter filter = FILTER_OFF,
+                   standby_duration duration = STANDBY_MS_1) {
+    (void)mode; (void)tempSampling; (void)pressSampling; (void)filter; (void)duration;
+  }
+
+private:
+  TwoWire* wire_;
+  uint8_t addr_ = 0;
+  bool present_ = false;
+};
@@ -0,0 +1,66 @@
+// Host implementation of the Adafruit SSD1306 driver: an in-memory framebuffer
+// in the controller's page layout. display() pushes it to the simulated panel
+// (and costs the same I2C bus time as the real transfer).
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+#define INVERSE SSD1306_INVERSE
+
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SWITCHCAPVCC 0x02
+
+#define SSD1306_SETCONTRAST 0x81
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY 0xA6
+#define SSD1306_INVERTDISPLAY 0xA7
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+#define SSD1306_SETPRECHARGE 0xD9
+#define SSD1306_SETVCOMDETECT 0xDB
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi = &Wire, int8_t rst_pin = -1,
+                   uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL);
+  ~Adafruit_SSD1306();
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0, bool reset = true,
+             bool periphBegin = true);
+  void display();
+  void clearDisplay();
+  void invertDisplay(bool i);
+  void dim(bool dim);
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y);
+  uint8_t* getBuffer() { return buffer; }
+  void ssd1306_command(uint8_t c);
+
+private:
+  void commandByte(uint8_t c);
+
+  TwoWire* wire;
+  uint8_t* buffer = nullptr;
+  uint8_t i2caddr = 0x3C;
+  uint8_t vccstate = SSD1306_SWITCHCAPVCC;
+  uint8_t contrast = 0xCF;
+  int pendingArg = -1; // command expecting a parameter byte
+  uint32_t clkDuring, clkAfter;
+};
+
+// Simulated panel state (what the glass shows after the last display() call).
+struct SimPanel {
+  uint8_t pixels[128 * 64 / 8];
+  uint8_t rotation;
+  uint8_t contrast;
+  bool on;
+  bool inverted;
+  uint32_t flushes;
+};
+SimPanel simPanelSnapshot();
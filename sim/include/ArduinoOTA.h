@@ -0,0 +1,32 @@
+// Simulated ArduinoOTA: the espota.py network service is not emulated.
+#pragma once
+
+#include <Arduino.h>
+#include <Update.h>
+
+typedef enum { OTA_AUTH_ERROR, OTA_BEGIN_ERROR, OTA_CONNECT_ERROR, OTA_RECEIVE_ERROR, OTA_END_ERROR } ota_error_t;
+
+class ArduinoOTAClass {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+  typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+  ArduinoOTAClass& setHostname(const char* hostname) { (void)hostname; return *this; }
+  ArduinoOTAClass& setPassword(const char* password) { (void)password; return *this; }
+  ArduinoOTAClass& setPort(uint16_t port) { (void)port; return *this; }
+  ArduinoOTAClass& onStart(THandlerFunction fn) { onStart_ = fn; return *this; }
+  ArduinoOTAClass& onEnd(THandlerFunction fn) { onEnd_ = fn; return *this; }
+  ArduinoOTAClass& onError(THandlerFunction_Error fn) { onError_ = fn; return *this; }
+  ArduinoOTAClass& onProgress(THandlerFunction_Progress fn) { onProgress_ = fn; return *this; }
+  void begin() {}
+  void end() {}
+  void handle() {}
+
+private:
+  THandlerFunction onStart_, onEnd_;
+  THandlerFunction_Error onError_;
+  THandlerFunction_Progress onProgress_;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
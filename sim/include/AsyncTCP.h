@@ -0,0 +1,2 @@
+// AsyncTCP is provided by the simulated ESPAsyncWebServer event loop.
+#pragma once
@@ -0,0 +1,45 @@
+// Simulated AsyncUDP. Nothing is bound on the host; the simulator hands datagrams to a
+// listener with simUdpDeliver() (see sim.h) and collects what the handler writes back.
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+#include <string>
+
+class AsyncUDPPacket {
+public:
+  AsyncUDPPacket(const uint8_t* data, size_t len, std::string* reply) : data_(data), len_(len), reply_(reply) {}
+  uint8_t* data() { return const_cast<uint8_t*>(data_); }
+  size_t length() { return len_; }
+  // Replies to the sender
+  size_t write(const uint8_t* data, size_t len) {
+    reply_->append((const char*)data, len);
+    return len;
+  }
+
+private:
+  const uint8_t* data_;
+  size_t len_;
+  std::string* reply_;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+public:
+  ~AsyncUDP() { close(); }
+  bool listen(uint16_t port);
+  void onPacket(AuPacketHandlerFunction cb) { handler_ = cb; }
+  void close();
+
+  // Simulator: the listener's handler, called from simUdpDeliver()
+  uint16_t simPort() const { return port_; }
+  void simHandle(AsyncUDPPacket& packet) {
+    if (handler_) handler_(packet);
+  }
+
+private:
+  uint16_t port_ = 0;
+  AuPacketHandlerFunction handler_;
+};
@@ -0,0 +1,216 @@
+// Host implementation of the ESPAsyncWebServer API on POSIX sockets.
+//
+// Like AsyncTCP on the device, a single event-loop thread accepts connections,
+// parses requests and runs every handler, so handlers execute concurrently with
+// loop() exactly as they do on the ESP32. Responses are produced incrementally
+// (fillers are called as the socket drains) and connections close after each
+// response, matching the library's "Connection: close" behaviour.
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+typedef enum {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data,
+                           size_t len, bool final)>
+    ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total)>
+    ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<String(const String&)> AwsTemplateProcessor;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool form = false, bool file = false, size_t size = 0)
+      : name_(name), value_(value), size_(size), isForm_(form), isFile_(file) {}
+  const String& name() const { return name_; }
+  const String& value() const { return value_; }
+  size_t size() const { return size_; }
+  bool isPost() const { return isForm_; }
+  bool isFile() const { return isFile_; }
+
+private:
+  String name_, value_;
+  size_t size_;
+  bool isForm_, isFile_;
+};
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const String& name, const String& value) : name_(name), value_(value) {}
+  const String& name() const { return name_; }
+  const String& value() const { return value_; }
+  String toString() const { return name_ + ": " + value_ + "\r\n"; }
+
+private:
+  String name_, value_;
+};
+
+class AsyncWebServerResponse {
+public:
+  virtual ~AsyncWebServerResponse() {}
+  void setCode(int code) { code_ = code; }
+  void setContentLength(size_t len) { contentLength_ = len; }
+  void setContentType(const String& type) { contentType_ = type; }
+  void addHeader(const String& name, const String& value) { headers_.emplace_back(name, value); }
+
+  // Simulator internals.
+  int code() const { return code_; }
+  bool chunked() const { return chunked_; }
+  std::string head() const;
+  // Writes up to `maxLen` body bytes; returns 0 when finished, RESPONSE_TRY_AGAIN to poll again.
+  virtual size_t fill(uint8_t* buf, size_t maxLen) = 0;
+
+protected:
+  int code_ = 200;
+  String contentType_;
+  size_t contentLength_ = 0;
+  bool chunked_ = false;
+  bool sendContentLength_ = true;
+  std::vector<AsyncWebHeader> headers_;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+  AsyncResponseStream(const String& contentType, size_t bufferSize);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+  size_t fill(uint8_t* buf, size_t maxLen) override;
+
+private:
+  std::string content_;
+  size_t sent_ = 0;
+};
+
+class AsyncWebServerRequest {
+public:
+  ~AsyncWebServerRequest();
+
+  WebRequestMethodComposite method() const { return method_; }
+  const String& url() const { return url_; }
+  const String& host() const { return host_; }
+  const String& contentType() const { return contentType_; }
+  size_t contentLength() const { return body_.size(); }
+  const char* methodToString() const;
+
+  size_t params() const { return params_.size(); }
+  bool hasParam(const String& name, bool post = false, bool file = false) const;
+  AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+  AsyncWebParameter* getParam(size_t num) const;
+  size_t args() const { return params(); }
+  const String& arg(const String& name) const;
+  bool hasArg(const char* name) const;
+
+  size_t headers() const { return headers_.size(); }
+  bool hasHeader(const String& name) const;
+  AsyncWebHeader* getHeader(const String& name) const;
+  AsyncWebHeader* getHeader(size_t num) const;
+
+  void send(AsyncWebServerResponse* response);
+  void send(int code, const String& contentType = String(), const String& content = String());
+  void send_P(int code, const String& contentType, const uint8_t* content, size_t len,
+              AwsTemplateProcessor callback = nullptr);
+  void send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback = nullptr);
+  void send(const String& contentType, size_t len, AwsResponseFiller callback,
+            AwsTemplateProcessor templateCallback = nullptr);
+  void sendChunked(const String& contentType, AwsResponseFiller callback,
+                   AwsTemplateProcessor templateCallback = nullptr);
+  void redirect(const String& url);
+
+  AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(),
+                                        const String& content = String());
+  AsyncWebServerResponse* beginResponse(const String& contentType, size_t len, AwsResponseFiller callback,
+                                        AwsTemplateProcessor templateCallback = nullptr);
+  AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller callback,
+                                               AwsTemplateProcessor templateCallback = nullptr);
+  AsyncResponseStream* beginResponseStream(const String& contentType, size_t bufferSize = 1460);
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, const uint8_t* content, size_t len,
+                                          AwsTemplateProcessor callback = nullptr);
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, PGM_P content,
+                                          AwsTemplateProcessor callback = nullptr);
+
+  void onDisconnect(ArDisconnectHandler fn) { onDisconnect_ = fn; }
+
+  // Simulator internals (filled in by the event loop's request parser).
+  AsyncWebServerResponse* simResponse() const { return response_; }
+  AsyncWebServerRequest() {}
+
+  WebRequestMethodComposite method_ = HTTP_GET;
+  String url_, host_, contentType_;
+  std::string body_;
+  std::vector<AsyncWebParameter*> params_;
+  std::vector<AsyncWebHeader*> headers_;
+  AsyncWebServerResponse* response_ = nullptr;
+  ArDisconnectHandler onDisconnect_;
+  void* _tempObject = nullptr;
+};
+
+class AsyncCallbackWebHandler {
+public:
+  String uri;
+  WebRequestMethodComposite method = HTTP_ANY;
+  ArRequestHandlerFunction onRequest;
+  ArUploadHandlerFunction onUpload;
+  ArBodyHandlerFunction onBody;
+  bool canHandle(const AsyncWebServerRequest* request) const;
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port) : port_(port) {}
+  ~AsyncWebServer();
+
+  void begin();
+  void end();
+  void reset();
+
+  AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest);
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                              ArUploadHandlerFunction onUpload);
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                              ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
+  void onNotFound(ArRequestHandlerFunction fn) { notFound_ = fn; }
+
+  // Simulator internals: dispatches a fully received request on the event-loop thread.
+  void simDispatch(AsyncWebServerRequest* request);
+
+private:
+  uint16_t port_;
+  std::vector<std::unique_ptr<AsyncCallbackWebHandler>> handlers_;
+  ArRequestHandlerFunction notFound_;
+  bool running_ = false;
+};
+
+// Simulator: port that "port 80" maps to on the host, and simulator-only routes
+// that are matched before any firmware handler.
+void simHttpSetPort(uint16_t port);
+uint16_t simHttpPort();
+void simHttpAddRoute(const char* uri, ArRequestHandlerFunction fn);
+// Listens for the simulator routes even if the firmware never starts its server
+void simHttpStart();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "WString.h"
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : a_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : a_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return a_[i]; }
+  String toString() const {
+    return String((int)a_[0]) + "." + String((int)a_[1]) + "." + String((int)a_[2]) + "." + String((int)a_[3]);
+  }
+  bool operator==(const IPAddress& o) const {
+    return a_[0] == o.a_[0] && a_[1] == o.a_[1] && a_[2] == o.a_[2] && a_[3] == o.a_[3];
+  }
+
+  size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+  uint8_t a_[4];
+};
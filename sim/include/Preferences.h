@@ -0,0 +1,62 @@
+// Simulated NVS: each namespace is a small text file in the simulator's state
+// directory, so settings survive ESP.restart() just like on the device.
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false, const char* partition_label = nullptr);
+  void end();
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putChar(const char* key, int8_t value) { return putNum(key, value, 1); }
+  size_t putUChar(const char* key, uint8_t value) { return putNum(key, value, 1); }
+  size_t putShort(const char* key, int16_t value) { return putNum(key, value, 2); }
+  size_t putUShort(const char* key, uint16_t value) { return putNum(key, value, 2); }
+  size_t putInt(const char* key, int32_t value) { return putNum(key, value, 4); }
+  size_t putUInt(const char* key, uint32_t value) { return putNum(key, value, 4); }
+  size_t putLong(const char* key, int32_t value) { return putNum(key, value, 4); }
+  size_t putULong(const char* key, uint32_t value) { return putNum(key, value, 4); }
+  size_t putLong64(const char* key, int64_t value) { return putNum(key, (double)value, 8); }
+  size_t putULong64(const char* key, uint64_t value) { return putNum(key, (double)value, 8); }
+  size_t putFloat(const char* key, float value) { return putNum(key, value, 4); }
+  size_t putDouble(const char* key, double value) { return putNum(key, value, 8); }
+  size_t putBool(const char* key, bool value) { return putNum(key, value ? 1 : 0, 1); }
+  size_t putString(const char* key, const char* value);
+  size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+  size_t putBytes(const char* key, const void* value, size_t len);
+
+  int8_t getChar(const char* key, int8_t defaultValue = 0) { return (int8_t)getNum(key, defaultValue); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return (uint8_t)getNum(key, defaultValue); }
+  int16_t getShort(const char* key, int16_t defaultValue = 0) { return (int16_t)getNum(key, defaultValue); }
+  uint16_t getUShort(const char* key, uint16_t defaultValue = 0) { return (uint16_t)getNum(key, defaultValue); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) { return (int32_t)getNum(key, defaultValue); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return (uint32_t)getNum(key, defaultValue); }
+  int32_t getLong(const char* key, int32_t defaultValue = 0) { return (int32_t)getNum(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return (uint32_t)getNum(key, defaultValue); }
+  int64_t getLong64(const char* key, int64_t defaultValue = 0) { return (int64_t)getNum(key, (double)defaultValue); }
+  uint64_t getULong64(const char* key, uint64_t defaultValue = 0) { return (uint64_t)getNum(key, (double)defaultValue); }
+  float getFloat(const char* key, float defaultValue = NAN) { return (float)getNum(key, defaultValue); }
+  double getDouble(const char* key, double defaultValue = NAN) { return getNum(key, defaultValue); }
+  bool getBool(const char* key, bool defaultValue = false) { return getNum(key, defaultValue ? 1 : 0) != 0; }
+  String getString(const char* key, const String defaultValue = String());
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+private:
+  size_t putNum(const char* key, double value, size_t size);
+  double getNum(const char* key, double defaultValue);
+  void load();
+  void save();
+
+  std::string ns_;
+  bool open_ = false;
+  bool readOnly_ = true;
+  std::map<std::string, std::string> values_;
+};
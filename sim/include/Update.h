@@ -0,0 +1,26 @@
+// Simulated firmware updater: the uploaded image is written to the state directory.
+#pragma once
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN);
+  size_t write(uint8_t* data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  bool isFinished() { return finished_; }
+  bool hasError() { return error_; }
+  void printError(Print& out) { out.println(errorString()); }
+  const char* errorString() { return error_ ? "Update error (simulated)" : "No error"; }
+  size_t progress() { return written_; }
+
+private:
+  FILE* file_ = nullptr;
+  size_t written_ = 0;
+  bool finished_ = false;
+  bool error_ = false;
+};
+
+extern UpdateClass Update;
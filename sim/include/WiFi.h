@@ -0,0 +1,78 @@
+// Simulated Wi-Fi: station mode "connects" instantly to any non-empty SSID
+// (unless the simulator runs with --no-wifi), serving on the host's loopback.
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+typedef enum {
+  WL_NO_SHIELD = 255, WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_CONNECTION_LOST = 5, WL_DISCONNECTED = 6
+} wl_status_t;
+typedef enum {
+  WIFI_AUTH_OPEN = 0, WIFI_AUTH_WEP, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK,
+  WIFI_AUTH_WPA2_ENTERPRISE, WIFI_AUTH_WPA3_PSK, WIFI_AUTH_WPA2_WPA3_PSK
+} wifi_auth_mode_t;
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { mode_ = m; return true; }
+  wifi_mode_t getMode() { return mode_; }
+
+  bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet) {
+    (void)gateway; (void)subnet;
+    apIp_ = local_ip;
+    return true;
+  }
+  bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1, int ssid_hidden = 0,
+              int max_connection = 4) {
+    (void)passphrase; (void)channel; (void)ssid_hidden; (void)max_connection;
+    apSsid_ = ssid;
+    return true;
+  }
+  IPAddress softAPIP() { return apIp_; }
+
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+  bool disconnect(bool wifioff = false) { (void)wifioff; status_ = WL_DISCONNECTED; return true; }
+  bool reconnect() { return begin(ssid_.c_str()) == WL_CONNECTED; }
+  wl_status_t status() { return status_; }
+  bool isConnected() { return status_ == WL_CONNECTED; }
+
+  IPAddress localIP() { return status_ == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress(); }
+  String SSID() { return ssid_; }
+  int8_t RSSI();
+  String macAddress() { return "02:00:00:5E:C3:01"; }
+  uint8_t channel() { return 6; }
+
+  bool setSleep(bool enabled) { sleep_ = enabled; return true; }
+  bool setSleep(wifi_ps_type_t type) { sleep_ = type != WIFI_PS_NONE; return true; }
+  bool getSleep() { return sleep_; }
+  bool setHostname(const char* name) { hostname_ = name; return true; }
+
+  int16_t scanNetworks(bool async = false, bool show_hidden = false, bool passive = false,
+                       uint32_t max_ms_per_chan = 300, uint8_t channel = 0);
+  int16_t scanComplete();
+  void scanDelete();
+  String SSID(uint8_t i);
+  int32_t RSSI(uint8_t i);
+  wifi_auth_mode_t encryptionType(uint8_t i);
+  int32_t channel(uint8_t i);
+
+private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  wl_status_t status_ = WL_IDLE_STATUS;
+  IPAddress apIp_;
+  String apSsid_, ssid_, hostname_;
+  bool sleep_ = true;
+  unsigned long scanStartedAt_ = 0;
+  int16_t scanState_ = WIFI_SCAN_FAILED;
+};
+
+extern WiFiClass WiFi;
+
+// Simulator: make station connects fail (forces the captive portal path).
+void simWiFiSetAvailable(bool available);
@@ -0,0 +1,8 @@
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+// Saved to the state directory on a simulated reset and restored after it (sim_reset.cpp)
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))
+#define RTC_IRAM_ATTR
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+esp_err_t esp_sleep_enable_gpio_wakeup();
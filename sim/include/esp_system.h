@@ -0,0 +1,24 @@
+// Reset reasons and the hardware RNG. The simulator passes the reset reason to the
+// re-executed firmware, see simReset() in sim.h.
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+} esp_reset_reason_t;
+
+esp_reset_reason_t esp_reset_reason();
+
+// Hardware RNG; std::random_device here
+uint32_t esp_random();
@@ -0,0 +1,31 @@
+// Host implementation of the FreeRTOS types and primitives the firmware uses.
+// Tasks are std::threads; tick counts are virtual milliseconds.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Critical sections: one process-wide recursive lock.
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void simEnterCritical();
+void simExitCritical();
+#define portENTER_CRITICAL(mux) ((void)(mux), simEnterCritical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), simExitCritical())
+#define portENTER_CRITICAL_ISR(mux) simEnterCritical()
+#define portEXIT_CRITICAL_ISR(mux) simExitCritical()
+#define portYIELD_FROM_ISR(...) ((void)0)
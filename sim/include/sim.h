@@ -0,0 +1,161 @@
+// Simulator-only hooks: virtual clock, virtual pins and the simulated environment.
+// Nothing in the firmware includes this; it is used by the shims and sim_main.cpp.
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "WString.h"
+
+// --- Virtual clock ---
+// Virtual time advances at `simSpeed` times wall-clock speed.
+void simClockInit(double speed);
+// Stops following the wall clock until the next simClockInit(): virtual time then only
+// moves when the program sleeps or a timed wait runs out, by exactly that long. For
+// single-threaded checks that need exact virtual timings.
+void simClockStep();
+bool simClockStepped();
+double simSpeed();
+uint64_t simMicros64();
+void simSleepMicros(uint64_t us);
+
+// --- Virtual pins ---
+void simSetPin(uint8_t pin, int level);
+int simGetPin(uint8_t pin);
+// Holds the pin HIGH for `ms` virtual milliseconds from a background thread.
+void simPulsePin(uint8_t pin, uint32_t ms);
+uint32_t simBuzzerFrequency();
+
+// --- Simulated environment (AHT20 / BMP280 / BH1750) ---
+struct SimEnvironment {
+  float tempC;
+  float humidity;
+  float pressure_hPa;
+  float lux;
+  bool ahtPresent;
+  bool bmpPresent;
+  bool bh1750Present;
+  bool overridden; // true while values come from /sim/sensors instead of the model
+};
+SimEnvironment simReadEnvironment();
+void simOverrideEnvironment(float tempC, float humidity, float pressure_hPa, float lux);
+void simClearEnvironmentOverride();
+// Registers the devices emulated at register level (the BH1750) on the I2C bus.
+void simSensorsBegin();
+// True while the emulated BH1750 is still converting: its data register holds the last result.
+bool simBh1750Converting();
+
+// --- Simulated microphone (INMP441 on I2S) ---
+// The model is a quiet room with someone talking now and then; a WAV file given with
+// --mic-wav replaces it, and simMicOverride() pins a tone and/or noise (a level <= 0
+// leaves that part out).
+bool simMicSetWav(const char* path);
+void simMicOverride(float toneDb, float toneHz, float noiseDb);
+void simMicClearOverride();
+struct SimMicState {
+  bool running;          // The firmware installed the I2S driver
+  const char* source;    // "model", "wav" or "override"
+  float toneDb, toneHz, noiseDb;
+};
+SimMicState simMicState();
+// Times the sound level meter's kernels on a WAV file and prints its levels (--sound-bench).
+// Returns the process exit code.
+int simSoundBench(const char* path);
+// Times the speech front end's kernels on a WAV file and checks its features against a
+// double-precision reference (--voice-bench). Returns the process exit code, 1 on a mismatch.
+int simVoiceBench(const char* path);
+
+// --- Power ---
+// Whether esp_pm_configure() succeeds, as in a build with tickless idle (the default), or
+// fails as in one without.
+void simPmSetAvailable(bool available);
+// Virtual time any no-light-sleep power management lock has been held, in total.
+uint64_t simPmNoSleepUs();
+// Runs the power manager's waits against the simulated Wi-Fi and touch pin, checks when
+// it light-sleeps, and estimates a day of the loop through it (--power-test). Returns the
+// process exit code, 1 on a failure.
+int simPowerTest();
+
+// --- Display ---
+// Checks the precomputed eye frames against the reference GFX drawing and times both
+// ways of showing one (--eye-bench). Returns the process exit code, 1 on a mismatch.
+int simEyeBench();
+// Drives the eye animator into a host framebuffer and checks its key frames and frame
+// slots (--eye-test). Returns the process exit code, 1 on a failure.
+int simEyeTest();
+
+// --- Logging ---
+// Checks the log formatter and times log calls against a synchronous Serial.printf()
+// over a modelled UART (--log-bench). Returns the process exit code, 1 on a mismatch.
+int simLogBench();
+// Checks the crash trace's encoding, ring order and validity checks and times one
+// event (--trace-test). Returns the process exit code, 1 on a failure.
+int simTraceTest();
+
+// --- Sensor readings ---
+// Hammers the sensor snapshot's seqlock from a writer and several reader threads and
+// checks every copy is whole (--snapshot-test). Returns the process exit code, 1 on a failure.
+int simSnapshotTest();
+// Feeds the anomaly detector failed reads, zeros, a frozen value, a flat line and steps
+// between ordinary readings and checks its conditions and events (--anomaly-test).
+// Returns the process exit code, 1 on a failure.
+int simAnomalyTest();
+// Replays the pressure_*.csv traces in dir through the pressure tendency, checks every
+// refit against an exact least-squares fit and each trace's expected outlook
+// (--pressure-test). Returns the process exit code, 1 on a failure.
+int simPressureTest(const char* dir);
+// Sweeps the light through the BH1750 emulation and checks the driver's ranging, clip
+// re-measures and readings against a datasheet reference (--light-test). Returns the
+// process exit code, 1 on a failure.
+int simLightTest();
+// Replays a time_s,temp,humidity,pressure trace (path, or a synthetic day when null)
+// through the adaptive sampler, reports the reads it saves and checks how it follows the
+// signal and missing readings (--sampler-test). Returns the process exit code, 1 on a failure.
+int simSamplerTest(const char* path);
+
+// --- Sample history ---
+// Checks the /history?after= delta protocol against the sample store through dropped
+// polls, outages and restarts (--history-test). Returns the process exit code, 1 on a failure.
+int simHistoryTest();
+
+// --- Statistics ---
+// Checks the rolling statistics against an exact recomputation of every window and
+// times a reading (--stats-bench). Returns the process exit code, 1 on a mismatch.
+int simStatsBench();
+// Checks the percentile sketches' counts and rank error against exact percentiles and
+// times them (--quantile-test). Returns the process exit code, 1 on a failure.
+int simQuantileTest();
+
+// --- Web responses ---
+// Streams full sample exports through httpSendStream() and checks their lines, the pool
+// slot's return and the rate (--export-bench). Returns the process exit code, 1 on a failure.
+int simExportBench();
+// Checks the CBOR forms of /data and /history against their JSON field by field and times
+// both encoders (--api-bench). Returns the process exit code, 1 on a mismatch.
+int simApiBench();
+// Renders the main page through the old copy-and-replace() path and through
+// httpRenderPage(), compares them and times both (--render-bench). Returns the process
+// exit code, 1 on a failure.
+int simRenderBench();
+
+// --- Network ---
+// Hands a datagram to the AsyncUDP listener on port, as if from a client; what the
+// handler writes back is appended to reply. False if nothing listens there.
+bool simUdpDeliver(uint16_t port, const uint8_t* data, size_t len, std::string& reply);
+// Checks the captive portal's DNS answers to well-formed and malformed queries
+// (--dns-test). Returns the process exit code, 1 on a failure.
+int simDnsTest();
+
+// --- Persistent state directory (NVS, flash partitions) ---
+void simSetStateDir(const char* dir);
+String simStatePath(const char* name);
+
+// --- Process control ---
+void simSetArgs(int argc, char** argv);
+// Resets the device: RTC_NOINIT_ATTR memory is saved, and the firmware is re-executed
+// with esp_reset_reason() returning reason (an esp_reset_reason_t).
+void simReset(int reason, const char* what) __attribute__((noreturn));
+// Call after the state directory is set, before setup(): restores RTC memory after a
+// simulated reset, and turns crashes (SIGSEGV, SIGABRT, ...) into panic resets.
+void simResetBoot();
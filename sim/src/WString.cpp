@@ -0,0 +1,122 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static std::string formatUnsigned(unsigned long long v, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int i = sizeof(buf) - 1;
+  buf[i] = '\0';
+  do {
+    int d = (int)(v % base);
+    buf[--i] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+    v /= base;
+  } while (v);
+  return std::string(&buf[i]);
+}
+
+static std::string formatSigned(long long v, unsigned char base) {
+  if (v < 0 && base == 10) return "-" + formatUnsigned((unsigned long long)(-(v + 1)) + 1, base);
+  return formatUnsigned((unsigned long long)v, base);
+}
+
+static std::string formatFloat(double v, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  return std::string(buf);
+}
+
+String::String(unsigned char v, unsigned char base) : s_(formatUnsigned(v, base)) {}
+String::String(int v, unsigned char base) : s_(formatSigned(v, base)) {}
+String::String(unsigned int v, unsigned char base) : s_(formatUnsigned(v, base)) {}
+String::String(long v, unsigned char base) : s_(formatSigned(v, base)) {}
+String::String(unsigned long v, unsigned char base) : s_(formatUnsigned(v, base)) {}
+String::String(long long v, unsigned char base) : s_(formatSigned(v, base)) {}
+String::String(unsigned long long v, unsigned char base) : s_(formatUnsigned(v, base)) {}
+String::String(float v, unsigned int decimals) : s_(formatFloat(v, decimals)) {}
+String::String(double v, unsigned int decimals) : s_(formatFloat(v, decimals)) {}
+
+bool String::equalsIgnoreCase(const String& o) const {
+  return strcasecmp(s_.c_str(), o.s_.c_str()) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t p = s_.find(c, from);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+  size_t p = s_.find(str.s_, from);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t p = s_.rfind(c);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned int from) const {
+  if (from >= s_.size()) return String();
+  return String(s_.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) { unsigned int t = from; from = to; to = t; }
+  if (from >= s_.size()) return String();
+  if (to > s_.size()) to = (unsigned int)s_.size();
+  return String(s_.substr(from, to - from));
+}
+
+void String::replace(char find, char repl) {
+  for (auto& ch : s_) if (ch == find) ch = repl;
+}
+
+void String::replace(const String& find, const String& repl) {
+  if (find.s_.empty()) return;
+  size_t pos = 0;
+  while ((pos = s_.find(find.s_, pos)) != std::string::npos) {
+    s_.replace(pos, find.s_.size(), repl.s_);
+    pos += repl.s_.size();
+  }
+}
+
+void String::remove(unsigned int index) {
+  if (index < s_.size()) s_.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < s_.size()) s_.erase(index, count);
+}
+
+void String::toLowerCase() {
+  for (auto& ch : s_) ch = (char)tolower((unsigned char)ch);
+}
+
+void String::toUpperCase() {
+  for (auto& ch : s_) ch = (char)toupper((unsigned char)ch);
+}
+
+void String::trim() {
+  size_t b = 0, e = s_.size();
+  while (b < e && isspace((unsigned char)s_[b])) b++;
+  while (e > b && isspace((unsigned char)s_[e - 1])) e--;
+  s_ = s_.substr(b, e - b);
+}
+
+long String::toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+float String::toFloat() const { return strtof(s_.c_str(), nullptr); }
+double String::toDouble() const { return strtod(s_.c_str(), nullptr); }
+
+String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+String operator+(const String& a, char b) { String r(a); r += b; return r; }
+String operator+(const String& a, int b) { String r(a); r += b; return r; }
+String operator+(const String& a, unsigned int b) { String r(a); r += b; return r; }
+String operator+(const String& a, long b) { String r(a); r += b; return r; }
+String operator+(const String& a, unsigned long b) { String r(a); r += b; return r; }
+String operator+(const String& a, float b) { String r(a); r += b; return r; }
+String operator+(const String& a, double b) { String r(a); r += b; return r; }
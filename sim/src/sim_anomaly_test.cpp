@@ -0,0 +1,234 @@
+// --anomaly-test: feeds the anomaly detector (anomaly_detector.h) injected faults between
+// stretches of ordinary readings and checks what it makes of each reading, the condition
+// the API reports (anomalyCondition()) and the typed events it records. The faults are
+// the ones a dead or failing sensor produces: failed reads, zeros reported as readings
+// (from the AHT20, and a BMP280 reading 0 hPa), a frozen value, a flat line within a
+// fraction of the noise, and an impossible step; plus a real change the forecast has
+// to follow. Two days of noisy readings with a day/night swing must raise nothing. The
+// exit code is 1 if any check fails.
+#include "anomaly_detector.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <initializer_list>
+#include <random>
+
+#include "sim.h"
+
+const uint32_t ANOMALY_TEST_INTERVAL_MS = 5000;   // The default sensor interval
+const uint32_t NORMAL_DAYS = 2;
+const uint32_t SETTLE_READINGS = 100;             // Ordinary readings before each fault
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// Readings of all channels every ANOMALY_TEST_INTERVAL_MS, ordinary unless a test says
+// otherwise: weather drifting slowly, a day/night swing on temperature and sensor noise
+struct AnomalyFeed {
+  AnomalyDetector d;
+  uint32_t nowMs;
+  std::mt19937 rng;
+  std::normal_distribution<float> noise;
+
+  explicit AnomalyFeed(uint32_t seed) : nowMs(1000), rng(seed), noise(0, 1) { anomalyBegin(d); }
+
+  float normal(AnomalyChannel c) {
+    double t = nowMs / 1000.0;
+    switch (c) {
+      case ANOMALY_TEMP: return 21 + 3 * sin(2 * M_PI * t / 86400) + 0.02f * noise(rng);
+      case ANOMALY_HUMIDITY: return 45 - 8 * sin(2 * M_PI * t / 86400) + 0.1f * noise(rng);
+      default: return 1012 + 0.6 * sin(2 * M_PI * t / 43200) + 0.03f * noise(rng);
+    }
+  }
+
+  // One reading of channel c (the others read normally); returns its condition
+  SensorCondition read(AnomalyChannel c, bool ok, float value) {
+    nowMs += ANOMALY_TEST_INTERVAL_MS;
+    SensorCondition cond = SENSOR_OK;
+    for (uint8_t k = 0; k < ANOMALY_CHANNELS; k++) {
+      SensorCondition got = k == c ? anomalyCheck(d, c, nowMs, ok, value)
+                                   : anomalyCheck(d, (AnomalyChannel)k, nowMs, true, normal((AnomalyChannel)k));
+      if (k == c) cond = got;
+    }
+    return cond;
+  }
+
+  SensorCondition readNormal(AnomalyChannel c) { return read(c, true, normal(c)); }
+
+  // n ordinary readings of every channel; true if all of them were judged OK
+  bool settle(uint32_t n) {
+    bool ok = true;
+    for (uint32_t i = 0; i < n; i++) {
+      nowMs += ANOMALY_TEST_INTERVAL_MS;
+      for (uint8_t k = 0; k < ANOMALY_CHANNELS; k++) {
+        ok &= anomalyCheck(d, (AnomalyChannel)k, nowMs, true, normal((AnomalyChannel)k)) == SENSOR_OK;
+      }
+    }
+    return ok;
+  }
+};
+
+// True if the events recorded from index `from` on are exactly `want`, all on channel c
+static bool eventsAre(AnomalyDetector& d, uint32_t from, AnomalyChannel c, std::initializer_list<SensorCondition> want) {
+  uint32_t end = anomalyEventEnd(d);
+  if (end - from != want.size()) {
+    printf("  %u events, expected %u:", (unsigned)(end - from), (unsigned)want.size());
+    for (uint32_t i = from; i < end; i++) {
+      AnomalyEvent e;
+      if (anomalyEventGet(d, i, e)) printf(" %s/%s", anomalyChannelName(e.channel), sensorConditionName(e.type));
+    }
+    printf("\n");
+    return false;
+  }
+  uint32_t i = from;
+  for (SensorCondition t : want) {
+    AnomalyEvent e;
+    if (!anomalyEventGet(d, i++, e) || e.channel != c || e.type != t) return false;
+  }
+  return true;
+}
+
+// Two days of ordinary readings raise nothing
+static void checkNormal() {
+  AnomalyFeed f(1);
+  bool ok = f.settle(NORMAL_DAYS * 24 * 3600 * 1000 / ANOMALY_TEST_INTERVAL_MS);
+  check(ok, "ordinary readings are all OK");
+  check(anomalyEventEnd(f.d) == 0, "ordinary readings raise no event");
+  for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) {
+    check(anomalyCondition(f.d, (AnomalyChannel)c) == SENSOR_OK, "each channel reports OK after ordinary readings");
+  }
+}
+
+// The AHT20 stops answering: readSensors() reports failed reads (and zeros)
+static void checkFailedReads() {
+  AnomalyFeed f(2);
+  f.settle(SETTLE_READINGS);
+  uint32_t from = anomalyEventEnd(f.d);
+  bool ok = true;
+  for (int i = 0; i < 20; i++) ok &= f.read(ANOMALY_TEMP, false, 0) == SENSOR_READ_FAILED;
+  check(ok, "failed reads are read_failed");
+  check(anomalyCondition(f.d, ANOMALY_TEMP) == SENSOR_READ_FAILED, "the API reports read_failed while reads fail");
+  check(f.readNormal(ANOMALY_TEMP) == SENSOR_OK, "the first good read after failures is OK");
+  check(anomalyCondition(f.d, ANOMALY_TEMP) == SENSOR_OK, "the API reports OK again");
+  check(eventsAre(f.d, from, ANOMALY_TEMP, {SENSOR_READ_FAILED, SENSOR_OK}), "failed reads: one read_failed, one recovery");
+  check(anomalyEventCount(f.d, ANOMALY_TEMP, SENSOR_READ_FAILED) == 1, "read_failed counted once");
+}
+
+// A dead sensor whose reads still succeed, returning zeros. They are too far from the
+// last good reading at first, and too far from the forecast once enough time has gone
+// by to allow the step; then they agree with each other and are taken as a real change,
+// by which time they have been the same too often: stuck. None of them is OK.
+static void checkZeros() {
+  AnomalyFeed f(3);
+  f.settle(SETTLE_READINGS);
+  uint32_t from = anomalyEventEnd(f.d);
+  check(f.read(ANOMALY_HUMIDITY, true, 0) == SENSOR_STEP, "the first humidity zero is a step");
+  bool ok = true;
+  for (int i = 1; i < 60; i++) ok &= f.read(ANOMALY_HUMIDITY, true, 0) != SENSOR_OK;
+  check(ok, "no humidity zero is OK");
+  check(anomalyCondition(f.d, ANOMALY_HUMIDITY) == SENSOR_STUCK, "the API reports stuck after a minute of zeros");
+  check(eventsAre(f.d, from, ANOMALY_HUMIDITY, {SENSOR_STEP, SENSOR_SPIKE, SENSOR_STUCK}),
+        "humidity zeros: step, spike, stuck");
+
+  // Back from zero, the ordinary readings are a step and a shift in turn
+  int recoveredAfter = 0;
+  for (int i = 1; i <= 30 && !recoveredAfter; i++) {
+    if (f.readNormal(ANOMALY_HUMIDITY) == SENSOR_OK) recoveredAfter = i;
+  }
+  check(recoveredAfter > 0, "ordinary humidity is OK again within 30 readings");
+  check(f.settle(SETTLE_READINGS), "and stays OK");
+  AnomalyEvent e;
+  check(anomalyEventGet(f.d, anomalyEventEnd(f.d) - 1, e) && e.type == SENSOR_OK &&
+            anomalyEventCount(f.d, ANOMALY_HUMIDITY, SENSOR_OK) == 1,
+        "one recovery event once humidity is OK");
+
+  AnomalyFeed p(7);
+  p.settle(SETTLE_READINGS);
+  ok = true;
+  for (int i = 0; i < 10; i++) ok &= p.read(ANOMALY_PRESSURE, true, 0) == SENSOR_OUT_OF_RANGE;
+  check(ok, "0 hPa is out of range");
+  check(anomalyCondition(p.d, ANOMALY_PRESSURE) == SENSOR_OUT_OF_RANGE, "the API reports out_of_range");
+  check(p.readNormal(ANOMALY_PRESSURE) == SENSOR_OK, "ordinary pressure is OK again");
+  check(eventsAre(p.d, 0, ANOMALY_PRESSURE, {SENSOR_OUT_OF_RANGE, SENSOR_OK}), "0 hPa: one out_of_range, one recovery");
+}
+
+// The same value over and over: stuck from the ANOMALY_STUCK_READINGS-th on
+static void checkFrozen() {
+  AnomalyFeed f(4);
+  f.settle(SETTLE_READINGS);
+  uint32_t from = anomalyEventEnd(f.d);
+  float frozen = f.normal(ANOMALY_TEMP);
+  bool ok = true;
+  for (int i = 1; i <= 30; i++) {
+    SensorCondition want = i >= ANOMALY_STUCK_READINGS ? SENSOR_STUCK : SENSOR_OK;
+    ok &= f.read(ANOMALY_TEMP, true, frozen) == want;
+  }
+  check(ok, "a frozen value is OK until its ANOMALY_STUCK_READINGS-th reading, then stuck");
+  check(anomalyCondition(f.d, ANOMALY_TEMP) == SENSOR_STUCK, "the API reports stuck");
+  check(f.readNormal(ANOMALY_TEMP) == SENSOR_OK, "a changed reading ends stuck");
+  check(eventsAre(f.d, from, ANOMALY_TEMP, {SENSOR_STUCK, SENSOR_OK}), "frozen value: one stuck, one recovery");
+}
+
+// Readings that change, but by less than the flat-line band, for over ANOMALY_FLAT_SEC
+static void checkFlat() {
+  AnomalyFeed f(5);
+  f.settle(SETTLE_READINGS);
+  uint32_t from = anomalyEventEnd(f.d);
+  float base = f.normal(ANOMALY_PRESSURE);
+  uint32_t startMs = f.nowMs + ANOMALY_TEST_INTERVAL_MS;
+  bool ok = true;
+  uint32_t readings = (ANOMALY_FLAT_SEC + 600) * 1000 / ANOMALY_TEST_INTERVAL_MS;
+  for (uint32_t i = 0; i < readings; i++) {
+    SensorCondition got = f.read(ANOMALY_PRESSURE, true, base + (i & 1) * 0.0003f);
+    ok &= got == (f.nowMs - startMs >= ANOMALY_FLAT_SEC * 1000 ? SENSOR_FLAT : SENSOR_OK);
+  }
+  check(ok, "a flat line is OK for ANOMALY_FLAT_SEC, then flat");
+  check(anomalyCondition(f.d, ANOMALY_PRESSURE) == SENSOR_FLAT, "the API reports flat");
+  check(f.read(ANOMALY_PRESSURE, true, base + 0.01f) == SENSOR_OK, "a reading off the line ends flat");
+  check(eventsAre(f.d, from, ANOMALY_PRESSURE, {SENSOR_FLAT, SENSOR_OK}), "flat line: one flat, one recovery");
+}
+
+// One reading further off than the room can move; then a real change, which the
+// forecast follows after ANOMALY_SHIFT_READINGS readings
+static void checkSteps() {
+  AnomalyFeed f(6);
+  f.settle(SETTLE_READINGS);
+  uint32_t from = anomalyEventEnd(f.d);
+  float jump = f.normal(ANOMALY_TEMP) + 15;
+  check(f.read(ANOMALY_TEMP, true, jump) == SENSOR_STEP, "15 degC in 5 s is a step");
+  check(anomalyCondition(f.d, ANOMALY_TEMP) == SENSOR_STEP, "the API reports the step");
+  check(f.readNormal(ANOMALY_TEMP) == SENSOR_OK, "the reading after the step is OK");
+  check(eventsAre(f.d, from, ANOMALY_TEMP, {SENSOR_STEP}), "step: one event, no recovery");
+  AnomalyEvent e;
+  check(anomalyEventGet(f.d, from, e) && e.value == jump && e.atMs == f.nowMs - ANOMALY_TEST_INTERVAL_MS,
+        "the step event carries the reading and its time");
+
+  f.settle(SETTLE_READINGS);
+  from = anomalyEventEnd(f.d);
+  float opened = f.normal(ANOMALY_TEMP) - 2;   // A window opened: 2 degC down at once
+  bool ok = true;
+  for (int i = 1; i <= 20; i++) {
+    SensorCondition want = i < ANOMALY_SHIFT_READINGS ? SENSOR_SPIKE : SENSOR_OK;
+    ok &= f.read(ANOMALY_TEMP, true, opened + 0.02f * f.noise(f.rng)) == want;
+  }
+  check(ok, "a real change is a spike for ANOMALY_SHIFT_READINGS - 1 readings, then followed");
+  check(eventsAre(f.d, from, ANOMALY_TEMP, {SENSOR_SPIKE}), "real change: one spike event");
+}
+
+int simAnomalyTest() {
+  checkNormal();
+  checkFailedReads();
+  checkZeros();
+  checkFrozen();
+  checkFlat();
+  checkSteps();
+  printf("anomaly: %s\n", g_failures ? "FAILED" : "every fault flagged, ordinary readings pass");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,580 @@
+// --api-bench: encodes /data and /history through the firmware's own printers
+// (printDataJson()/printDataCbor() and printHistoryJson()/printHistoryCbor() in main.cpp)
+// and compares the two forms. Each CBOR body is decoded and checked against the schema
+// in the README (every integer key present once, typed arrays under tags 70 and 85),
+// and against the JSON body of the same reading field by field: a value that is null in
+// the CBOR must be absent (or "N/A", or null) in the JSON, and the rest must agree. This
+// is done for a full reading and for one with every optional sensor missing, and for a
+// full, an empty and a reset /history page. Then it times the four encoders and prints
+// bytes and ns per encode; the CBOR of /data must be at least CBOR_MIN_RATIO times
+// smaller, that of /history HISTORY_CBOR_MIN_RATIO times (its JSON values are already
+// printed to 0.01). The exit code is 1 if any check fails.
+#include "cbor_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "anomaly_detector.h"
+#include "http_response.h"
+#include "pressure_trend.h"
+#include "sample_store.h"
+#include "sensor_snapshot.h"
+#include "sim.h"
+#include "sound_level.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double CBOR_MIN_RATIO = 3.0;
+const double HISTORY_CBOR_MIN_RATIO = 2.0;
+const int DATA_HISTORY_SIZE = 60;   // main.cpp
+const uint32_t SAMPLE_SPACING_S = 30;
+
+// main.cpp
+struct HistoryPoint {
+  uint32_t seq;     // Sequence number in the sample store, see sample_store.h
+  int64_t epochMs;
+  float temp;
+  float humidity;
+  float lux; // NaN without a light reading
+};
+extern SoundMeter soundMeter;
+extern bool micPresent;
+void printDataJson(const SensorSnapshot& snap, Print& out);
+void printDataCbor(const SensorSnapshot& snap, Print& out);
+SampleResume latestHistory();
+uint8_t collectHistory(const SampleResume& range, HistoryPoint (&points)[DATA_HISTORY_SIZE]);
+void printHistoryJson(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+void printHistoryCbor(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// A decoded JSON or CBOR item. CBOR map keys are kept as "#<key>"; typed arrays
+// become arrays of numbers with their tag.
+struct Item {
+  enum Kind { NONE, NUL, BOOL, NUM, TEXT, ARRAY, MAP } kind = NONE;
+  double num = 0;
+  bool flag = false;
+  bool integer = false;   // CBOR: an integer rather than a float
+  uint32_t tag = 0;
+  std::string text;
+  std::vector<Item> items;
+  std::vector<std::pair<std::string, Item>> members;
+
+  const Item* get(const std::string& key) const {
+    for (const auto& m : members)
+      if (m.first == key) return &m.second;
+    return nullptr;
+  }
+};
+
+class JsonReader {
+public:
+  explicit JsonReader(const std::string& s) : p_(s.c_str()), end_(s.c_str() + s.size()) {}
+  bool read(Item& out) {
+    bool ok = value(out);
+    ws();
+    return ok && p_ == end_;
+  }
+
+private:
+  const char* p_;
+  const char* end_;
+
+  void ws() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+  }
+  bool literal(const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end_ - p_) < n || strncmp(p_, word, n) != 0) return false;
+    p_ += n;
+    return true;
+  }
+  bool string(std::string& out) {
+    if (*p_++ != '"') return false;
+    while (p_ < end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c == '\\' && p_ < end_) {
+        c = *p_++;
+        if (c == 'n') c = '\n';
+        else if (c == 't') c = '\t';
+        else if (c == 'r') c = '\r';
+        else if (c == 'u') return false;   // The firmware's texts are ASCII
+      }
+      out += c;
+    }
+    return p_++ < end_;
+  }
+  bool value(Item& out) {
+    ws();
+    if (p_ >= end_) return false;
+    if (*p_ == '{') {
+      out.kind = Item::MAP;
+      p_++;
+      ws();
+      if (*p_ == '}') return ++p_ <= end_;
+      for (;;) {
+        ws();
+        std::pair<std::string, Item> m;
+        if (!string(m.first)) return false;
+        ws();
+        if (*p_++ != ':' || !value(m.second)) return false;
+        out.members.push_back(std::move(m));
+        ws();
+        if (*p_ == '}') return ++p_ <= end_;
+        if (*p_++ != ',') return false;
+      }
+    }
+    if (*p_ == '[') {
+      out.kind = Item::ARRAY;
+      p_++;
+      ws();
+      if (*p_ == ']') return ++p_ <= end_;
+      for (;;) {
+        out.items.emplace_back();
+        if (!value(out.items.back())) return false;
+        ws();
+        if (*p_ == ']') return ++p_ <= end_;
+        if (*p_++ != ',') return false;
+      }
+    }
+    if (*p_ == '"') {
+      out.kind = Item::TEXT;
+      return string(out.text);
+    }
+    if (literal("null")) return out.kind = Item::NUL, true;
+    if (literal("true")) return out.kind = Item::BOOL, out.flag = true, true;
+    if (literal("false")) return out.kind = Item::BOOL, out.flag = false, true;
+    char* after;
+    out.num = strtod(p_, &after);
+    if (after == p_) return false;
+    out.kind = Item::NUM;
+    p_ = after;
+    return true;
+  }
+};
+
+class CborReader {
+public:
+  CborReader(const uint8_t* data, size_t len) : p_(data), end_(data + len) {}
+  bool read(Item& out) { return item(out) && p_ == end_; }
+
+private:
+  const uint8_t* p_;
+  const uint8_t* end_;
+
+  bool arg(uint8_t info, uint64_t& v) {
+    if (info < 24) {
+      v = info;
+      return true;
+    }
+    if (info > 27) return false;   // No indefinite lengths in the firmware's output
+    size_t n = (size_t)1 << (info - 24);
+    if ((size_t)(end_ - p_) < n) return false;
+    v = 0;
+    for (size_t i = 0; i < n; i++) v = (v << 8) | *p_++;
+    return true;
+  }
+  bool item(Item& out) {
+    if (p_ >= end_) return false;
+    uint8_t major = *p_ >> 5, info = *p_ & 31;
+    p_++;
+    uint64_t v;
+    if (major == 7) {
+      if (info == 20 || info == 21) return out.kind = Item::BOOL, out.flag = info == 21, true;
+      if (info == 22) return out.kind = Item::NUL, true;
+      if (info != 26 || !arg(info, v)) return false;   // The firmware writes only float32
+      uint32_t bits = (uint32_t)v;
+      float f;
+      memcpy(&f, &bits, 4);
+      out.kind = Item::NUM;
+      out.num = f;
+      return true;
+    }
+    if (!arg(info, v)) return false;
+    switch (major) {
+      case 0:
+      case 1:
+        out.kind = Item::NUM;
+        out.integer = true;
+        out.num = major == 0 ? (double)v : -1.0 - (double)v;
+        return true;
+      case 3:
+        if ((uint64_t)(end_ - p_) < v) return false;
+        out.kind = Item::TEXT;
+        out.text.assign((const char*)p_, v);
+        p_ += v;
+        return true;
+      case 4:
+        out.kind = Item::ARRAY;
+        out.items.resize(v);
+        for (Item& i : out.items)
+          if (!item(i)) return false;
+        return true;
+      case 5:
+        out.kind = Item::MAP;
+        for (uint64_t i = 0; i < v; i++) {
+          Item key, value;
+          if (!item(key) || !key.integer || key.num < 0 || !item(value)) return false;
+          out.members.emplace_back("#" + std::to_string((uint64_t)key.num), std::move(value));
+        }
+        return true;
+      case 6:
+        return typedArray((uint32_t)v, out);
+    }
+    return false;   // Byte strings only appear behind a typed array tag
+  }
+  bool typedArray(uint32_t tag, Item& out) {
+    if (tag != CBOR_TAG_UINT32_LE && tag != CBOR_TAG_FLOAT32_LE) return false;
+    if (p_ >= end_ || (*p_ >> 5) != 2) return false;
+    uint64_t len;
+    uint8_t info = *p_++ & 31;
+    if (!arg(info, len) || len % 4 || (uint64_t)(end_ - p_) < len) return false;
+    out.kind = Item::ARRAY;
+    out.tag = tag;
+    for (uint64_t i = 0; i < len; i += 4, p_ += 4) {
+      uint32_t bits = p_[0] | (p_[1] << 8) | (p_[2] << 16) | ((uint32_t)p_[3] << 24);
+      Item n;
+      n.kind = Item::NUM;
+      if (tag == CBOR_TAG_UINT32_LE) {
+        n.num = bits;
+        n.integer = true;
+      } else {
+        float f;
+        memcpy(&f, &bits, 4);
+        n.num = f;
+      }
+      out.items.push_back(n);
+    }
+    return true;
+  }
+};
+
+static bool parseJson(const HttpBuffer& body, Item& out) {
+  return JsonReader(std::string(body.data(), body.length())).read(out) && out.kind == Item::MAP;
+}
+
+static bool parseCbor(const HttpBuffer& body, Item& out) {
+  return CborReader((const uint8_t*)body.data(), body.length()).read(out) && out.kind == Item::MAP;
+}
+
+// ArduinoJson prints floats with up to 9 significant digits; the CBOR has the float32
+static bool near(double json, double cbor, double tolerance = 0) {
+  return fabs(json - cbor) <= std::max(tolerance, 1e-5 * std::max(1.0, fabs(cbor)));
+}
+
+// A CBOR map with exactly the keys 1..keys, each once
+static bool hasKeys(const Item& map, uint8_t keys) {
+  if (map.members.size() != keys) return false;
+  for (uint8_t k = 1; k <= keys; k++)
+    if (!map.get("#" + std::to_string(k))) return false;
+  return true;
+}
+
+// --- /data ---
+
+enum FieldKind { F_NUMBER, F_TEXT, F_PRESSURE, F_HEALTH, F_SOUND };
+
+struct DataField {
+  uint8_t key;          // DataKey in main.cpp
+  const char* name;     // JSON name
+  FieldKind kind;
+  double tolerance;     // For values read again by each encoder
+};
+
+const DataField DATA_FIELDS[] = {
+  {1, "tempC", F_NUMBER, 0},
+  {2, "humidity", F_NUMBER, 0},
+  {3, "pressure_hPa", F_PRESSURE, 0},
+  {4, "state", F_NUMBER, 0},
+  {5, "uptime", F_NUMBER, 50},          // millis() when each encoder ran
+  {6, "sampled_at", F_NUMBER, 0},
+  {7, "heap_percent", F_NUMBER, 1},
+  {8, "heap_frag", F_NUMBER, 1},
+  {9, "dew_point", F_NUMBER, 0},
+  {10, "abs_humidity", F_NUMBER, 0},
+  {11, "heat_index", F_NUMBER, 0},
+  {12, "pressure_trend", F_NUMBER, 0},
+  {13, "pressure_tendency", F_TEXT, 0},
+  {14, "forecast", F_TEXT, 0},
+  {15, "forecast_text", F_TEXT, 0},
+  {16, "sensor_health", F_HEALTH, 0},
+  {17, "lux", F_NUMBER, 0},
+  {18, "sound", F_SOUND, 0},
+};
+const uint8_t DATA_KEYS = sizeof(DATA_FIELDS) / sizeof(DATA_FIELDS[0]);
+const char* const SOUND_NAMES[5] = {"la", "laeq_1s", "laeq_1min", "lamax_1min", "lzpeak_1s"};
+
+static bool sameField(const DataField& f, const Item* j, const Item& c) {
+  if (c.kind == Item::NUL) {
+    if (f.kind == F_PRESSURE) return j && j->kind == Item::TEXT && j->text == "N/A";
+    return !j;
+  }
+  if (!j) return false;
+  switch (f.kind) {
+    case F_NUMBER:
+      return j->kind == Item::NUM && c.kind == Item::NUM && near(j->num, c.num, f.tolerance);
+    case F_PRESSURE:
+      return j->kind == Item::NUM && c.integer && j->num == c.num;
+    case F_TEXT:
+      return j->kind == Item::TEXT && c.kind == Item::TEXT && j->text == c.text;
+    case F_HEALTH: {
+      if (j->kind != Item::MAP || c.kind != Item::ARRAY || c.items.size() != ANOMALY_CHANNELS) return false;
+      size_t present = 0;
+      for (uint8_t ch = 0; ch < ANOMALY_CHANNELS; ch++) {
+        const Item* name = j->get(anomalyChannelName((AnomalyChannel)ch));
+        const Item& code = c.items[ch];
+        if (code.kind == Item::NUL) {
+          if (name) return false;
+          continue;
+        }
+        if (!name || !code.integer || code.num >= SENSOR_CONDITIONS) return false;
+        if (name->text != sensorConditionName((SensorCondition)code.num)) return false;
+        present++;
+      }
+      return j->members.size() == present;
+    }
+    case F_SOUND:
+      if (j->kind != Item::MAP || c.kind != Item::ARRAY || c.items.size() != 5 || j->members.size() != 5) return false;
+      for (uint8_t i = 0; i < 5; i++) {
+        const Item* v = j->get(SOUND_NAMES[i]);
+        if (!v || !near(v->num, c.items[i].num)) return false;
+      }
+      return true;
+  }
+  return false;
+}
+
+static void checkData(const char* label, const SensorSnapshot& snap) {
+  static HttpBuffer json, cbor;
+  json.clear();
+  cbor.clear();
+  printDataJson(snap, json);
+  printDataCbor(snap, cbor);
+  Item j, c;
+  char what[128];
+  bool jsonOk = parseJson(json, j);
+  snprintf(what, sizeof(what), "/data %s: the JSON parses", label);
+  check(jsonOk, what);
+  snprintf(what, sizeof(what), "/data %s: the CBOR decodes to a map with keys 1..%u", label, DATA_KEYS);
+  bool cborOk = parseCbor(cbor, c) && hasKeys(c, DATA_KEYS);
+  check(cborOk, what);
+  if (!jsonOk || !cborOk) return;
+
+  for (const DataField& f : DATA_FIELDS) {
+    snprintf(what, sizeof(what), "/data %s: key %u matches \"%s\"", label, f.key, f.name);
+    check(sameField(f, j.get(f.name), *c.get("#" + std::to_string(f.key))), what);
+  }
+  for (const auto& m : j.members) {
+    bool known = false;
+    for (const DataField& f : DATA_FIELDS) known |= m.first == f.name;
+    snprintf(what, sizeof(what), "/data %s: JSON field \"%s\" has a CBOR key", label, m.first.c_str());
+    check(known, what);
+  }
+}
+
+// --- /history ---
+
+static bool sameSeries(const Item* j, const Item* c, uint32_t tag, size_t count) {
+  if (!j || !c || j->kind != Item::ARRAY || c->tag != tag) return false;
+  if (j->items.size() != count || c->items.size() != count) return false;
+  for (size_t i = 0; i < count; i++) {
+    const Item& a = j->items[i];
+    double b = c->items[i].num;
+    if (isnan(b) ? a.kind != Item::NUL : a.kind != Item::NUM || !near(a.num, b)) return false;
+  }
+  return true;
+}
+
+static void checkHistory(const char* label, const SampleResume& range) {
+  static HttpBuffer json, cbor;
+  static HistoryPoint points[DATA_HISTORY_SIZE];
+  uint8_t count = collectHistory(range, points);
+  json.clear();
+  cbor.clear();
+  printHistoryJson(range, points, count, json);
+  printHistoryCbor(range, points, count, cbor);
+  Item j, c;
+  char what[128];
+  bool jsonOk = parseJson(json, j);
+  snprintf(what, sizeof(what), "/history %s: the JSON parses", label);
+  check(jsonOk, what);
+  snprintf(what, sizeof(what), "/history %s: the CBOR decodes to a map with keys 1..11", label);
+  bool cborOk = parseCbor(cbor, c) && hasKeys(c, 11);
+  check(cborOk, what);
+  if (!jsonOk || !cborOk) return;
+
+  struct Scalar {
+    uint8_t key;
+    const char* name;
+  };
+  const Scalar scalars[] = {{7, "session"}, {8, "last"}, {9, "more"}, {10, "dropped"}, {11, "reset"}};
+  for (const Scalar& s : scalars) {
+    const Item* a = j.get(s.name);
+    const Item* b = c.get("#" + std::to_string(s.key));
+    snprintf(what, sizeof(what), "/history %s: key %u matches \"%s\"", label, s.key, s.name);
+    check(a && a->kind == b->kind && a->num == b->num && a->flag == b->flag, what);
+  }
+
+  snprintf(what, sizeof(what), "/history %s: %u points in both", label, count);
+  check(j.get("temps") && j.get("temps")->items.size() == count, what);
+  snprintf(what, sizeof(what), "/history %s: seqs (tag 70) match", label);
+  check(sameSeries(j.get("seqs"), c.get("#6"), CBOR_TAG_UINT32_LE, count), what);
+  snprintf(what, sizeof(what), "/history %s: temps (tag 85) match", label);
+  check(sameSeries(j.get("temps"), c.get("#3"), CBOR_TAG_FLOAT32_LE, count), what);
+  snprintf(what, sizeof(what), "/history %s: hums (tag 85) match", label);
+  check(sameSeries(j.get("hums"), c.get("#4"), CBOR_TAG_FLOAT32_LE, count), what);
+  snprintf(what, sizeof(what), "/history %s: lux (tag 85) match, NaN where the JSON has null", label);
+  check(sameSeries(j.get("lux"), c.get("#5"), CBOR_TAG_FLOAT32_LE, count), what);
+
+  // times[i] = t0 + dt[i], and the JSON labels are what a client formats from them
+  const Item* times = j.get("times");
+  const Item* labels = j.get("labels");
+  const Item* dt = c.get("#2");
+  bool timesMatch = times && labels && dt->tag == CBOR_TAG_UINT32_LE && c.get("#1")->integer &&
+                    times->items.size() == count && labels->items.size() == count && dt->items.size() == count;
+  for (uint8_t i = 0; timesMatch && i < count; i++) {
+    double t = c.get("#1")->num + dt->items[i].num;
+    time_t s = (time_t)(t / 1000);
+    char text[16];
+    strftime(text, sizeof(text), "%H:%M:%S", localtime(&s));
+    timesMatch = times->items[i].num == t && labels->items[i].text == text;
+  }
+  snprintf(what, sizeof(what), "/history %s: t0 + dt give the times and labels", label);
+  check(timesMatch, what);
+}
+
+// --- Timing ---
+
+// Runs encode() until BENCH_MIN_SEC have gone by; ns per call, and the body size
+template <typename Encode>
+static double timeEncode(Encode encode, size_t& bytes) {
+  static HttpBuffer out;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t runs = 0;
+  do {
+    for (int i = 0; i < 100; i++) {
+      out.clear();
+      encode(out);
+    }
+    runs += 100;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  bytes = out.length();
+  return elapsed * 1e9 / runs;
+}
+
+static void fillStore() {
+  sampleStoreBegin(7);
+  uint32_t epoch = 1700000000;
+  for (uint32_t i = 0; i < 2 * DATA_HISTORY_SIZE; i++) {
+    uint16_t flags = SAMPLE_TEMP_OK | SAMPLE_PRESSURE_OK | SAMPLE_TIME_SYNCED;
+    if (i % 17 != 3) flags |= SAMPLE_LIGHT_OK;     // Now and then no light reading
+    if (i % 29 == 5) flags |= SAMPLE_TEMP_SUSPECT;   // Left out of the chart
+    uint16_t luxCount = (uint16_t)(380 + 120 * sin(i * 0.05));   // BH1750 counts, 1.2 per lx
+    sampleStoreAdd(i * SAMPLE_SPACING_S * 1000, epoch + i * SAMPLE_SPACING_S, 21.0f + (i % 50) * 0.07f,
+                   40.0f + (i % 30) * 0.33f, 1012.4f, luxCount / 1.2f, NAN, NAN, flags);
+  }
+}
+
+static SensorSnapshot fullReading() {
+  SensorSnapshot s = {};
+  s.version = 1;
+  s.sampledAt = millis();
+  s.epochMs = 1700003600123LL;
+  s.tempC = 23.41f;
+  s.humidity = 48.7f;
+  s.pressureHpa = 1013.6f;
+  s.state = 1;
+  s.tempOk = true;
+  s.pressureOk = true;
+  s.conditions[ANOMALY_HUMIDITY] = SENSOR_FLAT;
+  s.forecast.valid = true;
+  s.forecast.changePer3h = -1.85f;
+  s.forecast.seaLevelHpa = 1015.2f;
+  s.forecast.tendency = PT_FALLING;
+  s.forecast.letter = 'N';
+  s.lux = 312.5f;
+  return s;
+}
+
+// No BMP280, no BH1750, no microphone, a failed AHT20 read and no forecast yet
+static SensorSnapshot sparseReading() {
+  SensorSnapshot s = {};
+  s.version = 1;
+  s.sampledAt = millis();
+  s.tempC = 0;   // What readSensors() leaves after a failed read
+  s.humidity = 0;
+  s.pressureHpa = -1;
+  s.conditions[ANOMALY_TEMP] = SENSOR_READ_FAILED;
+  s.conditions[ANOMALY_HUMIDITY] = SENSOR_READ_FAILED;
+  s.lux = NAN;
+  return s;
+}
+
+// Runs a second of a 1 kHz tone through the firmware's sound meter, so /data has levels
+static void startSoundMeter() {
+  soundMeterBegin(soundMeter);
+  static int32_t block[SOUND_BLOCK_SAMPLES];
+  for (uint8_t b = 0; b < SOUND_BLOCKS_PER_SEC; b++) {
+    for (uint16_t i = 0; i < SOUND_BLOCK_SAMPLES; i++) {
+      block[i] = (int32_t)(200000 * sin(2 * M_PI * 1000 * (b * SOUND_BLOCK_SAMPLES + i) / 16000.0));
+    }
+    soundMeterProcess(soundMeter, block, SOUND_BLOCK_SAMPLES);
+  }
+  micPresent = soundMeterLevels(soundMeter).valid;
+}
+
+int simApiBench() {
+  simClockInit(1);
+  fillStore();
+
+  micPresent = false;
+  checkData("sparse reading", sparseReading());
+  startSoundMeter();
+  check(micPresent, "the sound meter has levels after a second of tone");
+  SensorSnapshot full = fullReading();
+  checkData("full reading", full);
+
+  SampleResume page = latestHistory();
+  checkHistory("latest page", page);
+  checkHistory("empty page", sampleStoreResume(sampleStoreSession(), sampleSeq(sampleStoreEnd() - 1), DATA_HISTORY_SIZE));
+  checkHistory("after a restart", sampleStoreResume(sampleStoreSession() + 1, 10, DATA_HISTORY_SIZE));
+  if (g_failures) {
+    printf("api: FAILED (JSON and CBOR disagree)\n");
+    return 1;
+  }
+
+  static HistoryPoint points[DATA_HISTORY_SIZE];
+  uint8_t count = collectHistory(page, points);
+  const char* names[4] = {"/data JSON", "/data CBOR", "/history JSON", "/history CBOR"};
+  size_t bytes[4];
+  double ns[4];
+  ns[0] = timeEncode([&](Print& out) { printDataJson(full, out); }, bytes[0]);
+  ns[1] = timeEncode([&](Print& out) { printDataCbor(full, out); }, bytes[1]);
+  ns[2] = timeEncode([&](Print& out) { printHistoryJson(page, points, count, out); }, bytes[2]);
+  ns[3] = timeEncode([&](Print& out) { printHistoryCbor(page, points, count, out); }, bytes[3]);
+  for (uint8_t k = 0; k < 4; k++) {
+    printf("  %-14s %5u bytes %9.0f ns/encode (host)\n", names[k], (unsigned)bytes[k], ns[k]);
+  }
+  printf("  /history has %u points; size ratio JSON/CBOR: /data %.2fx, /history %.2fx\n", count,
+         (double)bytes[0] / bytes[1], (double)bytes[2] / bytes[3]);
+  check(bytes[0] >= CBOR_MIN_RATIO * bytes[1], "/data: CBOR at least 3x smaller than the JSON");
+  check(bytes[2] >= HISTORY_CBOR_MIN_RATIO * bytes[3], "/history: CBOR at least 2x smaller than the JSON");
+  printf("api: %s\n", g_failures ? "FAILED" : "CBOR matches the JSON field by field and is 2-3x smaller or better");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+// Virtual clock, GPIO, Serial, ESP and time functions for the host build.
+#include <Arduino.h>
+
+#include <errno.h>
+#include <esp_system.h>
+#include <malloc.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "sim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// --------------------------------------------------------------------------------
+// Virtual clock
+// --------------------------------------------------------------------------------
+static std::chrono::steady_clock::time_point g_clockStart = std::chrono::steady_clock::now();
+static double g_speed = 1.0;
+static std::atomic<bool> g_stepped(false);
+static std::atomic<uint64_t> g_steppedUs(0);
+
+void simClockInit(double speed) {
+  g_stepped = false;
+  g_clockStart = std::chrono::steady_clock::now();
+  g_speed = speed > 0 ? speed : 1.0;
+}
+
+void simClockStep() {
+  g_steppedUs = simMicros64();
+  g_stepped = true;
+}
+
+bool simClockStepped() { return g_stepped; }
+
+double simSpeed() { return g_speed; }
+
+uint64_t simMicros64() {
+  if (g_stepped) return g_steppedUs;
+  auto real = std::chrono::steady_clock::now() - g_clockStart;
+  double us = std::chrono::duration<double, std::micro>(real).count();
+  return (uint64_t)(us * g_speed);
+}
+
+void simSleepMicros(uint64_t us) {
+  if (g_stepped) {
+    g_steppedUs += us;
+    return;
+  }
+  if (us == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double, std::micro>((double)us / g_speed));
+}
+
+unsigned long millis() { return (unsigned long)(simMicros64() / 1000ULL); }
+unsigned long micros() { return (unsigned long)simMicros64(); }
+void delay(uint32_t ms) { simSleepMicros((uint64_t)ms * 1000ULL); }
+void delayMicroseconds(uint32_t us) { simSleepMicros(us); }
+void yield() { std::this_thread::yield(); }
+
+// --------------------------------------------------------------------------------
+// GPIO
+// --------------------------------------------------------------------------------
+static const int SIM_PIN_COUNT = 32;
+static std::atomic<int> g_pins[SIM_PIN_COUNT];
+static void (*g_isr[SIM_PIN_COUNT])(void);
+static int g_isrMode[SIM_PIN_COUNT];
+static std::mutex g_pinMutex;
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+
+int digitalRead(uint8_t pin) { return pin < SIM_PIN_COUNT ? g_pins[pin].load() : LOW; }
+
+void simI2CPinWritten(uint8_t pin, uint8_t val); // sim_wire.cpp: bus recovery clocks
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < SIM_PIN_COUNT) g_pins[pin] = val ? HIGH : LOW;
+  simI2CPinWritten(pin, val);
+}
+
+int analogRead(uint8_t pin) { return digitalRead(pin) ? 4095 : 0; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  std::lock_guard<std::mutex> lock(g_pinMutex);
+  if (pin >= SIM_PIN_COUNT) return;
+  g_isr[pin] = isr;
+  g_isrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(g_pinMutex);
+  if (pin < SIM_PIN_COUNT) g_isr[pin] = nullptr;
+}
+
+void simSetPin(uint8_t pin, int level) {
+  if (pin >= SIM_PIN_COUNT) return;
+  int old = g_pins[pin].exchange(level ? HIGH : LOW);
+  void (*isr)(void) = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(g_pinMutex);
+    if (old != level && g_isr[pin]) {
+      int mode = g_isrMode[pin];
+      if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) isr = g_isr[pin];
+    }
+  }
+  if (isr) isr();
+}
+
+int simGetPin(uint8_t pin) { return digitalRead(pin); }
+
+void simPulsePin(uint8_t pin, uint32_t ms) {
+  std::thread([pin, ms]() {
+    simSetPin(pin, HIGH);
+    simSleepMicros((uint64_t)ms * 1000ULL);
+    simSetPin(pin, LOW);
+  }).detach();
+}
+
+// --------------------------------------------------------------------------------
+// LEDC / buzzer
+// --------------------------------------------------------------------------------
+static std::atomic<uint32_t> g_buzzerFreq(0);
+
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) {
+  (void)channel; (void)resolution_bits;
+  return freq;
+}
+void ledcAttachPin(uint8_t pin, uint8_t channel) { (void)pin; (void)channel; }
+void ledcDetachPin(uint8_t pin) { (void)pin; g_buzzerFreq = 0; }
+double ledcWriteTone(uint8_t channel, double freq) {
+  (void)channel;
+  g_buzzerFreq = (uint32_t)freq;
+  return freq;
+}
+void ledcWrite(uint8_t channel, uint32_t duty) { (void)channel; (void)duty; }
+uint32_t simBuzzerFrequency() { return g_buzzerFreq; }
+
+// --------------------------------------------------------------------------------
+// Random
+// --------------------------------------------------------------------------------
+static std::mt19937 g_rng(12345);
+static std::mutex g_rngMutex;
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  std::lock_guard<std::mutex> lock(g_rngMutex);
+  return (long)(g_rng() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  std::lock_guard<std::mutex> lock(g_rngMutex);
+  g_rng.seed((uint32_t)seed);
+}
+
+// --------------------------------------------------------------------------------
+// Serial
+// --------------------------------------------------------------------------------
+size_t HardwareSerial::write(uint8_t c) {
+  fputc(c, stdout);
+  if (c == '\n') fflush(stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  fwrite(buffer, 1, size, stdout);
+  fflush(stdout);
+  return size;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char stackBuf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(stackBuf)) return write((const uint8_t*)stackBuf, (size_t)len);
+  char* heapBuf = (char*)malloc((size_t)len + 1);
+  if (!heapBuf) return 0;
+  va_start(args, format);
+  vsnprintf(heapBuf, (size_t)len + 1, format, args);
+  va_end(args);
+  size_t n = write((const uint8_t*)heapBuf, (size_t)len);
+  free(heapBuf);
+  return n;
+}
+
+// --------------------------------------------------------------------------------
+// ESP (heap figures come from the host allocator so allocation trends stay visible)
+// --------------------------------------------------------------------------------
+static const uint32_t SIM_HEAP_SIZE = 327680;
+static uint32_t g_baseAllocated = 0;
+static std::atomic<uint32_t> g_minFree(SIM_HEAP_SIZE);
+
+static uint32_t simHeapUsed() {
+  struct mallinfo2 mi = mallinfo2();
+  uint32_t used = (uint32_t)mi.uordblks;
+  if (g_baseAllocated == 0) g_baseAllocated = used;
+  uint32_t delta = used > g_baseAllocated ? used - g_baseAllocated : 0;
+  // Pretend the core and Wi-Fi stack already hold ~90 KB, as on the device.
+  uint32_t total = 90 * 1024 + delta;
+  return total < SIM_HEAP_SIZE ? total : SIM_HEAP_SIZE;
+}
+
+uint32_t EspClass::getHeapSize() { return SIM_HEAP_SIZE; }
+
+uint32_t EspClass::getFreeHeap() {
+  uint32_t freeBytes = SIM_HEAP_SIZE - simHeapUsed();
+  uint32_t prev = g_minFree.load();
+  while (freeBytes < prev && !g_minFree.compare_exchange_weak(prev, freeBytes)) {
+  }
+  return freeBytes;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  getFreeHeap();
+  return g_minFree.load();
+}
+
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap() * 9 / 10; }
+
+uint32_t EspClass::getCycleCount() { return (uint32_t)(simMicros64() * 160ULL); }
+
+static int g_argc = 0;
+static char** g_argv = nullptr;
+
+void simSetArgs(int argc, char** argv) {
+  g_argc = argc;
+  g_argv = argv;
+}
+
+void EspClass::restart() { simReset(ESP_RST_SW, "ESP.restart()"); }
+
+// --------------------------------------------------------------------------------
+// Resets. RTC_NOINIT_ATTR variables share one section, which is written to the state
+// directory before the firmware is re-executed and read back before setup(). The
+// reason travels in the environment.
+// --------------------------------------------------------------------------------
+extern char __start_rtc_noinit[] __attribute__((weak));
+extern char __stop_rtc_noinit[] __attribute__((weak));
+static const char* RESET_REASON_ENV = "SIM_RESET_REASON";
+static esp_reset_reason_t g_resetReason = ESP_RST_POWERON;
+
+esp_reset_reason_t esp_reset_reason() { return g_resetReason; }
+
+uint32_t esp_random() {
+  static std::random_device rd;
+  return rd();
+}
+
+void simReset(int reason, const char* what) {
+  fflush(stdout);
+  printf("\n[sim] %s -> re-executing firmware\n", what);
+  fflush(stdout);
+  size_t rtcBytes = __start_rtc_noinit ? (size_t)(__stop_rtc_noinit - __start_rtc_noinit) : 0;
+  if (rtcBytes) {
+    FILE* f = fopen(simStatePath("rtc_noinit.bin").c_str(), "wb");
+    if (f) {
+      fwrite(__start_rtc_noinit, 1, rtcBytes, f);
+      fclose(f);
+    }
+  }
+  char value[8];
+  snprintf(value, sizeof(value), "%d", reason);
+  setenv(RESET_REASON_ENV, value, 1);
+  if (g_argv) execv("/proc/self/exe", g_argv);
+  _exit(3);
+}
+
+static void onCrashSignal(int sig) {
+  signal(sig, SIG_DFL);
+  char what[48];
+  snprintf(what, sizeof(what), "Guru Meditation (signal %d)", sig);
+  simReset(ESP_RST_PANIC, what);
+}
+
+void simResetBoot() {
+  const char* reason = getenv(RESET_REASON_ENV);
+  if (reason) {
+    g_resetReason = (esp_reset_reason_t)atoi(reason);
+    unsetenv(RESET_REASON_ENV);
+  }
+  // Power-on: RTC memory holds whatever it powers up with. A new process starts
+  // with zeros, which is close enough.
+  size_t rtcBytes = __start_rtc_noinit ? (size_t)(__stop_rtc_noinit - __start_rtc_noinit) : 0;
+  if (rtcBytes && g_resetReason != ESP_RST_POWERON) {
+    FILE* f = fopen(simStatePath("rtc_noinit.bin").c_str(), "rb");
+    if (f) {
+      if (fread(__start_rtc_noinit, 1, rtcBytes, f) != rtcBytes) memset(__start_rtc_noinit, 0, rtcBytes);
+      fclose(f);
+    }
+  }
+  signal(SIGSEGV, onCrashSignal);
+  signal(SIGABRT, onCrashSignal);
+  signal(SIGFPE, onCrashSignal);
+  signal(SIGILL, onCrashSignal);
+  signal(SIGBUS, onCrashSignal);
+}
+
+// --------------------------------------------------------------------------------
+// Time (esp32-hal-time). "NTP" is the host clock, available immediately.
+// --------------------------------------------------------------------------------
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2, const char* server3) {
+  (void)server1; (void)server2; (void)server3;
+  // Same TZ string construction as the ESP32 core.
+  char cst[32] = {0};
+  char cdt[32] = "DST";
+  char tz[64] = {0};
+  if (gmtOffset_sec % 3600) {
+    snprintf(cst, sizeof(cst), "UTC%ld:%02u:%02u", gmtOffset_sec / 3600,
+             (unsigned)abs((int)((gmtOffset_sec % 3600) / 60)), (unsigned)abs((int)(gmtOffset_sec % 60)));
+  } else {
+    snprintf(cst, sizeof(cst), "UTC%ld", gmtOffset_sec / 3600);
+  }
+  if (daylightOffset_sec != 3600) {
+    long tz_dst = gmtOffset_sec - daylightOffset_sec;
+    if (tz_dst % 3600) {
+      snprintf(cdt, sizeof(cdt), "DST%ld:%02u:%02u", tz_dst / 3600,
+               (unsigned)abs((int)((tz_dst % 3600) / 60)), (unsigned)abs((int)(tz_dst % 60)));
+    } else {
+      snprintf(cdt, sizeof(cdt), "DST%ld", tz_dst / 3600);
+    }
+  }
+  snprintf(tz, sizeof(tz), "%s%s", cst, cdt);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  (void)ms;
+  time_t now = time(nullptr);
+  localtime_r(&now, info);
+  return info->tm_year > (2016 - 1900);
+}
+
+// --------------------------------------------------------------------------------
+// State directory
+// --------------------------------------------------------------------------------
+static String g_stateDir = "sim_state";
+
+void simSetStateDir(const char* dir) { g_stateDir = dir; }
+
+String simStatePath(const char* name) {
+  mkdir(g_stateDir.c_str(), 0755);
+  return g_stateDir + "/" + name;
+}
+
+// --------------------------------------------------------------------------------
+// Wall clock. time() and gettimeofday() follow the virtual clock so that a sped-up
+// run sees NTP time (alarms, quiet hours, daily cycles) advance at the same rate.
+// --------------------------------------------------------------------------------
+#include <sys/time.h>
+
+static time_t g_epochAtStart = 0;
+
+static uint64_t simEpochMicros() {
+  if (g_epochAtStart == 0) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    g_epochAtStart = ts.tv_sec;
+  }
+  return (uint64_t)g_epochAtStart * 1000000ULL + simMicros64();
+}
+
+extern "C" time_t time(time_t* out) {
+  time_t now = (time_t)(simEpochMicros() / 1000000ULL);
+  if (out) *out = now;
+  return now;
+}
+
+extern "C" int gettimeofday(struct timeval* tv, void* tz) {
+  (void)tz;
+  uint64_t us = simEpochMicros();
+  tv->tv_sec = (time_t)(us / 1000000ULL);
+  tv->tv_usec = (suseconds_t)(us % 1000000ULL);
+  return 0;
+}
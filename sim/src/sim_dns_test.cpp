@@ -0,0 +1,104 @@
+// --dns-test: host checks of the captive portal's DNS answers (captive_dns.h): an A
+// query gets the portal's address, other types an empty NOERROR answer, and malformed
+// or unexpected messages (too short, a response, another opcode, two questions, a
+// compressed or overlong name, a truncated question) get nothing. The exit code is 1 if
+// any check fails.
+#include "captive_dns.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "sim.h"
+
+static const uint8_t PORTAL_IP[4] = {192, 168, 4, 1};
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// A standard query for name with one question of qtype, recursion desired
+static std::string query(const char* name, uint16_t qtype, uint16_t id = 0x1234) {
+  std::string q = {(char)(id >> 8), (char)(id & 0xFF), 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+  const char* label = name;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    size_t n = dot ? (size_t)(dot - label) : strlen(label);
+    q += (char)n;
+    q.append(label, n);
+    label += n + (dot ? 1 : 0);
+  }
+  q += '\0';
+  q += (char)(qtype >> 8);
+  q += (char)(qtype & 0xFF);
+  q += '\0';
+  q += '\1';
+  return q;
+}
+
+static size_t reply(const std::string& q, uint8_t* out, size_t size = CAPTIVE_DNS_MAX_PACKET) {
+  return captiveDnsReply((const uint8_t*)q.data(), q.size(), PORTAL_IP, out, size);
+}
+
+static void checkAnswers() {
+  uint8_t out[CAPTIVE_DNS_MAX_PACKET];
+  std::string q = query("connectivitycheck.gstatic.com", 1, 0xBEEF);
+  size_t n = reply(q, out);
+  check(n == q.size() + 16, "A query: question plus one answer");
+  check(out[0] == 0xBE && out[1] == 0xEF, "A query: id echoed");
+  check(out[2] == 0x85 && out[3] == 0x80, "A query: response, authoritative, RD kept, NOERROR");
+  check(out[7] == 1 && out[9] == 0 && out[11] == 0, "A query: one answer, no other records");
+  check(memcmp(out + 12, q.data() + 12, q.size() - 12) == 0, "A query: question echoed");
+  const uint8_t* a = out + q.size();
+  const uint8_t expected[16] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 192, 168, 4, 1};
+  check(memcmp(a, expected, 16) == 0, "A query: answer points at the portal");
+
+  n = reply(query("captive.apple.com", 28), out);
+  check(n == query("captive.apple.com", 28).size() && out[7] == 0 && out[3] == 0x80, "AAAA query: empty NOERROR");
+
+  // EDNS: the OPT record after the question is not echoed
+  q = query("example.com", 1);
+  q[11] = 1;
+  q += std::string("\0\0\x29\x10\0\0\0\0\0\0\0", 11);
+  n = reply(q, out);
+  check(n == q.size() - 11 + 16 && out[11] == 0, "EDNS query: OPT record dropped");
+}
+
+static void checkRejected() {
+  uint8_t out[CAPTIVE_DNS_MAX_PACKET];
+  std::string q = query("example.com", 1);
+  check(reply(q.substr(0, 11), out) == 0, "short header");
+  check(reply(q.substr(0, q.size() - 1), out) == 0, "truncated question");
+  check(reply(q.substr(0, 16), out) == 0, "name running off the end");
+
+  std::string r = q;
+  r[2] |= 0x80;
+  check(reply(r, out) == 0, "a response");
+  r = q;
+  r[2] |= 0x10;   // Opcode 2, status
+  check(reply(r, out) == 0, "another opcode");
+  r = q;
+  r[5] = 2;
+  check(reply(r, out) == 0, "two questions");
+  r = q;
+  r[12] = (char)0xC0;   // A compression pointer in the question
+  check(reply(r, out) == 0, "compressed name");
+
+  std::string longName;
+  for (int i = 0; i < 5; i++) longName += std::string(60, 'a') + ".";
+  longName += "com";
+  check(reply(query(longName.c_str(), 1), out) == 0, "name longer than 255 bytes");
+  check(reply(q, out, q.size() + 15) == 0, "no room for the answer");
+}
+
+int simDnsTest() {
+  checkAnswers();
+  checkRejected();
+  printf("captive DNS: %s\n", g_failures ? "FAILED" : "answers and rejections as expected");
+  return g_failures ? 1 : 0;
+}
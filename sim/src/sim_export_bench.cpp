@@ -0,0 +1,178 @@
+// --export-bench: streams a full sample store through the /export path as the web
+// server does: httpSendStream() with exportNext() as the producer, its chunked
+// response drained in socket-sized pieces until the producer is done. Checks each
+// export's lines (header and one record per sample), that the stream's pool slot goes
+// back to the pool when the body ends or the client drops half-way, and the rate,
+// which must stay above EXPORT_MIN_MB_PER_S. The exit code is 1 if any check fails.
+#include "sample_export.h"
+
+#include <ESPAsyncWebServer.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "http_response.h"
+#include "sample_store.h"
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double EXPORT_MIN_MB_PER_S = 1.0;
+const size_t SOCKET_CHUNK = 2860 - 12;        // What AsyncTCP offers per ack, less the chunk framing
+const uint32_t FIRST_EPOCH = 1700000000;
+const uint32_t SAMPLE_SPACING_S = 42;
+const uint16_t ALL_OK = SAMPLE_TEMP_OK | SAMPLE_PRESSURE_OK | SAMPLE_LIGHT_OK | SAMPLE_SOUND_OK;
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+static void fillStore() {
+  sampleStoreBegin(1);
+  for (uint32_t i = 0; i < SAMPLE_STORE_CAPACITY; i++) {
+    float t = 21.0f + 3.0f * sinf(i * 0.01f);
+    sampleStoreAdd(i * SAMPLE_SPACING_S * 1000, FIRST_EPOCH + i * SAMPLE_SPACING_S, t, 45.0f + (i % 17) * 0.5f,
+                   1009.0f + (i % 40) * 0.1f, 120.0f + (i % 300), 38.5f + (i % 9), 52.0f + (i % 11), ALL_OK);
+  }
+}
+
+// Starts an export the way handleExport() does and returns the request holding its response
+static AsyncWebServerRequest* startExport(ExportFormat format) {
+  AsyncWebServerRequest* request = new AsyncWebServerRequest();
+  uint32_t state[HTTP_STREAM_STATE_WORDS];
+  exportBegin(state, format, 0, 0);
+  httpSendStream(request, exportContentType(format), exportNext, state);
+  return request;
+}
+
+// The connection closing, as the sim's event loop does it
+static void closeRequest(AsyncWebServerRequest* request) {
+  if (request->onDisconnect_) request->onDisconnect_();
+  delete request;
+}
+
+// Drains the response into body (if given); returns the body length
+static size_t drain(AsyncWebServerRequest* request, std::string* body) {
+  AsyncWebServerResponse* response = request->simResponse();
+  if (!response) return 0;
+  uint8_t buf[SOCKET_CHUNK];
+  size_t total = 0, n;
+  while ((n = response->fill(buf, sizeof(buf))) != 0) {
+    if (n == RESPONSE_TRY_AGAIN) continue;
+    total += n;
+    if (body) body->append((const char*)buf, n);
+  }
+  return total;
+}
+
+static uint32_t countLines(const std::string& body, char first, char last, uint32_t& malformed) {
+  uint32_t lines = 0;
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t end = body.find('\n', pos);
+    if (end == std::string::npos) {
+      malformed++;
+      break;
+    }
+    if (first && (body[pos] != first || body[end - 1] != last)) malformed++;
+    lines++;
+    pos = end + 1;
+  }
+  return lines;
+}
+
+static void checkContent() {
+  AsyncWebServerRequest* request = startExport(EXPORT_CSV);
+  check(request->simResponse() && request->simResponse()->chunked(), "CSV: a chunked response");
+  check(httpGetStats().inUse == 1, "CSV: the stream holds one pool slot");
+  std::string body;
+  drain(request, &body);
+  check(httpGetStats().inUse == 0, "CSV: the slot is back once the body ends");
+  closeRequest(request);
+
+  uint32_t malformed = 0;
+  check(body.compare(0, 5, "time,") == 0, "CSV: starts with the header line");
+  check(countLines(body, 0, 0, malformed) == SAMPLE_STORE_CAPACITY + 1 && !malformed,
+        "CSV: the header and one line per stored sample");
+  size_t firstRecord = body.find('\n') + 1;
+  size_t commas = 0;
+  for (size_t i = 0; i < firstRecord; i++) commas += body[i] == ',';
+  size_t recordCommas = 0;
+  for (size_t i = firstRecord; body[i] != '\n'; i++) recordCommas += body[i] == ',';
+  check(commas == recordCommas, "CSV: records have as many fields as the header");
+
+  request = startExport(EXPORT_NDJSON);
+  body.clear();
+  drain(request, &body);
+  closeRequest(request);
+  malformed = 0;
+  check(countLines(body, '{', '}', malformed) == SAMPLE_STORE_CAPACITY && !malformed,
+        "NDJSON: one object per line, one line per stored sample");
+  check(httpGetStats().inUse == 0, "NDJSON: the slot is back once the body ends");
+}
+
+static void checkDroppedClient() {
+  AsyncWebServerRequest* request = startExport(EXPORT_CSV);
+  uint8_t buf[SOCKET_CHUNK];
+  request->simResponse()->fill(buf, sizeof(buf));
+  request->simResponse()->fill(buf, sizeof(buf));
+  check(httpGetStats().inUse == 1, "dropped client: slot held while the body is unfinished");
+  closeRequest(request);
+  check(httpGetStats().inUse == 0, "dropped client: slot back after the disconnect");
+
+  // Every slot streaming at once: one more request is turned away, and all come back
+  AsyncWebServerRequest* requests[HTTP_POOL_SLOTS];
+  for (uint8_t i = 0; i < HTTP_POOL_SLOTS; i++) requests[i] = startExport(EXPORT_NDJSON);
+  uint32_t exhausted = httpGetStats().exhausted;
+  AsyncWebServerRequest* extra = startExport(EXPORT_NDJSON);
+  check(extra->simResponse() && extra->simResponse()->code() == 503, "pool full: the next export gets 503");
+  check(httpGetStats().exhausted == exhausted + 1, "pool full: counted as exhausted");
+  closeRequest(extra);
+  for (uint8_t i = 0; i < HTTP_POOL_SLOTS; i++) {
+    drain(requests[i], nullptr);
+    closeRequest(requests[i]);
+  }
+  check(httpGetStats().inUse == 0, "pool full: every slot back after the exports end");
+}
+
+// Whole exports back to back until BENCH_MIN_SEC have gone by; MB/s
+static double timeExports(ExportFormat format, size_t& bytesPerExport) {
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t bytes = 0;
+  do {
+    AsyncWebServerRequest* request = startExport(format);
+    bytesPerExport = drain(request, nullptr);
+    closeRequest(request);
+    bytes += bytesPerExport;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return bytes / elapsed / 1e6;
+}
+
+int simExportBench() {
+  fillStore();
+  checkContent();
+  checkDroppedClient();
+
+  const char* names[2] = {"CSV", "NDJSON"};
+  for (uint8_t f = 0; f < 2; f++) {
+    size_t bytes = 0;
+    double mbPerS = timeExports((ExportFormat)f, bytes);
+    printf("  %-6s %u samples, %7u bytes per export, %7.1f MB/s (host)\n", names[f], (unsigned)SAMPLE_STORE_CAPACITY,
+           (unsigned)bytes, mbPerS);
+    char what[64];
+    snprintf(what, sizeof(what), "%s: at least %.0f MB/s", names[f], EXPORT_MIN_MB_PER_S);
+    check(mbPerS >= EXPORT_MIN_MB_PER_S, what);
+  }
+  check(httpGetStats().inUse == 0, "no pool slot left in use");
+  printf("export: %s\n", g_failures ? "FAILED" : "complete exports, slots returned, rate above the floor");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// --eye-bench: checks the precomputed Big Eyes frames (eye_frames.h, generated by
+// tools/gen_eye_frames.py) against the firmware's reference GFX path, drawEyesGfx() in
+// main.cpp, pixel for pixel on a rotated SSD1306 buffer, then times showing a frame
+// both ways: the 1 KB memcpy_P() of the sprite path against clearing the buffer and
+// drawing the expression with GFX primitives. The exit code is 1 if any frame differs.
+#include "eye_frames.h"
+
+#include <Adafruit_SSD1306.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+
+// main.cpp
+void drawEyesGfx(Adafruit_GFX& gfx, uint8_t state, uint8_t direction);
+
+static const char* const STATE_NAMES[EYE_FRAME_STATES] = {"HAPPY", "ALERT_HIGH", "ALERT_LOW", "TOUCHED"};
+static const char* const DIRECTION_NAMES[EYE_FRAME_DIRECTIONS] = {"CENTER", "UP", "DOWN", "LEFT", "RIGHT"};
+
+// Pixels that differ between two page-layout frames
+static uint32_t differingPixels(const uint8_t* a, const uint8_t* b) {
+  uint32_t n = 0;
+  for (size_t i = 0; i < EYE_FRAME_BYTES; i++) n += __builtin_popcount(a[i] ^ b[i]);
+  return n;
+}
+
+// Runs show(state, direction) over all frames until BENCH_MIN_SEC have gone by; ns per frame
+template <typename Show>
+static double timePerFrame(const uint8_t* buffer, Show show) {
+  const uint32_t frames = EYE_FRAME_STATES * EYE_FRAME_DIRECTIONS;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t shown = 0;
+  volatile uint8_t sink = 0;   // Reads the buffer so the copies are not optimized away
+  do {
+    for (uint8_t row = 0; row < EYE_FRAME_STATES; row++) {
+      for (uint8_t col = 0; col < EYE_FRAME_DIRECTIONS; col++) {
+        show(row, col);
+        sink = sink + buffer[(row * 131 + col * 17) % EYE_FRAME_BYTES];
+      }
+    }
+    shown += frames;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return elapsed * 1e9 / shown;
+}
+
+int simEyeBench() {
+  Adafruit_SSD1306 gfx(128, 64);
+  if (!gfx.begin(SSD1306_SWITCHCAPVCC, 0x3C)) return 1;
+  gfx.setRotation(EYE_FRAME_ROTATION);
+  uint8_t* buffer = gfx.getBuffer();
+
+  int failures = 0;
+  for (uint8_t row = 0; row < EYE_FRAME_STATES; row++) {
+    for (uint8_t col = 0; col < EYE_FRAME_DIRECTIONS; col++) {
+      gfx.clearDisplay();
+      drawEyesGfx(gfx, row, col);
+      uint32_t diff = differingPixels(buffer, EYE_FRAMES[row][col]);
+      if (diff) {
+        printf("  FAIL %s/%s: %u pixels differ from the GFX rendering\n", STATE_NAMES[row], DIRECTION_NAMES[col],
+               (unsigned)diff);
+        failures++;
+      }
+    }
+  }
+  printf("eye frames: %s\n", failures ? "FAILED (re-run tools/gen_eye_frames.py or fix its geometry)"
+                                      : "all 20 match the GFX rendering pixel for pixel");
+  if (failures) return 1;
+
+  double blitNs = timePerFrame(buffer, [&](uint8_t row, uint8_t col) {
+    memcpy_P(buffer, EYE_FRAMES[row][col], EYE_FRAME_BYTES);
+  });
+  double gfxNs = timePerFrame(buffer, [&](uint8_t row, uint8_t col) {
+    gfx.clearDisplay();
+    drawEyesGfx(gfx, row, col);
+  });
+  printf("  sprite blit (memcpy_P)   %9.1f ns/frame\n", blitNs);
+  printf("  GFX clear + draw         %9.1f ns/frame  (%.0fx the blit, host)\n", gfxNs, gfxNs / blitNs);
+  return 0;
+}
@@ -0,0 +1,237 @@
+// --eye-test: host checks of the eye animator (eye_animator.h) against a plain
+// framebuffer, with the clock driven by the test. Checks the key frames: every resting
+// expression and gaze against the firmware's GFX drawing (drawEyesGfx() in main.cpp),
+// pupils part-way through eased moves against GFX circles at the expected offset, both
+// ends and the middle of a cross-fade, and a blink closing and opening again. Then the
+// frame slots: a slot that finds the bus busy (i2cBusBusy() in loop()) is dropped, not
+// retried, and slots the loop slept through are counted as dropped. The exit code is 1
+// if any check fails.
+#include "eye_animator.h"
+
+#include <Adafruit_SSD1306.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "eye_frames.h"
+#include "sim.h"
+
+const uint16_t FPS = 30;
+const uint32_t FRAME_MS = 33;      // (1000 + FPS / 2) / FPS, as eyeAnimBegin() rounds it
+const uint32_t FADE_MS = 240;      // eye_animator.cpp
+const uint32_t BLINK_CLOSE_MS = 70;
+const uint32_t BLINK_HOLD_MS = 40;
+const uint32_t BLINK_OPEN_MS = 90;
+const uint8_t LOOK_RIGHT = 4;       // EYES_RIGHT in main.cpp
+
+// main.cpp
+void drawEyesGfx(Adafruit_GFX& gfx, uint8_t state, uint8_t direction);
+
+static uint8_t g_fb[EYE_FRAME_BYTES];
+static uint8_t g_from[EYE_FRAME_BYTES];
+static uint32_t g_now = 1000;
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// The reference drawing surface: an SSD1306 buffer with the panel's rotation
+static Adafruit_SSD1306& reference() {
+  static Adafruit_SSD1306 gfx(128, 64);
+  static bool begun = false;
+  if (!begun) {
+    begun = gfx.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+    gfx.setRotation(EYE_FRAME_ROTATION);
+  }
+  return gfx;
+}
+
+static const uint8_t* restingFrame(uint8_t state, uint8_t direction) {
+  Adafruit_SSD1306& gfx = reference();
+  gfx.clearDisplay();
+  drawEyesGfx(gfx, state, direction);
+  return gfx.getBuffer();
+}
+
+// The sockets of state with its pupils at (dx, dy), drawn with GFX
+static const uint8_t* pupilFrame(uint8_t state, int dx, int dy) {
+  Adafruit_SSD1306& gfx = reference();
+  memcpy(gfx.getBuffer(), EYE_SOCKETS[state], EYE_FRAME_BYTES);
+  const EyePupilStyle& style = EYE_PUPIL_STYLES[state];
+  if (style.eyes & 1) gfx.fillCircle(EYE_LEFT_X + dx, EYE_CENTER_Y + dy + style.dy, style.r, SSD1306_WHITE);
+  if (style.eyes & 2) gfx.fillCircle(EYE_RIGHT_X + dx, EYE_CENTER_Y + dy + style.dy, style.r, SSD1306_WHITE);
+  return gfx.getBuffer();
+}
+
+// Pixel at logical (x, y) of a frame in the panel's page layout
+static bool lit(const uint8_t* frame, int x, int y) {
+#if EYE_FRAME_ROTATION == 2
+  x = 127 - x;
+  y = 63 - y;
+#endif
+  return (frame[x + (y / 8) * 128] >> (y & 7)) & 1;
+}
+
+static bool sameFrame(const uint8_t* frame) {
+  return memcmp(g_fb, frame, EYE_FRAME_BYTES) == 0;
+}
+
+// Runs the animator to the given time, expecting a frame to be rendered then
+static bool tickAt(uint32_t t, bool busy = false) {
+  g_now = t;
+  return eyeAnimTick(g_now, busy);
+}
+
+// Shows state looking at direction and lets every tween finish
+static void settle(uint8_t state, uint8_t direction) {
+  eyeAnimSetExpression(state, g_now, true);
+  eyeAnimLookAt(EYE_PUPIL_OFFSETS[direction][0], EYE_PUPIL_OFFSETS[direction][1], 0, EASE_LINEAR, g_now);
+  tickAt(g_now + FADE_MS + FRAME_MS);
+  tickAt(g_now + 1000);   // Idle again: the next change renders without waiting for a slot
+}
+
+static void checkRestingFrames() {
+  char what[96];
+  for (uint8_t state = 0; state < EYE_FRAME_STATES; state++) {
+    for (uint8_t direction = 0; direction < EYE_FRAME_DIRECTIONS; direction++) {
+      settle(state, direction);
+      snprintf(what, sizeof(what), "resting frame %u/%u matches the GFX drawing", state, direction);
+      check(sameFrame(restingFrame(state, direction)), what);
+    }
+  }
+}
+
+// Pupil positions part-way through a move follow the easing curve
+static void checkEasing() {
+  struct Case {
+    EyeEase ease;
+    int8_t dx, dy;
+    uint16_t durationMs;
+    uint16_t atMs;
+    int expectDx, expectDy;
+    const char* what;
+  };
+  const Case cases[] = {
+    {EASE_LINEAR, 12, 0, 400, 100, 3, 0, "linear, a quarter of the way"},
+    {EASE_IN_OUT, 12, 0, 400, 100, 1, 0, "ease-in-out starts slowly (0.0625 at a quarter)"},
+    {EASE_IN_OUT, 12, 0, 400, 200, 6, 0, "ease-in-out halfway"},
+    {EASE_IN_OUT, 12, 0, 400, 300, 11, 0, "ease-in-out slows down at the end (0.9375)"},
+    {EASE_OUT_BACK, 0, -8, 400, 280, 0, -9, "ease-out-back overshoots the target"},
+    {EASE_OUT_BACK, 0, -8, 400, 400, 0, -8, "ease-out-back settles on the target"},
+  };
+  char what[96];
+  for (const Case& c : cases) {
+    settle(0, 0);
+    uint32_t start = g_now;
+    eyeAnimLookAt(c.dx, c.dy, c.durationMs, c.ease, start);
+    check(!tickAt(start), "a move starts where the pupils are: nothing new to flush");
+    tickAt(start + c.atMs);
+    snprintf(what, sizeof(what), "%s: pupils at (%d, %d)", c.what, c.expectDx, c.expectDy);
+    check(sameFrame(pupilFrame(0, c.expectDx, c.expectDy)), what);
+  }
+  settle(0, 0);
+}
+
+static void checkCrossFade() {
+  settle(0, 0);
+  memcpy(g_from, g_fb, EYE_FRAME_BYTES);
+  uint32_t start = g_now;
+  eyeAnimSetExpression(1, start);
+  check(tickAt(start), "a fade renders its first frame at once");
+  check(sameFrame(g_from), "fade start shows the old expression");
+
+  tickAt(start + FADE_MS / 2 + 1);
+  const uint8_t* target = restingFrame(1, 0);
+  uint32_t differing = 0, fromNew = 0;
+  bool mixed = true;
+  for (size_t i = 0; i < EYE_FRAME_BYTES; i++) {
+    uint8_t diff = g_from[i] ^ target[i];
+    mixed &= ((g_fb[i] ^ g_from[i]) & (g_fb[i] ^ target[i])) == 0;   // Each pixel from one side
+    differing += __builtin_popcount(diff);
+    fromNew += __builtin_popcount(diff & ~(g_fb[i] ^ target[i]));
+  }
+  check(mixed, "fade middle: every pixel comes from the old or the new frame");
+  double share = differing ? (double)fromNew / differing : 0;
+  check(share > 0.35 && share < 0.65, "fade middle: about half the changed pixels are new");
+
+  tickAt(start + FADE_MS);
+  check(sameFrame(target), "fade end shows the new expression");
+  check(!eyeAnimIsAnimating(), "nothing animates after the fade");
+}
+
+static void checkBlink() {
+  settle(0, 0);
+  const uint8_t* open = restingFrame(0, 0);
+  uint8_t openFrame[EYE_FRAME_BYTES];
+  memcpy(openFrame, open, EYE_FRAME_BYTES);
+  uint32_t start = g_now;
+  eyeAnimBlink(start);
+
+  // Half closed: lids at 15 rows from the middle, pupils clipped between them
+  tickAt(start + BLINK_CLOSE_MS / 2);
+  check(lit(g_fb, EYE_LEFT_X - 18, EYE_CENTER_Y - 15) && lit(g_fb, EYE_RIGHT_X + 18, EYE_CENTER_Y + 15),
+        "half closed: both lids drawn");
+
+  // Closed: one lid across the middle row, nothing else inside the sockets
+  tickAt(start + BLINK_CLOSE_MS + BLINK_HOLD_MS / 2);
+  const uint8_t* sockets = EYE_SOCKETS[0];
+  bool closed = true;
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 128; x++) {
+      bool insideLeft = x > EYE_LEFT_X - EYE_SOCKET_W / 2 && x < EYE_LEFT_X + EYE_SOCKET_W / 2 - 1;
+      bool insideRight = x > EYE_RIGHT_X - EYE_SOCKET_W / 2 && x < EYE_RIGHT_X + EYE_SOCKET_W / 2 - 1;
+      bool expected = y == EYE_CENTER_Y && (insideLeft || insideRight) ? true : lit(sockets, x, y);
+      closed &= lit(g_fb, x, y) == expected;
+    }
+  }
+  check(closed, "closed: one lid across each eye, no pupils");
+
+  tickAt(start + BLINK_CLOSE_MS + BLINK_HOLD_MS + BLINK_OPEN_MS);
+  check(sameFrame(openFrame), "blink end: eyes open as before");
+  check(!eyeAnimIsAnimating(), "nothing animates after the blink");
+}
+
+static void checkFrameSlots() {
+  settle(0, 0);
+  uint32_t dropped = eyeAnimGetStats().framesDropped;
+  uint32_t start = g_now;
+  eyeAnimLookAt(12, 0, 1000, EASE_LINEAR, start);
+  check(!tickAt(start), "first slot: pupils not moved yet, nothing to flush");
+  check(eyeAnimNextDeadline(g_now) == start + FRAME_MS, "next deadline is the next slot");
+  check(!tickAt(start + FRAME_MS / 2), "nothing before the next slot");
+
+  // Bus busy at the slot: dropped, and not retried once the bus is free
+  check(!tickAt(start + FRAME_MS, true), "busy slot renders nothing");
+  check(eyeAnimGetStats().framesDropped == dropped + 1, "busy slot counted as dropped");
+  check(!tickAt(start + FRAME_MS + 5), "busy slot not retried");
+  check(eyeAnimNextDeadline(g_now) == start + 2 * FRAME_MS, "deadline moves to the slot after");
+  check(tickAt(start + 2 * FRAME_MS), "slot after a busy one renders");
+
+  // The loop slept through three slots: they are dropped and the schedule keeps its phase
+  check(tickAt(start + 6 * FRAME_MS + 4), "late tick renders");
+  check(eyeAnimGetStats().framesDropped == dropped + 4, "slept-through slots counted as dropped");
+  check(eyeAnimNextDeadline(g_now) == start + 7 * FRAME_MS, "schedule keeps its phase");
+
+  // Still busy at every slot: the tween goes on in time and ends where it should
+  for (uint32_t slot = 7; slot * FRAME_MS < 1000; slot++) tickAt(start + slot * FRAME_MS, true);
+  check(tickAt(start + 1000 + FRAME_MS), "first free slot after the tween renders");
+  check(sameFrame(restingFrame(0, LOOK_RIGHT)), "tween ends on target despite the dropped slots");
+  tickAt(g_now + 1000);
+  check(!eyeAnimIsAnimating() && eyeAnimNextDeadline(g_now) == g_now + 1000, "idle: no frame slots");
+}
+
+int simEyeTest() {
+  eyeAnimBegin(g_fb, FPS, nullptr);
+  eyeAnimSetAutoBlink(false);
+  checkRestingFrames();
+  checkEasing();
+  checkCrossFade();
+  checkBlink();
+  checkFrameSlots();
+  printf("eye animator: %s\n", g_failures ? "FAILED" : "key frames and frame slots as expected");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,364 @@
+// Adafruit GFX / SSD1306 rasterization for the host build.
+#include <Adafruit_SSD1306.h>
+
+#include <mutex>
+
+#include "sim_font.h"
+
+#define gfx_swap(a, b) \
+  {                    \
+    int16_t t = a;     \
+    a = b;             \
+    b = t;             \
+  }
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t i = x; i < x + w; i++) drawFastVLine(i, y, h, color);
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    gfx_swap(x0, y0);
+    gfx_swap(x1, y1);
+  }
+  if (x0 > x1) {
+    gfx_swap(x0, x1);
+    gfx_swap(y0, y1);
+  }
+  int16_t dx = x1 - x0, dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = (y0 < y1) ? 1 : -1;
+  for (; x0 <= x1; x0++) {
+    if (steep) drawPixel(y0, x0, color);
+    else drawPixel(x0, y0, color);
+    err -= dy;
+    if (err < 0) {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+  drawPixel(x0, y0 + r, color);
+  drawPixel(x0, y0 - r, color);
+  drawPixel(x0 + r, y0, color);
+  drawPixel(x0 - r, y0, color);
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    drawPixel(x0 + x, y0 + y, color);
+    drawPixel(x0 - x, y0 + y, color);
+    drawPixel(x0 + x, y0 - y, color);
+    drawPixel(x0 - x, y0 - y, color);
+    drawPixel(x0 + y, y0 + x, color);
+    drawPixel(x0 - y, y0 + x, color);
+    drawPixel(x0 + y, y0 - x, color);
+    drawPixel(x0 - y, y0 - x, color);
+  }
+}
+
+void Adafruit_GFX::drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername, uint16_t color) {
+  int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    if (cornername & 0x4) {
+      drawPixel(x0 + x, y0 + y, color);
+      drawPixel(x0 + y, y0 + x, color);
+    }
+    if (cornername & 0x2) {
+      drawPixel(x0 + x, y0 - y, color);
+      drawPixel(x0 + y, y0 - x, color);
+    }
+    if (cornername & 0x8) {
+      drawPixel(x0 - y, y0 + x, color);
+      drawPixel(x0 - x, y0 + y, color);
+    }
+    if (cornername & 0x1) {
+      drawPixel(x0 - y, y0 - x, color);
+      drawPixel(x0 - x, y0 - y, color);
+    }
+  }
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+  fillCircleHelper(x0, y0, r, 3, 0, color);
+}
+
+void Adafruit_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta,
+                                    uint16_t color) {
+  int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+  delta++;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    if (x < (y + 1)) {
+      if (corners & 1) drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+      if (corners & 2) drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+    }
+    if (y != py) {
+      if (corners & 1) drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+      if (corners & 2) drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+      py = y;
+    }
+    px = x;
+  }
+}
+
+void Adafruit_GFX::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) {
+  int16_t max_radius = ((w < h) ? w : h) / 2;
+  if (r > max_radius) r = max_radius;
+  drawFastHLine(x + r, y, w - 2 * r, color);
+  drawFastHLine(x + r, y + h - 1, w - 2 * r, color);
+  drawFastVLine(x, y + r, h - 2 * r, color);
+  drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+  drawCircleHelper(x + r, y + r, r, 1, color);
+  drawCircleHelper(x + w - r - 1, y + r, r, 2, color);
+  drawCircleHelper(x + w - r - 1, y + h - r - 1, r, 4, color);
+  drawCircleHelper(x + r, y + h - r - 1, r, 8, color);
+}
+
+void Adafruit_GFX::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color) {
+  int16_t max_radius = ((w < h) ? w : h) / 2;
+  if (r > max_radius) r = max_radius;
+  fillRect(x + r, y, w - 2 * r, h, color);
+  fillCircleHelper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
+  fillCircleHelper(x + r, y + r, r, 2, h - 2 * r - 1, color);
+}
+
+void Adafruit_GFX::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+                                uint16_t color) {
+  drawLine(x0, y0, x1, y1, color);
+  drawLine(x1, y1, x2, y2, color);
+  drawLine(x2, y2, x0, y0, color);
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h,
+                              uint16_t color) {
+  int16_t byteWidth = (w + 7) / 8;
+  uint8_t b = 0;
+  for (int16_t j = 0; j < h; j++, y++) {
+    for (int16_t i = 0; i < w; i++) {
+      if (i & 7) b <<= 1;
+      else b = bitmap[j * byteWidth + i / 8];
+      if (b & 0x80) drawPixel(x + i, y, color);
+    }
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size) {
+  if ((x >= _width) || (y >= _height) || ((x + 6 * size - 1) < 0) || ((y + 8 * size - 1) < 0)) return;
+  const uint8_t* glyph = simFontGlyph(c);
+  for (int8_t i = 0; i < 5; i++) {
+    uint8_t line = glyph[i];
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      if (line & 1) {
+        if (size == 1) drawPixel(x + i, y + j, color);
+        else fillRect(x + i * size, y + j * size, size, size, color);
+      } else if (bg != color) {
+        if (size == 1) drawPixel(x + i, y + j, bg);
+        else fillRect(x + i * size, y + j * size, size, size, bg);
+      }
+    }
+  }
+  if (bg != color) {
+    if (size == 1) drawFastVLine(x + 5, y, 8, bg);
+    else fillRect(x + 5 * size, y, size, 8 * size, bg);
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += textsize * 8;
+  } else if (c != '\r') {
+    if (wrap && ((cursor_x + textsize * 6) > _width)) {
+      cursor_x = 0;
+      cursor_y += textsize * 8;
+    }
+    drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+    cursor_x += textsize * 6;
+  }
+  return 1;
+}
+
+void Adafruit_GFX::setRotation(uint8_t r) {
+  rotation = r & 3;
+  switch (rotation) {
+    case 0:
+    case 2:
+      _width = WIDTH;
+      _height = HEIGHT;
+      break;
+    default:
+      _width = HEIGHT;
+      _height = WIDTH;
+      break;
+  }
+}
+
+// --------------------------------------------------------------------------------
+// SSD1306
+// --------------------------------------------------------------------------------
+static std::mutex g_panelMutex;
+static SimPanel g_panel = {{0}, 0, 0xCF, false, false, 0};
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi, int8_t rst_pin, uint32_t clkDuring,
+                                   uint32_t clkAfter)
+    : Adafruit_GFX(w, h), wire(twi), clkDuring(clkDuring), clkAfter(clkAfter) {
+  (void)rst_pin;
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { free(buffer); }
+
+bool Adafruit_SSD1306::begin(uint8_t vcs, uint8_t addr, bool reset, bool periphBegin) {
+  (void)reset;
+  (void)periphBegin;
+  if (!buffer && !(buffer = (uint8_t*)malloc(WIDTH * ((HEIGHT + 7) / 8)))) return false;
+  clearDisplay();
+  vccstate = vcs;
+  i2caddr = addr ? addr : 0x3C;
+  wire->simTransfer(i2caddr, 26); // Init sequence
+  std::lock_guard<std::mutex> lock(g_panelMutex);
+  g_panel.on = true;
+  return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() { memset(buffer, 0, WIDTH * ((HEIGHT + 7) / 8)); }
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) return;
+  switch (getRotation()) {
+    case 1:
+      gfx_swap(x, y);
+      x = WIDTH - x - 1;
+      break;
+    case 2:
+      x = WIDTH - x - 1;
+      y = HEIGHT - y - 1;
+      break;
+    case 3:
+      gfx_swap(x, y);
+      y = HEIGHT - y - 1;
+      break;
+  }
+  switch (color) {
+    case SSD1306_WHITE: buffer[x + (y / 8) * WIDTH] |= (1 << (y & 7)); break;
+    case SSD1306_BLACK: buffer[x + (y / 8) * WIDTH] &= ~(1 << (y & 7)); break;
+    case SSD1306_INVERSE: buffer[x + (y / 8) * WIDTH] ^= (1 << (y & 7)); break;
+  }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) {
+  if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) return false;
+  switch (getRotation()) {
+    case 1:
+      gfx_swap(x, y);
+      x = WIDTH - x - 1;
+      break;
+    case 2:
+      x = WIDTH - x - 1;
+      y = HEIGHT - y - 1;
+      break;
+    case 3:
+      gfx_swap(x, y);
+      y = HEIGHT - y - 1;
+      break;
+  }
+  return (buffer[x + (y / 8) * WIDTH] & (1 << (y & 7)));
+}
+
+void Adafruit_SSD1306::display() {
+  // Same framing as the Adafruit driver: 6 addressing commands, then the
+  // framebuffer in (WIRE_MAX - 1)-byte chunks each prefixed with a 0x40 control byte.
+  uint32_t saved = wire->getClock();
+  wire->setClock(clkDuring);
+  size_t bytes = WIDTH * ((HEIGHT + 7) / 8);
+  size_t chunks = (bytes + 30) / 31;
+  wire->simTransfer(i2caddr, 6 * 2);
+  for (size_t i = 0; i < chunks; i++) wire->simTransfer(i2caddr, 32);
+  wire->setClock(clkAfter ? clkAfter : saved);
+
+  std::lock_guard<std::mutex> lock(g_panelMutex);
+  memcpy(g_panel.pixels, buffer, sizeof(g_panel.pixels));
+  g_panel.rotation = getRotation();
+  g_panel.flushes++;
+}
+
+void Adafruit_SSD1306::commandByte(uint8_t c) {
+  std::lock_guard<std::mutex> lock(g_panelMutex);
+  if (pendingArg >= 0) {
+    if (pendingArg == SSD1306_SETCONTRAST) {
+      contrast = c;
+      g_panel.contrast = c;
+    }
+    pendingArg = -1;
+    return;
+  }
+  switch (c) {
+    case SSD1306_SETCONTRAST:
+    case SSD1306_SETPRECHARGE:
+    case SSD1306_SETVCOMDETECT:
+      pendingArg = c;
+      break;
+    case SSD1306_DISPLAYOFF: g_panel.on = false; break;
+    case SSD1306_DISPLAYON: g_panel.on = true; break;
+    case SSD1306_INVERTDISPLAY: g_panel.inverted = true; break;
+    case SSD1306_NORMALDISPLAY: g_panel.inverted = false; break;
+    default: break;
+  }
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
+  wire->simTransfer(i2caddr, 2);
+  commandByte(c);
+}
+
+void Adafruit_SSD1306::invertDisplay(bool i) { ssd1306_command(i ? SSD1306_INVERTDISPLAY : SSD1306_NORMALDISPLAY); }
+
+void Adafruit_SSD1306::dim(bool dim) {
+  ssd1306_command(SSD1306_SETCONTRAST);
+  ssd1306_command(dim ? 0 : (vccstate == SSD1306_EXTERNALVCC ? 0x9F : 0xCF));
+}
+
+SimPanel simPanelSnapshot() {
+  std::lock_guard<std::mutex> lock(g_panelMutex);
+  return g_panel;
+}
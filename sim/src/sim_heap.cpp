@@ -0,0 +1,23 @@
+// Heap numbers for the simulator, modelled as a 320 KB heap on top of glibc's arena.
+#include <esp_heap_caps.h>
+#include <malloc.h>
+#include <algorithm>
+
+static const size_t SIM_HEAP = 320 * 1024;
+static size_t minFree = SIM_HEAP;
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  (void)caps;
+  struct mallinfo2 mi = mallinfo2();
+  size_t used = std::min(mi.uordblks, SIM_HEAP / 2);
+  info->total_allocated_bytes = used;
+  info->total_free_bytes = SIM_HEAP - used;
+  info->free_blocks = mi.ordblks;
+  info->allocated_blocks = mi.hblks + mi.ordblks; // glibc doesn't count live chunks; use a proxy
+  info->largest_free_block = info->total_free_bytes - std::min(mi.fordblks, info->total_free_bytes / 2);
+  info->minimum_free_bytes = minFree = std::min(minFree, info->total_free_bytes);
+  info->total_blocks = info->allocated_blocks + info->free_blocks;
+}
+size_t heap_caps_get_free_size(uint32_t caps) { multi_heap_info_t i; heap_caps_get_info(&i, caps); return i.total_free_bytes; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { heap_caps_get_free_size(caps); return minFree; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { multi_heap_info_t i; heap_caps_get_info(&i, caps); return i.largest_free_block; }
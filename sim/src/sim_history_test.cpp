@@ -0,0 +1,241 @@
+// --history-test: host checks of the /history?after= delta protocol (sampleStoreResume()
+// in sample_store.h) against the real sample store. A collector polls the way the
+// dashboard and external pollers do: send the last sequence number and session, take
+// the page, repeat while "more". Between polls the device stores readings, polls are
+// dropped at random, the collector goes away for longer than the store holds, and the
+// device restarts with a new session.
+//
+// Every reading carries a unique id (in uptimeMs). The collector must receive each id
+// at most once and in order, and every id it never received must be accounted for:
+// either reported as dropped (overwritten before it asked) or lost with a restart that
+// came before it could ask. Then full pages at 3- to 10-digit sequence numbers, with
+// lux, are encoded by the firmware's /history printers and must fit in a pool slot.
+// The exit code is 1 if any check fails.
+#include "sample_store.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "http_response.h"
+#include "sim.h"
+
+const uint32_t PAGE = 60;   // DATA_HISTORY_SIZE in main.cpp
+
+// main.cpp
+struct HistoryPoint {
+  uint32_t seq;     // Sequence number in the sample store, see sample_store.h
+  int64_t epochMs;
+  float temp;
+  float humidity;
+  float lux; // NaN without a light reading
+};
+void printHistoryJson(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+void printHistoryCbor(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// The device: the sample store plus the bookkeeping needed to check the collector
+struct Device {
+  uint32_t session = 0;
+  uint32_t nextId = 1;
+  uint32_t stored = 0;   // Readings ever stored, over all sessions
+
+  void boot() {
+    sampleStoreBegin(++session);
+  }
+  void store(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+      sampleStoreAdd(nextId++, 0, 21.5f, 40.0f, 1013.0f, NAN, NAN, NAN, SAMPLE_TEMP_OK | SAMPLE_PRESSURE_OK);
+      stored++;
+    }
+  }
+};
+
+struct Collector {
+  bool sendSession = true;   // False: an old poller that only sends after=
+  uint32_t session = 0;
+  uint32_t last = 0;
+  uint32_t lastId = 0;
+  std::vector<uint32_t> ids;
+  uint32_t dropped = 0;
+  uint32_t resets = 0;
+  uint32_t requests = 0;
+  bool ordered = true;
+
+  void poll() {
+    SampleResume r;
+    do {
+      r = sampleStoreResume(sendSession ? session : 0, last, PAGE);
+      requests++;
+      check(r.end - r.from <= PAGE, "page no larger than asked for");
+      if (r.reset) resets++;
+      dropped += r.dropped;
+      for (uint32_t i = r.from; i < r.end; i++) {
+        StoredSample s;
+        if (!sampleStoreGet(i, s)) {
+          check(false, "page holds only stored readings");
+          continue;
+        }
+        ordered &= s.uptimeMs > lastId;
+        lastId = s.uptimeMs;
+        ids.push_back(s.uptimeMs);
+      }
+      session = sampleStoreSession();
+      last = r.end;   // The "last" of the answer
+    } while (r.more);
+  }
+
+  // Readings of the running session this collector will never see once the device
+  // restarts: those after its last poll, or all of them if it never polled this session
+  uint32_t lostAtRestart() const {
+    uint32_t end = sampleStoreEnd();
+    uint32_t seen = session == sampleStoreSession() ? last : 0;
+    return end - seen;
+  }
+};
+
+struct Scenario {
+  const char* name;
+  uint32_t steps;
+  double pollChance;      // Per step; the rest are dropped polls
+  double restartChance;   // Per step
+  uint32_t maxPerStep;    // Readings stored per step, 0..maxPerStep
+  uint32_t outageStep;    // Step at which the collector is away for OUTAGE readings; 0 for none
+};
+
+const uint32_t OUTAGE = SAMPLE_STORE_CAPACITY * 2 + 123;
+
+static void run(const Scenario& sc, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> chance(0, 1);
+  Device device;
+  Collector collector;
+  uint32_t lost = 0, restarts = 0;
+  device.boot();
+  for (uint32_t step = 0; step < sc.steps; step++) {
+    if (chance(rng) < sc.restartChance) {
+      lost += collector.lostAtRestart();
+      device.boot();
+      restarts++;
+    }
+    device.store(std::uniform_int_distribution<uint32_t>(0, sc.maxPerStep)(rng));
+    if (step == sc.outageStep && sc.outageStep) device.store(OUTAGE);
+    if (chance(rng) < sc.pollChance) collector.poll();
+  }
+  collector.poll();
+
+  uint32_t received = collector.ids.size();
+  char what[160];
+  snprintf(what, sizeof(what), "%s: received %u + dropped %u + lost at restarts %u == stored %u", sc.name,
+           (unsigned)received, (unsigned)collector.dropped, (unsigned)lost, (unsigned)device.stored);
+  check(received + collector.dropped + lost == device.stored, what);
+  snprintf(what, sizeof(what), "%s: readings arrive once and in order", sc.name);
+  check(collector.ordered, what);
+  snprintf(what, sizeof(what), "%s: every restart seen (%u of %u)", sc.name, (unsigned)collector.resets,
+           (unsigned)restarts);
+  check(collector.resets <= restarts && (restarts == 0 || collector.resets > 0), what);
+  if (!sc.outageStep) {
+    snprintf(what, sizeof(what), "%s: nothing dropped without an outage", sc.name);
+    check(collector.dropped == 0, what);
+  } else {
+    snprintf(what, sizeof(what), "%s: the outage dropped readings", sc.name);
+    check(collector.dropped >= OUTAGE - SAMPLE_STORE_CAPACITY, what);
+  }
+  printf("  %-28s seed %u: %6u stored, %6u received in %5u requests, %5u dropped, %4u lost in %u restarts\n",
+         sc.name, (unsigned)seed, (unsigned)device.stored, (unsigned)received, (unsigned)collector.requests,
+         (unsigned)collector.dropped, (unsigned)lost, (unsigned)restarts);
+}
+
+// A restart is noticed by the session alone once the new run has stored more readings
+// than the collector had seen; a poller without the session only notices while the
+// device is behind it
+static void checkSessionDetection() {
+  Device device;
+  Collector withSession, without;
+  without.sendSession = false;
+  device.boot();
+  device.store(100);
+  withSession.poll();
+  without.poll();
+  device.boot();
+  device.store(150);
+  SampleResume a = sampleStoreResume(withSession.session, withSession.last, PAGE);
+  SampleResume b = sampleStoreResume(0, without.last, PAGE);
+  check(a.reset && a.from == 0, "new session detected by the session");
+  check(!b.reset, "without the session, a run already past the old last looks like the same one");
+  device.boot();
+  device.store(20);
+  b = sampleStoreResume(0, without.last, PAGE);
+  check(b.reset && b.from == 0, "without the session, a run behind the old last is a restart");
+
+  // Nothing new: an empty page that keeps the position
+  device.boot();
+  device.store(10);
+  withSession.session = sampleStoreSession();
+  withSession.last = 10;
+  a = sampleStoreResume(withSession.session, 10, PAGE);
+  check(!a.reset && !a.more && a.from == a.end && a.end == 10 && a.dropped == 0, "no new readings");
+  // after=0 asks for everything still stored
+  a = sampleStoreResume(0, 0, PAGE);
+  check(!a.reset && a.from == 0 && a.end == 10, "after=0 is everything");
+}
+
+// A full page of readings up to sequence number last, with the longest values a
+// reading can have: a session and counters of 10 digits, negative temperatures, lux
+// at the BH1750's full scale. Both encodings must fit in one pool slot.
+static void checkPageSize(uint32_t last) {
+  static HttpBuffer json, cbor;
+  HistoryPoint points[PAGE];
+  for (uint32_t i = 0; i < PAGE; i++) {
+    points[i].seq = last - PAGE + 1 + i;
+    points[i].epochMs = 1790000000000LL + i * 30000;
+    points[i].temp = -38.27f + i * 0.01f;
+    points[i].humidity = 99.99f - i * 0.01f;
+    points[i].lux = 121557.13f - i;
+  }
+  SampleResume range = {last - PAGE, last, 4294967295u, true, true};
+  sampleStoreBegin(4294967295u);
+  json.clear();
+  cbor.clear();
+  printHistoryJson(range, points, PAGE, json);
+  printHistoryCbor(range, points, PAGE, cbor);
+  char what[160];
+  snprintf(what, sizeof(what), "a page up to seq %u fits in a slot: JSON %u bytes, CBOR %u bytes of %u", (unsigned)last,
+           (unsigned)json.length(), (unsigned)cbor.length(), (unsigned)HTTP_SLOT_SIZE);
+  check(!json.overflowed() && !cbor.overflowed(), what);
+  // Values go out at the store's 0.01 resolution, not as the float's nine digits
+  std::string body(json.data(), json.length());
+  check(body.find("-38.27,") != std::string::npos && body.find("121557.13,") != std::string::npos,
+        "JSON values are printed to 0.01");
+  printf("  page to seq %10u: JSON %4u bytes, CBOR %4u bytes (slot %u)\n", (unsigned)last, (unsigned)json.length(),
+         (unsigned)cbor.length(), (unsigned)HTTP_SLOT_SIZE);
+}
+
+int simHistoryTest() {
+  const Scenario scenarios[] = {
+    {"every poll answered", 5000, 1.0, 0.0, 3, 0},
+    {"most polls dropped", 5000, 0.2, 0.0, 3, 0},
+    {"polls dropped, restarts", 20000, 0.3, 0.002, 4, 0},
+    {"long outage", 5000, 0.5, 0.0, 3, 2500},
+    {"outage and restarts", 20000, 0.1, 0.001, 8, 9000},
+  };
+  printf("history delta protocol (page of %u, store of %u):\n", (unsigned)PAGE, (unsigned)SAMPLE_STORE_CAPACITY);
+  for (const Scenario& sc : scenarios) {
+    for (uint32_t seed = 1; seed <= 3; seed++) run(sc, seed);
+  }
+  checkSessionDetection();
+  for (uint32_t last : {999u, 99999u, 4294967295u}) checkPageSize(last);
+  printf("history: %s\n", g_failures ? "FAILED" : "all readings accounted for");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,768 @@
+// Socket event loop behind the simulated ESPAsyncWebServer.
+#include <ESPAsyncWebServer.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "sim.h"
+
+// --------------------------------------------------------------------------------
+// Responses
+// --------------------------------------------------------------------------------
+static const char* statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+std::string AsyncWebServerResponse::head() const {
+  std::string h = "HTTP/1.1 " + std::to_string(code_) + " " + statusText(code_) + "\r\n";
+  h += "Connection: close\r\n";
+  h += "Accept-Ranges: none\r\n";
+  for (auto& hd : headers_) h += hd.toString().str();
+  if (contentType_.length()) h += "Content-Type: " + contentType_.str() + "\r\n";
+  if (chunked_) h += "Transfer-Encoding: chunked\r\n";
+  else if (sendContentLength_) h += "Content-Length: " + std::to_string(contentLength_) + "\r\n";
+  h += "\r\n";
+  return h;
+}
+
+// Expands %PLACEHOLDER% tokens like the library's template processor.
+static std::string applyTemplate(const std::string& in, const AwsTemplateProcessor& proc) {
+  if (!proc) return in;
+  std::string out;
+  size_t i = 0;
+  while (i < in.size()) {
+    size_t start = in.find('%', i);
+    if (start == std::string::npos) {
+      out.append(in, i, std::string::npos);
+      break;
+    }
+    out.append(in, i, start - i);
+    size_t end = in.find('%', start + 1);
+    if (end == std::string::npos) {
+      out.append(in, start, std::string::npos);
+      break;
+    }
+    if (end == start + 1) { // "%%" -> "%"
+      out += '%';
+      i = end + 1;
+      continue;
+    }
+    std::string name = in.substr(start + 1, end - start - 1);
+    if (name.find_first_of(" \t\r\n;:{}\"'") != std::string::npos) { // Not a placeholder
+      out += '%';
+      i = start + 1;
+      continue;
+    }
+    out += proc(String(name)).str();
+    i = end + 1;
+  }
+  return out;
+}
+
+class SimBasicResponse : public AsyncWebServerResponse {
+public:
+  SimBasicResponse(int code, const String& type, const std::string& content) : content_(content) {
+    code_ = code;
+    contentType_ = type;
+    contentLength_ = content_.size();
+  }
+  size_t fill(uint8_t* buf, size_t maxLen) override {
+    size_t n = std::min(maxLen, content_.size() - sent_);
+    memcpy(buf, content_.data() + sent_, n);
+    sent_ += n;
+    return n;
+  }
+
+private:
+  std::string content_;
+  size_t sent_ = 0;
+};
+
+class SimCallbackResponse : public AsyncWebServerResponse {
+public:
+  SimCallbackResponse(const String& type, size_t len, AwsResponseFiller filler, bool chunked)
+      : filler_(filler) {
+    contentType_ = type;
+    contentLength_ = len;
+    chunked_ = chunked;
+  }
+  size_t fill(uint8_t* buf, size_t maxLen) override {
+    if (done_ || (!chunked_ && index_ >= contentLength_)) return 0;
+    if (!chunked_) maxLen = std::min(maxLen, contentLength_ - index_);
+    size_t n = filler_(buf, maxLen, index_);
+    if (n == RESPONSE_TRY_AGAIN) return RESPONSE_TRY_AGAIN;
+    if (n > maxLen) n = maxLen;
+    if (n == 0) done_ = true;
+    index_ += n;
+    return n;
+  }
+
+private:
+  AwsResponseFiller filler_;
+  size_t index_ = 0;
+  bool done_ = false;
+};
+
+AsyncResponseStream::AsyncResponseStream(const String& contentType, size_t bufferSize) {
+  contentType_ = contentType;
+  content_.reserve(bufferSize);
+}
+
+size_t AsyncResponseStream::write(uint8_t c) {
+  content_ += (char)c;
+  contentLength_ = content_.size();
+  return 1;
+}
+
+size_t AsyncResponseStream::write(const uint8_t* data, size_t len) {
+  content_.append((const char*)data, len);
+  contentLength_ = content_.size();
+  return len;
+}
+
+size_t AsyncResponseStream::fill(uint8_t* buf, size_t maxLen) {
+  size_t n = std::min(maxLen, content_.size() - sent_);
+  memcpy(buf, content_.data() + sent_, n);
+  sent_ += n;
+  return n;
+}
+
+// --------------------------------------------------------------------------------
+// Request
+// --------------------------------------------------------------------------------
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+  for (auto* p : params_) delete p;
+  for (auto* h : headers_) delete h;
+  delete response_;
+}
+
+const char* AsyncWebServerRequest::methodToString() const {
+  switch (method_) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_PUT: return "PUT";
+    case HTTP_PATCH: return "PATCH";
+    case HTTP_HEAD: return "HEAD";
+    case HTTP_OPTIONS: return "OPTIONS";
+    default: return "UNKNOWN";
+  }
+}
+
+bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+  return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+  for (auto* p : params_)
+    if (p->name() == name && p->isPost() == post && p->isFile() == file) return p;
+  return nullptr;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const {
+  return num < params_.size() ? params_[num] : nullptr;
+}
+
+const String& AsyncWebServerRequest::arg(const String& name) const {
+  static const String empty;
+  for (auto* p : params_)
+    if (p->name() == name) return p->value();
+  return empty;
+}
+
+bool AsyncWebServerRequest::hasArg(const char* name) const {
+  for (auto* p : params_)
+    if (p->name() == name) return true;
+  return false;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const { return getHeader(name) != nullptr; }
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
+  for (auto* h : headers_)
+    if (h->name().equalsIgnoreCase(name)) return h;
+  return nullptr;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const {
+  return num < headers_.size() ? headers_[num] : nullptr;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+  if (response_) { // Only the first response counts, as in the library
+    delete response;
+    return;
+  }
+  response_ = response;
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+  send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, const uint8_t* content, size_t len,
+                                   AwsTemplateProcessor callback) {
+  send(beginResponse_P(code, contentType, content, len, callback));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, PGM_P content,
+                                   AwsTemplateProcessor callback) {
+  send(beginResponse_P(code, contentType, content, callback));
+}
+
+void AsyncWebServerRequest::send(const String& contentType, size_t len, AwsResponseFiller callback,
+                                 AwsTemplateProcessor templateCallback) {
+  send(beginResponse(contentType, len, callback, templateCallback));
+}
+
+void AsyncWebServerRequest::sendChunked(const String& contentType, AwsResponseFiller callback,
+                                        AwsTemplateProcessor templateCallback) {
+  send(beginChunkedResponse(contentType, callback, templateCallback));
+}
+
+void AsyncWebServerRequest::redirect(const String& url) {
+  AsyncWebServerResponse* response = beginResponse(302);
+  response->addHeader("Location", url);
+  send(response);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& contentType,
+                                                             const String& content) {
+  return new SimBasicResponse(code, contentType, content.str());
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(const String& contentType, size_t len,
+                                                             AwsResponseFiller callback,
+                                                             AwsTemplateProcessor templateCallback) {
+  (void)templateCallback;
+  return new SimCallbackResponse(contentType, len, callback, false);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String& contentType,
+                                                                    AwsResponseFiller callback,
+                                                                    AwsTemplateProcessor templateCallback) {
+  (void)templateCallback;
+  return new SimCallbackResponse(contentType, 0, callback, true);
+}
+
+AsyncResponseStream* AsyncWebServerRequest::beginResponseStream(const String& contentType, size_t bufferSize) {
+  return new AsyncResponseStream(contentType, bufferSize);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String& contentType,
+                                                               const uint8_t* content, size_t len,
+                                                               AwsTemplateProcessor callback) {
+  std::string body((const char*)content, len);
+  return new SimBasicResponse(code, contentType, applyTemplate(body, callback));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String& contentType,
+                                                               PGM_P content, AwsTemplateProcessor callback) {
+  return beginResponse_P(code, contentType, (const uint8_t*)content, strlen(content), callback);
+}
+
+// --------------------------------------------------------------------------------
+// Server / routing
+// --------------------------------------------------------------------------------
+bool AsyncCallbackWebHandler::canHandle(const AsyncWebServerRequest* request) const {
+  if (!(method & request->method())) return false;
+  if (uri.length() && uri.endsWith("*")) return request->url().startsWith(uri.substring(0, uri.length() - 1));
+  return request->url() == uri || request->url().startsWith(uri + "/");
+}
+
+static std::mutex g_routeMutex;
+static std::vector<std::pair<String, ArRequestHandlerFunction>> g_simRoutes;
+static std::atomic<uint16_t> g_httpPort(8080);
+static AsyncWebServer* g_activeServer = nullptr;
+
+void simHttpSetPort(uint16_t port) { g_httpPort = port; }
+uint16_t simHttpPort() { return g_httpPort; }
+
+void simHttpAddRoute(const char* uri, ArRequestHandlerFunction fn) {
+  std::lock_guard<std::mutex> lock(g_routeMutex);
+  g_simRoutes.emplace_back(String(uri), fn);
+}
+
+AsyncWebServer::~AsyncWebServer() { end(); }
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, ArRequestHandlerFunction onRequest) {
+  return on(uri, HTTP_ANY, onRequest);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                            ArRequestHandlerFunction onRequest) {
+  return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                            ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload) {
+  return on(uri, method, onRequest, onUpload, nullptr);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                            ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload,
+                                            ArBodyHandlerFunction onBody) {
+  std::lock_guard<std::mutex> lock(g_routeMutex);
+  std::unique_ptr<AsyncCallbackWebHandler> h(new AsyncCallbackWebHandler());
+  h->uri = uri;
+  h->method = method;
+  h->onRequest = onRequest;
+  h->onUpload = onUpload;
+  h->onBody = onBody;
+  handlers_.push_back(std::move(h));
+  return *handlers_.back();
+}
+
+void AsyncWebServer::reset() {
+  std::lock_guard<std::mutex> lock(g_routeMutex);
+  handlers_.clear();
+  notFound_ = nullptr;
+}
+
+// Called with g_routeMutex held
+static ArRequestHandlerFunction findSimRoute(AsyncWebServerRequest* request) {
+  ArRequestHandlerFunction simRoute;
+  for (auto& r : g_simRoutes)
+    if (request->url() == r.first) simRoute = r.second;
+  return simRoute;
+}
+
+void AsyncWebServer::simDispatch(AsyncWebServerRequest* request) {
+  ArRequestHandlerFunction simRoute;
+  AsyncCallbackWebHandler* handler = nullptr;
+  ArRequestHandlerFunction notFound;
+  {
+    std::lock_guard<std::mutex> lock(g_routeMutex);
+    simRoute = findSimRoute(request);
+    if (!simRoute) {
+      for (auto& h : handlers_) {
+        if (h->canHandle(request)) {
+          handler = h.get();
+          break;
+        }
+      }
+    }
+    notFound = notFound_;
+  }
+  if (simRoute) {
+    simRoute(request);
+  } else if (handler) {
+    if (handler->onBody && !request->body_.empty())
+      handler->onBody(request, (uint8_t*)&request->body_[0], request->body_.size(), 0, request->body_.size());
+    if (handler->onRequest) handler->onRequest(request);
+  } else if (notFound) {
+    notFound(request);
+  } else {
+    request->send(404);
+  }
+}
+
+// --------------------------------------------------------------------------------
+// Event loop
+// --------------------------------------------------------------------------------
+struct SimUpload {
+  String field, filename;
+  std::string data;
+};
+
+struct SimHttpConnection {
+  int fd = -1;
+  std::string in;
+  std::string out;
+  AsyncWebServerRequest* request = nullptr;
+  bool dispatched = false;
+  bool headSent = false;
+  bool finished = false;
+  bool chunkTrailerSent = false;
+  unsigned long lastActivity = 0;
+  std::vector<SimUpload> uploads;
+};
+
+static std::string urlDecode(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') out += ' ';
+    else if (s[i] == '%' && i + 2 < s.size()) {
+      out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else out += s[i];
+  }
+  return out;
+}
+
+static void parseQuery(AsyncWebServerRequest* req, std::vector<AsyncWebParameter*>& params, const std::string& q,
+                       bool post) {
+  (void)req;
+  size_t i = 0;
+  while (i <= q.size() && !q.empty()) {
+    size_t amp = q.find('&', i);
+    std::string pair = q.substr(i, amp == std::string::npos ? std::string::npos : amp - i);
+    if (!pair.empty()) {
+      size_t eq = pair.find('=');
+      std::string k = urlDecode(pair.substr(0, eq));
+      std::string v = eq == std::string::npos ? "" : urlDecode(pair.substr(eq + 1));
+      params.push_back(new AsyncWebParameter(String(k), String(v), post));
+    }
+    if (amp == std::string::npos) break;
+    i = amp + 1;
+  }
+}
+
+static std::string headerValue(const std::string& headers, const char* name) {
+  size_t pos = 0;
+  size_t nlen = strlen(name);
+  while (pos < headers.size()) {
+    size_t eol = headers.find("\r\n", pos);
+    if (eol == std::string::npos) eol = headers.size();
+    if (eol - pos > nlen && strncasecmp(headers.c_str() + pos, name, nlen) == 0 && headers[pos + nlen] == ':') {
+      std::string v = headers.substr(pos + nlen + 1, eol - pos - nlen - 1);
+      size_t b = v.find_first_not_of(' ');
+      return b == std::string::npos ? "" : v.substr(b);
+    }
+    pos = eol + 2;
+  }
+  return "";
+}
+
+static void parseMultipart(SimHttpConnection* c, AsyncWebServerRequest* req, const std::string& body,
+                           const std::string& boundary) {
+  std::string delim = "--" + boundary;
+  size_t pos = body.find(delim);
+  while (pos != std::string::npos) {
+    pos += delim.size();
+    if (body.compare(pos, 2, "--") == 0) break;
+    pos += 2; // CRLF
+    size_t hend = body.find("\r\n\r\n", pos);
+    if (hend == std::string::npos) break;
+    std::string partHeaders = body.substr(pos, hend - pos + 2);
+    size_t next = body.find("\r\n" + delim, hend + 4);
+    if (next == std::string::npos) break;
+    std::string data = body.substr(hend + 4, next - hend - 4);
+    std::string disp = headerValue(partHeaders, "Content-Disposition");
+    std::string name, filename;
+    size_t n = disp.find("name=\"");
+    if (n != std::string::npos) name = disp.substr(n + 6, disp.find('"', n + 6) - n - 6);
+    size_t f = disp.find("filename=\"");
+    if (f != std::string::npos) filename = disp.substr(f + 10, disp.find('"', f + 10) - f - 10);
+    if (f != std::string::npos) {
+      c->uploads.push_back({String(name), String(filename), data});
+      req->params_.push_back(new AsyncWebParameter(String(name), String(filename), true, true, data.size()));
+    } else {
+      req->params_.push_back(new AsyncWebParameter(String(name), String(data), true));
+    }
+    pos = next + 2;
+  }
+}
+
+// Returns true once a complete request has been parsed into c->request.
+static bool tryParse(SimHttpConnection* c) {
+  size_t hend = c->in.find("\r\n\r\n");
+  if (hend == std::string::npos) return false;
+  std::string head = c->in.substr(0, hend + 2);
+  size_t contentLength = strtoul(headerValue(head, "Content-Length").c_str(), nullptr, 10);
+  if (c->in.size() < hend + 4 + contentLength) return false;
+
+  AsyncWebServerRequest* req = new AsyncWebServerRequest();
+  size_t eol = head.find("\r\n");
+  std::string line = head.substr(0, eol);
+  size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+  std::string method = line.substr(0, sp1);
+  std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+  if (method == "GET") req->method_ = HTTP_GET;
+  else if (method == "POST") req->method_ = HTTP_POST;
+  else if (method == "DELETE") req->method_ = HTTP_DELETE;
+  else if (method == "PUT") req->method_ = HTTP_PUT;
+  else if (method == "PATCH") req->method_ = HTTP_PATCH;
+  else if (method == "HEAD") req->method_ = HTTP_HEAD;
+  else if (method == "OPTIONS") req->method_ = HTTP_OPTIONS;
+
+  size_t q = target.find('?');
+  req->url_ = String(urlDecode(target.substr(0, q)));
+  if (q != std::string::npos) parseQuery(req, req->params_, target.substr(q + 1), false);
+
+  size_t pos = eol + 2;
+  while (pos < head.size()) {
+    size_t e = head.find("\r\n", pos);
+    std::string h = head.substr(pos, e - pos);
+    size_t colon = h.find(':');
+    if (colon != std::string::npos) {
+      std::string v = h.substr(colon + 1);
+      size_t b = v.find_first_not_of(' ');
+      req->headers_.push_back(new AsyncWebHeader(String(h.substr(0, colon)), String(b == std::string::npos ? "" : v.substr(b))));
+    }
+    pos = e + 2;
+  }
+  req->host_ = String(headerValue(head, "Host"));
+  std::string ctype = headerValue(head, "Content-Type");
+  req->contentType_ = String(ctype);
+  req->body_ = c->in.substr(hend + 4, contentLength);
+  if (ctype.find("application/x-www-form-urlencoded") != std::string::npos) {
+    parseQuery(req, req->params_, req->body_, true);
+  } else if (ctype.find("multipart/form-data") != std::string::npos) {
+    size_t b = ctype.find("boundary=");
+    if (b != std::string::npos) parseMultipart(c, req, req->body_, ctype.substr(b + 9));
+  }
+  c->request = req;
+  return true;
+}
+
+class SimEventLoop {
+public:
+  void start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    listenFd_ = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int family = AF_INET6;
+    if (listenFd_ < 0) {
+      listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      family = AF_INET;
+    }
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    int rc;
+    if (family == AF_INET6) {
+      int zero = 0;
+      setsockopt(listenFd_, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+      sockaddr_in6 addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin6_family = AF_INET6;
+      addr.sin6_addr = in6addr_any;
+      addr.sin6_port = htons(simHttpPort());
+      rc = bind(listenFd_, (sockaddr*)&addr, sizeof(addr));
+    } else {
+      sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(simHttpPort());
+      rc = bind(listenFd_, (sockaddr*)&addr, sizeof(addr));
+    }
+    if (rc != 0 || listen(listenFd_, 64) != 0) {
+      fprintf(stderr, "[sim] cannot listen on port %u: %s\n", simHttpPort(), strerror(errno));
+      exit(1);
+    }
+    fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+    running_ = true;
+    printf("[sim] HTTP server listening on http://localhost:%u/\n", simHttpPort());
+    std::thread([this]() { run(); }).detach();
+  }
+
+private:
+  static const size_t FILL_CHUNK = 2860; // ~2 TCP segments, as AsyncTCP offers per ack
+
+  void closeConnection(SimHttpConnection* c) {
+    if (c->fd >= 0) {
+      shutdown(c->fd, SHUT_RDWR);
+      close(c->fd);
+      c->fd = -1;
+    }
+    if (c->request) {
+      if (c->request->onDisconnect_) c->request->onDisconnect_();
+      delete c->request;
+      c->request = nullptr;
+    }
+  }
+
+  void dispatch(SimHttpConnection* c) {
+    c->dispatched = true;
+    AsyncWebServer* server = g_activeServer;
+    if (!server) {
+      ArRequestHandlerFunction simRoute;
+      {
+        std::lock_guard<std::mutex> lock(g_routeMutex);
+        simRoute = findSimRoute(c->request);
+      }
+      if (simRoute) simRoute(c->request);
+      else c->request->send(503);
+      return;
+    }
+    server->simDispatch(c->request);
+  }
+
+  // Produces more output for the connection. Returns false when nothing more will come.
+  bool produce(SimHttpConnection* c) {
+    AsyncWebServerResponse* r = c->request ? c->request->simResponse() : nullptr;
+    if (!r) return true; // Handler has not answered yet
+    if (!c->headSent) {
+      c->out += r->head();
+      c->headSent = true;
+      if (c->request->method() == HTTP_HEAD) {
+        c->finished = true;
+        return false;
+      }
+    }
+    if (c->finished) return false;
+    uint8_t buf[FILL_CHUNK];
+    size_t n = r->fill(buf, r->chunked() ? FILL_CHUNK - 12 : FILL_CHUNK);
+    if (n == RESPONSE_TRY_AGAIN) return true;
+    if (r->chunked()) {
+      char hdr[16];
+      snprintf(hdr, sizeof(hdr), "%zx\r\n", n);
+      c->out += hdr;
+      c->out.append((const char*)buf, n);
+      c->out += "\r\n";
+      if (n == 0) c->finished = true;
+    } else {
+      c->out.append((const char*)buf, n);
+      if (n == 0) c->finished = true;
+    }
+    return !c->finished;
+  }
+
+  void run() {
+    std::list<SimHttpConnection> conns;
+    std::vector<pollfd> fds;
+    while (true) {
+      fds.clear();
+      fds.push_back({listenFd_, POLLIN, 0});
+      bool busy = false;
+      for (auto& c : conns) {
+        short ev = POLLIN;
+        if (!c.out.empty()) ev |= POLLOUT;
+        if (c.dispatched && c.out.empty() && !c.finished) busy = true;
+        fds.push_back({c.fd, ev, 0});
+      }
+      poll(fds.data(), fds.size(), busy ? 1 : 20);
+
+      if (fds[0].revents & POLLIN) {
+        while (true) {
+          int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+          if (fd < 0) break;
+          fcntl(fd, F_SETFL, O_NONBLOCK);
+          int one = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          SimHttpConnection c;
+          c.fd = fd;
+          c.lastActivity = millis();
+          conns.push_back(std::move(c));
+        }
+      }
+
+      size_t idx = 1;
+      for (auto it = conns.begin(); it != conns.end();) {
+        SimHttpConnection& c = *it;
+        short rev = idx < fds.size() && fds[idx].fd == c.fd ? fds[idx].revents : 0;
+        idx++;
+        bool drop = false;
+
+        if (rev & (POLLIN | POLLHUP | POLLERR)) {
+          char buf[8192];
+          ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+          if (n > 0) {
+            if (!c.dispatched) c.in.append(buf, (size_t)n);
+            c.lastActivity = millis();
+          } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            drop = true;
+          }
+        }
+
+        if (!drop && !c.dispatched && tryParse(&c)) {
+          // Uploads are delivered before the request handler, as the library does while the body streams in.
+          deliverUploads(&c);
+          dispatch(&c);
+        }
+
+        if (!drop && c.dispatched) {
+          if (c.out.empty() && !c.finished) produce(&c);
+          if (!c.out.empty()) {
+            ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n > 0) {
+              c.out.erase(0, (size_t)n);
+              c.lastActivity = millis();
+            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+              drop = true;
+            }
+          }
+          if (c.finished && c.out.empty()) drop = true;
+        }
+
+        if (!drop && millis() - c.lastActivity > 30000) drop = true;
+
+        if (drop) {
+          closeConnection(&c);
+          it = conns.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  void deliverUploads(SimHttpConnection* c) {
+    if (c->uploads.empty() || !g_activeServer) return;
+    ArUploadHandlerFunction upload = findUploadHandler(c->request);
+    if (!upload) return;
+    for (auto& u : c->uploads) {
+      upload(c->request, u.filename, 0, (uint8_t*)&u.data[0], u.data.size(), true);
+    }
+  }
+
+  ArUploadHandlerFunction findUploadHandler(AsyncWebServerRequest* req);
+
+  std::mutex mutex_;
+  bool running_ = false;
+  int listenFd_ = -1;
+
+public:
+  std::vector<AsyncCallbackWebHandler*> uploadHandlers;
+};
+
+static SimEventLoop g_loop;
+
+void simHttpStart() { g_loop.start(); }
+
+ArUploadHandlerFunction SimEventLoop::findUploadHandler(AsyncWebServerRequest* req) {
+  std::lock_guard<std::mutex> lock(g_routeMutex);
+  for (auto* h : uploadHandlers)
+    if (h->onUpload && h->canHandle(req)) return h->onUpload;
+  return nullptr;
+}
+
+void AsyncWebServer::begin() {
+  {
+    std::lock_guard<std::mutex> lock(g_routeMutex);
+    g_loop.uploadHandlers.clear();
+    for (auto& h : handlers_) g_loop.uploadHandlers.push_back(h.get());
+    g_activeServer = this;
+  }
+  running_ = true;
+  g_loop.start();
+}
+
+void AsyncWebServer::end() {
+  std::lock_guard<std::mutex> lock(g_routeMutex);
+  if (g_activeServer == this) g_activeServer = nullptr;
+  running_ = false;
+}
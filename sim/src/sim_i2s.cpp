@@ -0,0 +1,191 @@
+// Simulated INMP441 behind the legacy I2S driver API.
+//
+// Samples are produced at the configured rate by the virtual clock into as many DMA
+// buffers as the real driver has; a reader that falls further behind than they hold
+// loses the oldest buffer and gets an I2S_EVENT_RX_Q_OVF, as on the device. The sound
+// is a WAV file played in a loop (--mic-wav), a tone and/or noise pinned with /sim/mic,
+// or the model: a quiet room (noise around 35 dB SPL) where, every 40 s, someone talks
+// for a few seconds at about 60 dB.
+#include <driver/i2s.h>
+#include "freertos/queue.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <mutex>
+#include <string>
+
+#include "sim.h"
+#include "sim_wav.h"
+
+const double FULL_SCALE = 8388607;     // 24-bit, a sine of this amplitude is 120 dB SPL
+const float ROOM_NOISE_DB = 35;
+const float VOICE_DB = 60;
+const double VOICE_PERIOD_S = 40;
+const double VOICE_LENGTH_S = 4;
+
+struct MicSource {
+  bool overridden;
+  float toneDb, toneHz, noiseDb;       // <= 0 for none
+};
+
+static std::mutex g_micMutex;
+static MicSource g_source = {false, 0, 1000, 0};
+static SimWav g_wav;
+static bool g_wavLoaded = false;
+
+// Driver state; only the capture task calls i2s_read()
+static bool g_installed = false;
+static uint32_t g_rate = 16000;
+static uint32_t g_dmaLen = 256;
+static uint32_t g_dmaCount = 6;
+static QueueHandle_t g_events = nullptr;
+static uint64_t g_startUs = 0;
+static uint64_t g_consumed = 0;        // Frames handed to the reader or lost
+static uint32_t g_rng = 2463534242u;
+
+static double toneAmplitude(float db) {
+  return db > 0 ? FULL_SCALE * pow(10.0, (db - 120) / 20) : 0;
+}
+
+static double noiseRms(float db) {
+  return toneAmplitude(db) / sqrt(2.0);
+}
+
+// Roughly normal, unit variance
+static double gaussian() {
+  double sum = 0;
+  for (int i = 0; i < 4; i++) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    sum += g_rng / 2147483648.0 - 1;
+  }
+  return sum * sqrt(3.0 / 4);
+}
+
+static int32_t sampleAt(uint64_t frame, const MicSource& src) {
+  double t = (double)frame / g_rate;
+  double v;
+  if (src.overridden) {
+    v = toneAmplitude(src.toneDb) * sin(2 * M_PI * src.toneHz * t) + noiseRms(src.noiseDb) * gaussian();
+  } else if (g_wavLoaded && !g_wav.samples.empty()) {
+    return g_wav.samples[frame % g_wav.samples.size()];
+  } else {
+    v = noiseRms(ROOM_NOISE_DB) * gaussian();
+    double cycle = fmod(t, VOICE_PERIOD_S);
+    if (cycle < VOICE_LENGTH_S) {
+      // A 150 Hz voice with falling harmonics, in syllables of a quarter second
+      double syllable = 0.5 * (1 - cos(2 * M_PI * 4 * cycle));
+      double voice = 0;
+      for (int h = 1; h <= 6; h++) voice += sin(2 * M_PI * 150 * h * t) / h;
+      v += toneAmplitude(VOICE_DB) * 0.6 * syllable * voice;
+    }
+  }
+  if (v > FULL_SCALE) v = FULL_SCALE;
+  if (v < -FULL_SCALE - 1) v = -FULL_SCALE - 1;
+  return (int32_t)lround(v);
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queueSize, void* i2s_queue) {
+  (void)port;
+  if (g_installed || !(config->mode & I2S_MODE_RX) || config->bits_per_sample != I2S_BITS_PER_SAMPLE_32BIT ||
+      config->channel_format != I2S_CHANNEL_FMT_ONLY_LEFT || config->dma_buf_count < 2 || config->dma_buf_len < 8) {
+    return ESP_FAIL;
+  }
+  g_rate = config->sample_rate;
+  g_dmaLen = config->dma_buf_len;
+  g_dmaCount = config->dma_buf_count;
+  if (i2s_queue && queueSize > 0) {
+    g_events = xQueueCreate(queueSize, sizeof(i2s_event_t));
+    *(QueueHandle_t*)i2s_queue = g_events;
+  }
+  if (g_wavLoaded && g_wav.rate != g_rate) {
+    fprintf(stderr, "mic: the WAV file is %u Hz, played at %u Hz\n", (unsigned)g_wav.rate, (unsigned)g_rate);
+  }
+  g_startUs = simMicros64();
+  g_consumed = 0;
+  g_installed = true;
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+  (void)port;
+  g_installed = false;
+  return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins) {
+  (void)port;
+  return g_installed && pins->bck_io_num >= 0 && pins->ws_io_num >= 0 && pins->data_in_num >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void* dest, size_t size, size_t* bytesRead, TickType_t ticks) {
+  (void)port;
+  *bytesRead = 0;
+  if (!g_installed) return ESP_FAIL;
+  uint64_t want = size / sizeof(int32_t);
+  uint64_t giveUpUs = ticks == portMAX_DELAY ? UINT64_MAX : simMicros64() + (uint64_t)ticks * 1000;
+  for (;;) {
+    uint64_t now = simMicros64();
+    uint64_t produced = (now - g_startUs) * g_rate / 1000000;
+    // DMA ran out of buffers: the oldest filled one is overwritten
+    while (produced - g_consumed > (uint64_t)g_dmaCount * g_dmaLen) {
+      g_consumed += g_dmaLen;
+      i2s_event_t ev = {I2S_EVENT_RX_Q_OVF, g_dmaLen * sizeof(int32_t)};
+      if (g_events) xQueueSend(g_events, &ev, 0);
+    }
+    uint64_t avail = produced - g_consumed;
+    if (avail >= want) break;
+    if (now >= giveUpUs) {
+      want = avail;
+      break;
+    }
+    simSleepMicros((want - avail) * 1000000 / g_rate + 1);
+  }
+
+  MicSource src;
+  {
+    std::lock_guard<std::mutex> lock(g_micMutex);
+    src = g_source;
+  }
+  int32_t* out = (int32_t*)dest;
+  for (uint64_t i = 0; i < want; i++) out[i] = (int32_t)((uint32_t)sampleAt(g_consumed + i, src) << 8);
+  g_consumed += want;
+  *bytesRead = want * sizeof(int32_t);
+  return ESP_OK;
+}
+
+bool simMicSetWav(const char* path) {
+  std::string error;
+  SimWav wav;
+  if (!simLoadWav(path, wav, error)) {
+    fprintf(stderr, "--mic-wav %s: %s\n", path, error.c_str());
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(g_micMutex);
+  g_wav = wav;
+  g_wavLoaded = true;
+  return true;
+}
+
+void simMicOverride(float toneDb, float toneHz, float noiseDb) {
+  std::lock_guard<std::mutex> lock(g_micMutex);
+  g_source = {true, toneDb, toneHz, noiseDb};
+}
+
+void simMicClearOverride() {
+  std::lock_guard<std::mutex> lock(g_micMutex);
+  g_source.overridden = false;
+}
+
+SimMicState simMicState() {
+  std::lock_guard<std::mutex> lock(g_micMutex);
+  SimMicState s;
+  s.running = g_installed;
+  s.source = g_source.overridden ? "override" : (g_wavLoaded ? "wav" : "model");
+  s.toneDb = g_source.toneDb;
+  s.toneHz = g_source.toneHz;
+  s.noiseDb = g_source.noiseDb;
+  return s;
+}
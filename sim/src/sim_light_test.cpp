@@ -0,0 +1,191 @@
+// --light-test: runs the firmware's BH1750 driver (bh1750.h) against the register-level
+// emulation in sim_sensors.cpp on a fast virtual clock, without the pause between
+// measurements, sweeping the light from LIGHT_SWEEP_MIN_LUX to LIGHT_SWEEP_MAX_LUX and
+// back in log steps. A reference follows the same measurements from the datasheet: the
+// count of each range (lux * 1.2 * MTreg / 69, doubled in H-resolution mode 2,
+// saturating at 0xFFFF), one range coarser at 90 % of full scale, one finer when the
+// reading is under 40 % of the finer range's full scale. Every range change must match
+// it; a clipped count must be re-measured at once in the coarser range without becoming
+// a reading; and every reading must be within one count of the light, or full scale
+// beyond the coarsest range. Each measurement must be given the datasheet's longest
+// conversion time. At each level the range must settle and stay put. Then each
+// threshold is checked a count either side. The exit code is 1 if any check fails.
+#include "bh1750.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+// Virtual clock speed. Host stalls are multiplied by it, so a conversion can start late
+// in virtual time; readings are collected once the emulation has finished it, as it
+// would have by the deadline on the device.
+const double LIGHT_TEST_SPEED = 50;
+const float LIGHT_SWEEP_MIN_LUX = 0.05f;
+const float LIGHT_SWEEP_MAX_LUX = 150000;
+const int LIGHT_SWEEP_STEPS = 60;           // Each way
+const int LIGHT_SETTLE_READINGS = 5;        // Most readings a level may take to settle
+
+// Counts per lux of each range, from the datasheet: mode 2 doubles, MTreg scales
+static const double COUNTS_PER_LUX[BH1750_RANGES] = {1.2 * 254 / 69 * 2, 1.2 * 2, 1.2, 1.2 * 31 / 69};
+// Longest conversion of each range, from the datasheet: 180 ms at MTreg 69, scaled by MTreg
+static const uint32_t CONVERSION_MAX_MS[BH1750_RANGES] = {663, 180, 180, 81};
+
+static int g_failures = 0;
+static int g_reported = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+static void fail(float lux, const char* what) {
+  g_failures++;
+  if (g_reported++ < 10) printf("  FAIL at %g lx: %s\n", lux, what);
+}
+
+static uint16_t expectedCount(float lux, uint8_t range) {
+  double counts = floor(lux * COUNTS_PER_LUX[range]);
+  return counts >= 65535 ? 65535 : (uint16_t)counts;
+}
+
+// What the reference does with a count measured in range: the next range, and whether
+// the count clipped and must be measured again
+static uint8_t nextRange(uint8_t range, uint16_t count, bool& clipped) {
+  clipped = false;
+  if (count >= 0.9 * 65535 && range + 1 < BH1750_RANGES) {
+    clipped = count == 65535;
+    return range + 1;
+  }
+  if (range > 0 && count / COUNTS_PER_LUX[range] * COUNTS_PER_LUX[range - 1] < 0.4 * 65535) return range - 1;
+  return range;
+}
+
+struct LightReference {
+  uint32_t readings;
+  uint32_t rangeChanges;
+  uint32_t remeasures;
+  uint32_t used[BH1750_RANGES];   // Readings taken in each range
+};
+
+// Sets the light and polls until the driver has a reading (or fails), checking every
+// measurement against the reference. True if the reading was taken in the range it
+// ended up in.
+static bool measure(Bh1750& s, LightReference& ref, float lux) {
+  simOverrideEnvironment(21, 45, 1013, lux);
+  if (!s.measuring) s.dueMs = millis();   // Skips the rest of BH1750_INTERVAL_MS
+  for (int polls = 0; polls < 2 * BH1750_RANGES + 2; polls++) {
+    int32_t wait = (int32_t)(bh1750Deadline(s) - millis());
+    if (wait > 0) delay(wait);
+    while (s.measuring && simBh1750Converting()) delay(1);
+    uint8_t measured = s.range;
+    uint32_t nowMs = millis();
+    Bh1750Status status = bh1750Poll(s, nowMs);
+    if (status == BH1750_STARTED && bh1750Deadline(s) - nowMs < CONVERSION_MAX_MS[s.range]) {
+      fail(lux, "the reading is due before the longest conversion");
+    }
+    if (status == BH1750_STARTED || status == BH1750_IDLE) continue;
+    if (status == BH1750_FAILED) {
+      fail(lux, "the sensor did not answer");
+      return false;
+    }
+
+    uint16_t count = expectedCount(lux, measured);
+    bool clipped;
+    uint8_t next = nextRange(measured, count, clipped);
+    if (next != measured) ref.rangeChanges++;
+    if (s.range != next) fail(lux, "range change differs from the reference");
+    if (clipped) {
+      ref.remeasures++;
+      if (status != BH1750_RANGING) fail(lux, "a clipped count is not re-measured");
+      if (bh1750Deadline(s) != nowMs) fail(lux, "the re-measure is not due at once");
+      if (s.readings != ref.readings) fail(lux, "a clipped count became a reading");
+      continue;
+    }
+    if (status != BH1750_READING) {
+      fail(lux, "an unclipped count is not a reading");
+      return false;
+    }
+
+    ref.readings++;
+    ref.used[measured]++;
+    if (s.raw != count) fail(lux, "the count differs from the datasheet's");
+    float got = bh1750Lux(s);
+    bool ok;
+    if (count == 65535) ok = fabs(got - 65535 / COUNTS_PER_LUX[measured]) < 0.01;   // Beyond the coarsest range
+    else ok = got <= lux * 1.0001f && lux - got <= 1 / COUNTS_PER_LUX[measured] * 1.0001;
+    if (!ok && g_reported++ < 10) {
+      printf("  FAIL at %g lx: read back %g lx in the %s range (count %u)\n", lux, got,
+             bh1750RangeName((Bh1750Range)measured), (unsigned)count);
+    }
+    if (!ok) g_failures++;
+    return next == measured;
+  }
+  fail(lux, "no reading");
+  return false;
+}
+
+// Light that gives exactly count in range r
+static float luxForCount(uint8_t r, uint32_t count) {
+  return (float)((count + 0.5) / COUNTS_PER_LUX[r]);
+}
+
+// Readings at one level until the range settles; then one more must not move it
+static void level(Bh1750& s, LightReference& ref, float lux) {
+  bool settled = false;
+  for (int i = 0; i < LIGHT_SETTLE_READINGS && !settled; i++) settled = measure(s, ref, lux);
+  if (!settled) fail(lux, "the range does not settle");
+  else if (!measure(s, ref, lux)) fail(lux, "the range moves again after settling");
+}
+
+int simLightTest() {
+  simClockInit(LIGHT_TEST_SPEED);
+  simSensorsBegin();
+  Wire.begin();
+  Bh1750 s;
+  check(bh1750Begin(s, Wire, millis()), "the emulated BH1750 answers");
+  LightReference ref = {0, 0, 0, {0}};
+
+  double ratio = pow(LIGHT_SWEEP_MAX_LUX / LIGHT_SWEEP_MIN_LUX, 1.0 / LIGHT_SWEEP_STEPS);
+  for (int i = 0; i <= LIGHT_SWEEP_STEPS; i++) level(s, ref, LIGHT_SWEEP_MIN_LUX * pow(ratio, i));
+  for (int i = LIGHT_SWEEP_STEPS - 1; i >= 0; i--) level(s, ref, LIGHT_SWEEP_MIN_LUX * pow(ratio, i));
+  // Straight from the dark into sunlight and back: clips all the way up
+  level(s, ref, LIGHT_SWEEP_MAX_LUX);
+  level(s, ref, LIGHT_SWEEP_MIN_LUX);
+  level(s, ref, LIGHT_SWEEP_MAX_LUX);
+  // Each threshold from both sides, in the range it applies to: just under 90 % of full
+  // scale stays, 90 % moves coarser; a reading just over 40 % of the finer range's full
+  // scale stays, just under moves finer. Range r is reached from the dark.
+  for (uint8_t r = 0; r + 1 < BH1750_RANGES; r++) {
+    uint32_t up = (uint32_t)ceil(0.9 * 65535);
+    level(s, ref, LIGHT_SWEEP_MIN_LUX);
+    for (uint8_t k = 0; k < r; k++) measure(s, ref, luxForCount(k, up));
+    level(s, ref, luxForCount(r, up / 2));
+    if (s.range != r) fail(luxForCount(r, up / 2), "not in the range whose thresholds are checked");
+    measure(s, ref, luxForCount(r, up - 1));
+    if (s.range != r) fail(luxForCount(r, up - 1), "moved coarser under 90 % of full scale");
+    measure(s, ref, luxForCount(r, up));
+    if (s.range != r + 1) fail(luxForCount(r, up), "did not move coarser at 90 % of full scale");
+    uint32_t down = (uint32_t)ceil(0.4 * 65535 / COUNTS_PER_LUX[r] * COUNTS_PER_LUX[r + 1]);
+    measure(s, ref, luxForCount(r + 1, down + 1));
+    if (s.range != r + 1) fail(luxForCount(r + 1, down + 1), "moved finer over 40 % of the finer full scale");
+    measure(s, ref, luxForCount(r + 1, down - 1));
+    if (s.range != r) fail(luxForCount(r + 1, down - 1), "did not move finer under 40 % of the finer full scale");
+  }
+  simClearEnvironmentOverride();
+
+  check(s.readings == ref.readings, "the driver counts the same readings");
+  check(s.rangeChanges == ref.rangeChanges, "the driver counts the same range changes");
+  check(s.failures == 0, "no failed measurement");
+  check(ref.remeasures >= 3, "clipped counts were re-measured");
+  for (uint8_t r = 0; r < BH1750_RANGES; r++) check(ref.used[r] > 0, "every range was used");
+  printf("  %u readings (dark %u, dim %u, normal %u, bright %u), %u range changes, %u clipped and re-measured\n",
+         (unsigned)ref.readings, (unsigned)ref.used[0], (unsigned)ref.used[1], (unsigned)ref.used[2],
+         (unsigned)ref.used[3], (unsigned)ref.rangeChanges, (unsigned)ref.remeasures);
+  printf("light: %s\n", g_failures ? "FAILED" : "ranging as the datasheet reference, every reading within a count");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+// --log-bench: what a log call costs on the host (log_ring.h), against the synchronous
+// Serial.printf() it replaced, and whether the hot path ever waits for the UART.
+//
+// The UART is modelled as a 128-byte TX FIFO draining at 115200 baud (11520 bytes/s);
+// a write that finds it full spins until there is room, as the ESP32 driver does.
+// The formatter is checked against snprintf() on the same arguments first; the exit
+// code is 1 if any of them differs.
+#include "log_ring.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double UART_BYTES_PER_SEC = 11520;
+const double UART_FIFO_BYTES = 128;
+const uint32_t BURST_CALLS = 40;            // A boot or an alarm: many lines at once
+const uint32_t BURSTS = 10;
+const uint32_t BURST_GAP_MS = 300;    // Long enough for the UART to catch up
+
+typedef std::chrono::steady_clock Clock;
+
+static LogRing g_ring;                      // 7 KB; kept off the stack
+
+static uint64_t cycleCount() {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static double nsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// A UART with a TX FIFO: write() returns as soon as the bytes are in the FIFO
+class UartModel : public Print {
+public:
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t*, size_t len) override {
+    for (size_t i = 0; i < len; i++) {
+      while (fill() >= UART_FIFO_BYTES) {
+      }
+      queued_ += 1;
+    }
+    bytes += len;
+    return len;
+  }
+  using Print::write;
+  uint64_t bytes = 0;
+
+private:
+  // Bytes still in the FIFO
+  double fill() {
+    double now = std::chrono::duration<double>(Clock::now() - start_).count();
+    double sent = now * UART_BYTES_PER_SEC;
+    if (sent > queued_) {
+      queued_ = sent;   // Idle line: nothing carries over
+    }
+    return queued_ - sent;
+  }
+  Clock::time_point start_ = Clock::now();
+  double queued_ = 0;
+};
+
+// --- Formatter check ---
+
+static bool checkFormat(const char* expected, LogMessage message, const LogArgs& args) {
+  LogEntry e = {};
+  e.message = message;
+  e.args = args;
+  char out[LOG_LINE_MAX];
+  logFormat(e, out, sizeof(out));
+  bool ok = strcmp(out, expected) == 0;
+  if (!ok) printf("  MISMATCH \"%s\" != \"%s\"\n", out, expected);
+  return ok;
+}
+
+template <typename... Args>
+static LogArgs encode(const Args&... args) {
+  LogArgs a;
+  a.count = a.types = a.len = 0;
+  a.total = sizeof...(Args);
+  int expand[] = {0, (logArg(a, args), 0)...};
+  (void)expand;
+  return a;
+}
+
+static bool checkFormatter() {
+  char expected[LOG_LINE_MAX];
+  bool ok = true;
+  float t = 23.456f, h = 41.2f, p = 1013.25f;
+  snprintf(expected, sizeof(expected), "T: %.2f C, H: %.2f %%, P: %.2f hPa", t, h, p);
+  ok &= checkFormat(expected, LOG_MSG_SENSOR_READING, encode(t, h, p));
+  ok &= checkFormat("Wi-Fi connected after 3120 ms, IP Address: 192.168.1.42", LOG_MSG_WIFI_CONNECTED,
+                    encode(3120UL, "192.168.1.42"));
+  ok &= checkFormat("OTA Error[4]", LOG_MSG_OTA_ERROR, encode(4u));
+  ok &= checkFormat("OTA progress: 70%", LOG_MSG_OTA_PROGRESS, encode(70u));
+  ok &= checkFormat("I2C bus unavailable, keeping last AHT20 reading", LOG_MSG_SENSOR_BUS_BUSY, encode("AHT20"));
+  // A long string is cut short so the number after it still fits
+  ok &= checkFormat("Bench 7: T: 1.50 C, H: 2.00 %, a string much longer than t", LOG_MSG_LOG_BENCH,
+                    encode(7u, 1.5f, 2.0f, "a string much longer than the argument space"));
+  // Missing arguments show as '?'
+  ok &= checkFormat("T: 1.00 C, H: ? %, P: ? hPa", LOG_MSG_SENSOR_READING, encode(1.0f));
+  printf("formatter: %s\n", ok ? "all lines match snprintf()" : "MISMATCH");
+  return ok;
+}
+
+// --- Timing ---
+
+struct Timing {
+  double ns;
+  double cycles;   // Host TSC cycles; 0 without a TSC
+};
+
+// Runs call() until BENCH_MIN_SEC have gone by; time per call
+template <typename Call>
+static Timing timePerCall(Call call) {
+  const uint32_t batch = 1000;
+  auto start = Clock::now();
+  uint64_t startCycles = cycleCount();
+  double elapsed = 0;
+  uint64_t calls = 0;
+  do {
+    for (uint32_t i = 0; i < batch; i++) call(i);
+    calls += batch;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return {elapsed * 1e9 / calls, (double)(cycleCount() - startCycles) / calls};
+}
+
+static void report(const char* name, Timing t) {
+  if (t.cycles > 0) printf("  %-24s %8.1f ns/call %8.0f cycles/call\n", name, t.ns, t.cycles);
+  else printf("  %-24s %8.1f ns/call\n", name, t.ns);
+}
+
+struct Latency {
+  double maxNs;
+  double p99Ns;
+  double meanNs;
+};
+
+static Latency summarize(std::vector<double>& ns) {
+  std::sort(ns.begin(), ns.end());
+  double sum = 0;
+  for (double v : ns) sum += v;
+  return {ns.back(), ns[ns.size() * 99 / 100], sum / ns.size()};
+}
+
+// BURSTS bursts of BURST_CALLS sensor-reading lines; the latency of every call
+template <typename Call>
+static Latency timeBursts(Call call) {
+  std::vector<double> ns;
+  ns.reserve(BURSTS * BURST_CALLS);
+  for (uint32_t b = 0; b < BURSTS; b++) {
+    for (uint32_t i = 0; i < BURST_CALLS; i++) {
+      auto start = Clock::now();
+      call(b * BURST_CALLS + i);
+      ns.push_back(nsSince(start));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BURST_GAP_MS));
+  }
+  return summarize(ns);
+}
+
+static void reportLatency(const char* name, Latency l) {
+  printf("  %-24s mean %9.0f ns  p99 %11.0f ns  max %11.0f ns\n", name, l.meanNs, l.p99Ns, l.maxNs);
+}
+
+int simLogBench() {
+  simClockInit(1.0);
+  if (!checkFormatter()) return 1;
+
+  float t = 23.45f, h = 41.2f, p = 1013.2f;
+  volatile uint32_t sink = 0;
+  printf("per call (host, nothing draining the ring, %u entries of %u bytes):\n", (unsigned)LOG_RING_ENTRIES,
+         (unsigned)sizeof(LogEntry));
+  logRingBegin(g_ring);
+  report("log, no arguments", timePerCall([&](uint32_t) { logWriteTo(g_ring, LOG_MSG_AHT_READ_FAILED); }));
+  report("log, 3 floats", timePerCall([&](uint32_t i) { logWriteTo(g_ring, LOG_MSG_SENSOR_READING, t + i, h, p); }));
+  report("log, uint + string", timePerCall([&](uint32_t i) {
+    logWriteTo(g_ring, LOG_MSG_WIFI_CONNECTED, i, "192.168.1.42");
+  }));
+  char line[LOG_LINE_MAX];
+  report("snprintf of the same", timePerCall([&](uint32_t i) {
+    sink += snprintf(line, sizeof(line), "T: %.2f C, H: %.2f %%, P: %.2f hPa\n", t + i, h, p);
+  }));
+  LogEntry e;
+  logRead(g_ring, g_ring.written, e);
+  report("format one entry", timePerCall([&](uint32_t) { sink += logFormat(e, line, sizeof(line)); }));
+
+  // Burst latency against the modelled UART: synchronous printf first
+  printf("bursts of %u lines every %u ms, UART at 115200 baud with a %u-byte FIFO:\n", (unsigned)BURST_CALLS,
+         (unsigned)BURST_GAP_MS, (unsigned)UART_FIFO_BYTES);
+  UartModel syncUart;
+  Latency sync = timeBursts([&](uint32_t i) {
+    syncUart.printf("T: %.2f C, H: %.2f %%, P: %.2f hPa\n", t + i, h, p);
+  });
+  reportLatency("Serial.printf()", sync);
+
+  // Then the ring, drained by the log task into another modelled UART
+  UartModel drainUart;
+  logBegin(drainUart);
+  LogStats before = logStats();
+  Latency ring = timeBursts([&](uint32_t i) { logWrite(LOG_MSG_SENSOR_READING, t + i, h, p); });
+  reportLatency("logWrite()", ring);
+  logFlush();
+  LogStats after = logStats();
+  uint32_t written = after.written - before.written;
+  printf("  drained %u of %u entries (%u overwritten before printing, %llu bytes to the UART)\n",
+         (unsigned)(after.printed - before.printed), (unsigned)written, (unsigned)(after.lost - before.lost),
+         (unsigned long long)drainUart.bytes);
+  printf("  worst call %.0fx faster than Serial.printf()\n", sync.maxNs / ring.maxNs);
+  return 0;
+}
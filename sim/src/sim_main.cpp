@@ -0,0 +1,243 @@
+// Entry point of the full-device simulator: parses the command line, registers
+// the /sim/* control routes and runs the firmware's setup()/loop().
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include <ESPAsyncWebServer.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <esp_system.h>
+#include <signal.h>
+
+#include <fstream>
+
+#include "sim.h"
+#include "sim_png.h"
+
+static uint8_t g_touchPin = 7;
+static int g_pngScale = 4;
+
+// Renders the panel as the user sees it (rotation undone, contrast as brightness).
+static std::string panelPng() {
+  SimPanel p = simPanelSnapshot();
+  const int W = 128, H = 64, S = g_pngScale;
+  std::string gray((size_t)W * H * S * S, '\0');
+  uint8_t on = p.on ? (uint8_t)(64 + (p.contrast * 191) / 255) : 0;
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) {
+      int px = x, py = y;
+      if (p.rotation == 2) {
+        px = W - 1 - x;
+        py = H - 1 - y;
+      }
+      bool lit = (p.pixels[px + (py / 8) * W] >> (py & 7)) & 1;
+      if (p.inverted) lit = !lit;
+      uint8_t v = lit ? on : 0;
+      for (int dy = 0; dy < S; dy++)
+        for (int dx = 0; dx < S; dx++) gray[(size_t)(y * S + dy) * W * S + x * S + dx] = (char)v;
+    }
+  }
+  return simEncodePng((const uint8_t*)gray.data(), W * S, H * S);
+}
+
+static void registerControlRoutes() {
+  simHttpAddRoute("/sim/oled.png", [](AsyncWebServerRequest* request) {
+    std::string png = panelPng();
+    request->send(request->beginResponse_P(200, "image/png", (const uint8_t*)png.data(), png.size()));
+  });
+
+  simHttpAddRoute("/sim/touch", [](AsyncWebServerRequest* request) {
+    uint32_t ms = request->hasParam("ms") ? (uint32_t)request->getParam("ms")->value().toInt() : 80;
+    simPulsePin(g_touchPin, ms);
+    request->send(200, "text/plain", "OK");
+  });
+
+  simHttpAddRoute("/sim/sensors", [](AsyncWebServerRequest* request) {
+    if (request->hasParam("auto")) {
+      simClearEnvironmentOverride();
+    } else if (request->hasParam("temp") || request->hasParam("hum") || request->hasParam("pressure") ||
+               request->hasParam("lux")) {
+      SimEnvironment env = simReadEnvironment();
+      float t = request->hasParam("temp") ? request->getParam("temp")->value().toFloat() : env.tempC;
+      float h = request->hasParam("hum") ? request->getParam("hum")->value().toFloat() : env.humidity;
+      float p = request->hasParam("pressure") ? request->getParam("pressure")->value().toFloat() : env.pressure_hPa;
+      float l = request->hasParam("lux") ? request->getParam("lux")->value().toFloat() : env.lux;
+      simOverrideEnvironment(t, h, p, l);
+    }
+    SimEnvironment env = simReadEnvironment();
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "{\"tempC\":%.2f,\"humidity\":%.2f,\"pressure_hPa\":%.2f,\"lux\":%.2f,\"override\":%s}",
+             env.tempC, env.humidity, env.pressure_hPa, env.lux, env.overridden ? "true" : "false");
+    request->send(200, "application/json", buf);
+  });
+
+  simHttpAddRoute("/sim/mic", [](AsyncWebServerRequest* request) {
+    if (request->hasParam("auto")) {
+      simMicClearOverride();
+    } else if (request->hasParam("tone") || request->hasParam("hz") || request->hasParam("noise")) {
+      SimMicState m = simMicState();
+      float tone = request->hasParam("tone") ? request->getParam("tone")->value().toFloat() : 0;
+      float hz = request->hasParam("hz") ? request->getParam("hz")->value().toFloat() : m.toneHz;
+      float noise = request->hasParam("noise") ? request->getParam("noise")->value().toFloat() : 0;
+      simMicOverride(tone, hz, noise);
+    }
+    SimMicState m = simMicState();
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"running\":%s,\"source\":\"%s\",\"tone_db\":%.1f,\"hz\":%.1f,\"noise_db\":%.1f}",
+             m.running ? "true" : "false", m.source, m.toneDb, m.toneHz, m.noiseDb);
+    request->send(200, "application/json", buf);
+  });
+
+  simHttpAddRoute("/sim/i2c", [](AsyncWebServerRequest* request) {
+    if (request->hasParam("stuck")) simI2CSetStuck(request->getParam("stuck")->value().toInt() != 0);
+    request->send(200, "application/json", simI2CIsStuck() ? "{\"stuck\":true}" : "{\"stuck\":false}");
+  });
+
+  // Asks the portal's DNS responder (port 53) for name, as a phone probing for a captive
+  // portal would: {"answered":bool,"address":"a.b.c.d" or null}
+  simHttpAddRoute("/sim/dns", [](AsyncWebServerRequest* request) {
+    String name = request->hasParam("name") ? request->getParam("name")->value() : String("connectivitycheck.gstatic.com");
+    std::string q = {0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+    int start = 0;
+    while (start <= (int)name.length()) {
+      int dot = name.indexOf('.', start);
+      if (dot < 0) dot = name.length();
+      q += (char)(dot - start);
+      q += name.substring(start, dot).c_str();
+      start = dot + 1;
+    }
+    q += std::string("\0\0\1\0\1", 5); // End of name, type A, class IN
+    std::string reply;
+    simUdpDeliver(53, (const uint8_t*)q.data(), q.size(), reply);
+    char buf[96];
+    if (reply.size() >= q.size() + 16) {
+      const uint8_t* a = (const uint8_t*)reply.data() + q.size() + 12;
+      snprintf(buf, sizeof(buf), "{\"answered\":true,\"address\":\"%u.%u.%u.%u\"}", a[0], a[1], a[2], a[3]);
+    } else {
+      snprintf(buf, sizeof(buf), "{\"answered\":%s,\"address\":null}", reply.empty() ? "false" : "true");
+    }
+    request->send(200, "application/json", buf);
+  });
+
+  // Resets the device the way a fault would: kind=panic (a real SIGSEGV), wdt or brownout
+  simHttpAddRoute("/sim/crash", [](AsyncWebServerRequest* request) {
+    String kind = request->hasParam("kind") ? request->getParam("kind")->value() : String("panic");
+    if (kind == "wdt") simReset(ESP_RST_TASK_WDT, "Task watchdog got triggered");
+    else if (kind == "brownout") simReset(ESP_RST_BROWNOUT, "Brownout detector was triggered");
+    else if (kind == "panic") raise(SIGSEGV);
+    request->send(400, "text/plain", "kind must be panic, wdt or brownout");
+  });
+
+  simHttpAddRoute("/sim/status", [](AsyncWebServerRequest* request) {
+    SimPanel p = simPanelSnapshot();
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\"uptime_ms\":%lu,\"speed\":%.2f,\"buzzer_hz\":%u,\"oled_on\":%s,\"oled_contrast\":%u,"
+             "\"oled_flushes\":%u,\"touch\":%d,\"i2c_clock\":%u}",
+             millis(), simSpeed(), simBuzzerFrequency(), p.on ? "true" : "false", p.contrast, p.flushes,
+             digitalRead(g_touchPin), Wire.getClock());
+    request->send(200, "application/json", buf);
+  });
+}
+
+static void usage(const char* argv0) {
+  printf("Usage: %s [options]\n"
+         "  --port N         Host port that serves the device's port 80 (default 8080)\n"
+         "  --speed X        Virtual clock speed multiplier (default 1.0)\n"
+         "  --state DIR      Directory for NVS / flash state (default ./sim_state)\n"
+         "  --no-wifi        Station connects fail (boots into the captive portal)\n"
+         "  --touch-pin N    GPIO used as the touch input (default 7)\n"
+         "  --png-scale N    Pixel scale of /sim/oled.png (default 4)\n"
+         "  --mic-wav FILE   Play FILE in a loop into the simulated microphone\n"
+         "  --sound-bench FILE  Time the sound level kernels on FILE (WAV) and exit\n"
+         "  --voice-bench FILE  Time the VAD/MFCC kernels on FILE (WAV), check them against a\n"
+         "                      reference and exit (1 on a mismatch)\n"
+         "  --power-test     Check when the power manager light-sleeps, estimate a day and exit\n"
+         "  --eye-bench      Check the eye frames against the GFX drawing, time both and exit\n"
+         "  --eye-test       Check the eye animator's key frames and frame slots and exit\n"
+         "  --log-bench      Check the log formatter, time log calls against Serial.printf() and exit\n"
+         "  --trace-test     Check the crash trace encoder and decoder, time a trace event and exit\n"
+         "  --snapshot-test  Hammer the sensor snapshot from writer and reader threads, check every copy and exit\n"
+         "  --anomaly-test   Feed the anomaly detector injected sensor faults, check what it flags and exit\n"
+         "  --pressure-test [DIR]  Replay the pressure traces in DIR (default sim/traces) through\n"
+         "                      the forecast, check it against exact fits and exit\n"
+         "  --light-test     Sweep the light through the emulated BH1750, check the driver's ranging and exit\n"
+         "  --sampler-test [FILE]  Replay a sensor trace (default a synthetic day) through the\n"
+         "                      adaptive sampler, report the reads it saves, check it and exit\n"
+         "  --history-test   Check /history?after= syncing through dropped polls and restarts and exit\n"
+         "  --stats-bench    Check the rolling statistics against exact windows, time a reading and exit\n"
+         "  --quantile-test  Check the percentile sketches against exact percentiles, time them and exit\n"
+         "  --export-bench   Stream full sample exports, check their slots and rate and exit\n"
+         "  --api-bench      Check /data and /history CBOR against the JSON, time both and exit\n"
+         "  --render-bench   Render the main page with replace() and streamed, compare, time both and exit\n"
+         "  --dns-test       Check the captive portal's DNS answers and exit\n",
+         argv0);
+}
+
+int main(int argc, char** argv) {
+  simSetArgs(argc, argv);
+  double speed = 1.0;
+  for (int i = 1; i < argc; i++) {
+    String a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--port" && hasValue) simHttpSetPort((uint16_t)atoi(argv[++i]));
+    else if (a == "--speed" && hasValue) speed = atof(argv[++i]);
+    else if (a == "--state" && hasValue) simSetStateDir(argv[++i]);
+    else if (a == "--no-wifi") simWiFiSetAvailable(false);
+    else if (a == "--touch-pin" && hasValue) g_touchPin = (uint8_t)atoi(argv[++i]);
+    else if (a == "--png-scale" && hasValue) g_pngScale = std::max(1, atoi(argv[++i]));
+    else if (a == "--mic-wav" && hasValue) {
+      if (!simMicSetWav(argv[++i])) return 2;
+    } else if (a == "--sound-bench" && hasValue) {
+      return simSoundBench(argv[++i]);
+    } else if (a == "--voice-bench" && hasValue) {
+      return simVoiceBench(argv[++i]);
+    } else if (a == "--power-test") {
+      return simPowerTest();
+    } else if (a == "--eye-bench") {
+      return simEyeBench();
+    } else if (a == "--eye-test") {
+      return simEyeTest();
+    } else if (a == "--log-bench") {
+      return simLogBench();
+    } else if (a == "--trace-test") {
+      return simTraceTest();
+    } else if (a == "--snapshot-test") {
+      return simSnapshotTest();
+    } else if (a == "--anomaly-test") {
+      return simAnomalyTest();
+    } else if (a == "--pressure-test") {
+      return simPressureTest(hasValue && argv[i + 1][0] != '-' ? argv[i + 1] : "sim/traces");
+    } else if (a == "--light-test") {
+      return simLightTest();
+    } else if (a == "--sampler-test") {
+      return simSamplerTest(hasValue && argv[i + 1][0] != '-' ? argv[i + 1] : nullptr);
+    } else if (a == "--history-test") {
+      return simHistoryTest();
+    } else if (a == "--stats-bench") {
+      return simStatsBench();
+    } else if (a == "--quantile-test") {
+      return simQuantileTest();
+    } else if (a == "--export-bench") {
+      return simExportBench();
+    } else if (a == "--api-bench") {
+      return simApiBench();
+    } else if (a == "--render-bench") {
+      return simRenderBench();
+    } else if (a == "--dns-test") {
+      return simDnsTest();
+    } else {
+      usage(argv[0]);
+      return a == "--help" ? 0 : 2;
+    }
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  simResetBoot();
+  simClockInit(speed);
+  simSensorsBegin();
+  registerControlRoutes();
+
+  setup();
+  simHttpStart(); // For /sim/touch in DATA_COLLECTION_MODE, which runs no web server
+  for (;;) loop();
+}
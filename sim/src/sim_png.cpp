@@ -0,0 +1,82 @@
+#include "sim_png.h"
+
+#include <vector>
+
+static uint32_t crcTable[256];
+
+static void initCrc() {
+  if (crcTable[1]) return;
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crcTable[n] = c;
+  }
+}
+
+static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  crc ^= 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static void put32(std::string& out, uint32_t v) {
+  out += (char)(v >> 24);
+  out += (char)(v >> 16);
+  out += (char)(v >> 8);
+  out += (char)v;
+}
+
+static void chunk(std::string& out, const char* type, const std::string& data) {
+  put32(out, (uint32_t)data.size());
+  std::string body = std::string(type, 4) + data;
+  out += body;
+  put32(out, crc32((const uint8_t*)body.data(), body.size()));
+}
+
+std::string simEncodePng(const uint8_t* gray, uint32_t width, uint32_t height) {
+  initCrc();
+  // Raw scanlines, each prefixed with filter type 0.
+  std::string raw;
+  raw.reserve((width + 1) * height);
+  for (uint32_t y = 0; y < height; y++) {
+    raw += '\0';
+    raw.append((const char*)gray + y * width, width);
+  }
+  // zlib stream made of stored blocks.
+  std::string z;
+  z += (char)0x78;
+  z += (char)0x01;
+  size_t pos = 0;
+  do {
+    size_t n = raw.size() - pos;
+    if (n > 65535) n = 65535;
+    bool final = pos + n == raw.size();
+    z += (char)(final ? 1 : 0);
+    z += (char)(n & 0xFF);
+    z += (char)(n >> 8);
+    z += (char)(~n & 0xFF);
+    z += (char)((~n >> 8) & 0xFF);
+    z.append(raw, pos, n);
+    pos += n;
+  } while (pos < raw.size());
+  uint32_t a = 1, b = 0;
+  for (unsigned char c : raw) {
+    a = (a + c) % 65521;
+    b = (b + a) % 65521;
+  }
+  put32(z, (b << 16) | a);
+
+  std::string png("\x89PNG\r\n\x1a\n", 8);
+  std::string ihdr;
+  put32(ihdr, width);
+  put32(ihdr, height);
+  ihdr += (char)8; // bit depth
+  ihdr += (char)0; // grayscale
+  ihdr += (char)0;
+  ihdr += (char)0;
+  ihdr += (char)0;
+  chunk(png, "IHDR", ihdr);
+  chunk(png, "IDAT", z);
+  chunk(png, "IEND", std::string());
+  return png;
+}
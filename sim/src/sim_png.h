@@ -0,0 +1,8 @@
+// Minimal PNG encoder (8-bit grayscale, stored/uncompressed deflate blocks).
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+std::string simEncodePng(const uint8_t* gray, uint32_t width, uint32_t height);
@@ -0,0 +1,322 @@
+// --power-test: runs the firmware's power manager (power_manager.h) on the simulated
+// clock, touch pin and Wi-Fi. It checks the sleep policy first.
+//   - A wait is counted as light sleep only when the loop allows it and the radio can
+//     sleep (a station in modem sleep, or the radio off).
+//   - Every other wait holds the no-light-sleep lock for its whole length.
+//   - A build without tickless idle never sleeps.
+//   - Waits are capped at POWER_MAX_IDLE_MS.
+//   - A touch or powerWake() ends a wait early.
+// Then it runs a day of the loop's deadlines through the real powerIdleUntil() on the
+// stepped clock. The day is shaped by touches, the OLED timeout and quiet hours. It runs
+// in a build without tickless idle, one with it, and the previous 10 ms polling loop,
+// and prints the duty cycle, sleep fraction, average current and mAh per day from the
+// power manager's own totals. The per-task costs are rough, and the currents are the
+// estimator's datasheet figures, so the output is an estimate, not a measurement. The
+// exit code is 1 if any check fails.
+#include "power_manager.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sim.h"
+
+const uint8_t TOUCH_PIN = 7;              // main.cpp
+const uint32_t POWER_MAX_IDLE_MS = 1000;  // power_manager.cpp
+const uint32_t SLACK_MS = 60;             // Host scheduling jitter allowed on each wait
+
+// The day's loop, kept in sync with src/main.cpp and src/eye_animator.cpp
+const uint32_t EYE_MOVE_INTERVAL = 2000;
+const uint32_t EYE_LOOK_MS = 220;
+const uint32_t EYE_FRAME_MS = 1000 / 30;
+const uint32_t BLINK_MS = 70 + 40 + 90;
+const uint32_t AUTO_BLINK_MIN_MS = 2500, AUTO_BLINK_SPREAD_MS = 4000;
+const uint32_t PARAM_SHOW_INTERVAL = 10000;
+const uint32_t PARAM_DISPLAY_DURATION = 10000;
+const uint32_t PARAM_REDRAW_INTERVAL = 1000;
+const uint32_t TOUCH_DISPLAY_MS = 2000;
+
+// Cost of one piece of work with the CPU awake (µs). Rough figures from the bus stats in /metrics.
+const uint32_t COST_SENSOR_US = 90000;  // AHT20 trigger + 80 ms conversion wait, BMP280 read
+const uint32_t COST_FRAME_US = 25000;   // Compose + 1 KB flush at 400 kHz
+const uint32_t COST_PARAM_US = 27000;   // GFX text drawing + flush
+const uint32_t COST_LOOP_US = 50;       // Bookkeeping on a pass with nothing due
+
+// The day's inputs
+const uint32_t DAY_MS = 24UL * 3600 * 1000;
+const int DAY_TOUCHES = 12;
+const uint32_t DAY_SENSOR_MS = 5000;
+const uint32_t DAY_OLED_TIMEOUT_MS = 10 * 60000;
+const int QUIET_START = 23, QUIET_END = 7;
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+struct PowerWait {
+  uint32_t ms;        // Virtual time the wait took
+  uint32_t sleepMs;   // Counted as light sleep
+  uint32_t lockedMs;  // With the no-light-sleep lock held
+};
+
+static PowerWait idle(uint32_t ms, bool allowLightSleep) {
+  ulTaskNotifyTake(pdTRUE, 0);   // Wake-ups left over from an earlier check (a touch's second edge)
+  uint32_t sleepBefore = powerGetStats().sleepMs;
+  uint64_t lockedBefore = simPmNoSleepUs();
+  uint32_t start = millis();
+  powerIdleUntil(start + ms, allowLightSleep);
+  return {(uint32_t)(millis() - start), powerGetStats().sleepMs - sleepBefore,
+          (uint32_t)((simPmNoSleepUs() - lockedBefore) / 1000)};
+}
+
+static bool near(uint32_t ms, uint32_t expected) {
+  return ms + 5 >= expected && ms <= expected + SLACK_MS;
+}
+
+// One wait of 300 ms on the stepped clock: either all of it is sleep, or all of it is
+// held out of light sleep (when the build has automatic light sleep at all)
+static void checkWait(const char* what, bool allowLightSleep, bool sleeps, bool locks) {
+  char line[112];
+  PowerWait w = idle(300, allowLightSleep);
+  snprintf(line, sizeof(line), "%s: the wait lasts until the deadline (%u ms)", what, (unsigned)w.ms);
+  check(w.ms == 300, line);
+  snprintf(line, sizeof(line), "%s: %s (%u ms counted as sleep)", what,
+           sleeps ? "the wait is counted as light sleep" : "no light sleep is counted", (unsigned)w.sleepMs);
+  check(w.sleepMs == (sleeps ? 300u : 0u), line);
+  snprintf(line, sizeof(line), "%s: %s (%u ms locked)", what,
+           locks ? "light sleep is held off for the whole wait" : "no lock holds light sleep off", (unsigned)w.lockedMs);
+  check(w.lockedMs == (locks ? 300u : 0u), line);
+}
+
+static void checkPolicy() {
+  simClockStep();
+  powerBegin(TOUCH_PIN);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("HomeNetwork", "secret");
+  checkWait("station without modem sleep", true, false, true);
+  powerEnableModemSleep();
+  checkWait("station in modem sleep", true, true, false);
+  checkWait("station, loop busy", false, false, true);
+
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_AP);
+  checkWait("access point", true, false, true);
+
+  WiFi.mode(WIFI_OFF);
+  checkWait("radio off", true, true, false);
+  checkWait("radio off, loop busy", false, false, true);
+
+  simPmSetAvailable(false);
+  powerBegin(TOUCH_PIN);
+  check(!powerGetStats().autoLightSleep, "no automatic light sleep without tickless idle");
+  checkWait("without tickless idle", true, false, false);
+  simPmSetAvailable(true);
+}
+
+static void checkCap() {
+  PowerWait w = idle(5000, false);
+  check(near(w.ms, POWER_MAX_IDLE_MS), "a wait is capped at POWER_MAX_IDLE_MS");
+}
+
+// A touch 100 ms into a 800 ms wait ends it, whether it may sleep or not
+static void checkWakes(bool allowLightSleep) {
+  std::thread toucher([]() {
+    simSleepMicros(100000);
+    simPulsePin(TOUCH_PIN, 50);
+  });
+  PowerWait w = idle(800, allowLightSleep);
+  toucher.join();
+  simSleepMicros(80000);   // Let the pulse end before the next wait
+  check(w.ms < 400, allowLightSleep ? "a touch ends a sleeping wait early" : "a touch ends a wait early");
+
+  std::thread waker([]() {
+    simSleepMicros(100000);
+    powerWake();
+  });
+  w = idle(800, allowLightSleep);
+  waker.join();
+  check(w.ms < 400, "powerWake() from another task ends a wait early");
+}
+
+static bool inQuietHours(uint32_t t) {
+  int hour = (int)((t / 3600000UL) % 24);
+  return QUIET_START < QUIET_END ? hour >= QUIET_START && hour < QUIET_END : hour >= QUIET_START || hour < QUIET_END;
+}
+
+struct DayResult {
+  PowerStats stats;
+  uint64_t allowedUs;   // Waits in which the loop allowed light sleep
+  double mahPerDay;
+};
+
+// One day of the loop at the level of its deadlines: every pass does the work that is due
+// (sensor read, eye animation frame, parameter screen redraw, ...), then hands the earliest
+// next deadline to powerIdleUntil(), as loop() / nextLoopDeadline() do. A touch ends the
+// wait through the ISR on the device; here it is one more deadline. `legacy` runs the
+// previous loop instead, which redrew the parameter screen on every pass and then waited
+// a fixed 10 ms.
+static DayResult runDay(bool legacy) {
+  std::mt19937 rng(1);
+  std::vector<uint32_t> touches;
+  while ((int)touches.size() < DAY_TOUCHES) {
+    uint32_t t = rng() % DAY_MS;
+    if (!inQuietHours(t)) touches.push_back(t);
+  }
+  std::sort(touches.begin(), touches.end());
+
+  simClockInit(1);
+  simClockStep();
+  powerBegin(TOUCH_PIN);
+  uint32_t day0 = millis();
+  DayResult r = {};
+  size_t nextTouch = 0;
+  bool touched = false;
+  uint32_t lastTouch = 0, touchedUntil = 0;
+  uint32_t lastSensor = 0, lastMove = 0, lastParamShow = 0, lastParamDraw = 0, paramStart = 0;
+  bool showingParams = false;
+  uint32_t animUntil = 0, nextBlink = AUTO_BLINK_MIN_MS, nextFrame = 0;
+
+  for (;;) {
+    uint32_t t = millis() - day0;
+    if (t >= DAY_MS) break;
+    while (nextTouch < touches.size() && touches[nextTouch] <= t) {
+      lastTouch = touches[nextTouch++];
+      touched = true;
+      touchedUntil = lastTouch + TOUCH_DISPLAY_MS;
+    }
+    bool displayOn = !inQuietHours(t) && touched && t - lastTouch <= DAY_OLED_TIMEOUT_MS;
+
+    uint32_t work = COST_LOOP_US;
+    if (t - lastSensor >= DAY_SENSOR_MS) {
+      lastSensor = t;
+      work += COST_SENSOR_US;
+    }
+    if (displayOn) {
+      if (showingParams) {
+        if (legacy || t - lastParamDraw >= PARAM_REDRAW_INTERVAL) {
+          lastParamDraw = t;
+          work += COST_PARAM_US;
+        }
+        if (t - paramStart > PARAM_DISPLAY_DURATION) {
+          showingParams = false;
+          lastParamShow = t;
+        }
+      } else if (t - lastParamShow > PARAM_SHOW_INTERVAL) {
+        showingParams = true;
+        paramStart = t;
+        lastParamDraw = t - PARAM_REDRAW_INTERVAL;
+      } else {
+        if (t - lastMove > EYE_MOVE_INTERVAL) {
+          lastMove = t;
+          animUntil = std::max(animUntil, t + EYE_LOOK_MS);
+        }
+        if (t >= nextBlink) {
+          animUntil = std::max(animUntil, t + BLINK_MS);
+          nextBlink = t + AUTO_BLINK_MIN_MS + rng() % AUTO_BLINK_SPREAD_MS;
+        }
+        if (t <= animUntil && t >= nextFrame) {
+          nextFrame = t + EYE_FRAME_MS;
+          work += COST_FRAME_US;
+        }
+      }
+    }
+    delayMicroseconds(work);
+    powerSetDisplayOn(displayOn);
+
+    t = millis() - day0;
+    if (legacy) {
+      powerIdleUntil(day0 + t + 10, false);
+      continue;
+    }
+    uint32_t deadline = lastSensor + DAY_SENSOR_MS;
+    auto earlier = [&deadline](uint32_t d) { deadline = std::min(deadline, d); };
+    if (nextTouch < touches.size()) earlier(touches[nextTouch]);
+    if (t < touchedUntil) earlier(touchedUntil + 1);
+    if (displayOn) {
+      earlier(lastTouch + DAY_OLED_TIMEOUT_MS + 1);
+      if (showingParams) {
+        earlier(lastParamDraw + PARAM_REDRAW_INTERVAL);
+        earlier(paramStart + PARAM_DISPLAY_DURATION + 1);
+      } else {
+        earlier(lastParamShow + PARAM_SHOW_INTERVAL + 1);
+        earlier(lastMove + EYE_MOVE_INTERVAL + 1);
+        earlier(t <= animUntil ? nextFrame : nextBlink);
+      }
+    }
+    uint64_t before = simMicros64();
+    powerIdleUntil(day0 + deadline, !displayOn);
+    if (!displayOn) r.allowedUs += simMicros64() - before;
+  }
+  r.stats = powerGetStats();
+  r.mahPerDay = r.stats.usedMah * (double)DAY_MS / (millis() - day0);
+  return r;
+}
+
+static void report(const char* name, const DayResult& r) {
+  const PowerStats& s = r.stats;
+  double total = (double)s.activeMs + s.idleMs + s.sleepMs;
+  printf("  %s\n", name);
+  printf("    duty cycle      %6.2f %%\n", 100.0 * s.activeMs / total);
+  printf("    sleep fraction  %6.2f %%\n", 100.0 * s.sleepMs / total);
+  printf("    avg current     %8.2f mA\n", r.mahPerDay / 24.0);
+  printf("    charge          %8.1f mAh/day\n", r.mahPerDay);
+}
+
+static void checkDay() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("HomeNetwork", "secret");
+  powerEnableModemSleep();
+
+  simPmSetAvailable(false);
+  DayResult modem = runDay(false);
+  simPmSetAvailable(true);
+  DayResult tickless = runDay(false);
+  simPmSetAvailable(false);
+  DayResult polling = runDay(true);
+  simPmSetAvailable(true);
+
+  printf("  a day with Wi-Fi connected (estimates, not measurements):\n");
+  report("deadline-driven loop, build without tickless idle (modem sleep)", modem);
+  report("deadline-driven loop, build with tickless idle (automatic light sleep)", tickless);
+  report("previous loop (delay(10) polling)", polling);
+
+  check(modem.stats.sleepMs == 0, "day: no light sleep without tickless idle");
+  check(tickless.stats.sleepMs > 0, "day: the tickless build light-sleeps while the display is off");
+  check(tickless.stats.sleepMs == (uint32_t)(tickless.allowedUs / 1000),
+        "day: the tickless build sleeps exactly through the waits the loop allowed");
+  check(tickless.mahPerDay < modem.mahPerDay && modem.mahPerDay < polling.mahPerDay,
+        "day: tickless idle uses less charge than modem sleep alone, and both less than polling");
+}
+
+int simPowerTest() {
+  pinMode(TOUCH_PIN, INPUT_PULLDOWN);
+  checkPolicy();
+
+  // Touches and powerWake() come from other threads: back on the scaled clock
+  simClockInit(4);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("HomeNetwork", "secret");
+  powerEnableModemSleep();
+  powerBegin(TOUCH_PIN);
+  checkCap();
+  checkWakes(false);
+  checkWakes(true);
+
+  checkDay();
+  printf("power manager: %s\n", g_failures ? "FAILED" : "light sleep only where the loop and the radio allow it");
+  return g_failures ? 1 : 0;
+}
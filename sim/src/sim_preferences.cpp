@@ -0,0 +1,130 @@
+#include <Preferences.h>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "sim.h"
+
+static std::mutex g_nvsMutex;
+
+static String nsPath(const std::string& ns) {
+  return simStatePath(("nvs_" + ns + ".txt").c_str());
+}
+
+// File format: one "key<TAB>hex-encoded value" line per entry.
+static std::string toHex(const std::string& s) {
+  static const char* digits = "0123456789abcdef";
+  std::string out;
+  for (unsigned char c : s) {
+    out += digits[c >> 4];
+    out += digits[c & 15];
+  }
+  return out;
+}
+
+static std::string fromHex(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i + 1 < s.size(); i += 2) out += (char)strtol(s.substr(i, 2).c_str(), nullptr, 16);
+  return out;
+}
+
+void Preferences::load() {
+  values_.clear();
+  std::ifstream in(nsPath(ns_).c_str());
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos) continue;
+    values_[line.substr(0, tab)] = fromHex(line.substr(tab + 1));
+  }
+}
+
+void Preferences::save() {
+  std::ofstream out(nsPath(ns_).c_str(), std::ios::trunc);
+  for (auto& kv : values_) out << kv.first << '\t' << toHex(kv.second) << '\n';
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition_label) {
+  (void)partition_label;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  ns_ = name;
+  readOnly_ = readOnly;
+  open_ = true;
+  load();
+  return true;
+}
+
+void Preferences::end() {
+  open_ = false;
+  values_.clear();
+}
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  values_.clear();
+  save();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!open_ || readOnly_) return false;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  values_.erase(key);
+  save();
+  return true;
+}
+
+bool Preferences::isKey(const char* key) { return open_ && values_.count(key) > 0; }
+
+size_t Preferences::putNum(const char* key, double value, size_t size) {
+  if (!open_ || readOnly_) return 0;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  std::ostringstream os;
+  os.precision(17);
+  os << value;
+  values_[key] = os.str();
+  save();
+  return size;
+}
+
+double Preferences::getNum(const char* key, double defaultValue) {
+  auto it = values_.find(key);
+  if (!open_ || it == values_.end()) return defaultValue;
+  return strtod(it->second.c_str(), nullptr);
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  if (!open_ || readOnly_ || !value) return 0;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  values_[key] = value;
+  save();
+  return strlen(value);
+}
+
+String Preferences::getString(const char* key, const String defaultValue) {
+  auto it = values_.find(key);
+  if (!open_ || it == values_.end()) return defaultValue;
+  return String(it->second);
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!open_ || readOnly_) return 0;
+  std::lock_guard<std::mutex> lock(g_nvsMutex);
+  values_[key] = std::string((const char*)value, len);
+  save();
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  auto it = values_.find(key);
+  return (open_ && it != values_.end()) ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  auto it = values_.find(key);
+  if (!open_ || it == values_.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
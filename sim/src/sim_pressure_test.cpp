@@ -0,0 +1,236 @@
+// --pressure-test: replays the pressure traces in sim/traces (written by
+// tools/gen_pressure_traces.py) through the pressure tendency (pressure_trend.h). Every
+// time a bin closes, the forecast is compared with a least-squares fit over the raw
+// readings of the same 3 h window, in double precision: validity must match, the 3 h
+// change to PRESSURE_CHANGE_TOLERANCE and the sea-level pressure to
+// PRESSURE_LEVEL_TOLERANCE, and so must the tendency and Zambretti letter, unless the
+// exact values sit that close to one of their boundaries. At the end of each trace the
+// tendency and outlook must be the ones its "# expect" line names. Prints the cost of
+// a reading. The exit code is 1 if any check fails or no trace could be read.
+#include "pressure_trend.h"
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double PRESSURE_CHANGE_TOLERANCE = 0.002;   // hPa per 3 h
+const double PRESSURE_LEVEL_TOLERANCE = 0.01;     // hPa
+static const char* const OUTLOOK_NAMES[] = {"fine", "fair", "changeable", "rain", "storm"};
+
+static int g_failures = 0;
+static int g_reported = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+struct PressureReading {
+  uint32_t t;
+  float hPa;
+};
+
+struct PressureTrace {
+  std::string name;
+  float altitudeM = 0;
+  std::string tendency, outlook;   // Expected at the end
+  std::vector<PressureReading> readings;
+};
+
+static bool loadTrace(const std::string& path, PressureTrace& trace) {
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[160], a[40], b[40];
+  unsigned t;
+  float p;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "# altitude_m %f", &trace.altitudeM) == 1) continue;
+    if (sscanf(line, "# expect %39s %39s", a, b) == 2) {
+      trace.tendency = a;
+      trace.outlook = b;
+    } else if (sscanf(line, "%u,%f", &t, &p) == 2) {
+      trace.readings.push_back({t, p});
+    }
+  }
+  fclose(f);
+  return !trace.readings.empty() && !trace.outlook.empty();
+}
+
+// The WMO characteristic of a 3 h change, from its definition
+static PressureTendency tendencyOf(double change) {
+  double size = fabs(change);
+  if (size < 0.1) return PT_STEADY;
+  int level = size < 1.6 ? 0 : size < 3.6 ? 1 : size < 6.0 ? 2 : 3;
+  return (PressureTendency)((change > 0 ? PT_RISING_SLOWLY : PT_FALLING_SLOWLY) + level);
+}
+
+// Least-squares fit over the readings of the 3 h window that ends where bin `open`
+// starts; valid with readings in at least PT_MIN_BINS of its bins
+static PressureForecast exactFit(const std::vector<PressureReading>& readings, size_t end, uint32_t open,
+                                 float altitudeM, double& change, double& seaLevel) {
+  PressureForecast f;
+  f.valid = false;
+  uint32_t first = open >= PT_BINS ? open - PT_BINS : 0;
+  double n = 0, sumT = 0, sumP = 0;
+  std::vector<uint32_t> bins;
+  for (size_t i = 0; i < end; i++) {
+    uint32_t id = readings[i].t / PT_BIN_SEC;
+    if (id < first || id >= open) continue;
+    n++;
+    sumT += readings[i].t - (double)first * PT_BIN_SEC;
+    sumP += readings[i].hPa;
+    if (bins.empty() || bins.back() != id) bins.push_back(id);
+  }
+  if (bins.size() < PT_MIN_BINS) return f;
+  double meanT = sumT / n, meanP = sumP / n, m2T = 0, cTP = 0;
+  for (size_t i = 0; i < end; i++) {
+    uint32_t id = readings[i].t / PT_BIN_SEC;
+    if (id < first || id >= open) continue;
+    double dT = readings[i].t - (double)first * PT_BIN_SEC - meanT;
+    m2T += dT * dT;
+    cTP += dT * (readings[i].hPa - meanP);
+  }
+  double slope = cTP / m2T;
+  double fitted = meanP + slope * ((double)PT_BINS * PT_BIN_SEC - meanT);
+  change = slope * 3 * 60 * 60;
+  seaLevel = fitted / pow(1 - altitudeM / 44330.0, 5.255);
+  f.valid = true;
+  f.changePer3h = change;
+  f.seaLevelHpa = seaLevel;
+  f.tendency = tendencyOf(change);
+  f.letter = zambrettiLetter(seaLevel, change);
+  return f;
+}
+
+// True if every value within the tolerances of the exact ones gives the same tendency
+// (letter), so a difference there would be the engine's fault
+static bool clearTendency(double change) {
+  return tendencyOf(change - PRESSURE_CHANGE_TOLERANCE) == tendencyOf(change + PRESSURE_CHANGE_TOLERANCE);
+}
+
+static bool clearLetter(double change, double seaLevel) {
+  char letter = zambrettiLetter(seaLevel, change);
+  for (int dc = -1; dc <= 1; dc += 2) {
+    for (int dl = -1; dl <= 1; dl += 2) {
+      if (zambrettiLetter(seaLevel + dl * PRESSURE_LEVEL_TOLERANCE, change + dc * PRESSURE_CHANGE_TOLERANCE) != letter) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void fail(const PressureTrace& trace, uint32_t t, const char* what, const PressureForecast& got,
+                 const PressureForecast& want) {
+  g_failures++;
+  if (g_reported++ >= 10) return;
+  printf("  FAIL %s at %us: %s; got %s %+.3f hPa/3h %.2f hPa %s '%c', expected %s %+.3f hPa/3h %.2f hPa %s '%c'\n",
+         trace.name.c_str(), (unsigned)t, what, got.valid ? "valid" : "invalid", got.changePer3h, got.seaLevelHpa,
+         pressureTendencyName(got.tendency), got.letter, want.valid ? "valid" : "invalid", want.changePer3h,
+         want.seaLevelHpa, pressureTendencyName(want.tendency), want.letter);
+}
+
+// Replays one trace, comparing each refit; keeps the worst change and level errors
+static void checkTrace(const PressureTrace& trace, double& worstChange, double& worstLevel) {
+  static PressureTrend s;
+  pressureTrendBegin(s, trace.altitudeM);
+  uint32_t fits = 0;
+  for (size_t i = 0; i < trace.readings.size(); i++) {
+    uint32_t t = trace.readings[i].t;
+    bool opens = i > 0 && t / PT_BIN_SEC != trace.readings[i - 1].t / PT_BIN_SEC;
+    pressureTrendAdd(s, t, trace.readings[i].hPa);
+    if (!opens) continue;
+
+    // The refit covers the window ending at this reading's bin, over the earlier readings
+    PressureForecast got = pressureTrendForecast(s);
+    double change = 0, seaLevel = 0;
+    PressureForecast want = exactFit(trace.readings, i, t / PT_BIN_SEC, trace.altitudeM, change, seaLevel);
+    fits++;
+    if (got.valid != want.valid) {
+      fail(trace, t, "validity differs", got, want);
+      continue;
+    }
+    if (!want.valid) continue;
+    double changeErr = fabs(got.changePer3h - change), levelErr = fabs(got.seaLevelHpa - seaLevel);
+    worstChange = std::max(worstChange, changeErr);
+    worstLevel = std::max(worstLevel, levelErr);
+    if (changeErr > PRESSURE_CHANGE_TOLERANCE || levelErr > PRESSURE_LEVEL_TOLERANCE) {
+      fail(trace, t, "fit off", got, want);
+    } else if (clearTendency(change) && got.tendency != want.tendency) {
+      fail(trace, t, "tendency differs", got, want);
+    } else if (clearLetter(change, seaLevel) && got.letter != want.letter) {
+      fail(trace, t, "letter differs", got, want);
+    }
+  }
+
+  PressureForecast last = pressureTrendForecast(s);
+  const char* outlook = last.valid ? OUTLOOK_NAMES[zambrettiOutlook(last.letter)] : "none";
+  const char* tendency = last.valid ? pressureTendencyName(last.tendency) : "none";
+  printf("  %-16s %4u readings, %3u refits: %+.2f hPa/3h, %7.2f hPa at sea level, %s, '%c' %s\n",
+         trace.name.c_str(), (unsigned)trace.readings.size(), (unsigned)fits, last.changePer3h, last.seaLevelHpa,
+         tendency, last.letter, zambrettiText(last.letter));
+  char what[120];
+  snprintf(what, sizeof(what), "%s ends %s/%s, expected %s/%s", trace.name.c_str(), tendency, outlook,
+           trace.tendency.c_str(), trace.outlook.c_str());
+  check(trace.tendency == tendency && trace.outlook == outlook, what);
+}
+
+static double nsPerReading(const std::vector<PressureTrace>& traces) {
+  static PressureTrend s;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t added = 0;
+  do {
+    for (const PressureTrace& trace : traces) {
+      pressureTrendBegin(s, trace.altitudeM);
+      for (const PressureReading& r : trace.readings) pressureTrendAdd(s, r.t, r.hPa);
+      added += trace.readings.size();
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return elapsed * 1e9 / added;
+}
+
+int simPressureTest(const char* dir) {
+  std::vector<std::string> names;
+  if (DIR* d = opendir(dir)) {
+    while (dirent* e = readdir(d)) {
+      std::string name = e->d_name;
+      if (name.compare(0, 9, "pressure_") == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".csv") == 0) {
+        names.push_back(name);
+      }
+    }
+    closedir(d);
+  }
+  std::sort(names.begin(), names.end());
+
+  std::vector<PressureTrace> traces;
+  for (const std::string& name : names) {
+    PressureTrace trace;
+    trace.name = name.substr(9, name.size() - 13);
+    if (loadTrace(std::string(dir) + "/" + name, trace)) traces.push_back(trace);
+    else check(false, (name + " has no readings or no \"# expect\" line").c_str());
+  }
+  if (traces.empty()) {
+    printf("  FAIL no pressure_*.csv traces in %s (run from the repository root)\n", dir);
+    return 1;
+  }
+
+  double worstChange = 0, worstLevel = 0;
+  for (const PressureTrace& trace : traces) checkTrace(trace, worstChange, worstLevel);
+  printf("  worst difference from the exact fit: %.4f hPa/3h, %.4f hPa; %.1f ns/reading, %u bytes of state (host)\n",
+         worstChange, worstLevel, nsPerReading(traces), (unsigned)sizeof(PressureTrend));
+  printf("pressure: %s\n", g_failures ? "FAILED" : "every refit matches the exact fit, every outlook as expected");
+  return g_failures ? 1 : 0;
+}
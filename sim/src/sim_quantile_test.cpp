@@ -0,0 +1,197 @@
+// --quantile-test: checks the percentile sketches (env_quantiles.h, quantile_sketch.h)
+// against exact percentiles from a sort. First a week of known values: a permutation of
+// 0..N-1 spread over six days, so the whole of it is rolled up into the 7-day window.
+// Then nine days of random-walk readings twice: every 5 s (the default sensor interval),
+// and irregular as the adaptive sampler makes them, with gaps of hours, a day/night
+// swing and pressure missing for a while. Every window and channel is queried at random
+// points, now and some time after the latest reading. Each sketch must count exactly
+// the readings in its window, and p1 to p99 must be within QUANTILE_MAX_RANK_ERROR of
+// the exact rank. Prints the cost of a reading and of a 7-day query. The exit code is 1
+// if any check fails.
+#include "env_quantiles.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double QUANTILE_MAX_RANK_ERROR = 0.012;
+const uint32_t PERMUTATION_READINGS = 20160;
+const uint32_t PERMUTATION_SPACING_S = 25;
+const uint32_t TRACE_DAYS = 9;
+const uint32_t TRACE_QUERIES = 60;             // Comparisons per trace, on average
+const double QS[] = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+const uint32_t TIER_BUCKET_SEC[ENV_WINDOWS] = {15 * 60, 4 * 60 * 60, 24 * 60 * 60};   // env_quantiles.cpp
+const uint8_t TIER_BUCKETS[ENV_WINDOWS] = {4, 6, 7};
+
+static int g_failures = 0;
+static int g_reported = 0;
+
+// How far estimate is from quantile q of the sorted values, as a fraction of the count.
+// An estimate between two neighbouring values could have either rank (the sketch
+// interpolates), and one equal to a run of ties any rank in the run. Quantile q is at
+// rank q * (n - 1) for a sort and q * n - 0.5 for the sketch (value i stands for ranks
+// i to i + 1); both are right, so anything between them counts as exact.
+static double rankError(const std::vector<float>& sorted, float estimate, double q) {
+  double n = sorted.size();
+  double lowest = (std::lower_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin()) - 1;
+  double highest = std::upper_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin();
+  double rankLow = std::min(q * (n - 1), q * n - 0.5), rankHigh = std::max(q * (n - 1), q * n - 0.5);
+  if (rankHigh < lowest) return (lowest - rankHigh) / n;
+  if (rankLow > highest) return (rankLow - highest) / n;
+  return 0;
+}
+
+// Compares one sketch with the exact values of its window; returns the worst rank error
+static double compare(const QuantileSketch& sketch, std::vector<float>& values, const char* label) {
+  std::sort(values.begin(), values.end());
+  bool ok = (uint32_t)sketch.total == values.size();
+  if (!ok && g_reported++ < 10) {
+    printf("  FAIL %s: sketch counts %u readings, the window has %u\n", label, (unsigned)sketch.total,
+           (unsigned)values.size());
+  }
+  if (values.empty()) {
+    ok &= isnan(qsketchQuantile(sketch, 0.5));
+  }
+  double worst = 0;
+  for (size_t k = 0; ok && !values.empty() && k < sizeof(QS) / sizeof(QS[0]); k++) {
+    double err = rankError(values, qsketchQuantile(sketch, QS[k]), QS[k]);
+    worst = std::max(worst, err);
+    if (err > QUANTILE_MAX_RANK_ERROR) {
+      if (g_reported++ < 10) printf("  FAIL %s: p%g off by %.2f%% of the ranks\n", label, QS[k] * 100, err * 100);
+      ok = false;
+    }
+  }
+  if (!ok) g_failures++;
+  return worst;
+}
+
+// A permutation of 0..N-1, whose exact quantile q is q * (N - 1)
+static void checkPermutation() {
+  static EnvQuantiles s;
+  envQuantilesBegin(s);
+  const uint32_t n = PERMUTATION_READINGS;
+  std::vector<float> values;
+  for (uint32_t i = 0; i < n; i++) {
+    float v = (float)((i * 7919UL) % n);
+    envQuantilesAdd(s, i * PERMUTATION_SPACING_S, v, v, v);
+    values.push_back(v);
+  }
+  QuantileSketch sketch;
+  envQuantilesSketch(s, ENV_7D, ENV_TEMP, n * PERMUTATION_SPACING_S, sketch);
+  double worst = compare(sketch, values, "permutation, 7d");
+  printf("  permutation of %u over six days: worst rank error %.2f%% (7d)\n", (unsigned)n, worst * 100);
+}
+
+struct TraceReading {
+  uint32_t t;
+  float v[EQ_CHANNELS];   // NaN where the channel had no value
+};
+
+// Nine days of random-walk readings, compared as they go. Steady: every 5 s. Otherwise
+// 5 to 60 s apart, now and then hours apart, with a day/night swing and pressure
+// missing for a while.
+static void checkTrace(bool steady, uint32_t seed) {
+  static EnvQuantiles s;
+  envQuantilesBegin(s);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::normal_distribution<double> noise(0, 1);
+  std::deque<TraceReading> readings;
+  double weather[EQ_CHANNELS] = {21, 50, 1010};
+  const double drift[EQ_CHANNELS] = {0.01, 0.04, 0.01};     // Weather: random walk per reading
+  const double daily[EQ_CHANNELS] = {3, -10, 0.6};          // Day/night swing (pressure: the 12 h tide)
+  const double sensor[EQ_CHANNELS] = {0.02, 0.1, 0.03};     // Sensor noise
+  const double queryChance = TRACE_QUERIES * (steady ? 5.0 : 23.0) / (TRACE_DAYS * 24 * 3600);
+  bool pressureMissing = false;
+  uint32_t t = 100;
+  uint32_t queries = 0;
+  double worst[ENV_WINDOWS] = {0, 0, 0};
+  char label[80];
+
+  while (t < TRACE_DAYS * 24 * 3600) {
+    double gap = unit(rng);
+    if (steady) t += 5;
+    else t += gap < 0.0005 ? 3600 + (uint32_t)(unit(rng) * 20000) : 5 + (uint32_t)(gap * gap * 55);
+    if (!steady && unit(rng) < 0.0005) pressureMissing = !pressureMissing;
+    TraceReading r;
+    r.t = t;
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+      weather[c] += noise(rng) * drift[c];
+      double period = c == ENV_PRESSURE ? 12 * 3600 : 24 * 3600;
+      double swing = steady ? 0 : daily[c] * sin(2 * M_PI * t / period);
+      r.v[c] = (float)(weather[c] + swing + noise(rng) * sensor[c]);
+    }
+    if (pressureMissing) r.v[ENV_PRESSURE] = NAN;
+    envQuantilesAdd(s, t, r.v[ENV_TEMP], r.v[ENV_HUMIDITY], r.v[ENV_PRESSURE]);
+    readings.push_back(r);
+    while (readings.front().t + 8 * 24 * 3600 < t) readings.pop_front();
+
+    if (unit(rng) >= queryChance) continue;
+    uint32_t nowS = t + (unit(rng) < 0.5 ? 0 : (uint32_t)(unit(rng) * 24 * 3600));
+    queries++;
+    for (uint8_t w = 0; w < ENV_WINDOWS; w++) {
+      uint32_t nowId = nowS / TIER_BUCKET_SEC[w];
+      uint32_t first = nowId >= TIER_BUCKETS[w] ? nowId - TIER_BUCKETS[w] + 1 : 0;
+      for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+        std::vector<float> values;
+        for (const TraceReading& x : readings) {
+          if (x.t / TIER_BUCKET_SEC[w] >= first && !isnan(x.v[c])) values.push_back(x.v[c]);
+        }
+        QuantileSketch sketch;
+        envQuantilesSketch(s, (EnvWindow)w, (EnvChannel)c, nowS, sketch);
+        snprintf(label, sizeof(label), "%s trace at %us, %s %s", steady ? "steady" : "irregular", (unsigned)nowS,
+                 envWindowName((EnvWindow)w), envChannelName((EnvChannel)c));
+        worst[w] = std::max(worst[w], compare(sketch, values, label));
+      }
+    }
+  }
+  printf("  %u days %s, %u queries of all windows and channels: worst rank error", TRACE_DAYS,
+         steady ? "every 5 s" : "irregular", (unsigned)queries);
+  for (uint8_t w = 0; w < ENV_WINDOWS; w++) printf(" %.2f%% (%s)", worst[w] * 100, envWindowName((EnvWindow)w));
+  printf("\n");
+}
+
+static void timeSketches() {
+  static EnvQuantiles s;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t added = 0;
+  do {
+    envQuantilesBegin(s);
+    for (uint32_t i = 0; i < PERMUTATION_READINGS; i++) {
+      float v = (float)((i * 7919UL) % PERMUTATION_READINGS);
+      envQuantilesAdd(s, i * PERMUTATION_SPACING_S, v, v, v);
+    }
+    added += PERMUTATION_READINGS;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  double addNs = elapsed * 1e9 / added;
+
+  QuantileSketch sketch;
+  start = std::chrono::steady_clock::now();
+  uint64_t queries = 0;
+  do {
+    envQuantilesSketch(s, ENV_7D, ENV_TEMP, PERMUTATION_READINGS * PERMUTATION_SPACING_S, sketch);
+    queries++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  printf("  %.1f ns/reading, %.1f us per 7d query, %u bytes per sketch, %u bytes in all (host)\n", addNs,
+         elapsed * 1e6 / queries, (unsigned)sizeof(QuantileSketch), (unsigned)sizeof(EnvQuantiles));
+}
+
+int simQuantileTest() {
+  checkPermutation();
+  checkTrace(true, 20240611);
+  checkTrace(false, 4242);
+  timeSketches();
+  printf("quantiles: %s\n", g_failures ? "FAILED" : "counts exact, rank error within 1.2%");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// --render-bench: renders the main page both ways the firmware has done it and compares
+// them. "replace" is the old path: the template copied into a String and replace() run
+// once per placeholder, with mainPagePlaceholder() (main.cpp) giving the values.
+// "stream" is httpRenderPage() filling TCP-sized chunks from flash. Both must produce
+// the same page with no placeholder left. Prints the average time of each and the most
+// heap held at any step, sampled between steps (so transient reallocations inside one
+// replace() are not counted; the real peak of that path is higher). The streaming path
+// must not use the heap (RENDER_MAX_STREAM_HEAP). The exit code is 1 if any check fails.
+#include "web_pages.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "http_response.h"
+#include "sim.h"
+
+const int RENDER_BENCH_RUNS = 20;
+const size_t RENDER_BENCH_CHUNK = 1436;       // One TCP segment
+const uint32_t RENDER_MAX_STREAM_HEAP = 256;   // Allocator noise
+
+// main.cpp
+void mainPagePlaceholder(uint8_t placeholder, Print& out);
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// The original template text, as it used to be embedded
+static String originalTemplate() {
+  String tmpl;
+  tmpl.reserve(sizeof(MAIN_PAGE_TEXT) + 256);
+  size_t pos = 0;
+  for (uint8_t i = 0; i < MAIN_PAGE.segmentCount; i++) {
+    const HttpSegment& seg = MAIN_PAGE.segments[i];
+    for (uint16_t k = 0; k < seg.textLen; k++) tmpl += (char)pgm_read_byte(MAIN_PAGE.text + pos + k);
+    pos += seg.textLen;
+    if (seg.placeholder != HTTP_PAGE_END) {
+      tmpl += '%';
+      tmpl += WEB_PLACEHOLDER_NAMES[seg.placeholder];
+      tmpl += '%';
+    }
+  }
+  return tmpl;
+}
+
+// Heap taken since baseFree was read (0 if some was given back)
+static uint32_t heapHeld(uint32_t baseFree) {
+  uint32_t freeNow = ESP.getFreeHeap();
+  return freeNow < baseFree ? baseFree - freeNow : 0;
+}
+
+static bool hasPlaceholder(const std::string& page) {
+  for (uint8_t id = 0; id < PH_COUNT; id++) {
+    if (page.find(std::string("%") + WEB_PLACEHOLDER_NAMES[id] + "%") != std::string::npos) return true;
+  }
+  return false;
+}
+
+int simRenderBench() {
+  static HttpBuffer scratch;
+  static uint8_t chunk[RENDER_BENCH_CHUNK];
+  String tmpl = originalTemplate();
+
+  double replaceUs = 0, streamUs = 0;
+  uint32_t replacePeak = 0, streamPeak = 0;
+  std::string replaced, streamed;
+  streamed.reserve(2 * sizeof(MAIN_PAGE_TEXT));   // Kept off the stream's heap reading
+  for (int run = 0; run < RENDER_BENCH_RUNS; run++) {
+    uint32_t baseFree = ESP.getFreeHeap();
+    auto start = std::chrono::steady_clock::now();
+    String html = tmpl;
+    for (uint8_t id = 0; id < PH_COUNT; id++) {
+      String needle = String("%") + WEB_PLACEHOLDER_NAMES[id] + "%";
+      if (html.indexOf(needle) < 0) continue;
+      scratch.clear();
+      mainPagePlaceholder(id, scratch);
+      scratch.write((uint8_t)0);
+      html.replace(needle, scratch.data());
+      replacePeak = std::max(replacePeak, heapHeld(baseFree));
+    }
+    replaceUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    replaced.assign(html.c_str(), html.length());
+    html = String();
+
+    baseFree = ESP.getFreeHeap();
+    start = std::chrono::steady_clock::now();
+    HttpPageCursor cursor = HttpPageCursor();
+    scratch.clear();
+    streamed.clear();
+    size_t n;
+    while ((n = httpRenderPage(MAIN_PAGE, mainPagePlaceholder, cursor, scratch, chunk, sizeof(chunk))) > 0) {
+      streamPeak = std::max(streamPeak, heapHeld(baseFree));
+      streamed.append((const char*)chunk, n);
+    }
+    streamUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  check(streamed == replaced, "both paths render the same page");
+  check(!hasPlaceholder(streamed), "no placeholder left in the page");
+  check(streamPeak <= RENDER_MAX_STREAM_HEAP, "streaming holds no heap");
+  printf("  replace: %u bytes, %7.1f us, peak heap %6u bytes (host)\n", (unsigned)replaced.size(),
+         replaceUs / RENDER_BENCH_RUNS, (unsigned)replacePeak);
+  printf("  stream:  %u bytes, %7.1f us, peak heap %6u bytes (host)\n", (unsigned)streamed.size(),
+         streamUs / RENDER_BENCH_RUNS, (unsigned)streamPeak);
+  printf("render: %s\n", g_failures ? "FAILED" : "same page both ways, streamed without heap");
+  return g_failures ? 1 : 0;
+}
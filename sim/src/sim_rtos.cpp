@@ -0,0 +1,207 @@
+// FreeRTOS primitives on std::thread / std::condition_variable.
+// Timeouts are virtual milliseconds, converted with the simulator clock speed.
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sim.h"
+
+static std::recursive_mutex g_critical;
+void simEnterCritical() { g_critical.lock(); }
+void simExitCritical() { g_critical.unlock(); }
+
+// Waits on `cv` until `ready()` or `ticks` virtual ms have passed. On the stepped clock
+// nobody else can make it ready meanwhile: the timeout passes at once.
+template <typename Pred>
+static bool waitTicks(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Pred ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  if (simClockStepped()) {
+    if (ready()) return true;
+    simSleepMicros((uint64_t)ticks * 1000ULL);
+    return false;
+  }
+  auto real = std::chrono::duration<double, std::milli>((double)ticks / simSpeed());
+  return cv.wait_for(lock, real, ready);
+}
+
+struct SimSemaphore {
+  std::mutex m;
+  std::condition_variable cv;
+  UBaseType_t count;
+  UBaseType_t max;
+};
+
+static SemaphoreHandle_t create(UBaseType_t max, UBaseType_t initial) {
+  SimSemaphore* s = new SimSemaphore();
+  s->count = initial;
+  s->max = max;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return create(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return create(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return create(1, 0); }
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+  return create(maxCount, initialCount);
+}
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(sem->m);
+  if (!waitTicks(sem->cv, lock, ticks, [sem]() { return sem->count > 0; })) return pdFALSE;
+  sem->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  std::lock_guard<std::mutex> lock(sem->m);
+  if (sem->count >= sem->max) return pdFALSE;
+  sem->count++;
+  sem->cv.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return xSemaphoreGive(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) {
+  std::lock_guard<std::mutex> lock(sem->m);
+  return sem->count;
+}
+
+// --------------------------------------------------------------------------------
+// Tasks
+// --------------------------------------------------------------------------------
+struct SimTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+  const char* name = "";
+};
+
+static thread_local SimTask* t_self = nullptr;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!t_self) t_self = new SimTask(); // loop task, HTTP thread, ...
+  return t_self;
+}
+
+struct TaskStart {
+  TaskFunction_t fn;
+  void* param;
+  SimTask* task;
+};
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created) {
+  (void)stackDepth;
+  (void)priority;
+  SimTask* task = new SimTask();
+  task->name = name;
+  if (created) *created = task;
+  std::thread([fn, param, task]() {
+    t_self = task;
+    fn(param);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+  (void)core;
+  return xTaskCreate(fn, name, stackDepth, param, priority, created);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Only self-deletion is used: end the thread by parking it forever.
+  if (task == nullptr || task == t_self) {
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(24));
+  }
+}
+
+void vTaskDelay(TickType_t ticks) { simSleepMicros((uint64_t)ticks * 1000ULL); }
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(simMicros64() / 1000ULL); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 4096;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  SimTask* self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(self->m);
+  waitTicks(self->cv, lock, ticks, [self]() { return self->notify > 0; });
+  uint32_t value = self->notify;
+  if (value) self->notify = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task) return pdFAIL;
+  std::lock_guard<std::mutex> lock(task->m);
+  task->notify++;
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  xTaskNotifyGive(task);
+}
+
+// --------------------------------------------------------------------------------
+// Queues
+// --------------------------------------------------------------------------------
+struct SimQueue {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::string> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  SimQueue* q = new SimQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->m);
+  if (!waitTicks(queue->cv, lock, ticks, [queue]() { return queue->items.size() < queue->length; })) return pdFALSE;
+  queue->items.emplace_back((const char*)item, queue->itemSize);
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->m);
+  if (!waitTicks(queue->cv, lock, ticks, [queue]() { return !queue->items.empty(); })) return pdFALSE;
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->m);
+  return (UBaseType_t)queue->items.size();
+}
@@ -0,0 +1,264 @@
+// --sampler-test: replays sensor traces through the firmware's adaptive sampler
+// (adaptive_sampler.h) and reports the sensor reads, I2C transactions and charge it
+// saves per day against fixed intervals, and how closely its samples still follow the
+// signal. The sampler is fed the trace at each time it asks for (linear interpolation).
+//
+// Without a file it replays a synthetic day, one reading a second with AHT20/BMP280-like
+// noise: a flat night, the heating coming on, a shower, a window opened for ten minutes
+// and cooking in the evening. The sampler must then read at most SAMPLER_MAX_READ_SHARE
+// of the reads at its minimum interval, with the interpolated samples within
+// SAMPLER_MAX_ERROR of the trace; back off to the maximum interval through the night;
+// and be at the minimum within SAMPLER_REACT_S of the window opening.
+//
+// Then readings that fail or are rejected (NaN) are injected into a flat signal: they
+// must not pull the interval down, a reading with no channel must hold it, a channel
+// that comes back is compared with its last good reading, and a device without the
+// BMP280 still backs off. The exit code is 1 if any check fails or the file can't be read.
+#include "adaptive_sampler.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+const uint32_t SAMPLER_MIN_MS = 1000;    // sensorMinInterval / sensorMaxInterval defaults in main.cpp
+const uint32_t SAMPLER_MAX_MS = 60000;
+const uint32_t SAMPLER_FIXED_MS = 5000;  // Fixed interval to compare with (sensorInterval default)
+const double SAMPLER_MAX_READ_SHARE = 0.1;
+const float SAMPLER_MAX_ERROR[3] = {0.5f, 2.0f, 0.2f};   // degC, %RH, hPa; the trace's own noise included
+const double SAMPLER_REACT_S = 90;
+const uint32_t DAY_S = 24 * 3600;
+
+// Cost of one readSensors() call
+const uint32_t I2C_TRANSACTIONS_PER_READ = 2;   // One bus acquire for the AHT20, one for the BMP280
+const uint32_t I2C_BYTES_PER_READ = 3 + 6 + 4 + 4;
+const double COST_SENSOR_MS = 90;
+const double CURRENT_ACTIVE_MA = 28.0;          // power_manager.cpp
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+struct SensorTrace {
+  std::vector<double> times;   // s
+  std::vector<float> values;   // temp, humidity, pressure of each time; NaN where missing
+};
+
+// CSV with a header line and the columns time_s,temp,humidity,pressure
+static bool loadSensorTrace(const char* path, SensorTrace& trace) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[160];
+  while (fgets(line, sizeof(line), f)) {
+    double t;
+    float v[3] = {NAN, NAN, NAN};
+    if (sscanf(line, "%lf,%f,%f,%f", &t, &v[0], &v[1], &v[2]) < 2) continue;
+    trace.times.push_back(t);
+    trace.values.insert(trace.values.end(), v, v + 3);
+  }
+  fclose(f);
+  return trace.times.size() >= 2;
+}
+
+// A bump of height that rises over riseS from start, holds for holdS and decays with fallS
+static double bump(double t, double start, double riseS, double holdS, double fallS, double height) {
+  if (t < start) return 0;
+  t -= start;
+  if (t < riseS) return height * t / riseS;
+  t -= riseS;
+  if (t < holdS) return height;
+  t -= holdS;
+  return height * exp(-t / fallS);
+}
+
+// One reading a second of a plausible indoor day
+static void syntheticDay(SensorTrace& trace) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> n(0, 1);
+  for (uint32_t t = 0; t < DAY_S; t++) {
+    double h = t / 3600.0;
+    double temp = 22.0 + 1.5 * sin(2 * M_PI * (h - 9) / 24);         // Slow daily swing
+    temp += bump(t, 7 * 3600, 1800, 3600 * 10, 3600, 1.0);           // Heating on at 07:00
+    temp -= bump(t, 10 * 3600, 120, 480, 900, 3.0);                  // Window open at 10:00
+    temp += bump(t, 19 * 3600, 900, 1800, 1200, 1.5);                // Cooking at 19:00
+    double hum = 48.0 - 4.0 * sin(2 * M_PI * (h - 9) / 24);
+    hum += bump(t, 10 * 3600, 120, 480, 900, 6.0);
+    hum += bump(t, 7.5 * 3600, 300, 600, 900, 20.0);                 // Shower at 07:30
+    hum += bump(t, 19 * 3600, 900, 1800, 1200, 8.0);
+    double press = 1012.0 + 2.0 * sin(2 * M_PI * h / 36);            // Weather drift
+    trace.times.push_back(t);
+    trace.values.push_back((float)temp + 0.02f * n(rng));
+    trace.values.push_back((float)hum + 0.15f * n(rng));
+    trace.values.push_back((float)press + 0.02f * n(rng));
+  }
+}
+
+// The trace at time t (s), interpolated; `from` is a search hint for increasing times
+static void valueAt(const std::vector<double>& times, const std::vector<float>& values, double t, size_t& from,
+                    float (&out)[3]) {
+  while (from + 1 < times.size() && times[from + 1] <= t) from++;
+  if (from + 1 >= times.size() || t <= times[from]) {
+    for (int c = 0; c < 3; c++) out[c] = values[from * 3 + c];
+    return;
+  }
+  double f = (t - times[from]) / (times[from + 1] - times[from]);
+  for (int c = 0; c < 3; c++) out[c] = values[from * 3 + c] + (values[(from + 1) * 3 + c] - values[from * 3 + c]) * f;
+}
+
+struct Schedule {
+  std::string name;
+  std::vector<double> times;      // When it read, s
+  std::vector<float> values;      // What it read
+  std::vector<uint32_t> intervals;
+};
+
+// Reads the trace every fixedMs, or when the sampler asks with fixedMs 0
+static Schedule replay(const SensorTrace& trace, uint32_t fixedMs) {
+  Schedule s;
+  char name[40];
+  if (fixedMs) snprintf(name, sizeof(name), "fixed %u s", (unsigned)(fixedMs / 1000));
+  else snprintf(name, sizeof(name), "adaptive %u-%u s", (unsigned)(SAMPLER_MIN_MS / 1000), (unsigned)(SAMPLER_MAX_MS / 1000));
+  s.name = name;
+  samplerBegin(SAMPLER_MIN_MS, SAMPLER_MAX_MS);
+  uint64_t tMs = (uint64_t)(trace.times.front() * 1000);
+  uint64_t endMs = (uint64_t)(trace.times.back() * 1000);
+  size_t from = 0;
+  while (tMs <= endMs) {
+    float v[3];
+    valueAt(trace.times, trace.values, tMs / 1000.0, from, v);
+    uint32_t interval = fixedMs ? fixedMs : samplerUpdate(v[0], v[1], v[2], (uint32_t)tMs);
+    s.times.push_back(tMs / 1000.0);
+    s.values.insert(s.values.end(), v, v + 3);
+    s.intervals.push_back(interval);
+    tMs += interval;
+  }
+  return s;
+}
+
+// Largest difference between the trace and the interpolation of the schedule's samples
+static void maxError(const SensorTrace& trace, const Schedule& s, float (&worst)[3]) {
+  size_t from = 0;
+  for (int c = 0; c < 3; c++) worst[c] = 0;
+  for (size_t i = 0; i < trace.times.size(); i++) {
+    float approx[3];
+    valueAt(s.times, s.values, trace.times[i], from, approx);
+    for (int c = 0; c < 3; c++) {
+      float err = fabsf(trace.values[i * 3 + c] - approx[c]);
+      if (err > worst[c]) worst[c] = err;
+    }
+  }
+}
+
+// Prints the schedules' reads, bus traffic and charge per day; the adaptive one last
+static void report(const char* name, const SensorTrace& trace, const std::vector<Schedule>& schedules,
+                   std::vector<std::vector<float>>& errors) {
+  double spanS = trace.times.back() - trace.times.front();
+  double perDay = spanS > 0 ? DAY_S / spanS : 1;
+  printf("%s: %.1f h, %u points\n", name, spanS / 3600, (unsigned)trace.times.size());
+  printf("  %-20s %10s %12s %8s   max error (T / RH / P)\n", "schedule", "reads/day", "I2C txn/day", "mAh/day");
+  for (const Schedule& s : schedules) {
+    double reads = s.times.size() * perDay;
+    float err[3];
+    maxError(trace, s, err);
+    errors.push_back(std::vector<float>(err, err + 3));
+    printf("  %-20s %10.0f %12.0f %8.2f   %.2f C / %.1f %% / %.2f hPa\n", s.name.c_str(), reads,
+           reads * I2C_TRANSACTIONS_PER_READ, reads * COST_SENSOR_MS * CURRENT_ACTIVE_MA / 3.6e6, err[0], err[1],
+           err[2]);
+  }
+  double saved = (schedules.front().times.size() - schedules.back().times.size()) * perDay;
+  printf("  saved vs %s: %.0f reads, %.0f I2C transactions (%.0f KiB on the bus), %.2f mAh per day\n",
+         schedules.front().name.c_str(), saved, saved * I2C_TRANSACTIONS_PER_READ, saved * I2C_BYTES_PER_READ / 1024,
+         saved * COST_SENSOR_MS * CURRENT_ACTIVE_MA / 3.6e6);
+}
+
+// The synthetic day's own checks on the adaptive schedule
+static void checkDay(const Schedule& fast, const Schedule& adaptive, const std::vector<float>& err) {
+  char what[160];
+  double share = (double)adaptive.times.size() / fast.times.size();
+  snprintf(what, sizeof(what), "reads %.1f %% of those at the minimum interval, at most %.0f %%", share * 100,
+           SAMPLER_MAX_READ_SHARE * 100);
+  check(share <= SAMPLER_MAX_READ_SHARE, what);
+  for (int c = 0; c < 3; c++) {
+    snprintf(what, sizeof(what), "channel %d follows the trace within %g (%.3f)", c, SAMPLER_MAX_ERROR[c], err[c]);
+    check(err[c] <= SAMPLER_MAX_ERROR[c], what);
+  }
+
+  bool nightAtMax = true, reacted = false;
+  double reactS = 0;
+  for (size_t i = 0; i < adaptive.times.size(); i++) {
+    double t = adaptive.times[i];
+    if (t >= 1 * 3600 && t < 5 * 3600) nightAtMax &= adaptive.intervals[i] == SAMPLER_MAX_MS;
+    if (!reacted && t >= 10 * 3600 && adaptive.intervals[i] == SAMPLER_MIN_MS) {
+      reacted = true;
+      reactS = t - 10 * 3600;
+    }
+  }
+  check(nightAtMax, "the maximum interval through the night (01:00 to 05:00)");
+  snprintf(what, sizeof(what), "at the minimum interval %.0f s after the window opened, within %.0f s", reactS,
+           SAMPLER_REACT_S);
+  check(reacted && reactS <= SAMPLER_REACT_S, what);
+}
+
+// Feeds n readings spaced as the sampler asks; returns the last interval
+static uint32_t feed(uint32_t& nowMs, uint32_t n, float temp, float humidity, float pressure) {
+  uint32_t interval = samplerInterval();
+  for (uint32_t i = 0; i < n; i++) {
+    nowMs += interval;
+    interval = samplerUpdate(temp, humidity, pressure, nowMs);
+  }
+  return interval;
+}
+
+static void checkMissingReadings() {
+  uint32_t nowMs = 0;
+  samplerBegin(SAMPLER_MIN_MS, SAMPLER_MAX_MS);
+  check(feed(nowMs, 20, 21.5f, 45.0f, 1013.0f) == SAMPLER_MAX_MS, "a flat signal backs off to the maximum");
+  // A failed AHT20 read: the sensor's channels are NaN, the pressure goes on
+  check(feed(nowMs, 5, NAN, NAN, 1013.0f) == SAMPLER_MAX_MS, "failed temperature/humidity reads keep the interval");
+  // Nothing read at all: held wherever it was
+  uint32_t held = samplerInterval();
+  check(feed(nowMs, 5, NAN, NAN, NAN) == held, "a reading with no channel holds the interval");
+  // The AHT20 comes back with the value it had: not a change
+  check(feed(nowMs, 1, 21.5f, 45.0f, 1013.0f) == SAMPLER_MAX_MS, "a channel that comes back unchanged is no change");
+  // Ten minutes of failed reads, then 3 degC colder: a change across the gap still counts
+  feed(nowMs, 10, NAN, NAN, 1013.0f);
+  check(feed(nowMs, 1, 18.5f, 45.0f, 1013.0f) == SAMPLER_MIN_MS, "a change across failed reads is noticed");
+
+  // At the minimum after a change, readings with no channel don't let it back off
+  check(feed(nowMs, 5, NAN, NAN, NAN) == SAMPLER_MIN_MS, "no channel read at the minimum holds the minimum");
+
+  // Without the BMP280 the pressure is always NaN
+  samplerBegin(SAMPLER_MIN_MS, SAMPLER_MAX_MS);
+  nowMs = 0;
+  check(feed(nowMs, 20, 21.5f, 45.0f, NAN) == SAMPLER_MAX_MS, "without a pressure sensor a flat signal backs off");
+}
+
+int simSamplerTest(const char* path) {
+  SensorTrace trace;
+  if (path && !loadSensorTrace(path, trace)) {
+    printf("  FAIL can't read a trace (time_s,temp,humidity,pressure) from %s\n", path);
+    return 1;
+  }
+  if (!path) syntheticDay(trace);
+
+  std::vector<Schedule> schedules;
+  schedules.push_back(replay(trace, SAMPLER_FIXED_MS));
+  schedules.push_back(replay(trace, SAMPLER_MIN_MS));
+  schedules.push_back(replay(trace, 0));
+  std::vector<std::vector<float>> errors;
+  report(path ? path : "synthetic day", trace, schedules, errors);
+  if (!path) checkDay(schedules[1], schedules[2], errors[2]);
+
+  checkMissingReadings();
+  printf("sampler: %s\n", g_failures ? "FAILED" : "follows the signal, holds its interval on missing readings");
+  return g_failures ? 1 : 0;
+}
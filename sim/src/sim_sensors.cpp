@@ -0,0 +1,192 @@
+// Environment model behind the simulated AHT20, BMP280 and BH1750.
+#include <Adafruit_AHTX0.h>
+#include <Adafruit_BMP280.h>
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <mutex>
+#include <random>
+
+#include "sim.h"
+
+static std::mutex g_envMutex;
+static SimEnvironment g_override = {0, 0, 0, 0, true, true, true, false};
+static std::mt19937 g_noise(4242);
+
+// Daily temperature/humidity cycle plus a slow multi-day pressure wave, all driven
+// by the virtual clock so a sped-up run sees whole days pass. Light is daylight through
+// a window (with passing clouds), a lamp in the evening and a street light at night.
+SimEnvironment simReadEnvironment() {
+  std::lock_guard<std::mutex> lock(g_envMutex);
+  if (g_override.overridden) return g_override;
+
+  std::normal_distribution<float> n(0.0f, 1.0f);
+  time_t now = time(nullptr);
+  struct tm t;
+  localtime_r(&now, &t);
+  float dayFrac = (t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec) / 86400.0f;
+  float phase = 2.0f * (float)M_PI * (dayFrac - 0.625f); // Warmest around 15:00
+  float hours = (float)now / 3600.0f;
+
+  SimEnvironment env = g_override;
+  env.tempC = 24.0f + 3.0f * cosf(phase) + 0.05f * n(g_noise);
+  env.humidity = 50.0f - 8.0f * cosf(phase) + 0.2f * n(g_noise);
+  env.pressure_hPa = 1013.0f + 6.0f * sinf(2.0f * (float)M_PI * hours / 72.0f) + 0.03f * n(g_noise);
+  float hour = dayFrac * 24.0f;
+  float sun = sinf((float)M_PI * (hour - 6.0f) / 14.0f); // Up from 06:00 to 20:00
+  float clouds = 0.75f + 0.25f * sinf(2.0f * (float)M_PI * hours / 1.7f);
+  env.lux = 0.3f + (sun > 0 ? 450.0f * sun * clouds : 0.0f) + (hour >= 18.5f && hour < 23.0f ? 150.0f : 0.0f);
+  env.lux *= 1.0f + 0.01f * n(g_noise);
+  env.overridden = false;
+  return env;
+}
+
+void simOverrideEnvironment(float tempC, float humidity, float pressure_hPa, float lux) {
+  std::lock_guard<std::mutex> lock(g_envMutex);
+  g_override.tempC = tempC;
+  g_override.humidity = humidity;
+  g_override.pressure_hPa = pressure_hPa;
+  g_override.lux = lux;
+  g_override.overridden = true;
+}
+
+void simClearEnvironmentOverride() {
+  std::lock_guard<std::mutex> lock(g_envMutex);
+  g_override.overridden = false;
+}
+
+bool Adafruit_AHTX0::begin(TwoWire* wire, int32_t sensor_id, uint8_t i2c_address) {
+  (void)sensor_id;
+  wire_ = wire;
+  wire_->simTransfer(i2c_address, 4);
+  present_ = simReadEnvironment().ahtPresent;
+  return present_;
+}
+
+bool Adafruit_AHTX0::getEvent(sensors_event_t* humidity, sensors_event_t* temp) {
+  if (!present_) return false;
+  // Trigger (3 bytes), wait for the conversion like the Adafruit driver, read 6 bytes.
+  wire_->simTransfer(AHTX0_I2CADDR_DEFAULT, 3);
+  delay(80);
+  wire_->simTransfer(AHTX0_I2CADDR_DEFAULT, 6);
+  SimEnvironment env = simReadEnvironment();
+  if (!env.ahtPresent) return false;
+  memset(humidity, 0, sizeof(*humidity));
+  memset(temp, 0, sizeof(*temp));
+  humidity->relative_humidity = env.humidity;
+  temp->temperature = env.tempC;
+  humidity->timestamp = temp->timestamp = (int32_t)millis();
+  return true;
+}
+
+bool Adafruit_BMP280::begin(uint8_t addr, uint8_t chipid) {
+  (void)chipid;
+  wire_->simTransfer(addr, 2);
+  addr_ = addr;
+  present_ = (addr == BMP280_ADDRESS_ALT) && simReadEnvironment().bmpPresent;
+  return present_;
+}
+
+float Adafruit_BMP280::readTemperature() {
+  if (!present_) return NAN;
+  wire_->simTransfer(addr_, 4);
+  return simReadEnvironment().tempC;
+}
+
+float Adafruit_BMP280::readPressure() {
+  if (!present_) return NAN;
+  wire_->simTransfer(addr_, 4); // Temperature (for compensation)
+  wire_->simTransfer(addr_, 4); // Pressure
+  return simReadEnvironment().pressure_hPa * 100.0f;
+}
+
+float Adafruit_BMP280::readAltitude(float seaLevelhPa) {
+  float pressure = readPressure() / 100.0f;
+  return 44330.0f * (1.0f - powf(pressure / seaLevelhPa, 0.1903f));
+}
+
+// BH1750 at 0x23, emulated at register level so the firmware's own driver (opcodes,
+// MTreg writes, conversion time, the 16-bit result) runs against it unchanged. The
+// count follows the datasheet: lux * 1.2 * MTreg / 69, twice that in H-resolution
+// mode 2, 4-count steps in L-resolution mode, saturating at 0xFFFF.
+struct SimBh1750 {
+  std::mutex mutex;
+  bool powered = false;
+  uint8_t mtreg = 69;
+  uint8_t mode = 0;       // Measurement opcode in progress, 0 = none
+  uint64_t readyUs = 0;   // When it completes
+  uint16_t data = 0;      // Data register, as last completed
+};
+static SimBh1750 g_bh1750;
+
+static uint16_t bh1750Count(uint8_t mode, uint8_t mtreg, float lux) {
+  double counts = lux * 1.2 * mtreg / 69.0;
+  if ((mode & 0x0F) == 0x01) counts *= 2;                  // H-resolution mode 2
+  uint32_t c = counts >= 65535 ? 65535 : (uint32_t)counts;
+  if ((mode & 0x0F) == 0x03) c &= ~3u;                     // L-resolution mode
+  return (uint16_t)c;
+}
+
+// Typical conversion time; the driver waits the worst case
+static uint64_t bh1750ConversionUs(uint8_t mode, uint8_t mtreg) {
+  uint64_t atDefault = (mode & 0x0F) == 0x03 ? 16000 : 120000;
+  return atDefault * mtreg / 69;
+}
+
+// Latches a finished conversion into the data register. Call with the mutex held.
+static void bh1750Complete(SimBh1750& d) {
+  if (!d.mode || simMicros64() < d.readyUs) return;
+  d.data = bh1750Count(d.mode, d.mtreg, simReadEnvironment().lux);
+  if (d.mode & 0x10) {   // Continuous: the next conversion starts straight away
+    d.readyUs = simMicros64() + bh1750ConversionUs(d.mode, d.mtreg);
+  } else {               // One-time: powers down
+    d.mode = 0;
+    d.powered = false;
+  }
+}
+
+static bool bh1750Write(const uint8_t* data, size_t len) {
+  if (!simReadEnvironment().bh1750Present) return false;
+  std::lock_guard<std::mutex> lock(g_bh1750.mutex);
+  SimBh1750& d = g_bh1750;
+  bh1750Complete(d);
+  for (size_t i = 0; i < len; i++) {
+    uint8_t op = data[i];
+    if (op == 0x00) {
+      d.powered = false;
+      d.mode = 0;
+    } else if (op == 0x01) {
+      d.powered = true;
+    } else if (op == 0x07) {
+      if (d.powered) d.data = 0;
+    } else if ((op & 0xF8) == 0x40) {
+      d.mtreg = (uint8_t)((d.mtreg & 0x1F) | ((op & 0x07) << 5));
+    } else if ((op & 0xE0) == 0x60) {
+      d.mtreg = (uint8_t)((d.mtreg & 0xE0) | (op & 0x1F));
+    } else if (op == 0x10 || op == 0x11 || op == 0x13 || op == 0x20 || op == 0x21 || op == 0x23) {
+      d.powered = true;
+      d.mode = op;
+      d.readyUs = simMicros64() + bh1750ConversionUs(op, d.mtreg);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool bh1750Read(uint8_t* data, size_t len) {
+  if (!simReadEnvironment().bh1750Present) return false;
+  std::lock_guard<std::mutex> lock(g_bh1750.mutex);
+  bh1750Complete(g_bh1750);
+  for (size_t i = 0; i < len; i++) data[i] = i == 0 ? g_bh1750.data >> 8 : i == 1 ? g_bh1750.data & 0xFF : 0xFF;
+  return true;
+}
+
+bool simBh1750Converting() {
+  std::lock_guard<std::mutex> lock(g_bh1750.mutex);
+  return g_bh1750.mode && simMicros64() < g_bh1750.readyUs;
+}
+
+void simSensorsBegin() {
+  simI2CRegister(0x23, SimI2CDevice{bh1750Write, bh1750Read});
+}
@@ -0,0 +1,52 @@
+// Light sleep: wake sources, and the power management that turns on the automatic light
+// sleep. Nothing sleeps; time under a no-light-sleep lock is recorded for the checks.
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "sim.h"
+
+struct SimPmLock {
+  esp_pm_lock_type_t type;
+  uint32_t held;
+};
+
+static bool pmAvailable = true;
+static uint32_t noSleepHeld = 0;
+static uint64_t noSleepSinceUs = 0, noSleepUs = 0;
+
+esp_err_t esp_sleep_enable_gpio_wakeup() { return 0; }
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) { (void)pin; (void)type; return 0; }
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) { (void)pin; return 0; }
+
+void simPmSetAvailable(bool available) { pmAvailable = available; }
+
+uint64_t simPmNoSleepUs() {
+  return noSleepUs + (noSleepHeld ? simMicros64() - noSleepSinceUs : 0);
+}
+
+esp_err_t esp_pm_configure(const void* config) {
+  (void)config;
+  return pmAvailable ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char* name, esp_pm_lock_handle_t* handle) {
+  (void)arg; (void)name;
+  *handle = new SimPmLock{type, 0};
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+  if (handle->held++ == 0 && handle->type == ESP_PM_NO_LIGHT_SLEEP && noSleepHeld++ == 0) {
+    noSleepSinceUs = simMicros64();
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+  if (!handle->held) return ESP_ERR_INVALID_STATE;
+  if (--handle->held == 0 && handle->type == ESP_PM_NO_LIGHT_SLEEP && --noSleepHeld == 0) {
+    noSleepUs += simMicros64() - noSleepSinceUs;
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,137 @@
+// --snapshot-test: hammers the sensor snapshot's seqlock (sensor_snapshot.h) from host
+// threads. One writer publishes as fast as it can, every field of publication k derived
+// from k, while SNAPSHOT_READERS readers take copies with sensorSnapshotRead() and check
+// that all fields of each copy belong to the same publication and that the versions a
+// reader sees never go back. The run lasts at least SNAPSHOT_MIN_SEC and goes on (up to
+// SNAPSHOT_MAX_SEC) until readers have had to retry SNAPSHOT_MIN_RETRIES times, so the
+// writer has really got in their way; on a single core that takes preemption in the
+// middle of a copy. The exit code is 1 on any torn or stale copy, or if readers never
+// overlapped the writer.
+#include "sensor_snapshot.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sim.h"
+
+const int SNAPSHOT_READERS = 3;
+const double SNAPSHOT_MIN_SEC = 1.0;
+const double SNAPSHOT_MAX_SEC = 10.0;
+const uint32_t SNAPSHOT_MIN_RETRIES = 20;
+
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+// Publication k. Floats take k modulo 2^16 so every value is exact.
+static SensorSnapshot snapshotFor(uint32_t k) {
+  SensorSnapshot s;
+  float f = (float)(k & 0xFFFF);
+  s.version = 0;
+  s.sampledAt = k;
+  s.epochMs = (int64_t)k * 1000 + 7;
+  s.tempC = f;
+  s.humidity = f + 1;
+  s.pressureHpa = f + 2;
+  s.state = (uint8_t)k;
+  s.tempOk = k & 1;
+  s.pressureOk = !(k & 1);
+  for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) s.conditions[c] = (SensorCondition)((k + c) % SENSOR_CONDITIONS);
+  s.forecast.valid = k & 2;
+  s.forecast.changePer3h = -f;
+  s.forecast.seaLevelHpa = f + 3;
+  s.forecast.tendency = (PressureTendency)(k % 3);
+  s.forecast.letter = (char)('A' + k % 26);
+  s.lux = f + 4;
+  return s;
+}
+
+// True if every field of s matches the publication its sampledAt names
+static bool consistent(const SensorSnapshot& s, uint32_t versionOffset) {
+  SensorSnapshot want = snapshotFor(s.sampledAt);
+  bool ok = s.version == s.sampledAt + versionOffset && s.epochMs == want.epochMs && s.tempC == want.tempC &&
+            s.humidity == want.humidity && s.pressureHpa == want.pressureHpa && s.state == want.state &&
+            s.tempOk == want.tempOk && s.pressureOk == want.pressureOk && s.lux == want.lux &&
+            s.forecast.valid == want.forecast.valid && s.forecast.changePer3h == want.forecast.changePer3h &&
+            s.forecast.seaLevelHpa == want.forecast.seaLevelHpa && s.forecast.tendency == want.forecast.tendency &&
+            s.forecast.letter == want.forecast.letter;
+  for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) ok &= s.conditions[c] == want.conditions[c];
+  return ok;
+}
+
+struct ReaderTally {
+  uint64_t reads = 0;
+  uint64_t torn = 0;
+  uint64_t backwards = 0;
+};
+
+int simSnapshotTest() {
+  // Publication 1 is made before the readers start, so they never see an empty snapshot
+  uint32_t versionOffset = sensorSnapshotRead().version;
+  sensorSnapshotPublish(snapshotFor(1));
+  uint32_t retriesBefore = sensorSnapshotRetries();
+
+  std::atomic<bool> stop(false);
+  uint32_t published = 1;
+  std::thread writer([&] {
+    while (!stop.load(std::memory_order_relaxed)) sensorSnapshotPublish(snapshotFor(++published));
+  });
+  std::vector<ReaderTally> tallies(SNAPSHOT_READERS);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < SNAPSHOT_READERS; r++) {
+    readers.emplace_back([&, r] {
+      ReaderTally& tally = tallies[r];
+      uint32_t last = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        SensorSnapshot s = sensorSnapshotRead();
+        tally.reads++;
+        if (!consistent(s, versionOffset)) {
+          if (tally.torn++ == 0) {
+            printf("  FAIL reader %d: torn copy, version %u with sampledAt %u, tempC %g, epochMs %lld\n", r,
+                   (unsigned)s.version, (unsigned)s.sampledAt, s.tempC, (long long)s.epochMs);
+          }
+        }
+        if (s.version < last) tally.backwards++;
+        last = s.version;
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < SNAPSHOT_MIN_SEC ||
+           (sensorSnapshotRetries() - retriesBefore < SNAPSHOT_MIN_RETRIES && elapsed < SNAPSHOT_MAX_SEC));
+  stop = true;
+  writer.join();
+  for (std::thread& t : readers) t.join();
+
+  ReaderTally all;
+  for (const ReaderTally& t : tallies) {
+    all.reads += t.reads;
+    all.torn += t.torn;
+    all.backwards += t.backwards;
+  }
+  uint32_t retries = sensorSnapshotRetries() - retriesBefore;
+  printf("  %.1f s: %u publications, %llu reads by %d readers, %u retries, %llu torn, %llu went back\n", elapsed,
+         (unsigned)published, (unsigned long long)all.reads, SNAPSHOT_READERS, (unsigned)retries,
+         (unsigned long long)all.torn, (unsigned long long)all.backwards);
+  check(all.torn == 0, "every copy is one whole publication");
+  check(all.backwards == 0, "a reader never sees an older publication after a newer one");
+  check(retries > 0, "readers overlapped the writer");
+  check(consistent(sensorSnapshotRead(), versionOffset) && sensorSnapshotRead().sampledAt == published,
+        "the last publication is the one read afterwards");
+  printf("snapshot: %s\n", g_failures ? "FAILED" : "no torn or stale copy");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+// --sound-bench: times the sound level meter's kernels (sound_level.h) on the host over
+// a recorded WAV file, then runs the meter over it and prints the levels it measured.
+#include "sound_level.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+#include "sim_wav.h"
+
+const double BENCH_MIN_SEC = 0.5;   // Each kernel is repeated over the file for at least this long
+
+static SoundMeter g_meter;          // Large; kept off the stack
+
+// Runs pass() over the whole file until BENCH_MIN_SEC have gone by; ns per sample
+template <typename Pass>
+static double timePerSample(size_t samples, Pass pass) {
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint32_t passes = 0;
+  do {
+    pass();
+    passes++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return elapsed * 1e9 / ((double)passes * samples);
+}
+
+static void report(const char* name, double ns) {
+  // Budget: one sample every 1/16000 s
+  double share = ns * SOUND_SAMPLE_RATE / 1e9 * 100;
+  printf("  %-14s %8.2f ns/sample  %9.0fx real time  %7.3f %% of a core\n", name, ns, 100 / share, share);
+}
+
+int simSoundBench(const char* path) {
+  SimWav wav;
+  std::string error;
+  if (!simLoadWav(path, wav, error)) {
+    fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return 1;
+  }
+  const std::vector<int32_t>& in = wav.samples;
+  size_t n = in.size();
+  if (n < SOUND_BLOCK_SAMPLES) {
+    fprintf(stderr, "%s: shorter than one 125 ms block\n", path);
+    return 1;
+  }
+  printf("%s: %u Hz, %u-bit, %u channel(s), %.1f s\n", path, (unsigned)wav.rate, (unsigned)wav.bits,
+         (unsigned)wav.channels, (double)n / wav.rate);
+  if (wav.rate != SOUND_SAMPLE_RATE) {
+    printf("  note: the A-weighting is designed for %u Hz; levels of this file are off\n", (unsigned)SOUND_SAMPLE_RATE);
+  }
+
+  // Kernels, chunk by chunk as the meter calls them. Each stage works on the previous
+  // stage's output, prepared outside the timing.
+  std::vector<int32_t> dcOut(n), filtered(n), work(n);
+  SoundDcBlocker dc = {};
+  soundDcBlock(dc, in.data(), dcOut.data(), n);
+  SoundBiquad aw[SOUND_AWEIGHT_STAGES];
+  soundAWeightDesign(aw, SOUND_SAMPLE_RATE);
+  filtered = dcOut;
+  soundBiquads(aw, SOUND_AWEIGHT_STAGES, filtered.data(), n);
+
+  volatile uint64_t sink = 0;
+  printf("kernels (host, %u-sample chunks):\n", (unsigned)SOUND_CHUNK);
+  report("dc_block", timePerSample(n, [&]() {
+    for (size_t i = 0; i < n; i += SOUND_CHUNK) {
+      soundDcBlock(dc, in.data() + i, work.data() + i, std::min<size_t>(SOUND_CHUNK, n - i));
+    }
+  }));
+  report("peak", timePerSample(n, [&]() {
+    for (size_t i = 0; i < n; i += SOUND_CHUNK) sink += soundPeak(dcOut.data() + i, std::min<size_t>(SOUND_CHUNK, n - i));
+  }));
+  double copyNs = timePerSample(n, [&]() { work = dcOut; });
+  report("a_weighting", timePerSample(n, [&]() {
+    work = dcOut;
+    for (size_t i = 0; i < n; i += SOUND_CHUNK) {
+      soundBiquads(aw, SOUND_AWEIGHT_STAGES, work.data() + i, std::min<size_t>(SOUND_CHUNK, n - i));
+    }
+  }) - copyNs);
+  report("sum_squares", timePerSample(n, [&]() {
+    for (size_t i = 0; i < n; i += SOUND_CHUNK) {
+      sink += soundSumSquares(filtered.data() + i, std::min<size_t>(SOUND_CHUNK, n - i));
+    }
+  }));
+  report("meter (all)", timePerSample(n, [&]() {
+    soundMeterBegin(g_meter);
+    soundMeterProcess(g_meter, in.data(), n);
+  }));
+
+  // Levels, a second at a time so every second's peak is seen
+  soundMeterBegin(g_meter);
+  float loudestSec = 0, peak = 0;
+  uint32_t loudestAt = 0;
+  for (size_t i = 0; i < n; i += SOUND_SAMPLE_RATE) {
+    soundMeterProcess(g_meter, in.data() + i, std::min<size_t>(SOUND_SAMPLE_RATE, n - i));
+    SoundLevels l = soundMeterLevels(g_meter);
+    if (!l.valid) continue;
+    if (l.laeq1s > loudestSec) {
+      loudestSec = l.laeq1s;
+      loudestAt = l.seconds;
+    }
+    if (l.lzpeak1s > peak) peak = l.lzpeak1s;
+  }
+  float laeq = 0, lamax = 0;
+  soundMeterTakeInterval(g_meter, laeq, lamax);
+  SoundLevels l = soundMeterLevels(g_meter);
+  printf("levels (dB SPL at the INMP441's nominal sensitivity, 0 dBFS = 120 dB):\n");
+  printf("  LAeq %.1f over %u s, LAmax (125 ms) %.1f, LZpeak %.1f\n", laeq, (unsigned)l.seconds, lamax, peak);
+  printf("  loudest second: LAeq,1s %.1f ending at %u s; last minute: LAeq,1min %.1f\n", loudestSec,
+         (unsigned)loudestAt, l.laeq1min);
+  return 0;
+}
@@ -0,0 +1,167 @@
+// --stats-bench: checks the rolling statistics (env_stats.h) against an exact
+// recomputation and times a reading. A private EnvStats gets weeks of irregular
+// readings: spacing from a second to a few minutes, now and then a gap of hours, and
+// pressure missing for stretches. At random points every window and channel is queried
+// and compared with the same window computed from the stored readings in double
+// precision: counts and extremes must match exactly, mean and standard deviation to
+// STATS_TOLERANCE. Then the cost of a reading is timed for growing numbers of readings;
+// it must stay flat (within STATS_MAX_GROWTH). The exit code is 1 if any check fails.
+#include "env_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <deque>
+#include <random>
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const uint32_t STATS_CHECK_READINGS = 200000;
+const uint32_t STATS_QUERY_EVERY = 997;       // Readings between comparisons, on average
+const double STATS_TOLERANCE = 1e-4;          // Of the channel's spread, for mean and stddev
+const double STATS_MAX_GROWTH = 3.0;          // Cost at the largest count against the smallest
+const uint32_t STATS_BENCH_COUNTS[] = {1000, 10000, 100000, 500000};
+const uint32_t WEEK_S = 7 * 24 * 3600;
+const uint32_t BUCKET_SEC[ENV_WINDOWS] = {5 * 60, 60 * 60, 6 * 60 * 60};   // env_stats.cpp
+const uint8_t BUCKETS[ENV_WINDOWS] = {12, 24, 28};
+
+static int g_failures = 0;
+static int g_mismatches = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+struct Reading {
+  uint32_t t;
+  float v[ENV_CHANNELS];   // NaN where the channel had no value
+};
+
+// The summary of one window over the stored readings, in double precision
+static EnvSummary exact(const std::deque<Reading>& readings, EnvWindow w, EnvChannel c, uint32_t nowS) {
+  uint32_t nowId = nowS / BUCKET_SEC[w];
+  uint32_t first = nowId >= BUCKETS[w] ? nowId - BUCKETS[w] + 1 : 0;
+  double sum = 0, sumSq = 0;
+  EnvSummary out = {0, INFINITY, -INFINITY, NAN, NAN};
+  for (const Reading& r : readings) {
+    uint32_t id = r.t / BUCKET_SEC[w];
+    float x = r.v[c];
+    if (id < first || id > nowId || isnan(x)) continue;
+    out.count++;
+    sum += x;
+    out.min = fminf(out.min, x);
+    out.max = fmaxf(out.max, x);
+  }
+  if (!out.count) return {0, NAN, NAN, NAN, NAN};
+  double mean = sum / out.count;
+  for (const Reading& r : readings) {
+    uint32_t id = r.t / BUCKET_SEC[w];
+    if (id < first || id > nowId || isnan(r.v[c])) continue;
+    sumSq += (r.v[c] - mean) * (r.v[c] - mean);
+  }
+  out.mean = mean;
+  out.stddev = out.count > 1 ? sqrt(sumSq / (out.count - 1)) : 0;
+  return out;
+}
+
+static void compare(EnvStats& stats, const std::deque<Reading>& readings, uint32_t nowS) {
+  const double spread[ENV_CHANNELS] = {20, 60, 40, 30};   // Rough range of each channel
+  for (uint8_t w = 0; w < ENV_WINDOWS; w++) {
+    for (uint8_t c = 0; c < ENV_CHANNELS; c++) {
+      EnvSummary got = envStatsGet(stats, (EnvWindow)w, (EnvChannel)c, nowS);
+      EnvSummary want = exact(readings, (EnvWindow)w, (EnvChannel)c, nowS);
+      double tol = STATS_TOLERANCE * spread[c];
+      bool ok = got.count == want.count;
+      if (ok && want.count) {
+        ok = got.min == want.min && got.max == want.max && fabs(got.mean - want.mean) <= tol &&
+             fabs(got.stddev - want.stddev) <= tol;
+      }
+      if (!ok && g_mismatches++ < 10) {
+        printf("  FAIL at %us, %s %s: n=%u min=%g max=%g mean=%g sd=%g, expected n=%u min=%g max=%g mean=%g sd=%g\n",
+               (unsigned)nowS, envWindowName((EnvWindow)w), envChannelName((EnvChannel)c), (unsigned)got.count,
+               got.min, got.max, got.mean, got.stddev, (unsigned)want.count, want.min, want.max, want.mean,
+               want.stddev);
+      }
+      if (!ok) g_failures++;
+    }
+  }
+}
+
+// Weeks of irregular readings, compared with the exact windows as they go
+static void checkWindows() {
+  static EnvStats stats;
+  envStatsBegin(stats);
+  std::mt19937 rng(20240611);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::deque<Reading> readings;
+  uint32_t t = 1000;
+  double temp = 21, humidity = 45, pressure = 1012;
+  bool pressureMissing = false;
+  uint32_t queries = 0;
+
+  for (uint32_t i = 0; i < STATS_CHECK_READINGS; i++) {
+    double gap = unit(rng);
+    t += gap < 0.0005 ? 3600 + (uint32_t)(unit(rng) * 30000) : 1 + (uint32_t)(gap * gap * 240);
+    temp = fmin(fmax(temp + (unit(rng) - 0.5) * 0.3, 5), 35);
+    humidity = fmin(fmax(humidity + (unit(rng) - 0.5) * 1.0, 10), 95);
+    pressure = fmin(fmax(pressure + (unit(rng) - 0.5) * 0.2, 980), 1040);
+    if (unit(rng) < 0.0003) pressureMissing = !pressureMissing;   // BMP280 away for a while
+
+    Reading r;
+    r.t = t;
+    r.v[ENV_TEMP] = (float)temp;
+    r.v[ENV_HUMIDITY] = (float)humidity;
+    r.v[ENV_PRESSURE] = pressureMissing ? NAN : (float)pressure;
+    r.v[ENV_DEW_POINT] = envDewPoint(r.v[ENV_TEMP], r.v[ENV_HUMIDITY]);
+    envStatsAdd(stats, t, r.v[ENV_TEMP], r.v[ENV_HUMIDITY], r.v[ENV_PRESSURE]);
+    readings.push_back(r);
+    while (readings.front().t + WEEK_S + BUCKET_SEC[ENV_7D] < t) readings.pop_front();
+
+    if (unit(rng) < 1.0 / STATS_QUERY_EVERY) {
+      // Now, or some time after the latest reading, when windows have partly emptied
+      uint32_t later = unit(rng) < 0.5 ? 0 : (uint32_t)(unit(rng) * 2 * 24 * 3600);
+      compare(stats, readings, t + later);
+      queries++;
+    }
+  }
+  printf("  %u readings, %u queries of all %u windows and channels against the exact values\n",
+         (unsigned)STATS_CHECK_READINGS, (unsigned)queries, ENV_WINDOWS * ENV_CHANNELS);
+}
+
+// Average cost of a reading in a fresh instance fed count readings 5 s apart, repeated
+// until BENCH_MIN_SEC have gone by
+static double nsPerReading(uint32_t count) {
+  static EnvStats bench;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  uint64_t added = 0;
+  do {
+    envStatsBegin(bench);
+    for (uint32_t i = 0; i < count; i++) {
+      envStatsAdd(bench, i * 5, 22.0f + (i % 97) * 0.01f, 45.0f + (i % 13) * 0.1f, 1010.0f + (i % 7) * 0.1f);
+    }
+    added += count;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  return elapsed * 1e9 / added;
+}
+
+int simStatsBench() {
+  checkWindows();
+
+  double first = 0, last = 0;
+  for (uint32_t count : STATS_BENCH_COUNTS) {
+    last = nsPerReading(count);
+    if (!first) first = last;
+    printf("  %7u readings: %6.1f ns/reading (host)\n", (unsigned)count, last);
+  }
+  printf("  state: %u bytes\n", (unsigned)sizeof(EnvStats));
+  check(last <= first * STATS_MAX_GROWTH, "the cost of a reading does not grow with the number of readings");
+  printf("env stats: %s\n", g_failures ? "FAILED" : "every window matches the exact values");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+// esp_timer on std::thread and the virtual clock.
+#include <esp_timer.h>
+
+#include <atomic>
+#include <thread>
+
+#include "sim.h"
+
+struct SimEspTimer {
+  esp_timer_create_args_t args;
+  std::atomic<bool> running;
+  std::atomic<uint32_t> generation;   // Bumped by every start and stop, so an old thread bows out
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  SimEspTimer* t = new SimEspTimer();
+  t->args = *args;
+  t->running = false;
+  t->generation = 0;
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  if (timer->running) return -1;   // ESP_ERR_INVALID_STATE
+  uint32_t generation = ++timer->generation;
+  timer->running = true;
+  std::thread([timer, periodUs, generation]() {
+    uint64_t due = simMicros64() + periodUs;
+    while (timer->generation == generation) {
+      uint64_t now = simMicros64();
+      if (now < due) {
+        simSleepMicros(due - now);
+        continue;
+      }
+      timer->args.callback(timer->args.arg);
+      due += periodUs;
+      if (timer->args.skip_unhandled_events && due < now) due = now + periodUs;
+    }
+  }).detach();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->running) return -1;
+  timer->running = false;
+  ++timer->generation;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() { return (int64_t)simMicros64(); }
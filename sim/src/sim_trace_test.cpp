@@ -0,0 +1,135 @@
+// --trace-test: host checks of the crash trace (crash_trace.h): event encoding and
+// decoding at the edges of every field, ring order across the wrap, the checks that
+// decide whether RTC memory holds a trace after a reset, and the JSON of each event
+// type. Then times recording one event. The exit code is 1 if any check fails.
+#include "crash_trace.h"
+
+#include <esp_system.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "sim.h"
+
+const double BENCH_MIN_SEC = 0.5;
+
+static TraceRing g_ring;            // 2 KB each; kept off the stack
+static TraceSnapshot g_snap;
+static int g_failures = 0;
+
+static void check(bool ok, const char* what) {
+  if (!ok) {
+    printf("  FAIL %s\n", what);
+    g_failures++;
+  }
+}
+
+static void checkJson(uint32_t word, const char* expected) {
+  char out[128];
+  traceEventJson(traceDecode(word), out, sizeof(out));
+  if (strcmp(out, expected) != 0) {
+    printf("  FAIL json %s != %s\n", out, expected);
+    g_failures++;
+  }
+}
+
+static void checkEncoding() {
+  for (uint8_t t = 0; t < TRACE_TYPES; t++) {
+    const uint32_t args[] = {0, 1, 0x7FFFFF, TRACE_ARG_MASK};
+    for (uint32_t arg : args) {
+      TraceEvent e = traceDecode(traceEncode((TraceType)t, arg));
+      check(e.type == t && e.arg == arg, "encode/decode round trip");
+    }
+  }
+  // Arguments wider than 24 bits are cut, never spill into the type
+  check(traceDecode(traceEncode(TRACE_LOOP, 0x12345678)).type == TRACE_LOOP, "wide argument keeps its type");
+  check(traceDecode(traceEncode(TRACE_LOOP, 0x12345678)).arg == 0x345678, "wide argument is masked");
+
+  uint32_t i2c = traceI2cArg(0x76, true, 412);
+  check(i2c >> 17 == 0x76 && ((i2c >> 16) & 1) && (i2c & 0xFFFF) == 412, "i2c fields");
+  check((traceI2cArg(0x3C, false, 1000000) & 0xFFFF) == 0xFFFF, "i2c time saturates");
+  check(!((traceI2cArg(0x3C, false, 5) >> 16) & 1), "i2c failure bit");
+  check(traceDecode(traceEncode(TRACE_I2C, traceI2cArg(0x7F, true, 0xFFFF))).arg >> 17 == 0x7F, "i2c top address");
+}
+
+static void checkRing() {
+  // Fewer events than the ring holds: all of them, in order
+  traceBegin(g_ring, 1);
+  for (uint32_t i = 0; i < 100; i++) traceRecordTo(g_ring, TRACE_LOOP, i);
+  check(traceSnapshot(g_ring, ESP_RST_TASK_WDT, g_snap), "trace kept after a watchdog reset");
+  check(g_snap.count == 100 && g_snap.recorded == 100 && g_snap.boot == 1, "partial ring counts");
+  bool ordered = true;
+  for (uint16_t i = 0; i < g_snap.count; i++) ordered &= traceDecode(g_snap.events[i]).arg == i;
+  check(ordered, "partial ring order");
+
+  // Wrapped several times: the newest TRACE_EVENTS, oldest first
+  const uint32_t total = TRACE_EVENTS * 3 + 17;
+  traceBegin(g_ring, 7);
+  for (uint32_t i = 0; i < total; i++) traceRecordTo(g_ring, TRACE_STAGE, i);
+  check(traceSnapshot(g_ring, ESP_RST_PANIC, g_snap), "trace kept after a panic");
+  check(g_snap.count == TRACE_EVENTS && g_snap.recorded == total && g_snap.boot == 7, "wrapped ring counts");
+  ordered = true;
+  for (uint16_t i = 0; i < g_snap.count; i++) ordered &= traceDecode(g_snap.events[i]).arg == total - TRACE_EVENTS + i;
+  check(ordered, "wrapped ring order");
+
+  // Power-on and uninitialized memory hold no trace
+  check(!traceSnapshot(g_ring, ESP_RST_POWERON, g_snap) && g_snap.count == 0, "power-on discards the trace");
+  memset(&g_ring, 0xA5, sizeof(g_ring));
+  check(!traceSnapshot(g_ring, ESP_RST_BROWNOUT, g_snap) && g_snap.count == 0, "garbage is not a trace");
+  traceBegin(g_ring, 2);
+  check(traceSnapshot(g_ring, ESP_RST_SW, g_snap) && g_snap.count == 0, "empty trace after a restart");
+}
+
+static void checkDescriptions() {
+  checkJson(traceEncode(TRACE_BOOT, ESP_RST_BROWNOUT), "{\"type\":\"boot\",\"reason\":\"brownout\"}");
+  checkJson(traceEncode(TRACE_LOOP, 123456), "{\"type\":\"loop\",\"ms\":123456}");
+  checkJson(traceEncode(TRACE_STAGE, TRACE_STAGE_SENSORS), "{\"type\":\"stage\",\"stage\":\"sensors\"}");
+  checkJson(traceEncode(TRACE_HANDLER, TRACE_H_EXPORT), "{\"type\":\"handler\",\"path\":\"/export\"}");
+  checkJson(traceEncode(TRACE_I2C, traceI2cArg(0x38, true, 412)),
+            "{\"type\":\"i2c\",\"addr\":56,\"ok\":true,\"us\":412}");
+  checkJson(traceEncode(TRACE_HEAP, 181234), "{\"type\":\"heap\",\"min_free\":181234}");
+  checkJson(traceEncode(TRACE_RESTART, TRACE_RESTART_OTA), "{\"type\":\"restart\",\"by\":\"ota\"}");
+  // Unknown codes (a newer firmware's trace read by an older one) still decode
+  checkJson(traceEncode((TraceType)0x42, 9), "{\"type\":\"?\",\"code\":66,\"arg\":9}");
+  checkJson(traceEncode(TRACE_STAGE, 200), "{\"type\":\"stage\",\"stage\":\"?\"}");
+  check(strcmp(resetReasonName(ESP_RST_TASK_WDT), "task_wdt") == 0, "reset reason name");
+  check(strcmp(resetReasonName(99), "unknown") == 0, "unknown reset reason");
+}
+
+static uint64_t cycleCount() {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+int simTraceTest() {
+  checkEncoding();
+  checkRing();
+  checkDescriptions();
+  printf("crash trace: %s\n", g_failures ? "FAILED" : "encoder, ring and decoder checks pass");
+  if (g_failures) return 1;
+
+  traceBegin(g_ring, 1);
+  const uint32_t batch = 1000;
+  auto start = std::chrono::steady_clock::now();
+  uint64_t startCycles = cycleCount();
+  uint64_t events = 0;
+  double elapsed = 0;
+  do {
+    for (uint32_t i = 0; i < batch; i++) traceRecordTo(g_ring, TRACE_STAGE, i);
+    events += batch;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  double cycles = (double)(cycleCount() - startCycles) / events;
+  printf("  record one event: %.2f ns", elapsed * 1e9 / events);
+  if (cycles > 0) printf(", %.1f cycles", cycles);
+  printf(" (host)\n");
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include <ArduinoOTA.h>
+#include <Update.h>
+
+#include "sim.h"
+
+UpdateClass Update;
+ArduinoOTAClass ArduinoOTA;
+
+bool UpdateClass::begin(size_t size) {
+  (void)size;
+  if (file_) fclose(file_);
+  file_ = fopen(simStatePath("firmware_upload.bin").c_str(), "wb");
+  written_ = 0;
+  finished_ = false;
+  error_ = (file_ == nullptr);
+  return !error_;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+  if (!file_) return 0;
+  size_t n = fwrite(data, 1, len, file_);
+  written_ += n;
+  return n;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  (void)evenIfRemaining;
+  if (!file_) return false;
+  fclose(file_);
+  file_ = nullptr;
+  finished_ = !error_ && written_ > 0;
+  return finished_;
+}
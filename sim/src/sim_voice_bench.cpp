@@ -0,0 +1,290 @@
+// --voice-bench: times the speech front end's kernels (voice_frontend.h) on the host over
+// a recorded WAV file, and checks its output against a straightforward double-precision
+// implementation of the same pipeline: same framing, DC blocker, pre-emphasis, window,
+// mel bands, floor and DCT, but a floating-point FFT and natural logs. The exit code is 1
+// when the coefficients or the log-mel energies are further off than the tolerances.
+#include "voice_frontend.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "sim.h"
+#include "sim_wav.h"
+
+const double BENCH_MIN_SEC = 0.5;
+const double MFCC_TOLERANCE = 0.05;       // Largest error in any coefficient of any frame
+const double MFCC_RMS_TOLERANCE = 0.01;
+const double LOG_MEL_TOLERANCE = 0.05;    // In ln units, for bands above the floor + 5
+const double VAD_AGREEMENT_MIN = 0.98;    // Share of frames with the same decision
+
+static VoiceFrontend g_voice;             // Large; kept off the stack
+
+// --- Reference ---
+
+struct Reference {
+  double dcX1 = 0, dcY1 = 0, last = 0;
+  bool started = false;
+  std::vector<double> history;            // Pre-emphasized samples, newest last
+  double hopEnergy = 0;
+  int hopCrossings = 0, hopFill = 0;
+  double floorDb = NAN;
+  int run = 0, hang = 0;
+  bool speech = false;
+  std::vector<double> window, points;
+};
+
+static double melOf(double hz) { return 2595 * log10(1 + hz / 700); }
+static double hzOf(double mel) { return 700 * (pow(10, mel / 2595) - 1); }
+
+static void referenceBegin(Reference& r) {
+  r = Reference();
+  for (int i = 0; i < VOICE_FRAME_SAMPLES; i++) r.window.push_back(0.54 - 0.46 * cos(2 * M_PI * i / (VOICE_FRAME_SAMPLES - 1)));
+  double low = melOf(VOICE_MEL_LOW_HZ), high = melOf(VOICE_MEL_HIGH_HZ);
+  for (int i = 0; i < VOICE_MEL_BANDS + 2; i++) r.points.push_back(hzOf(low + (high - low) * i / (VOICE_MEL_BANDS + 1)));
+}
+
+static void fft(std::vector<std::complex<double>>& a) {
+  size_t n = a.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    std::complex<double> wl = std::polar(1.0, -2 * M_PI / len);
+    for (size_t g = 0; g < n; g += len) {
+      std::complex<double> w = 1;
+      for (size_t k = 0; k < len / 2; k++, w *= wl) {
+        std::complex<double> t = a[g + k + len / 2] * w;
+        a[g + k + len / 2] = a[g + k] - t;
+        a[g + k] += t;
+      }
+    }
+  }
+}
+
+// Feeds a hop; true with the frame's log-mel energies, coefficients and VAD decision
+// once there is a full frame
+static bool referenceHop(Reference& r, const int32_t* samples, std::vector<double>& logMel, std::vector<double>& mfcc,
+                         bool& speech) {
+  for (int i = 0; i < VOICE_HOP_SAMPLES; i++) {
+    double x = samples[i] / 8388608.0;
+    if (!r.started) {
+      r.dcX1 = x;
+      r.started = true;
+    }
+    double d = x - r.dcX1 + r.dcY1 * (1 - 1.0 / 1024);
+    r.dcX1 = x;
+    r.dcY1 = d;
+    r.hopEnergy += d * d;
+    r.hopCrossings += (d < 0) != (r.last < 0);
+    r.history.push_back(d - VOICE_PREEMPHASIS * r.last);
+    r.last = d;
+  }
+  if (r.history.size() > VOICE_FRAME_SAMPLES) r.history.erase(r.history.begin(), r.history.end() - VOICE_FRAME_SAMPLES);
+
+  double db = r.hopEnergy > 0 ? 10 * log10(2 * r.hopEnergy / VOICE_HOP_SAMPLES) : -200;
+  bool first = std::isnan(r.floorDb);
+  bool like = !first && db >= VOICE_VAD_MIN_DBFS &&
+              (db > r.floorDb + VOICE_VAD_MARGIN_DB ||
+               (db > r.floorDb + VOICE_VAD_ZCR_MARGIN_DB && r.hopCrossings >= VOICE_VAD_ZCR_MIN));
+  if (first || db < r.floorDb) r.floorDb = db;
+  else r.floorDb += VOICE_VAD_FLOOR_RISE_DB * VOICE_HOP_SAMPLES / SOUND_SAMPLE_RATE;
+  r.run = like ? r.run + 1 : 0;
+  if (like && (r.speech || r.run >= VOICE_VAD_ONSET_FRAMES)) {
+    r.speech = true;
+    r.hang = VOICE_VAD_HANGOVER_FRAMES;
+  } else if (r.speech && --r.hang == 0) {
+    r.speech = false;
+  }
+  speech = r.speech;
+  r.hopEnergy = 0;
+  r.hopCrossings = 0;
+  if (r.history.size() < VOICE_FRAME_SAMPLES) return false;
+
+  std::vector<std::complex<double>> x(VOICE_FFT_SIZE);
+  for (int i = 0; i < VOICE_FRAME_SAMPLES; i++) x[i] = r.history[i] * r.window[i];
+  fft(x);
+  std::vector<double> mel(VOICE_MEL_BANDS, 0.0);
+  for (int k = 0; k < VOICE_BINS; k++) {
+    double hz = (double)k * SOUND_SAMPLE_RATE / VOICE_FFT_SIZE, power = std::norm(x[k]);
+    for (int m = 0; m < VOICE_MEL_BANDS; m++) {
+      double lo = r.points[m], mid = r.points[m + 1], hi = r.points[m + 2];
+      if (hz >= lo && hz < mid) mel[m] += power * (hz - lo) / (mid - lo);
+      else if (hz >= mid && hz < hi) mel[m] += power * (hi - hz) / (hi - mid);
+    }
+  }
+  logMel.assign(VOICE_MEL_BANDS, 0.0);
+  for (int m = 0; m < VOICE_MEL_BANDS; m++) logMel[m] = mel[m] > 0 ? std::max(log(mel[m]), (double)VOICE_LOG_FLOOR) : VOICE_LOG_FLOOR;
+  mfcc.assign(VOICE_MFCC, 0.0);
+  for (int i = 0; i < VOICE_MFCC; i++) {
+    double scale = sqrt((i ? 2.0 : 1.0) / VOICE_MEL_BANDS);
+    for (int m = 0; m < VOICE_MEL_BANDS; m++) mfcc[i] += scale * cos(M_PI * i * (m + 0.5) / VOICE_MEL_BANDS) * logMel[m];
+  }
+  return true;
+}
+
+// --- Timing ---
+
+struct Timing {
+  double ns;
+  double cycles;   // Host TSC cycles; 0 without a TSC
+};
+
+static uint64_t cycleCount() {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Runs pass() until BENCH_MIN_SEC have gone by; time per frame for passes of `frames` frames
+template <typename Pass>
+static Timing timePerFrame(size_t frames, Pass pass) {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t startCycles = cycleCount();
+  double elapsed = 0;
+  uint32_t passes = 0;
+  do {
+    pass();
+    passes++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < BENCH_MIN_SEC);
+  double count = (double)passes * frames;
+  return {elapsed * 1e9 / count, (cycleCount() - startCycles) / count};
+}
+
+static void report(const char* name, Timing t) {
+  // Budget: one frame every 10 ms
+  double share = t.ns / (1e9 * VOICE_HOP_SAMPLES / SOUND_SAMPLE_RATE) * 100;
+  if (t.cycles > 0) {
+    printf("  %-14s %10.0f ns/frame %10.0f cycles/frame  %7.3f %% of a core\n", name, t.ns, t.cycles, share);
+  } else {
+    printf("  %-14s %10.0f ns/frame  %7.3f %% of a core\n", name, t.ns, share);
+  }
+}
+
+int simVoiceBench(const char* path) {
+  SimWav wav;
+  std::string error;
+  if (!simLoadWav(path, wav, error)) {
+    fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return 1;
+  }
+  const std::vector<int32_t>& in = wav.samples;
+  size_t hops = in.size() / VOICE_HOP_SAMPLES;
+  if (hops < 3 * VOICE_FRAME_SAMPLES / VOICE_HOP_SAMPLES) {
+    fprintf(stderr, "%s: too short for a frame\n", path);
+    return 1;
+  }
+  size_t n = hops * VOICE_HOP_SAMPLES;
+  printf("%s: %u Hz, %u-bit, %u channel(s), %.1f s\n", path, (unsigned)wav.rate, (unsigned)wav.bits,
+         (unsigned)wav.channels, (double)n / wav.rate);
+  if (wav.rate != SOUND_SAMPLE_RATE) {
+    printf("  note: the front end expects %u Hz; the bands of this file are off\n", (unsigned)SOUND_SAMPLE_RATE);
+  }
+
+  // Golden check, a hop at a time so every frame's log-mel energies can be compared too
+  voiceFrontendBegin(g_voice);
+  Reference ref;
+  referenceBegin(ref);
+  std::vector<double> refLogMel, refMfcc;
+  double maxErr[VOICE_MFCC] = {}, sumSq[VOICE_MFCC] = {}, maxLogMelErr = 0;
+  uint32_t frames = 0, agree = 0, refSpeech = 0;
+  for (size_t h = 0; h < hops; h++) {
+    const int32_t* hop = in.data() + h * VOICE_HOP_SAMPLES;
+    bool speech;
+    bool refFrame = referenceHop(ref, hop, refLogMel, refMfcc, speech);
+    uint16_t produced = voiceFrontendProcess(g_voice, hop, VOICE_HOP_SAMPLES);
+    if (produced != (refFrame ? 1 : 0)) {
+      printf("FAIL: hop %u: %u frame(s), the reference %u\n", (unsigned)h, (unsigned)produced, refFrame ? 1u : 0u);
+      return 1;
+    }
+    if (!produced) continue;
+    VoiceFeatureFrame f;
+    uint32_t newest;
+    voiceFrontendFeatures(g_voice, &f, 1, newest);
+    for (uint8_t i = 0; i < VOICE_MFCC; i++) {
+      double e = fabs(f.mfcc[i] / (double)(1 << VOICE_MFCC_FRAC_BITS) - refMfcc[i]);
+      maxErr[i] = std::max(maxErr[i], e);
+      sumSq[i] += e * e;
+    }
+    for (uint8_t m = 0; m < VOICE_MEL_BANDS; m++) {
+      if (refLogMel[m] < VOICE_LOG_FLOOR + 5) continue;
+      maxLogMelErr = std::max(maxLogMelErr, fabs(g_voice.logMel[m] / 65536.0 - refLogMel[m]));
+    }
+    frames++;
+    if (f.speech == speech) agree++;
+    if (speech) refSpeech++;
+  }
+  VoiceStats stats = voiceFrontendStats(g_voice);
+
+  // Kernels, each on the previous stage's output for a frame in the middle of the file
+  voiceFrontendBegin(g_voice);
+  voiceFrontendProcess(g_voice, in.data(), n / 2);
+  size_t reps = 1000;
+  int16_t mfcc[VOICE_MFCC];
+  int8_t scale = voiceWindow(g_voice);
+  int32_t fftIn[VOICE_FFT_SIZE];
+  std::copy(g_voice.fft, g_voice.fft + VOICE_FFT_SIZE, fftIn);
+  voiceFft(g_voice);
+  int32_t fftOut[VOICE_FFT_SIZE];
+  std::copy(g_voice.fft, g_voice.fft + VOICE_FFT_SIZE, fftOut);
+  Timing copy = timePerFrame(reps, [&]() {
+    for (size_t i = 0; i < reps; i++) std::copy(fftIn, fftIn + VOICE_FFT_SIZE, g_voice.fft);
+  });
+  printf("kernels (host, %u-sample frames every %u samples):\n", (unsigned)VOICE_FRAME_SAMPLES, (unsigned)VOICE_HOP_SAMPLES);
+  report("window", timePerFrame(reps, [&]() {
+    for (size_t i = 0; i < reps; i++) scale = voiceWindow(g_voice);
+  }));
+  Timing t = timePerFrame(reps, [&]() {
+    for (size_t i = 0; i < reps; i++) {
+      std::copy(fftIn, fftIn + VOICE_FFT_SIZE, g_voice.fft);
+      voiceFft(g_voice);
+    }
+  });
+  report("fft", {t.ns - copy.ns, t.cycles - copy.cycles});
+  std::copy(fftOut, fftOut + VOICE_FFT_SIZE, g_voice.fft);
+  report("mel", timePerFrame(reps, [&]() {
+    for (size_t i = 0; i < reps; i++) voiceMelEnergies(g_voice);
+  }));
+  report("log+dct", timePerFrame(reps, [&]() {
+    for (size_t i = 0; i < reps; i++) voiceCepstrum(g_voice, scale, mfcc);
+  }));
+  report("front end", timePerFrame(hops, [&]() {
+    voiceFrontendBegin(g_voice);
+    voiceFrontendProcess(g_voice, in.data(), n);
+  }));
+
+  printf("golden check against the double-precision reference, %u frames:\n", (unsigned)frames);
+  double worst = 0, rms = 0;
+  printf("  coefficient     ");
+  for (uint8_t i = 0; i < VOICE_MFCC; i++) printf(" %6u", (unsigned)i);
+  printf("\n  max error       ");
+  for (uint8_t i = 0; i < VOICE_MFCC; i++) {
+    printf(" %6.4f", maxErr[i]);
+    worst = std::max(worst, maxErr[i]);
+    rms = std::max(rms, sqrt(sumSq[i] / frames));
+  }
+  printf("\n  worst %.4f (tolerance %.2f), worst RMS %.4f (%.2f); log-mel worst %.4f (%.2f)\n", worst, MFCC_TOLERANCE, rms,
+         MFCC_RMS_TOLERANCE, maxLogMelErr, LOG_MEL_TOLERANCE);
+  printf("  VAD: %u of %u frames speech (reference %u), %u utterance(s), decisions agree on %.2f %%\n",
+         (unsigned)stats.speechFrames, (unsigned)frames, (unsigned)refSpeech, (unsigned)stats.utterances,
+         100.0 * agree / frames);
+  bool pass = worst <= MFCC_TOLERANCE && rms <= MFCC_RMS_TOLERANCE && maxLogMelErr <= LOG_MEL_TOLERANCE &&
+              agree >= VAD_AGREEMENT_MIN * frames;
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include "sim_wav.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+
+const uint16_t FORMAT_PCM = 1;
+const uint16_t FORMAT_FLOAT = 3;
+const uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+static uint32_t le32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t le16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+bool simLoadWav(const char* path, SimWav& out, std::string& error) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    error = "can't open file";
+    return false;
+  }
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) || memcmp(file.data() + 8, "WAVE", 4)) {
+    error = "not a RIFF/WAVE file";
+    return false;
+  }
+
+  uint16_t format = 0, blockAlign = 0;
+  const uint8_t* data = nullptr;
+  size_t dataLen = 0;
+  for (size_t pos = 12; pos + 8 <= file.size();) {
+    const uint8_t* chunk = file.data() + pos;
+    size_t len = le32(chunk + 4);
+    size_t avail = file.size() - pos - 8;
+    if (len > avail) len = avail;   // Truncated file or streaming-style length
+    if (!memcmp(chunk, "fmt ", 4) && len >= 16) {
+      format = le16(chunk + 8);
+      out.channels = le16(chunk + 10);
+      out.rate = le32(chunk + 12);
+      blockAlign = le16(chunk + 20);
+      out.bits = le16(chunk + 22);
+      if (format == FORMAT_EXTENSIBLE && len >= 26) format = le16(chunk + 32);
+    } else if (!memcmp(chunk, "data", 4)) {
+      data = chunk + 8;
+      dataLen = len;
+    }
+    pos += 8 + len + (len & 1);
+  }
+  if (!format || !data) {
+    error = "no fmt or data chunk";
+    return false;
+  }
+  bool pcm = format == FORMAT_PCM && (out.bits == 16 || out.bits == 24 || out.bits == 32);
+  bool flt = format == FORMAT_FLOAT && out.bits == 32;
+  if ((!pcm && !flt) || !out.channels || blockAlign < out.channels * out.bits / 8) {
+    error = "unsupported format (PCM 16/24/32-bit or float32 only)";
+    return false;
+  }
+
+  size_t frames = dataLen / blockAlign;
+  out.samples.resize(frames);
+  for (size_t i = 0; i < frames; i++) {
+    const uint8_t* p = data + i * blockAlign;
+    int32_t v;
+    if (flt) {
+      float f;
+      memcpy(&f, p, 4);
+      double x = f * 8388608.0;
+      v = (int32_t)(x > 8388607 ? 8388607 : (x < -8388608 ? -8388608 : lround(x)));
+    } else if (out.bits == 16) {
+      v = (int16_t)le16(p) * 256;
+    } else if (out.bits == 24) {
+      v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+    } else {
+      v = (int32_t)le32(p) >> 8;
+    }
+    out.samples[i] = v;
+  }
+  return true;
+}
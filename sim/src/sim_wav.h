@@ -0,0 +1,17 @@
+// Minimal WAV reader for the simulated microphone and --sound-bench.
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+struct SimWav {
+  uint32_t rate;
+  uint16_t bits;
+  uint16_t channels;
+  std::vector<int32_t> samples;   // First channel, scaled to 24 bits (full scale = the microphone's)
+};
+
+// PCM 16/24/32-bit or 32-bit float, mono or multichannel. False with a reason in error.
+bool simLoadWav(const char* path, SimWav& out, std::string& error);
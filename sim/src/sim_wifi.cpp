@@ -0,0 +1,101 @@
+#include <WiFi.h>
+#include <AsyncUDP.h>
+#include <ESPmDNS.h>
+
+#include "sim.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+static bool g_wifiAvailable = true;
+
+void simWiFiSetAvailable(bool available) { g_wifiAvailable = available; }
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+  (void)passphrase;
+  ssid_ = ssid ? ssid : "";
+  status_ = (g_wifiAvailable && ssid_.length() > 0) ? WL_CONNECTED : WL_NO_SSID_AVAIL;
+  return status_;
+}
+
+int8_t WiFiClass::RSSI() {
+  if (status_ != WL_CONNECTED) return 0;
+  return (int8_t)(-52 - random(0, 8));
+}
+
+// A fixed neighbourhood of access points; a scan takes ~2 s of virtual time, as on the device.
+struct SimAp {
+  const char* ssid;
+  int32_t rssi;
+  wifi_auth_mode_t auth;
+  int32_t channel;
+};
+static const SimAp SIM_APS[] = {
+    {"HomeNetwork", -48, WIFI_AUTH_WPA2_PSK, 6},
+    {"HomeNetwork-5G-Ext", -63, WIFI_AUTH_WPA2_PSK, 11},
+    {"Neighbour", -77, WIFI_AUTH_WPA_WPA2_PSK, 1},
+    {"CoffeeShop Guest", -84, WIFI_AUTH_OPEN, 3},
+};
+static const int16_t SIM_AP_COUNT = sizeof(SIM_APS) / sizeof(SIM_APS[0]);
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden, bool passive, uint32_t max_ms_per_chan,
+                                uint8_t channel) {
+  (void)show_hidden; (void)passive; (void)max_ms_per_chan; (void)channel;
+  if (mode_ == WIFI_AP) mode_ = WIFI_AP_STA; // The core enables the station interface to scan
+  scanStartedAt_ = millis();
+  scanState_ = WIFI_SCAN_RUNNING;
+  if (!async) {
+    delay(2000);
+    scanState_ = SIM_AP_COUNT;
+  }
+  return scanState_;
+}
+
+int16_t WiFiClass::scanComplete() {
+  if (scanState_ == WIFI_SCAN_RUNNING && millis() - scanStartedAt_ >= 2000) scanState_ = SIM_AP_COUNT;
+  return scanState_;
+}
+
+void WiFiClass::scanDelete() { scanState_ = WIFI_SCAN_FAILED; }
+
+String WiFiClass::SSID(uint8_t i) { return i < SIM_AP_COUNT ? String(SIM_APS[i].ssid) : String(); }
+int32_t WiFiClass::RSSI(uint8_t i) { return i < SIM_AP_COUNT ? SIM_APS[i].rssi : 0; }
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) { return i < SIM_AP_COUNT ? SIM_APS[i].auth : WIFI_AUTH_OPEN; }
+int32_t WiFiClass::channel(uint8_t i) { return i < SIM_AP_COUNT ? SIM_APS[i].channel : 0; }
+
+// --- UDP ---
+static std::mutex g_udpMutex;
+static std::vector<AsyncUDP*> g_udpListeners;
+
+bool AsyncUDP::listen(uint16_t port) {
+  std::lock_guard<std::mutex> lock(g_udpMutex);
+  for (AsyncUDP* u : g_udpListeners) {
+    if (u != this && u->port_ == port) return false;
+  }
+  port_ = port;
+  if (std::find(g_udpListeners.begin(), g_udpListeners.end(), this) == g_udpListeners.end()) {
+    g_udpListeners.push_back(this);
+  }
+  return true;
+}
+
+void AsyncUDP::close() {
+  std::lock_guard<std::mutex> lock(g_udpMutex);
+  g_udpListeners.erase(std::remove(g_udpListeners.begin(), g_udpListeners.end(), this), g_udpListeners.end());
+  port_ = 0;
+}
+
+bool simUdpDeliver(uint16_t port, const uint8_t* data, size_t len, std::string& reply) {
+  std::lock_guard<std::mutex> lock(g_udpMutex);
+  for (AsyncUDP* u : g_udpListeners) {
+    if (u->simPort() != port) continue;
+    AsyncUDPPacket packet(data, len, &reply);
+    u->simHandle(packet);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <map>
+#include <mutex>
+
+#include "sim.h"
+
+TwoWire Wire(0);
+
+static std::map<uint8_t, SimI2CDevice> g_devices;
+static std::mutex g_devMutex;
+static bool g_stuck = false;
+static int g_sda = -1, g_scl = -1;
+static int g_clocksToRelease = 0;
+const int STUCK_RELEASE_CLOCKS = 3; // A wedged slave finishes its byte after a few clocks
+
+void simI2CRegister(uint8_t addr, const SimI2CDevice& dev) {
+  std::lock_guard<std::mutex> lock(g_devMutex);
+  g_devices[addr] = dev;
+}
+
+void simI2CSetStuck(bool sdaHeldLow) {
+  g_stuck = sdaHeldLow;
+  g_clocksToRelease = STUCK_RELEASE_CLOCKS;
+  if (g_sda >= 0) simSetPin((uint8_t)g_sda, sdaHeldLow ? LOW : HIGH);
+}
+
+// Rising SCL edges while SDA is held clock the wedged slave out of its byte.
+void simI2CPinWritten(uint8_t pin, uint8_t val) {
+  if ((int)pin == g_sda && val && g_stuck) simSetPin(pin, LOW); // Open drain: the slave still wins
+  if ((int)pin != g_scl || !val || !g_stuck) return;
+  if (--g_clocksToRelease <= 0) simI2CSetStuck(false);
+}
+bool simI2CIsStuck() { return g_stuck; }
+
+static bool lookup(uint8_t addr, SimI2CDevice* out) {
+  std::lock_guard<std::mutex> lock(g_devMutex);
+  auto it = g_devices.find(addr);
+  if (it == g_devices.end()) return false;
+  *out = it->second;
+  return true;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  if (sda >= 0) g_sda = sda;
+  if (scl >= 0) g_scl = scl;
+  if (g_sda >= 0) simSetPin((uint8_t)g_sda, g_stuck ? LOW : HIGH); // Pull-ups
+  if (g_scl >= 0) simSetPin((uint8_t)g_scl, HIGH);
+  if (frequency) clock_ = frequency;
+  begun_ = true;
+  return true;
+}
+
+bool TwoWire::end() {
+  begun_ = false;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock_ = frequency ? frequency : 100000;
+  return true;
+}
+
+void TwoWire::busTime(size_t bytes) {
+  // START + address byte + data bytes, 9 clocks each, + STOP.
+  uint64_t bits = (uint64_t)(bytes + 1) * 9 + 2;
+  simSleepMicros(bits * 1000000ULL / clock_);
+}
+
+void TwoWire::beginTransmission(uint16_t address) {
+  txAddress_ = address;
+  txLength_ = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (txLength_ >= sizeof(txBuffer_)) return 0;
+  txBuffer_[txLength_++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  if (!begun_ || g_stuck) return 4; // Other error (bus busy / SDA stuck)
+  busTime(txLength_);
+  SimI2CDevice dev;
+  if (!lookup((uint8_t)txAddress_, &dev)) return 2; // NACK on address
+  if (dev.write && !dev.write(txBuffer_, txLength_)) return 3; // NACK on data
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop) {
+  (void)sendStop;
+  rxLength_ = rxIndex_ = 0;
+  if (!begun_ || g_stuck) return 0;
+  if (size > sizeof(rxBuffer_)) size = sizeof(rxBuffer_);
+  busTime(size);
+  SimI2CDevice dev;
+  if (!lookup((uint8_t)address, &dev) || !dev.read) return 0;
+  if (!dev.read(rxBuffer_, size)) return 0;
+  rxLength_ = size;
+  return size;
+}
+
+int TwoWire::available() { return (int)(rxLength_ - rxIndex_); }
+int TwoWire::read() { return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_++] : -1; }
+int TwoWire::peek() { return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_] : -1; }
+
+void TwoWire::simTransfer(uint16_t address, size_t bytes) {
+  (void)address;
+  busTime(bytes);
+}
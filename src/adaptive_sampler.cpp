@@ -0,0 +1,105 @@
+#include "adaptive_sampler.h"
+
+#include <math.h>
+#include <string.h>
+
+// Per-channel sensitivity and state
+struct Channel {
+  float noise;        // Standard deviation of a steady signal
+  float ratePerMin;   // Drift that counts as "changing"
+  bool valid;         // Has had a reading since samplerBegin()
+  float last;         // Latest reading, and when it was taken
+  uint32_t lastMs;
+  float mssd;         // EWMA of the squared reading-to-reading difference (2x the variance of a steady signal)
+};
+
+const float TEMP_NOISE = 0.05f, TEMP_RATE = 0.2f;      // degC, degC/min (AHT20)
+const float HUM_NOISE = 0.3f, HUM_RATE = 1.0f;         // %RH, %RH/min (AHT20)
+const float PRESS_NOISE = 0.05f, PRESS_RATE = 0.15f;   // hPa, hPa/min (BMP280, x16 oversampling)
+const float EWMA_ALPHA = 0.3f;
+const float NOISE_MARGIN = 4.0f;    // Changes and spread within 4 sigma of the noise are not activity
+const float CALM_ACTIVITY = 0.5f;   // Back off only below this; hold the interval in between
+const float BACKOFF_FACTOR = 1.5f;
+
+static Channel channels[3] = {
+  { TEMP_NOISE, TEMP_RATE, false, 0, 0, 0 },
+  { HUM_NOISE, HUM_RATE, false, 0, 0, 0 },
+  { PRESS_NOISE, PRESS_RATE, false, 0, 0, 0 },
+};
+static uint32_t minMs = 1000, maxMs = 60000;
+static bool haveSample = false;
+static uint32_t firstSampleMs = 0;
+static SamplerStats stats;
+
+// Change score of one channel for a reading taken at nowMs, against its previous
+// reading however long ago that was.
+static float channelActivity(Channel& c, float value, uint32_t nowMs) {
+  uint32_t dtMs = nowMs - c.lastMs;
+  c.lastMs = nowMs;
+  if (!c.valid) {
+    c.valid = true;
+    c.last = value;
+    c.mssd = 2 * c.noise * c.noise;
+    return 0;
+  }
+  float delta = value - c.last;
+  float allowed = NOISE_MARGIN * c.noise + c.ratePerMin * dtMs / 60000.0f;
+  c.mssd += EWMA_ALPHA * (delta * delta - c.mssd);
+  c.last = value;
+
+  float trend = fabsf(delta) / allowed;
+  float spread = sqrtf(c.mssd / 2) / (NOISE_MARGIN * c.noise);
+  return trend > spread ? trend : spread;
+}
+
+void samplerBegin(uint32_t minIntervalMs, uint32_t maxIntervalMs) {
+  minMs = minIntervalMs > 0 ? minIntervalMs : 1;
+  maxMs = maxIntervalMs > minMs ? maxIntervalMs : minMs;
+  for (Channel& c : channels) c.valid = false;
+  haveSample = false;
+  memset(&stats, 0, sizeof(stats));
+  stats.intervalMs = minMs; // Start fast until there is a baseline
+}
+
+uint32_t samplerUpdate(float tempC, float humidity, float pressureHpa, uint32_t nowMs) {
+  if (!haveSample) firstSampleMs = nowMs;
+  haveSample = true;
+
+  // A channel without a usable reading says nothing about change: it is skipped and
+  // keeps its last good reading to compare the next one with
+  const float values[3] = { tempC, humidity, pressureHpa };
+  float activity = 0;
+  bool read = false;
+  for (uint8_t i = 0; i < 3; i++) {
+    if (isnan(values[i])) continue;
+    read = true;
+    float a = channelActivity(channels[i], values[i], nowMs);
+    if (a > activity) activity = a;
+  }
+
+  uint32_t interval = stats.intervalMs;
+  if (!read) {
+    // Nothing to judge by: hold the interval
+  } else if (activity >= 1.0f) {
+    interval = minMs;
+  } else if (activity < CALM_ACTIVITY) {
+    float next = interval * BACKOFF_FACTOR;
+    interval = next >= maxMs ? maxMs : (uint32_t)next;
+  }
+
+  stats.intervalMs = interval;
+  stats.activity = activity;
+  stats.samples++;
+  if (interval == minMs) stats.fastSamples++;
+  uint32_t atMin = (nowMs - firstSampleMs) / minMs + 1;
+  stats.skippedReads = atMin > stats.samples ? atMin - stats.samples : 0;
+  return interval;
+}
+
+uint32_t samplerInterval() {
+  return stats.intervalMs;
+}
+
+const SamplerStats& samplerGetStats() {
+  return stats;
+}
@@ -0,0 +1,166 @@
+#include "anomaly_detector.h"
+
+#include <math.h>
+#include <string.h>
+
+struct ChannelLimits {
+  float min, max;       // Measuring range
+  float stepMax;        // Largest believable change between two readings...
+  float stepPerSec;     // ...plus this much per second between them
+  float noise;          // Typical reading noise; floor of the residual deviation
+  float flatBand;       // Readings this close count as unchanged for the flat-line check
+};
+
+static const ChannelLimits LIMITS[ANOMALY_CHANNELS] = {
+  {-40, 85, 10, 0.1f, 0.05f, 0.002f},       // AHT20 temperature, degC
+  {0, 100, 25, 0.5f, 0.2f, 0.005f},          // AHT20 humidity, %RH
+  {300, 1100, 3, 0.01f, 0.03f, 0.0005f},    // BMP280 pressure, hPa
+};
+
+// Holt smoothing of level and trend, and the weight of each residual in its variance
+const float HOLT_ALPHA = 0.3f;
+const float HOLT_BETA = 0.05f;
+const float RESIDUAL_GAMMA = 0.05f;
+
+static const char* const CHANNEL_NAMES[ANOMALY_CHANNELS] = {"temp", "humidity", "pressure"};
+static const char* const CONDITION_NAMES[SENSOR_CONDITIONS] = {
+  "ok", "spike", "step", "out_of_range", "stuck", "flat", "read_failed"
+};
+
+// Faults that last until the sensor recovers, as opposed to single bad readings
+static bool lasting(SensorCondition c) {
+  return c >= SENSOR_OUT_OF_RANGE;
+}
+
+// Judges an in-range reading against the channel's history and updates it
+static SensorCondition judge(AnomalyChannelState& ch, const ChannelLimits& lim, uint32_t nowMs, float x) {
+  if (!ch.seen || fabsf(x - ch.flatAnchor) > lim.flatBand) {
+    ch.flatAnchor = x;
+    ch.flatSinceMs = nowMs;
+  }
+  ch.stuckRun = ch.seen && x == ch.previous ? (ch.stuckRun < 255 ? ch.stuckRun + 1 : 255) : 0;
+  ch.previous = x;
+  ch.seen = true;
+
+  if (ch.accepted) {
+    float dt = (nowMs - ch.lastMs) / 1000.0f;
+    float forecast = ch.level + ch.trend * dt;
+    float residual = x - forecast;
+    SensorCondition bad = SENSOR_OK;
+    if (fabsf(x - ch.last) > lim.stepMax + lim.stepPerSec * dt) {
+      bad = SENSOR_STEP;
+    } else if (ch.accepted >= ANOMALY_WARMUP &&
+               fabsf(residual) > ANOMALY_Z_LIMIT * sqrtf(ch.residualVar + lim.noise * lim.noise)) {
+      bad = SENSOR_SPIKE;
+    }
+
+    if (bad == SENSOR_STEP) {
+      ch.rejectedRun = 0;
+      return bad;
+    }
+    if (bad == SENSOR_SPIKE) {
+      // Spikes that sit closer to each other than to the forecast are a real change (a
+      // window opened, the heating came on): after a few, start over from there. Steps
+      // never do, however many agree: the sensor is reporting something impossible.
+      bool agrees = ch.rejectedRun && fabsf(x - ch.rejected) < fabsf(residual) / 2;
+      ch.rejectedRun = agrees ? ch.rejectedRun + 1 : 1;
+      ch.rejected = x;
+      if (ch.rejectedRun < ANOMALY_SHIFT_READINGS) return bad;
+      ch.accepted = 0;
+    } else {
+      float level = forecast + HOLT_ALPHA * residual;
+      if (dt > 0) ch.trend += HOLT_BETA * ((level - ch.level) / dt - ch.trend);
+      ch.level = level;
+      ch.residualVar += RESIDUAL_GAMMA * (residual * residual - ch.residualVar);
+    }
+  }
+  if (!ch.accepted) {
+    ch.level = x;
+    ch.trend = 0;
+    ch.residualVar = 0;
+  }
+  ch.rejectedRun = 0;
+  ch.last = x;
+  ch.lastMs = nowMs;
+  ch.accepted++;
+
+  // The reading fits, but the sensor may still have stopped responding
+  if (ch.stuckRun + 1 >= ANOMALY_STUCK_READINGS) return SENSOR_STUCK;
+  if (nowMs - ch.flatSinceMs >= ANOMALY_FLAT_SEC * 1000) return SENSOR_FLAT;
+  return SENSOR_OK;
+}
+
+void anomalyBegin(AnomalyDetector& d) {
+  memset(&d, 0, sizeof(d));
+  d.lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+SensorCondition anomalyCheck(AnomalyDetector& d, AnomalyChannel c, uint32_t nowMs, bool readOk, float value) {
+  AnomalyChannelState& ch = d.channels[c];
+  const ChannelLimits& lim = LIMITS[c];
+  SensorCondition cond;
+  if (!readOk || isnan(value)) cond = SENSOR_READ_FAILED;
+  else if (value < lim.min || value > lim.max) cond = SENSOR_OUT_OF_RANGE;
+  else cond = judge(ch, lim, nowMs, value);
+
+  // An event whenever the condition turns bad (not for each reading of a run), and when
+  // a good reading ends a lasting fault, even if a few spikes came in between
+  bool event = cond != SENSOR_OK ? cond != ch.condition : ch.faulted;
+  ch.faulted = lasting(cond) || (ch.faulted && cond != SENSOR_OK);
+  portENTER_CRITICAL(&d.lock);
+  ch.condition = cond;
+  if (event) {
+    AnomalyEvent& e = d.events[d.eventEnd % ANOMALY_EVENTS];
+    e.atMs = nowMs;
+    e.value = value;
+    e.channel = c;
+    e.type = cond;
+    d.eventEnd++;
+    ch.counts[cond]++;
+  }
+  portEXIT_CRITICAL(&d.lock);
+  return cond;
+}
+
+SensorCondition anomalyCondition(AnomalyDetector& d, AnomalyChannel c) {
+  portENTER_CRITICAL(&d.lock);
+  SensorCondition cond = d.channels[c].condition;
+  portEXIT_CRITICAL(&d.lock);
+  return cond;
+}
+
+uint32_t anomalyEventCount(AnomalyDetector& d, AnomalyChannel c, SensorCondition t) {
+  portENTER_CRITICAL(&d.lock);
+  uint32_t n = d.channels[c].counts[t];
+  portEXIT_CRITICAL(&d.lock);
+  return n;
+}
+
+uint32_t anomalyEventFirst(AnomalyDetector& d) {
+  uint32_t end = anomalyEventEnd(d);
+  return end > ANOMALY_EVENTS ? end - ANOMALY_EVENTS : 0;
+}
+
+uint32_t anomalyEventEnd(AnomalyDetector& d) {
+  portENTER_CRITICAL(&d.lock);
+  uint32_t end = d.eventEnd;
+  portEXIT_CRITICAL(&d.lock);
+  return end;
+}
+
+bool anomalyEventGet(AnomalyDetector& d, uint32_t i, AnomalyEvent& out) {
+  bool ok;
+  portENTER_CRITICAL(&d.lock);
+  ok = i < d.eventEnd && d.eventEnd - i <= ANOMALY_EVENTS;
+  if (ok) out = d.events[i % ANOMALY_EVENTS];
+  portEXIT_CRITICAL(&d.lock);
+  return ok;
+}
+
+const char* anomalyChannelName(AnomalyChannel c) {
+  return CHANNEL_NAMES[c];
+}
+
+const char* sensorConditionName(SensorCondition c) {
+  return CONDITION_NAMES[c];
+}
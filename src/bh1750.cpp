@@ -0,0 +1,120 @@
+#include "bh1750.h"
+
+#include <math.h>
+#include <string.h>
+
+// Opcodes (datasheet: "Instruction Set Architecture")
+const uint8_t OP_POWER_ON = 0x01;
+const uint8_t OP_ONE_TIME_H = 0x20;     // One-time H-resolution mode, then power down
+const uint8_t OP_ONE_TIME_H2 = 0x21;    // One-time H-resolution mode 2
+const uint8_t OP_MTREG_HIGH = 0x40;     // | MTreg bits 7..5
+const uint8_t OP_MTREG_LOW = 0x60;      // | MTreg bits 4..0
+
+const uint8_t MTREG_DEFAULT = 69;
+const uint16_t MEASURE_MAX_MS = 180;    // H-resolution modes at MTreg 69, worst case
+const uint16_t RANGE_UP_COUNT = 58982;   // 90 % of full scale: move coarser
+const uint16_t RANGE_DOWN_COUNT = 26214; // Would read under 40 % of the finer range's full scale: move finer
+
+struct RangeMode {
+  uint8_t opcode;
+  uint8_t mtreg;
+};
+
+static const RangeMode RANGES[BH1750_RANGES] = {
+  {OP_ONE_TIME_H2, 254},
+  {OP_ONE_TIME_H2, MTREG_DEFAULT},
+  {OP_ONE_TIME_H, MTREG_DEFAULT},
+  {OP_ONE_TIME_H, 31},
+};
+
+static const char* const RANGE_NAMES[BH1750_RANGES] = {"dark", "dim", "normal", "bright"};
+
+// Counts per lux: 1.2 at the default MTreg in H-resolution mode, proportional to MTreg,
+// doubled in mode 2
+static float countsPerLux(Bh1750Range r) {
+  float c = 1.2f * RANGES[r].mtreg / MTREG_DEFAULT;
+  return RANGES[r].opcode == OP_ONE_TIME_H2 ? 2 * c : c;
+}
+
+static bool command(Bh1750& s, uint8_t op) {
+  s.wire->beginTransmission(s.address);
+  s.wire->write(op);
+  return s.wire->endTransmission() == 0;
+}
+
+static bool start(Bh1750& s, uint32_t nowMs) {
+  const RangeMode& m = RANGES[s.range];
+  if (s.mtreg != m.mtreg) {
+    if (!command(s, OP_MTREG_HIGH | (m.mtreg >> 5)) || !command(s, OP_MTREG_LOW | (m.mtreg & 0x1F))) {
+      s.mtreg = 0;
+      return false;
+    }
+    s.mtreg = m.mtreg;
+  }
+  if (!command(s, m.opcode)) return false;
+  s.measuring = true;
+  s.dueMs = nowMs + (MEASURE_MAX_MS * m.mtreg + MTREG_DEFAULT - 1) / MTREG_DEFAULT;
+  return true;
+}
+
+bool bh1750Begin(Bh1750& s, TwoWire& wire, uint32_t nowMs, uint8_t address) {
+  memset(&s, 0, sizeof(s));
+  s.wire = &wire;
+  s.address = address;
+  s.range = BH1750_RANGE_NORMAL;
+  s.lux = NAN;
+  s.dueMs = nowMs;
+  return command(s, OP_POWER_ON);
+}
+
+bool bh1750Due(const Bh1750& s, uint32_t nowMs) {
+  return (int32_t)(nowMs - s.dueMs) >= 0;
+}
+
+uint32_t bh1750Deadline(const Bh1750& s) {
+  return s.dueMs;
+}
+
+Bh1750Status bh1750Poll(Bh1750& s, uint32_t nowMs) {
+  if (!bh1750Due(s, nowMs)) return BH1750_IDLE;
+  if (!s.measuring) {
+    if (start(s, nowMs)) return BH1750_STARTED;
+    s.failures++;
+    s.dueMs = nowMs + BH1750_INTERVAL_MS;
+    return BH1750_FAILED;
+  }
+
+  s.measuring = false;
+  s.dueMs = nowMs + BH1750_INTERVAL_MS;
+  if (s.wire->requestFrom(s.address, (uint8_t)2) != 2) {
+    s.failures++;
+    return BH1750_FAILED;
+  }
+  uint16_t raw = s.wire->read() << 8;
+  raw |= s.wire->read();
+
+  Bh1750Range measured = s.range;
+  if (raw >= RANGE_UP_COUNT && s.range + 1 < BH1750_RANGES) {
+    s.range = (Bh1750Range)(s.range + 1);
+    s.rangeChanges++;
+    if (raw == 0xFFFF) {   // Clipped: the value is only a lower bound
+      s.dueMs = nowMs;
+      return BH1750_RANGING;
+    }
+  } else if (s.range > 0 && raw / countsPerLux(s.range) * countsPerLux((Bh1750Range)(s.range - 1)) < RANGE_DOWN_COUNT) {
+    s.range = (Bh1750Range)(s.range - 1);
+    s.rangeChanges++;
+  }
+  s.raw = raw;
+  s.lux = raw / countsPerLux(measured);
+  s.readings++;
+  return BH1750_READING;
+}
+
+float bh1750Lux(const Bh1750& s) {
+  return s.lux;
+}
+
+const char* bh1750RangeName(Bh1750Range r) {
+  return RANGE_NAMES[r];
+}
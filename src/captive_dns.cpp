@@ -0,0 +1,80 @@
+#include "captive_dns.h"
+
+#include <AsyncUDP.h>
+#include <string.h>
+
+const size_t HEADER_BYTES = 12;
+const size_t ANSWER_BYTES = 16;       // Name pointer, type, class, TTL, length, address
+const size_t NAME_MAX = 255;
+const uint16_t TYPE_A = 1;
+const uint16_t CLASS_IN = 1;
+
+static AsyncUDP udp;
+static uint8_t address[4];
+static volatile uint32_t answered = 0;
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v & 0xFF;
+}
+
+size_t captiveDnsReply(const uint8_t* query, size_t len, const uint8_t ip[4], uint8_t* out, size_t size) {
+  if (len < HEADER_BYTES) return 0;
+  bool isResponse = query[2] & 0x80;
+  uint8_t opcode = (query[2] >> 3) & 0x0F;
+  if (isResponse || opcode != 0 || get16(query + 4) != 1) return 0;
+
+  // The question's name: plain labels (a query has nothing to compress against)
+  size_t pos = HEADER_BYTES;
+  while (pos < len && query[pos] != 0) {
+    uint8_t label = query[pos];
+    if (label > 63 || pos + 1 + label >= len) return 0;
+    pos += 1 + label;
+    if (pos - HEADER_BYTES > NAME_MAX) return 0;
+  }
+  size_t questionEnd = pos + 1 + 4;   // Terminating zero, type, class
+  if (questionEnd > len || questionEnd + ANSWER_BYTES > size) return 0;
+  bool answerA = get16(query + pos + 1) == TYPE_A && get16(query + pos + 3) == CLASS_IN;
+
+  // Header and question as asked; any additional records (EDNS) are left out
+  memcpy(out, query, questionEnd);
+  out[2] = 0x84 | (query[2] & 0x01);   // Response, authoritative, recursion desired as asked
+  out[3] = 0x80;                       // Recursion available, NOERROR
+  put16(out + 6, answerA ? 1 : 0);
+  put16(out + 8, 0);
+  put16(out + 10, 0);
+  if (!answerA) return questionEnd;
+
+  uint8_t* a = out + questionEnd;
+  put16(a, 0xC000 | HEADER_BYTES);     // The name in the question
+  put16(a + 2, TYPE_A);
+  put16(a + 4, CLASS_IN);
+  put16(a + 6, CAPTIVE_DNS_TTL_S >> 16);
+  put16(a + 8, CAPTIVE_DNS_TTL_S & 0xFFFF);
+  put16(a + 10, 4);
+  memcpy(a + 12, ip, 4);
+  return questionEnd + ANSWER_BYTES;
+}
+
+bool captiveDnsBegin(const uint8_t ip[4]) {
+  memcpy(address, ip, 4);
+  if (!udp.listen(53)) return false;
+  // Runs on the UDP task: the answer goes out before the loop would even have looked
+  udp.onPacket([](AsyncUDPPacket& packet) {
+    uint8_t reply[CAPTIVE_DNS_MAX_PACKET];
+    size_t n = captiveDnsReply(packet.data(), packet.length(), address, reply, sizeof(reply));
+    if (n) {
+      packet.write(reply, n);
+      answered = answered + 1;
+    }
+  });
+  return true;
+}
+
+uint32_t captiveDnsAnswered() {
+  return answered;
+}
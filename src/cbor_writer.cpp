@@ -0,0 +1,114 @@
+#include "cbor_writer.h"
+
+#include <string.h>
+
+enum {
+  MAJOR_UINT = 0,
+  MAJOR_NEGINT = 1,
+  MAJOR_BYTES = 2,
+  MAJOR_TEXT = 3,
+  MAJOR_ARRAY = 4,
+  MAJOR_MAP = 5,
+  MAJOR_TAG = 6,
+  MAJOR_SIMPLE = 7
+};
+
+// Major type and argument in the shortest form
+static void head(Print& out, uint8_t major, uint64_t v) {
+  uint8_t buf[9];
+  uint8_t n;
+  major <<= 5;
+  if (v < 24) {
+    buf[0] = major | v;
+    n = 1;
+  } else if (v <= 0xFF) {
+    buf[0] = major | 24;
+    n = 2;
+  } else if (v <= 0xFFFF) {
+    buf[0] = major | 25;
+    n = 3;
+  } else if (v <= 0xFFFFFFFFULL) {
+    buf[0] = major | 26;
+    n = 5;
+  } else {
+    buf[0] = major | 27;
+    n = 9;
+  }
+  for (uint8_t i = n - 1; i > 0; i--) {   // Big-endian argument
+    buf[i] = v & 0xFF;
+    v >>= 8;
+  }
+  out.write(buf, n);
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+void cborMap(Print& out, uint32_t pairs) {
+  head(out, MAJOR_MAP, pairs);
+}
+
+void cborArray(Print& out, uint32_t items) {
+  head(out, MAJOR_ARRAY, items);
+}
+
+void cborTag(Print& out, uint32_t tag) {
+  head(out, MAJOR_TAG, tag);
+}
+
+void cborUint(Print& out, uint64_t v) {
+  head(out, MAJOR_UINT, v);
+}
+
+void cborInt(Print& out, int64_t v) {
+  if (v >= 0) head(out, MAJOR_UINT, v);
+  else head(out, MAJOR_NEGINT, (uint64_t)(-1 - v));
+}
+
+void cborFloat(Print& out, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, 4);
+  uint8_t buf[5] = {(MAJOR_SIMPLE << 5) | 26, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8),
+                    (uint8_t)bits};
+  out.write(buf, 5);
+}
+
+void cborText(Print& out, const char* s) {
+  size_t len = strlen(s);
+  head(out, MAJOR_TEXT, len);
+  out.write((const uint8_t*)s, len);
+}
+
+void cborBool(Print& out, bool v) {
+  out.write((uint8_t)((MAJOR_SIMPLE << 5) | (v ? 21 : 20)));
+}
+
+void cborNull(Print& out) {
+  out.write((uint8_t)((MAJOR_SIMPLE << 5) | 22));
+}
+
+void cborUint32Array(Print& out, const uint32_t* v, uint32_t count) {
+  cborTag(out, CBOR_TAG_UINT32_LE);
+  head(out, MAJOR_BYTES, count * 4);
+  uint8_t le[4];
+  for (uint32_t i = 0; i < count; i++) {
+    putLe32(le, v[i]);
+    out.write(le, 4);
+  }
+}
+
+void cborFloat32Array(Print& out, const float* v, uint32_t count) {
+  cborTag(out, CBOR_TAG_FLOAT32_LE);
+  head(out, MAJOR_BYTES, count * 4);
+  uint8_t le[4];
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t bits;
+    memcpy(&bits, &v[i], 4);
+    putLe32(le, bits);
+    out.write(le, 4);
+  }
+}
@@ -0,0 +1,57 @@
+#include "command_queue.h"
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+
+static Command ring[COMMAND_QUEUE_DEPTH];
+static uint8_t head = 0;    // Next command to take
+static uint8_t count = 0;
+static uint32_t waitMsTotal = 0;
+static CommandQueueStats stats = {};
+static portMUX_TYPE queueMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool commandQueuePost(const Command& cmd) {
+  uint32_t now = millis();
+  bool ok;
+  portENTER_CRITICAL(&queueMux);
+  ok = count < COMMAND_QUEUE_DEPTH;
+  if (ok) {
+    Command& slot = ring[(head + count) % COMMAND_QUEUE_DEPTH];
+    slot = cmd;
+    slot.postedAt = now;
+    count++;
+    stats.posted++;
+    if (count > stats.depthMax) stats.depthMax = count;
+  } else {
+    stats.rejected++;
+  }
+  stats.depth = count;
+  portEXIT_CRITICAL(&queueMux);
+  return ok;
+}
+
+bool commandQueueTake(Command& out) {
+  bool ok;
+  portENTER_CRITICAL(&queueMux);
+  ok = count > 0;
+  if (ok) {
+    out = ring[head];
+    head = (head + 1) % COMMAND_QUEUE_DEPTH;
+    count--;
+  }
+  stats.depth = count;
+  portEXIT_CRITICAL(&queueMux);
+  if (!ok) return false;
+
+  uint32_t wait = millis() - out.postedAt;
+  stats.executed++;
+  stats.waitMsLast = wait;
+  if (wait > stats.waitMsMax) stats.waitMsMax = wait;
+  waitMsTotal += wait;
+  stats.waitMsAvg = (float)waitMsTotal / stats.executed;
+  return true;
+}
+
+const CommandQueueStats& commandQueueGetStats() {
+  return stats;
+}
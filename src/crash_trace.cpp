@@ -0,0 +1,176 @@
+#include "crash_trace.h"
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <stdio.h>
+#include <string.h>
+
+const uint32_t TRACE_MASK = TRACE_EVENTS - 1;
+const uint8_t REPORT_BATCH = 32;      // Events per crashReportNext() call
+const size_t EVENT_JSON_MAX = 96;
+
+// Kept through every reset but a power-on; holds garbage until crashTraceBegin()
+RTC_NOINIT_ATTR TraceRing crashTrace;
+
+static TraceSnapshot last;            // The previous run, copied out at boot
+static uint32_t heapLowWater = 0;
+
+static const char* const TYPE_NAMES[TRACE_TYPES] = {
+  "none", "boot", "loop", "stage", "handler", "i2c", "heap", "restart"
+};
+
+static const char* const STAGE_NAMES[TRACE_STAGES] = {
+  "ota", "commands", "portal", "light", "sensors", "store", "alerts", "gesture", "display", "idle"
+};
+
+static const char* const HANDLER_NAMES[TRACE_HANDLERS] = {
+  "/", "/data", "/history", "/stats", "/api/quantiles", "/api/sensor-events", "/metrics", "/export",
+  "/logs", "/debug/lastcrash", "/settings", "/save-settings", "/reboot", "/update", "/update (upload)",
+  "/find", "/config", "/saveconfig", "not found", "/networks"
+};
+
+static const char* const RESTART_NAMES[] = {"command", "ota"};
+
+// Indexed by esp_reset_reason_t
+static const char* const RESET_NAMES[] = {
+  "unknown", "poweron", "external", "software", "panic", "int_wdt", "task_wdt", "wdt",
+  "deepsleep", "brownout", "sdio", "usb", "jtag", "efuse", "power_glitch", "cpu_lockup"
+};
+
+void traceBegin(TraceRing& t, uint32_t boot) {
+  memset(t.events, 0, sizeof(t.events));
+  t.head = 0;
+  t.boot = boot;
+  t.magic = TRACE_MAGIC;
+}
+
+bool traceSnapshot(const TraceRing& t, int resetReason, TraceSnapshot& out) {
+  out.resetReason = resetReason;
+  out.valid = resetReason != ESP_RST_POWERON && t.magic == TRACE_MAGIC;
+  out.boot = out.valid ? t.boot : 0;
+  out.recorded = out.valid ? t.head : 0;
+  out.count = out.recorded < TRACE_EVENTS ? out.recorded : TRACE_EVENTS;
+  uint32_t first = out.recorded - out.count;
+  for (uint16_t i = 0; i < out.count; i++) out.events[i] = t.events[(first + i) & TRACE_MASK];
+  return out.valid;
+}
+
+const char* traceTypeName(TraceType type) {
+  return type < TRACE_TYPES ? TYPE_NAMES[type] : "?";
+}
+
+const char* traceStageName(TraceStage stage) {
+  return stage < TRACE_STAGES ? STAGE_NAMES[stage] : "?";
+}
+
+const char* traceHandlerName(TraceHandler handler) {
+  return handler < TRACE_HANDLERS ? HANDLER_NAMES[handler] : "?";
+}
+
+const char* resetReasonName(int reason) {
+  return reason >= 0 && reason < (int)(sizeof(RESET_NAMES) / sizeof(RESET_NAMES[0])) ? RESET_NAMES[reason] : "unknown";
+}
+
+size_t traceEventJson(const TraceEvent& e, char* out, size_t size) {
+  int n;
+  const char* type = traceTypeName(e.type);
+  switch (e.type) {
+    case TRACE_BOOT:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"reason\":\"%s\"}", type, resetReasonName(e.arg));
+      break;
+    case TRACE_LOOP:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"ms\":%lu}", type, (unsigned long)e.arg);
+      break;
+    case TRACE_STAGE:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"stage\":\"%s\"}", type, traceStageName((TraceStage)e.arg));
+      break;
+    case TRACE_HANDLER:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"path\":\"%s\"}", type, traceHandlerName((TraceHandler)e.arg));
+      break;
+    case TRACE_I2C:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"addr\":%u,\"ok\":%s,\"us\":%u}", type, (unsigned)(e.arg >> 17),
+                   (e.arg >> 16) & 1 ? "true" : "false", (unsigned)(e.arg & 0xFFFF));
+      break;
+    case TRACE_HEAP:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"min_free\":%lu}", type, (unsigned long)e.arg);
+      break;
+    case TRACE_RESTART:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"by\":\"%s\"}", type, e.arg < 2 ? RESTART_NAMES[e.arg] : "?");
+      break;
+    default:
+      n = snprintf(out, size, "{\"type\":\"%s\",\"code\":%u,\"arg\":%lu}", type, (unsigned)e.type,
+                   (unsigned long)e.arg);
+      break;
+  }
+  if (n < 0) return 0;
+  return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+void crashTraceBegin(int resetReason) {
+  traceSnapshot(crashTrace, resetReason, last);
+  traceBegin(crashTrace, last.valid ? last.boot + 1 : 1);
+  traceRecord(TRACE_BOOT, (uint32_t)resetReason);
+  heapLowWater = 0;
+}
+
+const TraceSnapshot& crashTraceLast() {
+  return last;
+}
+
+void crashTraceHeap() {
+  uint32_t low = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  if (heapLowWater && low >= heapLowWater) return;
+  heapLowWater = low;
+  traceRecord(TRACE_HEAP, low > TRACE_ARG_MASK ? TRACE_ARG_MASK : low);
+}
+
+// --- /debug/lastcrash ---
+
+// Layout of the stream state words
+enum {
+  ST_NEXT,    // Next event to send, or REPORT_HEADER before the header
+  ST_DONE
+};
+const uint32_t REPORT_HEADER = 0xFFFFFFFF;
+
+void crashReportBegin(uint32_t* state) {
+  state[ST_NEXT] = REPORT_HEADER;
+  state[ST_DONE] = 0;
+}
+
+bool crashReportNext(Print& out, uint32_t* state) {
+  if (state[ST_NEXT] == REPORT_HEADER) {
+    out.printf("{\"reset_reason\":\"%s\",\"boot\":%lu,\"trace\":%s", resetReasonName(last.resetReason),
+               (unsigned long)crashTrace.boot, last.valid ? "true" : "false");
+    if (last.valid) {
+      // The newest loop pass says how long the run lasted (its clock wraps every 4.6 h)
+      int32_t lastLoopMs = -1;
+      for (int i = last.count - 1; i >= 0 && lastLoopMs < 0; i--) {
+        TraceEvent e = traceDecode(last.events[i]);
+        if (e.type == TRACE_LOOP) lastLoopMs = (int32_t)e.arg;
+      }
+      out.printf(",\"previous\":{\"boot\":%lu,\"recorded\":%lu,\"kept\":%u", (unsigned long)last.boot,
+                 (unsigned long)last.recorded, (unsigned)last.count);
+      if (lastLoopMs >= 0) out.printf(",\"last_loop_ms\":%ld", (long)lastLoopMs);
+      out.print("}");
+    }
+    out.print(",\"events\":[");
+    state[ST_NEXT] = 0;
+  }
+
+  char json[EVENT_JSON_MAX];
+  for (uint8_t n = 0; n < REPORT_BATCH && state[ST_NEXT] < last.count; n++) {
+    uint32_t i = state[ST_NEXT]++;
+    if (i) out.print(",");
+    out.print("\n");
+    out.write((const uint8_t*)json, traceEventJson(traceDecode(last.events[i]), json, sizeof(json)));
+  }
+  if (state[ST_NEXT] < last.count) return true;
+  if (!state[ST_DONE]) {
+    state[ST_DONE] = 1;
+    out.print("]}\n");
+  }
+  return false;
+}
@@ -0,0 +1,143 @@
+#include "env_quantiles.h"
+
+#include <math.h>
+
+// Bucket width, bucket count and first slot of each tier
+static const uint32_t TIER_BUCKET_SEC[ENV_WINDOWS] = {15 * 60, 4 * 60 * 60, 24 * 60 * 60};
+static const uint8_t TIER_BUCKETS[ENV_WINDOWS] = {4, 6, 7};
+static const uint8_t TIER_FIRST_SLOT[ENV_WINDOWS] = {0, 4, 10};
+
+static uint8_t slotOf(uint8_t tier, uint32_t bucket) {
+  return TIER_FIRST_SLOT[tier] + bucket % TIER_BUCKETS[tier];
+}
+
+static void reset(EnvQuantiles& s, uint32_t nowS) {
+  portENTER_CRITICAL(&s.lock);
+  for (uint8_t t = 0; t < ENV_WINDOWS; t++) {
+    s.newest[t] = nowS / TIER_BUCKET_SEC[t];
+    for (uint8_t i = 0; i < TIER_BUCKETS[t]; i++) s.ids[TIER_FIRST_SLOT[t] + i] = s.newest[t];
+  }
+  for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+    for (uint8_t i = 0; i < EQ_SLOTS; i++) qsketchClear(s.sketches[c][i]);
+    s.pendingCount[c] = 0;
+  }
+  s.started = true;
+  portEXIT_CRITICAL(&s.lock);
+}
+
+// Moves the pending readings of channel c into the current 15 min sketch. The sketch is
+// rebuilt outside the lock (only this task writes) and swapped in under it.
+static void flush(EnvQuantiles& s, uint8_t c) {
+  uint8_t n = s.pendingCount[c];
+  if (!n) return;
+  uint8_t slot = slotOf(0, s.newest[0]);
+  QuantileSketch next = s.sketches[c][slot];
+  float values[EQ_PENDING];
+  for (uint8_t i = 0; i < n; i++) values[i] = s.pending[c][i];
+  qsketchAdd(next, values, n);
+  portENTER_CRITICAL(&s.lock);
+  s.sketches[c][slot] = next;
+  s.pendingCount[c] = 0;
+  portEXIT_CRITICAL(&s.lock);
+}
+
+// Moves tier t to the bucket holding nowS. The bucket it leaves is complete: it is merged
+// into the next tier, and in the same critical section the new bucket is opened, so a
+// query never counts it twice or not at all.
+static void advance(EnvQuantiles& s, uint8_t t, uint32_t nowS) {
+  uint32_t id = nowS / TIER_BUCKET_SEC[t];
+  if (id <= s.newest[t]) return;
+
+  // Static: too big for loop()'s stack at three sketches a level. The recursive call
+  // below is done with it before this level fills it, and only one task adds readings.
+  static QuantileSketch folded[EQ_CHANNELS];
+  uint8_t closed = slotOf(t, s.newest[t]);
+  uint8_t upper = 0;
+  if (t == 0) {
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) flush(s, c);
+  }
+  if (t + 1 < ENV_WINDOWS) {
+    advance(s, t + 1, s.newest[t] * TIER_BUCKET_SEC[t]);
+    upper = slotOf(t + 1, s.newest[t + 1]);
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+      folded[c] = s.sketches[c][upper];
+      qsketchMerge(folded[c], s.sketches[c][closed]);
+    }
+  }
+
+  uint32_t from = id - s.newest[t] > TIER_BUCKETS[t] ? id - TIER_BUCKETS[t] + 1 : s.newest[t] + 1;
+  portENTER_CRITICAL(&s.lock);
+  if (t + 1 < ENV_WINDOWS) {
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) s.sketches[c][upper] = folded[c];
+  }
+  for (uint32_t n = from; n <= id; n++) {
+    uint8_t slot = slotOf(t, n);
+    s.ids[slot] = n;
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) qsketchClear(s.sketches[c][slot]);
+  }
+  s.newest[t] = id;
+  portEXIT_CRITICAL(&s.lock);
+}
+
+void envQuantilesBegin(EnvQuantiles& s) {
+  s.lock = portMUX_INITIALIZER_UNLOCKED;
+  s.started = false;
+}
+
+void envQuantilesAdd(EnvQuantiles& s, uint32_t nowS, float tempC, float humidity, float pressureHpa) {
+  if (!s.started || nowS / TIER_BUCKET_SEC[0] < s.newest[0]) reset(s, nowS);   // Also after a millis() wrap
+  else advance(s, 0, nowS);
+
+  float values[EQ_CHANNELS] = {tempC, humidity, pressureHpa};
+  for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+    if (isnan(values[c])) continue;
+    portENTER_CRITICAL(&s.lock);
+    s.pending[c][s.pendingCount[c]++] = values[c];
+    portEXIT_CRITICAL(&s.lock);
+    if (s.pendingCount[c] == EQ_PENDING) flush(s, c);
+  }
+}
+
+bool envQuantilesSketch(EnvQuantiles& s, EnvWindow w, EnvChannel c, uint32_t nowS, QuantileSketch& out) {
+  qsketchClear(out);
+  if (c >= EQ_CHANNELS) return false;
+  if (!s.started) return true;
+
+  uint32_t nowId = nowS / TIER_BUCKET_SEC[w];
+  uint32_t firstBucket = nowId >= TIER_BUCKETS[w] ? nowId - TIER_BUCKETS[w] + 1 : 0;
+  uint32_t windowStart = firstBucket * TIER_BUCKET_SEC[w];
+
+  // Copied one sketch at a time and gathered outside the lock, so loop() is never held
+  // up by a query. Each rollover is atomic (see advance()), so no bucket is counted
+  // twice. The gather is static (about 6 KB) as only the web server's task queries.
+  static QuantileGather gather;
+  qgatherClear(gather);
+  QuantileSketch part;
+  for (uint8_t t = 0; t <= w; t++) {
+    for (uint8_t i = 0; i < TIER_BUCKETS[t]; i++) {
+      uint8_t slot = TIER_FIRST_SLOT[t] + i;
+      bool take;
+      portENTER_CRITICAL(&s.lock);
+      // The window's own tier: every bucket inside it. Lower tiers: only the open
+      // bucket, whose readings have not been rolled up yet.
+      if (t == w) take = s.ids[slot] >= firstBucket && s.ids[slot] <= nowId;
+      else take = s.ids[slot] == s.newest[t] && s.newest[t] * TIER_BUCKET_SEC[t] >= windowStart;
+      if (take) part = s.sketches[c][slot];
+      portEXIT_CRITICAL(&s.lock);
+      if (take) qgatherAdd(gather, part);
+    }
+  }
+
+  // The pending readings belong to the open 15 min bucket, which may have left the window
+  float pending[EQ_PENDING];
+  uint8_t n;
+  portENTER_CRITICAL(&s.lock);
+  n = s.newest[0] * TIER_BUCKET_SEC[0] >= windowStart ? s.pendingCount[c] : 0;
+  for (uint8_t i = 0; i < n; i++) pending[i] = s.pending[c][i];
+  portEXIT_CRITICAL(&s.lock);
+  qsketchClear(part);
+  qsketchAdd(part, pending, n);
+  qgatherAdd(gather, part);
+  qgatherSketch(gather, out);
+  return true;
+}
@@ -0,0 +1,194 @@
+#include "env_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+// Bucket width and count of each window
+static const uint32_t WINDOW_BUCKET_SEC[ENV_WINDOWS] = {5 * 60, 60 * 60, 6 * 60 * 60};
+static const uint8_t WINDOW_BUCKETS[ENV_WINDOWS] = {12, 24, 28};
+static const char* const WINDOW_NAMES[ENV_WINDOWS] = {"1h", "24h", "7d"};
+static const char* const CHANNEL_NAMES[ENV_CHANNELS] = {"temp", "humidity", "pressure", "dew_point"};
+
+const char* envWindowName(EnvWindow w) {
+  return WINDOW_NAMES[w];
+}
+
+const char* envChannelName(EnvChannel c) {
+  return CHANNEL_NAMES[c];
+}
+
+static void resetWindow(EnvWindowState& w, uint32_t nowS) {
+  w.newest = nowS / w.bucketSec;
+  for (uint8_t i = 0; i < w.buckets; i++) w.ids[i] = w.newest;
+  memset(w.moments, 0, sizeof(w.moments));
+  for (uint8_t c = 0; c < ENV_CHANNELS; c++) {
+    w.lows[c].head = w.lows[c].len = 0;
+    w.highs[c].head = w.highs[c].len = 0;
+  }
+}
+
+// Moves the window to the bucket holding nowS: empties the slots it skips over and drops
+// deque entries from buckets that fell out. At most `buckets` slots per call.
+static void advance(EnvWindowState& w, uint32_t nowS) {
+  uint32_t id = nowS / w.bucketSec;
+  if (id == w.newest) return;
+  if (id < w.newest) {   // Clock went backwards (millis() wrap): start over
+    resetWindow(w, nowS);
+    return;
+  }
+  uint32_t from = id - w.newest > w.buckets ? id - w.buckets + 1 : w.newest + 1;
+  for (uint32_t n = from; n <= id; n++) {
+    uint8_t slot = n % w.buckets;
+    w.ids[slot] = n;
+    for (uint8_t c = 0; c < ENV_CHANNELS; c++) w.moments[c][slot] = EnvBucket();
+  }
+  w.newest = id;
+
+  for (uint8_t c = 0; c < ENV_CHANNELS; c++) {
+    EnvDeque* deques[2] = {&w.lows[c], &w.highs[c]};
+    for (EnvDeque* d : deques) {
+      while (d->len && d->bucket[d->head] + w.buckets <= id) {
+        d->head = (d->head + 1) % ENV_MAX_BUCKETS;
+        d->len--;
+      }
+    }
+  }
+}
+
+// Monotonic deque step: entries from the back that x beats can never be the extreme
+// again. Each bucket keeps at most one entry, so the deque never exceeds the window.
+static void offer(EnvDeque& d, uint32_t bucket, float x, bool keepHigh) {
+  while (d.len) {
+    uint8_t back = (d.head + d.len - 1) % ENV_MAX_BUCKETS;
+    bool beaten = keepHigh ? d.value[back] <= x : d.value[back] >= x;
+    if (!beaten) {
+      if (d.bucket[back] == bucket) return;   // Same bucket already holds a more extreme value
+      break;
+    }
+    d.len--;
+  }
+  uint8_t slot = (d.head + d.len) % ENV_MAX_BUCKETS;
+  d.bucket[slot] = bucket;
+  d.value[slot] = x;
+  d.len++;
+}
+
+static void addValue(EnvWindowState& w, uint8_t c, float x) {
+  EnvBucket& b = w.moments[c][w.newest % w.buckets];
+  b.count++;
+  float delta = x - b.mean;
+  b.mean += delta / b.count;
+  b.m2 += delta * (x - b.mean);
+  offer(w.lows[c], w.newest, x, false);
+  offer(w.highs[c], w.newest, x, true);
+}
+
+void envStatsBegin(EnvStats& s) {
+  memset(&s, 0, sizeof(s));
+  for (uint8_t i = 0; i < ENV_WINDOWS; i++) {
+    s.windows[i].bucketSec = WINDOW_BUCKET_SEC[i];
+    s.windows[i].buckets = WINDOW_BUCKETS[i];
+  }
+  s.comfort.dewPointC = s.comfort.absHumidity = s.comfort.heatIndexC = NAN;
+  s.lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void envStatsAdd(EnvStats& s, uint32_t nowS, float tempC, float humidity, float pressureHpa) {
+  float values[ENV_CHANNELS] = {tempC, humidity, pressureHpa, NAN};
+  EnvComfort comfort = {NAN, NAN, NAN};
+  if (!isnan(tempC) && !isnan(humidity) && humidity > 0) {
+    comfort.dewPointC = envDewPoint(tempC, humidity);
+    comfort.absHumidity = envAbsoluteHumidity(tempC, humidity);
+    comfort.heatIndexC = envHeatIndex(tempC, humidity);
+    values[ENV_DEW_POINT] = comfort.dewPointC;
+  }
+
+  portENTER_CRITICAL(&s.lock);
+  for (uint8_t i = 0; i < ENV_WINDOWS; i++) {
+    EnvWindowState& w = s.windows[i];
+    if (!s.started) resetWindow(w, nowS);
+    else advance(w, nowS);
+    for (uint8_t c = 0; c < ENV_CHANNELS; c++) {
+      if (!isnan(values[c])) addValue(w, c, values[c]);
+    }
+  }
+  s.started = true;
+  s.comfort = comfort;
+  portEXIT_CRITICAL(&s.lock);
+}
+
+static float dequeFront(const EnvDeque& d, uint32_t firstBucket) {
+  for (uint8_t k = 0; k < d.len; k++) {
+    uint8_t i = (d.head + k) % ENV_MAX_BUCKETS;
+    if (d.bucket[i] >= firstBucket) return d.value[i];
+  }
+  return NAN;
+}
+
+EnvSummary envStatsGet(EnvStats& s, EnvWindow window, EnvChannel c, uint32_t nowS) {
+  EnvSummary out = {0, NAN, NAN, NAN, NAN};
+  double mean = 0, m2 = 0;
+
+  portENTER_CRITICAL(&s.lock);
+  const EnvWindowState& w = s.windows[window];
+  uint32_t nowId = nowS / w.bucketSec;
+  uint32_t firstBucket = nowId >= w.buckets ? nowId - w.buckets + 1 : 0;
+  if (s.started) {
+    // Merge the moments of the buckets still inside the window
+    for (uint8_t i = 0; i < w.buckets; i++) {
+      const EnvBucket& b = w.moments[c][i];
+      if (!b.count || w.ids[i] < firstBucket || w.ids[i] > w.newest) continue;
+      uint32_t n = out.count + b.count;
+      double delta = b.mean - mean;
+      mean += delta * b.count / n;
+      m2 += b.m2 + delta * delta * out.count * b.count / n;
+      out.count = n;
+    }
+    if (out.count) {
+      out.min = dequeFront(w.lows[c], firstBucket);
+      out.max = dequeFront(w.highs[c], firstBucket);
+    }
+  }
+  portEXIT_CRITICAL(&s.lock);
+
+  if (out.count) {
+    out.mean = mean;
+    out.stddev = out.count > 1 ? sqrt(m2 / (out.count - 1)) : 0;
+  }
+  return out;
+}
+
+EnvComfort envStatsComfort(EnvStats& s) {
+  portENTER_CRITICAL(&s.lock);
+  EnvComfort c = s.comfort;
+  portEXIT_CRITICAL(&s.lock);
+  return c;
+}
+
+// Magnus formula (Sonntag 1990 constants), good to about 0.1 degC from -45 to 60 degC
+float envDewPoint(float tempC, float humidity) {
+  const float a = 17.62f, b = 243.12f;
+  float gamma = logf(humidity / 100.0f) + a * tempC / (b + tempC);
+  return b * gamma / (a - gamma);
+}
+
+// Water vapour density from the saturation pressure (Bolton 1980) and the gas law
+float envAbsoluteHumidity(float tempC, float humidity) {
+  float saturationHpa = 6.112f * expf(17.67f * tempC / (tempC + 243.5f));
+  return saturationHpa * humidity * 2.1674f / (273.15f + tempC);
+}
+
+// NWS heat index: Steadman's simple form, switching to the Rothfusz regression (with
+// its low- and high-humidity adjustments) once that averages 80 degF or more
+float envHeatIndex(float tempC, float humidity) {
+  float t = tempC * 1.8f + 32;
+  float rh = humidity;
+  float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + rh * 0.094f);
+  if ((hi + t) / 2 >= 80) {
+    hi = -42.379f + 2.04901523f * t + 10.14333127f * rh - 0.22475541f * t * rh - 0.00683783f * t * t -
+         0.05481717f * rh * rh + 0.00122874f * t * t * rh + 0.00085282f * t * rh * rh - 0.00000199f * t * t * rh * rh;
+    if (rh < 13 && t >= 80 && t <= 112) hi -= (13 - rh) / 4 * sqrtf((17 - fabsf(t - 95)) / 17);
+    else if (rh > 85 && t >= 80 && t <= 87) hi += (rh - 85) / 10 * (87 - t) / 5;
+  }
+  return (hi - 32) / 1.8f;
+}
@@ -0,0 +1,450 @@
+#include "eye_animator.h"
+
+#include <math.h>
+#include <string.h>
+#include "eye_frames.h"
+
+#if EYE_FRAME_ROTATION != 0 && EYE_FRAME_ROTATION != 2
+#error "eye_animator only supports rotation 0 and 2 (regenerate eye_frames.h)"
+#endif
+
+// --- Timing ---
+const uint16_t BLINK_CLOSE_MS = 70;
+const uint16_t BLINK_HOLD_MS = 40;
+const uint16_t BLINK_OPEN_MS = 90;
+const uint16_t FADE_MS = 240;
+const uint16_t AUTO_BLINK_MIN_MS = 2500;
+const uint16_t AUTO_BLINK_SPREAD_MS = 4000;
+const uint16_t STATS_WINDOW_MS = 1000;
+
+// --- Geometry ---
+const int16_t FB_W = 128;
+const int16_t FB_H = 64;
+const int16_t LID_OPEN = EYE_SOCKET_H / 2; // Lid half-height at which the eye is fully open
+const int8_t PUPIL_MAX_DX = 12;
+const int8_t PUPIL_MAX_DY = 12;
+const uint8_t KEYFRAME_SLOTS = 4;
+
+struct Keyframe {
+  int8_t dx, dy;
+  uint16_t durationMs;
+  uint16_t holdMs; // Stillness before the move starts
+  EyeEase ease;
+};
+
+// Everything that decides what a frame looks like; an unchanged key means an identical frame.
+struct FrameKey {
+  uint8_t expression;
+  int8_t dx, dy;
+  uint8_t lidHalf;
+  uint8_t fadeLevel; // 0..16, 16 = fully on the new expression
+};
+
+static uint8_t* fb = nullptr;
+static EyeAnimClockUs clockUs = nullptr;
+static uint16_t frameMs = 33;
+static uint8_t expression = 0;
+
+// Pupil keyframes
+static Keyframe track[KEYFRAME_SLOTS];
+static uint8_t trackLen = 0;
+static bool segStarted = false;
+static uint32_t segStartMs = 0;
+static float fromDx = 0, fromDy = 0;
+static float pupilDx = 0, pupilDy = 0;
+
+// Blink & cross-fade
+static bool blinking = false;
+static uint32_t blinkStartMs = 0;
+static bool autoBlink = true;
+static bool blinkScheduled = false;
+static uint32_t nextBlinkMs = 0;
+static uint8_t lidHalf = LID_OPEN;
+static uint8_t fadeFrom[EYE_FRAME_BYTES];
+static bool fading = false;
+static uint32_t fadeStartMs = 0;
+static uint8_t fadeLevel = 16;
+
+// Frame scheduling
+static bool running = false;
+static bool dirty = true;
+static uint32_t nextFrameMs = 0;
+static FrameKey lastKey;
+static uint32_t rng = 0x2545F491;
+
+// Stats
+static EyeAnimStats stats;
+static uint32_t winStartMs = 0;
+static uint32_t winServiced = 0, winDropped = 0;
+static uint32_t winRenderSum = 0, winRenderCount = 0, winRenderMax = 0;
+static uint32_t winFlushSum = 0, winFlushCount = 0, winFlushMax = 0;
+
+// --------------------------------------------------------------------------------
+// Framebuffer primitives (logical coordinates, mapped to the panel rotation)
+// --------------------------------------------------------------------------------
+
+static int16_t clipTop = 0, clipBottom = FB_H - 1;
+
+static void fbVLine(int16_t x, int16_t y, int16_t h) {
+  int16_t y0 = y, y1 = y + h - 1;
+  if (h <= 0 || x < 0 || x >= FB_W) return;
+  if (y0 < clipTop) y0 = clipTop;
+  if (y1 > clipBottom) y1 = clipBottom;
+  if (y0 > y1) return;
+#if EYE_FRAME_ROTATION == 2
+  x = FB_W - 1 - x;
+  int16_t t = FB_H - 1 - y1;
+  y1 = FB_H - 1 - y0;
+  y0 = t;
+#endif
+  for (int16_t page = y0 >> 3; page <= (y1 >> 3); page++) {
+    uint8_t mask = 0xFF;
+    if (page == (y0 >> 3)) mask &= (uint8_t)(0xFF << (y0 & 7));
+    if (page == (y1 >> 3)) mask &= (uint8_t)(0xFF >> (7 - (y1 & 7)));
+    fb[page * FB_W + x] |= mask;
+  }
+}
+
+static void fbHLine(int16_t x, int16_t y, int16_t w) {
+  for (int16_t i = 0; i < w; i++) fbVLine(x + i, y, 1);
+}
+
+// Same rasterisation as Adafruit_GFX::fillCircle, so resting pupils match EYE_FRAMES exactly.
+static void fbFillCircle(int16_t x0, int16_t y0, int16_t r) {
+  fbVLine(x0, y0 - r, 2 * r + 1);
+  int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r;
+  int16_t x = 0, y = r, px = x, py = y;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+    if (x < (y + 1)) {
+      fbVLine(x0 + x, y0 - y, 2 * y + 1);
+      fbVLine(x0 - x, y0 - y, 2 * y + 1);
+    }
+    if (y != py) {
+      fbVLine(x0 + py, y0 - px, 2 * px + 1);
+      fbVLine(x0 - py, y0 - px, 2 * px + 1);
+      py = y;
+    }
+    px = x;
+  }
+}
+
+// Eyelid edge across the inside of a socket at row y (follows the rounded corners).
+static void drawLid(int16_t ex, int16_t y) {
+  const int16_t top = EYE_CENTER_Y - EYE_SOCKET_H / 2;
+  const int16_t bottom = top + EYE_SOCKET_H - 1;
+  int16_t d = (y - top < bottom - y) ? (y - top) : (bottom - y);
+  int16_t inset = 0;
+  if (d < EYE_SOCKET_R) {
+    float v = EYE_SOCKET_R - d;
+    inset = EYE_SOCKET_R - (int16_t)sqrtf(EYE_SOCKET_R * EYE_SOCKET_R - v * v);
+  }
+  int16_t x0 = ex - EYE_SOCKET_W / 2 + inset + 1;
+  fbHLine(x0, y, EYE_SOCKET_W - 2 * (inset + 1));
+}
+
+// Ordered-dither cross-fade: pixels whose Bayer threshold is below `level` come from the
+// new frame, the rest from fadeFrom. Masks repeat every 4 columns and every 4 rows.
+static void blendFrom(uint8_t level) {
+  static const uint8_t BAYER[4][4] = {
+    { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 }
+  };
+  uint8_t masks[4];
+  for (uint8_t col = 0; col < 4; col++) {
+    uint8_t m = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      if (BAYER[bit & 3][col] < level) m |= (1 << bit);
+    }
+    masks[col] = m;
+  }
+  for (uint16_t i = 0; i < EYE_FRAME_BYTES; i++) {
+    uint8_t m = masks[i & 3];
+    fb[i] = (fb[i] & m) | (fadeFrom[i] & ~m);
+  }
+}
+
+static void render(const FrameKey& key) {
+  memcpy_P(fb, EYE_SOCKETS[key.expression], EYE_FRAME_BYTES);
+
+  const EyePupilStyle& style = EYE_PUPIL_STYLES[key.expression];
+  const int16_t eyeX[2] = { EYE_LEFT_X, EYE_RIGHT_X };
+
+  // Pupils are clipped to the gap between the lids
+  clipTop = EYE_CENTER_Y - key.lidHalf;
+  clipBottom = EYE_CENTER_Y + key.lidHalf;
+  for (uint8_t e = 0; e < 2; e++) {
+    if (style.eyes & (1 << e)) {
+      fbFillCircle(eyeX[e] + key.dx, EYE_CENTER_Y + key.dy + style.dy, style.r);
+    }
+  }
+  clipTop = 0;
+  clipBottom = FB_H - 1;
+
+  // Lids within a couple of rows of the socket outline would just thicken it
+  if (key.lidHalf < LID_OPEN - 2) {
+    for (uint8_t e = 0; e < 2; e++) {
+      if (!(style.eyes & (1 << e))) continue; // Already closed (wink)
+      drawLid(eyeX[e], EYE_CENTER_Y - key.lidHalf);
+      if (key.lidHalf > 0) drawLid(eyeX[e], EYE_CENTER_Y + key.lidHalf);
+    }
+  }
+
+  if (key.fadeLevel < 16) blendFrom(key.fadeLevel);
+}
+
+// --------------------------------------------------------------------------------
+// Animation state
+// --------------------------------------------------------------------------------
+
+static float applyEase(EyeEase ease, float p) {
+  switch (ease) {
+    case EASE_IN_OUT:
+      return (p < 0.5f) ? 4 * p * p * p : 1 - powf(-2 * p + 2, 3) / 2;
+    case EASE_OUT_BACK: {
+      const float c1 = 1.70158f, c3 = c1 + 1;
+      float q = p - 1;
+      return 1 + c3 * q * q * q + c1 * q * q;
+    }
+    case EASE_LINEAR:
+    default:
+      return p;
+  }
+}
+
+static uint32_t nextRandom() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void scheduleAutoBlink(uint32_t nowMs) {
+  nextBlinkMs = nowMs + AUTO_BLINK_MIN_MS + nextRandom() % AUTO_BLINK_SPREAD_MS;
+  blinkScheduled = true;
+}
+
+static void advancePupils(uint32_t nowMs) {
+  while (trackLen > 0) {
+    if (!segStarted) {
+      segStartMs = nowMs;
+      segStarted = true;
+    }
+    const Keyframe& k = track[0];
+    uint32_t t = nowMs - segStartMs;
+    if (t < k.holdMs) return;
+    t -= k.holdMs;
+    if (t < k.durationMs) {
+      float p = applyEase(k.ease, (float)t / k.durationMs);
+      pupilDx = fromDx + (k.dx - fromDx) * p;
+      pupilDy = fromDy + (k.dy - fromDy) * p;
+      return;
+    }
+    // Keyframe reached: the next one starts where this one ended
+    pupilDx = fromDx = k.dx;
+    pupilDy = fromDy = k.dy;
+    segStartMs += k.holdMs + k.durationMs;
+    memmove(&track[0], &track[1], (trackLen - 1) * sizeof(Keyframe));
+    trackLen--;
+  }
+  segStarted = false;
+}
+
+static void advanceBlink(uint32_t nowMs) {
+  if (!blinking) {
+    lidHalf = LID_OPEN;
+    return;
+  }
+  uint32_t t = nowMs - blinkStartMs;
+  float open;
+  if (t < BLINK_CLOSE_MS) {
+    open = 1 - applyEase(EASE_IN_OUT, (float)t / BLINK_CLOSE_MS);
+  } else if (t < BLINK_CLOSE_MS + BLINK_HOLD_MS) {
+    open = 0;
+  } else if (t < BLINK_CLOSE_MS + BLINK_HOLD_MS + BLINK_OPEN_MS) {
+    open = applyEase(EASE_IN_OUT, (float)(t - BLINK_CLOSE_MS - BLINK_HOLD_MS) / BLINK_OPEN_MS);
+  } else {
+    blinking = false;
+    open = 1;
+  }
+  lidHalf = (uint8_t)lroundf(open * LID_OPEN);
+}
+
+static void advanceFade(uint32_t nowMs) {
+  if (!fading) {
+    fadeLevel = 16;
+    return;
+  }
+  uint32_t t = nowMs - fadeStartMs;
+  if (t >= FADE_MS) {
+    fading = false;
+    fadeLevel = 16;
+    return;
+  }
+  fadeLevel = (uint8_t)lroundf(applyEase(EASE_IN_OUT, (float)t / FADE_MS) * 16);
+}
+
+static int8_t clampOffset(float v, int8_t limit) {
+  long r = lroundf(v);
+  if (r > limit) return limit;
+  if (r < -limit) return -limit;
+  return (int8_t)r;
+}
+
+static void publishStats(uint32_t nowMs) {
+  if (nowMs - winStartMs < STATS_WINDOW_MS) return;
+  // Windows without animation keep the previous numbers
+  if (winServiced + winDropped > 0) {
+    stats.fps = (float)stats.targetFps * winServiced / (winServiced + winDropped);
+  }
+  if (winRenderCount > 0) {
+    stats.renderUsAvg = winRenderSum / winRenderCount;
+    stats.renderUsMax = winRenderMax;
+  }
+  if (winFlushCount > 0) {
+    stats.flushUsAvg = winFlushSum / winFlushCount;
+    stats.flushUsMax = winFlushMax;
+  }
+  winStartMs = nowMs;
+  winServiced = winDropped = 0;
+  winRenderSum = winRenderCount = winRenderMax = 0;
+  winFlushSum = winFlushCount = winFlushMax = 0;
+}
+
+static void dropFrames(uint32_t n) {
+  stats.framesDropped += n;
+  winDropped += n;
+}
+
+// --------------------------------------------------------------------------------
+// Public API
+// --------------------------------------------------------------------------------
+
+void eyeAnimBegin(uint8_t* framebuffer, uint16_t fps, EyeAnimClockUs clock) {
+  fb = framebuffer;
+  clockUs = clock;
+  if (fps == 0) fps = 1;
+  frameMs = (1000 + fps / 2) / fps;
+  memset(&stats, 0, sizeof(stats));
+  stats.targetFps = fps;
+  if (clockUs) rng ^= clockUs();
+  if (rng == 0) rng = 0x2545F491;
+  trackLen = 0;
+  blinking = fading = running = blinkScheduled = false;
+  dirty = true;
+}
+
+void eyeAnimSetExpression(uint8_t state, uint32_t nowMs, bool force) {
+  if (state >= EYE_FRAME_STATES) state = 0;
+  if (state == expression && !force) return;
+  // Fade from what is on screen right now (possibly mid-fade or another screen)
+  if (fb) memcpy(fadeFrom, fb, EYE_FRAME_BYTES);
+  expression = state;
+  fading = true;
+  fadeStartMs = nowMs;
+  dirty = true;
+}
+
+void eyeAnimLookAt(int8_t dx, int8_t dy, uint16_t durationMs, EyeEase ease, uint32_t nowMs) {
+  fromDx = pupilDx;
+  fromDy = pupilDy;
+  track[0] = { dx, dy, durationMs, 0, ease };
+  trackLen = 1;
+  segStartMs = nowMs;
+  segStarted = true;
+}
+
+bool eyeAnimQueueLook(int8_t dx, int8_t dy, uint16_t durationMs, EyeEase ease, uint16_t holdMs) {
+  if (trackLen >= KEYFRAME_SLOTS) return false;
+  track[trackLen++] = { dx, dy, durationMs, holdMs, ease };
+  return true;
+}
+
+void eyeAnimBlink(uint32_t nowMs) {
+  blinking = true;
+  blinkStartMs = nowMs;
+  scheduleAutoBlink(nowMs);
+}
+
+void eyeAnimSetAutoBlink(bool enabled) {
+  autoBlink = enabled;
+}
+
+bool eyeAnimIsAnimating() {
+  return trackLen > 0 || blinking || fading;
+}
+
+bool eyeAnimTick(uint32_t nowMs, bool busBusy) {
+  if (!fb) return false;
+
+  if (autoBlink && !blinkScheduled) scheduleAutoBlink(nowMs);
+  if (autoBlink && !blinking && (int32_t)(nowMs - nextBlinkMs) >= 0) eyeAnimBlink(nowMs);
+  advancePupils(nowMs);
+  advanceBlink(nowMs);
+  advanceFade(nowMs);
+
+  FrameKey key = { expression,
+                   clampOffset(pupilDx, PUPIL_MAX_DX), clampOffset(pupilDy, PUPIL_MAX_DY),
+                   lidHalf, fadeLevel };
+  bool changed = dirty || memcmp(&key, &lastKey, sizeof(key)) != 0;
+  bool animating = eyeAnimIsAnimating();
+
+  if (!changed && !animating) {
+    running = false; // Idle: the next change renders without waiting for a slot
+    publishStats(nowMs);
+    return false;
+  }
+  if (!running) {
+    running = true;
+    nextFrameMs = nowMs;
+  }
+  if ((int32_t)(nowMs - nextFrameMs) < 0) return false;
+
+  // Slots that went by while the loop was busy elsewhere or the last flush overran
+  uint32_t missed = (nowMs - nextFrameMs) / frameMs;
+  nextFrameMs += (missed + 1) * frameMs;
+  dropFrames(missed);
+  publishStats(nowMs);
+
+  if (busBusy) {
+    dropFrames(1);
+    return false;
+  }
+  winServiced++;
+  if (!changed) return false; // e.g. holding between keyframes: same pixels, nothing to flush
+
+  uint32_t t0 = clockUs ? clockUs() : 0;
+  render(key);
+  uint32_t renderUs = clockUs ? clockUs() - t0 : 0;
+
+  lastKey = key;
+  dirty = false;
+  stats.framesRendered++;
+  winRenderSum += renderUs;
+  winRenderCount++;
+  if (renderUs > winRenderMax) winRenderMax = renderUs;
+  return true;
+}
+
+uint32_t eyeAnimNextDeadline(uint32_t nowMs) {
+  if (!fb) return nowMs + 1000;
+  if (dirty || eyeAnimIsAnimating()) return running ? nextFrameMs : nowMs;
+  if (autoBlink) return blinkScheduled ? nextBlinkMs : nowMs;
+  return nowMs + 1000; // Nothing scheduled; the caller caps its own wait
+}
+
+void eyeAnimFlushDone(uint32_t flushUs) {
+  winFlushSum += flushUs;
+  winFlushCount++;
+  if (flushUs > winFlushMax) winFlushMax = flushUs;
+}
+
+const EyeAnimStats& eyeAnimGetStats() {
+  return stats;
+}
@@ -0,0 +1,48 @@
+#include "heap_monitor.h"
+
+#include <esp_heap_caps.h>
+#include "freertos/FreeRTOS.h"
+
+// The trend is written by loop() and read by /metrics on the AsyncTCP task
+static HeapSample ring[HEAP_TREND_SAMPLES];
+static uint8_t ringHead = 0, ringCount = 0;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+static bool started = false;
+static uint32_t lastSampleMs = 0;
+
+// Outside any critical section: heap_caps_get_info() takes the heap's own lock
+static void readHeap(HeapStats& stats) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  stats.freeBytes = info.total_free_bytes;
+  stats.totalBytes = info.total_free_bytes + info.total_allocated_bytes;
+  stats.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  stats.largestBlock = info.largest_free_block;
+  stats.allocatedBlocks = info.allocated_blocks;
+  stats.freeBlocks = info.free_blocks;
+  stats.fragmentation = info.total_free_bytes ? 1.0f - (float)info.largest_free_block / info.total_free_bytes : 0;
+}
+
+void heapMonitorPoll(uint32_t nowMs) {
+  if (started && nowMs - lastSampleMs < HEAP_TREND_INTERVAL_MS) return;
+  started = true;
+  lastSampleMs = nowMs;
+  HeapStats now;
+  readHeap(now);
+  portENTER_CRITICAL(&ringMux);
+  ring[ringHead] = { now.freeBytes, now.largestBlock, now.allocatedBlocks };
+  ringHead = (ringHead + 1) % HEAP_TREND_SAMPLES;
+  if (ringCount < HEAP_TREND_SAMPLES) ringCount++;
+  portEXIT_CRITICAL(&ringMux);
+}
+
+HeapStats heapMonitorGetStats() {
+  HeapStats stats;
+  readHeap(stats);
+  portENTER_CRITICAL(&ringMux);
+  uint8_t first = (ringHead + HEAP_TREND_SAMPLES - ringCount) % HEAP_TREND_SAMPLES;
+  for (uint8_t i = 0; i < ringCount; i++) stats.trend[i] = ring[(first + i) % HEAP_TREND_SAMPLES];
+  stats.trendCount = ringCount;
+  portEXIT_CRITICAL(&ringMux);
+  return stats;
+}
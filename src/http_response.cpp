@@ -0,0 +1,247 @@
+#include "http_response.h"
+
+#include "freertos/FreeRTOS.h"
+
+struct HttpSlot {
+  HttpBuffer body;        // Response body, or the scratch value for a template
+  bool inUse;
+  uint16_t gen;           // Bumped on every acquire so stale callbacks can't release a reused slot
+  // Page streaming state
+  const HttpPage* page;
+  HttpPageCursor cursor;
+  HttpPlaceholderFn fn;
+  // Producer streaming state
+  HttpStreamFn streamFn;
+  uint32_t streamState[HTTP_STREAM_STATE_WORDS];
+  size_t streamPos;       // Bytes of the body already copied out
+  bool streamDone;
+};
+
+static HttpSlot slots[HTTP_POOL_SLOTS];
+static portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;
+static HttpPoolStats stats = { HTTP_POOL_SLOTS, 0, 0, 0, 0, 0, 0 }; // Under poolMux: loop() responds too
+
+size_t HttpBuffer::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HttpBuffer::write(const uint8_t* data, size_t n) {
+  if (len + n > HTTP_SLOT_SIZE) {
+    overflow = true;
+    n = HTTP_SLOT_SIZE - len;
+  }
+  memcpy(buf + len, data, n);
+  len += n;
+  return n;
+}
+
+static HttpSlot* slotOf(HttpBuffer* body) {
+  for (HttpSlot& s : slots) {
+    if (&s.body == body) return &s;
+  }
+  return nullptr;
+}
+
+static HttpSlot* acquireSlot() {
+  HttpSlot* found = nullptr;
+  portENTER_CRITICAL(&poolMux);
+  for (HttpSlot& s : slots) {
+    if (!s.inUse) {
+      s.inUse = true;
+      s.gen++;
+      found = &s;
+      if (++stats.inUse > stats.inUseMax) stats.inUseMax = stats.inUse;
+      break;
+    }
+  }
+  if (!found) stats.exhausted++;
+  portEXIT_CRITICAL(&poolMux);
+  if (found) {
+    found->body.clear();
+    found->page = nullptr;
+  }
+  return found;
+}
+
+static void releaseSlot(HttpSlot* s, uint16_t gen) {
+  portENTER_CRITICAL(&poolMux);
+  if (s->inUse && s->gen == gen) {
+    s->inUse = false;
+    stats.inUse--;
+  }
+  portEXIT_CRITICAL(&poolMux);
+}
+
+static void countResponse(size_t bodyLen) {
+  portENTER_CRITICAL(&poolMux);
+  stats.responses++;
+  if (bodyLen > stats.largestBody) stats.largestBody = bodyLen;
+  portEXIT_CRITICAL(&poolMux);
+}
+
+static void countOverflow() {
+  portENTER_CRITICAL(&poolMux);
+  stats.overflows++;
+  portEXIT_CRITICAL(&poolMux);
+}
+
+static bool isCurrent(HttpSlot* s, uint16_t gen) {
+  return s->inUse && s->gen == gen;
+}
+
+// The slot comes back when the last byte has been handed over, or when the client goes away first.
+static void releaseOnDisconnect(AsyncWebServerRequest* request, HttpSlot* s, uint16_t gen) {
+  request->onDisconnect([s, gen]() { releaseSlot(s, gen); });
+}
+
+HttpBuffer* httpBegin(AsyncWebServerRequest* request) {
+  HttpSlot* s = acquireSlot();
+  if (!s) {
+    request->send(503, "text/plain", "Busy");
+    return nullptr;
+  }
+  return &s->body;
+}
+
+void httpSend(AsyncWebServerRequest* request, int code, const char* contentType, HttpBuffer* body) {
+  HttpSlot* s = slotOf(body);
+  if (!s) return;
+  uint16_t gen = s->gen;
+  if (body->overflowed()) {
+    countOverflow();
+    releaseSlot(s, gen);
+    request->send(500, "text/plain", "Response too large");
+    return;
+  }
+  size_t len = body->length();
+  countResponse(len);
+
+  AsyncWebServerResponse* response = request->beginResponse(contentType, len,
+      [s, gen, len](uint8_t* out, size_t maxLen, size_t index) -> size_t {
+        if (!isCurrent(s, gen) || index >= len) return 0;
+        size_t n = len - index < maxLen ? len - index : maxLen;
+        memcpy(out, s->body.data() + index, n);
+        if (index + n >= len) releaseSlot(s, gen);
+        return n;
+      });
+  response->setCode(code);
+  releaseOnDisconnect(request, s, gen);
+  request->send(response);
+}
+
+size_t httpRenderPage(const HttpPage& page, HttpPlaceholderFn fn, HttpPageCursor& cursor, HttpBuffer& scratch,
+                      uint8_t* out, size_t maxLen) {
+  size_t n = 0;
+  while (n < maxLen) {
+    // Finish a value that didn't fit into the previous chunk
+    if (cursor.scratchPos < scratch.length()) {
+      size_t take = scratch.length() - cursor.scratchPos;
+      if (take > maxLen - n) take = maxLen - n;
+      memcpy(out + n, scratch.data() + cursor.scratchPos, take);
+      cursor.scratchPos += take;
+      n += take;
+      continue;
+    }
+    if (cursor.segment >= page.segmentCount) break;
+
+    const HttpSegment& seg = page.segments[cursor.segment];
+    if (cursor.sliceOffset < seg.textLen) {
+      size_t take = seg.textLen - cursor.sliceOffset;
+      if (take > maxLen - n) take = maxLen - n;
+      memcpy_P(out + n, page.text + cursor.textPos, take);
+      cursor.sliceOffset += take;
+      cursor.textPos += take;
+      n += take;
+      continue;
+    }
+
+    // Slice done: format the value that follows it
+    scratch.clear();
+    cursor.scratchPos = 0;
+    if (seg.placeholder != HTTP_PAGE_END) fn(seg.placeholder, scratch);
+    cursor.segment++;
+    cursor.sliceOffset = 0;
+  }
+  return n;
+}
+
+void httpSendPage(AsyncWebServerRequest* request, const char* contentType, const HttpPage& page, HttpPlaceholderFn fn) {
+  HttpSlot* s = acquireSlot();
+  if (!s) {
+    request->send(503, "text/plain", "Busy");
+    return;
+  }
+  uint16_t gen = s->gen;
+  s->page = &page;
+  s->cursor = HttpPageCursor();
+  s->fn = fn;
+  countResponse(0);
+
+  AsyncWebServerResponse* response = request->beginChunkedResponse(contentType,
+      [s, gen](uint8_t* out, size_t maxLen, size_t) -> size_t {
+        if (!isCurrent(s, gen)) return 0;
+        size_t n = httpRenderPage(*s->page, s->fn, s->cursor, s->body, out, maxLen);
+        if (n == 0) releaseSlot(s, gen);
+        return n;
+      });
+  releaseOnDisconnect(request, s, gen);
+  request->send(response);
+}
+
+// Copies what the producer printed into out, asking it for more as the slot runs dry.
+static size_t fillStream(HttpSlot* s, uint8_t* out, size_t maxLen) {
+  size_t n = 0;
+  while (n < maxLen) {
+    if (s->streamPos < s->body.length()) {
+      size_t take = s->body.length() - s->streamPos;
+      if (take > maxLen - n) take = maxLen - n;
+      memcpy(out + n, s->body.data() + s->streamPos, take);
+      s->streamPos += take;
+      n += take;
+      continue;
+    }
+    if (s->streamDone) break;
+    s->body.clear();
+    s->streamPos = 0;
+    if (!s->streamFn(s->body, s->streamState)) s->streamDone = true;
+    if (s->body.overflowed()) countOverflow();
+  }
+  return n;
+}
+
+void httpSendStream(AsyncWebServerRequest* request, const char* contentType, HttpStreamFn fn,
+                    const uint32_t (&state)[HTTP_STREAM_STATE_WORDS]) {
+  HttpSlot* s = acquireSlot();
+  if (!s) {
+    request->send(503, "text/plain", "Busy");
+    return;
+  }
+  uint16_t gen = s->gen;
+  s->streamFn = fn;
+  memcpy(s->streamState, state, sizeof(s->streamState));
+  s->streamPos = 0;
+  s->streamDone = false;
+  countResponse(0);
+
+  AsyncWebServerResponse* response = request->beginChunkedResponse(contentType,
+      [s, gen](uint8_t* out, size_t maxLen, size_t) -> size_t {
+        if (!isCurrent(s, gen)) return 0;
+        size_t n = fillStream(s, out, maxLen);
+        if (n == 0) releaseSlot(s, gen);
+        return n;
+      });
+  releaseOnDisconnect(request, s, gen);
+  request->send(response);
+}
+
+void httpSendStatic(AsyncWebServerRequest* request, int code, const char* contentType, const char* text) {
+  countResponse(0);
+  request->send_P(code, contentType, text);
+}
+
+HttpPoolStats httpGetStats() {
+  portENTER_CRITICAL(&poolMux);
+  HttpPoolStats copy = stats;
+  portEXIT_CRITICAL(&poolMux);
+  return copy;
+}
@@ -0,0 +1,330 @@
+#include "i2c_bus.h"
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "log_ring.h"
+#include "crash_trace.h"
+
+const uint8_t I2C_MAX_DEVICES = 6;
+const uint8_t I2C_MAX_WAITERS = 4;
+const uint8_t RECOVERY_CLOCKS = 9;
+// Minimum time between recovery steps (half an SCL period), so the clock never exceeds 100 kHz.
+// Steps are taken from i2cBusPoll(), once per loop() pass, so in practice the recovery clock
+// runs at the loop's pace (~50 Hz with its 10 ms deadline while recovering).
+const uint32_t RECOVERY_HALF_PERIOD_US = 5;
+const uint32_t RECOVERY_RETRY_MS = 1000;    // Back-off after a recovery that did not free SDA
+const uint32_t STATS_WINDOW_US = 1000000;
+
+struct Waiter {
+  SemaphoreHandle_t wake;
+  bool inUse;
+  bool granted;
+  I2cPriority prio;
+  uint32_t seq;
+  int8_t device;
+};
+
+enum RecoveryStep : uint8_t {
+  REC_IDLE,
+  REC_START,
+  REC_CLOCK_LOW,   // SCL is high; drop it unless the slave has let go of SDA
+  REC_CLOCK_HIGH,
+  REC_STOP_SCL_LOW, // STOP condition: SCL low, SDA low, SCL high, SDA high
+  REC_STOP_SDA_LOW,
+  REC_STOP_SCL_HIGH,
+  REC_STOP_SDA_HIGH
+};
+
+static TwoWire* bus = nullptr;
+static int sdaPin = -1, sclPin = -1;
+static SemaphoreHandle_t stateLock = nullptr;
+
+static I2cDeviceStats devices[I2C_MAX_DEVICES];
+static uint64_t deviceBusyUs[I2C_MAX_DEVICES];
+static uint8_t deviceCount = 0;
+
+static Waiter waiters[I2C_MAX_WAITERS];
+static volatile uint8_t waiting = 0;
+static uint32_t nextSeq = 0;
+
+static volatile bool held = false;
+static int8_t owner = -1;
+static uint32_t heldSinceUs = 0;
+
+static volatile RecoveryStep recovery = REC_IDLE;
+static uint8_t recoveryClocks = 0;
+static uint32_t lastStepUs = 0;
+static bool retryPending = false;
+static uint32_t retryAtMs = 0;
+
+static I2cBusStats stats;
+static uint32_t windowStartUs = 0;
+static uint32_t windowBusyUs = 0;
+static uint32_t windowWaitMax = 0;
+static uint8_t windowDepthMax = 0;
+
+// Only meaningful while nobody is mid-transaction.
+static bool sdaStuck() {
+  return digitalRead(sdaPin) == LOW;
+}
+
+// Caller holds stateLock. Returns false while a failed recovery is backing off.
+static bool startRecovery() {
+  if (retryPending && (int32_t)(millis() - retryAtMs) < 0) return false;
+  retryPending = false;
+  stats.stuckEvents++;
+  recovery = REC_START;
+  logWrite(LOG_MSG_I2C_STUCK);
+  return true;
+}
+
+// Hands the idle bus to the highest-priority waiter (oldest first). Caller holds stateLock.
+static void grantNext() {
+  if (held || recovery != REC_IDLE || waiting == 0) return;
+  if (sdaStuck()) {
+    startRecovery(); // Waiters stay queued and get the bus once it is free again
+    return;
+  }
+  Waiter* best = nullptr;
+  for (uint8_t i = 0; i < I2C_MAX_WAITERS; i++) {
+    Waiter& w = waiters[i];
+    if (!w.inUse || w.granted) continue;
+    if (!best || w.prio > best->prio || (w.prio == best->prio && (int32_t)(w.seq - best->seq) < 0)) best = &w;
+  }
+  if (!best) return;
+  best->granted = true;
+  waiting--;
+  held = true;
+  owner = best->device;
+  heldSinceUs = micros();
+  xSemaphoreGive(best->wake);
+}
+
+static void finishRecovery(bool freed) {
+  bus->begin(sdaPin, sclPin);
+  xSemaphoreTake(stateLock, portMAX_DELAY);
+  if (freed) {
+    stats.recoveries++;
+    logWrite(LOG_MSG_I2C_RECOVERED);
+  } else {
+    stats.recoveryFailures++;
+    retryPending = true;
+    retryAtMs = millis() + RECOVERY_RETRY_MS;
+    logWrite(LOG_MSG_I2C_RECOVERY_FAILED);
+  }
+  recovery = REC_IDLE;
+  grantNext();
+  xSemaphoreGive(stateLock);
+}
+
+// At most one half SCL period per call, so the recovery never blocks the caller.
+static void stepRecovery() {
+  uint32_t now = micros();
+  if (recovery != REC_START && now - lastStepUs < RECOVERY_HALF_PERIOD_US) return;
+  lastStepUs = now;
+
+  switch (recovery) {
+    case REC_START:
+      bus->end();
+      pinMode(sdaPin, INPUT_PULLUP);
+      pinMode(sclPin, OUTPUT_OPEN_DRAIN);
+      digitalWrite(sclPin, HIGH);
+      recoveryClocks = 0;
+      recovery = REC_CLOCK_LOW;
+      break;
+    case REC_CLOCK_LOW:
+      if (digitalRead(sdaPin) == HIGH) {
+        recovery = REC_STOP_SCL_LOW;
+      } else if (recoveryClocks >= RECOVERY_CLOCKS) {
+        finishRecovery(false);
+      } else {
+        digitalWrite(sclPin, LOW);
+        recovery = REC_CLOCK_HIGH;
+      }
+      break;
+    case REC_CLOCK_HIGH:
+      digitalWrite(sclPin, HIGH);
+      recoveryClocks++;
+      recovery = REC_CLOCK_LOW;
+      break;
+    case REC_STOP_SCL_LOW:
+      digitalWrite(sclPin, LOW);
+      recovery = REC_STOP_SDA_LOW;
+      break;
+    case REC_STOP_SDA_LOW:
+      pinMode(sdaPin, OUTPUT_OPEN_DRAIN);
+      digitalWrite(sdaPin, LOW);
+      recovery = REC_STOP_SCL_HIGH;
+      break;
+    case REC_STOP_SCL_HIGH:
+      digitalWrite(sclPin, HIGH);
+      recovery = REC_STOP_SDA_HIGH;
+      break;
+    case REC_STOP_SDA_HIGH:
+      digitalWrite(sdaPin, HIGH);
+      finishRecovery(true);
+      break;
+    case REC_IDLE:
+    default:
+      break;
+  }
+}
+
+void i2cBusBegin(TwoWire& wire, int sda, int scl) {
+  bus = &wire;
+  sdaPin = sda;
+  sclPin = scl;
+  stateLock = xSemaphoreCreateMutex();
+  for (uint8_t i = 0; i < I2C_MAX_WAITERS; i++) waiters[i].wake = xSemaphoreCreateBinary();
+  memset(&stats, 0, sizeof(stats));
+  windowStartUs = micros();
+  bus->begin(sdaPin, sclPin);
+}
+
+int8_t i2cBusAddDevice(const char* name, uint8_t address, uint32_t clockHz) {
+  if (deviceCount >= I2C_MAX_DEVICES) return -1;
+  I2cDeviceStats& d = devices[deviceCount];
+  memset(&d, 0, sizeof(d));
+  d.name = name;
+  d.address = address;
+  d.clockHz = clockHz;
+  deviceBusyUs[deviceCount] = 0;
+  return (int8_t)deviceCount++;
+}
+
+bool i2cBusAcquire(int8_t device, I2cPriority prio, uint32_t timeoutMs) {
+  if (!bus || device < 0 || device >= deviceCount) return false;
+  uint32_t t0 = micros();
+
+  xSemaphoreTake(stateLock, portMAX_DELAY);
+  if (recovery != REC_IDLE) {
+    stats.rejected++;
+    xSemaphoreGive(stateLock);
+    return false;
+  }
+
+  if (!held && waiting == 0) {
+    // Free bus: take it straight away, unless SDA is stuck
+    if (sdaStuck()) {
+      startRecovery();
+      stats.rejected++;
+      xSemaphoreGive(stateLock);
+      return false;
+    }
+    held = true;
+    owner = device;
+    heldSinceUs = micros();
+  } else {
+    Waiter* w = nullptr;
+    for (uint8_t i = 0; i < I2C_MAX_WAITERS; i++) {
+      if (!waiters[i].inUse) {
+        w = &waiters[i];
+        break;
+      }
+    }
+    if (!w) {
+      stats.timeouts++;
+      xSemaphoreGive(stateLock);
+      return false;
+    }
+    w->inUse = true;
+    w->granted = false;
+    w->prio = prio;
+    w->seq = nextSeq++;
+    w->device = device;
+    waiting++;
+    if (waiting > windowDepthMax) windowDepthMax = waiting;
+    xSemaphoreGive(stateLock);
+
+    bool woke = xSemaphoreTake(w->wake, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    if (!w->granted) {
+      w->inUse = false;
+      waiting--;
+      stats.timeouts++;
+      xSemaphoreGive(stateLock);
+      return false;
+    }
+    if (!woke) xSemaphoreTake(w->wake, 0); // Granted just as we timed out: consume the wake-up
+    w->inUse = false;
+  }
+
+  uint32_t waited = micros() - t0;
+  if (waited > windowWaitMax) windowWaitMax = waited;
+  xSemaphoreGive(stateLock);
+
+  // From here on we own the bus
+  if (bus->getClock() != devices[device].clockHz) {
+    bus->setClock(devices[device].clockHz);
+    stats.clockSwitches++;
+  }
+  return true;
+}
+
+void i2cBusRelease(bool ok) {
+  xSemaphoreTake(stateLock, portMAX_DELAY);
+  if (!held) {
+    xSemaphoreGive(stateLock);
+    return;
+  }
+  uint32_t us = micros() - heldSinceUs;
+  I2cDeviceStats& d = devices[owner];
+  d.transactions++;
+  deviceBusyUs[owner] += us;
+  d.busyMs = (uint32_t)(deviceBusyUs[owner] / 1000);
+  stats.transactions++;
+  windowBusyUs += us;
+  if (!ok) {
+    d.errors++;
+    stats.errors++;
+  }
+  traceRecord(TRACE_I2C, traceI2cArg(d.address, ok, us));
+  held = false;
+  owner = -1;
+
+  // A failed transaction followed by SDA stuck low means a slave is wedged mid-byte
+  if (!ok && sdaStuck()) startRecovery();
+  grantNext();
+  xSemaphoreGive(stateLock);
+}
+
+bool i2cBusBusy() {
+  return held || waiting > 0 || recovery != REC_IDLE;
+}
+
+bool i2cBusRecovering() {
+  return recovery != REC_IDLE;
+}
+
+void i2cBusPoll() {
+  if (!bus) return;
+  if (recovery != REC_IDLE) stepRecovery();
+
+  uint32_t now = micros();
+  uint32_t elapsed = now - windowStartUs;
+  if (elapsed < STATS_WINDOW_US) return;
+  xSemaphoreTake(stateLock, portMAX_DELAY);
+  float u = (float)windowBusyUs / elapsed;
+  stats.utilization = (u > 1.0f) ? 1.0f : u;
+  stats.waitUsMax = windowWaitMax;
+  stats.queueDepthMax = windowDepthMax;
+  windowStartUs = now;
+  windowBusyUs = 0;
+  windowWaitMax = 0;
+  windowDepthMax = waiting;
+  xSemaphoreGive(stateLock);
+}
+
+const I2cBusStats& i2cBusGetStats() {
+  return stats;
+}
+
+uint8_t i2cBusDeviceCount() {
+  return deviceCount;
+}
+
+const I2cDeviceStats& i2cBusGetDeviceStats(uint8_t device) {
+  return devices[device < deviceCount ? device : 0];
+}
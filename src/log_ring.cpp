@@ -0,0 +1,344 @@
+#include "log_ring.h"
+
+#include <Arduino.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+const uint32_t RING_MASK = LOG_RING_ENTRIES - 1;
+const uint8_t STREAM_BATCH = 16;        // Entries per logStreamNext() call
+const size_t SPEC_MAX = 16;             // One conversion: %, flags, width, precision, letter
+
+static const LogLevel LEVELS[LOG_MESSAGE_COUNT] = {
+#define LOG_MESSAGE(name, level, format) level,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+};
+
+static const char* const FORMATS[LOG_MESSAGE_COUNT] = {
+#define LOG_MESSAGE(name, level, format) format,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+};
+
+static const char* const LEVEL_NAMES[] = {"debug", "info", "warn", "error"};
+
+// Statically initialized, so logging works from the first line of setup()
+LogRing systemLog = {{}, 0, portMUX_INITIALIZER_UNLOCKED, nullptr};
+
+// Drain state; printing is serialized by printMutex (the drain task vs. logFlush())
+static Print* drainOut = nullptr;
+static SemaphoreHandle_t printMutex = nullptr;
+static uint32_t handled = 0;      // Entries up to this sequence number are printed or lost
+static uint32_t printedCount = 0;
+static uint32_t lostCount = 0;
+
+void logRingBegin(LogRing& r) {
+  memset(r.entries, 0, sizeof(r.entries));
+  r.written = 0;
+  r.lock = portMUX_INITIALIZER_UNLOCKED;
+  r.drainTask = nullptr;
+}
+
+void logAppend(LogRing& r, LogMessage message, const LogArgs& args) {
+  uint32_t ms = millis();
+  portENTER_CRITICAL(&r.lock);
+  uint32_t seq = ++r.written;
+  LogEntry& e = r.entries[seq & RING_MASK];
+  e.seq = seq;
+  e.ms = ms;
+  e.message = message;
+  memcpy(&e.args, &args, offsetof(LogArgs, data) + args.len);
+  TaskHandle_t task = r.drainTask;
+  portEXIT_CRITICAL(&r.lock);
+  if (task) xTaskNotifyGive(task);
+}
+
+bool logRead(LogRing& r, uint32_t seq, LogEntry& out) {
+  bool ok;
+  portENTER_CRITICAL(&r.lock);
+  ok = seq && seq <= r.written && r.written - seq < LOG_RING_ENTRIES;
+  if (ok) out = r.entries[seq & RING_MASK];
+  portEXIT_CRITICAL(&r.lock);
+  return ok;
+}
+
+uint32_t logOldest(LogRing& r) {
+  uint32_t written = __atomic_load_n(&r.written, __ATOMIC_ACQUIRE);
+  return written > LOG_RING_ENTRIES ? written - LOG_RING_ENTRIES + 1 : 1;
+}
+
+// --- Argument encoding ---
+
+static void setType(LogArgs& a, LogArgType type) {
+  a.types |= type << (2 * a.count);
+  a.count++;
+}
+
+void logArg(LogArgs& a, int32_t v, LogArgType type) {
+  // Strings leave room for the numbers after them, so this always fits
+  if (a.count >= LOG_MAX_ARGS || a.len + sizeof(v) > LOG_ARG_BYTES) return;
+  memcpy(a.data + a.len, &v, sizeof(v));
+  a.len += sizeof(v);
+  setType(a, type);
+}
+
+void logArg(LogArgs& a, float v) {
+  if (a.count >= LOG_MAX_ARGS || a.len + sizeof(v) > LOG_ARG_BYTES) return;
+  memcpy(a.data + a.len, &v, sizeof(v));
+  a.len += sizeof(v);
+  setType(a, LOG_ARG_FLOAT);
+}
+
+void logArg(LogArgs& a, const char* s) {
+  if (a.count >= LOG_MAX_ARGS) return;
+  if (!s) s = "(null)";
+  // Keep 4 bytes for each argument still to come
+  uint8_t after = a.total > a.count + 1 ? a.total - a.count - 1 : 0;
+  int room = (int)LOG_ARG_BYTES - a.len - 4 * after - 1;
+  if (room < 0) return;
+  size_t n = strnlen(s, room);
+  memcpy(a.data + a.len, s, n);
+  a.data[a.len + n] = '\0';
+  a.len += n + 1;
+  setType(a, LOG_ARG_STRING);
+}
+
+void logArg(LogArgs& a, const String& s) {
+  logArg(a, s.c_str());
+}
+
+// --- Formatting ---
+
+static bool isFloatConversion(char c) {
+  return c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G';
+}
+
+size_t logFormat(const LogEntry& e, char* out, size_t size) {
+  if (!size) return 0;
+  const char* f = e.message < LOG_MESSAGE_COUNT ? FORMATS[e.message] : "?";
+  const LogArgs& a = e.args;
+  size_t n = 0;
+  uint8_t arg = 0;
+  uint8_t offset = 0;
+  while (*f && n + 1 < size) {
+    if (*f != '%') {
+      out[n++] = *f++;
+      continue;
+    }
+    if (f[1] == '%') {
+      out[n++] = '%';
+      f += 2;
+      continue;
+    }
+
+    // Flags, width and precision are kept; length modifiers are dropped, since every
+    // argument is stored in 32 bits
+    char spec[SPEC_MAX];
+    size_t s = 0;
+    spec[s++] = *f++;
+    while (*f && (strchr("-+ #0.", *f) || isdigit((unsigned char)*f))) {
+      if (s < SPEC_MAX - 3) spec[s++] = *f;
+      f++;
+    }
+    while (*f == 'l' || *f == 'h' || *f == 'z') f++;
+    char conv = *f ? *f++ : 'd';
+
+    size_t room = size - n;
+    int len;
+    if (arg >= a.count) {
+      len = snprintf(out + n, room, "?");
+    } else {
+      LogArgType type = (LogArgType)((a.types >> (2 * arg)) & 3);
+      if (type == LOG_ARG_STRING) {
+        const char* str = (const char*)a.data + offset;
+        offset += strlen(str) + 1;
+        spec[s++] = 's';
+        spec[s] = '\0';
+        len = snprintf(out + n, room, spec, str);
+      } else {
+        uint32_t bits;
+        memcpy(&bits, a.data + offset, sizeof(bits));
+        offset += sizeof(bits);
+        float fv;
+        memcpy(&fv, &bits, sizeof(fv));
+        if (isFloatConversion(conv)) {
+          spec[s++] = conv;
+          spec[s] = '\0';
+          len = snprintf(out + n, room, spec, type == LOG_ARG_FLOAT ? (double)fv
+                                                : type == LOG_ARG_INT ? (double)(int32_t)bits : (double)bits);
+        } else if (type == LOG_ARG_FLOAT) {
+          // A float given for %d or %s: print it as a float anyway
+          spec[s++] = 'g';
+          spec[s] = '\0';
+          len = snprintf(out + n, room, spec, (double)fv);
+        } else {
+          spec[s++] = conv == 's' ? (type == LOG_ARG_INT ? 'd' : 'u') : conv;
+          spec[s] = '\0';
+          if (type == LOG_ARG_INT) len = snprintf(out + n, room, spec, (int)(int32_t)bits);
+          else len = snprintf(out + n, room, spec, (unsigned)bits);
+        }
+      }
+      arg++;
+    }
+    if (len > 0) n += (size_t)len < room ? (size_t)len : room - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+LogLevel logLevelOf(LogMessage message) {
+  return message < LOG_MESSAGE_COUNT ? LEVELS[message] : LOG_LEVEL_ERROR;
+}
+
+const char* logLevelName(LogLevel level) {
+  return level <= LOG_LEVEL_ERROR ? LEVEL_NAMES[level] : "?";
+}
+
+bool logParseLevel(const char* name, LogLevel& level) {
+  for (uint8_t i = 0; i <= LOG_LEVEL_ERROR; i++) {
+    if (strcmp(name, LEVEL_NAMES[i]) == 0) {
+      level = (LogLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// --- /logs ---
+
+// Layout of the stream state words
+enum {
+  ST_NEXT,    // Sequence number of the next entry to send
+  ST_END,     // Latest entry when the stream began
+  ST_LEVEL    // Lowest LogLevel sent
+};
+
+void logStreamBegin(uint32_t* state, uint32_t after, LogLevel minLevel) {
+  uint32_t oldest = logOldest(systemLog);
+  state[ST_NEXT] = after + 1 > oldest ? after + 1 : oldest;
+  state[ST_END] = __atomic_load_n(&systemLog.written, __ATOMIC_ACQUIRE);
+  state[ST_LEVEL] = minLevel;
+}
+
+static void putJsonString(char*& p, char* end, const char* s) {
+  *p++ = '"';
+  for (; *s && p + 7 < end; s++) {
+    unsigned char c = *s;
+    if (c == '"' || c == '\\') {
+      *p++ = '\\';
+      *p++ = c;
+    } else if (c < 0x20) {
+      p += snprintf(p, end - p, "\\u%04x", c);
+    } else {
+      *p++ = c;
+    }
+  }
+  *p++ = '"';
+}
+
+bool logStreamNext(Print& out, uint32_t* state) {
+  char msg[LOG_LINE_MAX];
+  char line[LOG_LINE_MAX * 2];
+  for (uint8_t n = 0; n < STREAM_BATCH && state[ST_NEXT] <= state[ST_END]; n++) {
+    LogEntry e;
+    if (!logRead(systemLog, state[ST_NEXT], e)) {
+      // Overwritten while the stream was running: carry on from the oldest left
+      uint32_t oldest = logOldest(systemLog);
+      state[ST_NEXT] = oldest > state[ST_NEXT] ? oldest : state[ST_END] + 1;
+      continue;
+    }
+    state[ST_NEXT]++;
+    LogLevel level = logLevelOf(e.message);
+    if (level < state[ST_LEVEL]) continue;
+    logFormat(e, msg, sizeof(msg));
+    char* p = line;
+    char* end = line + sizeof(line) - 3;
+    p += snprintf(p, end - p, "{\"seq\":%lu,\"ms\":%lu,\"level\":\"%s\",\"msg\":", (unsigned long)e.seq,
+                  (unsigned long)e.ms, logLevelName(level));
+    putJsonString(p, end, msg);
+    *p++ = '}';
+    *p++ = '\n';
+    out.write((const uint8_t*)line, p - line);
+  }
+  return state[ST_NEXT] <= state[ST_END];
+}
+
+// --- Drain to Serial ---
+
+static void printEntry(const LogEntry& e) {
+  char line[LOG_LINE_MAX + 24];
+  int n = snprintf(line, sizeof(line), "[%6lu.%03lu] %-5s ", (unsigned long)(e.ms / 1000),
+                   (unsigned long)(e.ms % 1000), logLevelName(logLevelOf(e.message)));
+  n += logFormat(e, line + n, sizeof(line) - n - 1);
+  line[n++] = '\n';
+  drainOut->write((const uint8_t*)line, n);
+}
+
+// Prints every entry not yet handled. Call with printMutex held.
+static void printPending() {
+  uint32_t next;
+  while ((next = handled + 1) <= __atomic_load_n(&systemLog.written, __ATOMIC_ACQUIRE)) {
+    LogEntry e;
+    if (!logRead(systemLog, next, e)) {
+      uint32_t oldest = logOldest(systemLog);
+      if (oldest <= next) break;
+      LogEntry lost;
+      lost.seq = 0;
+      lost.ms = millis();
+      lost.message = LOG_MSG_LOG_LOST;
+      lost.args.count = lost.args.types = lost.args.len = 0;
+      lost.args.total = 1;
+      logArg(lost.args, (unsigned long)(oldest - next));
+      printEntry(lost);
+      lostCount += oldest - next;
+      handled = oldest - 1;
+      continue;
+    }
+    printEntry(e);
+    printedCount++;
+    handled = next;
+  }
+}
+
+static void drainTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(printMutex, portMAX_DELAY);
+    printPending();
+    xSemaphoreGive(printMutex);
+  }
+}
+
+bool logBegin(Print& out) {
+  if (drainOut) return true;
+  printMutex = xSemaphoreCreateMutex();
+  if (!printMutex) return false;
+  drainOut = &out;
+  TaskHandle_t task = nullptr;
+  if (xTaskCreate(drainTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, &task) != pdPASS) {
+    drainOut = nullptr;
+    return false;
+  }
+  portENTER_CRITICAL(&systemLog.lock);
+  systemLog.drainTask = task;
+  portEXIT_CRITICAL(&systemLog.lock);
+  xTaskNotifyGive(task);   // For what was logged before
+  return true;
+}
+
+void logFlush() {
+  if (!drainOut) return;
+  xSemaphoreTake(printMutex, portMAX_DELAY);
+  printPending();
+  drainOut->flush();
+  xSemaphoreGive(printMutex);
+}
+
+LogStats logStats() {
+  LogStats s;
+  s.written = __atomic_load_n(&systemLog.written, __ATOMIC_ACQUIRE);
+  s.printed = printedCount;
+  s.lost = lostCount;
+  return s;
+}
@@ -4,27 +4,66 @@
 #include <Adafruit_AHTX0.h>   // AHT20 Temp/Humidity Sensor
 #include <Adafruit_BMP280.h>  // BMP280 Pressure Sensor
 #include <WiFi.h>             // Standard ESP32 Wi-Fi library
-#include <DNSServer.h>
 #include <ESPmDNS.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h> // Asynchronous Web Server for speed and stability
 #include <Preferences.h>      // Non-Volatile Storage (NVS) for saving config
 #include <ArduinoOTA.h>       // Over-The-Air Updates
 #include <ArduinoJson.h>       // For robust JSON handling
+#include "eye_frames.h"        // Precomputed Big Eyes frames (tools/gen_eye_frames.py)
+#include "eye_animator.h"      // Fixed-frame-rate Big Eyes animation
+#include "i2c_bus.h"           // Arbitration for the shared I2C bus
+#include "power_manager.h"     // Idle / light sleep between loop deadlines
+#include "adaptive_sampler.h"  // Sensor read interval that follows signal change
+#include "http_response.h"     // Pool-buffered, allocation-free web responses
+#include "heap_monitor.h"      // Heap fragmentation telemetry
+#include "web_pages.h"         // Pages from web/ with precomputed placeholders (tools/gen_web_pages.py)
+#include "sample_store.h"      // Day-long sample history for /export
+#include "sample_export.h"     // Streamed CSV / NDJSON export
+#include "sensor_snapshot.h"   // Torn-free latest reading for the web handlers
+#include "command_queue.h"     // Work the web handlers hand to loop()
+#include "cbor_writer.h"       // Binary (CBOR) responses for /data and /history
+#include "env_stats.h"         // Rolling min/max/mean and comfort metrics
+#include "env_quantiles.h"     // Percentiles over the same windows
+#include "pressure_trend.h"    // 3 h pressure tendency and Zambretti forecast
+#include "anomaly_detector.h"  // Failed, stuck and implausible sensor readings
+#include "bh1750.h"            // Ambient light (non-blocking, auto-ranging)
+#include "mic_capture.h"       // INMP441 I2S capture into a lock-free ring
+#include "sound_level.h"       // Fixed-point A-weighted sound level meter
+#include "voice_frontend.h"    // Voice-activity detection and MFCC features
+#include "touch_gesture.h"     // Touch gesture segmenter and learned classifier
+#include "touch_capture.h"     // Binary touch capture for training it
+#include "log_ring.h"          // Non-blocking structured log, drained to Serial and served at /logs
+#include "crash_trace.h"       // Crash-surviving trace in RTC memory, served at /debug/lastcrash
+#include "captive_dns.h"       // Setup portal DNS, answered from the UDP task
+#include "wifi_scan.h"         // Background Wi-Fi scan for the setup portal
+#include <esp_system.h>
+#include <sys/time.h>
 
 // --- DEVELOPMENT & AI FLAGS ---
 // Set this to 1 to enable a special mode for collecting touch sensor data for ML model training.
 // The device will only print touch data to the Serial Monitor and will not run the main Mochi application.
 #define DATA_COLLECTION_MODE 0
 
-// Set this to 1 when you have an I2S microphone connected and are ready to work on Phase 3.
+// Set this to 1 when you have an INMP441 I2S microphone connected (L/R pin to GND). It adds the
+// sound level channel (A-weighted dB SPL, Leq, peak) and the speech front end (voice-activity
+// detection and the MFCC features a keyword-spotting model would take).
 #define ENABLE_VOICE_RECOGNITION 0
 
+// Set this to 1 to show the Big Eyes from the precomputed frames in eye_frames.h (one 1 KB copy per frame).
+// Set to 0 to fall back to drawing them with Adafruit GFX primitives at runtime.
+#define USE_EYE_SPRITES 1
+
+// Set this to 1 to animate the Big Eyes (tweened pupils, blinks, cross-fades) at EYE_ANIM_FPS.
+// Set to 0 to jump between the fixed frames every EYE_MOVE_INTERVAL instead.
+#define ENABLE_EYE_ANIMATION 1
+
 // --- WIFI & NVS CONFIGURATION ---
 const char* AP_SSID = "Smart-Mitra-Setup";
 const char* AP_PASS = "mochisetup";
 const IPAddress AP_IP(192, 168, 4, 1);
 const IPAddress NET_MASK(255, 255, 255, 0);
+bool portalActive = false; // Running the setup portal instead of the main interface
 
 // NVS Keys
 const char* PREFS_NAMESPACE = "nav_mitra_cfg";
@@ -36,12 +75,17 @@ const char* KEY_TEMP_LOW = "temp_low";
 const char* KEY_BUZZER_EN = "buzzer_en";
 const char* KEY_TZ_OFFSET = "tz_offset";
 const char* KEY_SENSOR_INT = "sensor_int";
+const char* KEY_SENSOR_ADAPT = "sensor_adapt";
+const char* KEY_SENSOR_MIN = "sensor_min";
+const char* KEY_SENSOR_MAX = "sensor_max";
 const char* KEY_OLED_TO = "oled_to";
 const char* KEY_QUIET_START = "quiet_start";
 const char* KEY_QUIET_END = "quiet_end";
 const char* KEY_ALARM_EN = "alarm_en";
 const char* KEY_ALARM_HR = "alarm_hr";
 const char* KEY_ALARM_MIN = "alarm_min";
+const char* KEY_ALTITUDE = "altitude";
+const char* KEY_AUTO_BRIGHT = "auto_bright";
 
 // Defaults and In-Memory Storage
 String deviceName = "nav-mitra";
@@ -54,6 +98,8 @@ String staPass = "";
 #define SCREEN_HEIGHT 64    // OLED display height, in pixels
 #define I2C_SDA_PIN 4       // Correct, safe I2C SDA pin for ESP32-C3
 #define I2C_SCL_PIN 5       // Correct, safe I2C SCL pin for ESP32-C3
+#define OLED_I2C_CLOCK 400000   // Display bursts (many panels also take 800 kHz on short wires)
+#define SENSOR_I2C_CLOCK 100000 // AHT20 / BMP280 reads
 #define TOUCH_PIN 7         // GPIO 7 for Touch Input
 #define BUZZER_PIN 6        // GPIO 6 for Active Buzzer
 
@@ -66,6 +112,10 @@ float tempAlertLow = 18.0;  // Celsius
 bool buzzerEnabled = true;
 uint16_t oledTimeoutMins = 10; // 0 = always on
 unsigned long sensorInterval = 5000; // Read sensors every 5 seconds (default, in ms)
+bool sensorAdaptive = true;            // Let the adaptive sampler pick the interval instead
+unsigned long sensorMinInterval = 1000; // Fastest adaptive interval (ms), used while readings change
+unsigned long sensorMaxInterval = 60000; // Slowest adaptive interval (ms), reached while readings are flat
+unsigned long sampleInterval = 5000;   // Interval until the next read (fixed or adaptive)
 long gmtOffset_sec = 0;
 uint8_t quietHourStart = 22; // 10 PM
 uint8_t quietHourEnd = 5;    // 5 AM
@@ -73,13 +123,15 @@ bool alarmEnabled = false;
 uint8_t alarmHour = 7;
 uint8_t alarmMinute = 30;
 bool alarmHasTriggeredToday = false;
+int16_t stationAltitudeM = 0; // Reduces the pressure to sea level for the forecast
+bool autoBrightness = true; // OLED contrast follows the room light, and the screen goes off in the dark
 
 // --- OBJECT INSTANCES ---
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET); // Uses default Wire (I2C0)
+// Uses default Wire (I2C0). The bus manager sets the clock per device, so the driver keeps OLED_I2C_CLOCK throughout.
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK, OLED_I2C_CLOCK);
 Adafruit_AHTX0 aht;
 Adafruit_BMP280 bmp; // I2C
 AsyncWebServer server(80);
-DNSServer dnsServer;
 Preferences preferences;
 
 // --- TIME CONFIGURATION ---
@@ -87,11 +139,10 @@ const char* ntpServer = "pool.ntp.org";
 const int   daylightOffset_sec = 3600;
 
 #if ENABLE_VOICE_RECOGNITION
-// --- PHASE 3: VOICE RECOGNITION HARDWARE (PLACEHOLDER) ---
-// #include <driver/i2s.h>
-// #define I2S_MIC_WS    1 // Example Pin
-// #define I2S_MIC_SD    2 // Example Pin
-// #define I2S_MIC_SCK   3 // Example Pin
+// --- PHASE 3: MICROPHONE HARDWARE (INMP441 on I2S) ---
+#define I2S_MIC_WS    1
+#define I2S_MIC_SD    2
+#define I2S_MIC_SCK   3
 #endif
 
 // --- STATE MANAGEMENT ---
@@ -113,15 +164,17 @@ unsigned long lastEyeMoveTime = 0;
 unsigned long lastParamShowTime = 0;
 unsigned long paramScreenStartTime = 0;
 bool isShowingParameters = false;
+bool eyesOnScreen = false; // False once another screen has drawn over the eyes
 const long EYE_MOVE_INTERVAL = 2000; // Move eyes every 2 seconds
+const uint16_t EYE_ANIM_FPS = 30;     // Frame budget of the eye animator
+const uint16_t EYE_LOOK_MS = 220;     // Duration of one pupil movement
 const long PARAM_SHOW_INTERVAL = 10000; // Show parameters every 10 seconds
 const long PARAM_DISPLAY_DURATION = 10000; // For 10 seconds
+const long PARAM_REDRAW_INTERVAL = 1000; // Refresh the parameter screen (clock, readings) once a second
+unsigned long lastParamDrawTime = 0;
 
 // --- NEW: Touch Gesture Detection Engine ---
-unsigned long touchStart = 0;
-unsigned long lastTap = 0;
-int tapCount = 0;
-bool touchActive = false;
+TouchGestureState touchGestures;
 
 // --- NEW: Alarm State Management ---
 bool alarmIsRinging = false;
@@ -135,32 +188,133 @@ bool findMeIsActive = false;
 unsigned long findMeStartTime = 0;
 unsigned long lastFindMeBeepTime = 0;
 
+// --- NEW: Deferred Commands ---
+const uint16_t RESTART_GRACE_MS = 2000; // Lets the response reach the browser before a restart
+bool rebootPending = false;
+unsigned long rebootAt = 0;
+unsigned int otaLoggedPercent = 0; // Last OTA progress step logged
+
 
 // Sensor Readings (Global for easy access)
 float tempC = 0.0;
 float humidity = 0.0;
 float pressure_hPa = 0.0;
+bool ahtReadOk = false; // Whether the last readSensors() got fresh values
+bool bmpReadOk = false;
+
+// --- I2C BUS DEVICES (ids from the bus manager) ---
+int8_t oledBus = -1;
+int8_t ahtBus = -1;
+int8_t bmpBus = -1;
+int8_t lightBus = -1;
+const uint32_t DISPLAY_BUS_TIMEOUT_MS = 50;  // A frame that can't get the bus by then is skipped
+const uint32_t SENSOR_BUS_TIMEOUT_MS = 500;
 
 // --- HISTORICAL DATA FOR CHARTING ---
-struct DataPoint {
-  unsigned long time;
+const int DATA_HISTORY_SIZE = 60; // Latest readings from the sample store shown in the chart
+struct HistoryPoint {
+  uint32_t seq;     // Sequence number in the sample store, see sample_store.h
+  int64_t epochMs;
   float temp;
   float humidity;
+  float lux; // NaN without a light reading
+};
+
+// --- NEW: Rolling Statistics ---
+EnvStats envStats; // Last hour / day / week of every reading, see env_stats.h
+EnvQuantiles envQuantiles; // Percentile sketches over the same windows, see env_quantiles.h
+const uint8_t QUANTILE_QUERY_MAX = 8; // Quantiles per /api/quantiles request
+
+// --- NEW: Pressure Trend & Forecast ---
+PressureTrend pressureTrend; // 3 h least-squares pressure tendency, see pressure_trend.h
+
+// --- NEW: Sensor Health ---
+AnomalyDetector sensorHealth; // Judges every reading before it is stored or acted on, see anomaly_detector.h
+
+// --- NEW: Ambient Light & Display Brightness ---
+Bh1750 lightSensor; // See bh1750.h
+bool lightPresent = false;
+const float LIGHT_DARK_LUX = 1.0;   // Below this the room counts as dark...
+const float LIGHT_WAKE_LUX = 5.0;   // ...until it is brighter than this again
+const unsigned long LIGHT_DARK_HOLD_MS = 30000; // Dark, and untouched, this long before the screen goes off
+const float LIGHT_SMOOTHING = 0.3;  // Weight of each reading in the smoothed log10(lux)
+const float LIGHT_FULL_LOG_LUX = 3.0; // Full contrast from 1000 lx
+const uint8_t CONTRAST_STEP = 12;   // Smallest contrast change sent to the panel
+const uint8_t CONTRAST_DEFAULT = 0xCF; // What the driver sets at begin()
+float smoothedLogLux = NAN;
+uint8_t oledContrast = CONTRAST_DEFAULT;
+unsigned long darkSince = 0; // millis() when the room went dark, 0 while it isn't
+bool darkBlanked = false;    // The screen is off because the room is dark
+
+// --- NEW: Sound Level ---
+// The capture task (mic_capture.h) fills a ring from I2S DMA; soundTask drains it into
+// the meter at a priority between the capture task and the web server, so a busy web
+// server delays the metering but never the capture.
+SoundMeter soundMeter; // See sound_level.h
+bool micPresent = false;
+const float MIC_CALIBRATION_DB = 0.0; // Added to every level; set from a calibrator or a reference meter
+const UBaseType_t SOUND_TASK_PRIORITY = 2;
+const uint16_t SOUND_TASK_STACK = 3072;
+volatile uint64_t soundProcessUs = 0; // Time spent metering since boot
+#if ENABLE_VOICE_RECOGNITION
+VoiceFrontend voiceFrontend; // See voice_frontend.h; fed the same samples by soundTask (12 KB)
+volatile uint64_t voiceProcessUs = 0; // Time spent on VAD and features since boot
+#endif
+
+// --- NEW: Binary API (CBOR) ---
+// Integer map keys of the CBOR forms of /data and /history; the schema is in the README
+enum DataKey : uint8_t {
+  DATA_TEMP_C = 1,
+  DATA_HUMIDITY,
+  DATA_PRESSURE,      // null when the BMP280 is missing
+  DATA_STATE,
+  DATA_UPTIME,
+  DATA_SAMPLED_AT,
+  DATA_HEAP_PERCENT,
+  DATA_HEAP_FRAG,
+  DATA_DEW_POINT,     // null while the temperature/humidity reading is invalid
+  DATA_ABS_HUMIDITY,
+  DATA_HEAT_INDEX,
+  DATA_PRESSURE_TREND,   // hPa per 3 h; this and the next three are null until 2 h of pressure readings
+  DATA_TENDENCY,
+  DATA_FORECAST,         // Zambretti letter
+  DATA_FORECAST_TEXT,
+  DATA_SENSOR_HEALTH,    // [temp, humidity, pressure] SensorCondition codes; pressure null without the BMP280
+  DATA_LUX,              // null without the BH1750
+  DATA_SOUND             // [la, laeq_1s, laeq_1min, lamax_1min, lzpeak_1s] dB SPL; null without the microphone
+};
+enum HistoryKey : uint8_t {
+  HISTORY_T0 = 1,     // Epoch ms of the first point
+  HISTORY_DT,         // Offset of each point from t0, ms (uint32 typed array)
+  HISTORY_TEMPS,      // float32 typed array
+  HISTORY_HUMS,       // float32 typed array
+  HISTORY_LUX,        // float32 typed array, NaN where there was no light reading
+  HISTORY_SEQS,       // Sequence number of each point (uint32 typed array)
+  HISTORY_SESSION,    // The rest as in the JSON: see handleHistory()
+  HISTORY_LAST,
+  HISTORY_MORE,
+  HISTORY_DROPPED,
+  HISTORY_RESET
 };
-const int DATA_HISTORY_SIZE = 60; // Store 60 points (e.g., 5 minutes of data at 5s intervals)
-DataPoint dataHistory[DATA_HISTORY_SIZE];
-int historyIndex = 0;
 
 // --- FUNCTION PROTOTYPES ---
 void loadConfig();
-void saveConfig(const String& ssid, const String& pass, const String& name);
-void saveSettings(float high, float low, bool buzzer, long tz, uint16_t sensInt, uint16_t timeout, uint8_t qStart, uint8_t qEnd, bool almEn, uint8_t almHr, uint8_t almMin);
+void saveConfig(const WifiConfig& cfg);
+void saveSettings(const SettingsValues& v);
+void runCommands();
+void scheduleReboot(unsigned long at);
+bool postCommand(AsyncWebServerRequest *request, const Command& cmd);
 void setupOTA();
 bool connectToWiFi();
 void startCaptivePortal();
 void handleRoot(AsyncWebServerRequest *request);
 void handleData(AsyncWebServerRequest *request);
 void handleHistory(AsyncWebServerRequest *request);
+void handleMetrics(AsyncWebServerRequest *request);
+void handleExport(AsyncWebServerRequest *request);
+void handleLogs(AsyncWebServerRequest *request);
+void handleLastCrash(AsyncWebServerRequest *request);
+void handleNetworks(AsyncWebServerRequest *request);
 void handleConfig(AsyncWebServerRequest *request);
 void handleSaveConfig(AsyncWebServerRequest *request);
 void handleSettings(AsyncWebServerRequest *request);
@@ -171,10 +325,29 @@ void handleUpdateUpload(AsyncWebServerRequest *request, String filename, size_t
 bool isQuietHours();
 void checkAlarm();
 void readSensors();
+void pollLightSensor();
+void updateDisplayBrightness(float lux);
+void soundTask(void*);
+bool flushDisplay();
+uint32_t nextLoopDeadline();
+void handleStats(AsyncWebServerRequest *request);
+void handleQuantiles(AsyncWebServerRequest *request);
+void handleSensorEvents(AsyncWebServerRequest *request);
+bool wantsCbor(AsyncWebServerRequest *request);
+void printDataJson(const SensorSnapshot& snap, Print& out);
+void printDataCbor(const SensorSnapshot& snap, Print& out);
+SampleResume latestHistory();
+uint8_t collectHistory(const SampleResume& range, HistoryPoint (&points)[DATA_HISTORY_SIZE]);
+void printHistoryJson(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+void printHistoryCbor(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out);
+int64_t epochMillis();
+void publishSnapshot(int64_t readEpochMs);
 
 // --- NEW: Core Interaction System Prototypes ---
 void drawParameterScreen();
+void drawForecastGlyph(int16_t x, int16_t y, ForecastOutlook outlook);
 void drawMochiFace(MochiState state, EyeDirection direction = EYES_CENTER);
+void drawEyesGfx(Adafruit_GFX& gfx, uint8_t state, uint8_t direction);
 String detectTouchGesture();
 void beep(int freq, int dur);
 void toneConfirm();
@@ -192,751 +365,13 @@ void updateDisplay(); // New function prototype for consolidated display logic
 #if DATA_COLLECTION_MODE == 0 // This wraps the main application logic
 
 // ------------------------------------
-// 1. EMBEDDED HTML/CSS/JS FOR CONFIGURATION PORTAL
-// ------------------------------------
-const char* CONFIG_HTML = R"raw(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>Smart-Nav-Mitra Configuration</title>
-    <style>
-        :root {
-            --primary: #FF69B4; /* Hot Pink (Mochi color) */
-            --secondary: #6A5ACD; /* Slate Blue */
-            --bg: #F0F4F8; /* Light Blue/Gray */
-            --card-bg: #FFFFFF;
-            --text-color: #333;
-        }
-        body {
-            font-family: Arial, sans-serif;
-            margin: 0;
-            padding: 20px;
-            background-color: var(--bg);
-            color: var(--text-color);
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            min-height: 100vh;
-        }
-        .container {
-            background: var(--card-bg);
-            padding: 30px;
-            border-radius: 16px;
-            box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1);
-            width: 100%;
-            max-width: 400px;
-        }
-        h1 {
-            color: var(--primary);
-            text-align: center;
-            margin-bottom: 20px;
-            font-size: 1.8em;
-        }
-        .mochi-face {
-            text-align: center;
-            font-size: 3rem;
-            margin-bottom: 20px;
-            animation: pulse 1.5s infinite;
-        }
-        @keyframes pulse {
-            0% { transform: scale(1); opacity: 0.8; }
-            50% { transform: scale(1.1); opacity: 1; }
-            100% { transform: scale(1); opacity: 0.8; }
-        }
-        label {
-            display: block;
-            margin-bottom: 8px;
-            font-weight: bold;
-            color: var(--secondary);
-        }
-        input[type="text"], input[type="password"] {
-            width: 100%;
-            padding: 12px;
-            margin-bottom: 15px;
-            border: 2px solid #ddd;
-            border-radius: 8px;
-            box-sizing: border-box;
-            transition: border-color 0.3s;
-        }
-        input[type="text"]:focus, input[type="password"]:focus {
-            border-color: var(--primary);
-            outline: none;
-        }
-        button {
-            width: 100%;
-            padding: 12px;
-            background-color: var(--primary);
-            color: white;
-            border: none;
-            border-radius: 8px;
-            font-size: 1.1em;
-            cursor: pointer;
-            transition: background-color 0.3s, transform 0.1s;
-        }
-        button:hover {
-            background-color: #E05AA0;
-        }
-        button:active {
-            transform: scale(0.99);
-        }
-        p.note {
-            margin-top: 20px;
-            font-size: 0.9em;
-            color: #666;
-            text-align: center;
-            border-top: 1px dashed #ddd;
-            padding-top: 10px;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Smart-Nav-Mitra Configuration Portal</h1>
-        <div class="mochi-face">🍥</div>
-        <form action="/saveconfig" method="post">
-            <label for="devicename">Device Name (mDNS: [name].local)</label>
-            <input type="text" id="devicename" name="devicename" value="%DEVICENAME%" required>
-
-            <label for="ssid">Wi-Fi SSID</label>
-            <input type="text" id="ssid" name="ssid" required>
-
-            <label for="password">Wi-Fi Password</label>
-            <input type="password" id="password" name="password">
-
-            <button type="submit">Connect & Save</button>
-        </form>
-        <p class="note">Once saved, Smart-Nav-Mitra will reboot and try to connect to your network.</p>
-    </div>
-</body>
-</html>
-)raw";
-
-// ------------------------------------
-// 2. EMBEDDED HTML/CSS/JS FOR MAIN DEVICE INTERFACE
-// ------------------------------------
-const char* MAIN_HTML = R"raw(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <script src="https://cdn.jsdelivr.net/npm/chart.js"></script>
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>%DEVICENAME% Interface</title>
-    <style>
-        :root {
-            --primary: #FF69B4; /* Hot Pink */
-            --secondary: #6A5ACD; /* Slate Blue */
-            --bg: #F0F4F8;
-            --card-bg: #FFFFFF;
-            --text-color: #333;
-            --success: #32CD32; /* Lime Green */
-            --danger: #FF4500; /* Orange Red */
-            --cold: #00BFFF; /* Deep Sky Blue */
-            --warning: #FFA500; /* Orange */
-        }
-        .top-right-info {
-            position: absolute;
-            top: 20px;
-            right: 20px;
-            text-align: right;
-            color: #555;
-        }
-        body {
-            font-family: 'Inter', sans-serif;
-            margin: 0;
-            padding: 20px;
-            background-color: var(--bg);
-            color: var(--text-color);
-            display: flex;
-            flex-direction: column;
-            align-items: center;
-            min-height: 100vh;
-        }
-        .header {
-            text-align: center;
-            margin-bottom: 30px;
-        }
-        h1 {
-            color: var(--primary);
-            font-size: 2.5em;
-            margin-bottom: 5px;
-        }
-        h2.device-name {
-            font-family: Verdana, sans-serif;
-            color: black;
-        }
-        .mochi-display {
-            display: flex;
-            flex-direction: column;
-            align-items: center;
-            margin-bottom: 40px;
-            padding: 20px;
-            background: var(--card-bg);
-            border-radius: 16px;
-            box-shadow: 0 8px 20px rgba(0, 0, 0, 0.1);
-            width: 100%;
-            max-width: 600px;
-            transition: background-color 0.5s;
-        }
-        .mochi-face {
-            font-size: 8rem;
-            animation: breathe 4s ease-in-out infinite;
-        }
-        @keyframes breathe {
-            0%, 100% { transform: scale(1); }
-            50% { transform: scale(1.05); }
-        }
-        .emotion-text {
-            font-size: 1.5em;
-            font-weight: bold;
-            margin-top: 10px;
-        }
-        .info-grid {
-            display: grid;
-            grid-template-columns: repeat(auto-fit, minmax(250px, 1fr));
-            gap: 20px;
-            width: 100%;
-            max-width: 1000px;
-        }
-        .card {
-            background: var(--card-bg);
-            padding: 20px;
-            border-radius: 12px;
-            box-shadow: 0 4px 15px rgba(0, 0, 0, 0.05);
-            transition: transform 0.2s;
-        }
-        .card:hover {
-            transform: translateY(-3px);
-        }
-        .card h2 {
-            margin-top: 0;
-            font-size: 1.3em;
-            color: var(--primary);
-            border-bottom: 2px solid var(--bg);
-            padding-bottom: 8px;
-            margin-bottom: 15px;
-        }
-        .card p {
-            margin: 5px 0;
-            line-height: 1.5;
-        }
-        .status-badge {
-            display: inline-block;
-            padding: 4px 10px;
-            border-radius: 6px;
-            font-size: 0.9em;
-            font-weight: bold;
-            margin-left: 10px;
-        }
-        .status-badge.online {
-            background-color: var(--success);
-            color: white;
-        }
-        .actions {
-            display: flex;
-            gap: 10px;
-            flex-wrap: wrap; /* Allow buttons to wrap on small screens */
-            margin-top: 20px;
-        }
-        .action-btn {
-            padding: 8px 16px;
-            border: none;
-            border-radius: 8px;
-            color: white;
-            font-weight: bold;
-            cursor: pointer;
-            transition: opacity 0.2s;
-        }
-        .action-btn:hover { opacity: 0.85; }
-        .btn-settings { background-color: var(--secondary); }
-        .btn-reboot { background-color: var(--warning); }
-        .btn-find { background-color: #1E90FF; } /* Dodger Blue */
-
-        @media (max-width: 650px) {
-            .info-grid {
-                grid-template-columns: 1fr;
-            }
-        }
-    </style>
-</head>
-<body>
-    <div class="header">
-        <h1>Hello.. %GREETING%</h1>
-        <h2 class="device-name">I'm %DEVICENAME%!</h2>
-        <p>Your friendly companion is online and connected.</p>
-    </div>
-    <div class="top-right-info">
-        <p id="live-datetime" style="margin:0; font-weight: bold;"></p>
-    </div>
-
-    <div id="mochi-display" class="mochi-display">
-        <div id="mochi-face" class="mochi-face">😊</div>
-        <div id="emotion-text" class="emotion-text" style="color: var(--secondary);">Happy and Ready!</div>
-    </div>
-
-    <div class="info-grid">
-        <!-- PARAMETER CARD 1: Sensor Data -->
-        <div class="card parameter-card">
-            <h2>Environment State</h2>
-            <p><strong>Temperature:</strong> <span id="temp">--.-</span> °C</p>
-            <p><strong>Humidity:</strong> <span id="humidity">%HUMIDITY%</span> %</p>
-            <p><strong>Pressure:</strong> <span id="pressure">%PRESSURE%</span> hPa</p>
-        </div>
-
-        <!-- PARAMETER CARD 2: System Status -->
-        <div class="card parameter-card">
-            <h2>System Health</h2>
-            <p><strong>Current State:</strong> <span id="current-state">%STATE%</span></p>
-            <p><strong>Uptime:</strong> <span id="uptime">Loading...</span></p>
-            <p><strong>Free Heap:</strong> <span id="heap">%FREE_HEAP%</span></p>
-            <div class="actions">
-                <button class="action-btn btn-settings" onclick="window.location.href='/settings'">Settings</button>
-                <button class="action-btn btn-reboot" onclick="rebootDevice()">Reboot</button>
-                <button class="action-btn btn-find" onclick="findMochi()">Find Me!</button>
-            </div>
-        </div>
-
-        <!-- INFO CARD 3: Network Information -->
-        <div class="card info-card">
-            <h2>Network Info <span class="status-badge online">Online</span></h2>
-            <p><strong>Local IP:</strong> <span id="ip">%LOCAL_IP%</span></p>
-            <p><strong>mDNS URL:</strong> http://%DEVICENAME%.local</p>
-            <p><strong>Wi-Fi SSID:</strong> %WIFI_SSID%</p>
-            <p><strong>Signal Strength:</strong> <span id="rssi">%RSSI%</span> dBm</p>
-        </div>
-
-        <!-- INFO CARD 4: Device Details -->
-        <div class="card info-card">
-            <h2>Device Info</h2>
-            <p><strong>Firmware Ver:</strong> 2.0.0</p>
-            <p><strong>Chip Model:</strong> ESP32</p>
-            <p><strong>MAC Address:</strong> %MAC_ADDRESS%</p>
-            <p><strong>Configured Name:</strong> %DEVICENAME%</p>
-        </div>
-    </div>
-    
-    <!-- CHART CARD -->
-    <div class="card" style="width: 100%; max-width: 1000px; margin-top: 20px;">
-        <h2>Live Environment Data</h2>
-        <canvas id="sensorChart"></canvas>
-        </div>
-
-    <script>
-        let sensorChart;
-
-        // Mapping MochiState enum to Strings for display
-        const stateMap = {
-            0: 'HAPPY',
-            1: 'ALERT_HIGH (Too Hot)',
-            2: 'ALERT_LOW (Too Cold)',
-            3: 'TOUCHED',
-            4: 'UPDATING (OTA)',
-        };
-
-        const dayNames = ["Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"];
-        const monthNames = ["January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"];
-
-        function getDayWithOrdinal(d) {
-            if (d > 3 && d < 21) return d + 'th';
-            switch (d % 10) {
-                case 1: return d + "st";
-                case 2: return d + "nd";
-                case 3: return d + "rd";
-                default: return d + "th";
-            }
-        }
-
-        // Function to update the live clock every second
-        function updateLiveClock() {
-            const now = new Date();
-
-            // Time part
-            const hours = String(now.getHours()).padStart(2, '0');
-            const minutes = String(now.getMinutes()).padStart(2, '0');
-            const seconds = String(now.getSeconds()).padStart(2, '0');
-            const timeString = `${hours}:${minutes}:${seconds}`;
-
-            // Date part
-            const dayOfWeek = dayNames[now.getDay()];
-            const dayOfMonth = getDayWithOrdinal(now.getDate());
-            const month = monthNames[now.getMonth()];
-            const year = now.getFullYear();
-            const dateString = `${dayOfWeek}, ${dayOfMonth} ${month} ${year}`;
-
-            const liveTimeElement = document.getElementById('live-datetime');
-            if (liveTimeElement) liveTimeElement.innerHTML = `${dateString}<br>${timeString}`;
-        }
-
-        // Function to fetch dynamic data and update the cards
-        function updateData() {
-            fetch('/data')
-                .then(response => response.json())
-                .then(data => {
-                    // Update Sensor Data
-                    document.getElementById('temp').innerText = data.tempC.toFixed(1);
-                    document.getElementById('humidity').innerText = data.humidity.toFixed(0);
-                    document.getElementById('pressure').innerText = data.pressure_hPa.toFixed(0);
-
-                    // Update System Data
-                    document.getElementById('current-state').innerText = stateMap[data.state];
-                    document.getElementById('uptime').innerText = formatUptime(data.uptime);
-                    document.getElementById('heap').innerText = data.heap_percent.toFixed(1) + ' %';
-
-                    // Update Chart
-                    updateChart(data.tempC, data.humidity);
-
-                    // Update Mochi Face and Display Color
-                    updateMochiFace(data.state, data.tempC);
-                })
-                .catch(error => console.error('Error fetching data:', error));
-        }
-
-        function updateMochiFace(state, temp) {
-            const faceElement = document.getElementById('mochi-face');
-            const emotionElement = document.getElementById('emotion-text');
-            const displayElement = document.getElementById('mochi-display');
-            let face, emotion, color, bgColor;
-
-            switch (state) {
-                case 1: // ALERT_HIGH
-                    face = '🥵';
-                    emotion = 'It\'s getting warm!';
-                    color = 'var(--danger)';
-                    bgColor = '#FFEDED';
-                    break;
-                case 2: // ALERT_LOW
-                    face = '🥶';
-                    emotion = 'A bit chilly!';
-                    color = 'var(--cold)';
-                    bgColor = '#EDF6FF';
-                    break;
-                case 3: // TOUCHED
-                    face = '😉';
-                    emotion = 'Thanks for the touch!';
-                    color = 'var(--primary)';
-                    bgColor = 'var(--card-bg)';
-                    break;
-                case 4: // UPDATING
-                    face = '🔄';
-                    emotion = 'Updating...';
-                    color = 'orange';
-                    bgColor = 'var(--card-bg)';
-                    break;
-                case 0: // HAPPY
-                default:
-                    face = '😊';
-                    emotion = 'Happy and Ready!';
-                    color = 'var(--secondary)';
-                    bgColor = 'var(--card-bg)';
-                    break;
-            }
-
-            faceElement.innerText = face;
-            emotionElement.innerText = emotion;
-            emotionElement.style.color = color;
-            displayElement.style.backgroundColor = bgColor;
-        }
-
-        // Helper function to format uptime from seconds
-        function formatUptime(ms) {
-            let totalSeconds = Math.floor(ms / 1000);
-            const hours = Math.floor(totalSeconds / 3600);
-            totalSeconds %= 3600;
-            const minutes = Math.floor(totalSeconds / 60);
-            const seconds = totalSeconds % 60;
-            return `${hours}h ${minutes}m ${seconds}s`;
-        }
-
-        function rebootDevice() {
-            if (confirm('Are you sure you want to reboot Mochi?')) {
-                fetch('/reboot', { method: 'POST' })
-                    .then(() => {
-                        alert('Reboot command sent. The device will now restart.');
-                        // Disable page interaction
-                        document.body.style.pointerEvents = 'none';
-                        document.body.style.opacity = '0.5';
-                    })
-                    .catch(error => console.error('Error sending reboot command:', error));
-            }
-        }
-
-        function findMochi() {
-            fetch('/find', { method: 'POST' })
-                .then(response => {
-                    if (!response.ok) alert('Failed to send Find Me command.');
-                })
-                .catch(error => console.error('Error sending find command:', error));
-        }
-
-        function initChart(history) {
-            const ctx = document.getElementById('sensorChart').getContext('2d');
-            sensorChart = new Chart(ctx, {
-                type: 'line',
-                data: {
-                    labels: history.labels,
-                    datasets: [{
-                        label: 'Temperature (°C)',
-                        data: history.temps,
-                        borderColor: 'rgba(255, 99, 132, 1)',
-                        backgroundColor: 'rgba(255, 99, 132, 0.2)',
-                        yAxisID: 'yTemp',
-                    }, {
-                        label: 'Humidity (%)',
-                        data: history.hums,
-                        borderColor: 'rgba(54, 162, 235, 1)',
-                        backgroundColor: 'rgba(54, 162, 235, 0.2)',
-                        yAxisID: 'yHum',
-                    }]
-                },
-                options: {
-                    scales: {
-                        yTemp: {
-                            type: 'linear',
-                            display: true,
-                            position: 'left',
-                            title: { display: true, text: 'Temperature (°C)' }
-                        },
-                        yHum: {
-                            type: 'linear',
-                            display: true,
-                            position: 'right',
-                            title: { display: true, text: 'Humidity (%)' },
-                            grid: { drawOnChartArea: false } // only draw grid for temp axis
-                        }
-                    }
-                }
-            });
-        }
-
-        function updateChart(temp, hum) {
-            if (!sensorChart) return;
-            const now = new Date();
-            const timeString = String(now.getHours()).padStart(2, '0') + ':' + String(now.getMinutes()).padStart(2, '0') + ':' + String(now.getSeconds()).padStart(2, '0');
-            sensorChart.data.labels.push(timeString);
-            sensorChart.data.datasets[0].data.push(temp);
-            sensorChart.data.datasets[1].data.push(hum);
-
-            // Limit data points
-            if (sensorChart.data.labels.length > 60) {
-                sensorChart.data.labels.shift();
-                sensorChart.data.datasets.forEach(dataset => dataset.data.shift());
-            }
-            sensorChart.update('none'); // 'none' for no animation
-        }
-
-        // Fetch historical data on page load to populate chart
-        fetch('/history')
-            .then(response => response.json())
-            .then(history => initChart(history))
-            .catch(error => console.error('Error fetching history:', error));
-
-        // Update data every 3 seconds
-        setInterval(updateData, %SENSOR_INTERVAL_MS%);
-        updateLiveClock(); // Call it once immediately on load
-        setInterval(updateLiveClock, 1000);
-    </script>
-</body>
-</html>
-)raw";
-
-// ------------------------------------
-// 3. FIRMWARE LOGIC (Implementation)
-// ------------------------------------
-
-const char* SETTINGS_HTML = R"raw(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>Mochi Settings</title>
-    <style>
-        :root {
-            --primary: #FF69B4;
-            --secondary: #6A5ACD;
-            --bg: #F0F4F8;
-            --card-bg: #FFFFFF;
-            --text-color: #333;
-        }
-        body { font-family: Arial, sans-serif; margin: 0; padding: 20px; background-color: var(--bg); color: var(--text-color); display: flex; justify-content: center; align-items: center; min-height: 100vh; }
-        .container { background: var(--card-bg); padding: 30px; border-radius: 16px; box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1); width: 100%; max-width: 400px; }
-        h1 { color: var(--primary); text-align: center; margin-bottom: 20px; }
-        label { display: block; margin: 15px 0 8px; font-weight: bold; color: var(--secondary); }
-        input[type="number"], select { width: 100%; padding: 12px; border: 2px solid #ddd; border-radius: 8px; box-sizing: border-box; background-color: white; }
-        input[type="number"]:focus, select:focus { border-color: var(--primary); outline: none; }
-        .checkbox-group { display: flex; align-items: center; gap: 10px; margin-top: 20px; }
-        input[type="range"] { width: 100%; }
-        button { width: 100%; padding: 12px; margin-top: 20px; background-color: var(--primary); color: white; border: none; border-radius: 8px; font-size: 1.1em; cursor: pointer; }
-        button:hover { background-color: #E05AA0; }
-        .note { margin-top: 20px; font-size: 0.9em; color: #666; text-align: center; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Mochi Settings</h1>
-        <form action="/save-settings" method="post">
-            <label for="temp_high">High Temperature Alert (°C)</label>
-            <input type="number" id="temp_high" name="temp_high" step="0.1" value="%TEMP_HIGH%" required>
-
-            <label for="temp_low">Low Temperature Alert (°C)</label>
-            <input type="number" id="temp_low" name="temp_low" step="0.1" value="%TEMP_LOW%" required>
-
-            <label for="timezone">Time Zone</label>
-            <select id="timezone" name="timezone">
-                <option value="-43200">UTC-12:00</option>
-                <option value="-39600">UTC-11:00</option>
-                <option value="-36000">UTC-10:00 (HST)</option>
-                <option value="-32400">UTC-09:00 (AKST)</option>
-                <option value="-28800">UTC-08:00 (PST)</option>
-                <option value="-25200">UTC-07:00 (MST)</option>
-                <option value="-21600">UTC-06:00 (CST)</option>
-                <option value="-18000">UTC-05:00 (EST)</option>
-                <option value="-14400">UTC-04:00 (AST)</option>
-                <option value="-10800">UTC-03:00</option>
-                <option value="-7200">UTC-02:00</option>
-                <option value="-3600">UTC-01:00</option>
-                <option value="0">UTC±00:00 (GMT)</option>
-                <option value="3600">UTC+01:00 (CET)</option>
-                <option value="7200">UTC+02:00 (EET)</option>
-                <option value="10800">UTC+03:00 (MSK)</option>
-                <option value="14400">UTC+04:00</option>
-                <option value="18000">UTC+05:00</option>
-                <option value="19800">UTC+05:30 (IST)</option>
-                <option value="21600">UTC+06:00</option>
-                <option value="25200">UTC+07:00</option>
-                <option value="28800">UTC+08:00 (CST)</option>
-                <option value="32400">UTC+09:00 (JST)</option>
-                <option value="34200">UTC+09:30</option>
-                <option value="36000">UTC+10:00 (AEST)</option>
-                <option value="39600">UTC+11:00</option>
-                <option value="43200">UTC+12:00</option>
-            </select>
-
-            <label for="sensor_interval">Sensor Read Interval (seconds, min 5)</label>
-            <input type="number" id="sensor_interval" name="sensor_interval" min="5" value="%SENSOR_INTERVAL%">
-
-            <label for="oled_timeout">OLED Timeout (minutes, 0=always on)</label>
-            <input type="number" id="oled_timeout" name="oled_timeout" min="0" value="%OLED_TO%">
-
-            <hr style="margin: 20px 0; border: 1px dashed #ddd;">
-
-            <label for="quiet_start">Quiet Hours Start (0-23)</label>
-            <input type="number" id="quiet_start" name="quiet_start" min="0" max="23" value="%QUIET_START%">
-            <label for="quiet_end">Quiet Hours End (0-23)</label>
-            <input type="number" id="quiet_end" name="quiet_end" min="0" max="23" value="%QUIET_END%">
-
-            <label for="alarm_hr">Alarm Time (Hour, 0-23)</label>
-            <input type="number" id="alarm_hr" name="alarm_hr" min="0" max="23" value="%ALARM_HR%">
-            <label for="alarm_min">Alarm Time (Minute, 0-59)</label>
-            <input type="number" id="alarm_min" name="alarm_min" min="0" max="59" value="%ALARM_MIN%">
-
-            <div class="checkbox-group">
-                <input type="checkbox" id="buzzer" name="buzzer" %BUZZER_CHECKED%>
-                <label for="buzzer">Enable Buzzer</label>
-            </div>
-
-            <div class="checkbox-group" style="margin-top: 10px;">
-                <input type="checkbox" id="alarm_en" name="alarm_en" %ALARM_CHECKED%>
-                <label for="alarm_en">Enable Wake-up Alarm</label>
-            </div>
-
-            <button type="submit">Save & Reboot</button>
-        </form>
-
-        <a href="/update" style="display: block; text-align: center; margin-top: 20px;">Update Firmware</a>
-
-        <p class="note">Smart-Nav-Mitra will reboot to apply the new settings.</p>
-    </div>
-</body>
-</html>
-)raw";
-
-// ------------------------------------
-// 4. EMBEDDED HTML FOR FIRMWARE UPDATE PAGE
+// 1. WEB PAGES
 // ------------------------------------
-const char* UPDATE_HTML = R"raw(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>Firmware Update</title>
-    <style>
-        :root { --primary: #6A5ACD; --bg: #F0F4F8; --card-bg: #FFFFFF; --text-color: #333; }
-        body { font-family: Arial, sans-serif; margin: 0; padding: 20px; background-color: var(--bg); color: var(--text-color); display: flex; justify-content: center; align-items: center; min-height: 100vh; }
-        .container { background: var(--card-bg); padding: 30px; border-radius: 16px; box-shadow: 0 10px 30px rgba(0, 0, 0, 0.1); width: 100%; max-width: 500px; text-align: center; }
-        h1 { color: var(--primary); }
-        form { margin-top: 20px; }
-        input[type="file"] { border: 2px dashed #ddd; padding: 20px; border-radius: 8px; width: 100%; box-sizing: border-box; }
-        button { width: 100%; padding: 12px; margin-top: 20px; background-color: var(--primary); color: white; border: none; border-radius: 8px; font-size: 1.1em; cursor: pointer; }
-        button:hover { background-color: #5949B2; }
-        .progress-bar { width: 100%; background-color: #ddd; border-radius: 4px; margin-top: 20px; display: none; }
-        .progress { width: 0%; height: 20px; background-color: var(--primary); border-radius: 4px; text-align: center; color: white; line-height: 20px; }
-        #status { margin-top: 10px; font-weight: bold; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Firmware Update</h1>
-        <p>Select a .bin file to upload and update the device.</p>
-        <form id="upload_form" method="POST" action="/update" enctype="multipart/form-data">
-            <input type="file" name="update" id="file" accept=".bin" required>
-            <button type="submit">Update Firmware</button>
-        </form>
-        <div class="progress-bar" id="progress_bar">
-            <div class="progress" id="progress">0%</div>
-        </div>
-        <div id="status"></div>
-    </div>
-    <script>
-        const form = document.getElementById('upload_form');
-        const progressBar = document.getElementById('progress_bar');
-        const progress = document.getElementById('progress');
-        const status = document.getElementById('status');
-
-        form.addEventListener('submit', function(e) {
-            e.preventDefault();
-            const fileInput = document.getElementById('file');
-            const file = fileInput.files[0];
-            if (!file) {
-                status.textContent = 'Please select a file.';
-                return;
-            }
-
-            const xhr = new XMLHttpRequest();
-            xhr.open('POST', '/update', true);
-
-            xhr.upload.addEventListener('progress', function(e) {
-                if (e.lengthComputable) {
-                    const percentComplete = (e.loaded / e.total) * 100;
-                    progressBar.style.display = 'block';
-                    progress.style.width = percentComplete.toFixed(2) + '%';
-                    progress.textContent = percentComplete.toFixed(2) + '%';
-                }
-            });
-
-            xhr.onload = function() {
-                if (xhr.status === 200) {
-                    status.textContent = 'Update successful! Rebooting...';
-                    setTimeout(() => window.location.href = '/', 5000); // Redirect to home page after 5s
-                } else {
-                    status.textContent = 'Update failed! ' + xhr.responseText;
-                }
-            };
-
-            const formData = new FormData();
-            formData.append('update', file);
-            xhr.send(formData);
-        });
-    </script>
-</body>
-</html>
-)raw";
+// The configuration portal, main interface, settings and firmware update pages live in
+// web/ and are compiled into web_pages.h by tools/gen_web_pages.py.
 
 // ------------------------------------
-// 4. FIRMWARE LOGIC (Implementation)
+// 2. FIRMWARE LOGIC (Implementation)
 // ------------------------------------
 
 // Load configuration from NVS
@@ -954,6 +389,9 @@ void loadConfig() {
   buzzerEnabled = preferences.getBool(KEY_BUZZER_EN, true);
   gmtOffset_sec = preferences.getLong(KEY_TZ_OFFSET, 0);
   sensorInterval = preferences.getUShort(KEY_SENSOR_INT, 5) * 1000; // Get seconds, convert to ms
+  sensorAdaptive = preferences.getBool(KEY_SENSOR_ADAPT, true);
+  sensorMinInterval = preferences.getUShort(KEY_SENSOR_MIN, 1) * 1000;
+  sensorMaxInterval = preferences.getUShort(KEY_SENSOR_MAX, 60) * 1000;
   oledTimeoutMins = preferences.getUShort(KEY_OLED_TO, 10);
   // Load quiet hours and alarm settings
   quietHourStart = preferences.getUChar(KEY_QUIET_START, 22);
@@ -961,66 +399,123 @@ void loadConfig() {
   alarmEnabled = preferences.getBool(KEY_ALARM_EN, false);
   alarmHour = preferences.getUChar(KEY_ALARM_HR, 7);
   alarmMinute = preferences.getUChar(KEY_ALARM_MIN, 30);
+  stationAltitudeM = preferences.getShort(KEY_ALTITUDE, 0);
+  autoBrightness = preferences.getBool(KEY_AUTO_BRIGHT, true);
 
   preferences.end();
 }
 
 // Save new configuration to NVS
-void saveConfig(const String& ssid, const String& pass, const String& name) {
+// The device name arrives already sanitized for mDNS (see handleSaveConfig)
+void saveConfig(const WifiConfig& cfg) {
   preferences.begin(PREFS_NAMESPACE, false); // Read/Write
 
-  preferences.putString(KEY_SSID, ssid);
-  preferences.putString(KEY_PASS, pass);
-  String sanitizedName = name;
-  sanitizedName.replace(" ", "-"); // Sanitize for mDNS
-  preferences.putString(KEY_DEV_NAME, sanitizedName);
+  preferences.putString(KEY_SSID, cfg.ssid);
+  preferences.putString(KEY_PASS, cfg.pass);
+  preferences.putString(KEY_DEV_NAME, cfg.name);
 
   preferences.end();
-  deviceName = sanitizedName; // Update in memory
+  deviceName = cfg.name; // Update in memory
 }
 
 // Save new settings to NVS
-void saveSettings(float high, float low, bool buzzer, long tz, uint16_t sensInt, uint16_t timeout, uint8_t qStart, uint8_t qEnd, bool almEn, uint8_t almHr, uint8_t almMin) {
+void saveSettings(const SettingsValues& v) {
   preferences.begin(PREFS_NAMESPACE, false); // Read/Write
-  preferences.putFloat(KEY_TEMP_HIGH, high);
-  preferences.putFloat(KEY_TEMP_LOW, low);
-  preferences.putBool(KEY_BUZZER_EN, buzzer);
-  preferences.putLong(KEY_TZ_OFFSET, tz);
-  preferences.putUShort(KEY_SENSOR_INT, sensInt);
-  preferences.putUShort(KEY_OLED_TO, timeout);
-  preferences.putUChar(KEY_QUIET_START, qStart);
-  preferences.putUChar(KEY_QUIET_END, qEnd);
-  preferences.putBool(KEY_ALARM_EN, almEn);
-  preferences.putUChar(KEY_ALARM_HR, almHr);
-  preferences.putUChar(KEY_ALARM_MIN, almMin);
+  preferences.putFloat(KEY_TEMP_HIGH, v.tempHigh);
+  preferences.putFloat(KEY_TEMP_LOW, v.tempLow);
+  preferences.putBool(KEY_BUZZER_EN, v.buzzer);
+  preferences.putLong(KEY_TZ_OFFSET, v.tzOffset);
+  preferences.putUShort(KEY_SENSOR_INT, v.sensorInterval);
+  preferences.putUShort(KEY_OLED_TO, v.oledTimeout);
+  preferences.putUChar(KEY_QUIET_START, v.quietStart);
+  preferences.putUChar(KEY_QUIET_END, v.quietEnd);
+  preferences.putBool(KEY_ALARM_EN, v.alarmEnabled);
+  preferences.putUChar(KEY_ALARM_HR, v.alarmHour);
+  preferences.putUChar(KEY_ALARM_MIN, v.alarmMinute);
+  preferences.putBool(KEY_SENSOR_ADAPT, v.sensorAdaptive);
+  preferences.putUShort(KEY_SENSOR_MIN, v.sensorMin);
+  preferences.putUShort(KEY_SENSOR_MAX, v.sensorMax);
+  preferences.putShort(KEY_ALTITUDE, v.altitude);
+  preferences.putBool(KEY_AUTO_BRIGHT, v.autoBrightness);
   preferences.end();
 }
 
+// Runs the commands the web handlers queued (see command_queue.h). Called from loop() only.
+void runCommands() {
+  Command cmd;
+  while (commandQueueTake(cmd)) {
+    switch (cmd.type) {
+      case CMD_REBOOT:
+        scheduleReboot(cmd.postedAt + cmd.rebootDelayMs);
+        break;
+      case CMD_SAVE_WIFI:
+        saveConfig(cmd.wifi);
+        logWrite(LOG_MSG_CONFIG_SAVED);
+        scheduleReboot(cmd.postedAt + RESTART_GRACE_MS);
+        break;
+      case CMD_APPLY_SETTINGS:
+        saveSettings(cmd.settings);
+        logWrite(LOG_MSG_SETTINGS_SAVED);
+        scheduleReboot(cmd.postedAt + RESTART_GRACE_MS);
+        break;
+      case CMD_FIND_ME:
+        playFindMyMochi();
+        break;
+    }
+  }
+  if (rebootPending && (long)(millis() - rebootAt) >= 0) {
+    logFlush(); // The last words before the restart
+    traceRecord(TRACE_RESTART, TRACE_RESTART_COMMAND);
+    ESP.restart();
+  }
+}
+
+// Restart at millis() time `at`, or earlier if a restart is already due before then
+void scheduleReboot(unsigned long at) {
+  if (!rebootPending || (long)(at - rebootAt) < 0) rebootAt = at;
+  rebootPending = true;
+}
+
+// Hands cmd to loop(); answers 503 and returns false if the queue is full
+bool postCommand(AsyncWebServerRequest *request, const Command& cmd) {
+  if (!commandQueuePost(cmd)) {
+    httpSendStatic(request, 503, "text/plain", "Busy, please try again.");
+    return false;
+  }
+  powerWake(); // Run it now rather than at the loop's next deadline
+  return true;
+}
+
 // Setup the Captive Portal AP and DNS
 void startCaptivePortal() {
-  Serial.println("Starting Captive Portal...");
+  logWrite(LOG_MSG_PORTAL_STARTING);
 
   WiFi.mode(WIFI_AP);
   WiFi.softAPConfig(AP_IP, AP_IP, NET_MASK);
   WiFi.softAP(AP_SSID, AP_PASS);
 
-  Serial.printf("AP IP: %s\n", WiFi.softAPIP().toString().c_str());
-  Serial.printf("AP Name: %s\n", AP_SSID);
+  logWrite(LOG_MSG_PORTAL_AP, AP_SSID, WiFi.softAPIP().toString());
 
   // DNS Server Setup (Redirect all requests to AP_IP)
-  dnsServer.start(53, "*", AP_IP);
+  const uint8_t apAddress[4] = {AP_IP[0], AP_IP[1], AP_IP[2], AP_IP[3]};
+  if (!captiveDnsBegin(apAddress)) logWrite(LOG_MSG_PORTAL_DNS_FAILED);
+  // Nearby networks for the config page, ready before anyone opens it
+  wifiScanBegin();
 
   // Web Server Setup
   server.onNotFound([](AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_NOT_FOUND);
     // Necessary for Captive Portal: redirect all traffic to /config
     request->redirect("/config");
   });
 
   server.on("/config", HTTP_GET, handleConfig);
   server.on("/saveconfig", HTTP_POST, handleSaveConfig);
+  server.on("/networks", HTTP_GET, handleNetworks); // Cached Wi-Fi scan as JSON
 
   server.begin();
-  Serial.println("HTTP and DNS Server started.");
+  logWrite(LOG_MSG_PORTAL_READY);
+  portalActive = true;
   
   // Show SETUP state on OLED during configuration
   currentState = SETUP; 
@@ -1029,7 +524,7 @@ void startCaptivePortal() {
 
 // Try to connect to saved Wi-Fi credentials
 bool connectToWiFi() {
-  Serial.printf("Connecting to Wi-Fi: %s\n", staSsid.c_str());
+  logWrite(LOG_MSG_WIFI_CONNECTING, staSsid);
   
   WiFi.mode(WIFI_STA);
   WiFi.begin(staSsid.c_str(), staPass.c_str());
@@ -1037,19 +532,16 @@ bool connectToWiFi() {
   unsigned long startTime = millis();
   while (WiFi.status() != WL_CONNECTED && millis() - startTime < 15000) { // 15s timeout
     delay(500);
-    Serial.print(".");
   }
-  Serial.println();
 
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("Wi-Fi connected successfully!");
-    Serial.printf("IP Address: %s\n", WiFi.localIP().toString().c_str());
+    logWrite(LOG_MSG_WIFI_CONNECTED, millis() - startTime, WiFi.localIP().toString());
 
     // Initialize mDNS with the saved device name
     if (!MDNS.begin(deviceName.c_str())) {
-      Serial.println("Error starting mDNS");
+      logWrite(LOG_MSG_MDNS_FAILED);
     } else {
-      Serial.printf("mDNS responder started at: http://%s.local\n", deviceName.c_str());
+      logWrite(LOG_MSG_MDNS_STARTED, deviceName);
       MDNS.addService("http", "tcp", 80);
     }
 
@@ -1057,6 +549,13 @@ bool connectToWiFi() {
     server.on("/", HTTP_GET, handleRoot);
     server.on("/data", HTTP_GET, handleData); // API endpoint for JS updates
     server.on("/history", HTTP_GET, handleHistory); // API for chart data
+    server.on("/stats", HTTP_GET, handleStats); // Hour / day / week statistics
+    server.on("/api/quantiles", HTTP_GET, handleQuantiles); // Percentiles over the same windows
+    server.on("/api/sensor-events", HTTP_GET, handleSensorEvents); // Sensor health and recent faults
+    server.on("/metrics", HTTP_GET, handleMetrics); // Runtime performance counters
+    server.on("/export", HTTP_GET, handleExport); // Full sample history as CSV / NDJSON
+    server.on("/logs", HTTP_GET, handleLogs); // Recent log entries as NDJSON
+    server.on("/debug/lastcrash", HTTP_GET, handleLastCrash); // What ran before the last reset
     server.on("/settings", HTTP_GET, handleSettings);
     server.on("/save-settings", HTTP_POST, handleSaveSettings);
     server.on("/reboot", HTTP_POST, handleReboot);
@@ -1068,189 +567,814 @@ bool connectToWiFi() {
     // Resume HAPPY state after connection
     currentState = HAPPY;
     setupOTA();
+    powerEnableModemSleep(); // Stay associated while the radio dozes between DTIM beacons
     return true;
   } else {
-    Serial.println("Wi-Fi connection failed or timed out.");
+    logWrite(LOG_MSG_WIFI_FAILED);
     return false;
   }
 }
 
-// Handler for the main operational web page (Mochi Interface)
-void handleRoot(AsyncWebServerRequest *request) {
-  readSensors(); // Get fresh data for initial page load
-  
-  String html = MAIN_HTML;
-
-  // Create dynamic greeting
-  String greeting = "";
-  struct tm timeinfo;
-  if(getLocalTime(&timeinfo)){
-    int hour = timeinfo.tm_hour;
-    if (hour >= 0 && hour < 12) { // From midnight (12 AM) to 11:59 AM
-      greeting = "Good morning.";
-    } else if (hour >= 12 && hour < 18) { // From noon (12 PM) to 5:59 PM
-      greeting = "Good afternoon.";
-    } else {
-      greeting = "Good evening.";
+// Values for the placeholders in web/index.html, printed while the page streams out
+void mainPagePlaceholder(uint8_t placeholder, Print& out) {
+  switch (placeholder) {
+    case PH_DEVICENAME:
+      out.print(deviceName);
+      break;
+    case PH_GREETING: {
+      // Create dynamic greeting
+      struct tm timeinfo;
+      if (getLocalTime(&timeinfo, 0)) {
+        int hour = timeinfo.tm_hour;
+        if (hour >= 0 && hour < 12) { // From midnight (12 AM) to 11:59 AM
+          out.print("Good morning.");
+        } else if (hour >= 12 && hour < 18) { // From noon (12 PM) to 5:59 PM
+          out.print("Good afternoon.");
+        } else {
+          out.print("Good evening.");
+        }
+      }
+      break;
     }
+    case PH_LOCAL_IP:
+      out.print(WiFi.localIP());
+      break;
+    case PH_WIFI_SSID:
+      out.print(WiFi.SSID());
+      break;
+    case PH_RSSI:
+      out.print(WiFi.RSSI());
+      break;
+    case PH_MAC_ADDRESS:
+      out.print(WiFi.macAddress());
+      break;
+    case PH_FREE_HEAP: {
+      float heapPercent = ((float)ESP.getFreeHeap() / (float)ESP.getHeapSize()) * 100.0;
+      out.printf("%.1f %%", heapPercent);
+      break;
+    }
+    case PH_SENSOR_INTERVAL_MS:
+      out.print(sensorAdaptive ? max(sensorMinInterval, 2000UL) : sensorInterval);
+      break;
+    case PH_HUMIDITY:
+      out.print(sensorSnapshotRead().humidity, 0);
+      break;
+    case PH_PRESSURE: {
+      float pressure = sensorSnapshotRead().pressureHpa;
+      if (pressure < 0) out.print("N/A");
+      else out.print((int)pressure);
+      break;
+    }
+    case PH_STATE:
+      // State to string (for the System Health card)
+      switch (sensorSnapshotRead().state) {
+          case HAPPY: out.print("Happy/Monitoring"); break;
+          case ALERT_HIGH: out.print("Alert: High Temp"); break;
+          case ALERT_LOW: out.print("Alert: Low Temp"); break;
+          case TOUCHED: out.print("Touched"); break;
+          case UPDATING: out.print("OTA Updating"); break;
+          default: out.print("Unknown");
+      }
+      break;
   }
+}
 
-  // Server-Side Placeholder Replacement for the first load
-  html.replace("%DEVICENAME%", deviceName);
-  html.replace("%GREETING%", greeting);
-  html.replace("%LOCAL_IP%", WiFi.localIP().toString()); 
-  html.replace("%WIFI_SSID%", WiFi.SSID());
-  html.replace("%RSSI%", String(WiFi.RSSI()));
-  html.replace("%MAC_ADDRESS%", WiFi.macAddress());  
-  float heapPercent = ((float)ESP.getFreeHeap() / (float)ESP.getHeapSize()) * 100.0;
-  html.replace("%FREE_HEAP%", String(heapPercent, 1) + " %");
-  html.replace("%SENSOR_INTERVAL_MS%", String(sensorInterval));
-  
-  // Replace sensor/state data
-  html.replace("%TEMP_C%", String(tempC, 1));
-  html.replace("%HUMIDITY%", String(humidity, 0));
-  html.replace("%PRESSURE%", (pressure_hPa < 0) ? "N/A" : String((int)pressure_hPa));
-  
-  // State to string (for the System Health card)
-  String stateStr;
-  switch (currentState) {
-      case HAPPY: stateStr = "Happy/Monitoring"; break;
-      case ALERT_HIGH: stateStr = "Alert: High Temp"; break;
-      case ALERT_LOW: stateStr = "Alert: Low Temp"; break;
-      case TOUCHED: stateStr = "Touched"; break;
-      case UPDATING: stateStr = "OTA Updating"; break;
-      default: stateStr = "Unknown";
-  }
-  html.replace("%STATE%", stateStr);
-
-  request->send(200, "text/html", html);
+// Handler for the main operational web page (Mochi Interface)
+void handleRoot(AsyncWebServerRequest *request) {
+  traceRecord(TRACE_HANDLER, TRACE_H_ROOT);
+  // Streamed from flash; placeholders are filled in as the page goes out, with the
+  // readings from the main loop's latest snapshot (no sensor access from this task)
+  httpSendPage(request, "text/html", MAIN_PAGE, mainPagePlaceholder);
 }
 
 // API endpoint to return JSON for dynamic JS updates
+// Content negotiation for /data and /history: CBOR when the client accepts it, else JSON
+bool wantsCbor(AsyncWebServerRequest *request) {
+    AsyncWebHeader* accept = request->getHeader("Accept");
+    return accept && accept->value().indexOf("application/cbor") >= 0;
+}
+
 void handleData(AsyncWebServerRequest *request) {
-    // Read sensors just before sending the response
-    // No need to call readSensors() here if the main loop does it periodically.
-    StaticJsonDocument<256> doc;
+    traceRecord(TRACE_HANDLER, TRACE_H_DATA);
+    // The latest reading published by the main loop; this runs on the AsyncTCP task
+    SensorSnapshot snap = sensorSnapshotRead();
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    if (wantsCbor(request)) {
+      printDataCbor(snap, *body);
+      httpSend(request, 200, "application/cbor", body);
+    } else {
+      printDataJson(snap, *body);
+      httpSend(request, 200, "application/json", body);
+    }
+}
+
+void printDataJson(const SensorSnapshot& snap, Print& out) {
+    StaticJsonDocument<768> doc;
 
-    doc["tempC"] = tempC;
-    doc["humidity"] = humidity;
-    if (pressure_hPa < 0) {
+    doc["tempC"] = snap.tempC;
+    doc["humidity"] = snap.humidity;
+    if (snap.pressureHpa < 0) {
       doc["pressure_hPa"] = "N/A";
     } else {
-      doc["pressure_hPa"] = (int)pressure_hPa;
+      doc["pressure_hPa"] = (int)snap.pressureHpa;
     }
-    doc["state"] = currentState;
+    doc["state"] = snap.state;
     doc["uptime"] = millis();
+    // Readings taken before NTP sync are placed relative to the current time
+    doc["sampled_at"] = snap.epochMs ? snap.epochMs : epochMillis() - (int64_t)(millis() - snap.sampledAt);
     
     float heapPercent = ((float)ESP.getFreeHeap() / (float)ESP.getHeapSize()) * 100.0;
     doc["heap_percent"] = heapPercent;
+    doc["heap_frag"] = heapMonitorGetStats().fragmentation * 100.0;
+    if (snap.tempOk) {
+      doc["dew_point"] = envDewPoint(snap.tempC, snap.humidity);
+      doc["abs_humidity"] = envAbsoluteHumidity(snap.tempC, snap.humidity);
+      doc["heat_index"] = envHeatIndex(snap.tempC, snap.humidity);
+    }
+    if (snap.forecast.valid) {
+      doc["pressure_trend"] = snap.forecast.changePer3h;
+      doc["pressure_tendency"] = pressureTendencyName(snap.forecast.tendency);
+      char letter[2] = {snap.forecast.letter, 0};
+      doc["forecast"] = letter; // Not const, so it is copied into the document
+      doc["forecast_text"] = zambrettiText(snap.forecast.letter);
+    }
+    JsonObject health = doc.createNestedObject("sensor_health");
+    for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) {
+      if (c == ANOMALY_PRESSURE && snap.pressureHpa < 0) continue; // No BMP280
+      health[anomalyChannelName((AnomalyChannel)c)] = sensorConditionName(snap.conditions[c]);
+    }
+    if (!isnan(snap.lux)) doc["lux"] = snap.lux;
+    // Sound levels move faster than the sensor readings, so they are read live
+    SoundLevels sound = soundMeterLevels(soundMeter);
+    if (micPresent && sound.valid) {
+      JsonObject s = doc.createNestedObject("sound");
+      s["la"] = sound.la;
+      s["laeq_1s"] = sound.laeq1s;
+      s["laeq_1min"] = sound.laeq1min;
+      s["lamax_1min"] = sound.lamax1min;
+      s["lzpeak_1s"] = sound.lzpeak1s;
+    }
+
+    serializeJson(doc, out);
+}
 
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    request->send(200, "application/json", jsonResponse);
+// Same fields as printDataJson() under DataKey integer keys
+void printDataCbor(const SensorSnapshot& snap, Print& out) {
+    cborMap(out, 18);
+    cborUint(out, DATA_TEMP_C);
+    cborFloat(out, snap.tempC);
+    cborUint(out, DATA_HUMIDITY);
+    cborFloat(out, snap.humidity);
+    cborUint(out, DATA_PRESSURE);
+    if (snap.pressureHpa < 0) cborNull(out);
+    else cborUint(out, (uint32_t)snap.pressureHpa);
+    cborUint(out, DATA_STATE);
+    cborUint(out, snap.state);
+    cborUint(out, DATA_UPTIME);
+    cborUint(out, millis());
+    cborUint(out, DATA_SAMPLED_AT);
+    cborInt(out, snap.epochMs ? snap.epochMs : epochMillis() - (int64_t)(millis() - snap.sampledAt));
+    cborUint(out, DATA_HEAP_PERCENT);
+    cborFloat(out, ((float)ESP.getFreeHeap() / (float)ESP.getHeapSize()) * 100.0);
+    cborUint(out, DATA_HEAP_FRAG);
+    cborFloat(out, heapMonitorGetStats().fragmentation * 100.0);
+    cborUint(out, DATA_DEW_POINT);
+    if (snap.tempOk) cborFloat(out, envDewPoint(snap.tempC, snap.humidity));
+    else cborNull(out);
+    cborUint(out, DATA_ABS_HUMIDITY);
+    if (snap.tempOk) cborFloat(out, envAbsoluteHumidity(snap.tempC, snap.humidity));
+    else cborNull(out);
+    cborUint(out, DATA_HEAT_INDEX);
+    if (snap.tempOk) cborFloat(out, envHeatIndex(snap.tempC, snap.humidity));
+    else cborNull(out);
+    const PressureForecast& f = snap.forecast;
+    char letter[2] = {f.letter, 0};
+    cborUint(out, DATA_PRESSURE_TREND);
+    if (f.valid) cborFloat(out, f.changePer3h);
+    else cborNull(out);
+    cborUint(out, DATA_TENDENCY);
+    if (f.valid) cborText(out, pressureTendencyName(f.tendency));
+    else cborNull(out);
+    cborUint(out, DATA_FORECAST);
+    if (f.valid) cborText(out, letter);
+    else cborNull(out);
+    cborUint(out, DATA_FORECAST_TEXT);
+    if (f.valid) cborText(out, zambrettiText(f.letter));
+    else cborNull(out);
+    cborUint(out, DATA_SENSOR_HEALTH);
+    cborArray(out, ANOMALY_CHANNELS);
+    for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) {
+      if (c == ANOMALY_PRESSURE && snap.pressureHpa < 0) cborNull(out);
+      else cborUint(out, snap.conditions[c]);
+    }
+    cborUint(out, DATA_LUX);
+    if (!isnan(snap.lux)) cborFloat(out, snap.lux);
+    else cborNull(out);
+    SoundLevels sound = soundMeterLevels(soundMeter);
+    cborUint(out, DATA_SOUND);
+    if (micPresent && sound.valid) {
+      cborArray(out, 5);
+      cborFloat(out, sound.la);
+      cborFloat(out, sound.laeq1s);
+      cborFloat(out, sound.laeq1min);
+      cborFloat(out, sound.lamax1min);
+      cborFloat(out, sound.lzpeak1s);
+    } else {
+      cborNull(out);
+    }
 }
 
 // Buffer for strftime in handleHistory to avoid stack allocation in loop
 char strftime_buf[64];
 
 // API endpoint to return historical data for chart
+// /history: the latest DATA_HISTORY_SIZE readings. /history?after=seq&session=id: the
+// readings stored after sequence number seq, oldest first, DATA_HISTORY_SIZE at a time.
+// Besides the series, the answer has "session" and "last", the values to send as
+// session and after next time; "more" when there are readings beyond this page;
+// "dropped", readings overwritten before the client asked; and "reset" when the device
+// restarted since (the page then starts from its oldest reading). Readings that failed
+// the sanity checks have a sequence number but no point.
 void handleHistory(AsyncWebServerRequest *request) {
-    StaticJsonDocument<2048> doc; // Larger doc for history
+    traceRecord(TRACE_HANDLER, TRACE_H_HISTORY);
+    SampleResume range;
+    if (request->hasParam("after")) {
+        uint32_t after = strtoul(request->getParam("after")->value().c_str(), nullptr, 10);
+        uint32_t session = request->hasParam("session") ? strtoul(request->getParam("session")->value().c_str(), nullptr, 10) : 0;
+        range = sampleStoreResume(session, after, DATA_HISTORY_SIZE);
+    } else {
+        range = latestHistory();
+    }
+    HistoryPoint points[DATA_HISTORY_SIZE];
+    uint8_t count = collectHistory(range, points);
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    if (wantsCbor(request)) {
+      printHistoryCbor(range, points, count, *body);
+      httpSend(request, 200, "application/cbor", body);
+    } else {
+      printHistoryJson(range, points, count, *body);
+      httpSend(request, 200, "application/json", body);
+    }
+}
+
+// The latest DATA_HISTORY_SIZE readings
+SampleResume latestHistory() {
+    uint32_t end = sampleStoreEnd();
+    return sampleStoreResume(0, end > DATA_HISTORY_SIZE ? end - DATA_HISTORY_SIZE : 0, DATA_HISTORY_SIZE);
+}
+
+// The valid readings in range, oldest first. Each record is copied out of the store
+// under its lock, so the main loop can keep adding samples meanwhile.
+uint8_t collectHistory(const SampleResume& range, HistoryPoint (&points)[DATA_HISTORY_SIZE]) {
+    uint8_t count = 0;
+    for (uint32_t i = range.from; i < range.end && count < DATA_HISTORY_SIZE; i++) {
+        StoredSample s;
+        if (!sampleStoreGet(i, s) || !(s.flags & SAMPLE_TEMP_OK) || (s.flags & SAMPLE_TEMP_SUSPECT)) continue;
+        HistoryPoint& p = points[count++];
+        p.seq = sampleSeq(i);
+        // Readings taken before NTP sync are placed relative to the current time
+        p.epochMs = s.epochS ? (int64_t)s.epochS * 1000 : epochMillis() - (int64_t)(millis() - s.uptimeMs);
+        p.temp = s.tempCenti / 100.0;
+        p.humidity = s.humidityCenti / 100.0;
+        p.lux = (s.flags & SAMPLE_LIGHT_OK) ? s.luxCenti / 100.0 : NAN;
+    }
+    return count;
+}
+
+// A stored reading as the double it stands for (the store keeps 0.01 steps), so
+// ArduinoJson prints "21.37" rather than the float's nine digits "21.3700008"
+static double historyValue(float v) {
+    return round(v * 100.0) / 100.0;
+}
+
+// At most about 3.8 KB, with 10-digit sequence numbers and lux in sunlight: it has to
+// fit in one pool slot (HTTP_SLOT_SIZE)
+void printHistoryJson(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out) {
+    // Six arrays of DATA_HISTORY_SIZE values plus the labels' text; static rather than
+    // on the stack, as the handlers all run on the one AsyncTCP task
+    static StaticJsonDocument<7168> doc;
+    doc.clear();
+    doc["session"] = sampleStoreSession();
+    doc["last"] = range.end; // Sequence number of the last reading of the page (index end - 1)
+    doc["more"] = range.more;
+    doc["dropped"] = range.dropped;
+    doc["reset"] = range.reset;
+    JsonArray seqs = doc.createNestedArray("seqs");
     JsonArray labels = doc.createNestedArray("labels");
+    JsonArray times = doc.createNestedArray("times"); // Epoch ms of each reading; the spacing varies
     JsonArray temps = doc.createNestedArray("temps");
     JsonArray hums = doc.createNestedArray("hums");
-    
-    for (int i = 0; i < DATA_HISTORY_SIZE; i++) {
-        if (dataHistory[i].time > 0) { // Only add valid points
-            // Convert the millis timestamp to a readable time string
-            unsigned long now_ms = millis();
-            unsigned long point_ms = dataHistory[i].time;
-            time_t point_time = time(nullptr) - ((now_ms - point_ms) / 1000);
-            strftime(strftime_buf, sizeof(strftime_buf), "%H:%M:%S", localtime(&point_time));
-            labels.add(strftime_buf);
-            temps.add(dataHistory[i].temp);
-            hums.add(dataHistory[i].humidity);
+    JsonArray lux = doc.createNestedArray("lux"); // NaN is written as null
+
+    for (uint8_t i = 0; i < count; i++) {
+        time_t point_time = (time_t)(points[i].epochMs / 1000);
+        strftime(strftime_buf, sizeof(strftime_buf), "%H:%M:%S", localtime(&point_time));
+        labels.add(strftime_buf);
+        seqs.add(points[i].seq);
+        times.add(points[i].epochMs);
+        temps.add(historyValue(points[i].temp));
+        hums.add(historyValue(points[i].humidity));
+        lux.add(historyValue(points[i].lux));
+    }
+
+    serializeJson(doc, out);
+}
+
+// Times as one base plus packed offsets and the readings as packed float32 arrays; the
+// client formats the labels itself
+void printHistoryCbor(const SampleResume& range, const HistoryPoint* points, uint8_t count, Print& out) {
+    uint32_t seqs[DATA_HISTORY_SIZE];
+    uint32_t dt[DATA_HISTORY_SIZE];
+    float temps[DATA_HISTORY_SIZE];
+    float hums[DATA_HISTORY_SIZE];
+    float lux[DATA_HISTORY_SIZE];
+    int64_t t0 = count ? points[0].epochMs : 0;
+    for (uint8_t i = 0; i < count; i++) {
+        seqs[i] = points[i].seq;
+        dt[i] = (uint32_t)(points[i].epochMs - t0);
+        temps[i] = points[i].temp;
+        hums[i] = points[i].humidity;
+        lux[i] = points[i].lux;
+    }
+
+    cborMap(out, 11);
+    cborUint(out, HISTORY_T0);
+    cborInt(out, t0);
+    cborUint(out, HISTORY_DT);
+    cborUint32Array(out, dt, count);
+    cborUint(out, HISTORY_TEMPS);
+    cborFloat32Array(out, temps, count);
+    cborUint(out, HISTORY_HUMS);
+    cborFloat32Array(out, hums, count);
+    cborUint(out, HISTORY_LUX);
+    cborFloat32Array(out, lux, count);
+    cborUint(out, HISTORY_SEQS);
+    cborUint32Array(out, seqs, count);
+    cborUint(out, HISTORY_SESSION);
+    cborUint(out, sampleStoreSession());
+    cborUint(out, HISTORY_LAST);
+    cborUint(out, range.end);
+    cborUint(out, HISTORY_MORE);
+    cborBool(out, range.more);
+    cborUint(out, HISTORY_DROPPED);
+    cborUint(out, range.dropped);
+    cborUint(out, HISTORY_RESET);
+    cborBool(out, range.reset);
+}
+
+// Bulk export of the stored samples: /export?format=csv|ndjson&from=&to= (epoch seconds).
+// Streamed a batch of lines at a time, so the size of the export doesn't matter.
+void handleExport(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_EXPORT);
+    ExportFormat format = EXPORT_CSV;
+    if (request->hasParam("format")) {
+        const String& f = request->getParam("format")->value();
+        if (f == "ndjson") format = EXPORT_NDJSON;
+        else if (f != "csv") {
+            httpSendStatic(request, 400, "text/plain", "Bad Request: format must be csv or ndjson.");
+            return;
         }
     }
+    uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : 0;
+    uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10) : 0;
+
+    uint32_t state[HTTP_STREAM_STATE_WORDS];
+    exportBegin(state, format, from, to);
+    httpSendStream(request, exportContentType(format), exportNext, state);
+}
+
+// Recent log entries: /logs?since=seq&level=debug|info|warn|error, as NDJSON lines of
+// {"seq","ms","level","msg"} after seq `since` (default 0, everything still in the ring).
+// A gap in seq means entries were overwritten before this request got to them.
+void handleLogs(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_LOGS);
+    uint32_t since = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), nullptr, 10) : 0;
+    LogLevel level = LOG_LEVEL_DEBUG;
+    if (request->hasParam("level") && !logParseLevel(request->getParam("level")->value().c_str(), level)) {
+        httpSendStatic(request, 400, "text/plain", "Bad Request: level must be debug, info, warn or error.");
+        return;
+    }
 
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    request->send(200, "application/json", jsonResponse);
+    uint32_t state[HTTP_STREAM_STATE_WORDS];
+    logStreamBegin(state, since, level);
+    httpSendStream(request, "application/x-ndjson", logStreamNext, state);
+}
+
+// What the firmware was doing before the last reset, from the trace kept in RTC memory
+// (crash_trace.h): the reset reason and the previous run's last events, oldest first.
+// After a power-on there is no trace, only the reason.
+void handleLastCrash(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_LASTCRASH);
+    uint32_t state[HTTP_STREAM_STATE_WORDS];
+    crashReportBegin(state);
+    httpSendStream(request, "application/json", crashReportNext, state);
+}
+
+// API endpoint for the hour / day / week statistics and comfort metrics
+void handleStats(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_STATS);
+    static StaticJsonDocument<2048> doc;
+    doc.clear();
+    uint32_t nowS = millis() / 1000;
+    JsonObject windows = doc.createNestedObject("windows");
+    for (uint8_t w = 0; w < ENV_WINDOWS; w++) {
+      JsonObject win = windows.createNestedObject(envWindowName((EnvWindow)w));
+      for (uint8_t c = 0; c < ENV_CHANNELS; c++) {
+        EnvSummary sum = envStatsGet(envStats, (EnvWindow)w, (EnvChannel)c, nowS);
+        JsonObject o = win.createNestedObject(envChannelName((EnvChannel)c));
+        o["count"] = sum.count;
+        if (!sum.count) continue;
+        o["min"] = sum.min;
+        o["max"] = sum.max;
+        o["mean"] = sum.mean;
+        o["stddev"] = sum.stddev;
+      }
+    }
+    EnvComfort comfort = envStatsComfort(envStats);
+    JsonObject cf = doc.createNestedObject("comfort");
+    cf["dew_point"] = comfort.dewPointC;
+    cf["abs_humidity"] = comfort.absHumidity;
+    cf["heat_index"] = comfort.heatIndexC;
+
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    serializeJson(doc, *body);
+    httpSend(request, 200, "application/json", body);
+}
+
+// Condition and fault counts of each channel, and the latest faults, oldest first
+void handleSensorEvents(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_SENSOR_EVENTS);
+    static StaticJsonDocument<2048> doc;
+    doc.clear();
+    JsonObject channels = doc.createNestedObject("channels");
+    for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) {
+      JsonObject ch = channels.createNestedObject(anomalyChannelName((AnomalyChannel)c));
+      ch["condition"] = sensorConditionName(anomalyCondition(sensorHealth, (AnomalyChannel)c));
+      JsonObject counts = ch.createNestedObject("events");
+      for (uint8_t t = 0; t < SENSOR_CONDITIONS; t++) {
+        counts[t == SENSOR_OK ? "recovered" : sensorConditionName((SensorCondition)t)] =
+            anomalyEventCount(sensorHealth, (AnomalyChannel)c, (SensorCondition)t);
+      }
+    }
+    JsonArray events = doc.createNestedArray("events");
+    for (uint32_t i = anomalyEventFirst(sensorHealth); i < anomalyEventEnd(sensorHealth); i++) {
+      AnomalyEvent e;
+      if (!anomalyEventGet(sensorHealth, i, e)) continue;
+      JsonObject o = events.createNestedObject();
+      o["at"] = epochMillis() - (int64_t)(millis() - e.atMs); // Estimated before NTP sync
+      o["channel"] = anomalyChannelName(e.channel);
+      o["type"] = e.type == SENSOR_OK ? "recovered" : sensorConditionName(e.type);
+      o["value"] = e.value;
+    }
+
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    serializeJson(doc, *body);
+    httpSend(request, 200, "application/json", body);
+}
+
+// /api/quantiles?channel=temp|humidity|pressure&window=1h|24h|7d&q=0.5,0.95 (q defaults to 0.5)
+void handleQuantiles(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_QUANTILES);
+    static const String empty;
+    const String& channelName = request->hasParam("channel") ? request->getParam("channel")->value() : empty;
+    const String& windowName = request->hasParam("window") ? request->getParam("window")->value() : empty;
+    int channel = -1, window = -1;
+    for (uint8_t c = 0; c < EQ_CHANNELS; c++) {
+      if (channelName == envChannelName((EnvChannel)c)) channel = c;
+    }
+    for (uint8_t w = 0; w < ENV_WINDOWS; w++) {
+      if (windowName == envWindowName((EnvWindow)w)) window = w;
+    }
+    if (channel < 0 || window < 0) {
+      httpSendStatic(request, 400, "text/plain", "Bad Request: channel must be temp, humidity or pressure and window 1h, 24h or 7d.");
+      return;
+    }
+
+    double qs[QUANTILE_QUERY_MAX];
+    uint8_t count = 0;
+    const char* p = request->hasParam("q") ? request->getParam("q")->value().c_str() : "0.5";
+    while (*p) {
+      char* end;
+      double q = strtod(p, &end);
+      if (end == p || q < 0 || q > 1 || count == QUANTILE_QUERY_MAX || (*end && *end != ',')) {
+        httpSendStatic(request, 400, "text/plain", "Bad Request: q must be up to 8 comma-separated values between 0 and 1.");
+        return;
+      }
+      qs[count++] = q;
+      p = *end ? end + 1 : end;
+    }
+
+    QuantileSketch sketch;
+    envQuantilesSketch(envQuantiles, (EnvWindow)window, (EnvChannel)channel, millis() / 1000, sketch);
+
+    StaticJsonDocument<512> doc;
+    doc["channel"] = envChannelName((EnvChannel)channel);
+    doc["window"] = envWindowName((EnvWindow)window);
+    doc["count"] = (uint32_t)sketch.total;
+    JsonArray results = doc.createNestedArray("quantiles");
+    for (uint8_t i = 0; i < count; i++) {
+      JsonObject r = results.createNestedObject();
+      r["q"] = qs[i];
+      r["value"] = qsketchQuantile(sketch, qs[i]); // null while the window is empty
+    }
+
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    serializeJson(doc, *body);
+    httpSend(request, 200, "application/json", body);
+}
+
+// API endpoint for runtime performance counters
+void handleMetrics(AsyncWebServerRequest *request) {
+    traceRecord(TRACE_HANDLER, TRACE_H_METRICS);
+    // Static rather than on the stack: handlers all run on the one AsyncTCP task
+    static StaticJsonDocument<3072> doc;
+    doc.clear();
+    doc["uptime"] = millis();
+
+    const EyeAnimStats& anim = eyeAnimGetStats();
+    JsonObject a = doc.createNestedObject("anim");
+    a["fps_target"] = anim.targetFps;
+    a["fps"] = anim.fps;
+    a["frames"] = anim.framesRendered;
+    a["dropped"] = anim.framesDropped;
+    a["render_us_avg"] = anim.renderUsAvg;
+    a["render_us_max"] = anim.renderUsMax;
+    a["flush_us_avg"] = anim.flushUsAvg;
+    a["flush_us_max"] = anim.flushUsMax;
+
+    const I2cBusStats& bus = i2cBusGetStats();
+    JsonObject b = doc.createNestedObject("i2c");
+    b["utilization"] = bus.utilization;
+    b["transactions"] = bus.transactions;
+    b["errors"] = bus.errors;
+    b["timeouts"] = bus.timeouts;
+    b["rejected"] = bus.rejected;
+    b["clock_switches"] = bus.clockSwitches;
+    b["stuck"] = bus.stuckEvents;
+    b["recoveries"] = bus.recoveries;
+    b["recovery_failures"] = bus.recoveryFailures;
+    b["wait_us_max"] = bus.waitUsMax;
+    b["queue_max"] = bus.queueDepthMax;
+    JsonArray devs = b.createNestedArray("devices");
+    for (uint8_t i = 0; i < i2cBusDeviceCount(); i++) {
+      const I2cDeviceStats& d = i2cBusGetDeviceStats(i);
+      JsonObject o = devs.createNestedObject();
+      o["name"] = d.name;
+      o["clock"] = d.clockHz;
+      o["transactions"] = d.transactions;
+      o["errors"] = d.errors;
+      o["busy_ms"] = d.busyMs;
+    }
+
+    JsonObject l = doc.createNestedObject("light");
+    l["present"] = lightPresent;
+    if (lightPresent) {
+      l["lux"] = bh1750Lux(lightSensor);
+      l["range"] = bh1750RangeName(lightSensor.range);
+      l["readings"] = lightSensor.readings;
+      l["failures"] = lightSensor.failures;
+      l["range_changes"] = lightSensor.rangeChanges;
+    }
+    l["auto_brightness"] = autoBrightness;
+    l["contrast"] = oledContrast;
+    l["dark"] = darkSince != 0;
+
+    JsonObject snd = doc.createNestedObject("sound");
+    snd["present"] = micPresent;
+    if (micPresent) {
+      MicStats mic = micStats();
+      SoundLevels sound = soundMeterLevels(soundMeter);
+      snd["samples"] = mic.samples;
+      snd["dma_overruns"] = mic.dmaOverruns;
+      snd["ring_dropped"] = mic.ringDropped;
+      snd["ring_fill_max"] = mic.maxFill;
+      snd["ring_size"] = MIC_RING_SAMPLES;
+      snd["seconds"] = sound.seconds;
+      // Share of the CPU the metering takes
+      snd["cpu"] = sound.seconds ? soundProcessUs / (sound.seconds * 1e6) : 0;
+
+#if ENABLE_VOICE_RECOGNITION
+      VoiceStats voice = voiceFrontendStats(voiceFrontend);
+      JsonObject vo = snd.createNestedObject("voice");
+      vo["speech"] = voice.speech;
+      vo["utterances"] = voice.utterances;
+      vo["frames"] = voice.frames;
+      vo["speech_frames"] = voice.speechFrames;
+      vo["energy_dbfs"] = voice.energyDbfs;
+      vo["noise_floor_dbfs"] = voice.noiseFloorDbfs;
+      float usPerFrame = voice.frames ? (float)voiceProcessUs / voice.frames : 0;
+      vo["us_per_frame"] = usPerFrame;
+      vo["cycles_per_frame"] = (uint32_t)(usPerFrame * getCpuFrequencyMhz());
+      vo["cpu"] = usPerFrame * SOUND_SAMPLE_RATE / (VOICE_HOP_SAMPLES * 1e6);
+      vo["memory_bytes"] = sizeof(voiceFrontend);
+#endif
+    }
+
+    const SamplerStats& smp = samplerGetStats();
+    JsonObject sm = doc.createNestedObject("sampler");
+    sm["adaptive"] = sensorAdaptive;
+    sm["interval_ms"] = sampleInterval;
+    sm["activity"] = smp.activity;
+    sm["samples"] = smp.samples;
+    sm["fast_samples"] = smp.fastSamples;
+    sm["skipped_reads"] = smp.skippedReads;
+    sm["snapshot_version"] = sensorSnapshotRead().version;
+    sm["snapshot_retries"] = sensorSnapshotRetries();
+
+    const PowerStats& pwr = powerGetStats();
+    JsonObject p = doc.createNestedObject("power");
+    p["duty_cycle"] = pwr.dutyCycle;
+    p["sleep_fraction"] = pwr.sleepFraction;
+    p["avg_ma"] = pwr.avgCurrentMa;
+    p["used_mah"] = pwr.usedMah;
+    p["active_ms"] = pwr.activeMs;
+    p["idle_ms"] = pwr.idleMs;
+    p["sleep_ms"] = pwr.sleepMs;
+    p["auto_light_sleep"] = pwr.autoLightSleep;
+
+    const TouchGestureStats& tg = touchGestureStats(touchGestures);
+    JsonObject tch = doc.createNestedObject("touch");
+    for (uint8_t g = TOUCH_GESTURE_SINGLE_TAP; g < TOUCH_GESTURE_COUNT; g++) tch[touchGestureName((TouchGesture)g)] = tg.gestures[g];
+    tch["none"] = tg.gestures[TOUCH_GESTURE_NONE];
+    tch["classify_cycles"] = tg.lastCycles;
+    tch["classify_cycles_max"] = tg.maxCycles;
+    tch["model_depth"] = touchGestureModelDepth();
+
+    HeapStats heap = heapMonitorGetStats();
+    JsonObject h = doc.createNestedObject("heap");
+    h["total"] = heap.totalBytes;
+    h["free"] = heap.freeBytes;
+    h["min_free"] = heap.minFreeBytes;
+    h["largest_block"] = heap.largestBlock;
+    h["fragmentation"] = heap.fragmentation;
+    h["alloc_blocks"] = heap.allocatedBlocks;
+    h["free_blocks"] = heap.freeBlocks;
+    h["trend_interval_ms"] = HEAP_TREND_INTERVAL_MS;
+    JsonArray trendFree = h.createNestedArray("trend_free");
+    JsonArray trendLargest = h.createNestedArray("trend_largest");
+    JsonArray trendAllocs = h.createNestedArray("trend_alloc_blocks");
+    for (uint8_t i = 0; i < heap.trendCount; i++) {
+      trendFree.add(heap.trend[i].freeBytes);
+      trendLargest.add(heap.trend[i].largestBlock);
+      trendAllocs.add(heap.trend[i].allocatedBlocks);
+    }
+
+    HttpPoolStats pool = httpGetStats();
+    JsonObject hp = doc.createNestedObject("http");
+    hp["responses"] = pool.responses;
+    hp["slots"] = pool.slots;
+    hp["in_use"] = pool.inUse;
+    hp["in_use_max"] = pool.inUseMax;
+    hp["exhausted"] = pool.exhausted;
+    hp["overflows"] = pool.overflows;
+    hp["largest_body"] = pool.largestBody;
+
+    const CommandQueueStats& cq = commandQueueGetStats();
+    JsonObject c = doc.createNestedObject("commands");
+    c["depth"] = cq.depth;
+    c["depth_max"] = cq.depthMax;
+    c["capacity"] = COMMAND_QUEUE_DEPTH;
+    c["posted"] = cq.posted;
+    c["executed"] = cq.executed;
+    c["rejected"] = cq.rejected;
+    c["wait_ms_last"] = cq.waitMsLast;
+    c["wait_ms_max"] = cq.waitMsMax;
+    c["wait_ms_avg"] = cq.waitMsAvg;
+
+    LogStats ls = logStats();
+    JsonObject lg = doc.createNestedObject("log");
+    lg["written"] = ls.written;
+    lg["printed"] = ls.printed;
+    lg["lost"] = ls.lost;
+    lg["capacity"] = LOG_RING_ENTRIES;
+
+    HttpBuffer* body = httpBegin(request);
+    if (!body) return;
+    serializeJson(doc, *body);
+    httpSend(request, 200, "application/json", body);
 }
 
 // Handler for the configuration page (Captive Portal)
+void configPagePlaceholder(uint8_t placeholder, Print& out) {
+  if (placeholder == PH_DEVICENAME) out.print(deviceName);
+  else if (placeholder == PH_NETWORKS) wifiScanPrintJson(out); // The page lists them without a request
+}
+
 void handleConfig(AsyncWebServerRequest *request) {
-  String html = CONFIG_HTML;
-  html.replace("%DEVICENAME%", deviceName);
-  request->send(200, "text/html", html);
+  traceRecord(TRACE_HANDLER, TRACE_H_CONFIG);
+  httpSendPage(request, "text/html", CONFIG_PAGE, configPagePlaceholder);
+}
+
+// Networks found by the last background scan, strongest first; see wifi_scan.h
+void handleNetworks(AsyncWebServerRequest *request) {
+  traceRecord(TRACE_HANDLER, TRACE_H_NETWORKS);
+  HttpBuffer* body = httpBegin(request);
+  if (!body) return;
+  wifiScanPrintJson(*body);
+  httpSend(request, 200, "application/json", body);
 }
 
 // Handler for saving configuration data
 void handleSaveConfig(AsyncWebServerRequest *request) {
-  String newSsid, newPass, newDeviceName;
-
-  if (request->hasParam("ssid", true)) {
-    newSsid = request->getParam("ssid", true)->value();
+  traceRecord(TRACE_HANDLER, TRACE_H_SAVE_CONFIG);
+  static const String empty;
+  // References into the request's own parameters: no copies
+  const String& newSsid = request->hasParam("ssid", true) ? request->getParam("ssid", true)->value() : empty;
+  const String& newPass = request->hasParam("password", true) ? request->getParam("password", true)->value() : empty;
+  const String& newDeviceName = request->hasParam("devicename", true) ? request->getParam("devicename", true)->value() : empty;
+
+  Command cmd;
+  cmd.type = CMD_SAVE_WIFI;
+  if (newSsid.length() >= sizeof(cmd.wifi.ssid) || newPass.length() >= sizeof(cmd.wifi.pass) ||
+      newDeviceName.length() >= sizeof(cmd.wifi.name)) {
+    httpSendStatic(request, 400, "text/plain", "Bad Request: SSID, password or device name too long.");
+    return;
   }
-  if (request->hasParam("password", true)) {
-    newPass = request->getParam("password", true)->value();
+  strcpy(cmd.wifi.ssid, newSsid.c_str());
+  strcpy(cmd.wifi.pass, newPass.c_str());
+  strcpy(cmd.wifi.name, newDeviceName.c_str());
+  for (char* c = cmd.wifi.name; *c; c++) {
+    if (*c == ' ') *c = '-'; // Sanitize for mDNS
   }
-  if (request->hasParam("devicename", true)) {
-    newDeviceName = request->getParam("devicename", true)->value();
+  // Saved and followed by a restart from loop()
+  if (!postCommand(request, cmd)) return;
+
+  HttpBuffer* body = httpBegin(request);
+  if (body) {
+    body->printf("<h1>Configuration Saved!</h1><p>Smart-Nav-Mitra is rebooting and attempting to connect to <strong>%s</strong>.</p>"
+                 "<p>Please wait 10 seconds and try accessing it at <strong>http://%s.local</strong></p>",
+                 cmd.wifi.ssid, cmd.wifi.name);
+    httpSend(request, 200, "text/html", body);
   }
-
-  saveConfig(newSsid, newPass, newDeviceName);
-
-      // Send success message and reboot command
-      request->send(200, "text/html", "<h1>Configuration Saved!</h1><p>Smart-Nav-Mitra is rebooting and attempting to connect to <strong>" + newSsid + "</strong>.</p><p>Please wait 10 seconds and try accessing it at <strong>http://" + newDeviceName + ".local</strong></p>");
-
-  Serial.println("Configuration saved. Rebooting...");
-  delay(2000);
-  ESP.restart();
 }
 
 // Handler for the settings page
+void settingsPagePlaceholder(uint8_t placeholder, Print& out) {
+  switch (placeholder) {
+    case PH_TEMP_HIGH: out.print(tempAlertHigh); break;
+    case PH_TEMP_LOW: out.print(tempAlertLow); break;
+    case PH_BUZZER_CHECKED: out.print(buzzerEnabled ? "checked" : ""); break;
+    case PH_SENSOR_INTERVAL: out.print(sensorInterval / 1000); break; // Convert ms to s for display
+    case PH_SENSOR_ADAPT_CHECKED: out.print(sensorAdaptive ? "checked" : ""); break;
+    case PH_SENSOR_MIN: out.print(sensorMinInterval / 1000); break;
+    case PH_SENSOR_MAX: out.print(sensorMaxInterval / 1000); break;
+    case PH_OLED_TO: out.print(oledTimeoutMins); break;
+    case PH_QUIET_START: out.print(quietHourStart); break;
+    case PH_QUIET_END: out.print(quietHourEnd); break;
+    case PH_ALARM_CHECKED: out.print(alarmEnabled ? "checked" : ""); break;
+    case PH_ALARM_HR: out.print(alarmHour); break;
+    case PH_ALARM_MIN: out.print(alarmMinute); break;
+    case PH_TZ_OFFSET: out.print(gmtOffset_sec); break;
+    case PH_ALTITUDE: out.print(stationAltitudeM); break;
+    case PH_AUTO_BRIGHT_CHECKED: out.print(autoBrightness ? "checked" : ""); break;
+  }
+}
+
 void handleSettings(AsyncWebServerRequest *request) {
-  String html = SETTINGS_HTML;
-  html.replace("%TEMP_HIGH%", String(tempAlertHigh));
-  html.replace("%TEMP_LOW%", String(tempAlertLow));
-  html.replace("%BUZZER_CHECKED%", buzzerEnabled ? "checked" : "");
-  html.replace("%SENSOR_INTERVAL%", String(sensorInterval / 1000)); // Convert ms to s for display
-  html.replace("%OLED_TO%", String(oledTimeoutMins));
-  html.replace("%QUIET_START%", String(quietHourStart));
-  html.replace("%QUIET_END%", String(quietHourEnd));
-  html.replace("%ALARM_CHECKED%", alarmEnabled ? "checked" : "");
-  html.replace("%ALARM_HR%", String(alarmHour));
-  html.replace("%ALARM_MIN%", String(alarmMinute));
-  // This JS snippet will select the correct timezone in the dropdown
-  String js = "<script>document.getElementById('timezone').value = '" + String(gmtOffset_sec) + "';</script>";
-  html += js;
-  request->send(200, "text/html", html);
+  traceRecord(TRACE_HANDLER, TRACE_H_SETTINGS);
+  httpSendPage(request, "text/html", SETTINGS_PAGE, settingsPagePlaceholder);
 }
 
 // Handler for saving settings
 void handleSaveSettings(AsyncWebServerRequest *request) {
+  traceRecord(TRACE_HANDLER, TRACE_H_SAVE_SETTINGS);
   if (request->hasParam("temp_high", true) && request->hasParam("temp_low", true) && request->hasParam("timezone", true) && request->hasParam("sensor_interval", true) && request->hasParam("oled_timeout", true) &&
       request->hasParam("quiet_start", true) && request->hasParam("quiet_end", true) && request->hasParam("alarm_hr", true) && request->hasParam("alarm_min", true)) {
 
-    float high = request->getParam("temp_high", true)->value().toFloat();
-    float low = request->getParam("temp_low", true)->value().toFloat();
-    bool buzzer = request->hasParam("buzzer", true);
-    long tz = request->getParam("timezone", true)->value().toInt();
-    uint16_t sensInt = request->getParam("sensor_interval", true)->value().toInt();
-    uint16_t timeout = request->getParam("oled_timeout", true)->value().toInt();
-    uint8_t qStart = request->getParam("quiet_start", true)->value().toInt();
-    uint8_t qEnd = request->getParam("quiet_end", true)->value().toInt();
-    bool almEn = request->hasParam("alarm_en", true);
-    uint8_t almHr = request->getParam("alarm_hr", true)->value().toInt();
-    uint8_t almMin = request->getParam("alarm_min", true)->value().toInt();
-    saveSettings(high, low, buzzer, tz, sensInt, timeout, qStart, qEnd, almEn, almHr, almMin);
-
-    request->send(200, "text/html", "<h1>Settings Saved!</h1><p>Smart-Nav-Mitra is rebooting to apply changes.</p>");
-    delay(2000);
-    ESP.restart();
+    Command cmd;
+    cmd.type = CMD_APPLY_SETTINGS;
+    SettingsValues& v = cmd.settings;
+    v.tempHigh = request->getParam("temp_high", true)->value().toFloat();
+    v.tempLow = request->getParam("temp_low", true)->value().toFloat();
+    v.buzzer = request->hasParam("buzzer", true);
+    v.tzOffset = request->getParam("timezone", true)->value().toInt();
+    v.sensorInterval = request->getParam("sensor_interval", true)->value().toInt();
+    v.oledTimeout = request->getParam("oled_timeout", true)->value().toInt();
+    v.quietStart = request->getParam("quiet_start", true)->value().toInt();
+    v.quietEnd = request->getParam("quiet_end", true)->value().toInt();
+    v.alarmEnabled = request->hasParam("alarm_en", true);
+    v.alarmHour = request->getParam("alarm_hr", true)->value().toInt();
+    v.alarmMinute = request->getParam("alarm_min", true)->value().toInt();
+    v.sensorAdaptive = request->hasParam("sensor_adapt", true);
+    // Older settings pages don't send the adaptive bounds; keep the stored ones
+    v.sensorMin = request->hasParam("sensor_min", true) ? request->getParam("sensor_min", true)->value().toInt() : sensorMinInterval / 1000;
+    v.sensorMax = request->hasParam("sensor_max", true) ? request->getParam("sensor_max", true)->value().toInt() : sensorMaxInterval / 1000;
+    if (v.sensorMin < 1) v.sensorMin = 1;
+    if (v.sensorMax < v.sensorMin) v.sensorMax = v.sensorMin;
+    long altitude = request->hasParam("altitude", true) ? request->getParam("altitude", true)->value().toInt() : stationAltitudeM;
+    v.altitude = altitude < -500 ? -500 : altitude > 9000 ? 9000 : altitude;
+    v.autoBrightness = request->hasParam("auto_bright", true);
+    // Saved and followed by a restart from loop()
+    if (!postCommand(request, cmd)) return;
+
+    httpSendStatic(request, 200, "text/html", "<h1>Settings Saved!</h1><p>Smart-Nav-Mitra is rebooting to apply changes.</p>");
   } else {
-    request->send(400, "text/plain", "Bad Request: Missing parameters.");
+    httpSendStatic(request, 400, "text/plain", "Bad Request: Missing parameters.");
   }
 }
 
@@ -1258,21 +1382,23 @@ void handleSaveSettings(AsyncWebServerRequest *request) {
 
 // Handler to serve the /update page
 void handleUpdate(AsyncWebServerRequest *request) {
-  request->send(200, "text/html", UPDATE_HTML);
+  traceRecord(TRACE_HANDLER, TRACE_H_UPDATE);
+  httpSendStatic(request, 200, "text/html", UPDATE_PAGE_TEXT); // No placeholders: sent as is
 }
 
 // Handler for the file upload process
 void handleUpdateUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
   if (index == 0) {
-    Serial.printf("Update Start: %s\n", filename.c_str());
+    traceRecord(TRACE_HANDLER, TRACE_H_UPDATE_UPLOAD); // Once per upload, not per chunk
+    logWrite(LOG_MSG_UPDATE_START, filename);
     currentState = UPDATING; // Show updating state on OLED
     // If authentication is not used, it's important to check the filename extension
     if (!filename.endsWith(".bin")) {
-      request->send(400, "text/plain", "Not a .bin file");
+      httpSendStatic(request, 400, "text/plain", "Not a .bin file");
       return;
     }
     if (!Update.begin(UPDATE_SIZE_UNKNOWN)) { // Start OTA update
-      Update.printError(Serial);
+      logWrite(LOG_MSG_UPDATE_FAILED, Update.errorString());
     }
   }
   if (len) {
@@ -1280,33 +1406,43 @@ void handleUpdateUpload(AsyncWebServerRequest *request, String filename, size_t
   }
   if (final) {
     if (Update.end(true)) { // Finish the update
-      Serial.println("Update Success");
+      logWrite(LOG_MSG_UPDATE_DONE);
     } else {
-      Update.printError(Serial);
+      logWrite(LOG_MSG_UPDATE_FAILED, Update.errorString());
     }
   }
 }
 
 // Handler for when the update is successfully finished
 void handleUpdateSuccess(AsyncWebServerRequest *request) {
+  traceRecord(TRACE_HANDLER, TRACE_H_UPDATE);
   if(Update.isFinished()){
-    request->send(200, "text/plain", "OK");
-    ESP.restart();
+    Command cmd;
+    cmd.type = CMD_REBOOT;
+    cmd.rebootDelayMs = RESTART_GRACE_MS;
+    if (!postCommand(request, cmd)) return;
+    httpSendStatic(request, 200, "text/plain", "OK");
   } else {
-    request->send(500, "text/plain", "Update failed");
+    httpSendStatic(request, 500, "text/plain", "Update failed");
   }
 }
 
 // Handler for reboot command
 void handleReboot(AsyncWebServerRequest *request) {
-    request->send(200, "text/plain", "Rebooting...");
-    delay(1000);
-    ESP.restart();
+    traceRecord(TRACE_HANDLER, TRACE_H_REBOOT);
+    Command cmd;
+    cmd.type = CMD_REBOOT;
+    cmd.rebootDelayMs = 1000;
+    if (!postCommand(request, cmd)) return;
+    httpSendStatic(request, 200, "text/plain", "Rebooting...");
 }
 
 void handleFind(AsyncWebServerRequest *request) {
-    playFindMyMochi(); // Trigger the non-blocking find sequence
-    request->send(200, "text/plain", "OK");
+    traceRecord(TRACE_HANDLER, TRACE_H_FIND);
+    Command cmd;
+    cmd.type = CMD_FIND_ME; // loop() starts the non-blocking find sequence
+    if (!postCommand(request, cmd)) return;
+    httpSendStatic(request, 200, "text/plain", "OK");
 }
 
 
@@ -1317,34 +1453,47 @@ void setupOTA() {
   ArduinoOTA
     .onStart([]() {
       currentState = UPDATING;
-      Serial.println("Start updating...");
+      otaLoggedPercent = 0;
+      logWrite(LOG_MSG_OTA_START);
     })
     .onEnd([]() {
-      Serial.println("\nEnd");
+      logWrite(LOG_MSG_OTA_END);
+      traceRecord(TRACE_RESTART, TRACE_RESTART_OTA);
     })
     .onProgress([](unsigned int progress, unsigned int total) {
-      // OLED/Serial progress display
-      Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+      // Every 10 %, rather than on every chunk: the ring would hold little else
+      unsigned int percent = total ? (unsigned int)((uint64_t)progress * 100 / total) : 0;
+      if (percent >= otaLoggedPercent + 10) {
+        otaLoggedPercent = percent - percent % 10;
+        logWrite(LOG_MSG_OTA_PROGRESS, otaLoggedPercent);
+      }
     })
     .onError([](ota_error_t error) {
-      Serial.printf("OTA Error[%u]: ", error);
+      logWrite(LOG_MSG_OTA_ERROR, (unsigned int)error);
       // Revert to HAPPY state on error
       currentState = HAPPY; 
     });
 
   ArduinoOTA.begin();
-  Serial.println("OTA Initialized.");
+  logWrite(LOG_MSG_OTA_READY);
 }
 
 // Read and update global sensor variables
 void readSensors() {
   sensors_event_t humidity_event, temp_event;
+  ahtReadOk = false;
+  bmpReadOk = false;
   // Use the AHT20 for Temperature and Humidity
-  if (aht.getEvent(&humidity_event, &temp_event)) {
+  if (!i2cBusAcquire(ahtBus, I2C_PRIO_HIGH, SENSOR_BUS_TIMEOUT_MS)) {
+    logWrite(LOG_MSG_SENSOR_BUS_BUSY, "AHT20");
+  } else if (aht.getEvent(&humidity_event, &temp_event)) {
+    i2cBusRelease();
     tempC = temp_event.temperature;
     humidity = humidity_event.relative_humidity;
+    ahtReadOk = true;
   } else {
-    Serial.println("Failed to read from AHT20");
+    i2cBusRelease(false);
+    logWrite(LOG_MSG_AHT_READ_FAILED);
     tempC = 0.0; humidity = 0.0; // Prevent using stale data on failure
   }
 
@@ -1353,10 +1502,118 @@ void readSensors() {
 
   // Use the BMP280 for Pressure
   if (bmp.sensorID() != 0) { // Only read if the sensor was found
-    pressure_hPa = bmp.readPressure() / 100.0F;
+    if (i2cBusAcquire(bmpBus, I2C_PRIO_HIGH, SENSOR_BUS_TIMEOUT_MS)) {
+      float pa = bmp.readPressure();
+      i2cBusRelease(!isnan(pa));
+      if (!isnan(pa)) pressure_hPa = pa / 100.0F;
+      bmpReadOk = !isnan(pa);
+    } else {
+      logWrite(LOG_MSG_SENSOR_BUS_BUSY, "BMP280");
+    }
+  }
+
+  logWrite(LOG_MSG_SENSOR_READING, tempC, humidity, pressure_hPa);
+}
+
+// Wall-clock time in ms, or 0 while the clock has not been set by NTP yet.
+int64_t epochMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < 1600000000) return 0; // Still counting from the 1970 boot default
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Hands the latest reading and device state to the web handlers (see sensor_snapshot.h).
+// Called from loop() only.
+void publishSnapshot(int64_t readEpochMs) {
+  SensorSnapshot snap;
+  snap.sampledAt = lastSensorReadTime;
+  snap.epochMs = readEpochMs;
+  snap.tempC = tempC;
+  snap.humidity = humidity;
+  snap.pressureHpa = pressure_hPa;
+  snap.state = currentState;
+  for (uint8_t c = 0; c < ANOMALY_CHANNELS; c++) snap.conditions[c] = anomalyCondition(sensorHealth, (AnomalyChannel)c);
+  snap.tempOk = ahtReadOk && snap.conditions[ANOMALY_TEMP] == SENSOR_OK && snap.conditions[ANOMALY_HUMIDITY] == SENSOR_OK;
+  snap.pressureOk = bmpReadOk && snap.conditions[ANOMALY_PRESSURE] == SENSOR_OK;
+  snap.forecast = pressureTrendForecast(pressureTrend);
+  snap.lux = lightPresent ? bh1750Lux(lightSensor) : NAN;
+  sensorSnapshotPublish(snap);
+}
+
+// Push the framebuffer to the OLED through the bus manager. A frame that can't get
+// the bus within DISPLAY_BUS_TIMEOUT_MS is skipped rather than stalling the caller.
+bool flushDisplay() {
+  if (!i2cBusAcquire(oledBus, I2C_PRIO_LOW, DISPLAY_BUS_TIMEOUT_MS)) return false;
+  display.display();
+  i2cBusRelease();
+  return true;
+}
+
+// Starts or collects a BH1750 measurement when one is due (see bh1750.h). The bus is
+// only taken when the driver has something to send, so waiting for a result is free.
+void pollLightSensor() {
+  if (!lightPresent || !bh1750Due(lightSensor, millis())) return;
+  if (!i2cBusAcquire(lightBus, I2C_PRIO_HIGH, SENSOR_BUS_TIMEOUT_MS)) return;
+  Bh1750Status status = bh1750Poll(lightSensor, millis());
+  i2cBusRelease(status != BH1750_FAILED);
+  if (status != BH1750_READING) return;
+
+  float lux = bh1750Lux(lightSensor);
+  updateDisplayBrightness(lux);
+  // Web handlers see the new light level without waiting for the next sensor reading
+  publishSnapshot(sensorSnapshotRead().epochMs);
+}
+
+// Follows the room light with the OLED contrast, and tracks darkness for the screen-off
+// logic in loop(). Contrast goes with the square of log10(lux) from 1 lx (dimmest) to
+// 1000 lx (full), smoothed over a few readings and only sent in CONTRAST_STEP steps, so
+// the panel doesn't flicker with noise or a passing shadow.
+void updateDisplayBrightness(float lux) {
+  if (lux < LIGHT_DARK_LUX) {
+    if (!darkSince) darkSince = millis() | 1; // Never 0, which means "not dark"
+  } else if (lux > LIGHT_WAKE_LUX) {
+    darkSince = 0;
+    // Lights on: bring back a screen the dark turned off
+    if (darkBlanked && isDisplayOff && autoBrightness && !isQuietHours()) {
+      isDisplayOff = false;
+      darkBlanked = false;
+      lastActivityTime = millis();
+      drawMochiFace(HAPPY, EYES_UP);
+    }
   }
+  if (!autoBrightness) return;
+
+  float level = log10f(lux + 1);
+  smoothedLogLux = isnan(smoothedLogLux) ? level : smoothedLogLux + LIGHT_SMOOTHING * (level - smoothedLogLux);
+  float frac = smoothedLogLux / LIGHT_FULL_LOG_LUX;
+  if (frac > 1) frac = 1;
+  uint8_t contrast = 1 + (uint8_t)lroundf(frac * frac * 254);
+  bool atEnd = (contrast == 1 || contrast == 255) && contrast != oledContrast;
+  if (abs((int)contrast - (int)oledContrast) < CONTRAST_STEP && !atEnd) return;
+  if (!i2cBusAcquire(oledBus, I2C_PRIO_LOW, DISPLAY_BUS_TIMEOUT_MS)) return; // Next reading tries again
+  display.ssd1306_command(SSD1306_SETCONTRAST);
+  display.ssd1306_command(contrast);
+  i2cBusRelease();
+  oledContrast = contrast;
+}
 
-  Serial.printf("T: %.2f C, H: %.2f %%, P: %.2f hPa\n", tempC, humidity, pressure_hPa);
+// Drains the microphone ring into the sound level meter and the speech front end (see the
+// Sound Level globals)
+void soundTask(void*) {
+  static int32_t samples[SOUND_CHUNK];
+  for (;;) {
+    size_t n = micRead(samples, SOUND_CHUNK, portMAX_DELAY);
+    if (!n) continue;
+    uint32_t start = micros();
+    soundMeterProcess(soundMeter, samples, n);
+    uint32_t metered = micros();
+    soundProcessUs += metered - start;
+#if ENABLE_VOICE_RECOGNITION
+    voiceFrontendProcess(voiceFrontend, samples, n);
+    voiceProcessUs += micros() - metered;
+#endif
+  }
 }
 
 void checkEnvironment() {
@@ -1365,15 +1622,19 @@ void checkEnvironment() {
   if (currentState == TOUCHED || currentState == UPDATING || currentState == SETUP) {
     return;
   }
+  // Keep the mood while the temperature can't be trusted (failed, stuck or implausible reading)
+  if (anomalyCondition(sensorHealth, ANOMALY_TEMP) != SENSOR_OK) {
+    return;
+  }
 
   // High Temperature Alert -> Angry
   if (tempC > tempAlertHigh) {
-    if (currentState != ALERT_HIGH) Serial.println("High Temperature Alert!");
+    if (currentState != ALERT_HIGH) logWrite(LOG_MSG_TEMP_HIGH);
     currentState = ALERT_HIGH;
   } 
   // Low Temperature Alert -> Sick
   else if (tempC < tempAlertLow) {
-    if (currentState != ALERT_LOW) Serial.println("Low Temperature Alert!");
+    if (currentState != ALERT_LOW) logWrite(LOG_MSG_TEMP_LOW);
     currentState = ALERT_LOW;
   }
   // No Alert -> Happy
@@ -1399,7 +1660,7 @@ bool isQuietHours() {
 
 void startAlarm() {
   if (!alarmEnabled || isQuietHours()) return;
-  Serial.println("ALARM! WAKE UP!");
+  logWrite(LOG_MSG_ALARM_RINGING);
   alarmIsRinging = true;
   alarmIsSnoozed = false;
   alarmStartTime = millis();
@@ -1409,7 +1670,7 @@ void startAlarm() {
 }
 
 void stopAlarm() {
-  Serial.println("Alarm stopped for the day.");
+  logWrite(LOG_MSG_ALARM_STOPPED);
   alarmIsRinging = false;
   alarmIsSnoozed = false;
   alarmHasTriggeredToday = true; // Prevent it from triggering again today
@@ -1419,7 +1680,7 @@ void stopAlarm() {
 }
 
 void snoozeAlarm() {
-  Serial.println("Alarm snoozed for 7 minutes.");
+  logWrite(LOG_MSG_ALARM_SNOOZED);
   alarmIsRinging = false;
   alarmIsSnoozed = true;
   snoozeUntilTime = millis() + (7 * 60 * 1000); // 7 minutes from now
@@ -1436,7 +1697,6 @@ void checkAlarm() {
   if (!getLocalTime(&timeinfo)) return;
 
   if (timeinfo.tm_hour == alarmHour && timeinfo.tm_min == alarmMinute && !alarmHasTriggeredToday) {
-    Serial.println("ALARM! WAKE UP!");
     startAlarm();
   }
 
@@ -1451,6 +1711,7 @@ void checkAlarm() {
 // --------------------------------------------------------------------------------
 
 void drawParameterScreen() {
+  eyesOnScreen = false;
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
@@ -1458,10 +1719,41 @@ void drawParameterScreen() {
   // Draw environment data vertically on the left side
   display.setCursor(0, 10);
   display.print("T:"); display.print(tempC, 1); display.println("C");
+  // Today's range and the dew point between the readings
+  EnvSummary day = envStatsGet(envStats, ENV_24H, ENV_TEMP, millis() / 1000);
+  if (day.count > 1) {
+    display.setCursor(0, 19);
+    display.print(day.min, 0); display.print("-"); display.print(day.max, 0); display.print("C");
+  }
   display.setCursor(0, 28);
   display.print("H:"); display.print(humidity, 0); display.print("%");
+  EnvComfort comfort = envStatsComfort(envStats);
+  if (!isnan(comfort.dewPointC)) {
+    display.setCursor(0, 37);
+    display.print("Dp:"); display.print(comfort.dewPointC, 0); display.print("C");
+  }
   display.setCursor(0, 46);
   display.print((pressure_hPa < 0) ? "P: N/A" : "P:" + String((int)pressure_hPa));
+  // Pressure tendency arrow, and the forecast on the bottom line, once 2 h of pressure
+  // readings are in
+  PressureForecast forecast = pressureTrendForecast(pressureTrend);
+  if (forecast.valid && pressure_hPa >= 0) {
+    if (forecast.tendency == PT_STEADY) { // Arrow right
+      display.drawFastHLine(39, 49, 7, SSD1306_WHITE);
+      display.drawLine(45, 49, 42, 46, SSD1306_WHITE);
+      display.drawLine(45, 49, 42, 52, SSD1306_WHITE);
+    } else { // Arrow up or down
+      int16_t tip = forecast.changePer3h > 0 ? 46 : 52;
+      display.drawFastVLine(42, 46, 7, SSD1306_WHITE);
+      display.drawLine(42, tip, 39, 49, SSD1306_WHITE);
+      display.drawLine(42, tip, 45, 49, SSD1306_WHITE);
+    }
+    static const char* const OUTLOOK_WORDS[] = {"Fine", "Fair", "Change", "Rain", "Storm"};
+    ForecastOutlook outlook = zambrettiOutlook(forecast.letter);
+    drawForecastGlyph(0, 55, outlook);
+    display.setCursor(14, 56);
+    display.print(OUTLOOK_WORDS[outlook]);
+  }
 
   // Draw the main Mochi shape, aligned to the right
   display.fillCircle(96, 32, 30, SSD1306_WHITE);
@@ -1479,34 +1771,43 @@ void drawParameterScreen() {
       display.drawCircle(96, 34, 10, SSD1306_WHITE); // Draw a circle for the mouth
       display.fillRect(86, 24, 22, 11, SSD1306_BLACK); // Cover the top part to make a smile
   }
-  display.display();
+  flushDisplay();
 }
 
-void drawMochiFace(MochiState state, EyeDirection direction) {
-  display.clearDisplay();
-
-  // Handle special full-screen states first
-  if (state == UPDATING) {
-      display.setTextSize(1);
-      display.setTextColor(SSD1306_WHITE);
-      display.setCursor(10, 10);
-      display.println("OTA UPDATE");
-      display.drawRect(5, 45, 118, 10, SSD1306_WHITE);
-      display.fillRect(7, 47, (millis()/100)%114, 6, SSD1306_WHITE);
-      display.display();
-      return;
-  } else if (state == SETUP) {
-      display.setTextSize(1);
-      display.setTextColor(SSD1306_WHITE);
-      display.setCursor(25, 10);
-      display.println("SETUP MODE");
-      display.setCursor(10, 30);
-      display.println("Connect to WiFi");
-      display.display();
-      return;
+// 12x9 weather icon with its top left corner at (x, y)
+void drawForecastGlyph(int16_t x, int16_t y, ForecastOutlook outlook) {
+  if (outlook == OUTLOOK_FINE) { // Sun
+    display.fillCircle(x + 5, y + 4, 2, SSD1306_WHITE);
+    display.drawFastVLine(x + 5, y, 1, SSD1306_WHITE);
+    display.drawFastVLine(x + 5, y + 8, 1, SSD1306_WHITE);
+    display.drawFastHLine(x + 1, y + 4, 1, SSD1306_WHITE);
+    display.drawFastHLine(x + 9, y + 4, 1, SSD1306_WHITE);
+    display.drawPixel(x + 2, y + 1, SSD1306_WHITE);
+    display.drawPixel(x + 8, y + 1, SSD1306_WHITE);
+    display.drawPixel(x + 2, y + 7, SSD1306_WHITE);
+    display.drawPixel(x + 8, y + 7, SSD1306_WHITE);
+    return;
   }
+  if (outlook == OUTLOOK_FAIR) display.fillCircle(x + 8, y + 2, 2, SSD1306_WHITE); // Sun behind the cloud
+  // Cloud: lower for fair / changeable, raised to leave room for rain or lightning
+  int16_t top = (outlook == OUTLOOK_RAIN || outlook == OUTLOOK_STORM) ? y : y + 3;
+  display.fillCircle(x + 3, top + 3, 2, SSD1306_WHITE);
+  display.fillCircle(x + 6, top + 2, 2, SSD1306_WHITE);
+  display.fillRect(x + 1, top + 3, 10, 3, SSD1306_WHITE);
+  if (outlook == OUTLOOK_FAIR) display.drawFastHLine(x + 7, top, 4, SSD1306_BLACK); // Cloud edge over the sun
+  if (outlook == OUTLOOK_RAIN) {
+    for (int16_t dx = 2; dx <= 8; dx += 3) display.drawFastVLine(x + dx, y + 7, 2, SSD1306_WHITE);
+  } else if (outlook == OUTLOOK_STORM) {
+    display.drawLine(x + 6, y + 6, x + 4, y + 7, SSD1306_WHITE);
+    display.drawLine(x + 4, y + 7, x + 6, y + 7, SSD1306_WHITE);
+    display.drawLine(x + 6, y + 7, x + 4, y + 8, SSD1306_WHITE);
+  }
+}
 
-  // --- Draw Big Eyes with Expressions ---
+// Draws the Big Eyes with Adafruit GFX primitives onto a cleared buffer. This is the
+// reference the precomputed frames in eye_frames.h are checked against (the simulator's
+// --eye-bench); keep the geometry in sync with tools/gen_eye_frames.py.
+void drawEyesGfx(Adafruit_GFX& gfx, uint8_t state, uint8_t direction) {
   int pupil_dx = 0, pupil_dy = 0;
   int eye_w = 48, eye_h = 60, pupil_r = 10;
   int left_eye_x = 32, right_eye_x = 96;
@@ -1520,73 +1821,86 @@ void drawMochiFace(MochiState state, EyeDirection direction) {
   }
 
   // Draw Eye Sockets
-  display.drawRoundRect(left_eye_x - eye_w/2, 32 - eye_h/2, eye_w, eye_h, 15, SSD1306_WHITE);
-  display.drawRoundRect(right_eye_x - eye_w/2, 32 - eye_h/2, eye_w, eye_h, 15, SSD1306_WHITE);
+  gfx.drawRoundRect(left_eye_x - eye_w/2, 32 - eye_h/2, eye_w, eye_h, 15, SSD1306_WHITE);
+  gfx.drawRoundRect(right_eye_x - eye_w/2, 32 - eye_h/2, eye_w, eye_h, 15, SSD1306_WHITE);
 
   // Draw Pupils and Expressions based on state
   switch (state) {
     case ALERT_HIGH: // Angry
-      display.drawLine(left_eye_x - 15, 10, left_eye_x + 5, 18, SSD1306_WHITE);
-      display.drawLine(right_eye_x + 15, 10, right_eye_x - 5, 18, SSD1306_WHITE);
-      display.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
-      display.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
+      gfx.drawLine(left_eye_x - 15, 10, left_eye_x + 5, 18, SSD1306_WHITE);
+      gfx.drawLine(right_eye_x + 15, 10, right_eye_x - 5, 18, SSD1306_WHITE);
+      gfx.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
+      gfx.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
       break;
     case ALERT_LOW: // Sick/Sad
-      display.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy + 5, pupil_r - 2, SSD1306_WHITE);
-      display.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy + 5, pupil_r - 2, SSD1306_WHITE);
+      gfx.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy + 5, pupil_r - 2, SSD1306_WHITE);
+      gfx.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy + 5, pupil_r - 2, SSD1306_WHITE);
       break;
     case TOUCHED: // Wink
-      display.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
-      display.drawFastHLine(right_eye_x - 15, 32, 30, SSD1306_WHITE);
+      gfx.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
+      gfx.drawFastHLine(right_eye_x - 15, 32, 30, SSD1306_WHITE);
       break;
     case HAPPY:
     default: // Neutral / Happy
-      display.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
-      display.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
+      gfx.fillCircle(left_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
+      gfx.fillCircle(right_eye_x + pupil_dx, 32 + pupil_dy, pupil_r, SSD1306_WHITE);
       break;
   }
-
-  display.display();
 }
 
-String detectTouchGesture() {
-  // Adapted for INPUT_PULLDOWN where HIGH means touched.
-  int t = digitalRead(TOUCH_PIN);
-
-  // A new touch has started
-  if (t == HIGH && !touchActive) {
-    touchStart = millis();
-    touchActive = true;
+void drawMochiFace(MochiState state, EyeDirection direction) {
+  // Handle special full-screen states first
+  if (state == UPDATING) {
+      eyesOnScreen = false;
+      display.clearDisplay();
+      display.setTextSize(1);
+      display.setTextColor(SSD1306_WHITE);
+      display.setCursor(10, 10);
+      display.println("OTA UPDATE");
+      display.drawRect(5, 45, 118, 10, SSD1306_WHITE);
+      display.fillRect(7, 47, (millis()/100)%114, 6, SSD1306_WHITE);
+      flushDisplay();
+      return;
+  } else if (state == SETUP) {
+      eyesOnScreen = false;
+      display.clearDisplay();
+      display.setTextSize(1);
+      display.setTextColor(SSD1306_WHITE);
+      display.setCursor(25, 10);
+      display.println("SETUP MODE");
+      display.setCursor(10, 30);
+      display.println("Connect to WiFi");
+      flushDisplay();
+      return;
   }
 
-  // The touch has been released
-  if (t == LOW && touchActive) {
-    unsigned long duration = millis() - touchStart;
-    touchActive = false;
-
-    if (duration < 250) {  
-      tapCount++;
-      if (tapCount == 1) {
-        lastTap = millis();
-      }
-      if (tapCount == 2 && (millis() - lastTap < 400)) {
-        tapCount = 0;
-        return "double_tap";
-      }
-    }
-
-    if (duration >= 1500) {
-      return "long_press";
-    }
-  }
+#if ENABLE_EYE_ANIMATION
+  // --- Hand the Big Eyes to the animator; loop() renders them on the next frame slot ---
+  uint8_t col = (direction < EYE_FRAME_DIRECTIONS) ? (uint8_t)direction : (uint8_t)EYES_CENTER;
+  eyeAnimSetExpression(state, millis(), !eyesOnScreen); // Cross-fade in over whatever was shown
+  eyesOnScreen = true;
+  eyeAnimLookAt(EYE_PUPIL_OFFSETS[col][0], EYE_PUPIL_OFFSETS[col][1], EYE_LOOK_MS, EASE_IN_OUT, millis());
+  return;
+#elif USE_EYE_SPRITES
+  // --- Blit the precomputed Big Eyes frame ---
+  // Frames exist for HAPPY, ALERT_HIGH, ALERT_LOW and TOUCHED; anything else shows the neutral face.
+  uint8_t row = (state < EYE_FRAME_STATES) ? (uint8_t)state : (uint8_t)HAPPY;
+  uint8_t col = (direction < EYE_FRAME_DIRECTIONS) ? (uint8_t)direction : (uint8_t)EYES_CENTER;
+  memcpy_P(display.getBuffer(), EYE_FRAMES[row][col], EYE_FRAME_BYTES);
+#else
+  // --- Draw Big Eyes with Expressions ---
+  display.clearDisplay();
+  drawEyesGfx(display, state, direction);
+#endif
 
-  // If a single tap was detected but no second tap followed, fire the single_tap event.
-  if (tapCount == 1 && (millis() - lastTap > 350)) {
-    tapCount = 0;
-    return "single_tap";
-  }
+  flushDisplay();
+}
 
-  return ""; // No gesture detected
+String detectTouchGesture() {
+  // Adapted for INPUT_PULLDOWN where HIGH means touched. Fixed or learned thresholds: see touch_gesture.h.
+  TouchGesture gesture;
+  if (!touchGestureUpdate(touchGestures, digitalRead(TOUCH_PIN) == HIGH, millis(), gesture)) return "";
+  return touchGestureName(gesture); // "" when the presses weren't a gesture
 }
 
 void beep(int freq, int dur) {
@@ -1617,10 +1931,11 @@ void toneHappy() {
 void playFindMyMochi() {
   // This function now just starts the non-blocking sequence.
   // The main loop will handle the sound.
-  Serial.println("'Find My Mochi' activated!");
+  logWrite(LOG_MSG_FIND_ME);
   findMeIsActive = true;
   findMeStartTime = millis();
   drawMochiFace(HAPPY, EYES_UP); // Show surprised eyes
+  powerWake(); // Start beeping now rather than at the loop's next deadline
 }
 
 
@@ -1629,44 +1944,75 @@ void playFindMyMochi() {
 // --------------------------------------------------------------------------------
 
 void setup() {
+  // Before anything records an event: keep what the last run was doing
+  esp_reset_reason_t resetReason = esp_reset_reason();
+  crashTraceBegin(resetReason);
+  sampleStoreBegin(esp_random()); // A new session: /history clients start over
   Serial.begin(115200);
   delay(100);
-  Serial.println("\n--- Smart-Nav-Mitra Firmware Starting ---");
+  logBegin(Serial);
+  logWrite(LOG_MSG_BOOT);
+  logWrite(LOG_MSG_RESET_REASON, resetReasonName(resetReason), crashTraceLast().valid ? "kept" : "none");
 
   // 1. Hardware Initialization
   pinMode(TOUCH_PIN, INPUT_PULLDOWN); // Use internal pull-down to prevent floating pin
   pinMode(BUZZER_PIN, OUTPUT);
-  // Initialize the single, stable I2C bus for all devices
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  touchGestureBegin(touchGestures);
+  powerBegin(TOUCH_PIN);
+  // Initialize the single, stable I2C bus for all devices. The bus manager owns Wire from here on.
+  i2cBusBegin(Wire, I2C_SDA_PIN, I2C_SCL_PIN);
+  oledBus = i2cBusAddDevice("oled", 0x3C, OLED_I2C_CLOCK);
+  ahtBus = i2cBusAddDevice("aht20", 0x38, SENSOR_I2C_CLOCK);
+  bmpBus = i2cBusAddDevice("bmp280", 0x76, SENSOR_I2C_CLOCK);
+  lightBus = i2cBusAddDevice("bh1750", BH1750_ADDRESS, SENSOR_I2C_CLOCK);
 
   // Initialize OLED
   if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) { 
-    Serial.println(F("SSD1306 allocation failed"));
+    logWrite(LOG_MSG_OLED_FAILED);
+    logFlush();
     for (;;); 
   }
   display.setRotation(2); // Rotate 180 degrees if your screen is upside down
   display.clearDisplay();
+#if ENABLE_EYE_ANIMATION
+  // The animator composes straight into the display buffer; loop() flushes it
+  eyeAnimBegin(display.getBuffer(), EYE_ANIM_FPS, []() -> uint32_t { return micros(); });
+#endif
 
   // Initialize AHT20 on the secondary bus
   if (!aht.begin()) { 
-    Serial.println("Could not find AHT20 sensor, check wiring!");
+    logWrite(LOG_MSG_AHT_MISSING);
   }
   // Initialize BMP280
   // The I2C address is often 0x77 or 0x76. If 0x76 doesn't work, try 0x77.
   if (!bmp.begin(0x76) && !bmp.begin(0x77)) {
-    Serial.println(F("BMP280 sensor not found. Pressure readings will be disabled."));
+    logWrite(LOG_MSG_BMP_MISSING);
     pressure_hPa = -1; // Set to -1 to indicate not available
   } else {
     /* Default settings from datasheet. */
     bmp.setSampling(Adafruit_BMP280::MODE_NORMAL, Adafruit_BMP280::SAMPLING_X2, Adafruit_BMP280::SAMPLING_X16, Adafruit_BMP280::FILTER_X16, Adafruit_BMP280::STANDBY_MS_500);
-    Serial.println("BMP280 sensor initialization complete.");
+    logWrite(LOG_MSG_BMP_READY);
   }
-
-  // Initialize history data
-  for(int i=0; i<DATA_HISTORY_SIZE; i++) dataHistory[i].time = 0;
+  // Initialize BH1750 (optional: without it the display keeps a fixed brightness)
+  lightPresent = bh1750Begin(lightSensor, Wire, millis());
+  logWrite(lightPresent ? LOG_MSG_LIGHT_FOUND : LOG_MSG_LIGHT_MISSING);
+#if ENABLE_VOICE_RECOGNITION
+  // Initialize the INMP441 (the I2S driver can't tell whether one is connected)
+  soundMeterBegin(soundMeter, MIC_CALIBRATION_DB);
+  voiceFrontendBegin(voiceFrontend);
+  micPresent = micBegin(SOUND_SAMPLE_RATE, I2S_MIC_SCK, I2S_MIC_WS, I2S_MIC_SD) &&
+               xTaskCreate(soundTask, "sound", SOUND_TASK_STACK, nullptr, SOUND_TASK_PRIORITY, nullptr) == pdPASS;
+  logWrite(micPresent ? LOG_MSG_MIC_STARTED : LOG_MSG_MIC_FAILED);
+#endif
 
   // 2. Load Configuration and Connect
   loadConfig();
+  samplerBegin(sensorMinInterval, sensorMaxInterval);
+  envStatsBegin(envStats);
+  envQuantilesBegin(envQuantiles);
+  pressureTrendBegin(pressureTrend, stationAltitudeM);
+  anomalyBegin(sensorHealth);
+  sampleInterval = sensorAdaptive ? samplerInterval() : sensorInterval;
   
   if (staSsid.length() > 0) {
     currentState = HAPPY; // Assume we will connect
@@ -1681,26 +2027,24 @@ void setup() {
   }
   
   // 3. Configure Time
-  Serial.print("Configuring time from NTP server...");
   configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
   struct tm timeinfo;
   int retries = 0;
   while (!getLocalTime(&timeinfo) && retries < 15) {
-    Serial.print(".");
     delay(1000);
     retries++;
   }
   if (retries < 15) {
-    Serial.println("\nTime synchronized successfully!");
+    logWrite(LOG_MSG_NTP_SYNCED, retries);
   } else {
-    Serial.println("\nFailed to synchronize time. Proceeding without it.");
+    logWrite(LOG_MSG_NTP_FAILED);
   }
 
   // Perform an initial sensor read and state check to set the correct state before the first loop.
   readSensors();
   // Initial display with a neutral face
   drawMochiFace(HAPPY, EYES_CENTER);
-  Serial.println("Smart-Nav-Mitra is ready!");
+  logWrite(LOG_MSG_READY);
   
   lastState = currentState; // Set lastState to the current state so the loop doesn't redraw immediately.
   lastActivityTime = millis(); // Initialize activity timer
@@ -1709,15 +2053,30 @@ void setup() {
 }
 
 void loop() {
+  traceRecord(TRACE_LOOP, millis());
+  crashTraceHeap();
   // Always handle OTA
+  traceRecord(TRACE_STAGE, TRACE_STAGE_OTA);
   ArduinoOTA.handle(); 
-
-  // In Captive Portal Mode, just handle DNS requests
-  if (WiFi.getMode() == WIFI_AP) {
-    dnsServer.processNextRequest();
-    // Show setup emotion
-    drawMochiFace(SETUP);
-    delay(10);
+  i2cBusPoll(); // Bus recovery steps and stats
+  heapMonitorPoll(millis()); // Fragmentation trend
+  traceRecord(TRACE_STAGE, TRACE_STAGE_COMMANDS);
+  runCommands(); // Work queued by the web handlers, in both portal and connected mode
+
+  // In Captive Portal Mode, DNS and the web server answer from their own tasks; the loop
+  // only keeps the Wi-Fi scan fresh and runs what the handlers queue (they wake it)
+  if (portalActive) {
+    traceRecord(TRACE_STAGE, TRACE_STAGE_PORTAL);
+    uint32_t deadline = wifiScanPoll(millis());
+    // Show setup emotion, drawn again only when the state changes
+    static MochiState portalFace = (MochiState)-1;
+    if (currentState != portalFace) {
+      portalFace = currentState;
+      drawMochiFace(currentState);
+    }
+    if (rebootPending && (int32_t)(rebootAt - deadline) < 0) deadline = rebootAt;
+    powerSetDisplayOn(true);
+    powerIdleUntil(deadline, false); // The access point needs the radio: no light sleep
     return; // Don't proceed to other logic
   }
 
@@ -1725,6 +2084,7 @@ void loop() {
   if (WiFi.status() != WL_CONNECTED) {
     // If connection is lost, you might want to handle it, e.g., try reconnecting.
     // For now, we just stop processing.
+    powerIdleUntil(millis() + 100, false);
     return;
   }
 
@@ -1743,17 +2103,52 @@ void loop() {
     checkAlarm();
   }
 
+  traceRecord(TRACE_STAGE, TRACE_STAGE_LIGHT);
+  pollLightSensor(); // Ambient light and display brightness, on its own cadence
+
   // Periodically check sensors and environment state
-  if (millis() - lastSensorReadTime >= sensorInterval) {
+  if (millis() - lastSensorReadTime >= sampleInterval) {
+    traceRecord(TRACE_STAGE, TRACE_STAGE_SENSORS);
     lastSensorReadTime = millis();
     readSensors(); // Read sensor data
+    // Judge the reading before it is stored or acted on; bad values are kept out of the
+    // chart, the statistics and the alerts, and flagged in the sample store
+    bool tempValid = anomalyCheck(sensorHealth, ANOMALY_TEMP, lastSensorReadTime, ahtReadOk, tempC) == SENSOR_OK;
+    bool humidityValid = anomalyCheck(sensorHealth, ANOMALY_HUMIDITY, lastSensorReadTime, ahtReadOk, humidity) == SENSOR_OK;
+    bool pressureValid = bmp.sensorID() != 0 &&
+                         anomalyCheck(sensorHealth, ANOMALY_PRESSURE, lastSensorReadTime, bmpReadOk, pressure_hPa) == SENSOR_OK;
+    if (sensorAdaptive) {
+      sampleInterval = samplerUpdate(tempValid ? tempC : NAN, humidityValid ? humidity : NAN,
+                                     pressureValid ? pressure_hPa : NAN, lastSensorReadTime);
+    } else {
+      sampleInterval = sensorInterval;
+    }
 
-    // Store data for charting
-    dataHistory[historyIndex].time = millis(); // Using millis as a simple timestamp for the chart
-    dataHistory[historyIndex].temp = tempC;
-    dataHistory[historyIndex].humidity = humidity;
-    historyIndex = (historyIndex + 1) % DATA_HISTORY_SIZE;
-
+    // Store the reading for the chart and /export, stamped with the actual read time
+    // and with what it is worth
+    traceRecord(TRACE_STAGE, TRACE_STAGE_STORE);
+    int64_t readEpochMs = epochMillis();
+    float lux = lightPresent ? bh1750Lux(lightSensor) : NAN;
+    uint16_t flags = 0;
+    if (ahtReadOk) flags |= SAMPLE_TEMP_OK;
+    if (bmpReadOk) flags |= SAMPLE_PRESSURE_OK;
+    if (readEpochMs) flags |= SAMPLE_TIME_SYNCED;
+    if (tempValid && tempC > tempAlertHigh) flags |= SAMPLE_ALERT_HIGH;
+    if (tempValid && tempC < tempAlertLow) flags |= SAMPLE_ALERT_LOW;
+    if (ahtReadOk && !(tempValid && humidityValid)) flags |= SAMPLE_TEMP_SUSPECT;
+    if (bmpReadOk && !pressureValid) flags |= SAMPLE_PRESSURE_SUSPECT;
+    if (sensorAdaptive && sampleInterval <= sensorMinInterval) flags |= SAMPLE_FAST;
+    if (!isnan(lux)) flags |= SAMPLE_LIGHT_OK;
+    float laeq = NAN, lamax = NAN;
+    if (micPresent && soundMeterTakeInterval(soundMeter, laeq, lamax)) flags |= SAMPLE_SOUND_OK;
+    sampleStoreAdd(lastSensorReadTime, (uint32_t)(readEpochMs / 1000), tempC, humidity, pressure_hPa, lux, laeq, lamax,
+                   flags);
+    envStatsAdd(envStats, lastSensorReadTime / 1000, tempValid ? tempC : NAN, humidityValid ? humidity : NAN,
+                pressureValid ? pressure_hPa : NAN);
+    envQuantilesAdd(envQuantiles, lastSensorReadTime / 1000, tempValid ? tempC : NAN, humidityValid ? humidity : NAN,
+                    pressureValid ? pressure_hPa : NAN);
+    pressureTrendAdd(pressureTrend, lastSensorReadTime / 1000, pressureValid ? pressure_hPa : NAN);
+    publishSnapshot(readEpochMs);
   }
 
   // OLED Timeout Logic
@@ -1762,6 +2157,7 @@ void loop() {
     // Only check for timeout/quiet hours if the screen is currently on.
     if (!isDisplayOff) {
       bool shouldTurnOff = false;
+      bool dark = false;
 
       // Reason 1: Quiet hours are active.
       if (isQuietHours()) {
@@ -1771,16 +2167,26 @@ void loop() {
       else if (oledTimeoutMins > 0 && (millis() - lastActivityTime > (unsigned long)oledTimeoutMins * 60 * 1000)) {
         shouldTurnOff = true;
       }
+      // Reason 3: The room has been dark for a while, and nobody touched Mochi meanwhile.
+      // This one comes back on by itself when the light does.
+      else if (autoBrightness && darkSince && millis() - darkSince > LIGHT_DARK_HOLD_MS &&
+               millis() - lastActivityTime > LIGHT_DARK_HOLD_MS) {
+        shouldTurnOff = true;
+        dark = true;
+      }
 
       if (shouldTurnOff) {
+        darkBlanked = dark;
         isDisplayOff = true;
+        eyesOnScreen = false;
         display.clearDisplay();
-        display.display();
+        flushDisplay();
       }
     }
   }
 
   // Handle alarm ringing state (non-blocking sound)
+  traceRecord(TRACE_STAGE, TRACE_STAGE_ALERTS);
   if (alarmIsRinging) {
     // Ring for 15 seconds then stop automatically
     if (millis() - alarmStartTime > 15000) {
@@ -1812,6 +2218,7 @@ void loop() {
   // --- NEW GESTURE & STATE LOGIC ---
 
   // 1. Detect user gesture
+  traceRecord(TRACE_STAGE, TRACE_STAGE_GESTURE);
   String gesture = detectTouchGesture();
 
   if (gesture != "") { // A gesture was detected! This is high priority.
@@ -1833,6 +2240,7 @@ void loop() {
               // On double tap, show the parameter screen
               isShowingParameters = true;
               paramScreenStartTime = millis();
+              lastParamDrawTime = 0; // Draw it straight away
               toneHappy();
           } else if (gesture == "long_press") {
               drawMochiFace(TOUCHED); // Show a wink on long press
@@ -1857,11 +2265,15 @@ void loop() {
 
       // --- NEW DISPLAY LOGIC ---
       if (!isDisplayOff) {
+          traceRecord(TRACE_STAGE, TRACE_STAGE_DISPLAY);
           checkEnvironment(); // Update background mood
 
           if (isShowingParameters) {
               // We are currently showing the parameter screen.
-              drawParameterScreen();
+              if (millis() - lastParamDrawTime >= PARAM_REDRAW_INTERVAL) {
+                  lastParamDrawTime = millis();
+                  drawParameterScreen();
+              }
 
               // Check if the display duration has passed.
               if (millis() - paramScreenStartTime > PARAM_DISPLAY_DURATION) {
@@ -1874,6 +2286,7 @@ void loop() {
               if (millis() - lastParamShowTime > PARAM_SHOW_INTERVAL) {
                   isShowingParameters = true; // Time to switch to parameters.
                   paramScreenStartTime = millis(); // Start the display duration timer.
+                  lastParamDrawTime = 0;
               } else {
                   // Animate the eyes periodically.
                   if (millis() - lastEyeMoveTime > EYE_MOVE_INTERVAL) {
@@ -1881,33 +2294,83 @@ void loop() {
                       currentEyeDirection = (EyeDirection)random(0, 5); // 0 to 4
                       drawMochiFace(HAPPY, currentEyeDirection); // Always draw happy big eyes
                   }
+#if ENABLE_EYE_ANIMATION
+                  // Render and flush the next animation frame when one is due
+                  if (eyesOnScreen && eyeAnimTick(millis(), i2cBusBusy())) {
+                      unsigned long flushStart = micros();
+                      if (flushDisplay()) eyeAnimFlushDone(micros() - flushStart);
+                  }
+#endif
               }
           }
       }
   }
-  
-  delay(10); // Small delay to prevent the loop from running too fast
+
+  // Web handlers see the state through the snapshot; republish when it changed without a new reading
+  SensorSnapshot published = sensorSnapshotRead();
+  if (published.state != currentState) publishSnapshot(published.epochMs);
+
+  // Sleep until the next thing that needs the loop, instead of a fixed delay. Light sleep
+  // stops the I2S clock, so not while the microphone is capturing; the power manager
+  // also keeps out of it unless the radio can sleep too (see power_manager.h).
+  bool allowLightSleep = isDisplayOff && !alarmIsRinging && !findMeIsActive && !touchGestureBusy(touchGestures) &&
+                         !i2cBusBusy() && !micPresent;
+  powerSetDisplayOn(!isDisplayOff);
+  traceRecord(TRACE_STAGE, TRACE_STAGE_IDLE);
+  powerIdleUntil(nextLoopDeadline(), allowLightSleep);
+}
+
+// Earliest millis() time at which loop() has work to do. Anything polled (touch gestures,
+// beeps) keeps it at the old 10 ms cadence; otherwise it is the nearest timer.
+uint32_t nextLoopDeadline() {
+  uint32_t now = millis();
+  if (touchGestureBusy(touchGestures) || alarmIsRinging || findMeIsActive || i2cBusRecovering()) return now + 10;
+
+  uint32_t deadline = lastSensorReadTime + sampleInterval;
+  auto sooner = [&](uint32_t t) {
+    if ((int32_t)(t - deadline) < 0) deadline = t;
+  };
+  sooner(lastMinuteCheck + 60001);
+  if (rebootPending) sooner(rebootAt);
+  if (lightPresent) sooner(bh1750Deadline(lightSensor));
+  if (alarmIsSnoozed) sooner(snoozeUntilTime + 1);
+  if (currentState == TOUCHED) sooner(touchTimer + touchDisplayDuration + 1);
+  if (!isDisplayOff) {
+    if (oledTimeoutMins > 0) sooner(lastActivityTime + (unsigned long)oledTimeoutMins * 60 * 1000 + 1);
+    if (isShowingParameters) {
+      sooner(lastParamDrawTime + PARAM_REDRAW_INTERVAL);
+      sooner(paramScreenStartTime + PARAM_DISPLAY_DURATION + 1);
+    } else {
+      sooner(lastParamShowTime + PARAM_SHOW_INTERVAL + 1);
+      sooner(lastEyeMoveTime + EYE_MOVE_INTERVAL + 1);
+#if ENABLE_EYE_ANIMATION
+      if (eyesOnScreen) sooner(eyeAnimNextDeadline(now));
+#endif
+    }
+  }
+  return deadline;
 }
 
 #elif DATA_COLLECTION_MODE == 1 // This block runs if DATA_COLLECTION_MODE is 1
 
 // ================================================================================
 // PHASE 1: DATA COLLECTION MODE
-// In this mode, the device's only job is to print the state of the touch pin
-// to the Serial Monitor. This data can be copied and used to train a gesture
-// recognition model.
+// In this mode, the device's only job is to stream the touch pin to the serial
+// port as binary records (edges and 2 kHz samples, see touch_capture.h) for
+// tools/touch_recorder.py, which labels the gestures to train the classifier in
+// touch_gesture.h with tools/train_touch_gestures.py.
 // ================================================================================
 void setup() {
   Serial.begin(115200);
-  pinMode(TOUCH_PIN, INPUT);
+  pinMode(TOUCH_PIN, INPUT_PULLDOWN);
   Serial.println("--- Smart-Nav-Mitra: Data Collection Mode ---");
-  Serial.println("Continuously printing touch pin state. Press the touch sensor to generate data.");
+  Serial.println("Streaming binary touch records. Run tools/touch_recorder.py on this port.");
+  if (!touchCaptureBegin(TOUCH_PIN)) Serial.println("Touch capture failed to start");
 }
 
 void loop() {
-  // Print the value of the touch pin (0 for not touched, 1 for touched)
-  Serial.println(digitalRead(TOUCH_PIN));
-  delay(10); // Sample every 10ms
+  touchCaptureWrite(Serial);
+  delay(10); // The rings hold 256 ms of samples
 }
 
 #endif // End of DATA_COLLECTION_MODE check
\ No newline at end of file
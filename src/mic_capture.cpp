@@ -0,0 +1,104 @@
+#include "mic_capture.h"
+
+#include <driver/i2s.h>
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+const i2s_port_t MIC_PORT = I2S_NUM_0;
+const uint8_t MIC_EVENT_QUEUE = 8;
+const uint32_t RING_MASK = MIC_RING_SAMPLES - 1;
+const uint16_t CAPTURE_STACK = 3072;
+
+static int32_t ring[MIC_RING_SAMPLES];
+static uint32_t head = 0;   // Running count of samples written; only the capture task stores it
+static uint32_t tail = 0;   // ...and read; only the consumer stores it
+static int32_t dmaBuf[MIC_DMA_FRAMES];
+static QueueHandle_t events = nullptr;
+static TaskHandle_t consumer = nullptr;
+static MicStats stats;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Appends n samples, as many as fit
+static void push(const int32_t* samples, uint32_t n) {
+  uint32_t h = head;
+  uint32_t fill = h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  uint32_t room = MIC_RING_SAMPLES - fill;
+  uint32_t take = n < room ? n : room;
+  for (uint32_t i = 0; i < take; i++) ring[(h + i) & RING_MASK] = samples[i];
+  __atomic_store_n(&head, h + take, __ATOMIC_RELEASE);
+
+  portENTER_CRITICAL(&statsMux);
+  stats.samples += take;
+  stats.ringDropped += n - take;
+  if (fill + take > stats.maxFill) stats.maxFill = fill + take;
+  portEXIT_CRITICAL(&statsMux);
+}
+
+static void captureTask(void*) {
+  for (;;) {
+    size_t bytes = 0;
+    if (i2s_read(MIC_PORT, dmaBuf, sizeof(dmaBuf), &bytes, portMAX_DELAY) != ESP_OK) continue;
+    uint32_t n = bytes / sizeof(int32_t);
+    // The INMP441 sends 24 bits, MSB first, in the top of each 32-bit slot
+    for (uint32_t i = 0; i < n; i++) dmaBuf[i] >>= 8;
+    push(dmaBuf, n);
+    TaskHandle_t c = __atomic_load_n(&consumer, __ATOMIC_ACQUIRE);
+    if (c) xTaskNotifyGive(c);
+
+    i2s_event_t ev;
+    while (xQueueReceive(events, &ev, 0) == pdTRUE) {
+      if (ev.type != I2S_EVENT_RX_Q_OVF) continue;
+      portENTER_CRITICAL(&statsMux);
+      stats.dmaOverruns++;
+      portEXIT_CRITICAL(&statsMux);
+    }
+  }
+}
+
+bool micBegin(uint32_t sampleRate, int sckPin, int wsPin, int sdPin) {
+  i2s_config_t config = {};
+  config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+  config.sample_rate = sampleRate;
+  config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+  config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+  config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+  config.dma_buf_count = MIC_DMA_BUFFERS;
+  config.dma_buf_len = MIC_DMA_FRAMES;
+  config.use_apll = false;
+
+  i2s_pin_config_t pins = {};
+  pins.mck_io_num = I2S_PIN_NO_CHANGE;
+  pins.bck_io_num = sckPin;
+  pins.ws_io_num = wsPin;
+  pins.data_out_num = I2S_PIN_NO_CHANGE;
+  pins.data_in_num = sdPin;
+
+  if (i2s_driver_install(MIC_PORT, &config, MIC_EVENT_QUEUE, &events) != ESP_OK) return false;
+  if (i2s_set_pin(MIC_PORT, &pins) != ESP_OK) {
+    i2s_driver_uninstall(MIC_PORT);
+    return false;
+  }
+  return xTaskCreate(captureTask, "mic", CAPTURE_STACK, nullptr, MIC_TASK_PRIORITY, nullptr) == pdPASS;
+}
+
+size_t micRead(int32_t* out, size_t max, TickType_t ticks) {
+  if (!consumer) __atomic_store_n(&consumer, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+  uint32_t t = tail;
+  uint32_t avail = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - t;
+  if (!avail && ticks) {
+    ulTaskNotifyTake(pdTRUE, ticks);
+    avail = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - t;
+  }
+  size_t n = avail < max ? avail : max;
+  for (size_t i = 0; i < n; i++) out[i] = ring[(t + i) & RING_MASK];
+  __atomic_store_n(&tail, t + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+MicStats micStats() {
+  portENTER_CRITICAL(&statsMux);
+  MicStats s = stats;
+  portEXIT_CRITICAL(&statsMux);
+  return s;
+}
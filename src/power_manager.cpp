@@ -0,0 +1,146 @@
+#include "power_manager.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+#include "log_ring.h"
+
+const uint32_t POWER_MAX_IDLE_MS = 1000;  // Keep OTA and other polled housekeeping responsive
+const uint32_t STATS_WINDOW_MS = 60000;
+
+// Current model for the estimator (ESP32-C3 datasheet typicals at 3.3 V, not measurements)
+const float CURRENT_ACTIVE_MA = 28.0f;  // 160 MHz, CPU running, Wi-Fi in modem sleep
+const float CURRENT_IDLE_MA = 19.0f;    // 160 MHz, CPU idle (WFI), Wi-Fi in modem sleep
+const float CURRENT_SLEEP_MA = 0.35f;   // Light sleep, incl. sensors in standby
+const float CURRENT_DISPLAY_MA = 10.0f; // SSD1306 lit with the eyes (~25% of the pixels)
+
+static uint8_t touchPin = 0xFF;
+static TaskHandle_t loopTask = nullptr;
+static bool displayOn = true;
+static bool modemSleep = false;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t noSleepLock = nullptr;   // Held through waits that must stay out of light sleep
+#endif
+
+static PowerStats stats;
+static uint32_t lastMarkUs = 0;
+static uint64_t activeUs = 0, idleUs = 0, sleepUs = 0;
+static uint32_t windowStartMs = 0;
+static uint64_t windowActiveUs = 0, windowIdleUs = 0, windowSleepUs = 0;
+static double windowChargeMaUs = 0, totalChargeMaUs = 0;
+
+static void IRAM_ATTR onTouchEdge() {
+  BaseType_t woken = pdFALSE;
+  if (loopTask) vTaskNotifyGiveFromISR(loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// Books the time since the last mark into one of the three states.
+static void account(uint64_t& total, uint64_t& window, float currentMa) {
+  uint32_t now = micros();
+  uint32_t us = now - lastMarkUs;
+  lastMarkUs = now;
+  total += us;
+  window += us;
+  double charge = (double)us * (currentMa + (displayOn ? CURRENT_DISPLAY_MA : 0));
+  windowChargeMaUs += charge;
+  totalChargeMaUs += charge;
+}
+
+static void rollWindow() {
+  uint32_t nowMs = millis();
+  stats.activeMs = (uint32_t)(activeUs / 1000);
+  stats.idleMs = (uint32_t)(idleUs / 1000);
+  stats.sleepMs = (uint32_t)(sleepUs / 1000);
+  stats.usedMah = (float)(totalChargeMaUs / 3.6e9);
+  if (nowMs - windowStartMs < STATS_WINDOW_MS) return;
+
+  double total = (double)(windowActiveUs + windowIdleUs + windowSleepUs);
+  if (total > 0) {
+    stats.dutyCycle = (float)(windowActiveUs / total);
+    stats.sleepFraction = (float)(windowSleepUs / total);
+    stats.avgCurrentMa = (float)(windowChargeMaUs / total);
+  }
+  windowStartMs = nowMs;
+  windowActiveUs = windowIdleUs = windowSleepUs = 0;
+  windowChargeMaUs = 0;
+}
+
+// A station in modem sleep wakes the radio for its DTIM beacons by itself; the access
+// point, or a station without modem sleep, needs it awake all the time
+static bool radioCanSleep() {
+  wifi_mode_t mode = WiFi.getMode();
+  return mode == WIFI_OFF || (mode == WIFI_STA && modemSleep);
+}
+
+void powerBegin(uint8_t pin) {
+  touchPin = pin;
+  loopTask = xTaskGetCurrentTaskHandle();
+  attachInterrupt(digitalPinToInterrupt(touchPin), onTouchEdge, CHANGE);
+  memset(&stats, 0, sizeof(stats));
+  activeUs = idleUs = sleepUs = 0;
+  windowActiveUs = windowIdleUs = windowSleepUs = 0;
+  windowChargeMaUs = totalChargeMaUs = 0;
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  // No frequency scaling: the buzzer (LEDC) and UART run from APB and would change pitch/baud
+  esp_pm_config_esp32c3_t pm = {};
+  pm.max_freq_mhz = getCpuFrequencyMhz();
+  pm.min_freq_mhz = getCpuFrequencyMhz();
+  pm.light_sleep_enable = true;
+  stats.autoLightSleep = esp_pm_configure(&pm) == ESP_OK;
+  if (stats.autoLightSleep) {
+    // The edge interrupt can't wake an automatic light sleep; the pin's level can
+    gpio_wakeup_enable((gpio_num_t)touchPin, GPIO_INTR_HIGH_LEVEL); // HIGH = touched (INPUT_PULLDOWN)
+    esp_sleep_enable_gpio_wakeup();
+    if (!noSleepLock) esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "loop", &noSleepLock);
+  }
+#endif
+  logWrite(LOG_MSG_POWER_MODE, stats.autoLightSleep ? "automatic" : "deadline-driven");
+
+  lastMarkUs = micros();
+  windowStartMs = millis();
+}
+
+void powerEnableModemSleep() {
+  // Radio wakes for every DTIM beacon and sleeps in between; the association is kept.
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);
+  modemSleep = true;
+}
+
+void powerSetDisplayOn(bool on) {
+  displayOn = on;
+}
+
+void powerIdleUntil(uint32_t deadlineMs, bool allowLightSleep) {
+  account(activeUs, windowActiveUs, CURRENT_ACTIVE_MA);
+
+  int32_t remaining = (int32_t)(deadlineMs - millis());
+  if (remaining > (int32_t)POWER_MAX_IDLE_MS) remaining = POWER_MAX_IDLE_MS;
+  if (remaining > 0) {
+    bool sleep = stats.autoLightSleep && allowLightSleep && radioCanSleep();
+#if CONFIG_PM_ENABLE
+    if (stats.autoLightSleep && !sleep) esp_pm_lock_acquire(noSleepLock);
+#endif
+    // Returns early when the touch ISR notifies us
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining));
+#if CONFIG_PM_ENABLE
+    if (stats.autoLightSleep && !sleep) esp_pm_lock_release(noSleepLock);
+#endif
+    if (sleep) account(sleepUs, windowSleepUs, CURRENT_SLEEP_MA); // The IDF slept for us
+    else account(idleUs, windowIdleUs, CURRENT_IDLE_MA);
+  }
+  rollWindow();
+}
+
+void powerWake() {
+  if (loopTask) xTaskNotifyGive(loopTask);
+}
+
+const PowerStats& powerGetStats() {
+  return stats;
+}
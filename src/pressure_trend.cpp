@@ -0,0 +1,164 @@
+#include "pressure_trend.h"
+
+#include <math.h>
+#include <string.h>
+
+const float WINDOW_SEC = (float)PT_BINS * PT_BIN_SEC;
+const float ZAMBRETTI_TREND_HPA = 1.6f;   // 3 h change that counts as rising or falling
+
+static const char* const TENDENCY_NAMES[] = {
+  "unknown", "steady",
+  "rising_slowly", "rising", "rising_quickly", "rising_very_rapidly",
+  "falling_slowly", "falling", "falling_quickly", "falling_very_rapidly"
+};
+
+static const char* const ZAMBRETTI_TEXT[26] = {
+  "Settled fine", "Fine weather", "Becoming fine", "Fine, becoming less settled",
+  "Fine, possible showers", "Fairly fine, improving", "Fairly fine, possible showers early",
+  "Fairly fine, showery later", "Showery early, improving", "Changeable, mending",
+  "Fairly fine, showers likely", "Rather unsettled, clearing later", "Unsettled, probably improving",
+  "Showery, bright intervals", "Showery, becoming less settled", "Changeable, some rain",
+  "Unsettled, short fine intervals", "Unsettled, rain later", "Unsettled, some rain",
+  "Mostly very unsettled", "Occasional rain, worsening", "Rain at times, very unsettled",
+  "Rain at frequent intervals", "Rain, very unsettled", "Stormy, may improve", "Stormy, much rain"
+};
+
+// Outlook letters by Z number, from the Negretti & Zambra tables
+static const char FALLING_LETTERS[] = "ABDHORUXZ";       // Z = 1..9
+static const char STEADY_LETTERS[] = "ABEKNPSWXZ";      // Z = 10..19
+static const char RISING_LETTERS[] = "ABCFGIJLMQTYZ";   // Z = 20..32
+
+static void reset(PressureTrend& s, uint32_t nowS, float pressureHpa) {
+  s.newest = nowS / PT_BIN_SEC;
+  for (uint8_t i = 0; i < PT_SLOTS; i++) s.ids[i] = s.newest;
+  memset(s.bins, 0, sizeof(s.bins));
+  s.refHpa = pressureHpa;
+  s.started = true;
+  portENTER_CRITICAL(&s.lock);
+  s.forecast.valid = false;
+  portEXIT_CRITICAL(&s.lock);
+}
+
+// Least-squares fit over the closed bins of the window ending where bin `open` starts.
+// The bin moments are merged pairwise (Chan et al.) in double, with times measured
+// from the start of the window.
+static PressureForecast fit(const PressureTrend& s, uint32_t open) {
+  PressureForecast f;
+  f.valid = false;
+  uint32_t first = open >= PT_BINS ? open - PT_BINS : 0;
+  double n = 0, meanT = 0, meanP = 0, m2T = 0, cTP = 0;
+  uint8_t used = 0;
+  for (uint8_t i = 0; i < PT_SLOTS; i++) {
+    const PressureBin& b = s.bins[i];
+    if (!b.count || s.ids[i] < first || s.ids[i] >= open) continue;
+    double bt = (double)(s.ids[i] - first) * PT_BIN_SEC + b.meanT;
+    double total = n + b.count;
+    double dT = bt - meanT;
+    double dP = b.meanP - meanP;
+    meanT += dT * b.count / total;
+    meanP += dP * b.count / total;
+    m2T += b.m2T + dT * dT * n * b.count / total;
+    cTP += b.cTP + dT * dP * n * b.count / total;
+    n = total;
+    used++;
+  }
+  if (used < PT_MIN_BINS || m2T <= 0) return f;
+
+  double slope = cTP / m2T;   // hPa per second
+  float fitted = s.refHpa + meanP + slope * (WINDOW_SEC - meanT);
+  f.valid = true;
+  f.changePer3h = slope * 3 * 60 * 60;
+  f.seaLevelHpa = seaLevelPressure(fitted, s.altitudeM);
+  float change = fabsf(f.changePer3h);
+  uint8_t level = change < 0.1f ? 0 : change < 1.6f ? 1 : change < 3.6f ? 2 : change < 6.0f ? 3 : 4;
+  if (!level) f.tendency = PT_STEADY;
+  else f.tendency = (PressureTendency)((f.changePer3h > 0 ? PT_RISING_SLOWLY : PT_FALLING_SLOWLY) + level - 1);
+  f.letter = zambrettiLetter(f.seaLevelHpa, f.changePer3h);
+  return f;
+}
+
+void pressureTrendBegin(PressureTrend& s, float altitudeM) {
+  memset(&s, 0, sizeof(s));
+  s.altitudeM = altitudeM;
+  s.lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void pressureTrendAdd(PressureTrend& s, uint32_t nowS, float pressureHpa) {
+  if (isnan(pressureHpa)) return;
+  uint32_t id = nowS / PT_BIN_SEC;
+  if (!s.started || id < s.newest) {   // Also after a millis() wrap
+    reset(s, nowS, pressureHpa);
+  } else if (id != s.newest) {
+    // Open the new bin (emptying the slots skipped over), then refit on the closed ones
+    uint32_t from = id - s.newest > PT_SLOTS ? id - PT_SLOTS + 1 : s.newest + 1;
+    for (uint32_t n = from; n <= id; n++) {
+      uint8_t slot = n % PT_SLOTS;
+      s.ids[slot] = n;
+      s.bins[slot] = PressureBin();
+    }
+    s.newest = id;
+    PressureForecast f = fit(s, id);
+    portENTER_CRITICAL(&s.lock);
+    s.forecast = f;
+    portEXIT_CRITICAL(&s.lock);
+  }
+
+  PressureBin& b = s.bins[id % PT_SLOTS];
+  float t = (float)(nowS - id * PT_BIN_SEC);
+  float p = pressureHpa - s.refHpa;
+  b.count++;
+  float dT = t - b.meanT;
+  b.meanT += dT / b.count;
+  b.meanP += (p - b.meanP) / b.count;
+  b.m2T += dT * (t - b.meanT);
+  b.cTP += dT * (p - b.meanP);
+}
+
+PressureForecast pressureTrendForecast(PressureTrend& s) {
+  portENTER_CRITICAL(&s.lock);
+  PressureForecast f = s.forecast;
+  portEXIT_CRITICAL(&s.lock);
+  return f;
+}
+
+const char* pressureTendencyName(PressureTendency t) {
+  return TENDENCY_NAMES[t];
+}
+
+// The usual linear fits of the Zambretti dial: the Z number falls as pressure rises,
+// with a separate line for falling, steady and rising pressure. Pressures outside about
+// 950..1050 hPa are clamped to the ends of each table.
+char zambrettiLetter(float seaLevelHpa, float changePer3h) {
+  const char* letters;
+  long z, first, last;
+  if (changePer3h <= -ZAMBRETTI_TREND_HPA) {
+    z = lroundf(127 - 0.12f * seaLevelHpa);
+    letters = FALLING_LETTERS; first = 1; last = 9;
+  } else if (changePer3h >= ZAMBRETTI_TREND_HPA) {
+    z = lroundf(185 - 0.16f * seaLevelHpa);
+    letters = RISING_LETTERS; first = 20; last = 32;
+  } else {
+    z = lroundf(144 - 0.13f * seaLevelHpa);
+    letters = STEADY_LETTERS; first = 10; last = 19;
+  }
+  if (z < first) z = first;
+  if (z > last) z = last;
+  return letters[z - first];
+}
+
+const char* zambrettiText(char letter) {
+  if (letter < 'A' || letter > 'Z') return "";
+  return ZAMBRETTI_TEXT[letter - 'A'];
+}
+
+ForecastOutlook zambrettiOutlook(char letter) {
+  if (letter <= 'D') return OUTLOOK_FINE;
+  if (letter <= 'J') return OUTLOOK_FAIR;
+  if (letter <= 'Q') return OUTLOOK_CHANGEABLE;
+  if (letter <= 'X') return OUTLOOK_RAIN;
+  return OUTLOOK_STORM;
+}
+
+float seaLevelPressure(float stationHpa, float altitudeM) {
+  return stationHpa / powf(1 - altitudeM / 44330.0f, 5.255f);
+}
@@ -0,0 +1,175 @@
+#include "quantile_sketch.h"
+
+#include <math.h>
+
+// Compression of the k1 scale. Sketches typically settle at about two thirds of this in
+// centroids; compress() retries with less when a pass would not fit.
+const float DELTA = 1.4f * QSKETCH_CENTROIDS;
+const uint8_t MERGE_MAX = 2 * QSKETCH_CENTROIDS;
+
+static float scaleK(float q, float delta) {
+  if (q < 0) q = 0;
+  if (q > 1) q = 1;
+  return delta / (2 * 3.14159265f) * asinf(2 * q - 1);
+}
+
+// Compresses n sorted centroids into s (whose total is already set). False if the result
+// would need more than QSKETCH_CENTROIDS centroids.
+static bool compressPass(QuantileSketch& s, const float* mean, const uint16_t* weight, uint16_t n, float delta) {
+  uint8_t out = 0;
+  float before = 0;   // Weight left of the centroid being built
+  float curMean = mean[0], curWeight = weight[0];
+  float kLeft = scaleK(0, delta);
+  for (uint16_t i = 1; i < n; i++) {
+    float proposed = curWeight + weight[i];
+    if (scaleK((before + proposed) / s.total, delta) - kLeft <= 1) {
+      curMean += (mean[i] - curMean) * weight[i] / proposed;
+      curWeight = proposed;
+    } else {
+      if (out == QSKETCH_CENTROIDS - 1) return false;
+      s.mean[out] = curMean;
+      s.weight[out] = (uint16_t)curWeight;
+      out++;
+      before += curWeight;
+      kLeft = scaleK(before / s.total, delta);
+      curMean = mean[i];
+      curWeight = weight[i];
+    }
+  }
+  s.mean[out] = curMean;
+  s.weight[out] = (uint16_t)curWeight;
+  s.count = out + 1;
+  return true;
+}
+
+// With delta <= QSKETCH_CENTROIDS - 1 a pass always fits: neighbouring centroids span
+// more than 1 in k, and k runs over delta / 2
+static void compress(QuantileSketch& s, const float* mean, const uint16_t* weight, uint16_t n) {
+  float delta = DELTA;
+  while (!compressPass(s, mean, weight, n, delta)) {
+    delta *= 0.85f;
+    if (delta < QSKETCH_CENTROIDS - 1) delta = QSKETCH_CENTROIDS - 1;
+  }
+}
+
+// Merges two sorted centroid lists and compresses the result into s
+static void mergeSorted(QuantileSketch& s, const float* aMean, const uint16_t* aWeight, uint8_t an,
+                        const float* bMean, const uint16_t* bWeight, uint8_t bn) {
+  float mean[MERGE_MAX];
+  uint16_t weight[MERGE_MAX];
+  uint8_t i = 0, j = 0, n = 0;
+  while (i < an || j < bn) {
+    if (j >= bn || (i < an && aMean[i] <= bMean[j])) {
+      mean[n] = aMean[i];
+      weight[n++] = aWeight[i++];
+    } else {
+      mean[n] = bMean[j];
+      weight[n++] = bWeight[j++];
+    }
+  }
+  if (n) compress(s, mean, weight, n);
+}
+
+void qsketchClear(QuantileSketch& s) {
+  s.count = 0;
+  s.total = 0;
+  s.min = INFINITY;
+  s.max = -INFINITY;
+}
+
+void qsketchAdd(QuantileSketch& s, float* values, uint8_t n) {
+  if (!n) return;
+  if (n > QSKETCH_CENTROIDS) n = QSKETCH_CENTROIDS;
+  for (uint8_t i = 1; i < n; i++) {   // Insertion sort: batches are small
+    float v = values[i];
+    uint8_t j = i;
+    for (; j > 0 && values[j - 1] > v; j--) values[j] = values[j - 1];
+    values[j] = v;
+  }
+  uint16_t ones[QSKETCH_CENTROIDS];
+  for (uint8_t i = 0; i < n; i++) ones[i] = 1;
+  if (values[0] < s.min) s.min = values[0];
+  if (values[n - 1] > s.max) s.max = values[n - 1];
+  s.total += n;
+
+  QuantileSketch old = s;
+  mergeSorted(s, old.mean, old.weight, old.count, values, ones, n);
+}
+
+void qsketchMerge(QuantileSketch& into, const QuantileSketch& from) {
+  if (!from.count) return;
+  if (from.min < into.min) into.min = from.min;
+  if (from.max > into.max) into.max = from.max;
+  into.total += from.total;
+
+  QuantileSketch old = into;
+  mergeSorted(into, old.mean, old.weight, old.count, from.mean, from.weight, from.count);
+}
+
+void qgatherClear(QuantileGather& g) {
+  g.count = 0;
+  g.total = 0;
+  g.min = INFINITY;
+  g.max = -INFINITY;
+}
+
+void qgatherAdd(QuantileGather& g, const QuantileSketch& s) {
+  if (!s.count) return;
+  if (g.count + s.count > QSKETCH_GATHER_MAX) {   // Full: one pass early rather than lose s
+    QuantileSketch early;
+    qgatherSketch(g, early);
+    for (uint8_t i = 0; i < early.count; i++) {
+      g.mean[i] = early.mean[i];
+      g.weight[i] = early.weight[i];
+    }
+    g.count = early.count;
+  }
+  if (s.min < g.min) g.min = s.min;
+  if (s.max > g.max) g.max = s.max;
+  g.total += s.total;
+
+  // Merged in place from the back, so nothing gathered moves before it has been read
+  int i = g.count - 1, j = s.count - 1;
+  for (int k = g.count + s.count - 1; j >= 0; k--) {
+    if (i >= 0 && g.mean[i] > s.mean[j]) {
+      g.mean[k] = g.mean[i];
+      g.weight[k] = g.weight[i--];
+    } else {
+      g.mean[k] = s.mean[j];
+      g.weight[k] = s.weight[j--];
+    }
+  }
+  g.count += s.count;
+}
+
+void qgatherSketch(const QuantileGather& g, QuantileSketch& out) {
+  qsketchClear(out);
+  if (!g.count) return;
+  out.min = g.min;
+  out.max = g.max;
+  out.total = g.total;
+  compress(out, g.mean, g.weight, g.count);
+}
+
+// Centroids are treated as their weight spread evenly around the mean; the ends are
+// anchored at the exact min and max
+float qsketchQuantile(const QuantileSketch& s, float q) {
+  if (!s.count) return NAN;
+  if (q <= 0) return s.min;
+  if (q >= 1) return s.max;
+  if (s.count == 1) return s.min + (s.max - s.min) * q;
+
+  float target = q * s.total;
+  float half = s.weight[0] / 2.0f;
+  if (target < half) return s.min + (s.mean[0] - s.min) * target / half;
+  float cumulative = half;
+  for (uint8_t i = 0; i + 1 < s.count; i++) {
+    float span = (s.weight[i] + s.weight[i + 1]) / 2.0f;
+    if (target < cumulative + span) return s.mean[i] + (s.mean[i + 1] - s.mean[i]) * (target - cumulative) / span;
+    cumulative += span;
+  }
+  half = s.weight[s.count - 1] / 2.0f;
+  float frac = (target - cumulative) / half;
+  if (frac > 1) frac = 1;
+  return s.mean[s.count - 1] + (s.max - s.mean[s.count - 1]) * frac;
+}
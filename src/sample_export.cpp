@@ -0,0 +1,184 @@
+#include "sample_export.h"
+
+#include <time.h>
+#include "sample_store.h"
+
+const uint32_t CLOCK_SET_EPOCH = 1600000000;   // Below this the clock still counts from 1970
+const size_t LINE_MAX = 256;
+
+// Layout of the stream state words
+enum {
+  ST_NEXT,        // Running index of the next record
+  ST_END,         // Index the export stops at (the newest sample when it started)
+  ST_FROM,
+  ST_TO,
+  ST_FORMAT,      // ExportFormat, plus ST_HEADER_SENT
+  ST_NOW_EPOCH,   // Wall clock and millis() when the export started, to place
+  ST_NOW_MILLIS,  // samples taken before NTP sync
+};
+const uint32_t ST_HEADER_SENT = 0x100;
+
+static const char CSV_HEADER[] = "time,epoch_s,uptime_ms,temp_c,humidity_pct,pressure_hpa,lux,laeq_db,lamax_db,flags\n";
+
+static void putUint(char*& p, uint32_t v) {
+  char tmp[10];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  while (n) *p++ = tmp[--n];
+}
+
+static void put2(char*& p, int v) {
+  *p++ = '0' + v / 10;
+  *p++ = '0' + v % 10;
+}
+
+// v in units of 10^-decimals
+static void putFixed(char*& p, int32_t v, uint8_t decimals) {
+  if (v < 0) {
+    *p++ = '-';
+    v = -v;
+  }
+  uint32_t scale = decimals == 2 ? 100 : 10;
+  putUint(p, v / scale);
+  *p++ = '.';
+  if (decimals == 2) put2(p, v % scale);
+  else *p++ = '0' + v % scale;
+}
+
+static void putStr(char*& p, const char* s) {
+  while (*s) *p++ = *s++;
+}
+
+static void putIsoTime(char*& p, uint32_t epochS) {
+  time_t t = epochS;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  putUint(p, tm.tm_year + 1900);
+  *p++ = '-';
+  put2(p, tm.tm_mon + 1);
+  *p++ = '-';
+  put2(p, tm.tm_mday);
+  *p++ = 'T';
+  put2(p, tm.tm_hour);
+  *p++ = ':';
+  put2(p, tm.tm_min);
+  *p++ = ':';
+  put2(p, tm.tm_sec);
+  *p++ = 'Z';
+}
+
+// Wall-clock time of a sample; samples from before NTP sync are placed relative to
+// the start of the export. 0 if the clock is still unset.
+static uint32_t sampleEpoch(const StoredSample& s, const uint32_t* state) {
+  if (s.epochS) return s.epochS;
+  if (!state[ST_NOW_EPOCH]) return 0;
+  return state[ST_NOW_EPOCH] - (state[ST_NOW_MILLIS] - s.uptimeMs) / 1000;
+}
+
+static size_t formatCsv(char* line, const StoredSample& s, uint32_t epoch) {
+  char* p = line;
+  if (epoch) putIsoTime(p, epoch);
+  *p++ = ',';
+  if (epoch) putUint(p, epoch);
+  *p++ = ',';
+  putUint(p, s.uptimeMs);
+  *p++ = ',';
+  if (s.flags & SAMPLE_TEMP_OK) putFixed(p, s.tempCenti, 2);
+  *p++ = ',';
+  if (s.flags & SAMPLE_TEMP_OK) putFixed(p, s.humidityCenti, 2);
+  *p++ = ',';
+  if (s.flags & SAMPLE_PRESSURE_OK) putFixed(p, s.pressureDeci, 1);
+  *p++ = ',';
+  if (s.flags & SAMPLE_LIGHT_OK) putFixed(p, s.luxCenti, 2);
+  *p++ = ',';
+  if (s.flags & SAMPLE_SOUND_OK) putFixed(p, s.laeqDeci, 1);
+  *p++ = ',';
+  if (s.flags & SAMPLE_SOUND_OK) putFixed(p, s.lamaxDeci, 1);
+  *p++ = ',';
+  putUint(p, s.flags);
+  *p++ = '\n';
+  return p - line;
+}
+
+static size_t formatNdjson(char* line, const StoredSample& s, uint32_t epoch) {
+  char* p = line;
+  putStr(p, "{\"time\":");
+  if (epoch) {
+    *p++ = '"';
+    putIsoTime(p, epoch);
+    *p++ = '"';
+    putStr(p, ",\"epoch_s\":");
+    putUint(p, epoch);
+  } else {
+    putStr(p, "null,\"epoch_s\":null");
+  }
+  putStr(p, ",\"uptime_ms\":");
+  putUint(p, s.uptimeMs);
+  putStr(p, ",\"temp_c\":");
+  if (s.flags & SAMPLE_TEMP_OK) putFixed(p, s.tempCenti, 2);
+  else putStr(p, "null");
+  putStr(p, ",\"humidity_pct\":");
+  if (s.flags & SAMPLE_TEMP_OK) putFixed(p, s.humidityCenti, 2);
+  else putStr(p, "null");
+  putStr(p, ",\"pressure_hpa\":");
+  if (s.flags & SAMPLE_PRESSURE_OK) putFixed(p, s.pressureDeci, 1);
+  else putStr(p, "null");
+  putStr(p, ",\"lux\":");
+  if (s.flags & SAMPLE_LIGHT_OK) putFixed(p, s.luxCenti, 2);
+  else putStr(p, "null");
+  putStr(p, ",\"laeq_db\":");
+  if (s.flags & SAMPLE_SOUND_OK) putFixed(p, s.laeqDeci, 1);
+  else putStr(p, "null");
+  putStr(p, ",\"lamax_db\":");
+  if (s.flags & SAMPLE_SOUND_OK) putFixed(p, s.lamaxDeci, 1);
+  else putStr(p, "null");
+  putStr(p, ",\"flags\":");
+  putUint(p, s.flags);
+  putStr(p, "}\n");
+  return p - line;
+}
+
+void exportBegin(uint32_t (&state)[HTTP_STREAM_STATE_WORDS], ExportFormat format, uint32_t fromS, uint32_t toS) {
+  time_t now = time(nullptr);
+  state[ST_NEXT] = sampleStoreFirst();
+  state[ST_END] = sampleStoreEnd();
+  state[ST_FROM] = fromS;
+  state[ST_TO] = toS;
+  state[ST_FORMAT] = format;
+  state[ST_NOW_EPOCH] = now >= (time_t)CLOCK_SET_EPOCH ? (uint32_t)now : 0;
+  state[ST_NOW_MILLIS] = millis();
+}
+
+bool exportNext(Print& out, uint32_t* state) {
+  ExportFormat format = (ExportFormat)(state[ST_FORMAT] & 0xFF);
+  if (!(state[ST_FORMAT] & ST_HEADER_SENT)) {
+    state[ST_FORMAT] |= ST_HEADER_SENT;
+    if (format == EXPORT_CSV) out.write((const uint8_t*)CSV_HEADER, sizeof(CSV_HEADER) - 1);
+  }
+
+  char line[LINE_MAX];
+  for (uint8_t n = 0; n < EXPORT_BATCH && state[ST_NEXT] < state[ST_END]; n++) {
+    // Samples overwritten while the export was running are skipped
+    uint32_t first = sampleStoreFirst();
+    if (state[ST_NEXT] < first) state[ST_NEXT] = first;
+
+    StoredSample s;
+    if (!sampleStoreGet(state[ST_NEXT]++, s)) continue;
+    uint32_t epoch = sampleEpoch(s, state);
+    if (state[ST_FROM] && epoch < state[ST_FROM]) continue;
+    if (state[ST_TO] && epoch > state[ST_TO]) {
+      state[ST_NEXT] = state[ST_END];   // Samples are in time order: nothing later matches
+      break;
+    }
+    size_t len = format == EXPORT_CSV ? formatCsv(line, s, epoch) : formatNdjson(line, s, epoch);
+    out.write((const uint8_t*)line, len);
+  }
+  return state[ST_NEXT] < state[ST_END];
+}
+
+const char* exportContentType(ExportFormat format) {
+  return format == EXPORT_CSV ? "text/csv" : "application/x-ndjson";
+}
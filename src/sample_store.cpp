@@ -0,0 +1,84 @@
+#include "sample_store.h"
+
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+
+static StoredSample ring[SAMPLE_STORE_CAPACITY];
+static uint32_t total = 0;   // Samples ever stored; the next one gets this index
+static uint32_t session = 0;
+static portMUX_TYPE storeMux = portMUX_INITIALIZER_UNLOCKED;
+
+static int32_t fixedPoint(float v, float scale, int32_t lo, int32_t hi) {
+  if (isnan(v)) return 0;
+  int32_t x = (int32_t)lroundf(v * scale);
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+void sampleStoreBegin(uint32_t s) {
+  portENTER_CRITICAL(&storeMux);
+  total = 0;
+  session = s ? s : 1; // 0 is "no session" in sampleStoreResume()
+  portEXIT_CRITICAL(&storeMux);
+}
+
+uint32_t sampleStoreSession() {
+  return session;
+}
+
+void sampleStoreAdd(uint32_t uptimeMs, uint32_t epochS, float tempC, float humidity, float pressureHpa, float lux,
+                    float laeq, float lamax, uint16_t flags) {
+  StoredSample s;
+  s.uptimeMs = uptimeMs;
+  s.epochS = epochS;
+  s.tempCenti = (flags & SAMPLE_TEMP_OK) ? fixedPoint(tempC, 100, INT16_MIN, INT16_MAX) : 0;
+  s.humidityCenti = (flags & SAMPLE_TEMP_OK) ? fixedPoint(humidity, 100, 0, UINT16_MAX) : 0;
+  s.pressureDeci = (flags & SAMPLE_PRESSURE_OK) ? fixedPoint(pressureHpa, 10, 0, UINT16_MAX) : 0;
+  s.luxCenti = (flags & SAMPLE_LIGHT_OK) ? fixedPoint(lux, 100, 0, INT32_MAX) : 0;
+  s.laeqDeci = (flags & SAMPLE_SOUND_OK) ? fixedPoint(laeq, 10, 0, UINT16_MAX) : 0;
+  s.lamaxDeci = (flags & SAMPLE_SOUND_OK) ? fixedPoint(lamax, 10, 0, UINT16_MAX) : 0;
+  s.flags = flags;
+
+  // The export streams from the web server task while the loop adds samples
+  portENTER_CRITICAL(&storeMux);
+  ring[total % SAMPLE_STORE_CAPACITY] = s;
+  total++;
+  portEXIT_CRITICAL(&storeMux);
+}
+
+uint32_t sampleStoreFirst() {
+  return total > SAMPLE_STORE_CAPACITY ? total - SAMPLE_STORE_CAPACITY : 0;
+}
+
+uint32_t sampleStoreEnd() {
+  return total;
+}
+
+bool sampleStoreGet(uint32_t i, StoredSample& out) {
+  bool ok;
+  portENTER_CRITICAL(&storeMux);
+  ok = i < total && total - i <= SAMPLE_STORE_CAPACITY;
+  if (ok) out = ring[i % SAMPLE_STORE_CAPACITY];
+  portEXIT_CRITICAL(&storeMux);
+  return ok;
+}
+
+SampleResume sampleStoreResume(uint32_t clientSession, uint32_t after, uint32_t maxCount) {
+  SampleResume r;
+  portENTER_CRITICAL(&storeMux);
+  uint32_t end = total;
+  uint32_t current = session;
+  portEXIT_CRITICAL(&storeMux);
+  uint32_t first = end > SAMPLE_STORE_CAPACITY ? end - SAMPLE_STORE_CAPACITY : 0;
+
+  // Sequence number `after` is running index after - 1, so the next one to send is index `after`
+  r.reset = (clientSession && clientSession != current) || after > end;
+  r.from = r.reset ? first : after;
+  r.dropped = 0;
+  if (r.from < first) {
+    r.dropped = first - r.from;
+    r.from = first;
+  }
+  r.more = end - r.from > maxCount;
+  r.end = r.more ? r.from + maxCount : end;
+  return r;
+}
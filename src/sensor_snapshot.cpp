@@ -0,0 +1,39 @@
+#include "sensor_snapshot.h"
+
+#include <atomic>
+
+// Even sequence: readers use copies[0]; odd: copies[1]. The writer updates the copy
+// readers are not using, so there is always one complete copy to read.
+static SensorSnapshot copies[2];
+static std::atomic<uint32_t> sequence(0);
+static std::atomic<uint32_t> retries(0);
+static uint32_t published = 0;
+
+void sensorSnapshotPublish(const SensorSnapshot& s) {
+  SensorSnapshot next = s;
+  next.version = ++published;
+
+  // Odd: readers move to copies[1] while copies[0] is rewritten
+  sequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  copies[0] = next;
+  // Even: readers move back to copies[0] while copies[1] catches up
+  sequence.fetch_add(1, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_release);
+  copies[1] = next;
+}
+
+SensorSnapshot sensorSnapshotRead() {
+  SensorSnapshot out;
+  for (;;) {
+    uint32_t seq = sequence.load(std::memory_order_acquire);
+    out = copies[seq & 1];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) == seq) return out;
+    retries.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+uint32_t sensorSnapshotRetries() {
+  return retries.load(std::memory_order_relaxed);
+}
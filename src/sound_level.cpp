@@ -0,0 +1,223 @@
+#include "sound_level.h"
+
+#include <math.h>
+#include <string.h>
+
+// IEC 61672 A-weighting pole frequencies, Hz. Four zeros sit at 0 Hz.
+const double AW_F1 = 20.598997;     // Double pole
+const double AW_F2 = 107.65265;
+const double AW_F3 = 737.86223;
+const double AW_F4 = 12194.217;     // Double pole
+
+const uint8_t SAMPLE_SHIFT = 6;     // 24-bit samples to 30 bits
+const uint8_t SQUARE_SHIFT = 5;     // See soundSumSquares()
+const uint8_t DC_POLE_SHIFT = 10;   // DC blocker pole at 1 - 2^-10
+const double SPL_FULL_SCALE = 120;  // 94 dB SPL at -26 dBFS
+
+static int32_t q30(double v) {
+  return (int32_t)llround(v * (1 << 30));
+}
+
+// |B(z) / A(z)| of one biquad at z = e^(jw)
+static double magnitude(const double b[3], const double a[3], double w) {
+  double br = b[0] + b[1] * cos(w) + b[2] * cos(2 * w), bi = -b[1] * sin(w) - b[2] * sin(2 * w);
+  double ar = a[0] + a[1] * cos(w) + a[2] * cos(2 * w), ai = -a[1] * sin(w) - a[2] * sin(2 * w);
+  return sqrt((br * br + bi * bi) / (ar * ar + ai * ai));
+}
+
+void soundAWeightDesign(SoundBiquad (&stages)[SOUND_AWEIGHT_STAGES], uint32_t sampleRate) {
+  double r1 = exp(-2 * M_PI * AW_F1 / sampleRate);
+  double r2 = exp(-2 * M_PI * AW_F2 / sampleRate);
+  double r3 = exp(-2 * M_PI * AW_F3 / sampleRate);
+  double r4 = exp(-2 * M_PI * AW_F4 / sampleRate);
+  double b[SOUND_AWEIGHT_STAGES][3] = {
+    {1, -2, 1},                         // Two of the zeros at DC
+    {1, -2, 1},                         // The other two
+    {1, SOUND_AWEIGHT_ZERO, 0},         // High-frequency correction
+  };
+  double a[SOUND_AWEIGHT_STAGES][3] = {
+    {1, -2 * r1, r1 * r1},
+    {1, -(r2 + r3), r2 * r3},
+    {1, -2 * r4, r4 * r4},
+  };
+  double w = 2 * M_PI * 1000 / sampleRate;
+  double gain = 1;
+  for (uint8_t s = 0; s < SOUND_AWEIGHT_STAGES; s++) gain *= magnitude(b[s], a[s], w);
+  // The last stage takes the gain: it is nearly flat, so no stage's output grows past the input's range
+  for (uint8_t k = 0; k < 3; k++) b[SOUND_AWEIGHT_STAGES - 1][k] /= gain;
+
+  memset(stages, 0, sizeof(stages));
+  for (uint8_t s = 0; s < SOUND_AWEIGHT_STAGES; s++) {
+    stages[s].b0 = q30(b[s][0]);
+    stages[s].b1 = q30(b[s][1]);
+    stages[s].b2 = q30(b[s][2]);
+    stages[s].a1 = q30(a[s][1]);
+    stages[s].a2 = q30(a[s][2]);
+  }
+}
+
+void soundDcBlock(SoundDcBlocker& s, const int32_t* in, int32_t* out, size_t n) {
+  int32_t x1 = s.x1, y1 = s.y1;
+  for (size_t i = 0; i < n; i++) {
+    int32_t x = in[i] * (1 << SAMPLE_SHIFT);
+    int32_t y = x - x1 + y1 - (y1 >> DC_POLE_SHIFT);
+    x1 = x;
+    y1 = y;
+    out[i] = y;
+  }
+  s.x1 = x1;
+  s.y1 = y1;
+}
+
+void soundBiquads(SoundBiquad* stages, uint8_t count, int32_t* buf, size_t n) {
+  for (uint8_t s = 0; s < count; s++) {
+    SoundBiquad& q = stages[s];
+    const int64_t b0 = q.b0, b1 = q.b1, b2 = q.b2, a1 = q.a1, a2 = q.a2;
+    int32_t x1 = q.x1, x2 = q.x2, y1 = q.y1, y2 = q.y2;
+    for (size_t i = 0; i < n; i++) {
+      int32_t x = buf[i];
+      int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+      int32_t y = (int32_t)((acc + (1 << 29)) >> 30);
+      x2 = x1;
+      x1 = x;
+      y2 = y1;
+      y1 = y;
+      buf[i] = y;
+    }
+    q.x1 = x1;
+    q.x2 = x2;
+    q.y1 = y1;
+    q.y2 = y2;
+  }
+}
+
+uint64_t soundSumSquares(const int32_t* buf, size_t n) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    int32_t v = buf[i] >> SQUARE_SHIFT;
+    sum += (uint64_t)((int64_t)v * v);
+  }
+  return sum;
+}
+
+uint32_t soundPeak(const int32_t* buf, size_t n) {
+  uint32_t peak = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t v = buf[i] < 0 ? 0u - (uint32_t)buf[i] : (uint32_t)buf[i];
+    if (v > peak) peak = v;
+  }
+  return peak;
+}
+
+static float meanSquareDb(const SoundMeter& m, double meanSquare) {
+  if (meanSquare <= 0) return 0;
+  float db = 10 * log10f((float)meanSquare) + m.levelOffset;
+  return db > 0 ? db : 0;
+}
+
+static float peakDb(const SoundMeter& m, uint32_t peak) {
+  if (!peak) return 0;
+  float db = 20 * log10f((float)peak) + m.peakOffset;
+  return db > 0 ? db : 0;
+}
+
+void soundMeterBegin(SoundMeter& m, float calibrationDb) {
+  memset(&m, 0, sizeof(m));
+  m.lock = portMUX_INITIALIZER_UNLOCKED;
+  soundAWeightDesign(m.aweight, SOUND_SAMPLE_RATE);
+  // A full-scale sine has a mean square of 2^(2 * 24) / 2 after the shifts, and reads SPL_FULL_SCALE
+  double fullScale = (double)(1UL << (23 + SAMPLE_SHIFT - SQUARE_SHIFT));
+  m.levelOffset = (float)(SPL_FULL_SCALE + calibrationDb - 10 * log10(fullScale * fullScale / 2));
+  // Its peak reads 3 dB higher
+  m.peakOffset = (float)(SPL_FULL_SCALE + calibrationDb + 10 * log10(2.0) - 20 * log10((double)(1UL << (23 + SAMPLE_SHIFT))));
+}
+
+static void closeBlock(SoundMeter& m) {
+  uint64_t mean = m.blockSum / SOUND_BLOCK_SAMPLES;
+  float la = meanSquareDb(m, (double)mean);
+  m.secSum += mean;
+  if (mean > m.secMax) m.secMax = mean;
+  if (m.blockPeak > m.secPeak) m.secPeak = m.blockPeak;
+  m.blockSum = 0;
+  m.blockFill = 0;
+  m.blockPeak = 0;
+
+  SoundLevels next;
+  portENTER_CRITICAL(&m.lock);
+  next = m.levels;
+  portEXIT_CRITICAL(&m.lock);
+  next.la = la;
+
+  if (++m.secBlocks == SOUND_BLOCKS_PER_SEC) {
+    uint8_t slot = next.seconds % SOUND_MINUTE_SEC;
+    m.minuteMean[slot] = m.secSum / SOUND_BLOCKS_PER_SEC;
+    m.minuteMax[slot] = m.secMax;
+    next.seconds++;
+    uint8_t filled = next.seconds < SOUND_MINUTE_SEC ? next.seconds : SOUND_MINUTE_SEC;
+    uint64_t sum = 0, max = 0;
+    for (uint8_t i = 0; i < filled; i++) {
+      sum += m.minuteMean[i];
+      if (m.minuteMax[i] > max) max = m.minuteMax[i];
+    }
+    next.valid = true;
+    next.laeq1s = meanSquareDb(m, (double)m.minuteMean[slot]);
+    next.laeq1min = meanSquareDb(m, (double)sum / filled);
+    next.lamax1min = meanSquareDb(m, (double)max);
+    next.lzpeak1s = peakDb(m, m.secPeak);
+    m.secSum = 0;
+    m.secMax = 0;
+    m.secPeak = 0;
+    m.secBlocks = 0;
+  }
+
+  portENTER_CRITICAL(&m.lock);
+  m.levels = next;
+  m.intervalSum += mean;
+  if (mean > m.intervalMax) m.intervalMax = mean;
+  m.intervalBlocks++;
+  portEXIT_CRITICAL(&m.lock);
+}
+
+void soundMeterProcess(SoundMeter& m, const int32_t* samples, size_t n) {
+  if (n && !m.started) {
+    // Start the DC blocker at the microphone's offset, not at a step from 0 to it
+    m.dc.x1 = samples[0] * (1 << SAMPLE_SHIFT);
+    m.started = true;
+  }
+  while (n) {
+    size_t take = SOUND_BLOCK_SAMPLES - m.blockFill;
+    if (take > SOUND_CHUNK) take = SOUND_CHUNK;
+    if (take > n) take = n;
+    soundDcBlock(m.dc, samples, m.work, take);
+    uint32_t peak = soundPeak(m.work, take);
+    if (peak > m.blockPeak) m.blockPeak = peak;
+    soundBiquads(m.aweight, SOUND_AWEIGHT_STAGES, m.work, take);
+    m.blockSum += soundSumSquares(m.work, take);
+    m.blockFill += take;
+    if (m.blockFill == SOUND_BLOCK_SAMPLES) closeBlock(m);
+    samples += take;
+    n -= take;
+  }
+}
+
+SoundLevels soundMeterLevels(SoundMeter& m) {
+  portENTER_CRITICAL(&m.lock);
+  SoundLevels levels = m.levels;
+  portEXIT_CRITICAL(&m.lock);
+  return levels;
+}
+
+bool soundMeterTakeInterval(SoundMeter& m, float& laeq, float& lamax) {
+  portENTER_CRITICAL(&m.lock);
+  double sum = m.intervalSum;
+  uint64_t max = m.intervalMax;
+  uint32_t blocks = m.intervalBlocks;
+  m.intervalSum = 0;
+  m.intervalMax = 0;
+  m.intervalBlocks = 0;
+  portEXIT_CRITICAL(&m.lock);
+  if (!blocks) return false;
+  laeq = meanSquareDb(m, sum / blocks);
+  lamax = meanSquareDb(m, (double)max);
+  return true;
+}
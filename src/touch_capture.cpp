@@ -0,0 +1,152 @@
+#include "touch_capture.h"
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+struct EdgeRecord {
+  uint32_t us;
+  uint8_t level;
+};
+
+struct BlockRecord {
+  uint32_t t0;
+  uint32_t bits;
+};
+
+static uint8_t capturePin = 0;
+static esp_timer_handle_t sampler = nullptr;
+
+// Running counts of records written (by the producer) and read (by touchCaptureWrite())
+static EdgeRecord edges[TOUCH_CAPTURE_EDGES];
+static uint32_t edgeHead = 0, edgeTail = 0;
+static BlockRecord blocks[TOUCH_CAPTURE_BLOCKS];
+static uint32_t blockHead = 0, blockTail = 0;
+static uint32_t dropped = 0;
+
+// The sampler's block in progress
+static uint32_t blockT0 = 0, blockBits = 0;
+static uint8_t blockCount = 0;
+
+static uint32_t lastInfo = 0;
+static bool infoSent = false;
+
+static void IRAM_ATTR onEdge() {
+  uint32_t h = edgeHead;
+  if (h - __atomic_load_n(&edgeTail, __ATOMIC_ACQUIRE) >= TOUCH_CAPTURE_EDGES) {
+    __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  EdgeRecord& r = edges[h % TOUCH_CAPTURE_EDGES];
+  r.us = micros();
+  r.level = digitalRead(capturePin);
+  __atomic_store_n(&edgeHead, h + 1, __ATOMIC_RELEASE);
+}
+
+static void onSample(void*) {
+  if (blockCount == 0) {
+    blockT0 = micros();
+    blockBits = 0;
+  }
+  if (digitalRead(capturePin) == HIGH) blockBits |= 1UL << blockCount;
+  if (++blockCount < TOUCH_CAPTURE_BLOCK) return;
+  blockCount = 0;
+  uint32_t h = blockHead;
+  if (h - __atomic_load_n(&blockTail, __ATOMIC_ACQUIRE) >= TOUCH_CAPTURE_BLOCKS) {
+    __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  blocks[h % TOUCH_CAPTURE_BLOCKS] = {blockT0, blockBits};
+  __atomic_store_n(&blockHead, h + 1, __ATOMIC_RELEASE);
+}
+
+bool touchCaptureBegin(uint8_t pin) {
+  capturePin = pin;
+  esp_timer_create_args_t args = {};
+  args.callback = onSample;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "touch_capture";
+  if (esp_timer_create(&args, &sampler) != ESP_OK) return false;
+  if (esp_timer_start_periodic(sampler, 1000000 / TOUCH_CAPTURE_HZ) != ESP_OK) return false;
+  attachInterrupt(digitalPinToInterrupt(pin), onEdge, CHANGE);
+  return true;
+}
+
+uint16_t touchCaptureCrc(const uint8_t* data, size_t n) {
+  uint16_t crc = 0xFFFF;
+  while (n--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+  return put16(put16(p, v), v >> 16);
+}
+
+// frame holds type, length and payload from frame + 2; sends it with sync and CRC
+static size_t sendFrame(Print& out, uint8_t* frame, uint8_t* end) {
+  frame[0] = TOUCH_FRAME_SYNC0;
+  frame[1] = TOUCH_FRAME_SYNC1;
+  frame[3] = end - frame - 4;
+  end = put16(end, touchCaptureCrc(frame + 2, end - frame - 2));
+  return out.write(frame, end - frame);
+}
+
+size_t touchCaptureWrite(Print& out) {
+  uint8_t frame[32];
+  size_t written = 0;
+
+  uint32_t t = blockTail;
+  uint32_t h = __atomic_load_n(&blockHead, __ATOMIC_ACQUIRE);
+  for (; t != h; t++) {
+    const BlockRecord& r = blocks[t % TOUCH_CAPTURE_BLOCKS];
+    frame[2] = TOUCH_FRAME_SAMPLES;
+    uint8_t* p = put16(put32(frame + 4, r.t0), 1000000 / TOUCH_CAPTURE_HZ);
+    *p++ = TOUCH_CAPTURE_BLOCK;
+    p = put32(p, r.bits);
+    __atomic_store_n(&blockTail, t + 1, __ATOMIC_RELEASE);
+    written += sendFrame(out, frame, p);
+  }
+
+  t = edgeTail;
+  h = __atomic_load_n(&edgeHead, __ATOMIC_ACQUIRE);
+  for (; t != h; t++) {
+    const EdgeRecord& r = edges[t % TOUCH_CAPTURE_EDGES];
+    frame[2] = TOUCH_FRAME_EDGE;
+    uint8_t* p = put32(frame + 4, r.us);
+    *p++ = r.level;
+    __atomic_store_n(&edgeTail, t + 1, __ATOMIC_RELEASE);
+    written += sendFrame(out, frame, p);
+  }
+
+  // Last, so its time is after that of every record sent before it
+  uint32_t now = micros();
+  if (!infoSent || now - lastInfo >= 1000000) {
+    infoSent = true;
+    lastInfo = now;
+    TouchCaptureStats s = touchCaptureStats();
+    frame[2] = TOUCH_FRAME_INFO;
+    uint8_t* p = put16(put32(frame + 4, now), TOUCH_CAPTURE_HZ);
+    *p++ = capturePin;
+    *p++ = TOUCH_CAPTURE_VERSION;
+    p = put32(put32(put32(p, s.edges), s.blocks), s.dropped);
+    written += sendFrame(out, frame, p);
+  }
+  return written;
+}
+
+TouchCaptureStats touchCaptureStats() {
+  TouchCaptureStats s;
+  s.edges = __atomic_load_n(&edgeHead, __ATOMIC_ACQUIRE);
+  s.blocks = __atomic_load_n(&blockHead, __ATOMIC_ACQUIRE);
+  s.dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+  return s;
+}
@@ -0,0 +1,92 @@
+#include "touch_gesture.h"
+
+#include <Arduino.h>
+#include <string.h>
+#include "touch_gesture_model.h"
+
+static uint16_t saturate(uint32_t ms) {
+  return ms > TOUCH_MAX_PRESS_MS ? TOUCH_MAX_PRESS_MS : (uint16_t)ms;
+}
+
+void touchGestureBegin(TouchGestureState& s) {
+  memset(&s, 0, sizeof(s));
+}
+
+static TouchGesture finish(TouchGestureState& s) {
+  uint32_t start = ESP.getCycleCount();
+  TouchGesture g = touchGestureClassify(s.features);
+  uint32_t cycles = ESP.getCycleCount() - start;
+  s.stats.lastCycles = cycles;
+  if (cycles > s.stats.maxCycles) s.stats.maxCycles = cycles;
+  s.stats.gestures[g]++;
+  s.presses = 0;
+  memset(s.features, 0, sizeof(s.features));
+  return g;
+}
+
+bool touchGestureUpdate(TouchGestureState& s, bool touched, uint32_t nowMs, TouchGesture& gesture) {
+  if (touched && !s.pressed) {
+    s.pressed = true;
+    s.pressStart = nowMs;
+    if (s.presses == 1) s.features[TOUCH_FEATURE_GAP_MS] = saturate(nowMs - s.lastRelease);
+    return false;
+  }
+  if (!touched && s.pressed) {
+    s.pressed = false;
+    s.lastRelease = nowMs;
+    s.features[s.presses ? TOUCH_FEATURE_SECOND_MS : TOUCH_FEATURE_FIRST_MS] = saturate(nowMs - s.pressStart);
+    s.features[TOUCH_FEATURE_PRESSES] = ++s.presses;
+    if (s.presses < 2) return false;
+    gesture = finish(s);
+    return true;
+  }
+  if (!s.pressed && s.presses && nowMs - s.lastRelease >= TOUCH_SEGMENT_GAP_MS) {
+    gesture = finish(s);
+    return true;
+  }
+  return false;
+}
+
+bool touchGestureBusy(const TouchGestureState& s) {
+  return s.pressed || s.presses;
+}
+
+// The old detectTouchGesture()'s rules on the segmenter's features. Two presses that
+// don't make a double tap are a single tap if either was one, as the old code fired it.
+static TouchGesture classifyFixed(const uint16_t features[TOUCH_FEATURES]) {
+  uint16_t first = features[TOUCH_FEATURE_FIRST_MS], second = features[TOUCH_FEATURE_SECOND_MS];
+  bool twoPresses = features[TOUCH_FEATURE_PRESSES] >= 2;
+  if (twoPresses && first < TOUCH_TAP_MAX_MS && second < TOUCH_TAP_MAX_MS &&
+      features[TOUCH_FEATURE_GAP_MS] + second < TOUCH_DOUBLE_TAP_MS) {
+    return TOUCH_GESTURE_DOUBLE_TAP;
+  }
+  if (first >= TOUCH_LONG_PRESS_MS || second >= TOUCH_LONG_PRESS_MS) return TOUCH_GESTURE_LONG_PRESS;
+  if (first < TOUCH_TAP_MAX_MS || (twoPresses && second < TOUCH_TAP_MAX_MS)) return TOUCH_GESTURE_SINGLE_TAP;
+  return TOUCH_GESTURE_NONE;
+}
+
+TouchGesture touchGestureClassify(const uint16_t features[TOUCH_FEATURES]) {
+  if (!TOUCH_TREE_RECORDED) return classifyFixed(features);
+  const TouchTreeNode* n = TOUCH_TREE;
+  while (n->feature != TOUCH_TREE_LEAF) {
+    n = &TOUCH_TREE[features[n->feature] <= n->threshold ? n->left : n->right];
+  }
+  return (TouchGesture)n->left;
+}
+
+const char* touchGestureName(TouchGesture g) {
+  switch (g) {
+    case TOUCH_GESTURE_SINGLE_TAP: return "single_tap";
+    case TOUCH_GESTURE_DOUBLE_TAP: return "double_tap";
+    case TOUCH_GESTURE_LONG_PRESS: return "long_press";
+    default: return "";
+  }
+}
+
+uint8_t touchGestureModelDepth() {
+  return TOUCH_TREE_RECORDED ? TOUCH_TREE_DEPTH : 0;
+}
+
+const TouchGestureStats& touchGestureStats(const TouchGestureState& s) {
+  return s.stats;
+}
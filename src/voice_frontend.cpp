@@ -0,0 +1,297 @@
+#include "voice_frontend.h"
+
+#include <math.h>
+#include <string.h>
+
+const uint8_t FRAME_SHIFT = 2;       // DC-blocked 30-bit samples to the frame's 28 bits
+const uint8_t HEADROOM_BIT = 28;     // voiceWindow() scales the largest value to [2^28, 2^29)
+const uint8_t ENERGY_SHIFT = 5;      // As soundSumSquares()
+const int32_t LN2_Q16 = 45426;
+const int64_t DB_PER_LOG2_Q16 = 197283;  // 10 log10(2)
+const int32_t SILENT_DB = -200 * 65536;
+const uint8_t NO_BAND = 0xFF;
+
+// VAD thresholds, dB Q16
+const int32_t VAD_MIN = (int32_t)(VOICE_VAD_MIN_DBFS * 65536);
+const int32_t VAD_MARGIN = (int32_t)(VOICE_VAD_MARGIN_DB * 65536);
+const int32_t VAD_ZCR_MARGIN = (int32_t)(VOICE_VAD_ZCR_MARGIN_DB * 65536);
+
+static double melOf(double hz) {
+  return 2595 * log10(1 + hz / 700);
+}
+
+static double hzOf(double mel) {
+  return 700 * (pow(10, mel / 2595) - 1);
+}
+
+void voiceFrontendBegin(VoiceFrontend& v) {
+  memset(&v, 0, sizeof(v));
+  v.lock = portMUX_INITIALIZER_UNLOCKED;
+
+  for (uint16_t i = 0; i < VOICE_FRAME_SAMPLES; i++) {
+    v.window[i] = (int16_t)lround((0.54 - 0.46 * cos(2 * M_PI * i / (VOICE_FRAME_SAMPLES - 1))) * 32767);
+  }
+  for (uint16_t k = 0; k < VOICE_BINS; k++) {
+    v.twiddleCos[k] = (int32_t)llround(cos(2 * M_PI * k / VOICE_FFT_SIZE) * (1 << 30));
+    v.twiddleSin[k] = (int32_t)llround(sin(2 * M_PI * k / VOICE_FFT_SIZE) * (1 << 30));
+  }
+  for (uint16_t i = 0; i < VOICE_FFT_HALF; i++) {
+    uint8_t r = 0;
+    for (uint8_t b = 0; b < VOICE_FFT_STAGES; b++) {
+      if (i & (1 << b)) r |= 1 << (VOICE_FFT_STAGES - 1 - b);
+    }
+    v.bitReverse[i] = r;
+  }
+
+  // Mel points evenly spaced on the mel scale; band m rises from point m to m + 1 and
+  // falls to m + 2
+  double points[VOICE_MEL_BANDS + 2];
+  double low = melOf(VOICE_MEL_LOW_HZ), high = melOf(VOICE_MEL_HIGH_HZ);
+  for (uint8_t i = 0; i < VOICE_MEL_BANDS + 2; i++) points[i] = hzOf(low + (high - low) * i / (VOICE_MEL_BANDS + 1));
+  for (uint16_t k = 0; k < VOICE_BINS; k++) {
+    double hz = (double)k * SOUND_SAMPLE_RATE / VOICE_FFT_SIZE;
+    v.binPoint[k] = NO_BAND;
+    for (uint8_t i = 0; i <= VOICE_MEL_BANDS; i++) {
+      if (hz >= points[i] && hz < points[i + 1]) {
+        v.binPoint[k] = i;
+        long w = lround((hz - points[i]) / (points[i + 1] - points[i]) * 32768);
+        v.binWeight[k] = (int16_t)(w < 32767 ? w : 32767);
+      }
+    }
+  }
+  for (uint8_t i = 0; i < VOICE_MFCC; i++) {
+    double scale = sqrt((i ? 2.0 : 1.0) / VOICE_MEL_BANDS);
+    for (uint8_t m = 0; m < VOICE_MEL_BANDS; m++) {
+      v.dct[i][m] = (int16_t)lround(scale * cos(M_PI * i * (m + 0.5) / VOICE_MEL_BANDS) * 32767);
+    }
+  }
+  v.preemphasis = (int16_t)lroundf(VOICE_PREEMPHASIS * 32768);
+  // A full-scale sine's samples reach 2^29 - ENERGY_SHIFT, so its mean square is 2^47
+  v.energyOffset = (int32_t)lround(-(log2((double)VOICE_HOP_SAMPLES) + 2 * (29 - ENERGY_SHIFT) - 1) * 65536);
+  v.floorRise = (int32_t)lround(VOICE_VAD_FLOOR_RISE_DB * 65536.0 * VOICE_HOP_SAMPLES / SOUND_SAMPLE_RATE);
+  v.energyDb = SILENT_DB;
+  v.floorDb = SILENT_DB;
+}
+
+int32_t voiceLog2(uint64_t x) {
+  uint8_t msb = 63 - __builtin_clzll(x);
+  // Mantissa in [1, 2) as Q30, then one fraction bit per squaring; its square stays under
+  // 4, so it fits 32 bits and each step is a 32 x 32-bit multiply
+  uint32_t m = (uint32_t)(msb >= 30 ? x >> (msb - 30) : x << (30 - msb));
+  int32_t frac = 0;
+  for (int8_t b = 15; b >= 0; b--) {
+    m = (uint32_t)(((uint64_t)m * m) >> 30);
+    if (m >= (2UL << 30)) {
+      m >>= 1;
+      frac |= 1 << b;
+    }
+  }
+  return ((int32_t)msb << 16) + frac;
+}
+
+int8_t voiceWindow(VoiceFrontend& v) {
+  uint32_t max = 0;
+  uint16_t idx = v.framePos;    // The oldest sample
+  for (uint16_t i = 0; i < VOICE_FRAME_SAMPLES; i++) {
+    int32_t s = (int32_t)(((int64_t)v.frame[idx] * v.window[i]) >> 15);
+    v.fft[i] = s;
+    uint32_t a = s < 0 ? 0u - (uint32_t)s : (uint32_t)s;
+    if (a > max) max = a;
+    if (++idx == VOICE_FRAME_SAMPLES) idx = 0;
+  }
+  memset(v.fft + VOICE_FRAME_SAMPLES, 0, (VOICE_FFT_SIZE - VOICE_FRAME_SAMPLES) * sizeof(int32_t));
+  if (!max) return INT8_MIN;
+
+  int8_t shift = HEADROOM_BIT - (31 - __builtin_clz(max));
+  if (shift > 0) {
+    for (uint16_t i = 0; i < VOICE_FRAME_SAMPLES; i++) v.fft[i] *= (1 << shift);
+  } else if (shift < 0) {
+    for (uint16_t i = 0; i < VOICE_FRAME_SAMPLES; i++) v.fft[i] >>= -shift;
+  }
+  return shift;
+}
+
+void voiceFft(VoiceFrontend& v) {
+  int32_t* z = v.fft;
+  for (uint16_t i = 0; i < VOICE_FFT_HALF; i++) {
+    uint16_t r = v.bitReverse[i];
+    if (r <= i) continue;
+    int32_t re = z[2 * i], im = z[2 * i + 1];
+    z[2 * i] = z[2 * r];
+    z[2 * i + 1] = z[2 * r + 1];
+    z[2 * r] = re;
+    z[2 * r + 1] = im;
+  }
+  // Each stage halves its outputs, so magnitudes never grow past the input's 2^29.5
+  for (uint16_t len = 2; len <= VOICE_FFT_HALF; len <<= 1) {
+    uint16_t half = len / 2, step = VOICE_FFT_SIZE / len;
+    for (uint16_t g = 0; g < VOICE_FFT_HALF; g += len) {
+      for (uint16_t k = 0; k < half; k++) {
+        int64_t c = v.twiddleCos[k * step], s = v.twiddleSin[k * step];
+        int32_t* a = z + 2 * (g + k);
+        int32_t* b = a + 2 * half;
+        // b times e^(-j 2 pi k step / 512)
+        int32_t tr = (int32_t)((b[0] * c + b[1] * s + (1 << 29)) >> 30);
+        int32_t ti = (int32_t)((b[1] * c - b[0] * s + (1 << 29)) >> 30);
+        int32_t ar = a[0], ai = a[1];
+        a[0] = (ar + tr) >> 1;
+        a[1] = (ai + ti) >> 1;
+        b[0] = (ar - tr) >> 1;
+        b[1] = (ai - ti) >> 1;
+      }
+    }
+  }
+}
+
+void voiceMelEnergies(VoiceFrontend& v) {
+  const int32_t* z = v.fft;
+  memset(v.mel, 0, sizeof(v.mel));
+  for (uint16_t k = 0; k < VOICE_BINS; k++) {
+    uint8_t point = v.binPoint[k];
+    if (point == NO_BAND) continue;
+    // The even samples' transform is the conjugate-symmetric part of Z, the odd ones' the rest
+    uint16_t k1 = k & (VOICE_FFT_HALF - 1), k2 = (VOICE_FFT_HALF - k) & (VOICE_FFT_HALF - 1);
+    int64_t zr = z[2 * k1], zi = z[2 * k1 + 1], cr = z[2 * k2], ci = -(int64_t)z[2 * k2 + 1];
+    int64_t er = zr + cr, ei = zi + ci;       // 2 x even
+    int64_t odr = zi - ci, odi = cr - zr;     // 2 x odd: -j (Z - conj)
+    int64_t c = v.twiddleCos[k], s = v.twiddleSin[k];
+    // X = (even + e^(-j 2 pi k / 512) odd) / 2, halved once more to stay under 2^29.5
+    int64_t xr = (er + ((odr * c + odi * s) >> 30)) >> 2;
+    int64_t xi = (ei + ((odi * c - odr * s) >> 30)) >> 2;
+    uint64_t power = (uint64_t)(xr * xr + xi * xi) >> VOICE_POWER_SHIFT;
+    uint32_t w = v.binWeight[k];
+    if (point < VOICE_MEL_BANDS) v.mel[point] += power * w;
+    if (point > 0) v.mel[point - 1] += power * (32768 - w);
+  }
+}
+
+void voiceCepstrum(VoiceFrontend& v, int8_t scale, int16_t* mfcc) {
+  const int32_t floor = (int32_t)(VOICE_LOG_FLOOR * 65536);
+  // Undo the frame's scaling, the FFT's halvings and the shifts on the way to v.mel: the
+  // frame is 2^(27 + scale) at full scale, X then 2^(18 + scale), and the bands carry
+  // 2^(15 - VOICE_POWER_SHIFT) on top of its square. The result is the log of the energy
+  // with samples in [-1, 1).
+  int32_t offset = (VOICE_POWER_SHIFT - 15 - 2 * (27 - VOICE_FFT_STAGES - 1 + scale)) * 65536;
+  for (uint8_t m = 0; m < VOICE_MEL_BANDS; m++) {
+    int32_t ln = floor;
+    if (scale != INT8_MIN && v.mel[m]) {
+      ln = (int32_t)(((int64_t)(voiceLog2(v.mel[m]) + offset) * LN2_Q16) >> 16);
+      if (ln < floor) ln = floor;
+    }
+    v.logMel[m] = ln;
+  }
+  for (uint8_t i = 0; i < VOICE_MFCC; i++) {
+    int64_t acc = 0;
+    for (uint8_t m = 0; m < VOICE_MEL_BANDS; m++) acc += (int64_t)v.logMel[m] * v.dct[i][m];
+    const uint8_t shift = 16 + 15 - VOICE_MFCC_FRAC_BITS;
+    acc = (acc + (1 << (shift - 1))) >> shift;
+    mfcc[i] = (int16_t)(acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : acc);
+  }
+}
+
+bool voiceVadUpdate(VoiceFrontend& v, uint64_t sumSquares, uint16_t crossings) {
+  int32_t db = SILENT_DB;
+  if (sumSquares) db = (int32_t)(((int64_t)(voiceLog2(sumSquares) + v.energyOffset) * DB_PER_LOG2_Q16) >> 16);
+  v.energyDb = db;
+
+  bool first = v.floorDb == SILENT_DB;
+  bool like = db >= VAD_MIN && !first &&
+              (db > v.floorDb + VAD_MARGIN || (db > v.floorDb + VAD_ZCR_MARGIN && crossings >= VOICE_VAD_ZCR_MIN));
+  if (first || db < v.floorDb) {
+    v.floorDb = db;
+  } else {
+    v.floorDb += v.floorRise;
+  }
+
+  v.run = like ? (v.run < UINT8_MAX ? v.run + 1 : v.run) : 0;
+  if (like && (v.speech || v.run >= VOICE_VAD_ONSET_FRAMES)) {
+    if (!v.speech) v.stats.utterances++;
+    v.speech = true;
+    v.hang = VOICE_VAD_HANGOVER_FRAMES;
+  } else if (v.speech && !--v.hang) {
+    v.speech = false;
+  }
+  return v.speech;
+}
+
+uint16_t voiceFrontendProcess(VoiceFrontend& v, const int32_t* samples, size_t n) {
+  uint16_t produced = 0;
+  if (n && !v.started) {
+    v.dc.x1 = samples[0] * (1 << 6);
+    v.started = true;
+  }
+  while (n) {
+    size_t take = VOICE_HOP_SAMPLES - v.hopFill;
+    if (take > n) take = n;
+    int32_t* out = v.dcOut + v.hopFill;
+    soundDcBlock(v.dc, samples, out, take);
+    int32_t last = v.lastSample;
+    for (size_t i = 0; i < take; i++) {
+      int32_t d = out[i];
+      int32_t e = d >> ENERGY_SHIFT;
+      v.hopEnergy += (uint64_t)((int64_t)e * e);
+      v.hopCrossings += (d < 0) != (last < 0);
+      int32_t p = last >> FRAME_SHIFT;
+      v.frame[v.framePos] = (d >> FRAME_SHIFT) - (int32_t)(((int64_t)p * v.preemphasis) >> 15);
+      if (++v.framePos == VOICE_FRAME_SAMPLES) v.framePos = 0;
+      if (v.filled < VOICE_FRAME_SAMPLES) v.filled++;
+      last = d;
+    }
+    v.lastSample = last;
+    v.hopFill += take;
+    samples += take;
+    n -= take;
+    if (v.hopFill < VOICE_HOP_SAMPLES) break;
+
+    bool speech = voiceVadUpdate(v, v.hopEnergy, v.hopCrossings);
+    v.hopFill = 0;
+    v.hopEnergy = 0;
+    v.hopCrossings = 0;
+    if (v.filled < VOICE_FRAME_SAMPLES) continue;
+
+    VoiceFeatureFrame f;
+    int8_t scale = voiceWindow(v);
+    if (scale != INT8_MIN) {
+      voiceFft(v);
+      voiceMelEnergies(v);
+    }
+    voiceCepstrum(v, scale, f.mfcc);
+    f.speech = speech;
+    portENTER_CRITICAL(&v.lock);
+    v.ring[v.stats.frames % VOICE_FEATURE_FRAMES] = f;
+    v.stats.frames++;
+    if (speech) v.stats.speechFrames++;
+    v.stats.speech = speech;
+    v.stats.energyDbfs = v.energyDb / 65536.0f;
+    v.stats.noiseFloorDbfs = v.floorDb / 65536.0f;
+    portEXIT_CRITICAL(&v.lock);
+    produced++;
+  }
+  return produced;
+}
+
+uint16_t voiceFrontendFeatures(VoiceFrontend& v, VoiceFeatureFrame* out, uint16_t max, uint32_t& newest) {
+  portENTER_CRITICAL(&v.lock);
+  uint32_t frames = v.stats.frames;
+  portEXIT_CRITICAL(&v.lock);
+  uint16_t n = frames < VOICE_FEATURE_FRAMES ? frames : VOICE_FEATURE_FRAMES;
+  if (n > max) n = max;
+  // One frame per critical section; a frame the producer overwrote meanwhile is skipped
+  uint16_t copied = 0;
+  for (uint32_t seq = frames - n; seq < frames; seq++) {
+    portENTER_CRITICAL(&v.lock);
+    bool current = v.stats.frames - seq <= VOICE_FEATURE_FRAMES;
+    if (current) out[copied] = v.ring[seq % VOICE_FEATURE_FRAMES];
+    portEXIT_CRITICAL(&v.lock);
+    if (current) copied++;
+  }
+  newest = frames;
+  return copied;
+}
+
+VoiceStats voiceFrontendStats(VoiceFrontend& v) {
+  portENTER_CRITICAL(&v.lock);
+  VoiceStats s = v.stats;
+  portEXIT_CRITICAL(&v.lock);
+  return s;
+}
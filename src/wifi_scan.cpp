@@ -0,0 +1,123 @@
+#include "wifi_scan.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+static WifiNetwork cache[WIFI_SCAN_MAX];
+static uint8_t cached = 0;
+static bool started = false;
+static bool scanning = false;
+static bool scanned = false;         // A scan has finished since boot
+static uint32_t scannedAtMs = 0;     // When the cache was last filled
+static uint32_t lastScanMs = 0;      // When the last scan finished (or failed to start)
+static portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Inserts n into list (count entries, strongest first) unless it is weaker than all of a
+// full list; an SSID already listed keeps only its stronger access point
+static void insertNetwork(WifiNetwork* list, uint8_t& count, const WifiNetwork& n) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(list[i].ssid, n.ssid) != 0) continue;
+    if (list[i].rssi >= n.rssi) return;
+    memmove(&list[i], &list[i + 1], (count - i - 1) * sizeof(WifiNetwork));
+    count--;
+    break;
+  }
+  uint8_t at = count;
+  while (at > 0 && list[at - 1].rssi < n.rssi) at--;
+  if (at >= WIFI_SCAN_MAX) return;
+  uint8_t keep = count < WIFI_SCAN_MAX ? count : WIFI_SCAN_MAX - 1;
+  memmove(&list[at + 1], &list[at], (keep - at) * sizeof(WifiNetwork));
+  list[at] = n;
+  count = keep + 1;
+}
+
+static void collect(int16_t found) {
+  WifiNetwork list[WIFI_SCAN_MAX];
+  uint8_t count = 0;
+  for (int16_t i = 0; i < found; i++) {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0 || ssid.length() >= sizeof(list[0].ssid)) continue; // Hidden
+    WifiNetwork n;
+    strcpy(n.ssid, ssid.c_str());
+    int32_t rssi = WiFi.RSSI(i);
+    n.rssi = rssi < -127 ? -127 : (rssi > 0 ? 0 : rssi);
+    n.channel = WiFi.channel(i);
+    n.open = WiFi.encryptionType(i) == WIFI_AUTH_OPEN;
+    insertNetwork(list, count, n);
+  }
+  portENTER_CRITICAL(&cacheMux);
+  memcpy(cache, list, count * sizeof(WifiNetwork));
+  cached = count;
+  portEXIT_CRITICAL(&cacheMux);
+}
+
+static void startScan(uint32_t nowMs) {
+  scanning = WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING;
+  if (!scanning) lastScanMs = nowMs; // Try again at the next refresh
+}
+
+void wifiScanBegin() {
+  started = true;
+  startScan(millis());
+}
+
+uint32_t wifiScanPoll(uint32_t nowMs) {
+  if (!started) return nowMs + WIFI_SCAN_REFRESH_MS;
+  if (scanning) {
+    int16_t found = WiFi.scanComplete();
+    if (found == WIFI_SCAN_RUNNING) return nowMs + WIFI_SCAN_POLL_MS;
+    if (found >= 0) {
+      collect(found);
+      scanned = true;
+      scannedAtMs = nowMs;
+    }
+    WiFi.scanDelete();
+    scanning = false;
+    lastScanMs = nowMs;
+  }
+  if (nowMs - lastScanMs >= WIFI_SCAN_REFRESH_MS) {
+    startScan(nowMs);
+    if (scanning) return nowMs + WIFI_SCAN_POLL_MS;
+  }
+  return lastScanMs + WIFI_SCAN_REFRESH_MS;
+}
+
+uint8_t wifiScanResults(WifiNetwork* out) {
+  portENTER_CRITICAL(&cacheMux);
+  uint8_t count = cached;
+  memcpy(out, cache, count * sizeof(WifiNetwork));
+  portEXIT_CRITICAL(&cacheMux);
+  return count;
+}
+
+static void printJsonString(Print& out, const char* s) {
+  out.print('"');
+  for (; *s; s++) {
+    unsigned char c = *s;
+    if (c == '"' || c == '\\') {
+      out.print('\\');
+      out.print((char)c);
+    } else if (c < 0x20 || c == '<') {
+      out.printf("\\u%04x", c);
+    } else {
+      out.print((char)c);
+    }
+  }
+  out.print('"');
+}
+
+void wifiScanPrintJson(Print& out) {
+  WifiNetwork list[WIFI_SCAN_MAX];
+  uint8_t count = wifiScanResults(list);
+  long age = scanned ? (long)((millis() - scannedAtMs) / 1000) : -1;
+  out.printf("{\"scanning\":%s,\"age_s\":%ld,\"networks\":[", scanning ? "true" : "false", age);
+  for (uint8_t i = 0; i < count; i++) {
+    out.print(i ? ",{\"ssid\":" : "{\"ssid\":");
+    printJsonString(out, list[i].ssid);
+    out.printf(",\"rssi\":%d,\"channel\":%u,\"open\":%s}", list[i].rssi, (unsigned)list[i].channel,
+               list[i].open ? "true" : "false");
+  }
+  out.print("]}");
+}
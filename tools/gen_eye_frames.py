@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+"""
+Generates include/eye_frames.h: the precomputed "Big Eyes" frames shown by
+drawMochiFace().
+
+Every (MochiState, EyeDirection) pair is rasterized here with the same
+primitives and geometry the firmware used to draw at runtime (Adafruit GFX
+drawRoundRect / fillCircle / drawLine / drawFastHLine), then packed in the
+SSD1306 page layout (128 columns x 8 pages, LSB = top row of the page) with
+the 180 degree rotation applied by display.setRotation(2). Showing an
+expression on the device is then a single 1 KB memcpy into the framebuffer.
+
+Usage:  python tools/gen_eye_frames.py [output_header]
+Re-run it whenever the eye geometry below changes.
+"""
+import sys
+import os
+
+WIDTH, HEIGHT = 128, 64
+ROTATION = 2  # Must match display.setRotation() in setup()
+
+# MochiState rows (same order as the enum in main.cpp)
+STATES = ["HAPPY", "ALERT_HIGH", "ALERT_LOW", "TOUCHED"]
+# EyeDirection columns (same order as the enum in main.cpp)
+DIRECTIONS = ["EYES_CENTER", "EYES_UP", "EYES_DOWN", "EYES_LEFT", "EYES_RIGHT"]
+
+# Geometry (kept in sync with the reference GFX path in drawMochiFace)
+EYE_W, EYE_H, EYE_R = 48, 60, 15
+PUPIL_R = 10
+LEFT_EYE_X, RIGHT_EYE_X, EYE_Y = 32, 96, 32
+PUPIL_OFFSETS = {
+    "EYES_CENTER": (0, 0),
+    "EYES_UP": (0, -8),
+    "EYES_DOWN": (0, 8),
+    "EYES_LEFT": (-12, 0),
+    "EYES_RIGHT": (12, 0),
+}
+# Pupil style per expression: (dy, radius, eyes) where eyes is bit 0 = left, bit 1 = right
+PUPIL_STYLES = {
+    "HAPPY": (0, PUPIL_R, 0x3),
+    "ALERT_HIGH": (0, PUPIL_R, 0x3),
+    "ALERT_LOW": (5, PUPIL_R - 2, 0x3),  # Sick / sad, droopy pupils
+    "TOUCHED": (0, PUPIL_R, 0x1),  # Wink: only the left eye is open
+}
+
+
+class Canvas:
+    """Tiny 1-bit canvas replicating the Adafruit GFX rasterization rules."""
+
+    def __init__(self):
+        self.buf = bytearray(WIDTH * HEIGHT // 8)
+
+    def pixel(self, x, y):
+        if x < 0 or y < 0 or x >= WIDTH or y >= HEIGHT:
+            return
+        if ROTATION == 2:
+            x, y = WIDTH - x - 1, HEIGHT - y - 1
+        self.buf[x + (y // 8) * WIDTH] |= 1 << (y & 7)
+
+    def hline(self, x, y, w):
+        for i in range(w):
+            self.pixel(x + i, y)
+
+    def vline(self, x, y, h):
+        for i in range(h):
+            self.pixel(x, y + i)
+
+    def line(self, x0, y0, x1, y1):
+        steep = abs(y1 - y0) > abs(x1 - x0)
+        if steep:
+            x0, y0 = y0, x0
+            x1, y1 = y1, x1
+        if x0 > x1:
+            x0, x1 = x1, x0
+            y0, y1 = y1, y0
+        dx = x1 - x0
+        dy = abs(y1 - y0)
+        err = dx // 2
+        ystep = 1 if y0 < y1 else -1
+        while x0 <= x1:
+            if steep:
+                self.pixel(y0, x0)
+            else:
+                self.pixel(x0, y0)
+            err -= dy
+            if err < 0:
+                y0 += ystep
+                err += dx
+            x0 += 1
+
+    def circle_helper(self, x0, y0, r, corner):
+        f = 1 - r
+        ddf_x = 1
+        ddf_y = -2 * r
+        x, y = 0, r
+        while x < y:
+            if f >= 0:
+                y -= 1
+                ddf_y += 2
+                f += ddf_y
+            x += 1
+            ddf_x += 2
+            f += ddf_x
+            if corner & 0x4:
+                self.pixel(x0 + x, y0 + y)
+                self.pixel(x0 + y, y0 + x)
+            if corner & 0x2:
+                self.pixel(x0 + x, y0 - y)
+                self.pixel(x0 + y, y0 - x)
+            if corner & 0x8:
+                self.pixel(x0 - y, y0 + x)
+                self.pixel(x0 - x, y0 + y)
+            if corner & 0x1:
+                self.pixel(x0 - y, y0 - x)
+                self.pixel(x0 - x, y0 - y)
+
+    def fill_circle_helper(self, x0, y0, r, corners, delta):
+        f = 1 - r
+        ddf_x = 1
+        ddf_y = -2 * r
+        x, y = 0, r
+        px, py = x, y
+        delta += 1
+        while x < y:
+            if f >= 0:
+                y -= 1
+                ddf_y += 2
+                f += ddf_y
+            x += 1
+            ddf_x += 2
+            f += ddf_x
+            if x < y + 1:
+                if corners & 1:
+                    self.vline(x0 + x, y0 - y, 2 * y + delta)
+                if corners & 2:
+                    self.vline(x0 - x, y0 - y, 2 * y + delta)
+            if y != py:
+                if corners & 1:
+                    self.vline(x0 + py, y0 - px, 2 * px + delta)
+                if corners & 2:
+                    self.vline(x0 - py, y0 - px, 2 * px + delta)
+                py = y
+            px = x
+
+    def fill_circle(self, x0, y0, r):
+        self.vline(x0, y0 - r, 2 * r + 1)
+        self.fill_circle_helper(x0, y0, r, 3, 0)
+
+    def round_rect(self, x, y, w, h, r):
+        max_r = min(w, h) // 2
+        r = min(r, max_r)
+        self.hline(x + r, y, w - 2 * r)
+        self.hline(x + r, y + h - 1, w - 2 * r)
+        self.vline(x, y + r, h - 2 * r)
+        self.vline(x + w - 1, y + r, h - 2 * r)
+        self.circle_helper(x + r, y + r, r, 1)
+        self.circle_helper(x + w - r - 1, y + r, r, 2)
+        self.circle_helper(x + w - r - 1, y + h - r - 1, r, 4)
+        self.circle_helper(x + r, y + h - r - 1, r, 8)
+
+
+def render_sockets(c, state):
+    """Everything of an expression except the pupils (used by the eye animator)."""
+    for ex in (LEFT_EYE_X, RIGHT_EYE_X):
+        c.round_rect(ex - EYE_W // 2, EYE_Y - EYE_H // 2, EYE_W, EYE_H, EYE_R)
+    if state == "ALERT_HIGH":  # Angry brows
+        c.line(LEFT_EYE_X - 15, 10, LEFT_EYE_X + 5, 18)
+        c.line(RIGHT_EYE_X + 15, 10, RIGHT_EYE_X - 5, 18)
+    elif state == "TOUCHED":  # Closed right eye of the wink
+        c.hline(RIGHT_EYE_X - 15, EYE_Y, 30)
+
+
+def render_base(state):
+    c = Canvas()
+    render_sockets(c, state)
+    return c.buf
+
+
+def render(state, direction):
+    c = Canvas()
+    dx, dy = PUPIL_OFFSETS[direction]
+
+    # Eye sockets and expression details
+    render_sockets(c, state)
+
+    # Pupils
+    pdy, pr, eyes = PUPIL_STYLES[state]
+    if eyes & 0x1:
+        c.fill_circle(LEFT_EYE_X + dx, EYE_Y + dy + pdy, pr)
+    if eyes & 0x2:
+        c.fill_circle(RIGHT_EYE_X + dx, EYE_Y + dy + pdy, pr)
+    return c.buf
+
+
+def emit_frame(lines, indent, buf):
+    for i in range(0, len(buf), 16):
+        chunk = ", ".join("0x%02X" % b for b in buf[i:i + 16])
+        lines.append("%s%s," % (indent, chunk))
+
+
+def emit(out_path):
+    lines = []
+    lines.append("// AUTO-GENERATED by tools/gen_eye_frames.py -- do not edit by hand.")
+    lines.append("// Precomputed \"Big Eyes\" frames in SSD1306 page layout (rotation %d)." % ROTATION)
+    lines.append("// Indexed as EYE_FRAMES[MochiState][EyeDirection]; each frame is one full")
+    lines.append("// 128x64 framebuffer that can be copied straight into display.getBuffer().")
+    lines.append("// EYE_SOCKETS[MochiState] holds the same expressions without pupils, for the")
+    lines.append("// eye animator to draw tweened pupils on top.")
+    lines.append("#pragma once")
+    lines.append("")
+    lines.append("#include <stdint.h>")
+    lines.append("#include <pgmspace.h>")
+    lines.append("")
+    lines.append("#define EYE_FRAME_STATES %d" % len(STATES))
+    lines.append("#define EYE_FRAME_DIRECTIONS %d" % len(DIRECTIONS))
+    lines.append("#define EYE_FRAME_BYTES %d" % (WIDTH * HEIGHT // 8))
+    lines.append("#define EYE_FRAME_ROTATION %d" % ROTATION)
+    lines.append("")
+    lines.append("// Geometry the frames were drawn with (logical, unrotated coordinates)")
+    lines.append("#define EYE_LEFT_X %d" % LEFT_EYE_X)
+    lines.append("#define EYE_RIGHT_X %d" % RIGHT_EYE_X)
+    lines.append("#define EYE_CENTER_Y %d" % EYE_Y)
+    lines.append("#define EYE_SOCKET_W %d" % EYE_W)
+    lines.append("#define EYE_SOCKET_H %d" % EYE_H)
+    lines.append("#define EYE_SOCKET_R %d" % EYE_R)
+    lines.append("")
+    lines.append("// Pupil offset for each EyeDirection, as {dx, dy}")
+    lines.append("const int8_t EYE_PUPIL_OFFSETS[EYE_FRAME_DIRECTIONS][2] = {")
+    for direction in DIRECTIONS:
+        lines.append("  { %d, %d }, // %s" % (PUPIL_OFFSETS[direction] + (direction,)))
+    lines.append("};")
+    lines.append("")
+    lines.append("// Pupils of each expression: vertical offset, radius and which eyes have one")
+    lines.append("struct EyePupilStyle { int8_t dy; uint8_t r; uint8_t eyes; }; // eyes: bit 0 = left, bit 1 = right")
+    lines.append("const EyePupilStyle EYE_PUPIL_STYLES[EYE_FRAME_STATES] = {")
+    for state in STATES:
+        lines.append("  { %d, %d, 0x%X }, // %s" % (PUPIL_STYLES[state] + (state,)))
+    lines.append("};")
+    lines.append("")
+    lines.append("const uint8_t EYE_FRAMES[EYE_FRAME_STATES][EYE_FRAME_DIRECTIONS][EYE_FRAME_BYTES] PROGMEM = {")
+    for state in STATES:
+        lines.append("  { // %s" % state)
+        for direction in DIRECTIONS:
+            buf = render(state, direction)
+            lines.append("    { // %s" % direction)
+            emit_frame(lines, "      ", buf)
+            lines.append("    },")
+        lines.append("  },")
+    lines.append("};")
+    lines.append("")
+    lines.append("const uint8_t EYE_SOCKETS[EYE_FRAME_STATES][EYE_FRAME_BYTES] PROGMEM = {")
+    for state in STATES:
+        lines.append("  { // %s" % state)
+        emit_frame(lines, "    ", render_base(state))
+        lines.append("  },")
+    lines.append("};")
+    lines.append("")
+    with open(out_path, "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "include", "eye_frames.h")
+    emit(out)
+    print("Wrote %s (%d frames, %d socket layers)" % (out, len(STATES) * len(DIRECTIONS), len(STATES)))
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Writes the pressure traces the simulator's --pressure-test replays through the
+pressure tendency and forecast (src/pressure_trend.cpp).
+
+Each trace is six hours of BMP280 station pressure at a known altitude, shaped
+like a typical barograph record of one kind of weather: the weather's own trend,
+the 12 h atmospheric tide and the sensor's noise, rounded to 0.01 hPa as the
+serial log prints it. They are written as CSV files with '#' comment lines; two
+of them are read by the test:
+    # altitude_m 120
+    # expect falling_quickly rain
+the station altitude, and the tendency and outlook the forecast must give at the
+end of the trace. The expectations are kept clear of the tendency and Zambretti
+boundaries, so they do not depend on the noise.
+
+Traces:
+  settled_high     an anticyclone near sea level, rising slowly: fine
+  approaching_low  steady, then falling 4.5 hPa per 3 h ahead of a front: rain
+  storm            a deep low falling 8 hPa per 3 h: storm
+  clearing         rising 2.5 hPa per 3 h behind a front, at 400 m: fair
+  irregular        falling slowly, read as the adaptive sampler reads it (5 to 60 s
+                   apart, bursts at 1 s, a 45 min gap): changeable
+
+Usage:  python tools/gen_pressure_traces.py [OUT_DIR] [--seed N]
+        (OUT_DIR defaults to sim/traces)
+"""
+import argparse
+import math
+import os
+import random
+
+HOURS = 6
+START_S = 7260            # Time of the first reading (millis() / 1000 after boot)
+TIDE_PERIOD_S = 12 * 3600
+NOISE_HPA = 0.03          # BMP280 at the firmware's oversampling
+
+
+def piecewise(points):
+    """Linear interpolation through (hours, hPa) points, as a function of hours."""
+    def f(h):
+        for (h0, p0), (h1, p1) in zip(points, points[1:]):
+            if h <= h1:
+                return p0 + (p1 - p0) * (h - h0) / (h1 - h0)
+        return points[-1][1]
+    return f
+
+
+TRACES = {
+    "settled_high": dict(
+        comment="An anticyclone near sea level, rising slowly",
+        altitude=50, expect="rising_slowly fine", tide=0.2, tide_phase=1.0,
+        weather=piecewise([(0, 1026.0), (6, 1026.8)])),
+    "approaching_low": dict(
+        comment="Steady for two hours, then falling 4.5 hPa per 3 h ahead of a front",
+        altitude=120, expect="falling_quickly rain", tide=0.3, tide_phase=0.0,
+        weather=piecewise([(0, 1000.0), (2, 1000.0), (6, 994.0)])),
+    "storm": dict(
+        comment="A deep low falling 8 hPa per 3 h",
+        altitude=0, expect="falling_very_rapidly storm", tide=0.3, tide_phase=2.0,
+        weather=piecewise([(0, 990.5), (2, 990.0), (6, 979.3)])),
+    "clearing": dict(
+        comment="Rising 2.5 hPa per 3 h behind a front, at 400 m",
+        altitude=400, expect="rising fair", tide=0.3, tide_phase=4.0,
+        weather=piecewise([(0, 956.0), (6, 961.0)])),
+    "irregular": dict(
+        comment="Falling slowly, read at the adaptive sampler's irregular times with a 45 min gap",
+        altitude=250, expect="falling_slowly changeable", tide=0.15, tide_phase=3.0,
+        weather=piecewise([(0, 980.0), (6, 978.0)]), irregular=True),
+}
+
+
+def times(irregular, rng):
+    """Reading times: every 60 s, or as the adaptive sampler spaces them."""
+    end = START_S + HOURS * 3600
+    if not irregular:
+        return list(range(START_S, end, 60))
+    out, t = [], START_S
+    gap_at = START_S + 4 * 3600       # The device was busy or off for 45 min
+    while t < end:
+        out.append(t)
+        if gap_at <= t < gap_at + 60:
+            t += 45 * 60
+        elif rng.random() < 0.02:     # Something changed: a burst of fast reads
+            for _ in range(rng.randint(10, 40)):
+                t += 1
+                out.append(t)
+        else:
+            t += rng.randint(5, 60)
+    return [x for x in out if x < end]
+
+
+def write(path, spec, rng):
+    with open(path, "w") as f:
+        f.write("# %s\n" % spec["comment"])
+        f.write("# altitude_m %d\n" % spec["altitude"])
+        f.write("# expect %s\n" % spec["expect"])
+        f.write("time_s,pressure\n")
+        for t in times(spec.get("irregular", False), rng):
+            h = (t - START_S) / 3600.0
+            tide = spec["tide"] * math.sin(2 * math.pi * t / TIDE_PERIOD_S + spec["tide_phase"])
+            p = spec["weather"](h) + tide + rng.gauss(0, NOISE_HPA)
+            f.write("%d,%.2f\n" % (t, p))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("out_dir", nargs="?", default=os.path.join("sim", "traces"))
+    ap.add_argument("--seed", type=int, default=1)
+    args = ap.parse_args()
+    os.makedirs(args.out_dir, exist_ok=True)
+    rng = random.Random(args.seed)
+    for name, spec in TRACES.items():
+        path = os.path.join(args.out_dir, "pressure_%s.csv" % name)
+        write(path, spec, rng)
+        print(path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Writes test recordings for the sound level meter: WAV files at a known sound
+level, as the INMP441 would have captured them.
+
+The scale is the microphone's: a sine at full scale is 120 dB SPL (94 dB SPL
+reads -26 dBFS), so the meter should read back the levels asked for here. The
+file is 16 kHz mono, 32-bit PCM, so quiet levels aren't lost to 16-bit
+rounding.
+
+Signals (--signal):
+  tone    a sine of --hz at --db SPL (a 1 kHz, 94 dB calibrator by default)
+  pink    pink noise at --db SPL, unweighted
+  sweep   a logarithmic sweep from 20 Hz to 7.5 kHz at --db SPL
+  room    a quiet room (--db, 35 by default) with a 2 s, 30 dB louder event
+          every 10 s, for checking Leq, maximum and peak
+  speech  a quiet room (35 dB) where, every 6 s, a synthetic voice at --db (60 by
+          default) says three words: a hiss like "s" and a vowel, for checking the
+          voice-activity detection
+
+Use the files with the simulator:
+  .pio/build/native/program --sound-bench tone.wav
+  .pio/build/native/program --voice-bench speech.wav
+  .pio/build/native/program --mic-wav room.wav ...
+
+Usage:  python tools/gen_sound_wav.py OUT.wav [--signal S] [--db DB] [--hz HZ]
+            [--seconds S] [--seed N]
+"""
+import argparse
+import math
+import random
+import struct
+
+RATE = 16000
+FULL_SCALE = 2 ** 31 - 1   # 32-bit PCM; the firmware keeps the top 24 bits
+FULL_SCALE_DB = 120.0
+
+
+def amplitude(db):
+    """Peak of a sine at db SPL, in full-scale units."""
+    return 10 ** ((db - FULL_SCALE_DB) / 20)
+
+
+def pink(n, rng):
+    """Voss-McCartney pink noise scaled to unit RMS."""
+    rows = [rng.uniform(-1, 1) for _ in range(16)]
+    out = []
+    total = sum(rows)
+    for i in range(n):
+        k = (i & -i).bit_length() - 1 if i else 0
+        if k < len(rows):
+            total -= rows[k]
+            rows[k] = rng.uniform(-1, 1)
+            total += rows[k]
+        out.append(total + rng.uniform(-1, 1))
+    mean = sum(out) / n
+    rms = math.sqrt(sum((v - mean) ** 2 for v in out) / n)
+    return [(v - mean) / rms for v in out]
+
+
+def resonator(x, hz, bandwidth):
+    """Two-pole resonance at hz, as a vocal tract formant."""
+    r = math.exp(-math.pi * bandwidth / RATE)
+    a1, a2 = -2 * r * math.cos(2 * math.pi * hz / RATE), r * r
+    y1 = y2 = 0.0
+    out = []
+    for v in x:
+        y = v - a1 * y1 - a2 * y2
+        out.append(y)
+        y1, y2 = y, y1
+    return out
+
+
+def speech(n, rng):
+    """Words of a 60 ms hiss and a 290 ms vowel, three to an utterance every 6 s,
+    at unit RMS while voiced."""
+    word, gap, period = int(0.35 * RATE), int(0.08 * RATE), 6 * RATE
+    hiss = int(0.06 * RATE)
+    pulses, phase = [], 0.0
+    for i in range(n):
+        f0 = 120 + 8 * math.sin(2 * math.pi * 5 * i / RATE)   # With vibrato
+        phase += f0 / RATE
+        pulses.append(1.0 if phase >= 1 else 0.0)
+        phase %= 1
+    vowel = resonator(resonator(pulses, 700, 110), 1200, 120)
+    rms = math.sqrt(sum(v * v for v in vowel) / n)
+    out, last = [], 0.0
+    for i in range(n):
+        t = i % period
+        w, at = t // (word + gap), t % (word + gap)
+        v = 0.0
+        if w < 3 and at < word:
+            if at < hiss:
+                white = rng.uniform(-1, 1)
+                v, last = 2.5 * (white - last), white              # Differenced noise: mostly highs
+            else:
+                envelope = math.sin(math.pi * (at - hiss) / (word - hiss))
+                v = envelope * vowel[i] / rms
+        out.append(v)
+    return out
+
+
+def signal(args, rng):
+    n = int(args.seconds * RATE)
+    if args.signal == "tone":
+        a = amplitude(args.db)
+        return [a * math.sin(2 * math.pi * args.hz * i / RATE) for i in range(n)]
+    if args.signal == "pink":
+        a = amplitude(args.db) / math.sqrt(2)   # RMS of a sine at that level
+        return [a * v for v in pink(n, rng)]
+    if args.signal == "sweep":
+        a = amplitude(args.db)
+        f0, f1 = 20.0, 7500.0
+        k = math.log(f1 / f0) / args.seconds
+        return [a * math.sin(2 * math.pi * f0 * (math.exp(k * i / RATE) - 1) / k) for i in range(n)]
+    if args.signal == "speech":
+        quiet = amplitude(35.0) / math.sqrt(2)
+        voice = amplitude(args.db) / math.sqrt(2)
+        return [quiet * b + voice * v for b, v in zip(pink(n, rng), speech(n, rng))]
+    # room
+    quiet = amplitude(args.db) / math.sqrt(2)
+    loud = amplitude(args.db + 30) / math.sqrt(2)
+    noise = pink(n, rng)
+    return [(loud if (i // RATE) % 10 < 2 else quiet) * v for i, v in enumerate(noise)]
+
+
+def write_wav(path, samples):
+    data = b"".join(struct.pack("<i", max(-FULL_SCALE, min(FULL_SCALE, round(v * FULL_SCALE)))) for v in samples)
+    fmt = struct.pack("<HHIIHH", 1, 1, RATE, RATE * 4, 4, 32)
+    with open(path, "wb") as f:
+        f.write(b"RIFF" + struct.pack("<I", 4 + 8 + len(fmt) + 8 + len(data)) + b"WAVE")
+        f.write(b"fmt " + struct.pack("<I", len(fmt)) + fmt)
+        f.write(b"data" + struct.pack("<I", len(data)) + data)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("out")
+    p.add_argument("--signal", choices=["tone", "pink", "sweep", "room", "speech"], default="tone")
+    p.add_argument("--db", type=float, help="level, dB SPL (94, 35 for room, 60 for speech)")
+    p.add_argument("--hz", type=float, default=1000.0)
+    p.add_argument("--seconds", type=float, default=10.0)
+    p.add_argument("--seed", type=int, default=1)
+    args = p.parse_args()
+    if args.db is None:
+        args.db = {"room": 35.0, "speech": 60.0}.get(args.signal, 94.0)
+    samples = signal(args, random.Random(args.seed))
+    peak = max(abs(v) for v in samples)
+    if peak > 1:
+        print("warning: clipped (peak %.1f dB SPL is over full scale)" % (FULL_SCALE_DB + 20 * math.log10(peak)))
+    write_wav(args.out, samples)
+    print("%s: %s, %.1f dB SPL, %.1f s" % (args.out, args.signal, args.db, args.seconds))
+
+
+if __name__ == "__main__":
+    main()
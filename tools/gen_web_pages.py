@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Generates include/web_pages.h: the web pages in web/ as flash-resident
+templates for the streaming renderer in src/http_response.cpp.
+
+Every %NAME% placeholder (NAME = an upper-case letter followed by upper-case
+letters, digits or '_') is cut out of the page here, so the firmware never
+scans the HTML. Each page becomes its static text plus a segment table: a
+slice length and the placeholder that follows the slice. Anything else with
+a '%' in it (CSS widths, keyframes, JS) is ordinary text.
+
+Usage:  python tools/gen_web_pages.py [output_header]
+Re-run it whenever a page in web/ changes.
+"""
+import os
+import re
+import sys
+
+# (C name prefix, file in web/), in the order they are emitted
+PAGES = [
+    ("CONFIG", "config.html"),
+    ("MAIN", "index.html"),
+    ("SETTINGS", "settings.html"),
+    ("UPDATE", "update.html"),
+]
+
+PLACEHOLDER = re.compile(rb"%([A-Z][A-Z0-9_]*)%")
+PAGE_END = "HTTP_PAGE_END"   # Must match http_response.h
+MAX_SLICE = 0xFFFF           # HttpSegment::textLen is 16 bits
+
+
+def c_string_lines(data):
+    """The bytes as C string literal lines, one per source line."""
+    lines, cur = [], []
+    for b in data:
+        if b == ord("\n"):
+            cur.append("\\n")
+            lines.append("".join(cur))
+            cur = []
+        elif b == ord("\\"):
+            cur.append("\\\\")
+        elif b == ord('"'):
+            cur.append('\\"')
+        elif b == ord("\t"):
+            cur.append("\\t")
+        elif 32 <= b < 127:
+            cur.append(chr(b))
+        else:
+            cur.append("\\%03o" % b)  # Octal escapes stop after three digits
+    if cur:
+        lines.append("".join(cur))
+    return ['    "%s"' % line for line in lines] or ['    ""']
+
+
+def split_page(data):
+    """Returns (static text, [(slice length, placeholder name or None)])."""
+    text, segments, pos = bytearray(), [], 0
+    for m in PLACEHOLDER.finditer(data):
+        text += data[pos:m.start()]
+        segments.append((m.start() - pos, m.group(1).decode()))
+        pos = m.end()
+    text += data[pos:]
+    segments.append((len(data) - pos, None))
+    for length, _ in segments:
+        if length > MAX_SLICE:
+            sys.exit("static slice of %d bytes is too long for HttpSegment" % length)
+    return bytes(text), segments
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    out_path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "include", "web_pages.h")
+
+    pages = []
+    for prefix, name in PAGES:
+        with open(os.path.join(root, "web", name), "rb") as f:
+            data = f.read()
+        text, segments = split_page(data)
+        pages.append((prefix, name, len(data), text, segments))
+
+    names = sorted({ph for *_, segments in pages for _, ph in segments if ph})
+    if len(names) >= 0xFF:
+        sys.exit("too many placeholders for an 8-bit id")
+
+    out = []
+    out.append("// AUTO-GENERATED by tools/gen_web_pages.py from web/ -- do not edit by hand.")
+    out.append("// Each page is its static text with the %NAME% placeholders cut out, plus a")
+    out.append("// segment table: a slice of the text, then the placeholder that follows it.")
+    out.append("// httpSendPage() streams the slices straight from flash and asks the handler")
+    out.append("// for each value in between.")
+    out.append("#pragma once")
+    out.append("")
+    out.append("#include <pgmspace.h>")
+    out.append('#include "http_response.h"')
+    out.append("")
+    out.append("enum WebPlaceholder : uint8_t {")
+    for ph in names:
+        out.append("  PH_%s," % ph)
+    out.append("  PH_COUNT")
+    out.append("};")
+    out.append("")
+    out.append("// Placeholder names as they appear in web/, indexed by WebPlaceholder")
+    out.append("static const char* const WEB_PLACEHOLDER_NAMES[PH_COUNT] = {")
+    for ph in names:
+        out.append('  "%s",' % ph)
+    out.append("};")
+
+    for prefix, name, size, text, segments in pages:
+        used = [ph for _, ph in segments if ph]
+        out.append("")
+        out.append("// web/%s: %d bytes, %d placeholders" % (name, size, len(used)))
+        out.append("static const char %s_PAGE_TEXT[] PROGMEM =" % prefix)
+        lines = c_string_lines(text)
+        lines[-1] += ";"
+        out.extend(lines)
+        out.append("static const HttpSegment %s_PAGE_SEGMENTS[] PROGMEM = {" % prefix)
+        for length, ph in segments:
+            out.append("  { %d, %s }," % (length, "PH_" + ph if ph else PAGE_END))
+        out.append("};")
+        out.append("static const HttpPage %s_PAGE = { %s_PAGE_TEXT, %s_PAGE_SEGMENTS, %d };"
+                   % (prefix, prefix, prefix, len(segments)))
+
+    with open(out_path, "w") as f:
+        f.write("\n".join(out) + "\n")
+    total = sum(len(s) for *_, s in pages)
+    print("Wrote %s (%d pages, %d segments, %d placeholders)" % (out_path, len(pages), total, len(names)))
+
+
+if __name__ == "__main__":
+    main()
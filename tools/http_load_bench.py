@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+"""
+HTTP load and latency benchmark for the device's web API.
+
+Drives groups of concurrent clients against a device or the localhost simulator
+(`pio run -e native`) as described by a scenario file, polls /metrics for the
+device's heap and response-pool state while the load runs, and writes the
+results as JSON so runs against different firmware builds can be compared.
+
+Each client group has:
+    count       number of clients
+    mode        "keepalive": reuse the connection while the server allows it
+                (the AsyncWebServer closes after every response, so this mostly
+                measures reconnect cost); "fresh": a new connection per request
+    rate        requests per second per client; 0 = back to back (closed loop)
+    paths       [{"path": "/data", "weight": 5}, ...] picked at random by weight
+
+With a rate, requests follow a fixed schedule and latency is measured from the
+time the request was due, so a stalled server shows up in the percentiles
+instead of quietly lowering the request rate.
+
+Usage:  python tools/http_load_bench.py http://mochi.local tools/load_scenarios/dashboard.json
+            [--duration S] [--clients-scale X] [--out results.json] [--seed N]
+        python tools/http_load_bench.py --compare base.json new.json [--tolerance 0.2]
+"""
+import argparse
+import asyncio
+import json
+import random
+import sys
+import time
+from urllib.parse import urlsplit
+
+CONNECT_TIMEOUT_S = 5.0
+REQUEST_TIMEOUT_S = 10.0
+METRICS_INTERVAL_S = 2.0
+
+
+class Target:
+    def __init__(self, url):
+        u = urlsplit(url if "://" in url else "http://" + url)
+        self.host = u.hostname
+        self.port = u.port or 80
+        self.base = url
+
+
+class Recorder:
+    """Latency samples and error counts per path."""
+
+    def __init__(self):
+        self.paths = {}
+
+    def _entry(self, path):
+        return self.paths.setdefault(path, {"lat": [], "bytes": 0, "errors": {}, "connects": 0})
+
+    def ok(self, path, latency_s, nbytes):
+        e = self._entry(path)
+        e["lat"].append(latency_s)
+        e["bytes"] += nbytes
+
+    def error(self, path, kind):
+        e = self._entry(path)
+        e["errors"][kind] = e["errors"].get(kind, 0) + 1
+
+    def connected(self, path):
+        self._entry(path)["connects"] += 1
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return None
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+async def read_response(reader):
+    """Reads one HTTP/1.1 response. Returns (status, headers, body)."""
+    status_line = await reader.readline()
+    if not status_line:
+        raise ConnectionError("closed before response")
+    parts = status_line.decode("latin-1").split(" ", 2)
+    if len(parts) < 2 or not parts[0].startswith("HTTP/"):
+        raise ValueError("bad status line")
+    status = int(parts[1])
+    headers = {}
+    while True:
+        line = await reader.readline()
+        if line in (b"\r\n", b"\n", b""):
+            break
+        name, _, value = line.decode("latin-1").partition(":")
+        headers[name.strip().lower()] = value.strip()
+
+    if headers.get("transfer-encoding", "").lower() == "chunked":
+        chunks = []
+        while True:
+            size = int((await reader.readline()).split(b";")[0], 16)
+            if size == 0:
+                await reader.readline()
+                break
+            chunks.append(await reader.readexactly(size))
+            await reader.readexactly(2)
+        body = b"".join(chunks)
+    elif "content-length" in headers:
+        body = await reader.readexactly(int(headers["content-length"]))
+    else:
+        body = await reader.read()
+    return status, headers, body
+
+
+class Client:
+    def __init__(self, target, group, rec, rng):
+        self.target, self.group, self.rec, self.rng = target, group, rec, rng
+        self.keepalive = group.get("mode", "keepalive") == "keepalive"
+        self.rate = float(group.get("rate", 1.0))
+        paths = group.get("paths") or [{"path": "/data"}]
+        self.paths = [p["path"] for p in paths]
+        self.weights = [p.get("weight", 1) for p in paths]
+        self.conn = None
+
+    async def close(self):
+        if self.conn:
+            self.conn[1].close()
+            try:
+                await self.conn[1].wait_closed()
+            except Exception:
+                pass
+            self.conn = None
+
+    async def request(self, path):
+        if self.conn is None:
+            self.conn = await asyncio.wait_for(
+                asyncio.open_connection(self.target.host, self.target.port), CONNECT_TIMEOUT_S)
+            self.rec.connected(path)
+        reader, writer = self.conn
+        connection = "keep-alive" if self.keepalive else "close"
+        writer.write((f"GET {path} HTTP/1.1\r\nHost: {self.target.host}\r\n"
+                      f"Connection: {connection}\r\nAccept-Encoding: identity\r\n\r\n").encode())
+        await writer.drain()
+        status, headers, body = await asyncio.wait_for(read_response(reader), REQUEST_TIMEOUT_S)
+        if not self.keepalive or headers.get("connection", "").lower() == "close":
+            await self.close()
+        return status, len(body)
+
+    async def run(self, stop_at):
+        interval = 1.0 / self.rate if self.rate > 0 else 0.0
+        # Spread the clients' first requests over one interval
+        due = time.monotonic() + self.rng.random() * interval
+        while True:
+            if not interval:
+                due = time.monotonic()
+            if due >= stop_at:
+                break
+            delay = due - time.monotonic()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            path = self.rng.choices(self.paths, self.weights)[0]
+            try:
+                status, nbytes = await self.request(path)
+                if status == 200:
+                    self.rec.ok(path, time.monotonic() - due, nbytes)
+                else:
+                    self.rec.error(path, f"http_{status}")
+            except asyncio.TimeoutError:
+                self.rec.error(path, "timeout")
+                await self.close()
+            except (ConnectionError, OSError):
+                self.rec.error(path, "connect" if self.conn is None else "reset")
+                await self.close()
+            except (ValueError, asyncio.IncompleteReadError):
+                self.rec.error(path, "protocol")
+                await self.close()
+            due += interval
+        await self.close()
+
+
+async def fetch_metrics(target):
+    reader, writer = await asyncio.wait_for(asyncio.open_connection(target.host, target.port), CONNECT_TIMEOUT_S)
+    try:
+        writer.write(f"GET /metrics HTTP/1.1\r\nHost: {target.host}\r\nConnection: close\r\n\r\n".encode())
+        await writer.drain()
+        status, _, body = await asyncio.wait_for(read_response(reader), REQUEST_TIMEOUT_S)
+        return json.loads(body) if status == 200 else None
+    finally:
+        writer.close()
+
+
+async def poll_metrics(target, start, stop_at, timeline):
+    while time.monotonic() < stop_at:
+        t = time.monotonic() - start
+        try:
+            m = await fetch_metrics(target)
+        except Exception:
+            m = None
+        if m is not None:
+            heap, http = m.get("heap", {}), m.get("http", {})
+            timeline.append({
+                "t": round(t, 2),
+                "free": heap.get("free"),
+                "min_free": heap.get("min_free"),
+                "largest_block": heap.get("largest_block"),
+                "fragmentation": heap.get("fragmentation"),
+                "alloc_blocks": heap.get("alloc_blocks"),
+                "http_in_use": http.get("in_use"),
+                "http_exhausted": http.get("exhausted"),
+            })
+        else:
+            timeline.append({"t": round(t, 2), "error": True})
+        await asyncio.sleep(METRICS_INTERVAL_S)
+
+
+def summarize(rec, elapsed):
+    paths, total_ok, total_err = {}, 0, 0
+    for path, e in sorted(rec.paths.items()):
+        lat = sorted(e["lat"])
+        errors = sum(e["errors"].values())
+        total_ok += len(lat)
+        total_err += errors
+        ms = lambda v: None if v is None else round(v * 1000, 2)
+        paths[path] = {
+            "ok": len(lat),
+            "errors": e["errors"],
+            "error_rate": round(errors / max(1, len(lat) + errors), 4),
+            "rps": round(len(lat) / elapsed, 2),
+            "kib_per_s": round(e["bytes"] / 1024 / elapsed, 2),
+            "connects": e["connects"],
+            "latency_ms": {"p50": ms(percentile(lat, 50)), "p90": ms(percentile(lat, 90)),
+                           "p99": ms(percentile(lat, 99)), "max": ms(lat[-1] if lat else None)},
+        }
+    return {
+        "ok": total_ok,
+        "errors": total_err,
+        "error_rate": round(total_err / max(1, total_ok + total_err), 4),
+        "rps": round(total_ok / elapsed, 2),
+        "paths": paths,
+    }
+
+
+async def run_scenario(target, scenario, args):
+    rng = random.Random(args.seed)
+    rec = Recorder()
+    duration = args.duration or scenario.get("duration_s", 30)
+    start = time.monotonic()
+    stop_at = start + duration
+    clients = []
+    for group in scenario["groups"]:
+        for _ in range(max(1, round(group.get("count", 1) * args.clients_scale))):
+            clients.append(Client(target, group, rec, random.Random(rng.random())))
+    timeline = []
+    tasks = [asyncio.ensure_future(c.run(stop_at)) for c in clients]
+    tasks.append(asyncio.ensure_future(poll_metrics(target, start, stop_at, timeline)))
+    await asyncio.gather(*tasks)
+    elapsed = time.monotonic() - start
+    return {
+        "target": target.base,
+        "scenario": scenario.get("name", "unnamed"),
+        "duration_s": round(elapsed, 2),
+        "clients": len(clients),
+        "started": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+        "summary": summarize(rec, elapsed),
+        "heap_timeline": timeline,
+    }
+
+
+def print_report(res):
+    s = res["summary"]
+    print(f"{res['scenario']} against {res['target']}: {res['clients']} clients, {res['duration_s']} s")
+    print(f"  {'path':<24} {'ok':>7} {'err':>6} {'rps':>8} {'p50 ms':>8} {'p90 ms':>8} {'p99 ms':>8} {'max ms':>8}")
+    for path, p in s["paths"].items():
+        lat = p["latency_ms"]
+        fmt = lambda v: "-" if v is None else f"{v:.1f}"
+        print(f"  {path:<24} {p['ok']:7d} {sum(p['errors'].values()):6d} {p['rps']:8.1f}"
+              f" {fmt(lat['p50']):>8} {fmt(lat['p90']):>8} {fmt(lat['p99']):>8} {fmt(lat['max']):>8}"
+              + (f"  {p['errors']}" if p["errors"] else ""))
+    print(f"  total: {s['ok']} ok, {s['errors']} errors ({s['error_rate'] * 100:.2f} %), {s['rps']:.1f} req/s")
+    heap = [h for h in res["heap_timeline"] if not h.get("error") and h.get("free") is not None]
+    if heap:
+        print(f"  heap free {heap[0]['free']} -> {heap[-1]['free']} B, low-water {min(h['min_free'] for h in heap)} B,"
+              f" largest block >= {min(h['largest_block'] for h in heap)} B,"
+              f" pool exhausted {heap[-1]['http_exhausted'] or 0}x")
+
+
+def compare(base_path, new_path, tolerance):
+    """Prints per-path deltas; returns 1 if any p99, error rate or throughput got worse than tolerance."""
+    with open(base_path) as f:
+        base = json.load(f)
+    with open(new_path) as f:
+        new = json.load(f)
+    regressions = 0
+    print(f"{'path':<24} {'p99 ms':>17} {'error rate':>17} {'rps':>15}")
+    for path, n in new["summary"]["paths"].items():
+        b = base["summary"]["paths"].get(path)
+        if not b:
+            continue
+        bp, np_ = b["latency_ms"]["p99"], n["latency_ms"]["p99"]
+        flags = []
+        if bp and np_ and np_ > bp * (1 + tolerance):
+            flags.append("p99")
+        if n["error_rate"] > b["error_rate"] + tolerance / 100:
+            flags.append("errors")
+        if b["rps"] and n["rps"] < b["rps"] * (1 - tolerance):
+            flags.append("rps")
+        regressions += bool(flags)
+        print(f"{path:<24} {bp or 0:8.1f} -> {np_ or 0:6.1f} {b['error_rate']:8.4f} -> {n['error_rate']:6.4f}"
+              f" {b['rps']:7.1f} -> {n['rps']:5.1f}  {'REGRESSION: ' + ', '.join(flags) if flags else ''}")
+    return 1 if regressions else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("target", nargs="?", help="device or simulator base URL, e.g. http://localhost:8080")
+    ap.add_argument("scenario", nargs="?", help="scenario JSON file")
+    ap.add_argument("--duration", type=float, help="override the scenario's duration, s")
+    ap.add_argument("--clients-scale", type=float, default=1.0, help="multiply every group's client count")
+    ap.add_argument("--out", help="write the results as JSON")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--compare", nargs=2, metavar=("BASE", "NEW"), help="compare two result files")
+    ap.add_argument("--tolerance", type=float, default=0.2, help="relative slack before --compare flags a regression")
+    args = ap.parse_args()
+
+    if args.compare:
+        sys.exit(compare(args.compare[0], args.compare[1], args.tolerance))
+    if not args.target or not args.scenario:
+        ap.error("target and scenario are required")
+
+    with open(args.scenario) as f:
+        scenario = json.load(f)
+    res = asyncio.run(run_scenario(Target(args.target), scenario, args))
+    print_report(res)
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(res, f, indent=1)
+
+
+if __name__ == "__main__":
+    main()
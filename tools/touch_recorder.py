@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+"""
+Records touch gestures from a device in DATA_COLLECTION_MODE 1 for training the classifier.
+
+The firmware streams binary frames (include/touch_capture.h): the touch pin's edges,
+stamped to the microsecond, blocks of samples at 2 kHz, and an info frame with its
+counters once a second. This tool decodes them, checking each frame's CRC and
+resynchronising after garbage (boot messages share the port), rebuilds the presses
+from the edges and cuts them into gestures with the firmware's rules: a gesture ends at
+its second release, or 350 ms after its first. It prints each gesture with what the
+firmware makes of it: the tree in include/touch_gesture_model.h once it has been trained
+on recordings, the fixed thresholds until then.
+
+With --label, every gesture is appended to --out as one NDJSON line for
+tools/train_touch_gestures.py. Record one gesture kind per run, e.g. 30 double taps
+with --label double_tap, then the others, and a run of --label none with brushes and
+half-hearted holds.
+
+--raw keeps the bytes as received, to replay later with --input. At the end (or on
+Ctrl-C) it reports the stream's health: the sample rate actually received, CRC errors,
+records the device dropped, and how well the sampled press lengths agree with the
+edges'.
+
+Usage:  python tools/touch_recorder.py --port /dev/ttyACM0 [--label double_tap] [--out gestures.ndjson]
+        python tools/touch_recorder.py --input capture.bin
+"""
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import time
+
+from train_touch_gestures import fixed
+
+# Kept in sync with include/touch_capture.h and include/touch_gesture.h
+SYNC = b"\xa5\x5a"
+FRAME_INFO, FRAME_SAMPLES, FRAME_EDGE = 0x01, 0x02, 0x03
+SEGMENT_GAP_MS = 350
+MAX_PRESS_MS = 60000
+LATE_US = 100000   # An edge can reach us this much after samples or info stamped later
+CLASSES = ["none", "single_tap", "double_tap", "long_press"]
+
+MODEL = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "touch_gesture_model.h")
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = self.crc_errors = self.skipped = 0
+
+    def feed(self, data):
+        """Yields (type, payload) for every good frame in the stream so far."""
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                keep = 1 if self.buf[-1:] == SYNC[:1] else 0
+                self.skipped += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                return
+            self.skipped += start
+            del self.buf[:start]
+            if len(self.buf) < 4:
+                return
+            length = self.buf[3]
+            if len(self.buf) < 6 + length:
+                return
+            body = bytes(self.buf[2:4 + length])
+            if struct.unpack_from("<H", self.buf, 4 + length)[0] != crc16(body):
+                self.crc_errors += 1
+                self.skipped += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:6 + length]
+            self.frames += 1
+            yield body[0], body[2:]
+
+
+class Unwrap:
+    """32-bit microsecond counter to a running one"""
+    def __init__(self):
+        self.last = None
+        self.high = 0
+
+    def __call__(self, us):
+        if self.last is not None and us < self.last and self.last - us > 1 << 31:
+            self.high += 1 << 32
+        self.last = us
+        return self.high + us
+
+
+def load_model(path):
+    """The tree from the generated header, or None while the firmware doesn't use it"""
+    try:
+        text = open(path).read()
+    except OSError:
+        return None
+    if not re.search(r"TOUCH_TREE_RECORDED = true", text):
+        return None
+    features = {"PRESSES": 0, "FIRST_MS": 1, "GAP_MS": 2, "SECOND_MS": 3}
+    nodes = []
+    for m in re.finditer(r"\{ (TOUCH_\w+), (\d+), (\w+), (\d+) \}", text):
+        kind, threshold, left, right = m.groups()
+        if kind == "TOUCH_TREE_LEAF":
+            nodes.append(("leaf", CLASSES.index(left[len("TOUCH_GESTURE_"):].lower())))
+        else:
+            nodes.append((features[kind[len("TOUCH_FEATURE_"):]], int(threshold), int(left), int(right)))
+    return nodes or None
+
+
+def classify(model, x):
+    n = model[0]
+    while n[0] != "leaf":
+        n = model[n[2] if x[n[0]] <= n[1] else n[3]]
+    return CLASSES[n[1]]
+
+
+class Recorder:
+    def __init__(self, args):
+        self.args = args
+        self.model = load_model(MODEL)
+        self.unwrap = Unwrap()
+        self.info = None
+        self.first_info = None
+        self.samples = 0
+        self.sample_span = [None, None]
+        self.sampled_high = 0     # Samples read as touched, to compare with the edges
+        self.edge_high_us = 0
+        self.edges = 0
+        self.level = 0
+        self.press_start = None
+        self.presses = []         # In the open gesture, [start_ms, length_ms]
+        self.last_release = None
+        self.gestures = 0
+        self.out = open(args.out, "a") if args.label else None
+
+    def frame(self, kind, payload):
+        if kind == FRAME_INFO and len(payload) >= 20:
+            t, hz, pin, version, edges, blocks, dropped = struct.unpack_from("<IHBBIII", payload)
+            self.info = {"t": self.unwrap(t), "hz": hz, "pin": pin, "version": version, "edges": edges,
+                         "blocks": blocks, "dropped": dropped}
+            if self.first_info is None:
+                self.first_info = self.info
+                print("device: pin %d, %d Hz sampling, capture version %d" % (pin, hz, version))
+            self.idle(self.info["t"] - LATE_US)
+        elif kind == FRAME_SAMPLES and len(payload) >= 11:
+            t0, period, count, bits = struct.unpack_from("<IHBI", payload)
+            t0 = self.unwrap(t0)
+            self.samples += count
+            self.sampled_high += bin(bits & ((1 << count) - 1)).count("1") * period
+            if self.sample_span[0] is None:
+                self.sample_span[0] = t0
+            self.sample_span[1] = t0 + count * period
+            self.idle(t0 + count * period - LATE_US)
+        elif kind == FRAME_EDGE and len(payload) >= 5:
+            t, level = struct.unpack_from("<IB", payload)
+            self.edge(self.unwrap(t), level)
+
+    def edge(self, us, level):
+        self.edges += 1
+        if level == self.level:
+            return
+        self.level = level
+        ms = us / 1000.0
+        if level:
+            self.idle(us)
+            self.press_start = ms
+            return
+        if self.press_start is None:
+            return
+        self.edge_high_us += (ms - self.press_start) * 1000
+        self.presses.append([self.press_start, min(ms - self.press_start, MAX_PRESS_MS)])
+        self.last_release = ms
+        self.press_start = None
+        if len(self.presses) == 2:
+            self.gesture()
+
+    def idle(self, us):
+        """The device's clock has reached us: close a gesture left open long enough"""
+        if self.presses and self.press_start is None and us / 1000.0 - self.last_release >= SEGMENT_GAP_MS:
+            self.gesture()
+
+    def gesture(self):
+        presses = [[int(round(s - self.presses[0][0])), int(round(d))] for s, d in self.presses]
+        self.presses = []
+        self.gestures += 1
+        x = [len(presses), presses[0][1], 0, 0]
+        if len(presses) > 1:
+            x[2], x[3] = presses[1][0] - presses[0][1], presses[1][1]
+        said = classify(self.model, x) if self.model else fixed(x)
+        print("gesture %d: %s -> %s" % (self.gestures, " / ".join(
+            ("%d ms" % d) if i == 0 else ("gap %d ms, %d ms" % (s - presses[i - 1][0] - presses[i - 1][1], d))
+            for i, (s, d) in enumerate(presses)), said or "none"))
+        if self.out:
+            self.out.write(json.dumps({"label": self.args.label, "presses": presses}) + "\n")
+            self.out.flush()
+
+    def report(self, decoder, seconds):
+        print("--- %d frames, %d CRC errors, %d bytes skipped, %.1f s" %
+              (decoder.frames, decoder.crc_errors, decoder.skipped, seconds))
+        if self.sample_span[0] is not None and self.sample_span[1] > self.sample_span[0]:
+            span = (self.sample_span[1] - self.sample_span[0]) / 1e6
+            print("samples: %d, %.0f Hz received" % (self.samples, self.samples / span))
+        if self.info:
+            print("device: %d edges, %d sample blocks, %d records dropped" %
+                  (self.info["edges"], self.info["blocks"], self.info["dropped"]))
+        print("edges: %d received, %d gestures" % (self.edges, self.gestures))
+        if self.edge_high_us:
+            print("touched time: %.1f ms from edges, %.1f ms from samples" %
+                  (self.edge_high_us / 1000, self.sampled_high / 1000))
+        if self.out:
+            print("appended %d gestures labelled %s to %s" % (self.gestures, self.args.label, self.args.out))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--port", help="serial port of the device")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--input", help="recorded capture instead of a port ('-' for stdin)")
+    ap.add_argument("--raw", help="also save the bytes received here")
+    ap.add_argument("--label", choices=CLASSES, help="label every gesture and append it to --out")
+    ap.add_argument("--out", default="touch_gestures.ndjson")
+    ap.add_argument("--duration", type=float, help="stop after this many seconds")
+    args = ap.parse_args()
+    if bool(args.port) == bool(args.input):
+        ap.error("give one of --port or --input")
+
+    if args.port:
+        import serial  # pyserial
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        read = lambda: port.read(4096)
+    elif args.input == "-":
+        read = lambda: os.read(sys.stdin.fileno(), 4096)
+    else:
+        f = open(args.input, "rb")
+        read = lambda: f.read(4096)
+    raw = open(args.raw, "wb") if args.raw else None
+
+    decoder = Decoder()
+    recorder = Recorder(args)
+    start = time.time()
+    try:
+        while args.duration is None or time.time() - start < args.duration:
+            data = read()
+            if not data:
+                if args.input:
+                    break
+                continue
+            if raw:
+                raw.write(data)
+            for kind, payload in decoder.feed(data):
+                recorder.frame(kind, payload)
+    except KeyboardInterrupt:
+        pass
+    recorder.idle(float("inf"))   # Close the last gesture
+    recorder.report(decoder, time.time() - start)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""
+Trains the touch gesture classifier and writes include/touch_gesture_model.h.
+
+The classifier is a small decision tree (CART, Gini impurity) over the features
+the firmware's segmenter extracts from each gesture (src/touch_gesture.cpp): the
+number of presses, the first press's length, the gap after it and the second
+press's length, in ms. The classes are none, single_tap, double_tap and
+long_press.
+
+Training data are NDJSON files written by tools/touch_recorder.py, one gesture
+per line: {"label": "double_tap", "presses": [[start_ms, length_ms], ...]}.
+--synthetic N adds N generated gestures per class, drawn from typical human
+timings (see synthetic() below). The model in the repository is trained on
+those alone, so the firmware keeps classifying with its fixed thresholds (the
+old detectTouchGesture()) until the tree is retrained on recordings: the header
+records whether it was. Scores on synthetic gestures only show how well the
+tree fits the generator, not real taps.
+
+The report gives the k-fold cross-validated accuracy and confusion matrix, the
+accuracy of the firmware's fixed thresholds on the same gestures, and the cost
+of one classification in comparisons (one per level visited). The firmware
+reports the cycles it takes in /metrics.
+
+Usage:  python tools/train_touch_gestures.py [data.ndjson ...] [--synthetic N]
+            [--depth D] [--min-leaf N] [--folds K] [--seed N] [--out HEADER]
+"""
+import argparse
+import json
+import math
+import os
+import random
+
+# Kept in sync with include/touch_gesture.h
+CLASSES = ["none", "single_tap", "double_tap", "long_press"]
+ENUMS = ["TOUCH_GESTURE_NONE", "TOUCH_GESTURE_SINGLE_TAP", "TOUCH_GESTURE_DOUBLE_TAP", "TOUCH_GESTURE_LONG_PRESS"]
+FEATURES = ["TOUCH_FEATURE_PRESSES", "TOUCH_FEATURE_FIRST_MS", "TOUCH_FEATURE_GAP_MS", "TOUCH_FEATURE_SECOND_MS"]
+SEGMENT_GAP_MS = 350
+MAX_PRESS_MS = 60000
+TAP_MAX_MS = 250
+DOUBLE_TAP_MS = 400
+LONG_PRESS_MS = 1500
+
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "touch_gesture_model.h")
+
+
+def features(presses):
+    """The segmenter's features for a gesture of at most two presses."""
+    first = min(presses[0][1], MAX_PRESS_MS)
+    if len(presses) < 2:
+        return [1, first, 0, 0]
+    gap = presses[1][0] - (presses[0][0] + presses[0][1])
+    return [2, first, min(gap, MAX_PRESS_MS), min(presses[1][1], MAX_PRESS_MS)]
+
+
+def lognormal(rng, median, sigma, low, high):
+    return int(round(min(high, max(low, median * math.exp(rng.gauss(0, sigma))))))
+
+
+def synthetic(n, rng):
+    """n gestures per class. Single taps: a 110 ms median press; double taps: two
+    90 ms presses 130 ms apart; long presses: a 2 s hold; none: a press too long
+    for a tap and too short for a hold, or a tap followed by such a press."""
+    out = []
+    for _ in range(n):
+        out.append(("single_tap", [[0, lognormal(rng, 110, 0.45, 20, 900)]]))
+        d1 = lognormal(rng, 90, 0.4, 20, 600)
+        gap = lognormal(rng, 130, 0.4, 30, SEGMENT_GAP_MS - 10)
+        out.append(("double_tap", [[0, d1], [d1 + gap, lognormal(rng, 90, 0.4, 20, 600)]]))
+        out.append(("long_press", [[0, lognormal(rng, 2000, 0.25, 900, 8000)]]))
+        if rng.random() < 0.6:
+            out.append(("none", [[0, lognormal(rng, 700, 0.35, 200, 3000)]]))
+        else:
+            d1 = lognormal(rng, 100, 0.4, 20, 600)
+            gap = lognormal(rng, 150, 0.4, 30, SEGMENT_GAP_MS - 10)
+            out.append(("none", [[0, d1], [d1 + gap, lognormal(rng, 900, 0.5, 250, 5000)]]))
+    return out
+
+
+def load(paths):
+    out = []
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                line = line.strip()
+                if not line:
+                    continue
+                g = json.loads(line)
+                if g["label"] not in CLASSES:
+                    raise SystemExit("%s: unknown label %r" % (path, g["label"]))
+                out.append((g["label"], [list(p) for p in g["presses"]][:2]))
+    return out
+
+
+def fixed(x):
+    """The firmware's fixed thresholds (classifyFixed() in src/touch_gesture.cpp)."""
+    presses, first, gap, second = x
+    if presses >= 2 and first < TAP_MAX_MS and second < TAP_MAX_MS and gap + second < DOUBLE_TAP_MS:
+        return "double_tap"
+    if first >= LONG_PRESS_MS or second >= LONG_PRESS_MS:
+        return "long_press"
+    if first < TAP_MAX_MS or (presses >= 2 and second < TAP_MAX_MS):
+        return "single_tap"
+    return "none"
+
+
+# --- CART ---
+
+def gini(counts):
+    n = sum(counts)
+    return 1 - sum((c / n) ** 2 for c in counts) if n else 0
+
+
+def class_counts(rows):
+    counts = [0] * len(CLASSES)
+    for x, y in rows:
+        counts[y] += 1
+    return counts
+
+
+def build(rows, depth, max_depth, min_leaf):
+    counts = class_counts(rows)
+    majority = max(range(len(CLASSES)), key=lambda c: (counts[c], -c))
+    if depth == max_depth or len(rows) < 2 * min_leaf or max(counts) == len(rows):
+        return {"leaf": majority, "counts": counts}
+    best = None
+    parent = gini(counts) * len(rows)
+    for f in range(len(FEATURES)):
+        ordered = sorted(rows, key=lambda r: r[0][f])
+        left = [0] * len(CLASSES)
+        right = counts[:]
+        for i in range(len(ordered) - 1):
+            y = ordered[i][1]
+            left[y] += 1
+            right[y] -= 1
+            a, b = ordered[i][0][f], ordered[i + 1][0][f]
+            if a == b or i + 1 < min_leaf or len(ordered) - i - 1 < min_leaf:
+                continue
+            gain = parent - gini(left) * (i + 1) - gini(right) * (len(ordered) - i - 1)
+            if best is None or gain > best[0] + 1e-9:
+                best = (gain, f, (a + b) // 2)
+    if best is None or best[0] <= 1e-9:
+        return {"leaf": majority, "counts": counts}
+    _, f, t = best
+    return {
+        "feature": f,
+        "threshold": t,
+        "left": build([r for r in rows if r[0][f] <= t], depth + 1, max_depth, min_leaf),
+        "right": build([r for r in rows if r[0][f] > t], depth + 1, max_depth, min_leaf),
+    }
+
+
+def predict(node, x):
+    visits = 0
+    while "leaf" not in node:
+        visits += 1
+        node = node["left"] if x[node["feature"]] <= node["threshold"] else node["right"]
+    return node["leaf"], visits
+
+
+def prune(node):
+    """Merges sibling leaves that answer the same."""
+    if "leaf" in node:
+        return node
+    node["left"], node["right"] = prune(node["left"]), prune(node["right"])
+    l, r = node["left"], node["right"]
+    if "leaf" in l and "leaf" in r and l["leaf"] == r["leaf"]:
+        return {"leaf": l["leaf"], "counts": [a + b for a, b in zip(l["counts"], r["counts"])]}
+    return node
+
+
+def depth_of(node):
+    return 0 if "leaf" in node else 1 + max(depth_of(node["left"]), depth_of(node["right"]))
+
+
+def flatten(node, out):
+    """Preorder; returns the node's index."""
+    index = len(out)
+    out.append(None)
+    if "leaf" in node:
+        out[index] = ("leaf", node["leaf"], node["counts"])
+    else:
+        left = flatten(node["left"], out)
+        right = flatten(node["right"], out)
+        out[index] = ("split", node["feature"], node["threshold"], left, right)
+    return index
+
+
+# --- Report ---
+
+def confusion(truth, predicted):
+    m = [[0] * len(CLASSES) for _ in CLASSES]
+    for t, p in zip(truth, predicted):
+        m[t][p] += 1
+    return m
+
+
+def print_confusion(m):
+    print("  %-12s %s" % ("true \\ said", " ".join("%11s" % c for c in CLASSES)))
+    for i, row in enumerate(m):
+        print("  %-12s %s" % (CLASSES[i], " ".join("%11d" % v for v in row)))
+
+
+def write_header(path, nodes, depth, recorded, summary):
+    lines = [
+        "// AUTO-GENERATED by tools/train_touch_gestures.py -- do not edit by hand.",
+        "// Decision tree for touchGestureClassify() (touch_gesture.h), preorder, root first.",
+    ]
+    lines += ["// " + s for s in summary]
+    lines += [
+        "#pragma once",
+        "",
+        '#include "touch_gesture.h"',
+        "",
+        "// Trained on recorded gestures; until then touchGestureClassify() keeps the fixed thresholds",
+        "const bool TOUCH_TREE_RECORDED = %s;" % ("true" if recorded else "false"),
+        "const uint8_t TOUCH_TREE_DEPTH = %d;" % depth,
+        "const uint8_t TOUCH_TREE_NODES = %d;" % len(nodes),
+        "const TouchTreeNode TOUCH_TREE[TOUCH_TREE_NODES] = {",
+    ]
+    for i, n in enumerate(nodes):
+        if n[0] == "leaf":
+            lines.append("  { TOUCH_TREE_LEAF, 0, %s, 0 },  // %d: %s (training %s)" %
+                         (ENUMS[n[1]], i, CLASSES[n[1]], "/".join(str(c) for c in n[2])))
+        else:
+            _, f, t, left, right = n
+            lines.append("  { %s, %d, %d, %d },  // %d: %s <= %d" % (FEATURES[f], t, left, right, i,
+                                                                    FEATURES[f][len("TOUCH_FEATURE_"):].lower(), t))
+    lines += ["};", ""]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("data", nargs="*", help="recorded gestures (NDJSON from touch_recorder.py)")
+    ap.add_argument("--synthetic", type=int, default=0, help="generated gestures per class")
+    ap.add_argument("--depth", type=int, default=4, help="deepest tree level")
+    ap.add_argument("--min-leaf", type=int, default=20, help="fewest training gestures in a leaf")
+    ap.add_argument("--folds", type=int, default=5)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--out", default=DEFAULT_OUT)
+    args = ap.parse_args()
+
+    rng = random.Random(args.seed)
+    gestures = load(args.data) + synthetic(args.synthetic, rng)
+    if len(gestures) < 2 * args.folds:
+        raise SystemExit("not enough gestures: record some, or add --synthetic N")
+    rng.shuffle(gestures)
+    rows = [(features(p), CLASSES.index(label)) for label, p in gestures]
+    print("%d gestures: %s" % (len(rows), ", ".join("%d %s" % (c, CLASSES[i]) for i, c in enumerate(class_counts(rows)))))
+
+    # Cross-validation
+    truth, said = [], []
+    for k in range(args.folds):
+        test = rows[k::args.folds]
+        train = [r for i, r in enumerate(rows) if i % args.folds != k]
+        tree = prune(build(train, 0, args.depth, args.min_leaf))
+        for x, y in test:
+            truth.append(y)
+            said.append(predict(tree, x)[0])
+    accuracy = sum(t == p for t, p in zip(truth, said)) / len(truth)
+    old = [CLASSES.index(fixed(x)) for x, _ in rows]
+    old_accuracy = sum(t == p for t, p in zip([y for _, y in rows], old)) / len(rows)
+    print("decision tree, %d-fold cross-validated: %.1f %% correct" % (args.folds, 100 * accuracy))
+    print_confusion(confusion(truth, said))
+    print("fixed thresholds (the firmware's default): %.1f %% correct" % (100 * old_accuracy))
+    print_confusion(confusion([y for _, y in rows], old))
+
+    tree = prune(build(rows, 0, args.depth, args.min_leaf))
+    visits = [predict(tree, x)[1] for x, _ in rows]
+    nodes = []
+    flatten(tree, nodes)
+    depth = depth_of(tree)
+    print("final tree: %d nodes, depth %d; %.2f comparisons per classification on average, %d at most" %
+          (len(nodes), depth, sum(visits) / len(visits), max(visits)))
+    source = []
+    if args.data:
+        source.append("%d recorded (%s)" % (len(rows) - 4 * args.synthetic, ", ".join(os.path.basename(p) for p in args.data)))
+    if args.synthetic:
+        source.append("%d synthetic (seed %d)" % (4 * args.synthetic, args.seed))
+    summary = [
+        "Trained on %s gestures, depth limit %d, at least %d per leaf." % (" + ".join(source), args.depth, args.min_leaf),
+        "%d-fold cross-validated accuracy %.1f %% (the fixed thresholds: %.1f %%)." %
+        (args.folds, 100 * accuracy, 100 * old_accuracy),
+    ]
+    if not args.data:
+        summary.append("Synthetic gestures only: these scores say how well it fits the generator, not real taps.")
+    write_header(args.out, nodes, depth, bool(args.data), summary)
+    print("wrote %s" % os.path.relpath(args.out))
+
+
+if __name__ == "__main__":
+    main()